@@ -4157,6 +4157,16 @@ static int direct_page_fault(struct kvm_vcpu *vcpu, gpa_t gpa, u32 error_code,
 		return r;
 
 	r = RET_PF_RETRY;
+
+	/*
+	 * If an invalidation is already known to be in flight the fault is
+	 * going to be retried anyway; don't pile onto mmu_lock just to find
+	 * that out.  The check is repeated under the lock, so a racy miss
+	 * here only costs the lock round trip that would have happened.
+	 */
+	if (mmu_notifier_retry(vcpu->kvm, mmu_seq))
+		goto out_release;
+
 	spin_lock(&vcpu->kvm->mmu_lock);
 	if (mmu_notifier_retry(vcpu->kvm, mmu_seq))
 		goto out_unlock;
@@ -4167,6 +4177,7 @@ static int direct_page_fault(struct kvm_vcpu *vcpu, gpa_t gpa, u32 error_code,
 
 out_unlock:
 	spin_unlock(&vcpu->kvm->mmu_lock);
+out_release:
 	kvm_release_pfn_clean(pfn);
 	return r;
 }
@@ -5569,6 +5580,15 @@ EXPORT_SYMBOL_GPL(kvm_disable_tdp);
 /* The return value indicates if tlb flush on all vcpus is needed. */
 typedef bool (*slot_level_handler) (struct kvm *kvm, struct kvm_rmap_head *rmap_head);
 
+/*
+ * Number of rmaps a memslot walk handles before checking whether vCPUs
+ * are waiting for mmu_lock.  spin_needbreak() is constant false without
+ * CONFIG_PREEMPTION, so on such kernels a walk over a TB-sized slot
+ * would otherwise only let faulting vCPUs in when this CPU itself needs
+ * to reschedule.
+ */
+#define SLOT_WALK_LOCK_BATCH	1024
+
 /* The caller should hold mmu-lock before calling this function. */
 static __always_inline bool
 slot_handle_level_range(struct kvm *kvm, struct kvm_memory_slot *memslot,
@@ -5576,6 +5596,7 @@ slot_handle_level_range(struct kvm *kvm, struct kvm_memory_slot *memslot,
 			gfn_t start_gfn, gfn_t end_gfn, bool lock_flush_tlb)
 {
 	struct slot_rmap_walk_iterator iterator;
+	unsigned int batch = 0;
 	bool flush = false;
 
 	for_each_slot_rmap_range(memslot, start_level, end_level, start_gfn,
@@ -5583,14 +5604,21 @@ slot_handle_level_range(struct kvm *kvm, struct kvm_memory_slot *memslot,
 		if (iterator.rmap)
 			flush |= fn(kvm, iterator.rmap);
 
-		if (need_resched() || spin_needbreak(&kvm->mmu_lock)) {
+		if (need_resched() || spin_needbreak(&kvm->mmu_lock) ||
+		    (++batch >= SLOT_WALK_LOCK_BATCH &&
+		     spin_is_contended(&kvm->mmu_lock))) {
 			if (flush && lock_flush_tlb) {
 				kvm_flush_remote_tlbs_with_address(kvm,
 						start_gfn,
 						iterator.gfn - start_gfn + 1);
 				flush = false;
 			}
-			cond_resched_lock(&kvm->mmu_lock);
+			if (!cond_resched_lock(&kvm->mmu_lock)) {
+				spin_unlock(&kvm->mmu_lock);
+				cpu_relax();
+				spin_lock(&kvm->mmu_lock);
+			}
+			batch = 0;
 		}
 	}
 
@@ -40,6 +40,18 @@ module_param(nested_early_check, bool, S_IRUGO);
 
 #define VMX_MISC_EMULATED_PREEMPTION_TIMER_RATE 5
 
+/*
+ * Groups of vmcs12 fields that prepare_vmcs02_rare() copies to vmcs02 only
+ * when L1 has modified them, see vmx->nested.dirty_vmcs12.  The two guest
+ * groups match the enlightened VMCS's GUEST_GRP2 and GUEST_GRP1 clean fields.
+ */
+#define VMCS12_DIRTY_GUEST_SEGMENTS	BIT(0)	/* selectors, bases, limits, ARs */
+#define VMCS12_DIRTY_GUEST_MISC		BIT(1)	/* SYSENTER, PDPTRs, BNDCFGS, ... */
+#define VMCS12_DIRTY_OTHER		BIT(2)
+#define VMCS12_DIRTY_ALL		(VMCS12_DIRTY_GUEST_SEGMENTS |	\
+					 VMCS12_DIRTY_GUEST_MISC |	\
+					 VMCS12_DIRTY_OTHER)
+
 enum {
 	VMX_VMREAD_BITMAP,
 	VMX_VMWRITE_BITMAP,
@@ -1963,7 +1975,7 @@ static int nested_vmx_handle_enlightened_vmptrld(struct kvm_vcpu *vcpu,
 			return 0;
 		}
 
-		vmx->nested.dirty_vmcs12 = true;
+		vmx->nested.dirty_vmcs12 = VMCS12_DIRTY_ALL;
 		vmx->nested.hv_evmcs_vmptr = evmcs_gpa;
 
 		evmcs_gpa_changed = true;
@@ -2284,12 +2296,27 @@ static void prepare_vmcs02_early(struct vcpu_vmx *vmx, struct vmcs12 *vmcs12)
 	}
 }
 
+/*
+ * Returns true if the vmcs02 copy of a group of fields may be stale.  With
+ * an enlightened VMCS, L1 tells us through the clean fields; otherwise KVM
+ * tracks the groups written by VMWRITE in vmx->nested.dirty_vmcs12.
+ */
+static bool vmcs02_group_stale(struct vcpu_vmx *vmx, u32 group, u32 evmcs_clean)
+{
+	struct hv_enlightened_vmcs *hv_evmcs = vmx->nested.hv_evmcs;
+
+	if (hv_evmcs)
+		return !(hv_evmcs->hv_clean_fields & evmcs_clean);
+
+	return vmx->nested.dirty_vmcs12 & group;
+}
+
 static void prepare_vmcs02_rare(struct vcpu_vmx *vmx, struct vmcs12 *vmcs12)
 {
 	struct hv_enlightened_vmcs *hv_evmcs = vmx->nested.hv_evmcs;
 
-	if (!hv_evmcs || !(hv_evmcs->hv_clean_fields &
-			   HV_VMX_ENLIGHTENED_CLEAN_FIELD_GUEST_GRP2)) {
+	if (vmcs02_group_stale(vmx, VMCS12_DIRTY_GUEST_SEGMENTS,
+			       HV_VMX_ENLIGHTENED_CLEAN_FIELD_GUEST_GRP2)) {
 		vmcs_write16(GUEST_ES_SELECTOR, vmcs12->guest_es_selector);
 		vmcs_write16(GUEST_CS_SELECTOR, vmcs12->guest_cs_selector);
 		vmcs_write16(GUEST_SS_SELECTOR, vmcs12->guest_ss_selector);
@@ -2328,8 +2355,8 @@ static void prepare_vmcs02_rare(struct vcpu_vmx *vmx, struct vmcs12 *vmcs12)
 		vmcs_writel(GUEST_IDTR_BASE, vmcs12->guest_idtr_base);
 	}
 
-	if (!hv_evmcs || !(hv_evmcs->hv_clean_fields &
-			   HV_VMX_ENLIGHTENED_CLEAN_FIELD_GUEST_GRP1)) {
+	if (vmcs02_group_stale(vmx, VMCS12_DIRTY_GUEST_MISC,
+			       HV_VMX_ENLIGHTENED_CLEAN_FIELD_GUEST_GRP1)) {
 		vmcs_write32(GUEST_SYSENTER_CS, vmcs12->guest_sysenter_cs);
 		vmcs_writel(GUEST_PENDING_DBG_EXCEPTIONS,
 			    vmcs12->guest_pending_dbg_exceptions);
@@ -2352,6 +2379,9 @@ static void prepare_vmcs02_rare(struct vcpu_vmx *vmx, struct vmcs12 *vmcs12)
 			vmcs_write64(GUEST_BNDCFGS, vmcs12->guest_bndcfgs);
 	}
 
+	if (!hv_evmcs && !(vmx->nested.dirty_vmcs12 & VMCS12_DIRTY_OTHER))
+		return;
+
 	if (nested_cpu_has_xsaves(vmcs12))
 		vmcs_write64(XSS_EXIT_BITMAP, vmcs12->xss_exit_bitmap);
 
@@ -2413,12 +2443,12 @@ static int prepare_vmcs02(struct kvm_vcpu *vcpu, struct vmcs12 *vmcs12,
 	bool load_guest_pdptrs_vmcs12 = false;
 
 	if (vmx->nested.dirty_vmcs12 || hv_evmcs) {
-		prepare_vmcs02_rare(vmx, vmcs12);
-		vmx->nested.dirty_vmcs12 = false;
+		load_guest_pdptrs_vmcs12 = vmcs02_group_stale(vmx,
+				VMCS12_DIRTY_GUEST_MISC,
+				HV_VMX_ENLIGHTENED_CLEAN_FIELD_GUEST_GRP1);
 
-		load_guest_pdptrs_vmcs12 = !hv_evmcs ||
-			!(hv_evmcs->hv_clean_fields &
-			  HV_VMX_ENLIGHTENED_CLEAN_FIELD_GUEST_GRP1);
+		prepare_vmcs02_rare(vmx, vmcs12);
+		vmx->nested.dirty_vmcs12 = 0;
 	}
 
 	if (vmx->nested.nested_run_pending &&
@@ -4881,6 +4911,31 @@ static bool is_shadow_field_ro(unsigned long field)
 	return false;
 }
 
+/*
+ * Which part of prepare_vmcs02_rare() has to run again after L1 writes
+ * @field.  VM_ENTRY_CONTROLS decides whether GUEST_BNDCFGS is loaded from
+ * vmcs12, so it dirties everything.
+ */
+static u32 vmcs12_field_dirty_group(unsigned long field)
+{
+	switch (field) {
+	case GUEST_ES_SELECTOR ... GUEST_TR_SELECTOR:
+	case GUEST_ES_LIMIT ... GUEST_TR_AR_BYTES:
+	case GUEST_ES_BASE ... GUEST_IDTR_BASE:
+		return VMCS12_DIRTY_GUEST_SEGMENTS;
+	case GUEST_PDPTR0 ... GUEST_BNDCFGS_HIGH:
+	case GUEST_SYSENTER_CS:
+	case GUEST_PENDING_DBG_EXCEPTIONS:
+	case GUEST_SYSENTER_ESP:
+	case GUEST_SYSENTER_EIP:
+		return VMCS12_DIRTY_GUEST_MISC;
+	case VM_ENTRY_CONTROLS:
+		return VMCS12_DIRTY_ALL;
+	default:
+		return VMCS12_DIRTY_OTHER;
+	}
+}
+
 static int handle_vmwrite(struct kvm_vcpu *vcpu)
 {
 	struct vmcs12 *vmcs12 = is_guest_mode(vcpu) ? get_shadow_vmcs12(vcpu)
@@ -4985,7 +5040,7 @@ static int handle_vmwrite(struct kvm_vcpu *vcpu)
 			vmcs_load(vmx->loaded_vmcs->vmcs);
 			preempt_enable();
 		}
-		vmx->nested.dirty_vmcs12 = true;
+		vmx->nested.dirty_vmcs12 |= vmcs12_field_dirty_group(field);
 	}
 
 	return nested_vmx_succeed(vcpu);
@@ -5000,7 +5055,7 @@ static void set_current_vmptr(struct vcpu_vmx *vmx, gpa_t vmptr)
 			     __pa(vmx->vmcs01.shadow_vmcs));
 		vmx->nested.need_vmcs12_to_shadow_sync = true;
 	}
-	vmx->nested.dirty_vmcs12 = true;
+	vmx->nested.dirty_vmcs12 = VMCS12_DIRTY_ALL;
 }
 
 /* Emulate the VMPTRLD instruction */
@@ -5963,7 +6018,7 @@ static int vmx_set_nested_state(struct kvm_vcpu *vcpu,
 	    nested_vmx_check_guest_state(vcpu, vmcs12, &exit_qual))
 		goto error_guest_mode;
 
-	vmx->nested.dirty_vmcs12 = true;
+	vmx->nested.dirty_vmcs12 = VMCS12_DIRTY_ALL;
 	ret = nested_vmx_enter_non_root_mode(vcpu, false);
 	if (ret)
 		goto error_guest_mode;
@@ -123,7 +123,12 @@ struct nested_vmx {
 	 * with the data held by struct vmcs12.
 	 */
 	bool need_vmcs12_to_shadow_sync;
-	bool dirty_vmcs12;
+
+	/*
+	 * Groups of vmcs12 fields (VMCS12_DIRTY_*) that were modified since
+	 * they were last copied to vmcs02 by prepare_vmcs02_rare().
+	 */
+	u32 dirty_vmcs12;
 
 	/*
 	 * Indicates lazily loaded guest state has not yet been decached from
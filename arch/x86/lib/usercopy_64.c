@@ -9,6 +9,25 @@
 #include <linux/export.h>
 #include <linux/uaccess.h>
 #include <linux/highmem.h>
+#include <linux/init.h>
+
+/*
+ * Size from which copy_user_generic_string() and
+ * copy_user_enhanced_fast_string() switch to non-temporal stores, set
+ * with "copy_user_nocache=<bytes>".  Off by default.
+ */
+unsigned int copy_user_nocache_threshold __read_mostly = UINT_MAX;
+
+static int __init copy_user_nocache_setup(char *str)
+{
+	unsigned int val;
+
+	if (kstrtouint(str, 0, &val) || val < PAGE_SIZE)
+		return 0;
+	copy_user_nocache_threshold = val;
+	return 1;
+}
+__setup("copy_user_nocache=", copy_user_nocache_setup);
 
 /*
  * Zero Userspace
@@ -655,9 +655,30 @@ static void flush_tlb_func_remote(void *info)
 	flush_tlb_func_common(f, false, TLB_REMOTE_SHOOTDOWN);
 }
 
-static bool tlb_is_not_lazy(int cpu, void *data)
+/*
+ * Decide whether @cpu needs the flush IPI at all.  Besides lazy CPUs, skip
+ * the ones that have already caught up with info->new_tlb_gen, e.g. because
+ * a concurrent flush of the same mm made them do a full flush after our PTE
+ * changes were visible.  ctxs[].tlb_gen is only advanced once the flush it
+ * stands for has completed, so a stale read can only cause a spurious IPI.
+ */
+static bool tlb_needs_flush(int cpu, void *data)
 {
-	return !per_cpu(cpu_tlbstate.is_lazy, cpu);
+	const struct flush_tlb_info *info = data;
+	u16 asid;
+
+	if (per_cpu(cpu_tlbstate.is_lazy, cpu))
+		return false;
+
+	if (!info->mm || per_cpu(cpu_tlbstate.loaded_mm, cpu) != info->mm)
+		return true;
+
+	asid = per_cpu(cpu_tlbstate.loaded_mm_asid, cpu);
+	if (asid >= TLB_NR_DYN_ASIDS ||
+	    per_cpu(cpu_tlbstate.ctxs[asid].ctx_id, cpu) != info->mm->context.ctx_id)
+		return true;
+
+	return per_cpu(cpu_tlbstate.ctxs[asid].tlb_gen, cpu) < info->new_tlb_gen;
 }
 
 void native_flush_tlb_others(const struct cpumask *cpumask,
@@ -696,7 +717,8 @@ void native_flush_tlb_others(const struct cpumask *cpumask,
 	/*
 	 * If no page tables were freed, we can skip sending IPIs to
 	 * CPUs in lazy TLB mode. They will flush the CPU themselves
-	 * at the next context switch.
+	 * at the next context switch. The same goes for CPUs that a
+	 * concurrent flush has already brought up to date.
 	 *
 	 * However, if page tables are getting freed, we need to send the
 	 * IPI everywhere, to prevent CPUs in lazy TLB mode from tripping
@@ -707,7 +729,7 @@ void native_flush_tlb_others(const struct cpumask *cpumask,
 		smp_call_function_many(cpumask, flush_tlb_func_remote,
 			       (void *)info, 1);
 	else
-		on_each_cpu_cond_mask(tlb_is_not_lazy, flush_tlb_func_remote,
+		on_each_cpu_cond_mask(tlb_needs_flush, flush_tlb_func_remote,
 				(void *)info, 1, cpumask);
 }
 
@@ -27,6 +27,7 @@
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
+#include <linux/semaphore.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -60,6 +61,14 @@ static bool initcalls_done;
 /* Save the async probe drivers' name from kernel cmdline */
 #define ASYNC_DRV_NAMES_MAX_LEN	256
 static char async_probe_drv_names[ASYNC_DRV_NAMES_MAX_LEN];
+static bool async_probe_default;
+
+/*
+ * Upper bound on the number of asynchronous probes running at once, set with
+ * "driver_async_probe_max=".  Zero means no limit.
+ */
+static int async_probe_max;
+static struct semaphore async_probe_sem;
 
 /*
  * In some cases, like suspend to RAM or hibernation, It might be reasonable
@@ -655,8 +664,8 @@ static int really_probe_debug(struct device *dev, struct device_driver *drv)
 	ret = really_probe(dev, drv);
 	rettime = ktime_get();
 	delta = ktime_sub(rettime, calltime);
-	printk(KERN_DEBUG "probe of %s returned %d after %lld usecs\n",
-	       dev_name(dev), ret, (s64) ktime_to_us(delta));
+	printk(KERN_DEBUG "probe of %s (%s) returned %d after %lld usecs\n",
+	       dev_name(dev), drv->name, ret, (s64) ktime_to_us(delta));
 	return ret;
 }
 
@@ -733,10 +742,17 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 
 static inline bool cmdline_requested_async_probing(const char *drv_name)
 {
-	return parse_option_str(async_probe_drv_names, drv_name);
+	return async_probe_default ||
+	       parse_option_str(async_probe_drv_names, drv_name);
 }
 
-/* The option format is "driver_async_probe=drv_name1,drv_name2,..." */
+/*
+ * The option format is "driver_async_probe=drv_name1,drv_name2,...".
+ * A "*" in the list makes asynchronous probing the default for every driver
+ * that does not ask for PROBE_FORCE_SYNCHRONOUS.  Ordering between devices
+ * is still kept by device links and probe deferral: a consumer whose
+ * suppliers are not bound yet defers and is retried once they are.
+ */
 static int __init save_async_options(char *buf)
 {
 	if (strlen(buf) >= ASYNC_DRV_NAMES_MAX_LEN)
@@ -744,10 +760,27 @@ static int __init save_async_options(char *buf)
 			"Too long list of driver names for 'driver_async_probe'!\n");
 
 	strlcpy(async_probe_drv_names, buf, ASYNC_DRV_NAMES_MAX_LEN);
+	async_probe_default = parse_option_str(async_probe_drv_names, "*");
+	if (async_probe_default)
+		pr_info("Asynchronous probing enabled by default\n");
 	return 0;
 }
 __setup("driver_async_probe=", save_async_options);
 
+static int __init async_probe_max_setup(char *str)
+{
+	int max;
+
+	if (kstrtoint(str, 10, &max) || max < 0)
+		return 0;
+
+	async_probe_max = max;
+	if (async_probe_max)
+		sema_init(&async_probe_sem, async_probe_max);
+	return 1;
+}
+__setup("driver_async_probe_max=", async_probe_max_setup);
+
 bool driver_allows_async_probing(struct device_driver *drv)
 {
 	switch (drv->probe_type) {
@@ -831,6 +864,22 @@ static int __device_attach_driver(struct device_driver *drv, void *_data)
 	return driver_probe_device(drv, dev);
 }
 
+/*
+ * Taken by the asynchronous probe helpers before they lock the device, so
+ * that a probe waiting for a slot never holds a lock another probe needs.
+ */
+static void async_probe_slot_get(void)
+{
+	if (async_probe_max)
+		down(&async_probe_sem);
+}
+
+static void async_probe_slot_put(void)
+{
+	if (async_probe_max)
+		up(&async_probe_sem);
+}
+
 static void __device_attach_async_helper(void *_dev, async_cookie_t cookie)
 {
 	struct device *dev = _dev;
@@ -840,6 +889,7 @@ static void __device_attach_async_helper(void *_dev, async_cookie_t cookie)
 		.want_async	= true,
 	};
 
+	async_probe_slot_get();
 	device_lock(dev);
 
 	/*
@@ -863,6 +913,7 @@ static void __device_attach_async_helper(void *_dev, async_cookie_t cookie)
 		pm_runtime_put(dev->parent);
 out_unlock:
 	device_unlock(dev);
+	async_probe_slot_put();
 
 	put_device(dev);
 }
@@ -1008,6 +1059,7 @@ static void __driver_attach_async_helper(void *_dev, async_cookie_t cookie)
 	struct device_driver *drv;
 	int ret = 0;
 
+	async_probe_slot_get();
 	__device_driver_lock(dev, dev->parent);
 
 	drv = dev->p->async_driver;
@@ -1020,6 +1072,7 @@ static void __driver_attach_async_helper(void *_dev, async_cookie_t cookie)
 		ret = driver_probe_device(drv, dev);
 
 	__device_driver_unlock(dev, dev->parent);
+	async_probe_slot_put();
 
 	dev_dbg(dev, "driver %s async attach completed: %d\n", drv->name, ret);
 
@@ -74,6 +74,9 @@ struct fw_priv {
 	bool need_uevent;
 	struct list_head pending_list;
 #endif
+	/* on fw_cache's linger list, protected by fwc->lock */
+	struct list_head linger_list;
+	unsigned long linger_expires;
 	const char *fw_name;
 };
 
@@ -51,6 +51,14 @@ struct firmware_cache {
 	struct list_head head;
 	int state;
 
+	/*
+	 * Images kept loaded for a while after their last release, oldest
+	 * first, so that devices of the same kind probed one after the other
+	 * share one copy instead of reading the file again.
+	 */
+	struct list_head linger;
+	struct delayed_work linger_work;
+
 #ifdef CONFIG_FW_CACHE
 	/*
 	 * Names of firmware images which have been cached successfully
@@ -189,12 +197,29 @@ static struct fw_priv *__allocate_fw_priv(const char *fw_name,
 #ifdef CONFIG_FW_LOADER_USER_HELPER
 	INIT_LIST_HEAD(&fw_priv->pending_list);
 #endif
+	INIT_LIST_HEAD(&fw_priv->linger_list);
 
 	pr_debug("%s: fw-%s fw_priv=%p\n", __func__, fw_name, fw_priv);
 
 	return fw_priv;
 }
 
+/*
+ * Time in milliseconds an image stays loaded after it was loaded or last
+ * shared with a new request, set with 'firmware_class.linger_ms='.  Zero
+ * frees it as soon as the last user releases it.
+ */
+static unsigned int fw_linger_ms;
+module_param_named(linger_ms, fw_linger_ms, uint, 0644);
+MODULE_PARM_DESC(linger_ms, "time in ms to keep a loaded firmware image for further requests");
+
+/* Called with fwc->lock held */
+static void __fw_linger_refresh(struct fw_priv *fw_priv)
+{
+	fw_priv->linger_expires = jiffies + msecs_to_jiffies(fw_linger_ms);
+	list_move_tail(&fw_priv->linger_list, &fw_priv->fwc->linger);
+}
+
 static struct fw_priv *__lookup_fw_priv(const char *fw_name)
 {
 	struct fw_priv *tmp;
@@ -219,6 +244,8 @@ static int alloc_lookup_fw_priv(const char *fw_name,
 		tmp = __lookup_fw_priv(fw_name);
 		if (tmp) {
 			kref_get(&tmp->ref);
+			if (!list_empty(&tmp->linger_list))
+				__fw_linger_refresh(tmp);
 			spin_unlock(&fwc->lock);
 			*fw_priv = tmp;
 			pr_debug("batched request - sharing the same struct fw_priv and lookup for multiple requests\n");
@@ -267,6 +294,67 @@ static void free_fw_priv(struct fw_priv *fw_priv)
 		spin_unlock(&fwc->lock);
 }
 
+/*
+ * Keep a freshly loaded image around for fw_linger_ms, holding a reference
+ * of its own that fw_linger_work_func() drops once it expires.
+ */
+static void fw_linger(struct fw_priv *fw_priv)
+{
+	struct firmware_cache *fwc = fw_priv->fwc;
+	unsigned int linger_ms = READ_ONCE(fw_linger_ms);
+
+	if (!linger_ms)
+		return;
+
+	spin_lock(&fwc->lock);
+	if (list_empty(&fw_priv->linger_list)) {
+		kref_get(&fw_priv->ref);
+		__fw_linger_refresh(fw_priv);
+	}
+	spin_unlock(&fwc->lock);
+
+	queue_delayed_work(system_power_efficient_wq, &fwc->linger_work,
+			   msecs_to_jiffies(linger_ms));
+}
+
+/* Drop the expired images, or all of them if @all */
+static void fw_linger_expire(struct firmware_cache *fwc, bool all)
+{
+	struct fw_priv *fw_priv;
+	unsigned long delay = 0;
+
+	spin_lock(&fwc->lock);
+	while (!list_empty(&fwc->linger)) {
+		fw_priv = list_first_entry(&fwc->linger, struct fw_priv,
+					   linger_list);
+		if (!all && time_before(jiffies, fw_priv->linger_expires)) {
+			delay = fw_priv->linger_expires - jiffies;
+			break;
+		}
+
+		pr_debug("%s: fw-%s fw_priv=%p\n", __func__,
+			 fw_priv->fw_name, fw_priv);
+		list_del_init(&fw_priv->linger_list);
+		/* __free_fw_priv() drops the lock */
+		if (kref_put(&fw_priv->ref, __free_fw_priv))
+			spin_lock(&fwc->lock);
+	}
+	spin_unlock(&fwc->lock);
+
+	if (delay)
+		queue_delayed_work(system_power_efficient_wq, &fwc->linger_work,
+				   delay);
+}
+
+static void fw_linger_work_func(struct work_struct *work)
+{
+	struct firmware_cache *fwc = container_of(to_delayed_work(work),
+						  struct firmware_cache,
+						  linger_work);
+
+	fw_linger_expire(fwc, false);
+}
+
 #ifdef CONFIG_FW_LOADER_PAGED_BUF
 void fw_free_paged_buf(struct fw_priv *fw_priv)
 {
@@ -672,6 +760,9 @@ int assign_fw(struct firmware *fw, struct device *device,
 			kref_get(&fw_priv->ref);
 	}
 
+	if (!(opt_flags & FW_OPT_NOCACHE))
+		fw_linger(fw_priv);
+
 	/* pass the pages buffer to driver at the last minute */
 	fw_set_page_data(fw_priv, fw);
 	mutex_unlock(&fw_lock);
@@ -1419,6 +1510,8 @@ static void __init fw_cache_init(void)
 	spin_lock_init(&fw_cache.lock);
 	INIT_LIST_HEAD(&fw_cache.head);
 	fw_cache.state = FW_LOADER_NO_CACHE;
+	INIT_LIST_HEAD(&fw_cache.linger);
+	INIT_DELAYED_WORK(&fw_cache.linger_work, fw_linger_work_func);
 }
 
 static int fw_shutdown_notify(struct notifier_block *unused1,
@@ -1461,6 +1554,8 @@ static int __init firmware_class_init(void)
 
 static void __exit firmware_class_exit(void)
 {
+	cancel_delayed_work_sync(&fw_cache.linger_work);
+	fw_linger_expire(&fw_cache, true);
 	unregister_fw_pm_ops();
 	unregister_reboot_notifier(&fw_shutdown_nb);
 	unregister_sysfs_loader();
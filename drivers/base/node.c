@@ -534,6 +534,64 @@ static ssize_t node_read_distance(struct device *dev,
 }
 static DEVICE_ATTR(distance, S_IRUGO, node_read_distance, NULL);
 
+/*
+ * Memory tiering: nodes in N_LOWER_TIER hold slower memory, such as PMEM
+ * onlined as System RAM by dax/kmem.  Every other node with memory gets
+ * the nearest lower tier node as its demotion target, which is where
+ * reclaim can move cold pages instead of swapping them out.
+ */
+static DEFINE_MUTEX(demotion_mutex);
+static int node_demotion[MAX_NUMNODES] __read_mostly = {
+	[0 ... MAX_NUMNODES - 1] = NUMA_NO_NODE,
+};
+
+static void establish_demotion_targets(void)
+{
+	int nid, target;
+
+	lockdep_assert_held(&demotion_mutex);
+
+	for_each_node_state(nid, N_MEMORY) {
+		int best = NUMA_NO_NODE;
+
+		if (!node_state(nid, N_LOWER_TIER)) {
+			for_each_node_state(target, N_LOWER_TIER) {
+				if (best == NUMA_NO_NODE ||
+				    node_distance(nid, target) <
+				    node_distance(nid, best))
+					best = target;
+			}
+		}
+		WRITE_ONCE(node_demotion[nid], best);
+	}
+}
+
+void node_set_lower_tier(int nid)
+{
+	mutex_lock(&demotion_mutex);
+	node_set_state(nid, N_LOWER_TIER);
+	establish_demotion_targets();
+	mutex_unlock(&demotion_mutex);
+}
+EXPORT_SYMBOL_GPL(node_set_lower_tier);
+
+void node_clear_lower_tier(int nid)
+{
+	mutex_lock(&demotion_mutex);
+	node_clear_state(nid, N_LOWER_TIER);
+	WRITE_ONCE(node_demotion[nid], NUMA_NO_NODE);
+	establish_demotion_targets();
+	mutex_unlock(&demotion_mutex);
+}
+EXPORT_SYMBOL_GPL(node_clear_lower_tier);
+
+static ssize_t demotion_target_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", READ_ONCE(node_demotion[dev->id]));
+}
+static DEVICE_ATTR_RO(demotion_target);
+
 static struct attribute *node_dev_attrs[] = {
 	&dev_attr_cpumap.attr,
 	&dev_attr_cpulist.attr,
@@ -541,6 +599,7 @@ static struct attribute *node_dev_attrs[] = {
 	&dev_attr_numastat.attr,
 	&dev_attr_distance.attr,
 	&dev_attr_vmstat.attr,
+	&dev_attr_demotion_target.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(node_dev);
@@ -974,6 +1033,7 @@ static struct node_attr node_state_attr[] = {
 #endif
 	[N_MEMORY] = _NODE_ATTR(has_memory, N_MEMORY),
 	[N_CPU] = _NODE_ATTR(has_cpu, N_CPU),
+	[N_LOWER_TIER] = _NODE_ATTR(has_lower_tier_memory, N_LOWER_TIER),
 };
 
 static struct attribute *node_state_attrs[] = {
@@ -985,6 +1045,7 @@ static struct attribute *node_state_attrs[] = {
 #endif
 	&node_state_attr[N_MEMORY].attr.attr,
 	&node_state_attr[N_CPU].attr.attr,
+	&node_state_attr[N_LOWER_TIER].attr.attr,
 	NULL
 };
 
@@ -142,6 +142,9 @@ struct regmap {
 	bool cache_dirty;
 	/* if set, the HW registers are known to match map->reg_defaults */
 	bool no_sync_defaults;
+	/* duration of and registers written by the last cache sync */
+	u64 cache_sync_ns;
+	u32 cache_sync_regs;
 
 	struct reg_sequence *patch;
 	int patch_regs;
@@ -175,6 +178,8 @@ struct regcache_ops {
 	int (*write)(struct regmap *map, unsigned int reg, unsigned int value);
 	int (*sync)(struct regmap *map, unsigned int min, unsigned int max);
 	int (*drop)(struct regmap *map, unsigned int min, unsigned int max);
+	/* if set, read() may be called without holding the map lock */
+	bool lockless_read;
 };
 
 bool regmap_cached(struct regmap *map, unsigned int reg);
@@ -187,6 +192,9 @@ bool regmap_readable_noinc(struct regmap *map, unsigned int reg);
 
 int _regmap_write(struct regmap *map, unsigned int reg,
 		  unsigned int val);
+int _regmap_multi_reg_write(struct regmap *map,
+			    const struct reg_sequence *regs,
+			    size_t num_regs);
 
 struct regmap_range_node {
 	struct rb_node node;
@@ -237,6 +245,8 @@ int regcache_init(struct regmap *map, const struct regmap_config *config);
 void regcache_exit(struct regmap *map);
 int regcache_read(struct regmap *map,
 		       unsigned int reg, unsigned int *value);
+int regcache_read_lockless(struct regmap *map,
+			   unsigned int reg, unsigned int *value);
 int regcache_write(struct regmap *map,
 			unsigned int reg, unsigned int value);
 int regcache_sync(struct regmap *map);
@@ -57,7 +57,8 @@ static int regcache_flat_read(struct regmap *map,
 	unsigned int *cache = map->cache;
 	unsigned int index = regcache_flat_get_index(map, reg);
 
-	*value = cache[index];
+	/* Pairs with the WRITE_ONCE() below, we may be called locklessly */
+	*value = READ_ONCE(cache[index]);
 
 	return 0;
 }
@@ -68,7 +69,7 @@ static int regcache_flat_write(struct regmap *map, unsigned int reg,
 	unsigned int *cache = map->cache;
 	unsigned int index = regcache_flat_get_index(map, reg);
 
-	cache[index] = value;
+	WRITE_ONCE(cache[index], value);
 
 	return 0;
 }
@@ -80,4 +81,5 @@ struct regcache_ops regcache_flat_ops = {
 	.exit = regcache_flat_exit,
 	.read = regcache_flat_read,
 	.write = regcache_flat_write,
+	.lockless_read = true,
 };
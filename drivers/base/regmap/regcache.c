@@ -9,6 +9,7 @@
 #include <linux/bsearch.h>
 #include <linux/device.h>
 #include <linux/export.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
 
@@ -252,6 +253,33 @@ int regcache_read(struct regmap *map,
 	return -EINVAL;
 }
 
+/**
+ * regcache_read_lockless - Fetch a register from the cache without the lock.
+ *
+ * @map: map to read from.
+ * @reg: The register index.
+ * @value: The value to be returned.
+ *
+ * Cache types whose storage never moves, like the flat cache, can serve
+ * hits without the map lock, which is the common case for maps that are
+ * mostly read back from the cache.  A cache being bypassed is left to the
+ * locked path.
+ *
+ * Return a negative value if the register has to be read under the lock,
+ * 0 on success.
+ */
+int regcache_read_lockless(struct regmap *map,
+			   unsigned int reg, unsigned int *value)
+{
+	if (!map->cache_ops || !map->cache_ops->lockless_read)
+		return -EAGAIN;
+
+	if (READ_ONCE(map->cache_bypass))
+		return -EAGAIN;
+
+	return regcache_read(map, reg, value);
+}
+
 /**
  * regcache_write - Set the value of a given register in the cache.
  *
@@ -291,10 +319,68 @@ static bool regcache_reg_needs_sync(struct regmap *map, unsigned int reg,
 	return true;
 }
 
+/* Maximum number of register/value pairs sent in one multi write */
+#define REGCACHE_SYNC_MULTI_MAX 32
+
+/*
+ * Devices which support multi write mode can take the registers to sync as
+ * R1,V1,R2,V2,... in a single bus transfer.
+ */
+static bool regcache_sync_can_multi(struct regmap *map)
+{
+	return map->can_multi_write && map->format.parse_inplace &&
+	       regmap_can_raw_write(map);
+}
+
+static unsigned int regcache_sync_multi_max(struct regmap *map)
+{
+	size_t pair_size = map->format.reg_bytes + map->format.pad_bytes +
+			   map->format.val_bytes;
+
+	if (!map->max_raw_write)
+		return REGCACHE_SYNC_MULTI_MAX;
+
+	return clamp_t(size_t, map->max_raw_write / pair_size, 1,
+		       REGCACHE_SYNC_MULTI_MAX);
+}
+
+static int regcache_sync_multi_flush(struct regmap *map,
+				     struct reg_sequence *regs,
+				     unsigned int *count)
+{
+	int ret;
+
+	if (!*count)
+		return 0;
+
+	dev_dbg(map->dev, "Writing %u registers from 0x%x-0x%x\n",
+		*count, regs[0].reg, regs[*count - 1].reg);
+
+	map->cache_bypass = true;
+
+	ret = _regmap_multi_reg_write(map, regs, *count);
+	if (ret)
+		dev_err(map->dev, "Unable to sync registers %#x-%#x. %d\n",
+			regs[0].reg, regs[*count - 1].reg, ret);
+	else
+		map->cache_sync_regs += *count;
+
+	map->cache_bypass = false;
+
+	*count = 0;
+
+	return ret;
+}
+
 static int regcache_default_sync(struct regmap *map, unsigned int min,
 				 unsigned int max)
 {
-	unsigned int reg;
+	struct reg_sequence regs[REGCACHE_SYNC_MULTI_MAX];
+	bool multi = regcache_sync_can_multi(map);
+	unsigned int reg, count = 0, multi_max = 0;
+
+	if (multi)
+		multi_max = regcache_sync_multi_max(map);
 
 	for (reg = min; reg <= max; reg += map->reg_stride) {
 		unsigned int val;
@@ -311,6 +397,16 @@ static int regcache_default_sync(struct regmap *map, unsigned int min,
 		if (!regcache_reg_needs_sync(map, reg, val))
 			continue;
 
+		if (multi) {
+			regs[count++] = (struct reg_sequence) { reg, val };
+			if (count < multi_max)
+				continue;
+			ret = regcache_sync_multi_flush(map, regs, &count);
+			if (ret)
+				return ret;
+			continue;
+		}
+
 		map->cache_bypass = true;
 		ret = _regmap_write(map, reg, val);
 		map->cache_bypass = false;
@@ -319,10 +415,11 @@ static int regcache_default_sync(struct regmap *map, unsigned int min,
 				reg, ret);
 			return ret;
 		}
+		map->cache_sync_regs++;
 		dev_dbg(map->dev, "Synced register %#x, value %#x\n", reg, val);
 	}
 
-	return 0;
+	return regcache_sync_multi_flush(map, regs, &count);
 }
 
 /**
@@ -342,10 +439,13 @@ int regcache_sync(struct regmap *map)
 	unsigned int i;
 	const char *name;
 	bool bypass;
+	ktime_t start;
 
 	BUG_ON(!map->cache_ops);
 
 	map->lock(map->lock_arg);
+	start = ktime_get();
+	map->cache_sync_regs = 0;
 	/* Remember the initial bypass state */
 	bypass = map->cache_bypass;
 	dev_dbg(map->dev, "Syncing %s cache\n",
@@ -386,6 +486,7 @@ int regcache_sync(struct regmap *map)
 	map->unlock(map->lock_arg);
 
 	regmap_async_complete(map);
+	map->cache_sync_ns = ktime_get_ns() - ktime_to_ns(start);
 
 	trace_regcache_sync(map, name, "stop");
 
@@ -411,10 +512,13 @@ int regcache_sync_region(struct regmap *map, unsigned int min,
 	int ret = 0;
 	const char *name;
 	bool bypass;
+	ktime_t start;
 
 	BUG_ON(!map->cache_ops);
 
 	map->lock(map->lock_arg);
+	start = ktime_get();
+	map->cache_sync_regs = 0;
 
 	/* Remember the initial bypass state */
 	bypass = map->cache_bypass;
@@ -442,6 +546,7 @@ int regcache_sync_region(struct regmap *map, unsigned int min,
 	map->unlock(map->lock_arg);
 
 	regmap_async_complete(map);
+	map->cache_sync_ns = ktime_get_ns() - ktime_to_ns(start);
 
 	trace_regcache_sync(map, name, "stop region");
 
@@ -694,6 +799,7 @@ static int regcache_sync_block_single(struct regmap *map, void *block,
 				regtmp, ret);
 			return ret;
 		}
+		map->cache_sync_regs++;
 		dev_dbg(map->dev, "Synced register %#x, value %#x\n",
 			regtmp, val);
 	}
@@ -701,6 +807,43 @@ static int regcache_sync_block_single(struct regmap *map, void *block,
 	return 0;
 }
 
+/*
+ * For devices which cannot take a raw block write but do support multi
+ * write mode, send the dirty registers of a block in as few bus transfers
+ * as the raw write limit allows.
+ */
+static int regcache_sync_block_multi(struct regmap *map, void *block,
+				     unsigned long *cache_present,
+				     unsigned int block_base,
+				     unsigned int start, unsigned int end)
+{
+	struct reg_sequence regs[REGCACHE_SYNC_MULTI_MAX];
+	unsigned int max = regcache_sync_multi_max(map);
+	unsigned int i, regtmp, val, count = 0;
+	int ret;
+
+	for (i = start; i < end; i++) {
+		regtmp = block_base + (i * map->reg_stride);
+
+		if (!regcache_reg_present(cache_present, i) ||
+		    !regmap_writeable(map, regtmp))
+			continue;
+
+		val = regcache_get_val(map, block, i);
+		if (!regcache_reg_needs_sync(map, regtmp, val))
+			continue;
+
+		regs[count++] = (struct reg_sequence) { regtmp, val };
+		if (count == max) {
+			ret = regcache_sync_multi_flush(map, regs, &count);
+			if (ret != 0)
+				return ret;
+		}
+	}
+
+	return regcache_sync_multi_flush(map, regs, &count);
+}
+
 static int regcache_sync_block_raw_flush(struct regmap *map, const void **data,
 					 unsigned int base, unsigned int cur)
 {
@@ -721,6 +864,8 @@ static int regcache_sync_block_raw_flush(struct regmap *map, const void **data,
 	if (ret)
 		dev_err(map->dev, "Unable to sync registers %#x-%#x. %d\n",
 			base, cur - map->reg_stride, ret);
+	else
+		map->cache_sync_regs += count;
 
 	map->cache_bypass = false;
 
@@ -779,6 +924,9 @@ int regcache_sync_block(struct regmap *map, void *block,
 	if (regmap_can_raw_write(map) && !map->use_single_write)
 		return regcache_sync_block_raw(map, block, cache_present,
 					       block_base, start, end);
+	else if (regcache_sync_can_multi(map))
+		return regcache_sync_block_multi(map, block, cache_present,
+						 block_base, start, end);
 	else
 		return regcache_sync_block_single(map, block, cache_present,
 						  block_base, start, end);
@@ -618,6 +618,10 @@ void regmap_debugfs_init(struct regmap *map, const char *name)
 		debugfs_create_file("cache_bypass", 0600, map->debugfs,
 				    &map->cache_bypass,
 				    &regmap_cache_bypass_fops);
+		debugfs_create_u64("cache_sync_ns", 0400, map->debugfs,
+				   &map->cache_sync_ns);
+		debugfs_create_u32("cache_sync_regs", 0400, map->debugfs,
+				   &map->cache_sync_regs);
 	}
 
 	next = rb_first(&map->range_tree);
@@ -2265,9 +2265,9 @@ static int _regmap_range_multi_paged_reg_write(struct regmap *map,
 	return 0;
 }
 
-static int _regmap_multi_reg_write(struct regmap *map,
-				   const struct reg_sequence *regs,
-				   size_t num_regs)
+int _regmap_multi_reg_write(struct regmap *map,
+			    const struct reg_sequence *regs,
+			    size_t num_regs)
 {
 	int i;
 	int ret;
@@ -2568,6 +2568,9 @@ int regmap_read(struct regmap *map, unsigned int reg, unsigned int *val)
 	if (!IS_ALIGNED(reg, map->reg_stride))
 		return -EINVAL;
 
+	if (regcache_read_lockless(map, reg, val) == 0)
+		return 0;
+
 	map->lock(map->lock_arg);
 
 	ret = _regmap_read(map, reg, val);
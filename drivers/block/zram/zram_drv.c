@@ -33,6 +33,8 @@
 #include <linux/sysfs.h>
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -51,6 +53,9 @@ static unsigned int num_devices = 1;
  */
 static size_t huge_class_size;
 
+/* Compresses the pages of parallel_write bios */
+static struct workqueue_struct *zram_wq;
+
 static void zram_free_page(struct zram *zram, size_t index);
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 				u32 index, int offset, struct bio *bio);
@@ -68,14 +73,73 @@ static void zram_slot_lock(struct zram *zram, u32 index)
 
 static void zram_slot_unlock(struct zram *zram, u32 index)
 {
+#ifdef ZRAM_SEQ_SHIFT
+	zram->table[index].flags += ZRAM_SEQ_INC;
+#endif
 	bit_spin_unlock(ZRAM_LOCK, &zram->table[index].flags);
 }
 
+#ifdef ZRAM_SEQ_SHIFT
+/*
+ * Take a consistent snapshot of a slot without its lock. Returns false if
+ * the slot is locked or was modified while we looked, in which case the
+ * caller has to fall back to zram_slot_lock().
+ */
+static bool zram_slot_snapshot(struct zram *zram, u32 index,
+				unsigned long *flags, unsigned long *element)
+{
+	struct zram_table_entry *entry = &zram->table[index];
+	unsigned long seq;
+
+	seq = READ_ONCE(entry->flags);
+	if (seq & BIT(ZRAM_LOCK))
+		return false;
+	smp_rmb();
+	*element = READ_ONCE(entry->element);
+	smp_rmb();
+	*flags = seq;
+	return READ_ONCE(entry->flags) == seq;
+}
+#else
+static bool zram_slot_snapshot(struct zram *zram, u32 index,
+				unsigned long *flags, unsigned long *element)
+{
+	return false;
+}
+#endif
+
 static inline bool init_done(struct zram *zram)
 {
 	return zram->disksize;
 }
 
+#define zram_stat_add(zram, field, val)	\
+	this_cpu_add((zram)->pcpu_stats->field, (val))
+
+#define zram_stat_read(zram, field)	\
+	__zram_stat_read(zram, offsetof(struct zram_pcpu_stats, field))
+
+static u64 __zram_stat_read(struct zram *zram, size_t offset)
+{
+	s64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += *(s64 *)((void *)per_cpu_ptr(zram->pcpu_stats, cpu) +
+				offset);
+
+	return sum > 0 ? sum : 0;
+}
+
+static void zram_stat_reset(struct zram *zram)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(zram->pcpu_stats, cpu), 0,
+		       sizeof(struct zram_pcpu_stats));
+}
+
 static inline struct zram *dev_to_zram(struct device *dev)
 {
 	return (struct zram *)dev_to_disk(dev)->private_data;
@@ -754,7 +818,7 @@ static ssize_t writeback_store(struct device *dev,
 		zram_set_flag(zram, index, ZRAM_WB);
 		zram_set_element(zram, index, blk_idx);
 		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
+		zram_stat_add(zram, pages_stored, 1);
 		spin_lock(&zram->wb_limit_lock);
 		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
 			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
@@ -858,8 +922,10 @@ static void zram_debugfs_destroy(void)
 
 static void zram_accessed(struct zram *zram, u32 index)
 {
+	zram_slot_lock(zram, index);
 	zram_clear_flag(zram, index, ZRAM_IDLE);
 	zram->table[index].ac_time = ktime_get_boottime();
+	zram_slot_unlock(zram, index);
 }
 
 static ssize_t read_block_state(struct file *file, char __user *buf,
@@ -891,13 +957,14 @@ static ssize_t read_block_state(struct file *file, char __user *buf,
 
 		ts = ktime_to_timespec64(zram->table[index].ac_time);
 		copied = snprintf(kbuf + written, count,
-			"%12zd %12lld.%06lu %c%c%c%c\n",
+			"%12zd %12lld.%06lu %c%c%c%c%c\n",
 			index, (s64)ts.tv_sec,
 			ts.tv_nsec / NSEC_PER_USEC,
 			zram_test_flag(zram, index, ZRAM_SAME) ? 's' : '.',
 			zram_test_flag(zram, index, ZRAM_WB) ? 'w' : '.',
 			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.',
-			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.');
+			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.',
+			zram_test_flag(zram, index, ZRAM_RECOMP) ? 'r' : '.');
 
 		if (count < copied) {
 			zram_slot_unlock(zram, index);
@@ -944,7 +1011,13 @@ static void zram_debugfs_create(void) {};
 static void zram_debugfs_destroy(void) {};
 static void zram_accessed(struct zram *zram, u32 index)
 {
+	/* Only ZRAM_IDLE needs updating, so most accesses skip the lock */
+	if (!(READ_ONCE(zram->table[index].flags) & BIT(ZRAM_IDLE)))
+		return;
+
+	zram_slot_lock(zram, index);
 	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_slot_unlock(zram, index);
 };
 static void zram_debugfs_register(struct zram *zram) {};
 static void zram_debugfs_unregister(struct zram *zram) {};
@@ -971,6 +1044,28 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t parallel_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n",
+			READ_ONCE(zram->parallel_write));
+}
+
+static ssize_t parallel_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(zram->parallel_write, val);
+	return len;
+}
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1064,19 +1159,19 @@ static ssize_t mm_stat_show(struct device *dev,
 		zs_pool_stats(zram->mem_pool, &pool_stats);
 	}
 
-	orig_size = atomic64_read(&zram->stats.pages_stored);
+	orig_size = zram_stat_read(zram, pages_stored);
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
 			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu\n",
 			orig_size << PAGE_SHIFT,
-			(u64)atomic64_read(&zram->stats.compr_data_size),
+			zram_stat_read(zram, compr_data_size),
 			mem_used << PAGE_SHIFT,
 			zram->limit_pages << PAGE_SHIFT,
 			max_used << PAGE_SHIFT,
-			(u64)atomic64_read(&zram->stats.same_pages),
+			zram_stat_read(zram, same_pages),
 			pool_stats.pages_compacted,
-			(u64)atomic64_read(&zram->stats.huge_pages));
+			zram_stat_read(zram, huge_pages));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1115,6 +1210,10 @@ static ssize_t debug_stat_show(struct device *dev,
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
 			(u64)atomic64_read(&zram->stats.miss_free));
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "recompressed: %8llu\n",
+			(u64)atomic64_read(&zram->stats.num_recompress));
+#endif
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1175,9 +1274,12 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (zram_test_flag(zram, index, ZRAM_IDLE))
 		zram_clear_flag(zram, index, ZRAM_IDLE);
 
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
-		atomic64_dec(&zram->stats.huge_pages);
+		zram_stat_add(zram, huge_pages, -1);
 	}
 
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
@@ -1192,7 +1294,7 @@ static void zram_free_page(struct zram *zram, size_t index)
 	 */
 	if (zram_test_flag(zram, index, ZRAM_SAME)) {
 		zram_clear_flag(zram, index, ZRAM_SAME);
-		atomic64_dec(&zram->stats.same_pages);
+		zram_stat_add(zram, same_pages, -1);
 		goto out;
 	}
 
@@ -1202,33 +1304,92 @@ static void zram_free_page(struct zram *zram, size_t index)
 
 	zs_free(zram->mem_pool, handle);
 
-	atomic64_sub(zram_get_obj_size(zram, index),
-			&zram->stats.compr_data_size);
+	zram_stat_add(zram, compr_data_size,
+			-(s64)zram_get_obj_size(zram, index));
 out:
-	atomic64_dec(&zram->stats.pages_stored);
+	zram_stat_add(zram, pages_stored, -1);
 	zram_set_handle(zram, index, 0);
 	zram_set_obj_size(zram, index, 0);
-	WARN_ON_ONCE(zram->table[index].flags &
+	WARN_ON_ONCE((zram->table[index].flags & ~ZRAM_SEQ_MASK) &
 		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
+/* The backend a slot's object was compressed with */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
+/*
+ * Decompress the zsmalloc object of a slot into @page. The slot has to be
+ * locked and to hold compressed data.
+ */
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				 u32 index)
+{
+	unsigned long handle = zram_get_handle(zram, index);
+	unsigned int size = zram_get_obj_size(zram, index);
+	void *src, *dst;
+	int ret;
+
+	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	if (size == PAGE_SIZE) {
+		dst = kmap_atomic(page);
+		memcpy(dst, src, PAGE_SIZE);
+		kunmap_atomic(dst);
+		ret = 0;
+	} else {
+		struct zcomp *comp = zram_slot_comp(zram, index);
+		struct zcomp_strm *zstrm = zcomp_stream_get(comp);
+
+		dst = kmap_atomic(page);
+		ret = zcomp_decompress(zstrm, src, size, dst);
+		kunmap_atomic(dst);
+		zcomp_stream_put(comp);
+	}
+	zs_unmap_object(zram->mem_pool, handle);
+
+	return ret;
+}
+
 static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 				struct bio *bio, bool partial_io)
 {
 	int ret;
-	unsigned long handle;
-	unsigned int size;
-	void *src, *dst;
+	unsigned long handle, flags;
+	struct bio_vec bvec;
+
+	bvec.bv_page = page;
+	bvec.bv_len = PAGE_SIZE;
+	bvec.bv_offset = 0;
+
+	/*
+	 * Written back, same filled and unallocated slots need nothing but
+	 * the slot's element, so serve them without taking the slot lock.
+	 */
+	if (zram_slot_snapshot(zram, index, &flags, &handle)) {
+		if (flags & BIT(ZRAM_WB))
+			return read_from_bdev(zram, &bvec, handle,
+					bio, partial_io);
+
+		if (!handle || (flags & BIT(ZRAM_SAME))) {
+			void *mem = kmap_atomic(page);
+
+			zram_fill_page(mem, PAGE_SIZE,
+				       (flags & BIT(ZRAM_SAME)) ? handle : 0);
+			kunmap_atomic(mem);
+			return 0;
+		}
+	}
 
 	zram_slot_lock(zram, index);
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
-		struct bio_vec bvec;
-
 		zram_slot_unlock(zram, index);
 
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
 		return read_from_bdev(zram, &bvec,
 				zram_get_element(zram, index),
 				bio, partial_io);
@@ -1247,23 +1408,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		return 0;
 	}
 
-	size = zram_get_obj_size(zram, index);
-
-	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
-	if (size == PAGE_SIZE) {
-		dst = kmap_atomic(page);
-		memcpy(dst, src, PAGE_SIZE);
-		kunmap_atomic(dst);
-		ret = 0;
-	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
-
-		dst = kmap_atomic(page);
-		ret = zcomp_decompress(zstrm, src, size, dst);
-		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
-	}
-	zs_unmap_object(zram->mem_pool, handle);
+	ret = zram_read_from_zspool(zram, page, index);
 	zram_slot_unlock(zram, index);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -1324,7 +1469,7 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 		kunmap_atomic(mem);
 		/* Free memory associated with this sector now. */
 		flags = ZRAM_SAME;
-		atomic64_inc(&zram->stats.same_pages);
+		zram_stat_add(zram, same_pages, 1);
 		goto out;
 	}
 	kunmap_atomic(mem);
@@ -1394,7 +1539,7 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
-	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	zram_stat_add(zram, compr_data_size, comp_len);
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1405,7 +1550,7 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 
 	if (comp_len == PAGE_SIZE) {
 		zram_set_flag(zram, index, ZRAM_HUGE);
-		atomic64_inc(&zram->stats.huge_pages);
+		zram_stat_add(zram, huge_pages, 1);
 	}
 
 	if (flags) {
@@ -1418,7 +1563,7 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	zram_slot_unlock(zram, index);
 
 	/* Update stats */
-	atomic64_inc(&zram->stats.pages_stored);
+	zram_stat_add(zram, pages_stored, 1);
 	return ret;
 }
 
@@ -1463,6 +1608,187 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_RECOMPRESS
+/*
+ * Try to replace the object of a locked slot with one produced by the
+ * secondary algorithm. The old object is kept unless the new one is
+ * smaller. Returns true if the slot was recompressed.
+ */
+static bool zram_recompress_slot(struct zram *zram, u32 index,
+				 struct page *page)
+{
+	unsigned int old_size = zram_get_obj_size(zram, index);
+	unsigned int comp_len;
+	unsigned long handle;
+	struct zcomp_strm *zstrm;
+	void *src, *dst;
+	int ret;
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	ktime_t ac_time = zram->table[index].ac_time;
+#endif
+
+	if (zram_read_from_zspool(zram, page, index))
+		return false;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len);
+	kunmap_atomic(src);
+
+	if (ret || comp_len >= old_size || comp_len >= huge_class_size) {
+		zcomp_stream_put(zram->recomp);
+		return false;
+	}
+
+	/* We hold the slot lock and a stream, so we can't sleep here */
+	handle = zs_malloc(zram->mem_pool, comp_len,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!handle) {
+		zcomp_stream_put(zram->recomp);
+		return false;
+	}
+
+	dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len);
+	zs_unmap_object(zram->mem_pool, handle);
+	zcomp_stream_put(zram->recomp);
+
+	zram_free_page(zram, index);
+	zram_set_handle(zram, index, handle);
+	zram_set_obj_size(zram, index, comp_len);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	/* The page is still idle, so writeback may pick it up next */
+	zram_set_flag(zram, index, ZRAM_IDLE);
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	zram->table[index].ac_time = ac_time;
+#endif
+	zram_stat_add(zram, compr_data_size, comp_len);
+	zram_stat_add(zram, pages_stored, 1);
+	update_used_max(zram, zs_get_total_pages(zram->mem_pool));
+
+	return true;
+}
+
+/* Recompress all idle slots. Called with init_lock held for read */
+static int zram_recompress_idle(struct zram *zram)
+{
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+	struct page *page;
+
+	page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM);
+	if (!page)
+		return -ENOMEM;
+
+	for (index = 0; index < nr_pages; index++) {
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index) ||
+				!zram_test_flag(zram, index, ZRAM_IDLE) ||
+				zram_test_flag(zram, index, ZRAM_WB) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(zram, index, ZRAM_SAME) ||
+				zram_test_flag(zram, index, ZRAM_RECOMP))
+			goto next;
+
+		if (zram_recompress_slot(zram, index, page))
+			atomic64_inc(&zram->stats.num_recompress);
+next:
+		zram_slot_unlock(zram, index);
+		cond_resched();
+	}
+
+	__free_page(page);
+	return 0;
+}
+
+static void zram_recomp_work_fn(struct work_struct *work)
+{
+	struct zram *zram = container_of(work, struct zram, recomp_work);
+
+	down_read(&zram->init_lock);
+	if (init_done(zram) && zram->recomp)
+		zram_recompress_idle(zram);
+	up_read(&zram->init_lock);
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool background;
+	ssize_t ret = len;
+
+	if (sysfs_streq(buf, "idle"))
+		background = false;
+	else if (sysfs_streq(buf, "background"))
+		background = true;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (background) {
+		queue_work(zram_wq, &zram->recomp_work);
+	} else {
+		int err = zram_recompress_idle(zram);
+
+		if (err)
+			ret = err;
+	}
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_algorithm, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recomp_algorithm)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recomp_algorithm, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1517,19 +1843,17 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 			&zram->disk->part0);
 
 	if (!op_is_write(op)) {
-		atomic64_inc(&zram->stats.num_reads);
+		zram_stat_add(zram, num_reads, 1);
 		ret = zram_bvec_read(zram, bvec, index, offset, bio);
 		flush_dcache_page(bvec->bv_page);
 	} else {
-		atomic64_inc(&zram->stats.num_writes);
+		zram_stat_add(zram, num_writes, 1);
 		ret = zram_bvec_write(zram, bvec, index, offset, bio);
 	}
 
 	generic_end_io_acct(q, op, &zram->disk->part0, start_time);
 
-	zram_slot_lock(zram, index);
 	zram_accessed(zram, index);
-	zram_slot_unlock(zram, index);
 
 	if (unlikely(ret < 0)) {
 		if (!op_is_write(op))
@@ -1541,6 +1865,98 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+/* Writes of at least this many pages are worth spreading out */
+#define ZRAM_PARALLEL_MIN_PAGES	4
+
+struct zram_parallel_bio;
+
+struct zram_page_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct zram_parallel_bio *pbio;
+	struct bio_vec bvec;
+	u32 index;
+};
+
+struct zram_parallel_bio {
+	struct bio *bio;
+	atomic_t remaining;
+	struct zram_page_work works[];
+};
+
+static void zram_parallel_bio_put(struct zram_parallel_bio *pbio)
+{
+	if (!atomic_dec_and_test(&pbio->remaining))
+		return;
+
+	bio_endio(pbio->bio);
+	kfree(pbio);
+}
+
+static void zram_page_write_fn(struct work_struct *work)
+{
+	struct zram_page_work *pw = container_of(work, struct zram_page_work,
+						 work);
+	struct zram_parallel_bio *pbio = pw->pbio;
+
+	if (zram_bvec_rw(pw->zram, &pw->bvec, pw->index, 0, REQ_OP_WRITE,
+			 pbio->bio) < 0)
+		pbio->bio->bi_status = BLK_STS_IOERR;
+
+	zram_parallel_bio_put(pbio);
+}
+
+/*
+ * Fan the pages of a large write out to zram_wq, so they are compressed
+ * on the per-CPU streams of several CPUs at once instead of one after
+ * the other on the submitter's. The bio completes once every page is
+ * stored. Returns false if the bio has to be handled inline.
+ */
+static bool zram_parallel_write(struct zram *zram, struct bio *bio,
+				u32 index, int offset)
+{
+	unsigned int nr_pages = bio->bi_iter.bi_size >> PAGE_SHIFT;
+	struct zram_parallel_bio *pbio;
+	struct zram_page_work *pw;
+	struct bvec_iter iter;
+	struct bio_vec bvec;
+
+	if (!READ_ONCE(zram->parallel_write) || bio_op(bio) != REQ_OP_WRITE)
+		return false;
+	if (offset || nr_pages < ZRAM_PARALLEL_MIN_PAGES ||
+	    !IS_ALIGNED(bio->bi_iter.bi_size, PAGE_SIZE))
+		return false;
+
+	/* Partial pages need read-modify-write, keep those inline */
+	bio_for_each_segment(bvec, bio, iter) {
+		if (bvec.bv_len != PAGE_SIZE)
+			return false;
+	}
+
+	pbio = kmalloc(struct_size(pbio, works, nr_pages),
+		       GFP_NOIO | __GFP_NOWARN);
+	if (!pbio)
+		return false;
+
+	pbio->bio = bio;
+	/* Hold the bio until all pages are queued */
+	atomic_set(&pbio->remaining, nr_pages + 1);
+
+	pw = pbio->works;
+	bio_for_each_segment(bvec, bio, iter) {
+		INIT_WORK(&pw->work, zram_page_write_fn);
+		pw->zram = zram;
+		pw->pbio = pbio;
+		pw->bvec = bvec;
+		pw->index = index++;
+		queue_work(zram_wq, &pw->work);
+		pw++;
+	}
+
+	zram_parallel_bio_put(pbio);
+	return true;
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int offset;
@@ -1562,6 +1978,9 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 		break;
 	}
 
+	if (zram_parallel_write(zram, bio, index, offset))
+		return;
+
 	bio_for_each_segment(bvec, bio, iter) {
 		struct bio_vec bv = bvec;
 		unsigned int unwritten = bvec.bv_len;
@@ -1679,6 +2098,9 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 static void zram_reset_device(struct zram *zram)
 {
 	struct zcomp *comp;
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	struct zcomp *recomp;
+#endif
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -1693,15 +2115,26 @@ static void zram_reset_device(struct zram *zram)
 	comp = zram->comp;
 	disksize = zram->disksize;
 	zram->disksize = 0;
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	recomp = zram->recomp;
+	zram->recomp = NULL;
+#endif
 
 	set_capacity(zram->disk, 0);
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
+	/* Let parallel writes still in flight finish first */
+	flush_workqueue(zram_wq);
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
+	zram_stat_reset(zram);
 	zcomp_destroy(comp);
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	if (recomp)
+		zcomp_destroy(recomp);
+#endif
 	reset_bdev(zram);
 }
 
@@ -1738,6 +2171,20 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	if (zram->recomp_algorithm[0]) {
+		struct zcomp *recomp = zcomp_create(zram->recomp_algorithm);
+
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s recompressing backend\n",
+					zram->recomp_algorithm);
+			err = PTR_ERR(recomp);
+			goto out_free_comp;
+		}
+		zram->recomp = recomp;
+	}
+#endif
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1747,6 +2194,10 @@ static ssize_t disksize_store(struct device *dev,
 
 	return len;
 
+#ifdef CONFIG_ZRAM_RECOMPRESS
+out_free_comp:
+	zcomp_destroy(comp);
+#endif
 out_free_meta:
 	zram_meta_free(zram, disksize);
 out_unlock:
@@ -1829,7 +2280,12 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(parallel_write);
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_ZRAM_RECOMPRESS
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -1846,7 +2302,12 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_parallel_write.attr,
 	&dev_attr_comp_algorithm.attr,
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
@@ -1890,7 +2351,16 @@ static int zram_add(void)
 		goto out_free_dev;
 	device_id = ret;
 
+	zram->pcpu_stats = alloc_percpu(struct zram_pcpu_stats);
+	if (!zram->pcpu_stats) {
+		ret = -ENOMEM;
+		goto out_free_idr;
+	}
+
 	init_rwsem(&zram->init_lock);
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	INIT_WORK(&zram->recomp_work, zram_recomp_work_fn);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
 #endif
@@ -1899,7 +2369,7 @@ static int zram_add(void)
 		pr_err("Error allocating disk queue for device %d\n",
 			device_id);
 		ret = -ENOMEM;
-		goto out_free_idr;
+		goto out_free_stats;
 	}
 
 	blk_queue_make_request(queue, zram_make_request);
@@ -1963,6 +2433,8 @@ static int zram_add(void)
 
 out_free_queue:
 	blk_cleanup_queue(queue);
+out_free_stats:
+	free_percpu(zram->pcpu_stats);
 out_free_idr:
 	idr_remove(&zram_index_idr, device_id);
 out_free_dev:
@@ -2000,6 +2472,7 @@ static int zram_remove(struct zram *zram)
 	del_gendisk(zram->disk);
 	blk_cleanup_queue(zram->disk->queue);
 	put_disk(zram->disk);
+	free_percpu(zram->pcpu_stats);
 	kfree(zram);
 	return 0;
 }
@@ -2086,21 +2559,29 @@ static void destroy_devices(void)
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+	destroy_workqueue(zram_wq);
 }
 
 static int __init zram_init(void)
 {
 	int ret;
 
+	zram_wq = alloc_workqueue("zram_wq", WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!zram_wq)
+		return -ENOMEM;
+
 	ret = cpuhp_setup_state_multi(CPUHP_ZCOMP_PREPARE, "block/zram:prepare",
 				      zcomp_cpu_up_prepare, zcomp_cpu_dead);
-	if (ret < 0)
+	if (ret < 0) {
+		destroy_workqueue(zram_wq);
 		return ret;
+	}
 
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_wq);
 		return ret;
 	}
 
@@ -2110,6 +2591,7 @@ static int __init zram_init(void)
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_wq);
 		return -EBUSY;
 	}
 
@@ -50,10 +50,24 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page is compressed with the secondary algorithm */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
+#if BITS_PER_LONG == 64
+/*
+ * The top bits of table.flags count unlocks of the slot, so a reader
+ * which sees the same flags word before and after looking at the slot
+ * knows that nobody modified it in between.
+ */
+#define ZRAM_SEQ_SHIFT	48
+#define ZRAM_SEQ_MASK	(~0UL << ZRAM_SEQ_SHIFT)
+#define ZRAM_SEQ_INC	(1UL << ZRAM_SEQ_SHIFT)
+#else
+#define ZRAM_SEQ_MASK	0UL
+#endif
+
 /*-- Data structures */
 
 /* Allocated for each disk page */
@@ -68,20 +82,30 @@ struct zram_table_entry {
 #endif
 };
 
+/*
+ * Counters updated on every I/O. They are kept per CPU, so an individual
+ * CPU's value may go negative; only the sum over all CPUs is meaningful.
+ */
+struct zram_pcpu_stats {
+	s64 compr_data_size;	/* compressed size of pages stored */
+	s64 num_reads;		/* failed + successful */
+	s64 num_writes;		/* --do-- */
+	s64 same_pages;		/* no. of same element filled pages */
+	s64 huge_pages;		/* no. of huge pages */
+	s64 pages_stored;	/* no. of pages currently stored */
+};
+
 struct zram_stats {
-	atomic64_t compr_data_size;	/* compressed size of pages stored */
-	atomic64_t num_reads;	/* failed + successful */
-	atomic64_t num_writes;	/* --do-- */
 	atomic64_t failed_reads;	/* can happen when memory is too low */
 	atomic64_t failed_writes;	/* can happen when memory is too low */
 	atomic64_t invalid_io;	/* non-page-aligned I/O requests */
 	atomic64_t notify_free;	/* no. of swap slot free notifications */
-	atomic64_t same_pages;		/* no. of same element filled pages */
-	atomic64_t huge_pages;		/* no. of huge pages */
-	atomic64_t pages_stored;	/* no. of pages currently stored */
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	atomic64_t num_recompress;	/* no. of pages recompressed */
+#endif
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -102,6 +126,7 @@ struct zram {
 	unsigned long limit_pages;
 
 	struct zram_stats stats;
+	struct zram_pcpu_stats __percpu *pcpu_stats;
 	/*
 	 * This is the limit on amount of *uncompressed* worth of data
 	 * we can store in a disk.
@@ -112,7 +137,17 @@ struct zram {
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by bdev->bd_mutex */
+	/*
+	 * Spread the pages of large writes over several CPUs' streams
+	 */
+	bool parallel_write;
 	struct file *backing_dev;
+#ifdef CONFIG_ZRAM_RECOMPRESS
+	struct zcomp *recomp;
+	char recomp_algorithm[CRYPTO_MAX_ALG_NAME];
+	/* Recompresses idle pages when asked to do so in the background */
+	struct work_struct recomp_work;
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spinlock_t wb_limit_lock;
 	bool wb_limit_enable;
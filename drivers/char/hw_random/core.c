@@ -35,7 +35,7 @@ static struct task_struct *hwrng_fill;
 static LIST_HEAD(rng_list);
 /* Protects rng_list and current_rng */
 static DEFINE_MUTEX(rng_mutex);
-/* Protects rng read functions, data_avail, rng_buffer and rng_fillbuf */
+/* Protects data_avail and rng_buffer */
 static DEFINE_MUTEX(reading_mutex);
 static int data_avail;
 static u8 *rng_buffer, *rng_fillbuf;
@@ -53,14 +53,21 @@ static void drop_current_rng(void);
 static int hwrng_init(struct hwrng *rng);
 static void start_khwrngd(void);
 
-static inline int rng_get_data(struct hwrng *rng, u8 *buffer, size_t size,
-			       int wait);
+static int rng_get_data(struct hwrng *rng, u8 *buffer, size_t size, int wait);
 
 static size_t rng_buffer_size(void)
 {
 	return SMP_CACHE_BYTES < 32 ? 32 : SMP_CACHE_BYTES;
 }
 
+/*
+ * Size of rng_buffer.  Large reads fetch up to this much per round trip on
+ * reading_mutex; small ones still only ask for rng_buffer_size() bytes.
+ * The buffer has to stay the same one: virtio-rng keeps it queued to the
+ * device after a read that did not wait for the data.
+ */
+#define RNG_BULK_SIZE		PAGE_SIZE
+
 static void add_early_randomness(struct hwrng *rng)
 {
 	int bytes_read;
@@ -183,13 +190,22 @@ static int rng_dev_open(struct inode *inode, struct file *filp)
 	return 0;
 }
 
-static inline int rng_get_data(struct hwrng *rng, u8 *buffer, size_t size,
-			int wait) {
-	int present;
+/*
+ * Drivers are only ever called for one read at a time, but reads from
+ * different rngs, e.g. the fill thread and a /dev/hwrng reader after the
+ * current rng was switched, don't wait for each other.
+ */
+static int rng_get_data(struct hwrng *rng, u8 *buffer, size_t size, int wait)
+{
+	int present, ret = 0;
 
-	BUG_ON(!mutex_is_locked(&reading_mutex));
-	if (rng->read)
-		return rng->read(rng, (void *)buffer, size, wait);
+	if (mutex_lock_interruptible(&rng->read_lock))
+		return -ERESTARTSYS;
+
+	if (rng->read) {
+		ret = rng->read(rng, (void *)buffer, size, wait);
+		goto out;
+	}
 
 	if (rng->data_present)
 		present = rng->data_present(rng, wait);
@@ -197,9 +213,10 @@ static inline int rng_get_data(struct hwrng *rng, u8 *buffer, size_t size,
 		present = 1;
 
 	if (present)
-		return rng->data_read(rng, (u32 *)buffer);
-
-	return 0;
+		ret = rng->data_read(rng, (u32 *)buffer);
+out:
+	mutex_unlock(&rng->read_lock);
+	return ret;
 }
 
 static ssize_t rng_dev_read(struct file *filp, char __user *buf,
@@ -226,8 +243,10 @@ static ssize_t rng_dev_read(struct file *filp, char __user *buf,
 			goto out_put;
 		}
 		if (!data_avail) {
+			/* drivers may assume at least rng_buffer_size() */
 			bytes_read = rng_get_data(rng, rng_buffer,
-				rng_buffer_size(),
+				clamp_t(size_t, round_up(size, 4),
+					rng_buffer_size(), RNG_BULK_SIZE),
 				!(filp->f_flags & O_NONBLOCK));
 			if (bytes_read < 0) {
 				err = bytes_read;
@@ -438,10 +457,9 @@ static int hwrng_fillfn(void *unused)
 		rng = get_current_rng();
 		if (IS_ERR(rng) || !rng)
 			break;
-		mutex_lock(&reading_mutex);
+		/* rng_fillbuf is only used here, no need for reading_mutex */
 		rc = rng_get_data(rng, rng_fillbuf,
 				  rng_buffer_size(), 1);
-		mutex_unlock(&reading_mutex);
 		put_rng(rng);
 		if (rc <= 0) {
 			pr_warn("hwrng: no data available\n");
@@ -486,6 +504,7 @@ int hwrng_register(struct hwrng *rng)
 
 	init_completion(&rng->cleanup_done);
 	complete(&rng->cleanup_done);
+	mutex_init(&rng->read_lock);
 
 	/* rng_list is sorted by decreasing quality */
 	list_for_each(rng_list_ptr, &rng_list) {
@@ -614,7 +633,7 @@ static int __init hwrng_modinit(void)
 	int ret = -ENOMEM;
 
 	/* kmalloc makes this safe for virt_to_page() in virtio_rng.c */
-	rng_buffer = kmalloc(rng_buffer_size(), GFP_KERNEL);
+	rng_buffer = kmalloc(RNG_BULK_SIZE, GFP_KERNEL);
 	if (!rng_buffer)
 		return -ENOMEM;
 
@@ -771,8 +771,15 @@ static DECLARE_WAIT_QUEUE_HEAD(crng_init_wait);
 static struct crng_state **crng_node_pool __read_mostly;
 #endif
 
+/*
+ * With random.percpu_crng=1 every CPU gets its own CRNG instance, seeded
+ * from primary_crng like the per-node ones, so that parallel readers do
+ * not all serialize on the same crng->lock.
+ */
+static struct crng_state __percpu *crng_cpu_pool __read_mostly;
+
 static void invalidate_batched_entropy(void);
-static void numa_crng_init(void);
+static void crng_pools_init(void);
 
 static bool trust_cpu __ro_after_init = IS_ENABLED(CONFIG_RANDOM_TRUST_CPU);
 static int __init parse_trust_cpu(char *arg)
@@ -781,6 +788,13 @@ static int __init parse_trust_cpu(char *arg)
 }
 early_param("random.trust_cpu", parse_trust_cpu);
 
+static bool percpu_crng __ro_after_init;
+static int __init parse_percpu_crng(char *arg)
+{
+	return kstrtobool(arg, &percpu_crng);
+}
+early_param("random.percpu_crng", parse_percpu_crng);
+
 static void crng_initialize(struct crng_state *crng)
 {
 	int		i;
@@ -803,7 +817,7 @@ static void crng_initialize(struct crng_state *crng)
 	}
 	if (trust_cpu && arch_init && crng == &primary_crng) {
 		invalidate_batched_entropy();
-		numa_crng_init();
+		crng_pools_init();
 		crng_init = 2;
 		pr_notice("crng done (trusting CPU's manufacturer)\n");
 	}
@@ -834,14 +848,37 @@ static void do_numa_crng_init(struct work_struct *work)
 }
 
 static DECLARE_WORK(numa_crng_init_work, do_numa_crng_init);
+#endif
 
-static void numa_crng_init(void)
+static void do_percpu_crng_init(struct work_struct *work)
 {
-	schedule_work(&numa_crng_init_work);
+	int cpu;
+	struct crng_state *crng;
+	struct crng_state __percpu *pool;
+
+	pool = alloc_percpu(struct crng_state);
+	if (!pool)
+		return;
+	for_each_possible_cpu(cpu) {
+		crng = per_cpu_ptr(pool, cpu);
+		spin_lock_init(&crng->lock);
+		crng_initialize(crng);
+	}
+	mb();
+	if (cmpxchg(&crng_cpu_pool, NULL, pool))
+		free_percpu(pool);
 }
-#else
-static void numa_crng_init(void) {}
+
+static DECLARE_WORK(percpu_crng_init_work, do_percpu_crng_init);
+
+static void crng_pools_init(void)
+{
+#ifdef CONFIG_NUMA
+	schedule_work(&numa_crng_init_work);
 #endif
+	if (percpu_crng)
+		schedule_work(&percpu_crng_init_work);
+}
 
 /*
  * crng_fast_load() can be called by code in the interrupt service
@@ -948,7 +985,7 @@ static void crng_reseed(struct crng_state *crng, struct entropy_store *r)
 	spin_unlock_irqrestore(&crng->lock, flags);
 	if (crng == &primary_crng && crng_init < 2) {
 		invalidate_batched_entropy();
-		numa_crng_init();
+		crng_pools_init();
 		crng_init = 2;
 		process_random_ready_list();
 		wake_up_interruptible(&crng_init_wait);
@@ -985,17 +1022,30 @@ static void _extract_crng(struct crng_state *crng,
 	spin_unlock_irqrestore(&crng->lock, flags);
 }
 
-static void extract_crng(__u8 out[CHACHA_BLOCK_SIZE])
+/*
+ * Pick the CRNG instance closest to the current CPU. The caller may be
+ * migrated afterwards; crng->lock still makes that safe, only a little
+ * less cache friendly.
+ */
+static struct crng_state *select_crng(void)
 {
+	struct crng_state __percpu *cpu_pool = READ_ONCE(crng_cpu_pool);
 	struct crng_state *crng = NULL;
 
+	if (cpu_pool)
+		return raw_cpu_ptr(cpu_pool);
 #ifdef CONFIG_NUMA
 	if (crng_node_pool)
 		crng = crng_node_pool[numa_node_id()];
 	if (crng == NULL)
 #endif
 		crng = &primary_crng;
-	_extract_crng(crng, out);
+	return crng;
+}
+
+static void extract_crng(__u8 out[CHACHA_BLOCK_SIZE])
+{
+	_extract_crng(select_crng(), out);
 }
 
 /*
@@ -1024,15 +1074,7 @@ static void _crng_backtrack_protect(struct crng_state *crng,
 
 static void crng_backtrack_protect(__u8 tmp[CHACHA_BLOCK_SIZE], int used)
 {
-	struct crng_state *crng = NULL;
-
-#ifdef CONFIG_NUMA
-	if (crng_node_pool)
-		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
-#endif
-		crng = &primary_crng;
-	_crng_backtrack_protect(crng, tmp, used);
+	_crng_backtrack_protect(select_crng(), tmp, used);
 }
 
 static ssize_t extract_crng_user(void __user *buf, size_t nbytes)
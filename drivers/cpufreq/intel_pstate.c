@@ -197,6 +197,8 @@ struct global_params {
  * @update_util:	CPUFreq utility callback information
  * @update_util_set:	CPUFreq utility callback is set
  * @iowait_boost:	iowait-related boost fraction
+ * @burst_boost:	Boost fraction applied on wakeup from idle
+ * @busy_underclocked_ns: Time spent busy below the requested P state
  * @last_update:	Time of the last update.
  * @pstate:		Stores P state limits for this CPU
  * @vid:		Stores VID limits for this CPU
@@ -255,6 +257,8 @@ struct cpudata {
 	bool valid_pss_table;
 #endif
 	unsigned int iowait_boost;
+	unsigned int burst_boost;
+	u64 busy_underclocked_ns;
 	s16 epp_powersave;
 	s16 epp_policy;
 	s16 epp_default;
@@ -298,6 +302,7 @@ static int hwp_active __read_mostly;
 static int hwp_mode_bdw __read_mostly;
 static bool per_cpu_limits __read_mostly;
 static bool hwp_boost __read_mostly;
+static unsigned int burst_boost_pct __read_mostly;
 
 static struct cpufreq_driver *intel_pstate_driver __read_mostly;
 
@@ -749,6 +754,23 @@ static struct freq_attr *hwp_cpufreq_attrs[] = {
 	NULL,
 };
 
+static ssize_t show_busy_underclocked_us(struct cpufreq_policy *policy,
+					 char *buf)
+{
+	struct cpudata *cpu = all_cpu_data[policy->cpu];
+
+	return sprintf(buf, "%llu\n",
+		       div_u64(READ_ONCE(cpu->busy_underclocked_ns),
+			       NSEC_PER_USEC));
+}
+
+cpufreq_freq_attr_ro(busy_underclocked_us);
+
+static struct freq_attr *intel_pstate_cpufreq_attrs[] = {
+	&busy_underclocked_us,
+	NULL,
+};
+
 static void intel_pstate_get_hwp_max(unsigned int cpu, int *phy_max,
 				     int *current_max)
 {
@@ -1192,6 +1214,30 @@ static ssize_t store_min_perf_pct(struct kobject *a, struct kobj_attribute *b,
 	return count;
 }
 
+static ssize_t show_burst_boost(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", burst_boost_pct);
+}
+
+static ssize_t store_burst_boost(struct kobject *a, struct kobj_attribute *b,
+				 const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &input);
+	if (ret)
+		return ret;
+
+	if (input > 100)
+		return -EINVAL;
+
+	WRITE_ONCE(burst_boost_pct, input);
+
+	return count;
+}
+
 static ssize_t show_hwp_dynamic_boost(struct kobject *kobj,
 				struct kobj_attribute *attr, char *buf)
 {
@@ -1227,6 +1273,7 @@ define_one_global_rw(min_perf_pct);
 define_one_global_ro(turbo_pct);
 define_one_global_ro(num_pstates);
 define_one_global_rw(hwp_dynamic_boost);
+define_one_global_rw(burst_boost);
 
 static struct attribute *intel_pstate_attributes[] = {
 	&status.attr,
@@ -1271,6 +1318,10 @@ static void __init intel_pstate_sysfs_expose_params(void)
 		rc = sysfs_create_file(intel_pstate_kobject,
 				       &hwp_dynamic_boost.attr);
 		WARN_ON(rc);
+	} else {
+		rc = sysfs_create_file(intel_pstate_kobject,
+				       &burst_boost.attr);
+		WARN_ON(rc);
 	}
 }
 /************************** sysfs end ************************/
@@ -1758,18 +1809,34 @@ static inline int32_t get_target_pstate(struct cpudata *cpu)
 {
 	struct sample *sample = &cpu->sample;
 	int32_t busy_frac;
-	int target, avg_pstate;
+	int target, avg_pstate, max_pstate;
 
 	busy_frac = div_fp(sample->mperf << cpu->aperf_mperf_shift,
 			   sample->tsc);
+	avg_pstate = get_avg_pstate(cpu);
+	max_pstate = global.no_turbo || global.turbo_disabled ?
+			cpu->pstate.max_pstate : cpu->pstate.turbo_pstate;
+
+	/*
+	 * Account the previous cycle as under-clocked if the CPU was almost
+	 * fully busy and yet ran below the P-state that its load calls for.
+	 */
+	if (busy_frac >= percent_fp(90) &&
+	    avg_pstate < mul_fp(max_pstate, busy_frac))
+		cpu->busy_underclocked_ns += sample->time -
+					     cpu->last_sample_time;
 
 	if (busy_frac < cpu->iowait_boost)
 		busy_frac = cpu->iowait_boost;
 
+	/* The burst boost is halved on every sample until it goes away. */
+	if (busy_frac < cpu->burst_boost)
+		busy_frac = cpu->burst_boost;
+	cpu->burst_boost >>= 1;
+
 	sample->busy_scaled = busy_frac * 100;
 
-	target = global.no_turbo || global.turbo_disabled ?
-			cpu->pstate.max_pstate : cpu->pstate.turbo_pstate;
+	target = max_pstate;
 	target += target >> 2;
 	target = mul_fp(target, busy_frac);
 	if (target < cpu->pstate.min_pstate)
@@ -1782,7 +1849,6 @@ static inline int32_t get_target_pstate(struct cpudata *cpu)
 	 * loss related to moving the workload from one CPU to another within
 	 * a package/module.
 	 */
-	avg_pstate = get_avg_pstate(cpu);
 	if (avg_pstate > target)
 		target += (avg_pstate - target) >> 1;
 
@@ -1835,6 +1901,8 @@ static void intel_pstate_update_util(struct update_util_data *data, u64 time,
 				     unsigned int flags)
 {
 	struct cpudata *cpu = container_of(data, struct cpudata, update_util);
+	unsigned int burst_pct = READ_ONCE(burst_boost_pct);
+	bool burst = false;
 	u64 delta_ns;
 
 	/* Don't allow remote callbacks */
@@ -1842,6 +1910,18 @@ static void intel_pstate_update_util(struct update_util_data *data, u64 time,
 		return;
 
 	delta_ns = time - cpu->last_update;
+
+	/*
+	 * The first update after the CPU may have been idle is most likely a
+	 * wakeup.  With burst boost enabled, raise the P-state floor for it
+	 * and re-evaluate the P-state right away instead of waiting for the
+	 * sampling interval to expire.
+	 */
+	if (burst_pct && delta_ns > TICK_NSEC) {
+		cpu->burst_boost = percent_fp(burst_pct);
+		burst = true;
+	}
+
 	if (flags & SCHED_CPUFREQ_IOWAIT) {
 		/* Start over if the CPU may have been idle. */
 		if (delta_ns > TICK_NSEC) {
@@ -1862,7 +1942,7 @@ static void intel_pstate_update_util(struct update_util_data *data, u64 time,
 	}
 	cpu->last_update = time;
 	delta_ns = time - cpu->sample.time;
-	if ((s64)delta_ns < INTEL_PSTATE_SAMPLING_INTERVAL)
+	if (!burst && (s64)delta_ns < INTEL_PSTATE_SAMPLING_INTERVAL)
 		return;
 
 	if (intel_pstate_sample(cpu, time))
@@ -2261,6 +2341,7 @@ static struct cpufreq_driver intel_pstate = {
 	.exit		= intel_pstate_cpu_exit,
 	.stop_cpu	= intel_pstate_stop_cpu,
 	.update_limits	= intel_pstate_update_limits,
+	.attr		= intel_pstate_cpufreq_attrs,
 	.name		= "intel_pstate",
 };
 
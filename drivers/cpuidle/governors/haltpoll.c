@@ -39,6 +39,28 @@ module_param(guest_halt_poll_grow_start, uint, 0644);
 static bool guest_halt_poll_allow_shrink __read_mostly = true;
 module_param(guest_halt_poll_allow_shrink, bool, 0644);
 
+/* allow growing guest halt poll on wakeups by the local timer */
+static bool guest_halt_poll_timer_grow __read_mostly;
+module_param(guest_halt_poll_timer_grow, bool, 0644);
+
+/*
+ * A halt that ends within this much of the next timer event is accounted
+ * as a timer wakeup.
+ */
+#define HALTPOLL_TIMER_SLACK_NS	(10 * NSEC_PER_USEC)
+
+/* time to the next timer event, sampled when halting */
+static DEFINE_PER_CPU(u64, haltpoll_sleep_length_ns);
+
+static int haltpoll_halt(void)
+{
+	ktime_t delta_next;
+
+	__this_cpu_write(haltpoll_sleep_length_ns,
+			 ktime_to_ns(tick_nohz_get_sleep_length(&delta_next)));
+	return 1;
+}
+
 /**
  * haltpoll_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -57,13 +79,13 @@ static int haltpoll_select(struct cpuidle_driver *drv,
 	}
 
 	if (dev->poll_limit_ns == 0)
-		return 1;
+		return haltpoll_halt();
 
 	/* Last state was poll? */
 	if (dev->last_state_idx == 0) {
 		/* Halt if no event occurred on poll window */
 		if (dev->poll_time_limit == true)
-			return 1;
+			return haltpoll_halt();
 
 		*stop_tick = false;
 		/* Otherwise, poll again */
@@ -78,11 +100,24 @@ static int haltpoll_select(struct cpuidle_driver *drv,
 static void adjust_poll_limit(struct cpuidle_device *dev, u64 block_ns)
 {
 	unsigned int val;
+	bool timer_wakeup;
+
+	/*
+	 * The expiry of a local timer is known in advance, so a halt ended
+	 * by one says nothing about how soon an IPI or a device interrupt
+	 * would have arrived.  Growing the poll window for it only makes
+	 * the vCPU spin until a wakeup whose time was already known.
+	 */
+	timer_wakeup = block_ns + HALTPOLL_TIMER_SLACK_NS >=
+		       __this_cpu_read(haltpoll_sleep_length_ns);
 
 	/* Grow cpu_halt_poll_us if
 	 * cpu_halt_poll_us < block_ns < guest_halt_poll_us
 	 */
 	if (block_ns > dev->poll_limit_ns && block_ns <= guest_halt_poll_ns) {
+		if (timer_wakeup && !guest_halt_poll_timer_grow)
+			return;
+
 		val = dev->poll_limit_ns * guest_halt_poll_grow;
 
 		if (val < guest_halt_poll_grow_start)
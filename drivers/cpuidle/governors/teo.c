@@ -42,12 +42,23 @@
  * - If the majority of the most recent idle duration values are below the
  *   target residency of the idle state selected so far, use those values to
  *   compute the new expected idle duration and find an idle state matching it
- *   (which has to be shallower than the one selected so far).
+ *   (which has to be shallower than the one selected so far).  The idle
+ *   duration values are kept separately depending on whether the wakeup before
+ *   them was a timer one or not, and only the values recorded after a wakeup of
+ *   the same kind as the last one are used, so that a burst of non-timer
+ *   wakeups is recognized quickly even if it is interleaved with timer ticks.
+ *
+ * With CONFIG_IRQ_TIMINGS and "teo.irq_timings=1" on the command line, the
+ * interrupt timings prediction is used on top of the above: if the next device
+ * interrupt is expected before the closest timer, the time till that interrupt
+ * is used as the anticipated idle duration instead of the sleep length.
  */
 
 #include <linux/cpuidle.h>
+#include <linux/interrupt.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/sched/clock.h>
 #include <linux/tick.h>
 
@@ -64,6 +75,11 @@
  */
 #define INTERVALS	8
 
+/* Kinds of the wakeup preceding a saved idle duration value. */
+#define TEO_WAKEUP_TIMER	0
+#define TEO_WAKEUP_OTHER	1
+#define TEO_WAKEUP_KINDS	2
+
 /**
  * struct teo_idle_state - Idle state data used by the TEO cpuidle governor.
  * @early_hits: "Early" CPU wakeups "matching" this state.
@@ -96,19 +112,58 @@ struct teo_idle_state {
  * @time_span_ns: Time between idle state selection and post-wakeup update.
  * @sleep_length_ns: Time till the closest timer event (at the selection time).
  * @states: Idle states data corresponding to this CPU.
- * @interval_idx: Index of the most recent saved idle interval.
- * @intervals: Saved idle duration values.
+ * @last_wakeup: Kind of the most recent wakeup (TEO_WAKEUP_TIMER or OTHER).
+ * @interval_idx: Index of the most recent saved idle interval, per kind.
+ * @intervals: Saved idle duration values, by kind of the preceding wakeup.
  */
 struct teo_cpu {
 	u64 time_span_ns;
 	u64 sleep_length_ns;
 	struct teo_idle_state states[CPUIDLE_STATE_MAX];
-	int interval_idx;
-	u64 intervals[INTERVALS];
+	int last_wakeup;
+	int interval_idx[TEO_WAKEUP_KINDS];
+	u64 intervals[TEO_WAKEUP_KINDS][INTERVALS];
 };
 
 static DEFINE_PER_CPU(struct teo_cpu, teo_cpus);
 
+#ifdef CONFIG_IRQ_TIMINGS
+static bool irq_timings __read_mostly;
+module_param(irq_timings, bool, 0444);
+
+/**
+ * teo_irq_duration - Clamp the anticipated idle duration to the next interrupt.
+ * @now: Current time as returned by local_clock().
+ * @duration_ns: Time till the closest timer event.
+ */
+static u64 teo_irq_duration(u64 now, u64 duration_ns)
+{
+	u64 next_irq;
+
+	if (!irq_timings)
+		return duration_ns;
+
+	next_irq = irq_timings_next_event(now);
+	if (next_irq - now < duration_ns)
+		return next_irq - now;
+
+	return duration_ns;
+}
+
+static void teo_irq_timings_init(void)
+{
+	if (irq_timings)
+		irq_timings_enable();
+}
+#else
+static inline u64 teo_irq_duration(u64 now, u64 duration_ns)
+{
+	return duration_ns;
+}
+
+static inline void teo_irq_timings_init(void) {}
+#endif
+
 /**
  * teo_update - Update CPU data after wakeup.
  * @drv: cpuidle driver containing state data.
@@ -117,7 +172,7 @@ static DEFINE_PER_CPU(struct teo_cpu, teo_cpus);
 static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 {
 	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
-	int i, idx_hit = -1, idx_timer = -1;
+	int i, kind, idx_hit = -1, idx_timer = -1;
 	u64 measured_ns;
 
 	if (cpu_data->time_span_ns >= cpu_data->sleep_length_ns) {
@@ -195,11 +250,16 @@ static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 
 	/*
 	 * Save idle duration values corresponding to non-timer wakeups for
-	 * pattern detection.
+	 * pattern detection, along with the values following the previous
+	 * wakeup of the same kind.
 	 */
-	cpu_data->intervals[cpu_data->interval_idx++] = measured_ns;
-	if (cpu_data->interval_idx >= INTERVALS)
-		cpu_data->interval_idx = 0;
+	kind = cpu_data->last_wakeup;
+	cpu_data->intervals[kind][cpu_data->interval_idx[kind]++] = measured_ns;
+	if (cpu_data->interval_idx[kind] >= INTERVALS)
+		cpu_data->interval_idx[kind] = 0;
+
+	cpu_data->last_wakeup = measured_ns == U64_MAX ?
+				TEO_WAKEUP_TIMER : TEO_WAKEUP_OTHER;
 }
 
 static bool teo_time_ok(u64 interval_ns)
@@ -257,6 +317,12 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	duration_ns = tick_nohz_get_sleep_length(&delta_tick);
 	cpu_data->sleep_length_ns = duration_ns;
 
+	/*
+	 * The statistics are kept against the sleep length, but the state
+	 * selection is done for the time till the earliest expected event.
+	 */
+	duration_ns = teo_irq_duration(cpu_data->time_span_ns, duration_ns);
+
 	hits = 0;
 	misses = 0;
 	early_hits = 0;
@@ -377,15 +443,17 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	if (idx < 0) {
 		idx = 0; /* No states enabled. Must use 0. */
 	} else if (idx > 0) {
+		u64 *intervals = cpu_data->intervals[cpu_data->last_wakeup];
 		unsigned int count = 0;
 		u64 sum = 0;
 
 		/*
 		 * Count and sum the most recent idle duration values less than
-		 * the current expected idle duration value.
+		 * the current expected idle duration value, among the ones
+		 * that followed a wakeup of the same kind as the last one.
 		 */
 		for (i = 0; i < INTERVALS; i++) {
-			u64 val = cpu_data->intervals[i];
+			u64 val = intervals[i];
 
 			if (val >= duration_ns)
 				continue;
@@ -468,12 +536,13 @@ static int teo_enable_device(struct cpuidle_driver *drv,
 			     struct cpuidle_device *dev)
 {
 	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
-	int i;
+	int i, kind;
 
 	memset(cpu_data, 0, sizeof(*cpu_data));
 
-	for (i = 0; i < INTERVALS; i++)
-		cpu_data->intervals[i] = U64_MAX;
+	for (kind = 0; kind < TEO_WAKEUP_KINDS; kind++)
+		for (i = 0; i < INTERVALS; i++)
+			cpu_data->intervals[kind][i] = U64_MAX;
 
 	return 0;
 }
@@ -488,6 +557,7 @@ static struct cpuidle_governor teo_governor = {
 
 static int __init teo_governor_init(void)
 {
+	teo_irq_timings_init();
 	return cpuidle_register_governor(&teo_governor);
 }
 
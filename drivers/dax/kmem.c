@@ -11,6 +11,7 @@
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/mman.h>
+#include <linux/node.h>
 #include "dax-private.h"
 #include "bus.h"
 
@@ -73,6 +74,9 @@ int dev_dax_kmem_probe(struct device *dev)
 	}
 	dev_dax->dax_kmem_res = new_res;
 
+	/* Slower than the RAM it is onlined next to: use it as a lower tier */
+	node_set_lower_tier(numa_node);
+
 	return 0;
 }
 
@@ -104,6 +108,9 @@ static int dev_dax_kmem_remove(struct device *dev)
 	kfree(res);
 	dev_dax->dax_kmem_res = NULL;
 
+	if (!node_state(dev_dax->target_node, N_MEMORY))
+		node_clear_lower_tier(dev_dax->target_node);
+
 	return 0;
 }
 #else
@@ -33,6 +33,7 @@
 
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
+#include <linux/highmem.h>
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/mm.h>
@@ -468,6 +469,125 @@ struct dma_chan *dma_find_channel(enum dma_transaction_type tx_type)
 }
 EXPORT_SYMBOL(dma_find_channel);
 
+/* one page of a dma_async_memcpy_pages() batch */
+struct dma_page_copy {
+	dma_addr_t src;
+	dma_addr_t dst;
+	dma_cookie_t cookie;
+};
+
+/**
+ * dma_async_memcpy_pages - copy a batch of pages with a single wait
+ * @chan: channel to use, or NULL for the NUMA-local memcpy channel
+ * @dst: destination pages
+ * @src: source pages
+ * @nr: number of pages in @dst and @src
+ *
+ * Every page is copied by its own descriptor, but only the last one asks
+ * for an interrupt and the caller waits once for the whole batch. Pages
+ * that cannot be mapped or queued are copied by the CPU, so all @nr pages
+ * have been copied on return. Looking up a channel for a NULL @chan needs
+ * a dmaengine_get() reference, as for the other dma_find_channel() users.
+ *
+ * The channel may be shared with other clients, so a batch that does not
+ * complete is not aborted: its pages are copied by the CPU and, if any of
+ * its descriptors is still in flight, its mappings are left in place.
+ *
+ * Returns the number of pages copied by the DMA engine.
+ */
+unsigned int dma_async_memcpy_pages(struct dma_chan *chan, struct page **dst,
+				    struct page **src, unsigned int nr)
+{
+	struct dma_async_tx_descriptor *tx;
+	struct dma_page_copy *copies, *c;
+	struct dma_device *device;
+	unsigned int i, mapped, done = 0;
+	bool busy = false;
+
+	if (!chan)
+		chan = dma_find_channel(DMA_MEMCPY);
+	if (!chan || !nr)
+		goto cpu_copy;
+
+	device = chan->device;
+	if (!device->device_prep_dma_memcpy ||
+	    !is_dma_copy_aligned(device, 0, 0, PAGE_SIZE))
+		goto cpu_copy;
+
+	copies = kmalloc_array(nr, sizeof(*copies), GFP_NOWAIT | __GFP_NOWARN);
+	if (!copies)
+		goto cpu_copy;
+
+	for (mapped = 0; mapped < nr; mapped++) {
+		unsigned long flags = DMA_CTRL_ACK;
+
+		c = &copies[mapped];
+		c->src = dma_map_page(device->dev, src[mapped], 0, PAGE_SIZE,
+				      DMA_TO_DEVICE);
+		if (dma_mapping_error(device->dev, c->src))
+			break;
+		c->dst = dma_map_page(device->dev, dst[mapped], 0, PAGE_SIZE,
+				      DMA_FROM_DEVICE);
+		if (dma_mapping_error(device->dev, c->dst)) {
+			dma_unmap_page(device->dev, c->src, PAGE_SIZE,
+				       DMA_TO_DEVICE);
+			break;
+		}
+
+		if (mapped == nr - 1)
+			flags |= DMA_PREP_INTERRUPT;
+		tx = device->device_prep_dma_memcpy(chan, c->dst, c->src,
+						    PAGE_SIZE, flags);
+		c->cookie = tx ? dmaengine_submit(tx) : -ENOMEM;
+		if (dma_submit_error(c->cookie)) {
+			dma_unmap_page(device->dev, c->dst, PAGE_SIZE,
+				       DMA_FROM_DEVICE);
+			dma_unmap_page(device->dev, c->src, PAGE_SIZE,
+				       DMA_TO_DEVICE);
+			break;
+		}
+	}
+
+	/*
+	 * Not every engine completes descriptors in submission order, so
+	 * wait for each cookie rather than only for the last one.  Once one
+	 * has failed, only check which of the others are still in flight.
+	 */
+	done = mapped;
+	for (i = 0; i < mapped; i++) {
+		c = &copies[i];
+		if (done && dma_sync_wait(chan, c->cookie) == DMA_COMPLETE)
+			continue;
+		done = 0;
+		if (dma_async_is_tx_complete(chan, c->cookie, NULL, NULL) ==
+		    DMA_IN_PROGRESS)
+			busy = true;
+	}
+
+	if (busy) {
+		/* unmapping would let the engine write to recycled IOVAs */
+		dev_warn_ratelimited(device->dev,
+				     "%s: batch timed out, leaking its mappings\n",
+				     __func__);
+	} else {
+		for (i = 0; i < mapped; i++) {
+			c = &copies[i];
+			dma_unmap_page(device->dev, c->dst, PAGE_SIZE,
+				       DMA_FROM_DEVICE);
+			dma_unmap_page(device->dev, c->src, PAGE_SIZE,
+				       DMA_TO_DEVICE);
+		}
+	}
+	kfree(copies);
+
+cpu_copy:
+	for (i = done; i < nr; i++)
+		copy_highpage(dst[i], src[i]);
+
+	return done;
+}
+EXPORT_SYMBOL(dma_async_memcpy_pages);
+
 /**
  * dma_issue_pending_all - flush all pending operations across all channels
  */
@@ -88,6 +88,10 @@ static unsigned int transfer_size;
 module_param(transfer_size, uint, 0644);
 MODULE_PARM_DESC(transfer_size, "Optional custom transfer size in bytes (default: not used (0))");
 
+static unsigned int page_batch;
+module_param(page_batch, uint, 0644);
+MODULE_PARM_DESC(page_batch, "Copy batches of this many pages with dma_async_memcpy_pages() instead of memcpy tests (default: not used (0))");
+
 /**
  * struct dmatest_params - test parameters.
  * @buf_size:		size of the memcpy test buffer
@@ -99,6 +103,7 @@ MODULE_PARM_DESC(transfer_size, "Optional custom transfer size in bytes (default
  * @xor_sources:	number of xor source buffers
  * @pq_sources:		number of p+q source buffers
  * @timeout:		transfer timeout in msec, 0 - 0xFFFFFFFF (4294967295)
+ * @page_batch:		number of pages per dma_async_memcpy_pages() batch
  */
 struct dmatest_params {
 	unsigned int	buf_size;
@@ -115,6 +120,7 @@ struct dmatest_params {
 	int		alignment;
 	unsigned int	transfer_size;
 	bool		polled;
+	unsigned int	page_batch;
 };
 
 /**
@@ -910,6 +916,94 @@ static int dmatest_func(void *data)
 	return ret;
 }
 
+/*
+ * Throughput of dma_async_memcpy_pages(): every test copies a batch of
+ * params->page_batch pages with a single wait, as a bulk page copy would.
+ */
+static int dmatest_batch_func(void *data)
+{
+	struct dmatest_thread	*thread = data;
+	struct dmatest_params	*params;
+	unsigned int		failed_tests = 0;
+	unsigned int		total_tests = 0;
+	unsigned long long	offloaded = 0;
+	unsigned long long	total_len = 0;
+	unsigned long long	iops = 0;
+	ktime_t			ktime, start;
+	ktime_t			comparetime = 0;
+	s64			runtime = 0;
+	struct page		**pages;
+	unsigned int		nr, i;
+	int			ret = -ENOMEM;
+
+	set_freezable();
+
+	smp_rmb();
+	thread->pending = false;
+	params = &thread->info->params;
+	nr = params->page_batch;
+
+	pages = kcalloc(2 * nr, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		goto err_pages;
+
+	for (i = 0; i < 2 * nr; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i])
+			goto err_alloc;
+	}
+	for (i = 0; i < nr; i++)
+		memset(page_address(pages[i]), gen_src_value(i, false), PAGE_SIZE);
+
+	set_user_nice(current, 10);
+
+	ktime = ktime_get();
+	while (!kthread_should_stop()
+	       && !(params->iterations && total_tests >= params->iterations)) {
+		total_tests++;
+		offloaded += dma_async_memcpy_pages(thread->chan, pages + nr,
+						    pages, nr);
+		total_len += (unsigned long long)nr * PAGE_SIZE;
+
+		if (params->noverify)
+			continue;
+
+		start = ktime_get();
+		for (i = 0; i < nr; i++) {
+			void *dst = page_address(pages[nr + i]);
+
+			if (memcmp(dst, page_address(pages[i]), PAGE_SIZE)) {
+				result("data error", total_tests, 0, 0,
+				       PAGE_SIZE, i);
+				failed_tests++;
+			}
+			memset(dst, gen_dst_value(i, false), PAGE_SIZE);
+		}
+		comparetime = ktime_add(comparetime,
+					ktime_sub(ktime_get(), start));
+	}
+	ktime = ktime_sub(ktime_get(), ktime);
+	ktime = ktime_sub(ktime, comparetime);
+	runtime = ktime_to_us(ktime);
+
+	ret = 0;
+err_alloc:
+	for (i = 0; i < 2 * nr && pages[i]; i++)
+		__free_page(pages[i]);
+	kfree(pages);
+err_pages:
+	iops = dmatest_persec(runtime, total_tests);
+	pr_info("%s: summary %u batches of %u pages, %llu offloaded, %u failures %llu.%02llu iops %llu KB/s (%d)\n",
+		current->comm, total_tests, nr, offloaded, failed_tests,
+		FIXPT_TO_INT(iops), FIXPT_GET_FRAC(iops),
+		dmatest_KBs(runtime, total_len), ret);
+
+	thread->done = true;
+	wake_up(&thread_wait);
+
+	return ret;
+}
+
 static void dmatest_cleanup_channel(struct dmatest_chan *dtc)
 {
 	struct dmatest_thread	*thread;
@@ -937,6 +1031,7 @@ static int dmatest_add_threads(struct dmatest_info *info,
 	struct dmatest_params *params = &info->params;
 	struct dmatest_thread *thread;
 	struct dma_chan *chan = dtc->chan;
+	int (*fn)(void *data) = dmatest_func;
 	char *op;
 	unsigned int i;
 
@@ -951,6 +1046,11 @@ static int dmatest_add_threads(struct dmatest_info *info,
 	else
 		return -EINVAL;
 
+	if (type == DMA_MEMCPY && params->page_batch) {
+		op = "batch";
+		fn = dmatest_batch_func;
+	}
+
 	for (i = 0; i < params->threads_per_chan; i++) {
 		thread = kzalloc(sizeof(struct dmatest_thread), GFP_KERNEL);
 		if (!thread) {
@@ -964,7 +1064,7 @@ static int dmatest_add_threads(struct dmatest_info *info,
 		thread->test_done.wait = &thread->done_wait;
 		init_waitqueue_head(&thread->done_wait);
 		smp_wmb();
-		thread->task = kthread_create(dmatest_func, thread, "%s-%s%u",
+		thread->task = kthread_create(fn, thread, "%s-%s%u",
 				dma_chan_name(chan), op, i);
 		if (IS_ERR(thread->task)) {
 			pr_warn("Failed to create thread %s-%s%u\n",
@@ -1086,6 +1186,7 @@ static void add_threaded_test(struct dmatest_info *info)
 	params->alignment = alignment;
 	params->transfer_size = transfer_size;
 	params->polled = polled;
+	params->page_batch = page_batch;
 
 	request_channels(info, DMA_MEMCPY);
 	request_channels(info, DMA_MEMSET);
@@ -133,6 +133,15 @@ static enum dma_status idxd_dma_tx_status(struct dma_chan *dma_chan,
 					  dma_cookie_t cookie,
 					  struct dma_tx_state *txstate)
 {
+	enum dma_status status;
+
+	status = dma_cookie_status(dma_chan, cookie, txstate);
+	if (status == DMA_COMPLETE)
+		return status;
+
+	/* Reap descriptors that were submitted without DMA_PREP_INTERRUPT. */
+	idxd_poll_completions(to_idxd_wq(dma_chan));
+
 	return dma_cookie_status(dma_chan, cookie, txstate);
 }
 
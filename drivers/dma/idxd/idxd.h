@@ -116,6 +116,8 @@ struct idxd_wq {
 	struct dma_chan dma_chan;
 	struct percpu_rw_semaphore submit_lock;
 	wait_queue_head_t submit_waitq;
+	spinlock_t poll_lock;		/* protects poll_list */
+	struct list_head poll_list;	/* submitted without RCI */
 	char name[WQ_NAME_SIZE + 1];
 };
 
@@ -295,6 +297,8 @@ void idxd_wq_unmap_portal(struct idxd_wq *wq);
 int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc);
 struct idxd_desc *idxd_alloc_desc(struct idxd_wq *wq, enum idxd_op_type optype);
 void idxd_free_desc(struct idxd_wq *wq, struct idxd_desc *desc);
+void idxd_poll_completions(struct idxd_wq *wq);
+void idxd_flush_poll_list(struct idxd_wq *wq);
 
 /* dmaengine */
 int idxd_register_dma_device(struct idxd_device *idxd);
@@ -188,6 +188,8 @@ static int idxd_setup_internals(struct idxd_device *idxd)
 		mutex_init(&wq->wq_lock);
 		atomic_set(&wq->dq_count, 0);
 		init_waitqueue_head(&wq->submit_waitq);
+		spin_lock_init(&wq->poll_lock);
+		INIT_LIST_HEAD(&wq->poll_list);
 		wq->idxd_cdev.minor = -1;
 		rc = percpu_init_rwsem(&wq->submit_lock);
 		if (rc < 0) {
@@ -453,6 +455,9 @@ static void idxd_shutdown(struct pci_dev *pdev)
 		idxd_flush_pending_llist(irq_entry);
 		idxd_flush_work_list(irq_entry);
 	}
+
+	for (i = 0; i < idxd->max_wqs; i++)
+		idxd_flush_poll_list(&idxd->wqs[i]);
 }
 
 static void idxd_remove(struct pci_dev *pdev)
@@ -85,11 +85,59 @@ int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc)
 
 	/*
 	 * Pending the descriptor to the lockless list for the irq_entry
-	 * that we designated the descriptor to.
+	 * that we designated the descriptor to. Descriptors that do not
+	 * request an interrupt are reaped by polling their completion
+	 * record instead, see idxd_poll_completions().
 	 */
-	if (desc->hw->flags & IDXD_OP_FLAG_RCI)
+	if (desc->hw->flags & IDXD_OP_FLAG_RCI) {
 		llist_add(&desc->llnode,
 			  &idxd->irq_entries[vec].pending_llist);
+	} else {
+		spin_lock_bh(&wq->poll_lock);
+		list_add_tail(&desc->list, &wq->poll_list);
+		spin_unlock_bh(&wq->poll_lock);
+	}
 
 	return 0;
 }
+
+/*
+ * Complete the descriptors on the poll list whose completion record has
+ * been written by the device. Called from the dmaengine status path, so
+ * that a client polling with dma_sync_wait() or dma_async_is_tx_complete()
+ * sees its transactions finish without taking an interrupt per descriptor.
+ */
+void idxd_poll_completions(struct idxd_wq *wq)
+{
+	struct idxd_desc *desc, *iter;
+	LIST_HEAD(done);
+
+	spin_lock_bh(&wq->poll_lock);
+	list_for_each_entry_safe(desc, iter, &wq->poll_list, list) {
+		if (READ_ONCE(desc->completion->status))
+			list_move_tail(&desc->list, &done);
+	}
+	spin_unlock_bh(&wq->poll_lock);
+
+	list_for_each_entry_safe(desc, iter, &done, list) {
+		list_del(&desc->list);
+		idxd_dma_complete_txd(desc, IDXD_COMPLETE_NORMAL);
+		idxd_free_desc(wq, desc);
+	}
+}
+
+void idxd_flush_poll_list(struct idxd_wq *wq)
+{
+	struct idxd_desc *desc, *iter;
+	LIST_HEAD(flush);
+
+	spin_lock_bh(&wq->poll_lock);
+	list_splice_init(&wq->poll_list, &flush);
+	spin_unlock_bh(&wq->poll_lock);
+
+	list_for_each_entry_safe(desc, iter, &flush, list) {
+		list_del(&desc->list);
+		idxd_dma_complete_txd(desc, IDXD_COMPLETE_ABORT);
+		idxd_free_desc(wq, desc);
+	}
+}
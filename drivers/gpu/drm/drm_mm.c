@@ -501,6 +501,13 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 		if (mode == DRM_MM_INSERT_HIGH && hole_end <= range_start)
 			break;
 
+		/*
+		 * Only the best-fit walk is ordered by size; the others visit
+		 * every hole, so reject the small ones before color_adjust().
+		 */
+		if (hole->hole_size < size)
+			continue;
+
 		col_start = hole_start;
 		col_end = hole_end;
 		if (mm->color_adjust)
@@ -873,15 +880,23 @@ struct drm_mm_node *drm_mm_scan_color_evict(struct drm_mm_scan *scan)
 	/*
 	 * The hole found during scanning should ideally be the first element
 	 * in the hole_stack list, but due to side-effects in the driver it
-	 * may not be.
+	 * may not be. Look it up by address, which does not depend on the
+	 * order of the hole_stack, and only walk the stack if that fails.
 	 */
-	list_for_each_entry(hole, &mm->hole_stack, hole_stack) {
+	hole = find_hole(mm, scan->hit_start);
+	if (hole) {
 		hole_start = __drm_mm_hole_node_start(hole);
 		hole_end = hole_start + hole->hole_size;
+	}
+	if (!hole || hole_start > scan->hit_start || hole_end < scan->hit_end) {
+		list_for_each_entry(hole, &mm->hole_stack, hole_stack) {
+			hole_start = __drm_mm_hole_node_start(hole);
+			hole_end = hole_start + hole->hole_size;
 
-		if (hole_start <= scan->hit_start &&
-		    hole_end >= scan->hit_end)
-			break;
+			if (hole_start <= scan->hit_start &&
+			    hole_end >= scan->hit_end)
+				break;
+		}
 	}
 
 	/* We should only be called after we found the hole previously */
@@ -25,3 +25,4 @@ selftest(highest, igt_highest)
 selftest(color, igt_color)
 selftest(color_evict, igt_color_evict)
 selftest(color_evict_range, igt_color_evict_range)
+selftest(bench_fragmented, igt_bench_fragmented)
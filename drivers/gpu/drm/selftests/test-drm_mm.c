@@ -10,6 +10,7 @@
 #include <linux/slab.h>
 #include <linux/random.h>
 #include <linux/vmalloc.h>
+#include <linux/ktime.h>
 
 #include <drm/drm_mm.h>
 
@@ -2350,6 +2351,88 @@ static int igt_color_evict_range(void *ignored)
 	return ret;
 }
 
+static int igt_bench_fragmented(void *ignored)
+{
+	DRM_RND_STATE(prng, random_seed);
+	const unsigned int count = min(8192u, max_iterations);
+	const struct insert_mode *mode;
+	struct drm_mm mm;
+	struct drm_mm_node *nodes, *node, *next;
+	unsigned int *order, n, ops;
+	ktime_t t;
+	int ret;
+
+	/* Measure insert/remove throughput on a heavily fragmented mm: every
+	 * other node is removed up front, leaving count/2 small holes, and
+	 * then random nodes are removed and reinserted with a larger
+	 * alignment, so that most holes are visited but rejected.
+	 */
+
+	ret = -ENOMEM;
+	nodes = vzalloc(array_size(count, sizeof(*nodes)));
+	if (!nodes)
+		goto err;
+
+	order = drm_random_order(count, &prng);
+	if (!order)
+		goto err_nodes;
+
+	ret = -EINVAL;
+	for (mode = insert_modes; mode->name; mode++) {
+		drm_mm_init(&mm, 0, 4ull * count);
+
+		for (n = 0; n < count; n++) {
+			if (!expect_insert(&mm, &nodes[n], 2, 0, n, mode)) {
+				pr_err("%s insert failed, step %d\n",
+				       mode->name, n);
+				goto out;
+			}
+		}
+
+		for (n = 0; n < count; n += 2)
+			drm_mm_remove_node(&nodes[n]);
+
+		ops = 0;
+		t = ktime_get();
+		for (n = 0; n < count; n++) {
+			node = &nodes[order[n]];
+			if (!drm_mm_node_allocated(node))
+				continue;
+
+			drm_mm_remove_node(node);
+			if (!expect_insert(&mm, node, 2, 4, 0, mode)) {
+				pr_err("%s reinsert failed, step %d\n",
+				       mode->name, n);
+				goto out;
+			}
+			ops++;
+		}
+		t = ktime_sub(ktime_get(), t);
+
+		pr_info("%s: %u remove/insert pairs with %u holes took %lldus\n",
+			mode->name, ops, count / 2, ktime_to_us(t));
+
+		drm_mm_for_each_node_safe(node, next, &mm)
+			drm_mm_remove_node(node);
+		DRM_MM_BUG_ON(!drm_mm_clean(&mm));
+		drm_mm_takedown(&mm);
+		cond_resched();
+	}
+
+	ret = 0;
+	goto err_order;
+out:
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+	drm_mm_takedown(&mm);
+err_order:
+	kfree(order);
+err_nodes:
+	vfree(nodes);
+err:
+	return ret;
+}
+
 #include "drm_selftest.c"
 
 static int __init test_drm_mm_init(void)
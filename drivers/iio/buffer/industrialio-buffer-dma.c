@@ -12,6 +12,9 @@
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/poll.h>
+#include <linux/mm.h>
+#include <linux/math64.h>
+#include <linux/timekeeping.h>
 #include <linux/iio/buffer.h>
 #include <linux/iio/buffer_impl.h>
 #include <linux/iio/buffer-dma.h>
@@ -89,6 +92,13 @@
  * has special requirements that are not handled by the generic functions. If a
  * driver chooses to overload a callback it has to ensure that the generic
  * callback is called from within the custom callback.
+ *
+ * Instead of read() an application can also exchange the blocks directly.
+ * After allocating blocks with IIO_BUFFER_BLOCK_ALLOC_IOCTL it maps them with
+ * mmap() and passes them back and forth with the enqueue and dequeue ioctls,
+ * so the samples are never copied. The application owns a block after
+ * allocating and after dequeuing it. While such blocks exist the two fileio
+ * blocks are released and read() returns -EBUSY.
  */
 
 static void iio_buffer_block_release(struct kref *kref)
@@ -216,6 +226,8 @@ void iio_dma_buffer_block_done(struct iio_dma_buffer_block *block)
 	struct iio_dma_buffer_queue *queue = block->queue;
 	unsigned long flags;
 
+	block->timestamp = ktime_get_ns();
+
 	spin_lock_irqsave(&queue->list_lock, flags);
 	_iio_dma_buffer_block_done(block);
 	spin_unlock_irqrestore(&queue->list_lock, flags);
@@ -287,6 +299,10 @@ int iio_dma_buffer_request_update(struct iio_buffer *buffer)
 	int ret = 0;
 	int i;
 
+	/* The application manages the blocks itself */
+	if (queue->num_blocks)
+		return 0;
+
 	/*
 	 * Split the buffer into two even parts. This is used as a double
 	 * buffering scheme with usually one block at a time being used by the
@@ -491,6 +507,11 @@ int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
 
 	mutex_lock(&queue->lock);
 
+	if (queue->num_blocks) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
 	if (!queue->fileio.active_block) {
 		block = iio_dma_buffer_dequeue(queue);
 		if (block == NULL) {
@@ -528,6 +549,340 @@ int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
 }
 EXPORT_SYMBOL_GPL(iio_dma_buffer_read);
 
+/* Both called with queue->lock held and the buffer disabled */
+static void iio_dma_buffer_fileio_free(struct iio_dma_buffer_queue *queue)
+{
+	unsigned int i;
+
+	spin_lock_irq(&queue->list_lock);
+	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
+		if (!queue->fileio.blocks[i])
+			continue;
+		queue->fileio.blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	}
+	INIT_LIST_HEAD(&queue->outgoing);
+	spin_unlock_irq(&queue->list_lock);
+
+	INIT_LIST_HEAD(&queue->incoming);
+
+	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
+		if (!queue->fileio.blocks[i])
+			continue;
+		iio_buffer_block_put(queue->fileio.blocks[i]);
+		queue->fileio.blocks[i] = NULL;
+	}
+	queue->fileio.active_block = NULL;
+	queue->fileio.block_size = 0;
+}
+
+static void iio_dma_buffer_mmap_free(struct iio_dma_buffer_queue *queue)
+{
+	unsigned int i;
+
+	spin_lock_irq(&queue->list_lock);
+	for (i = 0; i < queue->num_blocks; i++)
+		queue->blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	INIT_LIST_HEAD(&queue->outgoing);
+	spin_unlock_irq(&queue->list_lock);
+
+	INIT_LIST_HEAD(&queue->incoming);
+
+	/* Blocks still mapped by the application stay around until unmapped */
+	for (i = 0; i < queue->num_blocks; i++)
+		iio_buffer_block_put(queue->blocks[i]);
+
+	kfree(queue->blocks);
+	queue->blocks = NULL;
+	queue->num_blocks = 0;
+}
+
+/* Upper bound for the number of blocks of a single allocation request */
+#define IIO_DMA_BUFFER_MAX_BLOCKS	64
+
+/**
+ * iio_dma_buffer_alloc_blocks() - DMA buffer alloc_blocks callback
+ * @buffer: Buffer to allocate the blocks for
+ * @req: The allocation request, updated with the blocks that were allocated
+ *
+ * Should be used as the alloc_blocks callback for iio_buffer_access_ops
+ * struct for DMA buffers. Any blocks allocated earlier, for mmap or for
+ * read(), are released first.
+ */
+int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+	struct iio_buffer_block_alloc_req *req)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block **blocks;
+	unsigned int count, i;
+	u64 block_size;
+	int ret = 0;
+
+	if (req->type != 0 || !req->size || !req->count)
+		return -EINVAL;
+
+	if (buffer->bytes_per_datum && req->size % buffer->bytes_per_datum)
+		return -EINVAL;
+
+	/*
+	 * Block i is mapped at i * block_size, which has to fit the __u32
+	 * data.offset reported to user space.
+	 */
+	block_size = ALIGN((u64)req->size, PAGE_SIZE);
+	if (block_size > U32_MAX)
+		return -EINVAL;
+
+	count = min_t(unsigned int, req->count, IIO_DMA_BUFFER_MAX_BLOCKS);
+	count = min_t(u64, count, div64_u64(U32_MAX, block_size) + 1);
+
+	blocks = kcalloc(count, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks)
+		return -ENOMEM;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->active) {
+		ret = -EBUSY;
+		goto err_unlock;
+	}
+
+	iio_dma_buffer_fileio_free(queue);
+	if (queue->num_blocks)
+		iio_dma_buffer_mmap_free(queue);
+
+	for (i = 0; i < count; i++) {
+		blocks[i] = iio_dma_buffer_alloc_block(queue, req->size);
+		if (!blocks[i])
+			break;
+		blocks[i]->id = i;
+	}
+
+	if (!i) {
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
+
+	queue->blocks = blocks;
+	queue->num_blocks = i;
+	mutex_unlock(&queue->lock);
+
+	req->count = i;
+	req->id = 0;
+
+	return 0;
+
+err_unlock:
+	mutex_unlock(&queue->lock);
+	kfree(blocks);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_alloc_blocks);
+
+/**
+ * iio_dma_buffer_free_blocks() - DMA buffer free_blocks callback
+ * @buffer: Buffer to free the blocks of
+ *
+ * Should be used as the free_blocks callback for iio_buffer_access_ops
+ * struct for DMA buffers. Afterwards the buffer is read with read() again.
+ */
+int iio_dma_buffer_free_blocks(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+	if (queue->active)
+		ret = -EBUSY;
+	else
+		iio_dma_buffer_mmap_free(queue);
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_free_blocks);
+
+static void iio_dma_buffer_block_to_user(struct iio_dma_buffer_block *block,
+	struct iio_buffer_block *b)
+{
+	b->id = block->id;
+	b->size = block->size;
+	b->bytes_used = block->bytes_used;
+	b->type = 0;
+	b->flags = block->timestamp ? IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID : 0;
+	b->data.offset = block->id * PAGE_ALIGN(block->size);
+	b->timestamp = block->timestamp;
+}
+
+/**
+ * iio_dma_buffer_query_block() - DMA buffer query_block callback
+ * @buffer: Buffer the block belongs to
+ * @block: Descriptor to fill in, with the id of the block set
+ *
+ * Should be used as the query_block callback for iio_buffer_access_ops
+ * struct for DMA buffers.
+ */
+int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+	if (block->id < queue->num_blocks)
+		iio_dma_buffer_block_to_user(queue->blocks[block->id], block);
+	else
+		ret = -EINVAL;
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_query_block);
+
+/**
+ * iio_dma_buffer_enqueue_block() - DMA buffer enqueue_block callback
+ * @buffer: Buffer to enqueue the block on
+ * @block: Descriptor of the block, only the id is used
+ *
+ * Should be used as the enqueue_block callback for iio_buffer_access_ops
+ * struct for DMA buffers. Hands a block owned by the application back to the
+ * DMA controller.
+ */
+int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (block->id >= queue->num_blocks) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	dma_block = queue->blocks[block->id];
+	if (dma_block->state != IIO_BLOCK_STATE_DEQUEUED) {
+		ret = -EPERM;
+		goto out_unlock;
+	}
+
+	dma_block->bytes_used = dma_block->size;
+	dma_block->timestamp = 0;
+	iio_dma_buffer_enqueue(queue, dma_block);
+	iio_dma_buffer_block_to_user(dma_block, block);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_enqueue_block);
+
+/**
+ * iio_dma_buffer_dequeue_block() - DMA buffer dequeue_block callback
+ * @buffer: Buffer to dequeue the block from
+ * @block: Filled in with the descriptor of the dequeued block
+ *
+ * Should be used as the dequeue_block callback for iio_buffer_access_ops
+ * struct for DMA buffers. Returns -EAGAIN if no block has been completed.
+ */
+int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (!queue->num_blocks) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	dma_block = iio_dma_buffer_dequeue(queue);
+	if (!dma_block) {
+		ret = -EAGAIN;
+		goto out_unlock;
+	}
+
+	iio_dma_buffer_block_to_user(dma_block, block);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_dequeue_block);
+
+static void iio_dma_buffer_vm_open(struct vm_area_struct *vma)
+{
+	iio_buffer_block_get(vma->vm_private_data);
+}
+
+static void iio_dma_buffer_vm_close(struct vm_area_struct *vma)
+{
+	iio_buffer_block_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct iio_dma_buffer_vm_ops = {
+	.open = iio_dma_buffer_vm_open,
+	.close = iio_dma_buffer_vm_close,
+};
+
+/**
+ * iio_dma_buffer_mmap() - DMA buffer mmap callback
+ * @buffer: Buffer the block to map belongs to
+ * @vma: The mapping, its offset is the one reported for the block
+ *
+ * Should be used as the mmap callback for iio_buffer_access_ops struct for
+ * DMA buffers. Each mapping covers a single block and holds a reference to
+ * it, so the memory stays valid until it is unmapped.
+ */
+int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+	struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block;
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	size_t block_size;
+	int ret;
+
+	mutex_lock(&queue->lock);
+
+	if (!queue->num_blocks) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	block_size = PAGE_ALIGN(queue->blocks[0]->size);
+	if (offset % block_size || offset / block_size >= queue->num_blocks ||
+	    vma->vm_end - vma->vm_start > block_size) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	block = queue->blocks[offset / block_size];
+
+	/* dma_mmap_coherent() takes vm_pgoff relative to the block */
+	vma->vm_pgoff = 0;
+	ret = dma_mmap_coherent(queue->dev, vma, block->vaddr,
+				block->phys_addr, vma->vm_end - vma->vm_start);
+	if (ret)
+		goto out_unlock;
+
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_private_data = block;
+	vma->vm_ops = &iio_dma_buffer_vm_ops;
+	iio_buffer_block_get(block);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_mmap);
+
 /**
  * iio_dma_buffer_data_available() - DMA buffer data_available callback
  * @buf: Buffer to check for data availability
@@ -636,28 +991,10 @@ EXPORT_SYMBOL_GPL(iio_dma_buffer_init);
  */
 void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue)
 {
-	unsigned int i;
-
 	mutex_lock(&queue->lock);
 
-	spin_lock_irq(&queue->list_lock);
-	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
-		if (!queue->fileio.blocks[i])
-			continue;
-		queue->fileio.blocks[i]->state = IIO_BLOCK_STATE_DEAD;
-	}
-	INIT_LIST_HEAD(&queue->outgoing);
-	spin_unlock_irq(&queue->list_lock);
-
-	INIT_LIST_HEAD(&queue->incoming);
-
-	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
-		if (!queue->fileio.blocks[i])
-			continue;
-		iio_buffer_block_put(queue->fileio.blocks[i]);
-		queue->fileio.blocks[i] = NULL;
-	}
-	queue->fileio.active_block = NULL;
+	iio_dma_buffer_fileio_free(queue);
+	iio_dma_buffer_mmap_free(queue);
 	queue->ops = NULL;
 
 	mutex_unlock(&queue->lock);
@@ -16,6 +16,7 @@
 #include <linux/cdev.h>
 #include <linux/slab.h>
 #include <linux/poll.h>
+#include <linux/mm.h>
 #include <linux/sched/signal.h>
 
 #include <linux/iio/iio.h>
@@ -180,6 +181,119 @@ __poll_t iio_buffer_poll(struct file *filp,
 	return 0;
 }
 
+static int iio_buffer_dequeue_block(struct iio_dev *indio_dev,
+				    struct file *filp,
+				    struct iio_buffer_block *block)
+{
+	struct iio_buffer *rb = indio_dev->buffer;
+	DEFINE_WAIT_FUNC(wait, woken_wake_function);
+	int ret;
+
+	add_wait_queue(&rb->pollq, &wait);
+	do {
+		if (!indio_dev->info) {
+			ret = -ENODEV;
+			break;
+		}
+
+		ret = rb->access->dequeue_block(rb, block);
+		if (ret != -EAGAIN || (filp->f_flags & O_NONBLOCK))
+			break;
+
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+
+		wait_woken(&wait, TASK_INTERRUPTIBLE, MAX_SCHEDULE_TIMEOUT);
+	} while (1);
+	remove_wait_queue(&rb->pollq, &wait);
+
+	return ret;
+}
+
+/**
+ * iio_buffer_ioctl() - chrdev ioctls for block based buffer access
+ * @indio_dev:	The IIO device
+ * @filp:	File structure pointer for the char device
+ * @cmd:	One of the IIO_BUFFER_BLOCK_*_IOCTL commands
+ * @arg:	Pointer to the command's argument in userspace
+ *
+ * Blocks are allocated, exchanged with the buffer and mapped with mmap()
+ * instead of copying the data through read(). While blocks are allocated
+ * read() is not available.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+long iio_buffer_ioctl(struct iio_dev *indio_dev, struct file *filp,
+		      unsigned int cmd, unsigned long arg)
+{
+	struct iio_buffer *rb = indio_dev->buffer;
+	void __user *p = (void __user *)arg;
+	struct iio_buffer_block_alloc_req req;
+	struct iio_buffer_block block;
+	int ret;
+
+	if (!rb || !rb->access->alloc_blocks)
+		return -EINVAL;
+
+	switch (cmd) {
+	case IIO_BUFFER_BLOCK_ALLOC_IOCTL:
+		if (copy_from_user(&req, p, sizeof(req)))
+			return -EFAULT;
+		ret = rb->access->alloc_blocks(rb, &req);
+		if (ret)
+			return ret;
+		if (copy_to_user(p, &req, sizeof(req)))
+			return -EFAULT;
+		return 0;
+	case IIO_BUFFER_BLOCK_FREE_IOCTL:
+		return rb->access->free_blocks(rb);
+	case IIO_BUFFER_BLOCK_QUERY_IOCTL:
+	case IIO_BUFFER_BLOCK_ENQUEUE_IOCTL:
+	case IIO_BUFFER_BLOCK_DEQUEUE_IOCTL:
+		if (copy_from_user(&block, p, sizeof(block)))
+			return -EFAULT;
+		if (cmd == IIO_BUFFER_BLOCK_QUERY_IOCTL)
+			ret = rb->access->query_block(rb, &block);
+		else if (cmd == IIO_BUFFER_BLOCK_ENQUEUE_IOCTL)
+			ret = rb->access->enqueue_block(rb, &block);
+		else
+			ret = iio_buffer_dequeue_block(indio_dev, filp, &block);
+		if (ret)
+			return ret;
+		if (copy_to_user(p, &block, sizeof(block)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * iio_buffer_mmap() - chrdev mmap for block based buffer access
+ * @filp:	File structure pointer for the char device
+ * @vma:	The mapping to set up; its offset selects the block
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int iio_buffer_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct iio_dev *indio_dev = filp->private_data;
+	struct iio_buffer *rb = indio_dev->buffer;
+
+	if (!indio_dev->info)
+		return -ENODEV;
+
+	if (!rb || !rb->access->mmap)
+		return -ENODEV;
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	return rb->access->mmap(rb, vma);
+}
+
 /**
  * iio_buffer_wakeup_poll - Wakes up the buffer waitqueue
  * @indio_dev: The IIO device
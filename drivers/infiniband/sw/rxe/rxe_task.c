@@ -34,9 +34,31 @@
 #include <linux/kernel.h>
 #include <linux/interrupt.h>
 #include <linux/hardirq.h>
+#include <linux/workqueue.h>
 
 #include "rxe_task.h"
 
+/*
+ * Scheduled tasks run from an unbound workqueue rather than a tasklet, so
+ * that the requester, responder and completer of busy QPs spread over all
+ * CPUs instead of piling up on the one that raised the softirq.
+ */
+static struct workqueue_struct *rxe_wq;
+
+int rxe_alloc_wq(void)
+{
+	rxe_wq = alloc_workqueue("rxe_wq", WQ_UNBOUND, WQ_MAX_ACTIVE);
+	if (!rxe_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void rxe_destroy_wq(void)
+{
+	destroy_workqueue(rxe_wq);
+}
+
 int __rxe_do_task(struct rxe_task *task)
 
 {
@@ -114,6 +136,28 @@ void rxe_do_task(unsigned long data)
 	task->ret = ret;
 }
 
+static void rxe_do_work(struct work_struct *work)
+{
+	struct rxe_task *task = container_of(work, struct rxe_task, work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&task->state_lock, flags);
+	if (task->disabled) {
+		task->deferred = true;
+		spin_unlock_irqrestore(&task->state_lock, flags);
+		return;
+	}
+	spin_unlock_irqrestore(&task->state_lock, flags);
+
+	/*
+	 * The task functions also run from the receive softirq, and their
+	 * locking assumes bottom halves are off.
+	 */
+	local_bh_disable();
+	rxe_do_task((unsigned long)task);
+	local_bh_enable();
+}
+
 int rxe_init_task(void *obj, struct rxe_task *task,
 		  void *arg, int (*func)(void *), char *name)
 {
@@ -122,8 +166,10 @@ int rxe_init_task(void *obj, struct rxe_task *task,
 	task->func	= func;
 	snprintf(task->name, sizeof(task->name), "%s", name);
 	task->destroyed	= false;
+	task->disabled	= 0;
+	task->deferred	= false;
 
-	tasklet_init(&task->tasklet, rxe_do_task, (unsigned long)task);
+	INIT_WORK(&task->work, rxe_do_work);
 
 	task->state = TASK_STATE_START;
 	spin_lock_init(&task->state_lock);
@@ -138,7 +184,7 @@ void rxe_cleanup_task(struct rxe_task *task)
 
 	/*
 	 * Mark the task, then wait for it to finish. It might be
-	 * running in a non-tasklet (direct call) context.
+	 * running in a non-workqueue (direct call) context.
 	 */
 	task->destroyed = true;
 
@@ -148,7 +194,7 @@ void rxe_cleanup_task(struct rxe_task *task)
 		spin_unlock_irqrestore(&task->state_lock, flags);
 	} while (!idle);
 
-	tasklet_kill(&task->tasklet);
+	cancel_work_sync(&task->work);
 }
 
 void rxe_run_task(struct rxe_task *task, int sched)
@@ -157,17 +203,38 @@ void rxe_run_task(struct rxe_task *task, int sched)
 		return;
 
 	if (sched)
-		tasklet_schedule(&task->tasklet);
+		queue_work(rxe_wq, &task->work);
 	else
 		rxe_do_task((unsigned long)task);
 }
 
+/*
+ * Like tasklet_disable(): wait for a running instance to finish and hold
+ * back scheduled runs until rxe_enable_task().
+ */
 void rxe_disable_task(struct rxe_task *task)
 {
-	tasklet_disable(&task->tasklet);
+	unsigned long flags;
+
+	spin_lock_irqsave(&task->state_lock, flags);
+	task->disabled++;
+	spin_unlock_irqrestore(&task->state_lock, flags);
+
+	flush_work(&task->work);
 }
 
 void rxe_enable_task(struct rxe_task *task)
 {
-	tasklet_enable(&task->tasklet);
+	unsigned long flags;
+	bool run = false;
+
+	spin_lock_irqsave(&task->state_lock, flags);
+	if (!--task->disabled && task->deferred) {
+		task->deferred = false;
+		run = true;
+	}
+	spin_unlock_irqrestore(&task->state_lock, flags);
+
+	if (run)
+		queue_work(rxe_wq, &task->work);
 }
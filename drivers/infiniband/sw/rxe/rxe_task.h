@@ -47,9 +47,11 @@ enum {
  */
 struct rxe_task {
 	void			*obj;
-	struct tasklet_struct	tasklet;
+	struct work_struct	work;
 	int			state;
 	spinlock_t		state_lock; /* spinlock for task state */
+	int			disabled;   /* protected by state_lock */
+	bool			deferred;   /* scheduled while disabled */
 	void			*arg;
 	int			(*func)(void *arg);
 	int			ret;
@@ -70,7 +72,7 @@ void rxe_cleanup_task(struct rxe_task *task);
 
 /*
  * raw call to func in loop without any checking
- * can call when tasklets are disabled
+ * can call when tasks are disabled
  */
 int __rxe_do_task(struct rxe_task *task);
 
@@ -82,8 +84,8 @@ int __rxe_do_task(struct rxe_task *task);
  */
 void rxe_do_task(unsigned long data);
 
-/* run a task, else schedule it to run as a tasklet, The decision
- * to run or schedule tasklet is based on the parameter sched.
+/* run a task, else schedule it to run on rxe_wq, The decision
+ * to run or schedule the task is based on the parameter sched.
  */
 void rxe_run_task(struct rxe_task *task, int sched);
 
@@ -93,4 +95,7 @@ void rxe_disable_task(struct rxe_task *task);
 /* allow task to run */
 void rxe_enable_task(struct rxe_task *task);
 
+int rxe_alloc_wq(void);
+void rxe_destroy_wq(void);
+
 #endif /* RXE_TASK_H */
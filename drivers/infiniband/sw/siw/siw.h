@@ -678,29 +678,28 @@ static inline struct siw_sqe *irq_alloc_free(struct siw_qp *qp)
 	return NULL;
 }
 
-static inline __wsum siw_csum_update(const void *buff, int len, __wsum sum)
-{
-	return (__force __wsum)crc32c((__force __u32)sum, buff, len);
-}
-
-static inline __wsum siw_csum_combine(__wsum csum, __wsum csum2, int offset,
-				      int len)
-{
-	return (__force __wsum)__crc32c_le_combine((__force __u32)csum,
-						   (__force __u32)csum2, len);
-}
-
-static inline void siw_crc_skb(struct siw_rx_stream *srx, unsigned int len)
+/*
+ * Copy @len bytes at the current skb offset to @dest and fold them into
+ * the MPA CRC in the same pass. The CRC is taken from the skb, not from
+ * @dest, which user space may be writing to concurrently.
+ */
+static inline int siw_skb_copy_crc(struct siw_rx_stream *srx, void *dest,
+				   unsigned int len)
 {
-	const struct skb_checksum_ops siw_cs_ops = {
-		.update = siw_csum_update,
-		.combine = siw_csum_combine,
-	};
-	__wsum crc = *(u32 *)shash_desc_ctx(srx->mpa_crc_hd);
+	struct skb_seq_state st;
+	unsigned int copied = 0, avail;
+	const u8 *data;
+
+	skb_prepare_seq_read(srx->skb, srx->skb_offset, srx->skb_offset + len,
+			     &st);
+	while ((avail = skb_seq_read(copied, &data, &st)) != 0) {
+		crypto_shash_update(srx->mpa_crc_hd, data, avail);
+		memcpy(dest + copied, data, avail);
+		copied += avail;
+	}
+	skb_abort_seq_read(&st);
 
-	crc = __skb_checksum(srx->skb, srx->skb_offset, len, crc,
-			     &siw_cs_ops);
-	*(u32 *)shash_desc_ctx(srx->mpa_crc_hd) = crc;
+	return copied == len ? 0 : -EFAULT;
 }
 
 #define siw_dbg(ibdev, fmt, ...)                                               \
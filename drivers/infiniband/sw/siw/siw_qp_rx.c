@@ -54,8 +54,18 @@ static int siw_rx_umem(struct siw_rx_stream *srx, struct siw_umem *umem,
 		siw_dbg_qp(rx_qp(srx), "page %pK, bytes=%u\n", p, bytes);
 
 		dest = kmap_atomic(p);
-		rv = skb_copy_bits(srx->skb, srx->skb_offset, dest + pg_off,
-				   bytes);
+		/*
+		 * For user memory, do the CRC on the original, not the
+		 * target buffer: some user land applications may
+		 * concurrently write the target buffer, which would yield
+		 * a broken CRC.
+		 */
+		if (srx->mpa_crc_hd &&
+		    !rdma_is_kernel_res(&rx_qp(srx)->base_qp.res))
+			rv = siw_skb_copy_crc(srx, dest + pg_off, bytes);
+		else
+			rv = skb_copy_bits(srx->skb, srx->skb_offset,
+					   dest + pg_off, bytes);
 
 		if (unlikely(rv)) {
 			kunmap_atomic(dest);
@@ -67,28 +77,11 @@ static int siw_rx_umem(struct siw_rx_stream *srx, struct siw_umem *umem,
 
 			return -EFAULT;
 		}
-		if (srx->mpa_crc_hd) {
-			if (rdma_is_kernel_res(&rx_qp(srx)->base_qp.res)) {
-				crypto_shash_update(srx->mpa_crc_hd,
-					(u8 *)(dest + pg_off), bytes);
-				kunmap_atomic(dest);
-			} else {
-				kunmap_atomic(dest);
-				/*
-				 * Do CRC on original, not target buffer.
-				 * Some user land applications may
-				 * concurrently write the target buffer,
-				 * which would yield a broken CRC.
-				 * Walking the skb twice is very ineffcient.
-				 * Folding the CRC into skb_copy_bits()
-				 * would be much better, but is currently
-				 * not supported.
-				 */
-				siw_crc_skb(srx, bytes);
-			}
-		} else {
-			kunmap_atomic(dest);
-		}
+		if (srx->mpa_crc_hd &&
+		    rdma_is_kernel_res(&rx_qp(srx)->base_qp.res))
+			crypto_shash_update(srx->mpa_crc_hd,
+				(u8 *)(dest + pg_off), bytes);
+		kunmap_atomic(dest);
 		srx->skb_offset += bytes;
 		copied += bytes;
 		len -= bytes;
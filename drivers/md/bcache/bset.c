@@ -959,6 +959,15 @@ static struct bset_search_iter bset_search_tree(struct bset_tree *t,
 	struct bkey_float *f;
 	unsigned int inorder, j, n = 1;
 
+	/*
+	 * The tree is laid out breadth first, so the 16 bkey_floats four
+	 * levels below n share one cacheline: prefetching it here means it
+	 * is resident by the time the descent gets there.
+	 *
+	 * Which child we take is computed rather than branched on - the
+	 * comparison result is random, so a branch would mispredict about
+	 * half the time at every level.
+	 */
 	do {
 		unsigned int p = n << 4;
 
@@ -968,17 +977,10 @@ static struct bset_search_iter bset_search_tree(struct bset_tree *t,
 		j = n;
 		f = &t->tree[j];
 
-		if (likely(f->exponent != 127)) {
-			if (f->mantissa >= bfloat_mantissa(search, f))
-				n = j * 2;
-			else
-				n = j * 2 + 1;
-		} else {
-			if (bkey_cmp(tree_to_bkey(t, j), search) > 0)
-				n = j * 2;
-			else
-				n = j * 2 + 1;
-		}
+		if (likely(f->exponent != 127))
+			n = j * 2 + (f->mantissa < bfloat_mantissa(search, f));
+		else
+			n = j * 2 + (bkey_cmp(tree_to_bkey(t, j), search) <= 0);
 	} while (n < t->size);
 
 	inorder = to_inorder(j, t);
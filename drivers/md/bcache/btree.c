@@ -1737,11 +1737,34 @@ static int bch_btree_gc_root(struct btree *b, struct btree_op *op,
 	return ret;
 }
 
+/*
+ * Walking every bucket of a multi-TB cache takes long enough that holding
+ * bucket_lock across it stalls foreground allocations; the bucket walks in
+ * gc start and finish drop it every GC_BUCKET_BATCH buckets.
+ *
+ * That is safe because gc_mark_valid is clear for the whole walk, so the
+ * allocator thread won't invalidate buckets, and buckets handed out of the
+ * free fifos or freed in between are pinned or already have their final
+ * mark.
+ */
+#define GC_BUCKET_BATCH		4096
+
+static void gc_bucket_lock_break(struct cache_set *c, size_t *nr)
+{
+	if (++*nr % GC_BUCKET_BATCH)
+		return;
+
+	mutex_unlock(&c->bucket_lock);
+	cond_resched();
+	mutex_lock(&c->bucket_lock);
+}
+
 static void btree_gc_start(struct cache_set *c)
 {
 	struct cache *ca;
 	struct bucket *b;
 	unsigned int i;
+	size_t nr = 0;
 
 	if (!c->gc_mark_valid)
 		return;
@@ -1758,6 +1781,7 @@ static void btree_gc_start(struct cache_set *c)
 				SET_GC_MARK(b, 0);
 				SET_GC_SECTORS_USED(b, 0);
 			}
+			gc_bucket_lock_break(c, &nr);
 		}
 
 	mutex_unlock(&c->bucket_lock);
@@ -1768,12 +1792,12 @@ static void bch_btree_gc_finish(struct cache_set *c)
 	struct bucket *b;
 	struct cache *ca;
 	unsigned int i;
+	size_t nr = 0, avail = 0;
+	uint8_t need_gc = 0;
 
 	mutex_lock(&c->bucket_lock);
 
 	set_gc_sectors(c);
-	c->gc_mark_valid = 1;
-	c->need_gc	= 0;
 
 	for (i = 0; i < KEY_PTRS(&c->uuid_bucket); i++)
 		SET_GC_MARK(PTR_BUCKET(c, &c->uuid_bucket, i),
@@ -1801,7 +1825,6 @@ static void bch_btree_gc_finish(struct cache_set *c)
 	}
 	rcu_read_unlock();
 
-	c->avail_nbuckets = 0;
 	for_each_cache(ca, c, i) {
 		uint64_t *i;
 
@@ -1815,7 +1838,8 @@ static void bch_btree_gc_finish(struct cache_set *c)
 			SET_GC_MARK(ca->buckets + *i, GC_MARK_METADATA);
 
 		for_each_bucket(b, ca) {
-			c->need_gc	= max(c->need_gc, bucket_gc_gen(b));
+			need_gc = max(need_gc, bucket_gc_gen(b));
+			gc_bucket_lock_break(c, &nr);
 
 			if (atomic_read(&b->pin))
 				continue;
@@ -1823,10 +1847,14 @@ static void bch_btree_gc_finish(struct cache_set *c)
 			BUG_ON(!GC_MARK(b) && GC_SECTORS_USED(b));
 
 			if (!GC_MARK(b) || GC_MARK(b) == GC_MARK_RECLAIMABLE)
-				c->avail_nbuckets++;
+				avail++;
 		}
 	}
 
+	c->avail_nbuckets = avail;
+	c->need_gc	= need_gc;
+	c->gc_mark_valid = 1;
+
 	mutex_unlock(&c->bucket_lock);
 }
 
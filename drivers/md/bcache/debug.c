@@ -15,6 +15,7 @@
 #include <linux/debugfs.h>
 #include <linux/module.h>
 #include <linux/random.h>
+#include <linux/sched/clock.h>
 #include <linux/seq_file.h>
 
 struct dentry *bcache_debug;
@@ -150,6 +151,93 @@ void bch_data_verify(struct cached_dev *dc, struct bio *bio)
 	bio_put(check);
 }
 
+/*
+ * Microbenchmark for bch_bset_search(): fills a scratch btree node with
+ * one written bset of back to back extents, builds its auxiliary search
+ * tree and times random lookups against it. Every result is checked, so
+ * this doubles as a test of the search tree. Run it by reading
+ * bcache/bset_search_bench in debugfs.
+ */
+#define BSET_BENCH_PAGE_ORDER	6
+#define BSET_BENCH_SEARCHES	(1 << 20)
+#define BSET_BENCH_OFFSETS	4096
+
+static int bset_search_bench_show(struct seq_file *m, void *v)
+{
+	struct btree_keys *b;
+	struct bset *i;
+	struct bkey *k;
+	uint32_t *offsets;
+	unsigned int nr_keys = 0, errors = 0, n;
+	bool expensive_checks = false;
+	u64 start, elapsed;
+	int ret = -ENOMEM;
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	offsets = kmalloc_array(BSET_BENCH_OFFSETS, sizeof(*offsets),
+				GFP_KERNEL);
+	if (!b || !offsets)
+		goto out;
+
+	bch_btree_keys_init(b, &bch_extent_keys_ops, &expensive_checks);
+	if (bch_btree_keys_alloc(b, BSET_BENCH_PAGE_ORDER, GFP_KERNEL))
+		goto out;
+
+	i = b->set->data;
+	bch_bset_init_next(b, i, 0);
+
+	/* Key n covers sectors [n * 8, (n + 1) * 8) of inode 1 */
+	for (k = i->start;
+	     (void *) k + sizeof(struct bkey) <=
+	     (void *) i + (PAGE_SIZE << BSET_BENCH_PAGE_ORDER);
+	     k = bkey_next(k)) {
+		bkey_copy(k, &KEY(1, (nr_keys + 1) * 8, 8));
+		i->keys += bkey_u64s(k);
+		nr_keys++;
+	}
+
+	bch_bset_build_written_tree(b);
+
+	for (n = 0; n < BSET_BENCH_OFFSETS; n++)
+		offsets[n] = prandom_u32() % (nr_keys * 8);
+
+	start = local_clock();
+	for (n = 0; n < BSET_BENCH_SEARCHES; n++) {
+		uint32_t offset = offsets[n % BSET_BENCH_OFFSETS];
+
+		k = bch_bset_search(b, b->set, &KEY(1, offset, 0));
+		if (k == bset_bkey_last(i) ||
+		    KEY_OFFSET(k) != (offset / 8 + 1) * 8)
+			errors++;
+	}
+	elapsed = local_clock() - start;
+
+	seq_printf(m, "keys:\t\t%u\n", nr_keys);
+	seq_printf(m, "tree nodes:\t%u\n", b->set->size);
+	seq_printf(m, "searches:\t%u\n", BSET_BENCH_SEARCHES);
+	seq_printf(m, "ns/search:\t%llu\n",
+		   div_u64(elapsed, BSET_BENCH_SEARCHES));
+	seq_printf(m, "errors:\t\t%u\n", errors);
+	ret = 0;
+
+	bch_btree_keys_free(b);
+out:
+	kfree(offsets);
+	kfree(b);
+	return ret;
+}
+DEFINE_SHOW_ATTRIBUTE(bset_search_bench);
+
+static void bch_debug_init_bench(void)
+{
+	debugfs_create_file("bset_search_bench", 0400, bcache_debug, NULL,
+			    &bset_search_bench_fops);
+}
+
+#else
+
+static void bch_debug_init_bench(void) {}
+
 #endif
 
 #ifdef CONFIG_DEBUG_FS
@@ -259,4 +347,5 @@ void __init bch_debug_init(void)
 	 * about this.
 	 */
 	bcache_debug = debugfs_create_dir("bcache", NULL);
+	bch_debug_init_bench();
 }
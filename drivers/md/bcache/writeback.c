@@ -232,14 +232,51 @@ static void update_writeback_rate(struct work_struct *work)
 	smp_mb();
 }
 
+/*
+ * Number of foreground requests in flight on the bcache device. Writeback
+ * bios are submitted to the backing device directly and aren't counted.
+ */
+static unsigned int writeback_fg_in_flight(struct cached_dev *dc)
+{
+	struct hd_struct *part = &dc->disk.disk->part0;
+	unsigned int inflight = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		inflight += part_stat_local_read_cpu(part, in_flight[0], cpu) +
+			    part_stat_local_read_cpu(part, in_flight[1], cpu);
+
+	return inflight;
+}
+
 static unsigned int writeback_delay(struct cached_dev *dc,
 				    unsigned int sectors)
 {
+	unsigned int delay;
+
 	if (test_bit(BCACHE_DEV_DETACHING, &dc->disk.flags) ||
 	    !dc->writeback_percent)
 		return 0;
 
-	return bch_next_delay(&dc->writeback_rate, sectors);
+	delay = bch_next_delay(&dc->writeback_rate, sectors);
+
+	/*
+	 * The rate limit exists to keep writeback from competing with
+	 * foreground IO; if there is none queued, don't hold back.
+	 */
+	return writeback_fg_in_flight(dc) ? delay : 0;
+}
+
+/*
+ * Keys come out of the keybuf in backing device order. Writes within a
+ * pass are issued to the backing device in that order too, so keys with
+ * only a small hole between them still make for a sequential stream.
+ */
+static bool writeback_keys_close(struct bkey *prev, struct bkey *next)
+{
+	return KEY_INODE(prev) == KEY_INODE(next) &&
+		KEY_START(next) >= KEY_OFFSET(prev) &&
+		KEY_START(next) - KEY_OFFSET(prev) <= WRITEBACK_MERGE_GAP;
 }
 
 struct dirty_io {
@@ -397,9 +434,9 @@ static void read_dirty_submit(struct closure *cl)
 static void read_dirty(struct cached_dev *dc)
 {
 	unsigned int delay = 0;
-	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_PASS], *w;
-	size_t size;
-	int nk, i;
+	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_IDLE_PASS], *w;
+	size_t size, max_size;
+	int nk, max_nk, i;
 	struct dirty_io *io;
 	struct closure cl;
 	uint16_t sequence = 0;
@@ -421,6 +458,18 @@ static void read_dirty(struct cached_dev *dc)
 		size = 0;
 		nk = 0;
 
+		/*
+		 * With the backing device otherwise idle, gather a larger
+		 * window so it sees fewer, longer sequential runs.
+		 */
+		if (writeback_fg_in_flight(dc)) {
+			max_nk = MAX_WRITEBACKS_IN_PASS;
+			max_size = MAX_WRITESIZE_IN_PASS;
+		} else {
+			max_nk = MAX_WRITEBACKS_IN_IDLE_PASS;
+			max_size = MAX_WRITESIZE_IN_IDLE_PASS;
+		}
+
 		do {
 			BUG_ON(ptr_stale(dc->disk.c, &next->key, 0));
 
@@ -428,34 +477,29 @@ static void read_dirty(struct cached_dev *dc)
 			 * Don't combine too many operations, even if they
 			 * are all small.
 			 */
-			if (nk >= MAX_WRITEBACKS_IN_PASS)
+			if (nk >= max_nk)
 				break;
 
 			/*
 			 * If the current operation is very large, don't
 			 * further combine operations.
 			 */
-			if (size >= MAX_WRITESIZE_IN_PASS)
+			if (size >= max_size)
 				break;
 
 			/*
 			 * Operations are only eligible to be combined
-			 * if they are contiguous.
-			 *
-			 * TODO: add a heuristic willing to fire a
-			 * certain amount of non-contiguous IO per pass,
-			 * so that we can benefit from backing device
-			 * command queueing.
+			 * if they are contiguous, or nearly so.
 			 */
-			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
-						&START_KEY(&next->key)))
+			if ((nk != 0) && !writeback_keys_close(&keys[nk-1]->key,
+							       &next->key))
 				break;
 
 			size += KEY_SIZE(&next->key);
 			keys[nk++] = next;
 		} while ((next = bch_keybuf_next(&dc->writeback_keys)));
 
-		/* Now we have gathered a set of 1..5 keys to write back. */
+		/* Now we have gathered a set of 1..max_nk keys to write back. */
 		for (i = 0; i < nk; i++) {
 			w = keys[i];
 
@@ -11,6 +11,13 @@
 #define MAX_WRITEBACKS_IN_PASS  5
 #define MAX_WRITESIZE_IN_PASS   5000	/* *512b */
 
+/* Pass limits while nothing but writeback is queued on the device */
+#define MAX_WRITEBACKS_IN_IDLE_PASS	32
+#define MAX_WRITESIZE_IN_IDLE_PASS	32768	/* *512b */
+
+/* Largest hole between two keys that are still written in one pass */
+#define WRITEBACK_MERGE_GAP	256	/* *512b */
+
 #define WRITEBACK_RATE_UPDATE_SECS_MAX		60
 #define WRITEBACK_RATE_UPDATE_SECS_DEFAULT	5
 
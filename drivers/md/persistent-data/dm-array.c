@@ -8,6 +8,7 @@
 #include "dm-space-map.h"
 #include "dm-transaction-manager.h"
 
+#include <linux/bitmap.h>
 #include <linux/export.h>
 #include <linux/device-mapper.h>
 
@@ -368,15 +369,43 @@ static int insert_new_ablock(struct dm_array_info *info, size_t size_of_block,
 	return r;
 }
 
+/*
+ * The new blocks of a growing array are inserted into the btree in
+ * batches of this many, in ascending order, so that most of them go
+ * straight into the btree leaf the previous one went into.
+ */
+#define INSERT_BATCH 16
+
 static int insert_full_ablocks(struct dm_array_info *info, size_t size_of_block,
 			       unsigned begin_block, unsigned end_block,
 			       unsigned max_entries, const void *value,
 			       dm_block_t *root)
 {
 	int r = 0;
+	unsigned nr;
+	uint64_t key, block_keys[INSERT_BATCH];
+	__le64 blocks_le[INSERT_BATCH];
+	struct dm_block *block;
+	struct array_block *ab;
 
-	for (; !r && begin_block != end_block; begin_block++)
-		r = insert_new_ablock(info, size_of_block, max_entries, begin_block, max_entries, value, root);
+	while (!r && begin_block != end_block) {
+		for (nr = 0; nr < INSERT_BATCH && begin_block != end_block;
+		     nr++, begin_block++) {
+			r = alloc_ablock(info, size_of_block, max_entries,
+					 &block, &ab);
+			if (r)
+				return r;
+
+			fill_ablock(info, ab, value, max_entries);
+			block_keys[nr] = begin_block;
+			blocks_le[nr] = cpu_to_le64(dm_block_location(block));
+			unlock_ablock(info, block);
+		}
+
+		__dm_bless_for_disk(blocks_le);
+		r = dm_btree_insert_many(&info->btree_info, *root, &key,
+					 block_keys, blocks_le, nr, root, NULL);
+	}
 
 	return r;
 }
@@ -852,26 +881,22 @@ struct walk_info {
 	void *context;
 };
 
-static int walk_ablock(void *context, uint64_t *keys, void *leaf)
+static int walk_ablock(struct walk_info *wi, uint64_t index, dm_block_t b)
 {
-	struct walk_info *wi = context;
-
-	int r;
+	int r = 0;
 	unsigned i;
-	__le64 block_le;
 	unsigned nr_entries, max_entries;
 	struct dm_block *block;
 	struct array_block *ab;
 
-	memcpy(&block_le, leaf, sizeof(block_le));
-	r = get_ablock(wi->info, le64_to_cpu(block_le), &block, &ab);
+	r = get_ablock(wi->info, b, &block, &ab);
 	if (r)
 		return r;
 
 	max_entries = le32_to_cpu(ab->max_entries);
 	nr_entries = le32_to_cpu(ab->nr_entries);
 	for (i = 0; i < nr_entries; i++) {
-		r = wi->fn(wi->context, keys[0] * max_entries + i,
+		r = wi->fn(wi->context, index * max_entries + i,
 			   element_at(wi->info, ab, i));
 
 		if (r)
@@ -882,17 +907,61 @@ static int walk_ablock(void *context, uint64_t *keys, void *leaf)
 	return r;
 }
 
+/*
+ * The array blocks are looked up in runs of this many, and each run is
+ * prefetched before it is walked.
+ */
+#define WALK_BATCH 16
+
 int dm_array_walk(struct dm_array_info *info, dm_block_t root,
 		  int (*fn)(void *, uint64_t key, void *leaf),
 		  void *context)
 {
+	int r;
+	unsigned i, nr;
 	struct walk_info wi;
+	uint64_t begin, key, block_keys[WALK_BATCH];
+	__le64 blocks_le[WALK_BATCH];
+	dm_block_t blocks[WALK_BATCH];
+	DECLARE_BITMAP(found, WALK_BATCH);
 
 	wi.info = info;
 	wi.fn = fn;
 	wi.context = context;
 
-	return dm_btree_walk(&info->btree_info, root, walk_ablock, &wi);
+	/*
+	 * The btree is fully populated, so the array ends at the first
+	 * index that is missing.
+	 */
+	for (begin = 0;; begin += WALK_BATCH) {
+		for (i = 0; i < WALK_BATCH; i++)
+			block_keys[i] = begin + i;
+
+		r = dm_btree_lookup_many(&info->btree_info, root, &key,
+					 block_keys, WALK_BATCH, blocks_le,
+					 found);
+		if (r)
+			return r;
+
+		nr = find_first_zero_bit(found, WALK_BATCH);
+		if (!nr)
+			return 0;
+
+		for (i = 0; i < nr; i++)
+			blocks[i] = le64_to_cpu(blocks_le[i]);
+		dm_bm_prefetch_blocks(dm_tm_get_bm(info->btree_info.tm),
+				      blocks, nr);
+
+		for (i = 0; i < nr; i++) {
+			r = walk_ablock(&wi, begin + i,
+					le64_to_cpu(blocks_le[i]));
+			if (r)
+				return r;
+		}
+
+		if (nr < WALK_BATCH)
+			return 0;
+	}
 }
 EXPORT_SYMBOL_GPL(dm_array_walk);
 
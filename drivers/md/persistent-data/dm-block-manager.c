@@ -14,6 +14,7 @@
 #include <linux/device-mapper.h>
 #include <linux/stacktrace.h>
 #include <linux/sched/task.h>
+#include <linux/sort.h>
 
 #define DM_MSG_PREFIX "block manager"
 
@@ -614,6 +615,32 @@ void dm_bm_prefetch(struct dm_block_manager *bm, dm_block_t b)
 	dm_bufio_prefetch(bm->bufio, b, 1);
 }
 
+static int cmp_block(const void *lhs, const void *rhs)
+{
+	dm_block_t l = *(const dm_block_t *)lhs, r = *(const dm_block_t *)rhs;
+
+	if (l < r)
+		return -1;
+	return l > r;
+}
+
+void dm_bm_prefetch_blocks(struct dm_block_manager *bm, dm_block_t *blocks,
+			   unsigned nr)
+{
+	unsigned i, start = 0;
+
+	sort(blocks, nr, sizeof(*blocks), cmp_block, NULL);
+	for (i = 1; i <= nr; i++) {
+		/* duplicates and neighbours extend the current run */
+		if (i < nr && blocks[i] <= blocks[i - 1] + 1)
+			continue;
+
+		dm_bufio_prefetch(bm->bufio, blocks[start],
+				  blocks[i - 1] - blocks[start] + 1);
+		start = i;
+	}
+}
+
 bool dm_bm_is_read_only(struct dm_block_manager *bm)
 {
 	return bm->read_only;
@@ -112,6 +112,13 @@ int dm_bm_flush(struct dm_block_manager *bm);
  */
 void dm_bm_prefetch(struct dm_block_manager *bm, dm_block_t b);
 
+/*
+ * Prefetch several blocks.  @blocks is sorted in place so that runs of
+ * adjacent blocks are requested with a single read.
+ */
+void dm_bm_prefetch_blocks(struct dm_block_manager *bm, dm_block_t *blocks,
+			   unsigned nr);
+
 /*
  * Switches the bm to a read only mode.  Once read-only mode
  * has been entered the following functions will return -EPERM.
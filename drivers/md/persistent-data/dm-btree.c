@@ -8,6 +8,7 @@
 #include "dm-space-map.h"
 #include "dm-transaction-manager.h"
 
+#include <linux/bitmap.h>
 #include <linux/export.h>
 #include <linux/device-mapper.h>
 
@@ -416,6 +417,137 @@ int dm_btree_lookup(struct dm_btree_info *info, dm_block_t root,
 }
 EXPORT_SYMBOL_GPL(dm_btree_lookup);
 
+/*
+ * Sorted runs of keys: the number of upcoming keys whose children get
+ * prefetched while walking an internal node.
+ */
+#define RUN_PREFETCH 16
+
+/*
+ * Prefetch the children of @n, other than child @index which is about to
+ * be visited, that the next @nr keys of an ascending run will descend into.
+ */
+static void prefetch_run_children(struct dm_btree_info *info,
+				  struct btree_node *n, int index,
+				  const uint64_t *keys, unsigned nr)
+{
+	dm_block_t blocks[RUN_PREFETCH];
+	unsigned i, count = 0;
+	int child, last = index;
+
+	if (!(le32_to_cpu(n->header.flags) & INTERNAL_NODE))
+		return;
+
+	nr = min_t(unsigned, nr, RUN_PREFETCH);
+	for (i = 0; i < nr; i++) {
+		child = lower_bound(n, keys[i]);
+		if (child <= last)
+			continue;
+		blocks[count++] = value64(n, child);
+		last = child;
+	}
+
+	if (count)
+		dm_bm_prefetch_blocks(dm_tm_get_bm(info->tm), blocks, count);
+}
+
+/*
+ * Walk a single level tree down to the leaf that would hold @key.
+ */
+static int btree_lookup_leaf(struct ro_spine *s, dm_block_t block,
+			     uint64_t key, const uint64_t *next_keys,
+			     unsigned nr_next)
+{
+	int i, r;
+
+	for (;;) {
+		r = ro_step(s, block);
+		if (r < 0)
+			return r;
+
+		if (le32_to_cpu(ro_node(s)->header.flags) & LEAF_NODE)
+			return 0;
+
+		i = lower_bound(ro_node(s), key);
+		if (i < 0)
+			return -ENODATA;
+
+		prefetch_run_children(s->info, ro_node(s), i, next_keys,
+				      nr_next);
+		block = value64(ro_node(s), i);
+	}
+}
+
+/* Can the presence of @key be decided from leaf @n alone? */
+static bool leaf_covers(struct btree_node *n, uint64_t key)
+{
+	uint32_t nr_entries = le32_to_cpu(n->header.nr_entries);
+
+	return nr_entries &&
+		key >= le64_to_cpu(n->keys[0]) &&
+		key <= le64_to_cpu(n->keys[nr_entries - 1]);
+}
+
+int dm_btree_lookup_many(struct dm_btree_info *info, dm_block_t root,
+			 uint64_t *keys, const uint64_t *bottom_keys,
+			 unsigned nr, void *values_le, unsigned long *found)
+{
+	size_t value_size = info->value_type.size;
+	struct ro_spine spine;
+	struct btree_node *n;
+	bool have_leaf = false;
+	unsigned i;
+	int index, r;
+
+	bitmap_zero(found, nr);
+
+	/* find the bottom level tree holding the run */
+	if (info->levels > 1) {
+		struct dm_btree_info upper = *info;
+		__le64 root_le;
+
+		upper.levels = info->levels - 1;
+		upper.value_type.size = sizeof(root_le);
+		r = dm_btree_lookup(&upper, root, keys, &root_le);
+		if (r)
+			return r == -ENODATA ? 0 : r;
+		root = le64_to_cpu(root_le);
+	}
+
+	init_ro_spine(&spine, info);
+	for (i = 0; i < nr; i++) {
+		uint64_t key = bottom_keys[i];
+
+		if (!have_leaf || !leaf_covers(ro_node(&spine), key)) {
+			exit_ro_spine(&spine);
+			init_ro_spine(&spine, info);
+			have_leaf = false;
+
+			r = btree_lookup_leaf(&spine, root, key,
+					      bottom_keys + i + 1, nr - i - 1);
+			if (r == -ENODATA)
+				continue;
+			if (r)
+				goto out;
+			have_leaf = true;
+		}
+
+		n = ro_node(&spine);
+		index = lower_bound(n, key);
+		if (index >= 0 && index < le32_to_cpu(n->header.nr_entries) &&
+		    le64_to_cpu(n->keys[index]) == key) {
+			memcpy(values_le + i * value_size, value_ptr(n, index),
+			       value_size);
+			__set_bit(i, found);
+		}
+	}
+	r = 0;
+out:
+	exit_ro_spine(&spine);
+	return r;
+}
+EXPORT_SYMBOL_GPL(dm_btree_lookup_many);
+
 static int dm_btree_lookup_next_single(struct dm_btree_info *info, dm_block_t root,
 				       uint64_t key, uint64_t *rkey, void *value_le)
 {
@@ -689,12 +821,19 @@ static int btree_split_beneath(struct shadow_spine *s, uint64_t key)
 	return 0;
 }
 
+/*
+ * Walks down to the leaf @key belongs in, splitting full nodes on the way.
+ * If @upper is given, it is set to the lowest separator above @key on the
+ * path, i.e. the first key that no longer belongs in the leaf, or to
+ * U64_MAX if the leaf is the last one of the tree.
+ */
 static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 			    struct dm_btree_value_type *vt,
-			    uint64_t key, unsigned *index)
+			    uint64_t key, unsigned *index, uint64_t *upper)
 {
 	int r, i = *index, top = 1;
-	struct btree_node *node;
+	uint64_t bound = U64_MAX, parent_bound = U64_MAX;
+	struct btree_node *node, *parent;
 
 	for (;;) {
 		r = shadow_step(s, root, vt);
@@ -726,6 +865,15 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 
 			if (r < 0)
 				return r;
+
+			/* a sibling split adds a separator to the parent */
+			if (!top) {
+				parent = dm_block_data(shadow_parent(s));
+				i = lower_bound(parent, key);
+				bound = i + 1 < le32_to_cpu(parent->header.nr_entries) ?
+					le64_to_cpu(parent->keys[i + 1]) :
+					parent_bound;
+			}
 		}
 
 		node = dm_block_data(shadow_current(s));
@@ -741,6 +889,10 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 			i = 0;
 		}
 
+		parent_bound = bound;
+		if (i + 1 < le32_to_cpu(node->header.nr_entries))
+			bound = le64_to_cpu(node->keys[i + 1]);
+
 		root = value64(node, i);
 		top = 0;
 	}
@@ -749,6 +901,8 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 		i++;
 
 	*index = i;
+	if (upper)
+		*upper = bound;
 	return 0;
 }
 
@@ -759,27 +913,64 @@ static bool need_insert(struct btree_node *node, uint64_t *keys,
 		(le64_to_cpu(node->keys[index]) != keys[level]));
 }
 
-static int insert(struct dm_btree_info *info, dm_block_t root,
-		  uint64_t *keys, void *value, dm_block_t *new_root,
-		  int *inserted)
-		  __dm_written_to_disk(value)
+/*
+ * Store @value for @key at @index of leaf @n, which btree_insert_raw() or
+ * the caller has established is where @key belongs.
+ */
+static int insert_into_leaf(struct dm_btree_info *info, struct btree_node *n,
+			    unsigned index, uint64_t key, void *value,
+			    int *inserted)
+			    __dm_written_to_disk(value)
+{
+	if (need_insert(n, &key, 0, index)) {
+		if (inserted)
+			*inserted = 1;
+
+		return insert_at(info->value_type.size, n, index, key, value);
+	}
+
+	if (inserted)
+		*inserted = 0;
+
+	if (info->value_type.dec &&
+	    (!info->value_type.equal ||
+	     !info->value_type.equal(
+		     info->value_type.context,
+		     value_ptr(n, index),
+		     value))) {
+		info->value_type.dec(info->value_type.context,
+				     value_ptr(n, index));
+	}
+	memcpy_disk(value_ptr(n, index),
+		    value, info->value_type.size);
+	return 0;
+}
+
+/*
+ * Insert one value, walking down from @root with @spine.  On success the
+ * spine still holds the shadowed leaf that @value went into, and *@upper,
+ * if given, is the first key beyond that leaf as for btree_insert_raw().
+ */
+static int insert_walk(struct dm_btree_info *info, struct shadow_spine *spine,
+		       dm_block_t root, uint64_t *keys, void *value,
+		       int *inserted, uint64_t *upper)
+		       __dm_written_to_disk(value)
 {
 	int r;
 	unsigned level, index = -1, last_level = info->levels - 1;
 	dm_block_t block = root;
-	struct shadow_spine spine;
 	struct btree_node *n;
 	struct dm_btree_value_type le64_type;
 
 	init_le64_type(info->tm, &le64_type);
-	init_shadow_spine(&spine, info);
 
 	for (level = 0; level < (info->levels - 1); level++) {
-		r = btree_insert_raw(&spine, block, &le64_type, keys[level], &index);
+		r = btree_insert_raw(spine, block, &le64_type, keys[level], &index,
+				     NULL);
 		if (r < 0)
 			goto bad;
 
-		n = dm_block_data(shadow_current(&spine));
+		n = dm_block_data(shadow_current(spine));
 
 		if (need_insert(n, keys, level, index)) {
 			dm_block_t new_tree;
@@ -802,47 +993,34 @@ static int insert(struct dm_btree_info *info, dm_block_t root,
 			block = value64(n, index);
 	}
 
-	r = btree_insert_raw(&spine, block, &info->value_type,
-			     keys[level], &index);
+	r = btree_insert_raw(spine, block, &info->value_type,
+			     keys[level], &index, upper);
 	if (r < 0)
 		goto bad;
 
-	n = dm_block_data(shadow_current(&spine));
+	n = dm_block_data(shadow_current(spine));
 
-	if (need_insert(n, keys, level, index)) {
-		if (inserted)
-			*inserted = 1;
-
-		r = insert_at(info->value_type.size, n, index,
-			      keys[level], value);
-		if (r)
-			goto bad_unblessed;
-	} else {
-		if (inserted)
-			*inserted = 0;
-
-		if (info->value_type.dec &&
-		    (!info->value_type.equal ||
-		     !info->value_type.equal(
-			     info->value_type.context,
-			     value_ptr(n, index),
-			     value))) {
-			info->value_type.dec(info->value_type.context,
-					     value_ptr(n, index));
-		}
-		memcpy_disk(value_ptr(n, index),
-			    value, info->value_type.size);
-	}
-
-	*new_root = shadow_root(&spine);
-	exit_shadow_spine(&spine);
-
-	return 0;
+	return insert_into_leaf(info, n, index, keys[level], value, inserted);
 
 bad:
 	__dm_unbless_for_disk(value);
-bad_unblessed:
+	return r;
+}
+
+static int insert(struct dm_btree_info *info, dm_block_t root,
+		  uint64_t *keys, void *value, dm_block_t *new_root,
+		  int *inserted)
+		  __dm_written_to_disk(value)
+{
+	struct shadow_spine spine;
+	int r;
+
+	init_shadow_spine(&spine, info);
+	r = insert_walk(info, &spine, root, keys, value, inserted, NULL);
+	if (!r)
+		*new_root = shadow_root(&spine);
 	exit_shadow_spine(&spine);
+
 	return r;
 }
 
@@ -863,6 +1041,82 @@ int dm_btree_insert_notify(struct dm_btree_info *info, dm_block_t root,
 }
 EXPORT_SYMBOL_GPL(dm_btree_insert_notify);
 
+int dm_btree_insert_many(struct dm_btree_info *info, dm_block_t root,
+			 uint64_t *keys, const uint64_t *bottom_keys,
+			 void *values, unsigned nr, dm_block_t *new_root,
+			 unsigned *nr_inserted)
+			 __dm_written_to_disk(values)
+{
+	unsigned i, last_level = info->levels - 1;
+	size_t value_size = info->value_type.size;
+	struct shadow_spine spine;
+	bool walked = false;
+	uint64_t upper = 0;
+	int r = 0, inserted;
+
+	init_shadow_spine(&spine, info);
+	for (i = 0; i < nr; i++) {
+		void *value = values + i * value_size;
+		uint64_t key = bottom_keys[i];
+		struct btree_node *n, *p;
+		int index;
+
+		/*
+		 * The leaf the previous key went into is still shadowed and
+		 * locked in the spine.  If this key belongs to the same leaf
+		 * and there is room, put it there without walking again.
+		 */
+		if (walked && key >= bottom_keys[i - 1] && key < upper) {
+			n = dm_block_data(shadow_current(&spine));
+			if (le32_to_cpu(n->header.nr_entries) <
+			    le32_to_cpu(n->header.max_entries)) {
+				index = lower_bound(n, key);
+				if (index < 0 || le64_to_cpu(n->keys[index]) != key)
+					index++;
+				r = insert_into_leaf(info, n, index, key, value,
+						     &inserted);
+				goto next;
+			}
+		}
+
+		if (walked) {
+			root = shadow_root(&spine);
+			exit_shadow_spine(&spine);
+			init_shadow_spine(&spine, info);
+		}
+
+		keys[last_level] = key;
+		/*
+		 * The leaf takes keys up to the lowest separator above it on
+		 * the path, so the last leaf of the tree, the one an ascending
+		 * append keeps hitting, takes anything.
+		 */
+		r = insert_walk(info, &spine, root, keys, value, &inserted,
+				&upper);
+		if (r)
+			break;
+		walked = true;
+
+		if (shadow_has_parent(&spine)) {
+			p = dm_block_data(shadow_parent(&spine));
+			prefetch_run_children(info, p, lower_bound(p, key),
+					      bottom_keys + i + 1, nr - i - 1);
+		}
+next:
+		if (r)
+			break;
+		if (inserted && nr_inserted)
+			(*nr_inserted)++;
+	}
+
+	if (!r)
+		*new_root = walked ? shadow_root(&spine) : root;
+	exit_shadow_spine(&spine);
+
+	return r;
+}
+EXPORT_SYMBOL_GPL(dm_btree_insert_many);
+
 /*----------------------------------------------------------------*/
 
 static int find_key(struct ro_spine *s, dm_block_t block, bool find_highest,
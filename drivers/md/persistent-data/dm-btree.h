@@ -109,6 +109,18 @@ int dm_btree_del(struct dm_btree_info *info, dm_block_t root);
 int dm_btree_lookup(struct dm_btree_info *info, dm_block_t root,
 		    uint64_t *keys, void *value_le);
 
+/*
+ * Looks up a run of keys which only differ in the bottom level: keys[]
+ * holds the upper level keys as for dm_btree_lookup(), bottom_keys[] @nr
+ * ascending bottom level keys.  The value of each key found is stored in
+ * the matching slot of @values_le and its bit set in @found.  Consecutive
+ * keys in the same leaf are looked up without walking the tree again and
+ * the nodes further keys will need are prefetched.
+ */
+int dm_btree_lookup_many(struct dm_btree_info *info, dm_block_t root,
+			 uint64_t *keys, const uint64_t *bottom_keys,
+			 unsigned nr, void *values_le, unsigned long *found);
+
 /*
  * Tries to find the first key where the bottom level key is >= to that
  * given.  Useful for skipping empty sections of the btree.
@@ -133,6 +145,20 @@ int dm_btree_insert_notify(struct dm_btree_info *info, dm_block_t root,
 			   int *inserted)
 			   __dm_written_to_disk(value);
 
+/*
+ * Inserts (or overwrites) a run of @nr values whose keys only differ in the
+ * bottom level, like dm_btree_lookup_many().  keys[info->levels - 1] is
+ * used as scratch space.  While the keys ascend, values landing in the leaf
+ * the previous one went into are stored without walking the tree again.
+ * The number of new entries is added to *@nr_inserted if given.  On
+ * failure the transaction must be aborted, as with dm_btree_insert().
+ */
+int dm_btree_insert_many(struct dm_btree_info *info, dm_block_t root,
+			 uint64_t *keys, const uint64_t *bottom_keys,
+			 void *values, unsigned nr, dm_block_t *new_root,
+			 unsigned *nr_inserted)
+			 __dm_written_to_disk(values);
+
 /*
  * Remove a key if present.  This doesn't remove empty sub trees.  Normally
  * subtrees represent a separate entity, like a snapshot map, so this is
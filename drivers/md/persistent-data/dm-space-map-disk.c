@@ -10,6 +10,7 @@
 #include "dm-transaction-manager.h"
 
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/slab.h>
 #include <linux/export.h>
 #include <linux/device-mapper.h>
@@ -18,6 +19,22 @@
 
 /*----------------------------------------------------------------*/
 
+/*
+ * Reference count changes made during a transaction are held in memory,
+ * keyed by block, and written to the bitmaps and the ref count btree in
+ * one sorted pass when the transaction commits.  A block that is shared
+ * and then released again within a transaction never touches the on-disk
+ * structures at all.
+ */
+#define MAX_DELTAS 65536
+
+struct sm_delta {
+	struct rb_node node;
+	dm_block_t b;
+	uint32_t disk_count;	/* count held by ll when the delta was made */
+	uint32_t count;		/* count as seen by this transaction */
+};
+
 /*
  * Space map interface.
  */
@@ -29,12 +46,158 @@ struct sm_disk {
 
 	dm_block_t begin;
 	dm_block_t nr_allocated_this_transaction;
+
+	struct rb_root deltas;
+	unsigned nr_deltas;
 };
 
+static struct sm_delta *delta_find(struct sm_disk *smd, dm_block_t b)
+{
+	struct rb_node *n = smd->deltas.rb_node;
+
+	while (n) {
+		struct sm_delta *d = rb_entry(n, struct sm_delta, node);
+
+		if (b < d->b)
+			n = n->rb_left;
+		else if (b > d->b)
+			n = n->rb_right;
+		else
+			return d;
+	}
+
+	return NULL;
+}
+
+static void delta_insert(struct sm_disk *smd, struct sm_delta *d)
+{
+	struct rb_node **new = &smd->deltas.rb_node, *parent = NULL;
+
+	while (*new) {
+		struct sm_delta *tmp = rb_entry(*new, struct sm_delta, node);
+
+		parent = *new;
+		if (d->b < tmp->b)
+			new = &(*new)->rb_left;
+		else
+			new = &(*new)->rb_right;
+	}
+
+	rb_link_node(&d->node, parent, new);
+	rb_insert_color(&d->node, &smd->deltas);
+	smd->nr_deltas++;
+}
+
+static void delta_free_all(struct sm_disk *smd)
+{
+	struct sm_delta *d, *tmp;
+
+	rbtree_postorder_for_each_entry_safe(d, tmp, &smd->deltas, node)
+		kfree(d);
+
+	smd->deltas = RB_ROOT;
+	smd->nr_deltas = 0;
+}
+
+/*
+ * Writes the buffered counts to the ll, in block order so consecutive
+ * blocks share bitmap and ref count btree shadows.
+ */
+static int delta_flush(struct sm_disk *smd)
+{
+	int r;
+	struct rb_node *n;
+	enum allocation_event ev;
+
+	while ((n = rb_first(&smd->deltas))) {
+		struct sm_delta *d = rb_entry(n, struct sm_delta, node);
+
+		if (d->count != d->disk_count) {
+			r = sm_ll_insert(&smd->ll, d->b, d->count, &ev);
+			if (r)
+				return r;
+		}
+
+		rb_erase(n, &smd->deltas);
+		smd->nr_deltas--;
+		kfree(d);
+	}
+
+	return 0;
+}
+
+static int delta_get(struct sm_disk *smd, dm_block_t b, struct sm_delta **result)
+{
+	int r;
+	struct sm_delta *d;
+
+	d = delta_find(smd, b);
+	if (d) {
+		*result = d;
+		return 0;
+	}
+
+	if (smd->nr_deltas >= MAX_DELTAS) {
+		r = delta_flush(smd);
+		if (r)
+			return r;
+	}
+
+	d = kmalloc(sizeof(*d), GFP_NOIO);
+	if (!d)
+		return -ENOMEM;
+
+	r = sm_ll_lookup(&smd->ll, b, &d->disk_count);
+	if (r) {
+		kfree(d);
+		return r;
+	}
+
+	d->b = b;
+	d->count = d->disk_count;
+	delta_insert(smd, d);
+	*result = d;
+
+	return 0;
+}
+
+/*
+ * Accounts for a block's count going to or coming from zero.
+ */
+static int account_alloc(struct sm_disk *smd, dm_block_t b,
+			 uint32_t old, uint32_t new)
+{
+	int r;
+	uint32_t old_count;
+
+	if (!old && new) {
+		/*
+		 * This _must_ be free in the prior transaction
+		 * otherwise we've lost atomicity.
+		 */
+		smd->nr_allocated_this_transaction++;
+
+	} else if (old && !new) {
+		/*
+		 * It's only free if it's also free in the last
+		 * transaction.
+		 */
+		r = sm_ll_lookup(&smd->old_ll, b, &old_count);
+		if (r)
+			return r;
+
+		if (!old_count)
+			smd->nr_allocated_this_transaction--;
+	}
+
+	return 0;
+}
+
 static void sm_disk_destroy(struct dm_space_map *sm)
 {
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
 
+	delta_free_all(smd);
 	kfree(smd);
 }
 
@@ -65,6 +228,13 @@ static int sm_disk_get_count(struct dm_space_map *sm, dm_block_t b,
 			     uint32_t *result)
 {
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
+	struct sm_delta *d = delta_find(smd, b);
+
+	if (d) {
+		*result = d->count;
+		return 0;
+	}
+
 	return sm_ll_lookup(&smd->ll, b, result);
 }
 
@@ -87,38 +257,16 @@ static int sm_disk_set_count(struct dm_space_map *sm, dm_block_t b,
 			     uint32_t count)
 {
 	int r;
-	uint32_t old_count;
-	enum allocation_event ev;
+	struct sm_delta *d;
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
 
-	r = sm_ll_insert(&smd->ll, b, count, &ev);
-	if (!r) {
-		switch (ev) {
-		case SM_NONE:
-			break;
-
-		case SM_ALLOC:
-			/*
-			 * This _must_ be free in the prior transaction
-			 * otherwise we've lost atomicity.
-			 */
-			smd->nr_allocated_this_transaction++;
-			break;
-
-		case SM_FREE:
-			/*
-			 * It's only free if it's also free in the last
-			 * transaction.
-			 */
-			r = sm_ll_lookup(&smd->old_ll, b, &old_count);
-			if (r)
-				return r;
+	r = delta_get(smd, b, &d);
+	if (r)
+		return r;
 
-			if (!old_count)
-				smd->nr_allocated_this_transaction--;
-			break;
-		}
-	}
+	r = account_alloc(smd, b, d->count, count);
+	if (!r)
+		d->count = count;
 
 	return r;
 }
@@ -126,16 +274,16 @@ static int sm_disk_set_count(struct dm_space_map *sm, dm_block_t b,
 static int sm_disk_inc_block(struct dm_space_map *sm, dm_block_t b)
 {
 	int r;
-	enum allocation_event ev;
+	struct sm_delta *d;
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
 
-	r = sm_ll_inc(&smd->ll, b, &ev);
-	if (!r && (ev == SM_ALLOC))
-		/*
-		 * This _must_ be free in the prior transaction
-		 * otherwise we've lost atomicity.
-		 */
-		smd->nr_allocated_this_transaction++;
+	r = delta_get(smd, b, &d);
+	if (r)
+		return r;
+
+	r = account_alloc(smd, b, d->count, d->count + 1);
+	if (!r)
+		d->count++;
 
 	return r;
 }
@@ -143,45 +291,53 @@ static int sm_disk_inc_block(struct dm_space_map *sm, dm_block_t b)
 static int sm_disk_dec_block(struct dm_space_map *sm, dm_block_t b)
 {
 	int r;
-	uint32_t old_count;
-	enum allocation_event ev;
+	struct sm_delta *d;
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
 
-	r = sm_ll_dec(&smd->ll, b, &ev);
-	if (!r && (ev == SM_FREE)) {
-		/*
-		 * It's only free if it's also free in the last
-		 * transaction.
-		 */
-		r = sm_ll_lookup(&smd->old_ll, b, &old_count);
-		if (!r && !old_count)
-			smd->nr_allocated_this_transaction--;
+	r = delta_get(smd, b, &d);
+	if (r)
+		return r;
+
+	if (!d->count) {
+		DMERR("unable to decrement a reference count below 0");
+		return -EINVAL;
 	}
 
+	r = account_alloc(smd, b, d->count, d->count - 1);
+	if (!r)
+		d->count--;
+
 	return r;
 }
 
 static int sm_disk_new_block(struct dm_space_map *sm, dm_block_t *b)
 {
 	int r;
-	enum allocation_event ev;
+	struct sm_delta *d;
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
 
 	/*
-	 * Any block we allocate has to be free in both the old and current ll.
+	 * Any block we allocate has to be free in both the old and current
+	 * ll, and must not have been handed out earlier in this transaction.
 	 */
-	r = sm_ll_find_common_free_block(&smd->old_ll, &smd->ll, smd->begin, smd->ll.nr_blocks, b);
+	do {
+		r = sm_ll_find_common_free_block(&smd->old_ll, &smd->ll, smd->begin, smd->ll.nr_blocks, b);
+		if (r)
+			return r;
+
+		smd->begin = *b + 1;
+		d = delta_find(smd, *b);
+	} while (d && d->count);
+
+	r = delta_get(smd, *b, &d);
 	if (r)
 		return r;
 
-	smd->begin = *b + 1;
-	r = sm_ll_inc(&smd->ll, *b, &ev);
-	if (!r) {
-		BUG_ON(ev != SM_ALLOC);
-		smd->nr_allocated_this_transaction++;
-	}
+	BUG_ON(d->count);
+	d->count = 1;
+	smd->nr_allocated_this_transaction++;
 
-	return r;
+	return 0;
 }
 
 static int sm_disk_commit(struct dm_space_map *sm)
@@ -194,6 +350,10 @@ static int sm_disk_commit(struct dm_space_map *sm)
 	if (r)
 		return r;
 
+	r = delta_flush(smd);
+	if (r)
+		return r;
+
 	r = sm_ll_commit(&smd->ll);
 	if (r)
 		return r;
@@ -265,6 +425,8 @@ struct dm_space_map *dm_sm_disk_create(struct dm_transaction_manager *tm,
 
 	smd->begin = 0;
 	smd->nr_allocated_this_transaction = 0;
+	smd->deltas = RB_ROOT;
+	smd->nr_deltas = 0;
 	memcpy(&smd->sm, &ops, sizeof(smd->sm));
 
 	r = sm_ll_new_disk(&smd->ll, tm);
@@ -299,6 +461,8 @@ struct dm_space_map *dm_sm_disk_open(struct dm_transaction_manager *tm,
 
 	smd->begin = 0;
 	smd->nr_allocated_this_transaction = 0;
+	smd->deltas = RB_ROOT;
+	smd->nr_deltas = 0;
 	memcpy(&smd->sm, &ops, sizeof(smd->sm));
 
 	r = sm_ll_open_disk(&smd->ll, tm, root_le, len);
@@ -1418,7 +1418,7 @@ static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 	struct request_queue *q = req->q;
 	struct mmc_host *host = mq->card->host;
 	unsigned long flags;
-	bool put_card;
+	bool put_card, kick_writes;
 	int err;
 
 	mmc_cqe_post_req(host, mrq);
@@ -1447,6 +1447,13 @@ static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 	spin_lock_irqsave(&mq->lock, flags);
 
 	mq->in_flight[mmc_issue_type(mq, req)] -= 1;
+	if (req_op(req) == REQ_OP_WRITE)
+		mq->cqe_writes -= 1;
+
+	kick_writes = mq->cqe_writes_parked &&
+		      mq->cqe_writes < mq->cqe_write_depth;
+	if (kick_writes)
+		mq->cqe_writes_parked = false;
 
 	put_card = (mmc_tot_in_flight(mq) == 0);
 
@@ -1454,6 +1461,8 @@ static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 
 	spin_unlock_irqrestore(&mq->lock, flags);
 
+	if (kick_writes)
+		blk_mq_kick_requeue_list(q);
 	if (!mq->cqe_busy)
 		blk_mq_run_hw_queues(q, true);
 
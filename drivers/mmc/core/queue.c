@@ -37,6 +37,21 @@ void mmc_cqe_check_busy(struct mmc_queue *mq)
 	mq->cqe_busy &= ~MMC_CQE_QUEUE_FULL;
 }
 
+/*
+ * Writes are not allowed to take every CQE slot.  Once the cap is reached, a
+ * write that is dispatched anyway is parked on the requeue list until a write
+ * completes, while the writes behind it stay in the I/O scheduler, where small
+ * sequential writes are merged into larger ones instead of each taking a task
+ * slot of its own.  Parking the write rather than returning BLK_STS_RESOURCE
+ * keeps it off hctx->dispatch, so reads are still dispatched to the free
+ * slots.
+ */
+static inline bool mmc_cqe_write_full(struct mmc_queue *mq, struct request *req)
+{
+	return req_op(req) == REQ_OP_WRITE &&
+	       mq->cqe_writes >= mq->cqe_write_depth;
+}
+
 static inline bool mmc_cqe_can_dcmd(struct mmc_host *host)
 {
 	return host->caps2 & MMC_CAP2_CQE_DCMD;
@@ -279,6 +294,17 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 		}
 		break;
 	case MMC_ISSUE_ASYNC:
+		if (mq->use_cqe && mmc_cqe_write_full(mq, req)) {
+			/*
+			 * Kicked by mmc_blk_cqe_complete_rq().  Park under the
+			 * lock so that a completion cannot kick the requeue
+			 * list before the write is on it.
+			 */
+			mq->cqe_writes_parked = true;
+			blk_mq_requeue_request(req, false);
+			spin_unlock_irq(&mq->lock);
+			return BLK_STS_OK;
+		}
 		break;
 	default:
 		/*
@@ -296,6 +322,8 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 	mq->busy = true;
 
 	mq->in_flight[issue_type] += 1;
+	if (mq->use_cqe && req_op(req) == REQ_OP_WRITE)
+		mq->cqe_writes += 1;
 	get_card = (mmc_tot_in_flight(mq) == 1);
 	cqe_retune_ok = (mmc_cqe_qcnt(mq) == 1);
 
@@ -335,6 +363,8 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 		spin_lock_irq(&mq->lock);
 		mq->in_flight[issue_type] -= 1;
+		if (mq->use_cqe && req_op(req) == REQ_OP_WRITE)
+			mq->cqe_writes -= 1;
 		if (mmc_tot_in_flight(mq) == 0)
 			put_card = true;
 		mq->busy = false;
@@ -407,6 +437,17 @@ static inline bool mmc_merge_capable(struct mmc_host *host)
 /* Set queue depth to get a reasonable value for q->nr_requests */
 #define MMC_QUEUE_DEPTH 64
 
+/*
+ * Number of CQE slots writes may use.  The queue depth already accounts for
+ * both the card and the host (and a host using DCMD keeps a slot back for
+ * it), so half of it is enough to keep the card busy while the rest is held
+ * back for reads and to let writes merge.
+ */
+static int mmc_cqe_write_depth(int queue_depth)
+{
+	return max(queue_depth / 2, 2);
+}
+
 /**
  * mmc_init_queue - initialise a queue structure.
  * @mq: mmc queue
@@ -435,6 +476,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card)
 			min_t(int, card->ext_csd.cmdq_depth, host->cqe_qdepth);
 	else
 		mq->tag_set.queue_depth = MMC_QUEUE_DEPTH;
+	mq->cqe_write_depth = mmc_cqe_write_depth(mq->tag_set.queue_depth);
 	mq->tag_set.numa_node = NUMA_NO_NODE;
 	mq->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_BLOCKING;
 	mq->tag_set.nr_hw_queues = 1;
@@ -79,6 +79,9 @@ struct mmc_queue {
 	struct request_queue	*queue;
 	spinlock_t		lock;
 	int			in_flight[MMC_ISSUE_MAX];
+	int			cqe_writes;	/* CQE writes in flight */
+	int			cqe_write_depth;
+	bool			cqe_writes_parked;	/* on the requeue list */
 	unsigned int		cqe_busy;
 #define MMC_CQE_DCMD_BUSY	BIT(0)
 #define MMC_CQE_QUEUE_FULL	BIT(1)
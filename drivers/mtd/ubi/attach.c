@@ -72,8 +72,10 @@
 #include <linux/err.h>
 #include <linux/slab.h>
 #include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <linux/math64.h>
 #include <linux/random.h>
+#include <linux/workqueue.h>
 #include "ubi.h"
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
@@ -927,30 +929,74 @@ static bool vol_ignored(int vol_id)
 }
 
 /**
- * scan_peb - scan and process UBI headers of a PEB.
+ * struct scan_hdrs - UBI headers of a PEB as read from the flash.
+ * @ech: EC header buffer
+ * @vidb: VID header buffer
+ * @bad: what 'ubi_io_is_bad()' returned
+ * @ec_err: what 'ubi_io_read_ec_hdr()' returned
+ * @vid_err: what 'ubi_io_read_vid_hdr()' returned
+ *
+ * The VID header is not read for bad PEBs, when reading the EC header failed
+ * or when the EC header says the PEB is empty; @vid_err is meaningless then.
+ */
+struct scan_hdrs {
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_io_buf *vidb;
+	int bad;
+	int ec_err;
+	int vid_err;
+};
+
+/**
+ * read_peb_hdrs - read and check the UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @h: where to store the headers
+ *
+ * This function does all the flash I/O and CRC checking needed to scan PEB
+ * @pnum, but does not look at the attaching information, so it may be called
+ * for several PEBs in parallel.
+ */
+static void read_peb_hdrs(struct ubi_device *ubi, int pnum,
+			  struct scan_hdrs *h)
+{
+	h->bad = ubi_io_is_bad(ubi, pnum);
+	if (h->bad)
+		return;
+
+	h->ec_err = ubi_io_read_ec_hdr(ubi, pnum, h->ech, 0);
+	if (h->ec_err < 0 || h->ec_err == UBI_IO_FF ||
+	    h->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	h->vid_err = ubi_io_read_vid_hdr(ubi, pnum, h->vidb, 0);
+}
+
+/**
+ * scan_peb - process UBI headers of a PEB.
  * @ubi: UBI device description object
  * @ai: attaching information
  * @pnum: the physical eraseblock number
+ * @h: the headers of @pnum, as read by 'read_peb_hdrs()'
  * @fast: true if we're scanning for a Fastmap
  *
- * This function reads UBI headers of PEB @pnum, checks them, and adds
- * information about this PEB to the corresponding list or RB-tree in the
- * "attaching info" structure. Returns zero if the physical eraseblock was
- * successfully handled and a negative error code in case of failure.
+ * This function checks the UBI headers of PEB @pnum, and adds information
+ * about this PEB to the corresponding list or RB-tree in the "attaching info"
+ * structure. Returns zero if the physical eraseblock was successfully handled
+ * and a negative error code in case of failure.
  */
 static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, bool fast)
+		    int pnum, struct scan_hdrs *h, bool fast)
 {
-	struct ubi_ec_hdr *ech = ai->ech;
-	struct ubi_vid_io_buf *vidb = ai->vidb;
-	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
+	struct ubi_ec_hdr *ech = h->ech;
+	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(h->vidb);
 	long long ec;
 	int err, bitflips = 0, vol_id = -1, ec_err = 0;
 
 	dbg_bld("scan PEB %d", pnum);
 
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = h->bad;
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -958,7 +1004,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = h->ec_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1041,7 +1087,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	err = h->vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1193,6 +1239,148 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	return 0;
 }
 
+/*
+ * Number of consecutive PEBs each scan worker reads before the results are
+ * processed.
+ */
+#define UBI_SCAN_BATCH 16
+
+/**
+ * struct scan_worker - a scan worker reading PEB headers.
+ * @work: work item
+ * @ubi: UBI device description object
+ * @hdrs: header buffers for %UBI_SCAN_BATCH PEBs
+ * @pnum: first PEB to read
+ * @count: number of PEBs to read
+ */
+struct scan_worker {
+	struct work_struct work;
+	struct ubi_device *ubi;
+	struct scan_hdrs hdrs[UBI_SCAN_BATCH];
+	int pnum;
+	int count;
+};
+
+static void scan_worker_fn(struct work_struct *work)
+{
+	struct scan_worker *sw = container_of(work, struct scan_worker, work);
+	int i;
+
+	for (i = 0; i < sw->count; i++) {
+		read_peb_hdrs(sw->ubi, sw->pnum + i, &sw->hdrs[i]);
+		cond_resched();
+	}
+}
+
+static void free_scan_workers(struct scan_worker *sw, int nr)
+{
+	int i, j;
+
+	for (i = 0; i < nr; i++) {
+		for (j = 0; j < UBI_SCAN_BATCH; j++) {
+			ubi_free_vid_buf(sw[i].hdrs[j].vidb);
+			kfree(sw[i].hdrs[j].ech);
+		}
+	}
+	kfree(sw);
+}
+
+static struct scan_worker *alloc_scan_workers(struct ubi_device *ubi, int nr)
+{
+	struct scan_worker *sw;
+	int i, j;
+
+	sw = kcalloc(nr, sizeof(*sw), GFP_KERNEL);
+	if (!sw)
+		return NULL;
+
+	for (i = 0; i < nr; i++) {
+		INIT_WORK(&sw[i].work, scan_worker_fn);
+		sw[i].ubi = ubi;
+		for (j = 0; j < UBI_SCAN_BATCH; j++) {
+			struct scan_hdrs *h = &sw[i].hdrs[j];
+
+			h->ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+			h->vidb = ubi_alloc_vid_buf(ubi, GFP_KERNEL);
+			if (!h->ech || !h->vidb) {
+				free_scan_workers(sw, nr);
+				return NULL;
+			}
+		}
+	}
+
+	return sw;
+}
+
+/**
+ * scan_range - scan a range of PEBs.
+ * @ubi: UBI device description object
+ * @ai: attaching information
+ * @start: first PEB to scan
+ * @end: scan up to, but not including, this PEB
+ * @fast: true if we're scanning for a Fastmap
+ *
+ * With more than one scan worker the headers are read by the workers,
+ * %UBI_SCAN_BATCH consecutive PEBs each, so that several MTD reads and CRC
+ * checks are in flight at once.  The PEBs are then processed in order here,
+ * which gives exactly the same result as a serial scan.  Returns zero in case
+ * of success and a negative error code in case of failure.
+ */
+static int scan_range(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		      int start, int end, bool fast)
+{
+	int nr = clamp(ubi_scan_workers, 1, UBI_MAX_SCAN_WORKERS);
+	struct scan_worker *sw;
+	int err = 0, pnum, i, j;
+
+	nr = min(nr, DIV_ROUND_UP(end - start, UBI_SCAN_BATCH));
+	if (nr <= 1) {
+		struct scan_hdrs h = { .ech = ai->ech, .vidb = ai->vidb };
+
+		for (pnum = start; pnum < end; pnum++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum);
+			read_peb_hdrs(ubi, pnum, &h);
+			err = scan_peb(ubi, ai, pnum, &h, fast);
+			if (err < 0)
+				return err;
+		}
+		return 0;
+	}
+
+	sw = alloc_scan_workers(ubi, nr);
+	if (!sw)
+		return -ENOMEM;
+
+	for (pnum = start; pnum < end; pnum += nr * UBI_SCAN_BATCH) {
+		for (i = 0; i < nr; i++) {
+			sw[i].pnum = pnum + i * UBI_SCAN_BATCH;
+			sw[i].count = clamp(end - sw[i].pnum, 0, UBI_SCAN_BATCH);
+			if (sw[i].count)
+				queue_work(system_unbound_wq, &sw[i].work);
+		}
+
+		for (i = 0; i < nr; i++) {
+			flush_work(&sw[i].work);
+			for (j = 0; j < sw[i].count; j++) {
+				dbg_gen("process PEB %d", sw[i].pnum + j);
+				err = scan_peb(ubi, ai, sw[i].pnum + j,
+					       &sw[i].hdrs[j], fast);
+				if (err < 0)
+					goto out;
+			}
+		}
+	}
+
+out:
+	/* Wait for the reads still in flight if we bailed out early */
+	for (i = 0; i < nr; i++)
+		flush_work(&sw[i].work);
+	free_scan_workers(sw, nr);
+	return err;
+}
+
 /**
  * late_analysis - analyze the overall situation with PEB.
  * @ubi: UBI device description object
@@ -1374,10 +1562,11 @@ static void destroy_ai(struct ubi_attach_info *ai)
 static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int start)
 {
-	int err, pnum;
+	int err;
 	struct rb_node *rb1, *rb2;
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
+	ktime_t t;
 
 	err = -ENOMEM;
 
@@ -1389,16 +1578,13 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
-
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, false);
-		if (err < 0)
-			goto out_vidh;
-	}
+	t = ktime_get();
+	err = scan_range(ubi, ai, start, ubi->peb_count, false);
+	if (err < 0)
+		goto out_vidh;
 
-	ubi_msg(ubi, "scanning is finished");
+	ubi_msg(ubi, "scanning is finished, %d PEBs in %lld ms",
+		ubi->peb_count - start, ktime_ms_delta(ktime_get(), t));
 
 	/* Calculate mean erase counter */
 	if (ai->ec_count)
@@ -1486,8 +1672,9 @@ static struct ubi_attach_info *alloc_ai(void)
  */
 static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 {
-	int err, pnum;
+	int err;
 	struct ubi_attach_info *scan_ai;
+	ktime_t t;
 
 	err = -ENOMEM;
 
@@ -1503,14 +1690,10 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	if (!scan_ai->vidb)
 		goto out_ech;
 
-	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
-		cond_resched();
-
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, scan_ai, pnum, true);
-		if (err < 0)
-			goto out_vidh;
-	}
+	t = ktime_get();
+	err = scan_range(ubi, scan_ai, 0, UBI_FM_MAX_START, true);
+	if (err < 0)
+		goto out_vidh;
 
 	ubi_free_vid_buf(scan_ai->vidb);
 	kfree(scan_ai->ech);
@@ -1520,6 +1703,10 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	else
 		err = ubi_scan_fastmap(ubi, *ai, scan_ai);
 
+	if (!err)
+		ubi_msg(ubi, "attached by fastmap in %lld ms",
+			ktime_ms_delta(ktime_get(), t));
+
 	if (err) {
 		/*
 		 * Didn't attach via fastmap, do a full scan but reuse what
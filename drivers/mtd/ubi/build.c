@@ -74,6 +74,9 @@ static bool fm_debug;
 /* Slab cache for wear-leveling entries */
 struct kmem_cache *ubi_wl_entry_slab;
 
+/* Number of workers reading PEB headers when attaching by scanning */
+int ubi_scan_workers = 1;
+
 /* UBI control character device */
 static struct miscdevice ubi_ctrl_cdev = {
 	.minor = MISC_DYNAMIC_MINOR,
@@ -1463,6 +1466,9 @@ MODULE_PARM_DESC(mtd, "MTD devices to attach. Parameter format: mtd=<name|num|pa
 		      "Example 3: mtd=/dev/mtd1,0,25 - attach MTD device /dev/mtd1 using default VID header offset and reserve 25*nand_size_in_blocks/1024 erase blocks for bad block handling.\n"
 		      "Example 4: mtd=/dev/mtd1,0,0,5 - attach MTD device /dev/mtd1 to UBI 5 and using default values for the other fields.\n"
 		      "\t(e.g. if the NAND *chipset* has 4096 PEB, 100 will be reserved for this UBI device).");
+module_param_named(scan_workers, ubi_scan_workers, int, 0644);
+MODULE_PARM_DESC(scan_workers, "Number of workers reading PEB headers in parallel when attaching by scanning (default 1, max "
+		 __stringify(UBI_MAX_SCAN_WORKERS) "). Only helps if the MTD driver can serve reads from several threads at once.");
 #ifdef CONFIG_MTD_UBI_FASTMAP
 module_param(fm_autoconvert, bool, 0644);
 MODULE_PARM_DESC(fm_autoconvert, "Set this parameter to enable fastmap automatically on images without a fastmap.");
@@ -33,6 +33,9 @@
 /* Maximum number of supported UBI devices */
 #define UBI_MAX_DEVICES 32
 
+/* Maximum number of workers reading PEB headers while attaching by scanning */
+#define UBI_MAX_SCAN_WORKERS 16
+
 /* UBI name used for character devices, sysfs, etc */
 #define UBI_NAME_STR "ubi"
 
@@ -813,6 +816,7 @@ struct ubi_work {
 #include "debug.h"
 
 extern struct kmem_cache *ubi_wl_entry_slab;
+extern int ubi_scan_workers;
 extern const struct file_operations ubi_ctrl_cdev_operations;
 extern const struct file_operations ubi_cdev_operations;
 extern const struct file_operations ubi_vol_cdev_operations;
@@ -84,7 +84,7 @@ static inline void tlb_init_table_entry(struct tlb_client_info *entry, int save_
 		entry->tx_bytes = 0;
 	}
 
-	entry->tx_slave = NULL;
+	WRITE_ONCE(entry->tx_slave, NULL);
 	entry->next = TLB_NULL_INDEX;
 	entry->prev = TLB_NULL_INDEX;
 }
@@ -209,9 +209,10 @@ static struct slave *__tlb_choose_channel(struct bonding *bond, u32 hash_index,
 				&(SLAVE_TLB_INFO(assigned_slave));
 			u32 next_index = slave_info->head;
 
-			hash_table[hash_index].tx_slave = assigned_slave;
 			hash_table[hash_index].next = next_index;
 			hash_table[hash_index].prev = TLB_NULL_INDEX;
+			WRITE_ONCE(hash_table[hash_index].tx_slave,
+				   assigned_slave);
 
 			if (next_index != TLB_NULL_INDEX)
 				hash_table[next_index].prev = hash_index;
@@ -231,8 +232,21 @@ static struct slave *__tlb_choose_channel(struct bonding *bond, u32 hash_index,
 static struct slave *tlb_choose_channel(struct bonding *bond, u32 hash_index,
 					u32 skb_len)
 {
+	struct tlb_client_info *entry;
 	struct slave *tx_slave;
 
+	/* Once a hash entry is assigned, it only changes under mode_lock when
+	 * it is cleared, and slaves are freed only after an RCU grace period,
+	 * so the common case needs no lock. tx_bytes only feeds the periodic
+	 * rebalance, which can live with an occasional lost update.
+	 */
+	entry = &BOND_ALB_INFO(bond).tx_hashtbl[hash_index];
+	tx_slave = READ_ONCE(entry->tx_slave);
+	if (likely(tx_slave)) {
+		entry->tx_bytes += skb_len;
+		return tx_slave;
+	}
+
 	/* We don't need to disable softirq here, becase
 	 * tlb_choose_channel() is only called by bond_alb_xmit()
 	 * which already has softirq disabled.
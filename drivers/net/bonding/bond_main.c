@@ -3378,14 +3378,17 @@ static bool bond_flow_dissect(struct bonding *bond, struct sk_buff *skb,
  * @skb: buffer to use for headers
  *
  * This function will extract the necessary headers from the skb buffer and use
- * them to generate a hash based on the xmit_policy set in the bonding device
+ * them to generate a hash based on the xmit_policy set in the bonding device.
+ * For the layer3+4 policies, an L4 hash already carried by the skb is reused
+ * instead of dissecting the packet again.
  */
 u32 bond_xmit_hash(struct bonding *bond, struct sk_buff *skb)
 {
 	struct flow_keys flow;
 	u32 hash;
 
-	if (bond->params.xmit_policy == BOND_XMIT_POLICY_ENCAP34 &&
+	if ((bond->params.xmit_policy == BOND_XMIT_POLICY_LAYER34 ||
+	     bond->params.xmit_policy == BOND_XMIT_POLICY_ENCAP34) &&
 	    skb->l4_hash)
 		return skb->hash;
 
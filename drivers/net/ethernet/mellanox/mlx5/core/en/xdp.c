@@ -352,9 +352,27 @@ static bool mlx5e_xmit_xdp_frame(struct mlx5e_xdpsq *sq,
 	return true;
 }
 
+static void mlx5e_xdp_flush_frame_bulk(struct mlx5e_xdp_frame_bulk *bq)
+{
+	u16 i;
+
+	for (i = 0; i < bq->count; i++)
+		xdp_return_frame(bq->q[i]);
+	bq->count = 0;
+}
+
+static void mlx5e_xdp_return_frame_bulk(struct xdp_frame *xdpf,
+					struct mlx5e_xdp_frame_bulk *bq)
+{
+	if (unlikely(bq->count == MLX5E_XDP_FRAME_BULK))
+		mlx5e_xdp_flush_frame_bulk(bq);
+	bq->q[bq->count++] = xdpf;
+}
+
 static void mlx5e_free_xdpsq_desc(struct mlx5e_xdpsq *sq,
 				  struct mlx5e_xdp_wqe_info *wi,
 				  u32 *xsk_frames,
+				  struct mlx5e_xdp_frame_bulk *bq,
 				  bool recycle)
 {
 	struct mlx5e_xdp_info_fifo *xdpi_fifo = &sq->db.xdpi_fifo;
@@ -368,7 +386,7 @@ static void mlx5e_free_xdpsq_desc(struct mlx5e_xdpsq *sq,
 			/* XDP_TX from the XSK RQ and XDP_REDIRECT */
 			dma_unmap_single(sq->pdev, xdpi.frame.dma_addr,
 					 xdpi.frame.xdpf->len, DMA_TO_DEVICE);
-			xdp_return_frame(xdpi.frame.xdpf);
+			mlx5e_xdp_return_frame_bulk(xdpi.frame.xdpf, bq);
 			break;
 		case MLX5E_XDP_XMIT_MODE_PAGE:
 			/* XDP_TX from the regular RQ */
@@ -386,6 +404,7 @@ static void mlx5e_free_xdpsq_desc(struct mlx5e_xdpsq *sq,
 
 bool mlx5e_poll_xdpsq_cq(struct mlx5e_cq *cq)
 {
+	struct mlx5e_xdp_frame_bulk bq;
 	struct mlx5e_xdpsq *sq;
 	struct mlx5_cqe64 *cqe;
 	u32 xsk_frames = 0;
@@ -405,6 +424,7 @@ bool mlx5e_poll_xdpsq_cq(struct mlx5e_cq *cq)
 	 * otherwise a cq overrun may occur
 	 */
 	sqcc = sq->cc;
+	bq.count = 0;
 
 	i = 0;
 	do {
@@ -430,7 +450,7 @@ bool mlx5e_poll_xdpsq_cq(struct mlx5e_cq *cq)
 
 			sqcc += wi->num_wqebbs;
 
-			mlx5e_free_xdpsq_desc(sq, wi, &xsk_frames, true);
+			mlx5e_free_xdpsq_desc(sq, wi, &xsk_frames, &bq, true);
 		} while (!last_wqe);
 	} while ((++i < MLX5E_TX_CQ_POLL_BUDGET) && (cqe = mlx5_cqwq_get_cqe(&cq->wq)));
 
@@ -445,11 +465,14 @@ bool mlx5e_poll_xdpsq_cq(struct mlx5e_cq *cq)
 	wmb();
 
 	sq->cc = sqcc;
+
+	mlx5e_xdp_flush_frame_bulk(&bq);
 	return (i == MLX5E_TX_CQ_POLL_BUDGET);
 }
 
 void mlx5e_free_xdpsq_descs(struct mlx5e_xdpsq *sq)
 {
+	struct mlx5e_xdp_frame_bulk bq = {};
 	u32 xsk_frames = 0;
 
 	while (sq->cc != sq->pc) {
@@ -461,9 +484,11 @@ void mlx5e_free_xdpsq_descs(struct mlx5e_xdpsq *sq)
 
 		sq->cc += wi->num_wqebbs;
 
-		mlx5e_free_xdpsq_desc(sq, wi, &xsk_frames, false);
+		mlx5e_free_xdpsq_desc(sq, wi, &xsk_frames, &bq, false);
 	}
 
+	mlx5e_xdp_flush_frame_bulk(&bq);
+
 	if (xsk_frames)
 		xsk_umem_complete_tx(sq->umem, xsk_frames);
 }
@@ -60,6 +60,16 @@
 #define MLX5E_XDP_MPW_MAX_NUM_DS \
 	(MLX5E_XDP_MPW_MAX_WQEBBS * MLX5_SEND_WQEBB_NUM_DS)
 
+/* XDP frames completed in one CQ poll are returned together, once the CQ
+ * has been released to the HW.
+ */
+#define MLX5E_XDP_FRAME_BULK 16
+
+struct mlx5e_xdp_frame_bulk {
+	u16 count;
+	struct xdp_frame *q[MLX5E_XDP_FRAME_BULK];
+};
+
 struct mlx5e_xsk_param;
 int mlx5e_xdp_max_mtu(struct mlx5e_params *params, struct mlx5e_xsk_param *xsk);
 bool mlx5e_xdp_handle(struct mlx5e_rq *rq, struct mlx5e_dma_info *di,
@@ -12,6 +12,7 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/filter.h>
+#include <linux/bpf.h>
 #include <linux/if_team.h>
 
 static rx_handler_result_t lb_receive(struct team *team, struct team_port *port,
@@ -197,7 +198,7 @@ static unsigned int lb_get_skb_hash(struct lb_priv *lb_priv,
 	fp = rcu_dereference_bh(lb_priv->fp);
 	if (unlikely(!fp))
 		return 0;
-	lhash = BPF_PROG_RUN(fp, skb);
+	lhash = bpf_prog_run_save_cb(fp, skb);
 	c = (char *) &lhash;
 	return c[0] ^ c[1] ^ c[2] ^ c[3];
 }
@@ -284,11 +285,41 @@ static void __fprog_destroy(struct sock_fprog_kern *fprog)
 	kfree(fprog);
 }
 
-static int lb_bpf_func_set(struct team *team, struct team_gsetter_ctx *ctx)
+/* Classic filters are kept together with their original program, so that is
+ * what tells the two kinds apart. eBPF programs are only referenced.
+ */
+static void __lb_bpf_func_destroy(struct bpf_prog *fp,
+				  struct sock_fprog_kern *fprog)
+{
+	if (fprog) {
+		__fprog_destroy(fprog);
+		bpf_prog_destroy(fp);
+	} else {
+		bpf_prog_put(fp);
+	}
+}
+
+static void __lb_bpf_func_replace(struct team *team, struct bpf_prog *fp,
+				  struct sock_fprog_kern *fprog)
 {
 	struct lb_priv *lb_priv = get_lb_priv(team);
+	struct sock_fprog_kern *orig_fprog = lb_priv->ex->orig_fprog;
+	struct bpf_prog *orig_fp;
+
+	orig_fp = rcu_dereference_protected(lb_priv->fp,
+					    lockdep_is_held(&team->lock));
+	rcu_assign_pointer(lb_priv->fp, fp);
+	lb_priv->ex->orig_fprog = fprog;
+
+	if (orig_fp) {
+		synchronize_rcu();
+		__lb_bpf_func_destroy(orig_fp, orig_fprog);
+	}
+}
+
+static int lb_bpf_func_set(struct team *team, struct team_gsetter_ctx *ctx)
+{
 	struct bpf_prog *fp = NULL;
-	struct bpf_prog *orig_fp = NULL;
 	struct sock_fprog_kern *fprog = NULL;
 	int err;
 
@@ -304,20 +335,37 @@ static int lb_bpf_func_set(struct team *team, struct team_gsetter_ctx *ctx)
 		}
 	}
 
-	if (lb_priv->ex->orig_fprog) {
-		/* Clear old filter data */
-		__fprog_destroy(lb_priv->ex->orig_fprog);
-		orig_fp = rcu_dereference_protected(lb_priv->fp,
-						lockdep_is_held(&team->lock));
-	}
+	__lb_bpf_func_replace(team, fp, fprog);
+	return 0;
+}
 
-	rcu_assign_pointer(lb_priv->fp, fp);
-	lb_priv->ex->orig_fprog = fprog;
+static int lb_bpf_prog_get(struct team *team, struct team_gsetter_ctx *ctx)
+{
+	struct lb_priv *lb_priv = get_lb_priv(team);
+	struct bpf_prog *fp;
 
-	if (orig_fp) {
-		synchronize_rcu();
-		bpf_prog_destroy(orig_fp);
+	fp = rcu_dereference_protected(lb_priv->fp,
+				       lockdep_is_held(&team->lock));
+	ctx->data.s32_val = fp && !lb_priv->ex->orig_fprog ? fp->aux->id : 0;
+	return 0;
+}
+
+/* Takes the fd of a BPF_PROG_TYPE_SOCKET_FILTER program, or a negative value
+ * to detach. The program replaces any classic hash function, sees the frame
+ * from its Ethernet header and is JITed like any other eBPF program.
+ */
+static int lb_bpf_prog_set(struct team *team, struct team_gsetter_ctx *ctx)
+{
+	struct bpf_prog *fp = NULL;
+
+	if (ctx->data.s32_val >= 0) {
+		fp = bpf_prog_get_type(ctx->data.s32_val,
+				       BPF_PROG_TYPE_SOCKET_FILTER);
+		if (IS_ERR(fp))
+			return PTR_ERR(fp);
 	}
+
+	__lb_bpf_func_replace(team, fp, NULL);
 	return 0;
 }
 
@@ -326,13 +374,12 @@ static void lb_bpf_func_free(struct team *team)
 	struct lb_priv *lb_priv = get_lb_priv(team);
 	struct bpf_prog *fp;
 
-	if (!lb_priv->ex->orig_fprog)
-		return;
-
-	__fprog_destroy(lb_priv->ex->orig_fprog);
 	fp = rcu_dereference_protected(lb_priv->fp,
 				       lockdep_is_held(&team->lock));
-	bpf_prog_destroy(fp);
+	if (!fp)
+		return;
+
+	__lb_bpf_func_destroy(fp, lb_priv->ex->orig_fprog);
 }
 
 static int lb_tx_method_get(struct team *team, struct team_gsetter_ctx *ctx)
@@ -564,6 +611,12 @@ static const struct team_option lb_options[] = {
 		.getter = lb_bpf_func_get,
 		.setter = lb_bpf_func_set,
 	},
+	{
+		.name = "bpf_hash_prog",
+		.type = TEAM_OPTION_TYPE_S32,
+		.getter = lb_bpf_prog_get,
+		.setter = lb_bpf_prog_set,
+	},
 	{
 		.name = "lb_tx_method",
 		.type = TEAM_OPTION_TYPE_STRING,
@@ -25,6 +25,9 @@
  */
 
 #include <linux/module.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
 #include <net/ip6_checksum.h>
 
 #include "vmxnet3_int.h"
@@ -330,6 +333,7 @@ vmxnet3_unmap_pkt(u32 eop_idx, struct vmxnet3_tx_queue *tq,
 		  struct pci_dev *pdev,	struct vmxnet3_adapter *adapter)
 {
 	struct sk_buff *skb;
+	struct xdp_frame *xdpf;
 	int entries = 0;
 
 	/* no out of order completion */
@@ -337,8 +341,10 @@ vmxnet3_unmap_pkt(u32 eop_idx, struct vmxnet3_tx_queue *tq,
 	BUG_ON(VMXNET3_TXDESC_GET_EOP(&(tq->tx_ring.base[eop_idx].txd)) != 1);
 
 	skb = tq->buf_info[eop_idx].skb;
-	BUG_ON(skb == NULL);
+	xdpf = tq->buf_info[eop_idx].xdpf;
+	BUG_ON(skb == NULL && xdpf == NULL);
 	tq->buf_info[eop_idx].skb = NULL;
+	tq->buf_info[eop_idx].xdpf = NULL;
 
 	VMXNET3_INC_RING_IDX_ONLY(eop_idx, tq->tx_ring.size);
 
@@ -355,7 +361,10 @@ vmxnet3_unmap_pkt(u32 eop_idx, struct vmxnet3_tx_queue *tq,
 		entries++;
 	}
 
-	dev_kfree_skb_any(skb);
+	if (xdpf)
+		xdp_return_frame(xdpf);
+	else
+		dev_kfree_skb_any(skb);
 	return entries;
 }
 
@@ -412,12 +421,17 @@ vmxnet3_tq_cleanup(struct vmxnet3_tx_queue *tq,
 			dev_kfree_skb_any(tbi->skb);
 			tbi->skb = NULL;
 		}
+		if (tbi->xdpf) {
+			xdp_return_frame(tbi->xdpf);
+			tbi->xdpf = NULL;
+		}
 		vmxnet3_cmd_ring_adv_next2comp(&tq->tx_ring);
 	}
 
 	/* sanity check, verify all buffers are indeed unmapped and freed */
 	for (i = 0; i < tq->tx_ring.size; i++) {
 		BUG_ON(tq->buf_info[i].skb != NULL ||
+		       tq->buf_info[i].xdpf != NULL ||
 		       tq->buf_info[i].map_type != VMXNET3_MAP_NONE);
 	}
 
@@ -1161,6 +1175,131 @@ vmxnet3_xmit_frame(struct sk_buff *skb, struct net_device *netdev)
 }
 
 
+/*
+ * Queues an XDP frame on a tq as a single descriptor. The caller holds
+ * tq->tx_lock and rings the doorbell with vmxnet3_xdp_flush().
+ */
+static int
+vmxnet3_xdp_xmit_frame(struct vmxnet3_adapter *adapter,
+		       struct xdp_frame *xdpf, struct vmxnet3_tx_queue *tq)
+{
+	struct vmxnet3_tx_buf_info *tbi;
+	union Vmxnet3_GenericDesc *gdesc;
+	u32 dw2;
+
+	if (unlikely(vmxnet3_cmd_ring_desc_avail(&tq->tx_ring) < 1)) {
+		tq->stats.tx_ring_full++;
+		return -ENOSPC;
+	}
+
+	tbi = tq->buf_info + tq->tx_ring.next2fill;
+	tbi->dma_addr = dma_map_single(&adapter->pdev->dev, xdpf->data,
+				       xdpf->len, PCI_DMA_TODEVICE);
+	if (dma_mapping_error(&adapter->pdev->dev, tbi->dma_addr))
+		return -EFAULT;
+
+	tbi->map_type = VMXNET3_MAP_SINGLE;
+	tbi->len = xdpf->len;
+	tbi->xdpf = xdpf;
+	tbi->sop_idx = tq->tx_ring.next2fill;
+
+	/* use the previous gen bit, it is flipped once the desc is set up */
+	dw2 = (tq->tx_ring.gen ^ 0x1) << VMXNET3_TXD_GEN_SHIFT;
+	dw2 |= xdpf->len;
+
+	gdesc = tq->tx_ring.base + tq->tx_ring.next2fill;
+	gdesc->txd.addr = cpu_to_le64(tbi->dma_addr);
+	gdesc->dword[2] = cpu_to_le32(dw2);
+	gdesc->dword[3] = cpu_to_le32(VMXNET3_TXD_CQ | VMXNET3_TXD_EOP);
+	vmxnet3_cmd_ring_adv_next2fill(&tq->tx_ring);
+
+	le32_add_cpu(&tq->shared->txNumDeferred, 1);
+
+	/* Ensure that the write to (&gdesc->txd)->gen will be observed after
+	 * all other writes to &gdesc->txd.
+	 */
+	dma_wmb();
+	gdesc->dword[2] = cpu_to_le32(dw2 ^ VMXNET3_TXD_GEN);
+
+	return 0;
+}
+
+
+static void
+vmxnet3_xdp_flush(struct vmxnet3_adapter *adapter,
+		  struct vmxnet3_tx_queue *tq)
+{
+	tq->shared->txNumDeferred = 0;
+	VMXNET3_WRITE_BAR0_REG(adapter, VMXNET3_REG_TXPROD + tq->qid * 8,
+			       tq->tx_ring.next2fill);
+}
+
+
+static int
+vmxnet3_xdp_xmit(struct net_device *netdev, int n, struct xdp_frame **frames,
+		 u32 flags)
+{
+	struct vmxnet3_adapter *adapter = netdev_priv(netdev);
+	struct vmxnet3_tx_queue *tq;
+	unsigned long irq_flags;
+	int i, drops = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(test_bit(VMXNET3_STATE_BIT_QUIESCED, &adapter->state) ||
+		     !netif_carrier_ok(netdev)))
+		return -ENETDOWN;
+
+	tq = &adapter->tx_queue[smp_processor_id() % adapter->num_tx_queues];
+
+	spin_lock_irqsave(&tq->tx_lock, irq_flags);
+	for (i = 0; i < n; i++) {
+		if (vmxnet3_xdp_xmit_frame(adapter, frames[i], tq)) {
+			xdp_return_frame_rx_napi(frames[i]);
+			drops++;
+		}
+	}
+	if (flags & XDP_XMIT_FLUSH)
+		vmxnet3_xdp_flush(adapter, tq);
+	tq->stats.xdp_xmit += n - drops;
+	tq->stats.xdp_xmit_err += drops;
+	spin_unlock_irqrestore(&tq->tx_lock, irq_flags);
+
+	return n - drops;
+}
+
+
+/* XDP_TX goes out on the tq paired with the rq */
+static struct vmxnet3_tx_queue *
+vmxnet3_xdp_tq(struct vmxnet3_rx_queue *rq)
+{
+	struct vmxnet3_adapter *adapter = rq->adapter;
+
+	return &adapter->tx_queue[(rq - adapter->rx_queue) %
+				  adapter->num_tx_queues];
+}
+
+
+static int
+vmxnet3_xdp_xmit_back(struct vmxnet3_rx_queue *rq, struct xdp_frame *xdpf)
+{
+	struct vmxnet3_tx_queue *tq = vmxnet3_xdp_tq(rq);
+	unsigned long flags;
+	int err;
+
+	spin_lock_irqsave(&tq->tx_lock, flags);
+	err = vmxnet3_xdp_xmit_frame(rq->adapter, xdpf, tq);
+	if (err)
+		tq->stats.xdp_xmit_err++;
+	else
+		tq->stats.xdp_xmit++;
+	spin_unlock_irqrestore(&tq->tx_lock, flags);
+
+	return err;
+}
+
+
 static void
 vmxnet3_rx_csum(struct vmxnet3_adapter *adapter,
 		struct sk_buff *skb,
@@ -1274,6 +1413,119 @@ vmxnet3_get_hdr_len(struct vmxnet3_adapter *adapter, struct sk_buff *skb,
 	return (hlen + (hdr.tcp->doff << 2));
 }
 
+/* Deferred work after a round of XDP verdicts */
+#define VMXNET3_XDP_TX		BIT(0)
+#define VMXNET3_XDP_REDIR	BIT(1)
+
+/*
+ * Frames handed to XDP_TX or XDP_REDIRECT are eventually released with
+ * page_frag_free(), so they have to live in a page frag. Buffers posted at
+ * open time, or too small for the page frag cache, have a kmalloc'ed head;
+ * copy those packets into a page frag first.
+ */
+static int
+vmxnet3_xdp_frag_buf(struct sk_buff *skb, struct xdp_buff *xdp)
+{
+	unsigned int len = xdp->data_end - xdp->data;
+	void *buf;
+
+	if (skb->head_frag)
+		return 0;
+
+	buf = napi_alloc_frag(SKB_DATA_ALIGN(XDP_PACKET_HEADROOM + len) +
+			      SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
+	if (unlikely(!buf))
+		return -ENOMEM;
+
+	memcpy(buf + XDP_PACKET_HEADROOM, xdp->data, len);
+	xdp->data_hard_start = buf;
+	xdp->data = buf + XDP_PACKET_HEADROOM;
+	xdp->data_end = xdp->data + len;
+	xdp_set_data_meta_invalid(xdp);
+	return 0;
+}
+
+/*
+ * Run the XDP program on a packet that arrived in a single buffer.
+ * Returns true if the packet was consumed. Otherwise the skb is trimmed to
+ * what the program left of the packet and goes up the stack as usual.
+ */
+static bool
+vmxnet3_run_xdp(struct vmxnet3_rx_queue *rq, struct bpf_prog *prog,
+		struct sk_buff *skb, unsigned int *xdp_done)
+{
+	struct net_device *netdev = rq->adapter->netdev;
+	void *orig_data = skb->data;
+	struct xdp_frame *xdpf;
+	struct xdp_buff xdp;
+	unsigned int len;
+	u32 act;
+
+	xdp.data_hard_start = skb->head;
+	xdp.data = skb->data;
+	xdp.data_end = skb->data + skb->len;
+	xdp_set_data_meta_invalid(&xdp);
+	xdp.rxq = &rq->xdp_rxq;
+
+	rq->stats.xdp_packets++;
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		if (xdp.data > orig_data)
+			__skb_pull(skb, xdp.data - orig_data);
+		else if (xdp.data < orig_data)
+			__skb_push(skb, orig_data - xdp.data);
+
+		len = xdp.data_end - xdp.data;
+		if (len < skb->len)
+			__skb_trim(skb, len);
+		else
+			__skb_put(skb, len - skb->len);
+		return false;
+	case XDP_TX:
+		if (vmxnet3_xdp_frag_buf(skb, &xdp))
+			goto drop;
+		xdpf = convert_to_xdp_frame(&xdp);
+		if (unlikely(!xdpf) || vmxnet3_xdp_xmit_back(rq, xdpf))
+			goto xdp_err;
+		rq->stats.xdp_tx++;
+		*xdp_done |= VMXNET3_XDP_TX;
+		break;
+	case XDP_REDIRECT:
+		if (vmxnet3_xdp_frag_buf(skb, &xdp))
+			goto drop;
+		if (xdp_do_redirect(netdev, &xdp, prog))
+			goto xdp_err;
+		rq->stats.xdp_redirects++;
+		*xdp_done |= VMXNET3_XDP_REDIR;
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		/* fall through */
+	case XDP_ABORTED:
+		trace_xdp_exception(netdev, prog, act);
+		/* fall through */
+	case XDP_DROP:
+		goto drop;
+	}
+
+	/* the buffer now belongs to XDP, only free what is left of the skb */
+	if (xdp.data_hard_start == skb->head)
+		kfree_skb_partial(skb, true);
+	else
+		consume_skb(skb);
+	return true;
+
+xdp_err:
+	trace_xdp_exception(netdev, prog, act);
+	if (xdp.data_hard_start != skb->head)
+		page_frag_free(xdp.data);
+drop:
+	rq->stats.xdp_drops++;
+	dev_kfree_skb(skb);
+	return true;
+}
+
 static int
 vmxnet3_rq_rx_complete(struct vmxnet3_rx_queue *rq,
 		       struct vmxnet3_adapter *adapter, int quota)
@@ -1286,10 +1538,15 @@ vmxnet3_rq_rx_complete(struct vmxnet3_rx_queue *rq,
 	struct Vmxnet3_RxCompDesc *rcd;
 	struct vmxnet3_rx_ctx *ctx = &rq->rx_ctx;
 	u16 segCnt = 0, mss = 0;
+	struct bpf_prog *xdp_prog;
+	unsigned int xdp_done = 0;
 #ifdef __BIG_ENDIAN_BITFIELD
 	struct Vmxnet3_RxDesc rxCmdDesc;
 	struct Vmxnet3_RxCompDesc rxComp;
 #endif
+	rcu_read_lock();
+	xdp_prog = rcu_dereference(adapter->xdp_prog);
+
 	vmxnet3_getRxComp(rcd, &rq->comp_ring.base[rq->comp_ring.next2proc].rcd,
 			  &rxComp);
 	while (rcd->gen == rq->comp_ring.gen) {
@@ -1433,6 +1690,25 @@ vmxnet3_rq_rx_complete(struct vmxnet3_rx_queue *rq,
 			} else {
 				segCnt = 0;
 			}
+
+			if (xdp_prog) {
+				/* XDP sees neither LRO nor jumbo frames, so a
+				 * multi-buffer pkt is unexpected: drop it.
+				 */
+				if (unlikely(!rcd->eop)) {
+					dev_kfree_skb(ctx->skb);
+					ctx->skb = NULL;
+					rq->stats.xdp_drops++;
+					skip_page_frags = true;
+					goto rcd_done;
+				}
+				if (vmxnet3_run_xdp(rq, xdp_prog, ctx->skb,
+						    &xdp_done)) {
+					ctx->skb = NULL;
+					num_pkts++;
+					goto rcd_done;
+				}
+			}
 		} else {
 			BUG_ON(ctx->skb == NULL && !skip_page_frags);
 
@@ -1572,6 +1848,19 @@ vmxnet3_rq_rx_complete(struct vmxnet3_rx_queue *rq,
 				  &rq->comp_ring.base[rq->comp_ring.next2proc].rcd, &rxComp);
 	}
 
+	if (xdp_done & VMXNET3_XDP_TX) {
+		struct vmxnet3_tx_queue *tq = vmxnet3_xdp_tq(rq);
+		unsigned long flags;
+
+		/* tx_lock is also taken from ndo_xdp_xmit with irqs off */
+		spin_lock_irqsave(&tq->tx_lock, flags);
+		vmxnet3_xdp_flush(adapter, tq);
+		spin_unlock_irqrestore(&tq->tx_lock, flags);
+	}
+	if (xdp_done & VMXNET3_XDP_REDIR)
+		xdp_do_flush();
+	rcu_read_unlock();
+
 	return num_pkts;
 }
 
@@ -1640,6 +1929,8 @@ static void vmxnet3_rq_destroy(struct vmxnet3_rx_queue *rq,
 		}
 	}
 
+	if (xdp_rxq_info_is_reg(&rq->xdp_rxq))
+		xdp_rxq_info_unreg(&rq->xdp_rxq);
 
 	for (i = 0; i < 2; i++) {
 		if (rq->rx_ring[i].base) {
@@ -1822,6 +2113,13 @@ vmxnet3_rq_create(struct vmxnet3_rx_queue *rq, struct vmxnet3_adapter *adapter)
 	rq->buf_info[0] = bi;
 	rq->buf_info[1] = bi + rq->rx_ring[0].size;
 
+	if (xdp_rxq_info_reg(&rq->xdp_rxq, adapter->netdev,
+			     rq - adapter->rx_queue))
+		goto err;
+	if (xdp_rxq_info_reg_mem_model(&rq->xdp_rxq, MEM_TYPE_PAGE_SHARED,
+				       NULL))
+		goto err;
+
 	return 0;
 
 err:
@@ -2991,6 +3289,13 @@ vmxnet3_change_mtu(struct net_device *netdev, int new_mtu)
 	struct vmxnet3_adapter *adapter = netdev_priv(netdev);
 	int err = 0;
 
+	if (rcu_access_pointer(adapter->xdp_prog) &&
+	    new_mtu > VMXNET3_XDP_MAX_MTU) {
+		netdev_err(netdev, "MTU %d too large for XDP, max %d\n",
+			   new_mtu, VMXNET3_XDP_MAX_MTU);
+		return -EINVAL;
+	}
+
 	netdev->mtu = new_mtu;
 
 	/*
@@ -3033,6 +3338,50 @@ vmxnet3_change_mtu(struct net_device *netdev, int new_mtu)
 }
 
 
+static int
+vmxnet3_xdp_set(struct net_device *netdev, struct bpf_prog *prog,
+		struct netlink_ext_ack *extack)
+{
+	struct vmxnet3_adapter *adapter = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+
+	if (prog && netdev->mtu > VMXNET3_XDP_MAX_MTU) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	old_prog = rcu_replace_pointer(adapter->xdp_prog, prog,
+				       lockdep_rtnl_is_held());
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	/* LRO has to go while a program is attached, see fix_features */
+	if (!old_prog != !prog)
+		netdev_update_features(netdev);
+
+	return 0;
+}
+
+
+static int
+vmxnet3_xdp(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	struct vmxnet3_adapter *adapter = netdev_priv(netdev);
+	struct bpf_prog *prog;
+
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return vmxnet3_xdp_set(netdev, bpf->prog, bpf->extack);
+	case XDP_QUERY_PROG:
+		prog = rtnl_dereference(adapter->xdp_prog);
+		bpf->prog_id = prog ? prog->aux->id : 0;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+
 static void
 vmxnet3_declare_features(struct vmxnet3_adapter *adapter, bool dma64)
 {
@@ -3253,6 +3602,8 @@ vmxnet3_probe_device(struct pci_dev *pdev,
 		.ndo_set_rx_mode = vmxnet3_set_mc,
 		.ndo_vlan_rx_add_vid = vmxnet3_vlan_rx_add_vid,
 		.ndo_vlan_rx_kill_vid = vmxnet3_vlan_rx_kill_vid,
+		.ndo_bpf = vmxnet3_xdp,
+		.ndo_xdp_xmit = vmxnet3_xdp_xmit,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 		.ndo_poll_controller = vmxnet3_netpoll,
 #endif
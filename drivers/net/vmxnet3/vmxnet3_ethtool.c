@@ -72,6 +72,10 @@ vmxnet3_tq_driver_stats[] = {
 					 copy_skb_header) },
 	{ "  giant hdr",	offsetof(struct vmxnet3_tq_driver_stats,
 					 oversized_hdr) },
+	{ "  xdp xmit",		offsetof(struct vmxnet3_tq_driver_stats,
+					 xdp_xmit) },
+	{ "  xdp xmit err",	offsetof(struct vmxnet3_tq_driver_stats,
+					 xdp_xmit_err) },
 };
 
 /* per rq stats maintained by the device */
@@ -102,6 +106,14 @@ vmxnet3_rq_driver_stats[] = {
 					 drop_fcs) },
 	{ "  rx buf alloc fail", offsetof(struct vmxnet3_rq_driver_stats,
 					  rx_buf_alloc_failure) },
+	{ "  xdp packets",	offsetof(struct vmxnet3_rq_driver_stats,
+					 xdp_packets) },
+	{ "  xdp tx",		offsetof(struct vmxnet3_rq_driver_stats,
+					 xdp_tx) },
+	{ "  xdp redirects",	offsetof(struct vmxnet3_rq_driver_stats,
+					 xdp_redirects) },
+	{ "  xdp drops",	offsetof(struct vmxnet3_rq_driver_stats,
+					 xdp_drops) },
 };
 
 /* global stats maintained by the driver */
@@ -260,10 +272,16 @@ vmxnet3_get_strings(struct net_device *netdev, u32 stringset, u8 *buf)
 netdev_features_t vmxnet3_fix_features(struct net_device *netdev,
 				       netdev_features_t features)
 {
+	struct vmxnet3_adapter *adapter = netdev_priv(netdev);
+
 	/* If Rx checksum is disabled, then LRO should also be disabled */
 	if (!(features & NETIF_F_RXCSUM))
 		features &= ~NETIF_F_LRO;
 
+	/* XDP needs each packet in a single buffer */
+	if (rcu_access_pointer(adapter->xdp_prog))
+		features &= ~NETIF_F_LRO;
+
 	return features;
 }
 
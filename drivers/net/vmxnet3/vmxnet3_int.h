@@ -56,6 +56,7 @@
 #include <linux/if_arp.h>
 #include <linux/inetdevice.h>
 #include <linux/log2.h>
+#include <net/xdp.h>
 
 #include "vmxnet3_defs.h"
 
@@ -196,6 +197,7 @@ struct vmxnet3_tx_buf_info {
 	u16      sop_idx;
 	dma_addr_t  dma_addr;
 	struct sk_buff *skb;
+	struct xdp_frame *xdpf;	/* set instead of skb for XDP frames */
 };
 
 struct vmxnet3_tq_driver_stats {
@@ -212,6 +214,9 @@ struct vmxnet3_tq_driver_stats {
 	u64 linearized;         /* # of pkts linearized */
 	u64 copy_skb_header;    /* # of times we have to copy skb header */
 	u64 oversized_hdr;
+
+	u64 xdp_xmit;		/* # of XDP frames queued */
+	u64 xdp_xmit_err;	/* # of XDP frames dropped on tx */
 };
 
 struct vmxnet3_tx_ctx {
@@ -271,6 +276,11 @@ struct vmxnet3_rq_driver_stats {
 	u64 drop_err;
 	u64 drop_fcs;
 	u64 rx_buf_alloc_failure;
+
+	u64 xdp_packets;	/* # of pkts run through the XDP program */
+	u64 xdp_tx;
+	u64 xdp_redirects;
+	u64 xdp_drops;		/* XDP_DROP, XDP_ABORTED and failed actions */
 };
 
 struct vmxnet3_rx_data_ring {
@@ -294,6 +304,7 @@ struct vmxnet3_rx_queue {
 	dma_addr_t                      buf_info_pa;
 	struct Vmxnet3_RxQueueCtrl            *shared;
 	struct vmxnet3_rq_driver_stats  stats;
+	struct xdp_rxq_info		xdp_rxq;
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 #define VMXNET3_DEVICE_MAX_TX_QUEUES 8
@@ -389,6 +400,8 @@ struct vmxnet3_adapter {
 	dma_addr_t adapter_pa;
 	dma_addr_t pm_conf_pa;
 	dma_addr_t rss_conf_pa;
+
+	struct bpf_prog __rcu *xdp_prog;
 };
 
 #define VMXNET3_WRITE_BAR0_REG(adapter, reg, val)  \
@@ -423,6 +436,10 @@ struct vmxnet3_adapter {
 #define VMXNET3_MAX_ETH_HDR_SIZE    22
 #define VMXNET3_MAX_SKB_BUF_SIZE    (3*1024)
 
+/* XDP only sees packets that fit in a single ring 0 buffer */
+#define VMXNET3_XDP_MAX_MTU \
+	(VMXNET3_MAX_SKB_BUF_SIZE - VMXNET3_MAX_ETH_HDR_SIZE)
+
 #define VMXNET3_GET_RING_IDX(adapter, rqID)		\
 	((rqID >= adapter->num_rx_queues &&		\
 	 rqID < 2 * adapter->num_rx_queues) ? 1 : 0)	\
@@ -6,6 +6,8 @@
 #include "allowedips.h"
 #include "peer.h"
 
+static struct kmem_cache *node_cache;
+
 static void swap_endian(u8 *dst, const u8 *src, u8 bits)
 {
 	if (bits == 32) {
@@ -40,6 +42,12 @@ static void push_rcu(struct allowedips_node **stack,
 	}
 }
 
+static void node_free_rcu(struct rcu_head *rcu)
+{
+	kmem_cache_free(node_cache,
+			container_of(rcu, struct allowedips_node, rcu));
+}
+
 static void root_free_rcu(struct rcu_head *rcu)
 {
 	struct allowedips_node *node, *stack[128] = {
@@ -49,7 +57,7 @@ static void root_free_rcu(struct rcu_head *rcu)
 	while (len > 0 && (node = stack[--len])) {
 		push_rcu(stack, node->bit[0], &len);
 		push_rcu(stack, node->bit[1], &len);
-		kfree(node);
+		kmem_cache_free(node_cache, node);
 	}
 }
 
@@ -66,8 +74,102 @@ static void root_remove_peer_lists(struct allowedips_node *root)
 	}
 }
 
+static unsigned int fls128(u64 a, u64 b)
+{
+	return a ? fls64(a) + 64U : fls64(b);
+}
+
+static u8 common_bits(const struct allowedips_node *node, const u8 *key,
+		      u8 bits)
+{
+	if (bits == 32)
+		return 32U - fls(*(const u32 *)node->bits ^ *(const u32 *)key);
+	else if (bits == 128)
+		return 128U - fls128(
+			*(const u64 *)&node->bits[0] ^ *(const u64 *)&key[0],
+			*(const u64 *)&node->bits[8] ^ *(const u64 *)&key[8]);
+	return 0;
+}
+
+static bool prefix_matches(const struct allowedips_node *node, const u8 *key,
+			   u8 bits)
+{
+	/* This could be much faster if it actually just compared the common
+	 * bits properly, by precomputing a mask bswap(~0 << (32 - cidr)), and
+	 * the rest, but it turns out that common_bits is already super fast on
+	 * modern processors, even taking into account the unfortunate bswap.
+	 * So, we just inline it like this instead.
+	 */
+	return common_bits(node, key, bits) >= node->cidr;
+}
+
+static unsigned int stride_index(const u8 *key, u8 bits)
+{
+	if (bits == 32)
+		return *(const u32 *)key >> (32 - ALLOWEDIPS_STRIDE_BITS);
+	return *(const u64 *)key >> (64 - ALLOWEDIPS_STRIDE_BITS);
+}
+
+/* Walks the levels of the trie that are above ALLOWEDIPS_STRIDE_BITS for every
+ * key that falls into the given slot. Those levels only ever look at the bits
+ * that make up the slot index, so the walk is the same for all of them.
+ */
+static void stride_fill_slot(struct allowedips_slot *slot,
+			     struct allowedips_node __rcu *trie, u8 bits,
+			     unsigned int index, struct mutex *lock)
+{
+	/* Aligned so it can be passed to fls/fls64 */
+	u8 key[16] __aligned(__alignof(u64)) = { 0 };
+	struct allowedips_node *node, *found = NULL;
+
+	if (bits == 32)
+		*(u32 *)key = (u32)index << (32 - ALLOWEDIPS_STRIDE_BITS);
+	else
+		*(u64 *)key = (u64)index << (64 - ALLOWEDIPS_STRIDE_BITS);
+
+	node = rcu_dereference_protected(trie, lockdep_is_held(lock));
+	while (node && node->cidr < ALLOWEDIPS_STRIDE_BITS &&
+	       prefix_matches(node, key, bits)) {
+		if (rcu_access_pointer(node->peer))
+			found = node;
+		node = rcu_dereference_protected(CHOOSE_NODE(node, key),
+						 lockdep_is_held(lock));
+	}
+	rcu_assign_pointer(slot->found, found);
+	rcu_assign_pointer(slot->resume, node);
+}
+
+/* Refreshes the slots covered by key/cidr, or all of them if key is NULL. A
+ * concurrent lookup may pair a found and a resume from before and after the
+ * update, which only ever yields an answer that was valid in one of the two
+ * tries, as with the rest of the trie updates.
+ */
+static void stride_update(struct allowedips_stride __rcu *stride,
+			  struct allowedips_node __rcu *trie, u8 bits,
+			  const u8 *key, u8 cidr, struct mutex *lock)
+{
+	struct allowedips_stride *table = rcu_dereference_protected(stride,
+						lockdep_is_held(lock));
+	unsigned int i, first = 0, count = ARRAY_SIZE(table->slot);
+
+	if (unlikely(!table))
+		return;
+	if (key) {
+		first = stride_index(key, bits);
+		count = 1;
+		if (cidr < ALLOWEDIPS_STRIDE_BITS) {
+			count = 1U << (ALLOWEDIPS_STRIDE_BITS - cidr);
+			first &= ~(count - 1);
+		}
+	}
+	for (i = first; i < first + count; ++i)
+		stride_fill_slot(&table->slot[i], trie, bits, i, lock);
+}
+
 static void walk_remove_by_peer(struct allowedips_node __rcu **top,
-				struct wg_peer *peer, struct mutex *lock)
+				struct allowedips_stride __rcu *stride,
+				u8 bits, struct wg_peer *peer,
+				struct mutex *lock)
 {
 #define REF(p) rcu_access_pointer(p)
 #define DEREF(p) rcu_dereference_protected(*(p), lockdep_is_held(lock))
@@ -77,7 +179,8 @@ static void walk_remove_by_peer(struct allowedips_node __rcu **top,
 	})
 
 	struct allowedips_node __rcu **stack[128], **nptr;
-	struct allowedips_node *node, *prev;
+	struct allowedips_node *node, *prev, *tmp;
+	LIST_HEAD(unlinked);
 	unsigned int len;
 
 	if (unlikely(!peer || !REF(*top)))
@@ -107,7 +210,7 @@ static void walk_remove_by_peer(struct allowedips_node __rcu **top,
 				if (!node->bit[0] || !node->bit[1]) {
 					rcu_assign_pointer(*nptr, DEREF(
 					       &node->bit[!REF(node->bit[0])]));
-					kfree_rcu(node, rcu);
+					list_add(&node->peer_list, &unlinked);
 					node = DEREF(nptr);
 				}
 			}
@@ -115,44 +218,34 @@ static void walk_remove_by_peer(struct allowedips_node __rcu **top,
 		}
 	}
 
+	/* The stride table may still point at the unlinked nodes, so it has to
+	 * be brought up to date before they are queued for freeing.
+	 */
+	stride_update(stride, *top, bits, NULL, 0, lock);
+	list_for_each_entry_safe(node, tmp, &unlinked, peer_list)
+		call_rcu(&node->rcu, node_free_rcu);
+
 #undef REF
 #undef DEREF
 #undef PUSH
 }
 
-static unsigned int fls128(u64 a, u64 b)
+static struct allowedips_node *find_node(struct allowedips_node *trie,
+					 struct allowedips_stride *stride,
+					 u8 bits, const u8 *key)
 {
-	return a ? fls64(a) + 64U : fls64(b);
-}
-
-static u8 common_bits(const struct allowedips_node *node, const u8 *key,
-		      u8 bits)
-{
-	if (bits == 32)
-		return 32U - fls(*(const u32 *)node->bits ^ *(const u32 *)key);
-	else if (bits == 128)
-		return 128U - fls128(
-			*(const u64 *)&node->bits[0] ^ *(const u64 *)&key[0],
-			*(const u64 *)&node->bits[8] ^ *(const u64 *)&key[8]);
-	return 0;
-}
+	struct allowedips_node *node = trie, *found = NULL;
 
-static bool prefix_matches(const struct allowedips_node *node, const u8 *key,
-			   u8 bits)
-{
-	/* This could be much faster if it actually just compared the common
-	 * bits properly, by precomputing a mask bswap(~0 << (32 - cidr)), and
-	 * the rest, but it turns out that common_bits is already super fast on
-	 * modern processors, even taking into account the unfortunate bswap.
-	 * So, we just inline it like this instead.
-	 */
-	return common_bits(node, key, bits) >= node->cidr;
-}
+	/* Jump over the top levels of the trie in one step. */
+	if (likely(stride)) {
+		const struct allowedips_slot *slot =
+			&stride->slot[stride_index(key, bits)];
 
-static struct allowedips_node *find_node(struct allowedips_node *trie, u8 bits,
-					 const u8 *key)
-{
-	struct allowedips_node *node = trie, *found = NULL;
+		found = rcu_dereference_bh(slot->found);
+		if (found && !rcu_access_pointer(found->peer))
+			found = NULL;
+		node = rcu_dereference_bh(slot->resume);
+	}
 
 	while (node && prefix_matches(node, key, bits)) {
 		if (rcu_access_pointer(node->peer))
@@ -165,7 +258,8 @@ static struct allowedips_node *find_node(struct allowedips_node *trie, u8 bits,
 }
 
 /* Returns a strong reference to a peer */
-static struct wg_peer *lookup(struct allowedips_node __rcu *root, u8 bits,
+static struct wg_peer *lookup(struct allowedips_node __rcu *root,
+			      struct allowedips_stride __rcu *stride, u8 bits,
 			      const void *be_ip)
 {
 	/* Aligned so it can be passed to fls/fls64 */
@@ -177,7 +271,8 @@ static struct wg_peer *lookup(struct allowedips_node __rcu *root, u8 bits,
 
 	rcu_read_lock_bh();
 retry:
-	node = find_node(rcu_dereference_bh(root), bits, ip);
+	node = find_node(rcu_dereference_bh(root), rcu_dereference_bh(stride),
+			 bits, ip);
 	if (node) {
 		peer = wg_peer_get_maybe_zero(rcu_dereference_bh(node->peer));
 		if (!peer)
@@ -209,31 +304,41 @@ static bool node_placement(struct allowedips_node __rcu *trie, const u8 *key,
 	return exact;
 }
 
-static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
+static int add(struct allowedips_node __rcu **trie,
+	       struct allowedips_stride __rcu **stride, u8 bits, const u8 *key,
 	       u8 cidr, struct wg_peer *peer, struct mutex *lock)
 {
 	struct allowedips_node *node, *parent, *down, *newnode;
+	struct allowedips_stride *table;
 
 	if (unlikely(cidr > bits || !peer))
 		return -EINVAL;
 
+	if (unlikely(!rcu_access_pointer(*stride))) {
+		table = kzalloc(sizeof(*table), GFP_KERNEL);
+		if (unlikely(!table))
+			return -ENOMEM;
+		rcu_assign_pointer(*stride, table);
+		stride_update(*stride, *trie, bits, NULL, 0, lock);
+	}
+
 	if (!rcu_access_pointer(*trie)) {
-		node = kzalloc(sizeof(*node), GFP_KERNEL);
+		node = kmem_cache_zalloc(node_cache, GFP_KERNEL);
 		if (unlikely(!node))
 			return -ENOMEM;
 		RCU_INIT_POINTER(node->peer, peer);
 		list_add_tail(&node->peer_list, &peer->allowedips_list);
 		copy_and_assign_cidr(node, key, cidr, bits);
 		rcu_assign_pointer(*trie, node);
-		return 0;
+		goto out;
 	}
 	if (node_placement(*trie, key, cidr, bits, &node, lock)) {
 		rcu_assign_pointer(node->peer, peer);
 		list_move_tail(&node->peer_list, &peer->allowedips_list);
-		return 0;
+		goto out;
 	}
 
-	newnode = kzalloc(sizeof(*newnode), GFP_KERNEL);
+	newnode = kmem_cache_zalloc(node_cache, GFP_KERNEL);
 	if (unlikely(!newnode))
 		return -ENOMEM;
 	RCU_INIT_POINTER(newnode->peer, peer);
@@ -247,7 +352,7 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 						 lockdep_is_held(lock));
 		if (!down) {
 			rcu_assign_pointer(CHOOSE_NODE(node, key), newnode);
-			return 0;
+			goto out;
 		}
 	}
 	cidr = min(cidr, common_bits(down, key, bits));
@@ -261,10 +366,10 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 			rcu_assign_pointer(CHOOSE_NODE(parent, newnode->bits),
 					   newnode);
 	} else {
-		node = kzalloc(sizeof(*node), GFP_KERNEL);
+		node = kmem_cache_zalloc(node_cache, GFP_KERNEL);
 		if (unlikely(!node)) {
 			list_del(&newnode->peer_list);
-			kfree(newnode);
+			kmem_cache_free(node_cache, newnode);
 			return -ENOMEM;
 		}
 		INIT_LIST_HEAD(&node->peer_list);
@@ -278,22 +383,36 @@ static int add(struct allowedips_node __rcu **trie, u8 bits, const u8 *key,
 			rcu_assign_pointer(CHOOSE_NODE(parent, node->bits),
 					   node);
 	}
+out:
+	/* cidr is lowered to that of the new branching node above, if any. */
+	stride_update(*stride, *trie, bits, key, cidr, lock);
 	return 0;
 }
 
 void wg_allowedips_init(struct allowedips *table)
 {
 	table->root4 = table->root6 = NULL;
+	table->stride4 = table->stride6 = NULL;
 	table->seq = 1;
 }
 
 void wg_allowedips_free(struct allowedips *table, struct mutex *lock)
 {
 	struct allowedips_node __rcu *old4 = table->root4, *old6 = table->root6;
+	struct allowedips_stride *stride4 = rcu_dereference_protected(
+		table->stride4, lockdep_is_held(lock));
+	struct allowedips_stride *stride6 = rcu_dereference_protected(
+		table->stride6, lockdep_is_held(lock));
 
 	++table->seq;
 	RCU_INIT_POINTER(table->root4, NULL);
 	RCU_INIT_POINTER(table->root6, NULL);
+	RCU_INIT_POINTER(table->stride4, NULL);
+	RCU_INIT_POINTER(table->stride6, NULL);
+	if (stride4)
+		kfree_rcu(stride4, rcu);
+	if (stride6)
+		kfree_rcu(stride6, rcu);
 	if (rcu_access_pointer(old4)) {
 		struct allowedips_node *node = rcu_dereference_protected(old4,
 							lockdep_is_held(lock));
@@ -318,7 +437,7 @@ int wg_allowedips_insert_v4(struct allowedips *table, const struct in_addr *ip,
 
 	++table->seq;
 	swap_endian(key, (const u8 *)ip, 32);
-	return add(&table->root4, 32, key, cidr, peer, lock);
+	return add(&table->root4, &table->stride4, 32, key, cidr, peer, lock);
 }
 
 int wg_allowedips_insert_v6(struct allowedips *table, const struct in6_addr *ip,
@@ -329,15 +448,16 @@ int wg_allowedips_insert_v6(struct allowedips *table, const struct in6_addr *ip,
 
 	++table->seq;
 	swap_endian(key, (const u8 *)ip, 128);
-	return add(&table->root6, 128, key, cidr, peer, lock);
+	return add(&table->root6, &table->stride6, 128, key, cidr, peer,
+		   lock);
 }
 
 void wg_allowedips_remove_by_peer(struct allowedips *table,
 				  struct wg_peer *peer, struct mutex *lock)
 {
 	++table->seq;
-	walk_remove_by_peer(&table->root4, peer, lock);
-	walk_remove_by_peer(&table->root6, peer, lock);
+	walk_remove_by_peer(&table->root4, table->stride4, 32, peer, lock);
+	walk_remove_by_peer(&table->root6, table->stride6, 128, peer, lock);
 }
 
 int wg_allowedips_read_node(struct allowedips_node *node, u8 ip[16], u8 *cidr)
@@ -357,9 +477,11 @@ struct wg_peer *wg_allowedips_lookup_dst(struct allowedips *table,
 					 struct sk_buff *skb)
 {
 	if (skb->protocol == htons(ETH_P_IP))
-		return lookup(table->root4, 32, &ip_hdr(skb)->daddr);
+		return lookup(table->root4, table->stride4, 32,
+			      &ip_hdr(skb)->daddr);
 	else if (skb->protocol == htons(ETH_P_IPV6))
-		return lookup(table->root6, 128, &ipv6_hdr(skb)->daddr);
+		return lookup(table->root6, table->stride6, 128,
+			      &ipv6_hdr(skb)->daddr);
 	return NULL;
 }
 
@@ -368,10 +490,24 @@ struct wg_peer *wg_allowedips_lookup_src(struct allowedips *table,
 					 struct sk_buff *skb)
 {
 	if (skb->protocol == htons(ETH_P_IP))
-		return lookup(table->root4, 32, &ip_hdr(skb)->saddr);
+		return lookup(table->root4, table->stride4, 32,
+			      &ip_hdr(skb)->saddr);
 	else if (skb->protocol == htons(ETH_P_IPV6))
-		return lookup(table->root6, 128, &ipv6_hdr(skb)->saddr);
+		return lookup(table->root6, table->stride6, 128,
+			      &ipv6_hdr(skb)->saddr);
 	return NULL;
 }
 
+int __init wg_allowedips_slab_init(void)
+{
+	node_cache = KMEM_CACHE(allowedips_node, SLAB_HWCACHE_ALIGN);
+	return node_cache ? 0 : -ENOMEM;
+}
+
+void wg_allowedips_slab_uninit(void)
+{
+	rcu_barrier();
+	kmem_cache_destroy(node_cache);
+}
+
 #include "selftest/allowedips.c"
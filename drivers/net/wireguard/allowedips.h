@@ -29,12 +29,33 @@ struct allowedips_node {
 	};
 };
 
+enum { ALLOWEDIPS_STRIDE_BITS = 8 };
+
+/* Where a lookup for a key whose top ALLOWEDIPS_STRIDE_BITS bits index this
+ * slot picks up: found is the most specific node with a peer above that
+ * depth, and resume is the first node at or below it.
+ */
+struct allowedips_slot {
+	struct allowedips_node __rcu *found;
+	struct allowedips_node __rcu *resume;
+};
+
+struct allowedips_stride {
+	struct allowedips_slot slot[1U << ALLOWEDIPS_STRIDE_BITS];
+	struct rcu_head rcu;
+};
+
 struct allowedips {
 	struct allowedips_node __rcu *root4;
 	struct allowedips_node __rcu *root6;
+	struct allowedips_stride __rcu *stride4;
+	struct allowedips_stride __rcu *stride6;
 	u64 seq;
 };
 
+int wg_allowedips_slab_init(void);
+void wg_allowedips_slab_uninit(void);
+
 void wg_allowedips_init(struct allowedips *table);
 void wg_allowedips_free(struct allowedips *table, struct mutex *mutex);
 int wg_allowedips_insert_v4(struct allowedips *table, const struct in_addr *ip,
@@ -151,7 +151,14 @@ static netdev_tx_t wg_xmit(struct sk_buff *skb, struct net_device *dev)
 	mtu = skb_dst(skb) ? dst_mtu(skb_dst(skb)) : dev->mtu;
 
 	__skb_queue_head_init(&packets);
-	if (!skb_is_gso(skb)) {
+	/* GSO super-packets built by the local stack are queued as they are,
+	 * and are only split into segments by the encryption workers, which
+	 * reserve one nonce per segment based on gso_segs. Packets that come
+	 * from untrusted sources do not have a trustworthy gso_segs, so those
+	 * are still segmented here.
+	 */
+	if (!skb_is_gso(skb) || (!(skb_shinfo(skb)->gso_type & SKB_GSO_DODGY) &&
+				 skb_shinfo(skb)->gso_segs)) {
 		skb_mark_not_on_list(skb);
 	} else {
 		struct sk_buff *segs = skb_gso_segment(skb, 0);
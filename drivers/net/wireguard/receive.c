@@ -17,13 +17,14 @@
 #include <net/ip_tunnels.h>
 
 /* Must be called with bh disabled. */
-static void update_rx_stats(struct wg_peer *peer, size_t len)
+static void update_rx_stats(struct wg_peer *peer, unsigned int packets,
+			    size_t len)
 {
 	struct pcpu_sw_netstats *tstats =
 		get_cpu_ptr(peer->device->dev->tstats);
 
 	u64_stats_update_begin(&tstats->syncp);
-	++tstats->rx_packets;
+	tstats->rx_packets += packets;
 	tstats->rx_bytes += len;
 	peer->rx_bytes += len;
 	u64_stats_update_end(&tstats->syncp);
@@ -202,7 +203,7 @@ static void wg_receive_handshake_packet(struct wg_device *wg,
 	}
 
 	local_bh_disable();
-	update_rx_stats(peer, skb->len);
+	update_rx_stats(peer, 1, skb->len);
 	local_bh_enable();
 
 	wg_timers_any_authenticated_packet_received(peer);
@@ -339,37 +340,67 @@ static bool counter_validate(union noise_counter *counter, u64 their_counter)
 
 #include "selftest/counter.c"
 
+/* Per-peer state updated once per NAPI poll rather than once per packet:
+ * all the packets of one poll come from the same peer, so only the last
+ * authenticated endpoint and the totals matter.
+ */
+struct rx_batch {
+	struct endpoint endpoint;
+	unsigned int packets;
+	size_t bytes;
+	bool authenticated;
+	bool data_received;
+};
+
+static void wg_packet_consume_batch_done(struct wg_peer *peer,
+					 struct rx_batch *batch)
+{
+	if (!batch->authenticated)
+		return;
+
+	wg_socket_set_peer_endpoint(peer, &batch->endpoint);
+	if (batch->packets)
+		update_rx_stats(peer, batch->packets, batch->bytes);
+
+	keep_key_fresh(peer);
+
+	wg_timers_any_authenticated_packet_received(peer);
+	wg_timers_any_authenticated_packet_traversal(peer);
+	if (batch->data_received)
+		wg_timers_data_received(peer);
+}
+
 static void wg_packet_consume_data_done(struct wg_peer *peer,
 					struct sk_buff *skb,
-					struct endpoint *endpoint)
+					struct endpoint *endpoint,
+					struct rx_batch *batch)
 {
 	struct net_device *dev = peer->device->dev;
 	unsigned int len, len_before_trim;
 	struct wg_peer *routed_peer;
 
-	wg_socket_set_peer_endpoint(peer, endpoint);
+	batch->endpoint = *endpoint;
+	batch->authenticated = true;
 
 	if (unlikely(wg_noise_received_with_keypair(&peer->keypairs,
 						    PACKET_CB(skb)->keypair))) {
+		/* staged packets must go to where this one came from */
+		wg_socket_set_peer_endpoint(peer, endpoint);
 		wg_timers_handshake_complete(peer);
 		wg_packet_send_staged_packets(peer);
 	}
 
-	keep_key_fresh(peer);
-
-	wg_timers_any_authenticated_packet_received(peer);
-	wg_timers_any_authenticated_packet_traversal(peer);
-
 	/* A packet with length 0 is a keepalive packet */
 	if (unlikely(!skb->len)) {
-		update_rx_stats(peer, message_data_len(0));
+		++batch->packets;
+		batch->bytes += message_data_len(0);
 		net_dbg_ratelimited("%s: Receiving keepalive packet from peer %llu (%pISpfsc)\n",
 				    dev->name, peer->internal_id,
 				    &peer->endpoint.addr);
 		goto packet_processed;
 	}
 
-	wg_timers_data_received(peer);
+	batch->data_received = true;
 
 	if (unlikely(skb_network_header(skb) < skb->head))
 		goto dishonest_packet_size;
@@ -423,7 +454,8 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 				    dev->name, peer->internal_id,
 				    &peer->endpoint.addr);
 	} else {
-		update_rx_stats(peer, message_data_len(len_before_trim));
+		++batch->packets;
+		batch->bytes += message_data_len(len_before_trim);
 	}
 	return;
 
@@ -454,6 +486,7 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 {
 	struct wg_peer *peer = container_of(napi, struct wg_peer, napi);
 	struct crypt_queue *queue = &peer->rx_queue;
+	struct rx_batch batch = { 0 };
 	struct noise_keypair *keypair;
 	struct endpoint endpoint;
 	enum packet_state state;
@@ -488,7 +521,7 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 			goto next;
 
 		wg_reset_packet(skb);
-		wg_packet_consume_data_done(peer, skb, &endpoint);
+		wg_packet_consume_data_done(peer, skb, &endpoint, &batch);
 		free = false;
 
 next:
@@ -501,23 +534,41 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 			break;
 	}
 
+	/* Peer removal disables the napi before dropping the last reference,
+	 * so the peer is still valid here even if the loop put its packets.
+	 */
+	peer = container_of(napi, struct wg_peer, napi);
+	wg_packet_consume_batch_done(peer, &batch);
+
 	if (work_done < budget)
 		napi_complete_done(napi, work_done);
 
 	return work_done;
 }
 
+#define DECRYPT_BATCH 32
+
 void wg_packet_decrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
-	struct sk_buff *skb;
+	struct sk_buff *skbs[DECRYPT_BATCH];
+	int i, n;
 
-	while ((skb = ptr_ring_consume_bh(&queue->ring)) != NULL) {
-		enum packet_state state = likely(decrypt_packet(skb,
-				&PACKET_CB(skb)->keypair->receiving)) ?
-				PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
-		wg_queue_enqueue_per_peer_napi(skb, state);
+	/* Take a slice of the ring at a time, so that the ring lock and the
+	 * bh toggling are paid once per batch rather than once per packet.
+	 */
+	while ((n = ptr_ring_consume_batched_bh(&queue->ring, (void **)skbs,
+						DECRYPT_BATCH)) > 0) {
+		for (i = 0; i < n; ++i) {
+			enum packet_state state = PACKET_STATE_DEAD;
+			struct sk_buff *skb = skbs[i];
+
+			if (likely(decrypt_packet(skb,
+					&PACKET_CB(skb)->keypair->receiving)))
+				state = PACKET_STATE_CRYPTED;
+			wg_queue_enqueue_per_peer_napi(skb, state);
+		}
 	}
 }
 
@@ -10,9 +10,12 @@
  * to graphviz (the dot command) to visualize it. If you define the macro
  * DEBUG_RANDOM_TRIE to be 1, then there will be an extremely costly set of
  * randomized tests done against a trivial implementation, which may take
- * upwards of a half-hour to complete. There's no set of users who should be
- * enabling these, and the only developers that should go anywhere near these
- * nobs are the ones who are reading this comment.
+ * upwards of a half-hour to complete. If you define the macro
+ * DEBUG_BENCHMARK_TRIE to be 1, then a large table of random routes spread
+ * over many peers is built, and the lookup cost with and without the stride
+ * table is printed. There's no set of users who should be enabling these, and
+ * the only developers that should go anywhere near these nobs are the ones
+ * who are reading this comment.
  */
 
 #ifdef DEBUG
@@ -89,6 +92,12 @@ enum {
 	NUM_QUERIES = NUM_RAND_ROUTES * NUM_MUTATED_ROUTES * 30
 };
 
+enum {
+	NUM_BENCH_PEERS = 4000,
+	NUM_BENCH_ROUTES = 100000,
+	NUM_BENCH_QUERIES = NUM_BENCH_ROUTES * 20
+};
+
 struct horrible_allowedips {
 	struct hlist_head head;
 };
@@ -398,7 +407,7 @@ static __init bool randomized_test(void)
 
 	for (i = 0; i < NUM_QUERIES; ++i) {
 		prandom_bytes(ip, 4);
-		if (lookup(t.root4, 32, ip) !=
+		if (lookup(t.root4, t.stride4, 32, ip) !=
 		    horrible_allowedips_lookup_v4(&h, (struct in_addr *)ip)) {
 			pr_err("allowedips random self-test: FAIL\n");
 			goto free;
@@ -407,7 +416,7 @@ static __init bool randomized_test(void)
 
 	for (i = 0; i < NUM_QUERIES; ++i) {
 		prandom_bytes(ip, 16);
-		if (lookup(t.root6, 128, ip) !=
+		if (lookup(t.root6, t.stride6, 128, ip) !=
 		    horrible_allowedips_lookup_v6(&h, (struct in6_addr *)ip)) {
 			pr_err("allowedips random self-test: FAIL\n");
 			goto free;
@@ -429,6 +438,102 @@ static __init bool randomized_test(void)
 	return ret;
 }
 
+static __init u64 benchmark_lookups(struct allowedips_node __rcu *root,
+				    struct allowedips_stride __rcu *stride,
+				    u8 bits, u8 (*ips)[16])
+{
+	u64 start = ktime_get_ns();
+	unsigned int i;
+
+	for (i = 0; i < NUM_BENCH_QUERIES; ++i)
+		lookup(root, stride, bits, ips[i % NUM_BENCH_ROUTES]);
+	return div_u64(ktime_get_ns() - start, NUM_BENCH_QUERIES);
+}
+
+static __init bool benchmark(void)
+{
+	struct allowedips_stride __rcu *no_stride = NULL;
+	u64 trie4, trie6, stride4, stride6;
+	struct wg_peer **peers;
+	DEFINE_MUTEX(mutex);
+	struct allowedips t;
+	bool ret = false;
+	u8 (*ips)[16];
+	unsigned int i;
+
+	mutex_init(&mutex);
+	wg_allowedips_init(&t);
+
+	ips = kvmalloc_array(NUM_BENCH_ROUTES, sizeof(*ips), GFP_KERNEL);
+	peers = kcalloc(NUM_BENCH_PEERS, sizeof(*peers), GFP_KERNEL);
+	if (unlikely(!ips || !peers)) {
+		pr_err("allowedips benchmark malloc: FAIL\n");
+		goto free;
+	}
+	for (i = 0; i < NUM_BENCH_PEERS; ++i) {
+		peers[i] = kzalloc(sizeof(*peers[i]), GFP_KERNEL);
+		if (unlikely(!peers[i])) {
+			pr_err("allowedips benchmark malloc: FAIL\n");
+			goto free;
+		}
+		kref_init(&peers[i]->refcount);
+		INIT_LIST_HEAD(&peers[i]->allowedips_list);
+	}
+
+	mutex_lock(&mutex);
+	for (i = 0; i < NUM_BENCH_ROUTES; ++i) {
+		prandom_bytes(ips[i], 16);
+		if (wg_allowedips_insert_v4(&t, (struct in_addr *)ips[i],
+				prandom_u32_max(17) + 16,
+				peers[prandom_u32_max(NUM_BENCH_PEERS)],
+				&mutex) < 0 ||
+		    wg_allowedips_insert_v6(&t, (struct in6_addr *)ips[i],
+				prandom_u32_max(97) + 32,
+				peers[prandom_u32_max(NUM_BENCH_PEERS)],
+				&mutex) < 0) {
+			pr_err("allowedips benchmark malloc: FAIL\n");
+			goto free_locked;
+		}
+	}
+	mutex_unlock(&mutex);
+
+	/* Every query is one of the inserted addresses, so each has a match,
+	 * and the stride table must agree with the plain trie walk.
+	 */
+	for (i = 0; i < NUM_BENCH_ROUTES; ++i) {
+		if (!lookup(t.root4, t.stride4, 32, ips[i]) ||
+		    lookup(t.root4, t.stride4, 32, ips[i]) !=
+		    lookup(t.root4, no_stride, 32, ips[i]) ||
+		    !lookup(t.root6, t.stride6, 128, ips[i]) ||
+		    lookup(t.root6, t.stride6, 128, ips[i]) !=
+		    lookup(t.root6, no_stride, 128, ips[i])) {
+			pr_err("allowedips benchmark: FAIL\n");
+			goto free;
+		}
+	}
+
+	trie4 = benchmark_lookups(t.root4, no_stride, 32, ips);
+	stride4 = benchmark_lookups(t.root4, t.stride4, 32, ips);
+	trie6 = benchmark_lookups(t.root6, no_stride, 128, ips);
+	stride6 = benchmark_lookups(t.root6, t.stride6, 128, ips);
+	pr_info("allowedips benchmark: %u routes per family, v4 %llu ns/lookup (%llu ns without stride), v6 %llu ns/lookup (%llu ns without stride)\n",
+		NUM_BENCH_ROUTES, stride4, trie4, stride6, trie6);
+	ret = true;
+
+free:
+	mutex_lock(&mutex);
+free_locked:
+	wg_allowedips_free(&t, &mutex);
+	mutex_unlock(&mutex);
+	if (peers) {
+		for (i = 0; i < NUM_BENCH_PEERS; ++i)
+			kfree(peers[i]);
+	}
+	kfree(peers);
+	kvfree(ips);
+	return ret;
+}
+
 static __init inline struct in_addr *ip4(u8 a, u8 b, u8 c, u8 d)
 {
 	static struct in_addr ip;
@@ -477,13 +582,15 @@ static __init struct wg_peer *init_peer(void)
 	} while (0)
 
 #define test(version, mem, ipa, ipb, ipc, ipd) do {                          \
-		bool _s = lookup(t.root##version, (version) == 4 ? 32 : 128, \
+		bool _s = lookup(t.root##version, t.stride##version,         \
+				 (version) == 4 ? 32 : 128,                  \
 				 ip##version(ipa, ipb, ipc, ipd)) == (mem);  \
 		maybe_fail();                                                \
 	} while (0)
 
 #define test_negative(version, mem, ipa, ipb, ipc, ipd) do {                 \
-		bool _s = lookup(t.root##version, (version) == 4 ? 32 : 128, \
+		bool _s = lookup(t.root##version, t.stride##version,         \
+				 (version) == 4 ? 32 : 128,                  \
 				 ip##version(ipa, ipb, ipc, ipd)) != (mem);  \
 		maybe_fail();                                                \
 	} while (0)
@@ -656,6 +763,9 @@ bool __init wg_allowedips_selftest(void)
 	if (IS_ENABLED(DEBUG_RANDOM_TRIE) && success)
 		success = randomized_test();
 
+	if (IS_ENABLED(DEBUG_BENCHMARK_TRIE) && success)
+		success = benchmark();
+
 	if (success)
 		pr_info("allowedips self-tests: pass\n");
 
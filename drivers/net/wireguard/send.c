@@ -216,6 +216,35 @@ static bool encrypt_packet(struct sk_buff *skb, struct noise_keypair *keypair)
 						   keypair->sending.key);
 }
 
+/* Splits a GSO super-packet into its segments, handing them the consecutive
+ * nonces that were reserved for it when it was staged, and links the last one
+ * to next. The original skb is left for the caller to dispose of.
+ */
+static struct sk_buff *segment_packet(struct sk_buff *skb,
+				      struct sk_buff *next)
+{
+	unsigned int i = 0, reserved = skb_shinfo(skb)->gso_segs;
+	u64 nonce = PACKET_CB(skb)->nonce;
+	struct sk_buff *segs, *seg;
+
+	segs = skb_gso_segment(skb, 0);
+	if (unlikely(IS_ERR_OR_NULL(segs)))
+		return segs ? segs : ERR_PTR(-EINVAL);
+
+	for (seg = segs;; seg = seg->next) {
+		/* Never reuse a nonce beyond the ones reserved. */
+		if (unlikely(i == reserved)) {
+			kfree_skb_list(segs);
+			return ERR_PTR(-EMSGSIZE);
+		}
+		PACKET_CB(seg)->nonce = nonce + i++;
+		if (!seg->next)
+			break;
+	}
+	seg->next = next;
+	return segs;
+}
+
 void wg_packet_send_keepalive(struct wg_peer *peer)
 {
 	struct sk_buff *skb;
@@ -237,18 +266,98 @@ void wg_packet_send_keepalive(struct wg_peer *peer)
 	wg_packet_send_staged_packets(peer);
 }
 
+/* The UDP length field, and the IP length field under it, must be able to
+ * describe the whole train.
+ */
+#define WG_GSO_MAX_SIZE \
+	(U16_MAX - sizeof(struct ipv6hdr) - sizeof(struct udphdr))
+
+/* Returns true if skb can be chained after head as one more segment of a UDP
+ * GSO train. All segments but the last must be exactly gso_size long, and
+ * must be linear so that skb_segment() can hand each one out as a clone.
+ */
+static bool gso_train_can_append(struct sk_buff *head, struct sk_buff *tail,
+				 struct sk_buff *skb, unsigned int count)
+{
+	if (count >= UDP_MAX_SEGMENTS || skb_is_nonlinear(skb) ||
+	    PACKET_CB(skb)->ds != PACKET_CB(head)->ds ||
+	    head->len + skb->len > WG_GSO_MAX_SIZE)
+		return false;
+	if (head == tail)
+		return !skb_is_nonlinear(head) && skb->len <= head->len;
+	return tail->len == skb_shinfo(head)->gso_size && skb->len <= tail->len;
+}
+
+/* Turns head, whose frag_list holds count - 1 further encrypted packets, into
+ * a UDP GSO skb. The UDP header is pushed later by the tunnel xmit helpers,
+ * so the checksum start is set to where it will land.
+ */
+static void gso_train_finalize(struct sk_buff *head, unsigned int count)
+{
+	if (count < 2)
+		return;
+	skb_shinfo(head)->gso_type = SKB_GSO_UDP_L4;
+	skb_shinfo(head)->gso_segs = count;
+	head->ip_summed = CHECKSUM_PARTIAL;
+	head->csum_start = skb_headroom(head) - sizeof(struct udphdr);
+	head->csum_offset = offsetof(struct udphdr, check);
+}
+
 static void wg_packet_create_data_done(struct sk_buff *first,
 				       struct wg_peer *peer)
 {
-	struct sk_buff *skb, *next;
-	bool is_keepalive, data_sent = false;
+	struct sk_buff *skb, *next, *head = NULL, *tail = NULL;
+	bool train_has_data = false, data_sent = false;
+	unsigned int count = 0;
 
 	wg_timers_any_authenticated_packet_traversal(peer);
 	wg_timers_any_authenticated_packet_sent(peer);
 	skb_list_walk_safe(first, skb, next) {
-		is_keepalive = skb->len == message_data_len(0);
-		if (likely(!wg_socket_send_skb_to_peer(peer, skb,
-				PACKET_CB(skb)->ds) && !is_keepalive))
+		skb_mark_not_on_list(skb);
+
+		/* A GSO super-packet that was split by the encryption worker
+		 * only stays around as the carrier of the list.
+		 */
+		if (unlikely(skb_is_gso(skb))) {
+			consume_skb(skb);
+			continue;
+		}
+
+		if (head && gso_train_can_append(head, tail, skb, count)) {
+			if (head == tail) {
+				skb_shinfo(head)->gso_size = head->len;
+				skb_shinfo(head)->frag_list = skb;
+			} else {
+				tail->next = skb;
+			}
+			head->len += skb->len;
+			head->data_len += skb->len;
+			/* The truesize is not folded into head: every skb in
+			 * the train keeps its own destructor, which uncharges
+			 * its own truesize from the sending socket.
+			 */
+			tail = skb;
+			++count;
+		} else {
+			if (head) {
+				gso_train_finalize(head, count);
+				if (likely(!wg_socket_send_skb_to_peer(peer,
+						head, PACKET_CB(head)->ds) &&
+					   train_has_data))
+					data_sent = true;
+			}
+			head = tail = skb;
+			count = 1;
+			train_has_data = false;
+		}
+		if (skb->len != message_data_len(0))
+			train_has_data = true;
+	}
+	if (head) {
+		gso_train_finalize(head, count);
+		if (likely(!wg_socket_send_skb_to_peer(peer, head,
+						       PACKET_CB(head)->ds) &&
+			   train_has_data))
 			data_sent = true;
 	}
 
@@ -288,12 +397,32 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
-	struct sk_buff *first, *skb, *next;
+	struct sk_buff *first, *skb, *next, *prev, *segs;
 
 	while ((first = ptr_ring_consume_bh(&queue->ring)) != NULL) {
 		enum packet_state state = PACKET_STATE_CRYPTED;
 
+		prev = NULL;
 		skb_list_walk_safe(first, skb, next) {
+			if (unlikely(skb_is_gso(skb))) {
+				segs = segment_packet(skb, next);
+				if (unlikely(IS_ERR(segs))) {
+					state = PACKET_STATE_DEAD;
+					break;
+				}
+				/* The first skb is what the per-peer ring
+				 * points to, so it has to stay in the list.
+				 */
+				if (skb == first) {
+					first->next = segs;
+					prev = first;
+				} else {
+					prev->next = segs;
+					consume_skb(skb);
+				}
+				next = segs;
+				continue;
+			}
 			if (likely(encrypt_packet(skb,
 					PACKET_CB(first)->keypair))) {
 				wg_reset_packet(skb);
@@ -301,6 +430,7 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 				state = PACKET_STATE_DEAD;
 				break;
 			}
+			prev = skb;
 		}
 		wg_queue_enqueue_per_peer(&PACKET_PEER(first)->tx_queue, first,
 					  state);
@@ -348,6 +478,7 @@ void wg_packet_send_staged_packets(struct wg_peer *peer)
 	struct noise_keypair *keypair;
 	struct sk_buff_head packets;
 	struct sk_buff *skb;
+	u16 segs;
 
 	/* Steal the current queue into our local one. */
 	__skb_queue_head_init(&packets);
@@ -372,18 +503,21 @@ void wg_packet_send_staged_packets(struct wg_peer *peer)
 		goto out_invalid;
 
 	/* After we know we have a somewhat valid key, we now try to assign
-	 * nonces to all of the packets in the queue. If we can't assign nonces
-	 * for all of them, we just consider it a failure and wait for the next
-	 * handshake.
+	 * nonces to all of the packets in the queue. GSO super-packets get a
+	 * consecutive range, one for each segment they will be split into. If
+	 * we can't assign nonces for all of them, we just consider it a failure
+	 * and wait for the next handshake.
 	 */
 	skb_queue_walk(&packets, skb) {
+		segs = skb_is_gso(skb) ? skb_shinfo(skb)->gso_segs : 1;
 		/* 0 for no outer TOS: no leak. TODO: at some later point, we
 		 * might consider using flowi->tos as outer instead.
 		 */
 		PACKET_CB(skb)->ds = ip_tunnel_ecn_encap(0, ip_hdr(skb), skb);
 		PACKET_CB(skb)->nonce =
-				atomic64_inc_return(&key->counter.counter) - 1;
-		if (unlikely(PACKET_CB(skb)->nonce >= REJECT_AFTER_MESSAGES))
+			atomic64_add_return(segs, &key->counter.counter) - segs;
+		if (unlikely(PACKET_CB(skb)->nonce >=
+			     REJECT_AFTER_MESSAGES - segs + 1))
 			goto out_invalid;
 	}
 
@@ -124,6 +124,14 @@ struct xenvif_stats {
 	unsigned long tx_zerocopy_success;
 	unsigned long tx_zerocopy_fail;
 	unsigned long tx_frag_overflow;
+
+	/* Grant table batches issued and the ops they carried */
+	unsigned long tx_copy_batches;
+	unsigned long tx_copy_ops;
+	unsigned long tx_map_batches;
+	unsigned long tx_map_ops;
+	unsigned long rx_copy_batches;
+	unsigned long rx_copy_ops;
 };
 
 #define COPY_BATCH_SIZE 64
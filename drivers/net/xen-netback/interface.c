@@ -378,6 +378,33 @@ static const struct xenvif_stat {
 		"tx_frag_overflow",
 		offsetof(struct xenvif_stats, tx_frag_overflow)
 	},
+	/* Grant copy/map batches and the ops they carried; ops / batches
+	 * is the average number of grant ops per batch.
+	 */
+	{
+		"tx_copy_batches",
+		offsetof(struct xenvif_stats, tx_copy_batches)
+	},
+	{
+		"tx_copy_ops",
+		offsetof(struct xenvif_stats, tx_copy_ops)
+	},
+	{
+		"tx_map_batches",
+		offsetof(struct xenvif_stats, tx_map_batches)
+	},
+	{
+		"tx_map_ops",
+		offsetof(struct xenvif_stats, tx_map_ops)
+	},
+	{
+		"rx_copy_batches",
+		offsetof(struct xenvif_stats, rx_copy_batches)
+	},
+	{
+		"rx_copy_ops",
+		offsetof(struct xenvif_stats, rx_copy_ops)
+	},
 };
 
 static int xenvif_get_sset_count(struct net_device *dev, int string_set)
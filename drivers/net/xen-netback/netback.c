@@ -1331,12 +1331,16 @@ int xenvif_tx_action(struct xenvif_queue *queue, int budget)
 		return 0;
 
 	gnttab_batch_copy(queue->tx_copy_ops, nr_cops);
+	queue->stats.tx_copy_batches++;
+	queue->stats.tx_copy_ops += nr_cops;
 	if (nr_mops != 0) {
 		ret = gnttab_map_refs(queue->tx_map_ops,
 				      NULL,
 				      queue->pages_to_map,
 				      nr_mops);
 		BUG_ON(ret);
+		queue->stats.tx_map_batches++;
+		queue->stats.tx_map_ops += nr_mops;
 	}
 
 	work_done = xenvif_tx_submit(queue);
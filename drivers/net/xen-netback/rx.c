@@ -136,6 +136,10 @@ static void xenvif_rx_copy_flush(struct xenvif_queue *queue)
 	int notify;
 
 	gnttab_batch_copy(queue->rx_copy.op, queue->rx_copy.num);
+	if (queue->rx_copy.num) {
+		queue->stats.rx_copy_batches++;
+		queue->stats.rx_copy_ops += queue->rx_copy.num;
+	}
 
 	for (i = 0; i < queue->rx_copy.num; i++) {
 		struct gnttab_copy *op;
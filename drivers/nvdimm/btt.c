@@ -727,16 +727,26 @@ static int btt_rtt_init(struct arena_info *arena)
 	return 0;
 }
 
+/*
+ * The map locks only exist in memory, so unlike the lanes they need not be
+ * bound by the nfree of the on-media format. Size them by the number of
+ * CPUs that can be writing concurrently so that unrelated map updates
+ * rarely hash to the same lock.
+ */
 static int btt_maplocks_init(struct arena_info *arena)
 {
-	u32 i;
+	u32 i, nr;
+
+	nr = roundup_pow_of_two(max(arena->nfree, 4 * num_possible_cpus()));
+	arena->nr_map_locks = min_t(u32, nr, BTT_MAX_MAP_LOCKS);
+	arena->nr_map_locks = max(arena->nr_map_locks, arena->nfree);
 
-	arena->map_locks = kcalloc(arena->nfree, sizeof(struct aligned_lock),
-				GFP_KERNEL);
+	arena->map_locks = kcalloc(arena->nr_map_locks,
+				sizeof(struct aligned_lock), GFP_KERNEL);
 	if (!arena->map_locks)
 		return -ENOMEM;
 
-	for (i = 0; i < arena->nfree; i++)
+	for (i = 0; i < arena->nr_map_locks; i++)
 		spin_lock_init(&arena->map_locks[i].lock);
 
 	return 0;
@@ -1090,7 +1100,7 @@ static int lba_to_arena(struct btt *btt, sector_t sector, __u32 *premap,
 static void lock_map(struct arena_info *arena, u32 premap)
 		__acquires(&arena->map_locks[idx].lock)
 {
-	u32 idx = (premap * MAP_ENT_SIZE / L1_CACHE_BYTES) % arena->nfree;
+	u32 idx = (premap * MAP_ENT_SIZE / L1_CACHE_BYTES) % arena->nr_map_locks;
 
 	spin_lock(&arena->map_locks[idx].lock);
 }
@@ -1098,7 +1108,7 @@ static void lock_map(struct arena_info *arena, u32 premap)
 static void unlock_map(struct arena_info *arena, u32 premap)
 		__releases(&arena->map_locks[idx].lock)
 {
-	u32 idx = (premap * MAP_ENT_SIZE / L1_CACHE_BYTES) % arena->nfree;
+	u32 idx = (premap * MAP_ENT_SIZE / L1_CACHE_BYTES) % arena->nr_map_locks;
 
 	spin_unlock(&arena->map_locks[idx].lock);
 }
@@ -1203,11 +1213,15 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 	struct arena_info *arena = NULL;
 	u32 lane = 0, premap, postmap;
 
+	/*
+	 * The lane only names this reader's RTT slot, so a single lane
+	 * covers all the sectors of the page.
+	 */
+	lane = nd_region_acquire_lane(btt->nd_region);
+
 	while (len) {
 		u32 cur_len;
 
-		lane = nd_region_acquire_lane(btt->nd_region);
-
 		ret = lba_to_arena(btt, sector, &premap, &arena);
 		if (ret)
 			goto out_lane;
@@ -1230,7 +1244,7 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 
 			if (t_flag) {
 				zero_fill_data(page, off, cur_len);
-				goto out_lane;
+				goto next;
 			}
 
 			if (e_flag) {
@@ -1276,13 +1290,13 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 		}
 
 		arena->rtt[lane] = RTT_INVALID;
-		nd_region_release_lane(btt->nd_region, lane);
-
+ next:
 		len -= cur_len;
 		off += cur_len;
 		sector += btt->sector_size >> SECTOR_SHIFT;
 	}
 
+	nd_region_release_lane(btt->nd_region, lane);
 	return 0;
 
  out_rtt:
@@ -256,6 +256,46 @@ static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
 	return found;
 }
 
+/*
+ * Pick the path with the lowest load: the number of requests outstanding on
+ * its controller or, for service-time, the time a new request can expect to
+ * wait for those and itself at the path's average service time.
+ */
+static struct nvme_ns *nvme_least_loaded_path(struct nvme_ns_head *head,
+		bool service_time)
+{
+	u64 cost, found_cost = U64_MAX, fallback_cost = U64_MAX;
+	struct nvme_ns *found = NULL, *fallback = NULL, *ns;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		cost = atomic_read(&ns->ctrl->nr_active);
+		if (service_time)
+			cost = (cost + 1) * READ_ONCE(ns->ctrl->svc_time_ns);
+
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (cost < found_cost) {
+				found_cost = cost;
+				found = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (cost < fallback_cost) {
+				fallback_cost = cost;
+				fallback = ns;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return found ? found : fallback;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -267,6 +307,15 @@ inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	switch (READ_ONCE(head->subsys->iopolicy)) {
+	case NVME_IOPOLICY_QD:
+		return nvme_least_loaded_path(head, false);
+	case NVME_IOPOLICY_ST:
+		return nvme_least_loaded_path(head, true);
+	default:
+		break;
+	}
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (READ_ONCE(head->subsys->iopolicy) == NVME_IOPOLICY_RR && ns)
 		ns = nvme_round_robin_path(head, node, ns);
@@ -275,6 +324,58 @@ inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 	return ns;
 }
 
+/* Weight of a new sample in the service time average, as a shift */
+#define NVME_SVC_TIME_SHIFT	3
+
+/*
+ * Account a multipath request to its path while the subsystem uses a load
+ * based policy. Called once nvme_setup_cmd() has set it up for a queue.
+ */
+void nvme_mpath_start_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	int policy;
+
+	if (!(rq->cmd_flags & REQ_NVME_MPATH))
+		return;
+
+	policy = READ_ONCE(ns->head->subsys->iopolicy);
+	if (policy != NVME_IOPOLICY_QD && policy != NVME_IOPOLICY_ST)
+		return;
+
+	atomic_inc(&ns->ctrl->nr_active);
+	nvme_req(rq)->flags |= NVME_MPATH_CNT_ACTIVE;
+	nvme_req(rq)->start_time =
+		policy == NVME_IOPOLICY_ST ? ktime_get_ns() : 0;
+}
+
+/*
+ * Drop the request from its path's load and, if it completed rather than
+ * being torn down before it was issued, fold its service time into the
+ * path's average. The average may lose a concurrent update, which only
+ * drops a sample.
+ */
+void nvme_mpath_end_request(struct request *rq, bool completed)
+{
+	struct nvme_request *nreq = nvme_req(rq);
+	struct nvme_ctrl *ctrl = nreq->ctrl;
+	u64 avg, sample;
+
+	if (!(nreq->flags & NVME_MPATH_CNT_ACTIVE))
+		return;
+
+	nreq->flags &= ~NVME_MPATH_CNT_ACTIVE;
+	atomic_dec(&ctrl->nr_active);
+
+	if (!completed || !nreq->start_time)
+		return;
+
+	sample = ktime_get_ns() - nreq->start_time;
+	avg = READ_ONCE(ctrl->svc_time_ns);
+	WRITE_ONCE(ctrl->svc_time_ns, avg - (avg >> NVME_SVC_TIME_SHIFT) +
+			(sample >> NVME_SVC_TIME_SHIFT));
+}
+
 static bool nvme_available_path(struct nvme_ns_head *head)
 {
 	struct nvme_ns *ns;
@@ -597,6 +698,8 @@ void nvme_mpath_stop(struct nvme_ctrl *ctrl)
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_QD]	= "queue-depth",
+	[NVME_IOPOLICY_ST]	= "service-time",
 };
 
 static ssize_t nvme_subsys_iopolicy_show(struct device *dev,
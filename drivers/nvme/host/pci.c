@@ -9,6 +9,7 @@
 #include <linux/blkdev.h>
 #include <linux/blk-mq.h>
 #include <linux/blk-mq-pci.h>
+#include <linux/dim.h>
 #include <linux/dmi.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
@@ -78,6 +79,25 @@ static unsigned int poll_queues;
 module_param(poll_queues, uint, 0644);
 MODULE_PARM_DESC(poll_queues, "Number of queues to use for polled IO.");
 
+static bool adaptive_coalescing;
+module_param(adaptive_coalescing, bool, 0444);
+MODULE_PARM_DESC(adaptive_coalescing,
+	"tune interrupt coalescing from the I/O queue completion rate");
+
+/*
+ * Interrupt coalescing levels for adaptive_coalescing, indexed by the dim
+ * profile: aggregation time in 100us units and the 0's based aggregation
+ * threshold, as encoded in the Interrupt Coalescing feature.  Level 0 turns
+ * coalescing off for the vector.
+ */
+static const struct nvme_coalesce_profile {
+	u8 time;
+	u8 thr;
+} nvme_coalesce_profiles[RDMA_DIM_PARAMS_NUM_PROFILES] = {
+	{ 0, 0 }, { 1, 1 }, { 1, 3 }, { 1, 7 }, { 2, 7 },
+	{ 2, 15 }, { 3, 15 }, { 3, 31 }, { 4, 31 },
+};
+
 struct nvme_dev;
 struct nvme_queue;
 
@@ -106,6 +126,8 @@ struct nvme_dev {
 	unsigned long bar_mapped_size;
 	struct work_struct remove_work;
 	struct mutex shutdown_lock;
+	struct work_struct coalesce_work;
+	unsigned int coalesce_ix;
 	bool subsystem;
 	u64 cmb_size;
 	bool cmb_use_sqes;
@@ -188,6 +210,9 @@ struct nvme_queue {
 	u32 *dbbuf_sq_ei;
 	u32 *dbbuf_cq_ei;
 	struct completion delete_done;
+	/* adaptive interrupt coalescing: */
+	struct dim dim;
+	bool coalesce_off;
 };
 
 /*
@@ -1023,6 +1048,9 @@ static irqreturn_t nvme_irq(int irq, void *data)
 	wmb();
 
 	if (start != end) {
+		if (adaptive_coalescing && nvmeq->qid)
+			rdma_dim(&nvmeq->dim, end > start ? end - start :
+				 nvmeq->q_depth - start + end);
 		nvme_complete_cqes(nvmeq, start, end);
 		return IRQ_HANDLED;
 	}
@@ -1337,6 +1365,7 @@ static enum blk_eh_timer_return nvme_timeout(struct request *req, bool reserved)
 
 static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
+	cancel_work_sync(&nvmeq->dim.work);
 	dma_free_coherent(nvmeq->dev->dev, CQ_SIZE(nvmeq),
 				(void *)nvmeq->cqes, nvmeq->cq_dma_addr);
 	if (!nvmeq->sq_cmds)
@@ -1468,6 +1497,71 @@ static int nvme_alloc_sq_cmds(struct nvme_dev *dev, struct nvme_queue *nvmeq,
 	return 0;
 }
 
+/*
+ * NVMe only has a controller wide coalescing setting plus a per vector
+ * opt-out, so program the most aggressive level any I/O queue asked for and
+ * turn coalescing off for the vectors whose queues want none.
+ */
+static void nvme_coalesce_work(struct work_struct *work)
+{
+	struct nvme_dev *dev =
+		container_of(work, struct nvme_dev, coalesce_work);
+	unsigned int i, ix = 0;
+
+	if (dev->ctrl.state != NVME_CTRL_LIVE)
+		return;
+
+	for (i = 1; i < dev->online_queues; i++)
+		ix = max_t(unsigned int, ix,
+			   READ_ONCE(dev->queues[i].dim.profile_ix));
+
+	if (ix != dev->coalesce_ix) {
+		const struct nvme_coalesce_profile *p = &nvme_coalesce_profiles[ix];
+
+		if (nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE,
+				p->time << 8 | p->thr, NULL, 0, NULL))
+			return;
+		dev->coalesce_ix = ix;
+	}
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+		bool off = !READ_ONCE(nvmeq->dim.profile_ix);
+
+		/* the admin vector is never coalesced */
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags) || !nvmeq->cq_vector ||
+		    off == nvmeq->coalesce_off)
+			continue;
+		if (nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_CONFIG,
+				nvmeq->cq_vector | (off ? 1 << 16 : 0),
+				NULL, 0, NULL))
+			return;
+		nvmeq->coalesce_off = off;
+	}
+}
+
+static void nvme_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct nvme_queue *nvmeq = container_of(dim, struct nvme_queue, dim);
+
+	queue_work(nvme_wq, &nvmeq->dev->coalesce_work);
+	dim->state = DIM_START_MEASURE;
+}
+
+/*
+ * Called once the queues are disabled, so that no dim work can queue the
+ * coalescing work again behind our back.
+ */
+static void nvme_cancel_coalesce(struct nvme_dev *dev)
+{
+	unsigned int i;
+
+	for (i = 1; i < dev->ctrl.queue_count; i++)
+		cancel_work_sync(&dev->queues[i].dim.work);
+	cancel_work_sync(&dev->coalesce_work);
+}
+
 static int nvme_alloc_queue(struct nvme_dev *dev, int qid, int depth)
 {
 	struct nvme_queue *nvmeq = &dev->queues[qid];
@@ -1492,6 +1586,7 @@ static int nvme_alloc_queue(struct nvme_dev *dev, int qid, int depth)
 	nvmeq->cq_phase = 1;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	nvmeq->qid = qid;
+	INIT_WORK(&nvmeq->dim.work, nvme_dim_work);
 	dev->ctrl.queue_count++;
 
 	return 0;
@@ -1528,6 +1623,10 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	memset((void *)nvmeq->cqes, 0, CQ_SIZE(nvmeq));
 	nvme_dbbuf_init(dev, nvmeq, qid);
+	/* a controller reset also resets its coalescing features */
+	nvmeq->dim.state = DIM_START_MEASURE;
+	nvmeq->dim.profile_ix = 0;
+	nvmeq->coalesce_off = false;
 	dev->online_queues++;
 	wmb(); /* ensure the first interrupt sees the initialization */
 }
@@ -2502,6 +2601,7 @@ static void nvme_pci_free_ctrl(struct nvme_ctrl *ctrl)
 {
 	struct nvme_dev *dev = to_nvme_dev(ctrl);
 
+	cancel_work_sync(&dev->coalesce_work);
 	nvme_dbbuf_dma_free(dev);
 	put_device(dev->dev);
 	nvme_free_tagset(dev);
@@ -2546,6 +2646,8 @@ static void nvme_reset_work(struct work_struct *work)
 	if (dev->ctrl.ctrl_config & NVME_CC_ENABLE)
 		nvme_dev_disable(dev, false);
 	nvme_sync_queues(&dev->ctrl);
+	nvme_cancel_coalesce(dev);
+	dev->coalesce_ix = 0;
 
 	mutex_lock(&dev->shutdown_lock);
 	result = nvme_pci_enable(dev);
@@ -2802,6 +2904,7 @@ static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 
 	INIT_WORK(&dev->ctrl.reset_work, nvme_reset_work);
 	INIT_WORK(&dev->remove_work, nvme_remove_dead_ctrl_work);
+	INIT_WORK(&dev->coalesce_work, nvme_coalesce_work);
 	mutex_init(&dev->shutdown_lock);
 
 	result = nvme_setup_prp_pools(dev);
@@ -2903,6 +3006,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	nvme_stop_ctrl(&dev->ctrl);
 	nvme_remove_namespaces(&dev->ctrl);
 	nvme_dev_disable(dev, true);
+	nvme_cancel_coalesce(dev);
 	nvme_release_cmb(dev);
 	nvme_free_host_mem(dev);
 	nvme_dev_remove_admin(dev);
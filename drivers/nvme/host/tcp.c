@@ -14,6 +14,8 @@
 #include <linux/blk-mq.h>
 #include <crypto/hash.h>
 #include <net/busy_poll.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "nvme.h"
 #include "fabrics.h"
@@ -63,6 +65,7 @@ struct nvme_tcp_queue {
 	struct socket		*sock;
 	struct work_struct	io_work;
 	int			io_cpu;
+	int			rx_cpu;
 
 	spinlock_t		lock;
 	struct list_head	send_list;
@@ -119,6 +122,17 @@ struct nvme_tcp_ctrl {
 static LIST_HEAD(nvme_tcp_ctrl_list);
 static DEFINE_MUTEX(nvme_tcp_ctrl_mutex);
 static struct workqueue_struct *nvme_tcp_wq;
+static struct dentry *nvme_tcp_debugfs;
+
+/*
+ * Run a queue's io_work on the CPU its socket's receive processing lands
+ * on (as picked by RSS/RPS/aRFS), rather than the one it was assigned at
+ * connect time, so received data doesn't have to cross CPUs.
+ */
+static bool follow_rx_cpu;
+module_param(follow_rx_cpu, bool, 0644);
+MODULE_PARM_DESC(follow_rx_cpu,
+		 "run io_work on the CPU the queue's socket receives on");
 static struct blk_mq_ops nvme_tcp_mq_ops;
 static struct blk_mq_ops nvme_tcp_admin_mq_ops;
 
@@ -257,7 +271,18 @@ static inline void nvme_tcp_queue_request(struct nvme_tcp_request *req)
 	list_add_tail(&req->entry, &queue->send_list);
 	spin_unlock(&queue->lock);
 
-	queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+	queue_work_on(READ_ONCE(queue->io_cpu), nvme_tcp_wq,
+			&queue->io_work);
+}
+
+/*
+ * Whether more requests are waiting to be sent. Only a hint to the
+ * network stack to hold off pushing the current PDU out, so the unlocked
+ * check is fine.
+ */
+static inline bool nvme_tcp_queue_more(struct nvme_tcp_queue *queue)
+{
+	return !list_empty(&queue->send_list);
 }
 
 static inline struct nvme_tcp_request *
@@ -788,8 +813,18 @@ static void nvme_tcp_data_ready(struct sock *sk)
 
 	read_lock(&sk->sk_callback_lock);
 	queue = sk->sk_user_data;
-	if (likely(queue && queue->rd_enabled))
-		queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+	if (likely(queue && queue->rd_enabled)) {
+		/* recorded by the receive softirq, unlike the current CPU */
+		int cpu = READ_ONCE(sk->sk_incoming_cpu);
+
+		if (cpu >= 0 && queue->rx_cpu != cpu)
+			WRITE_ONCE(queue->rx_cpu, cpu);
+		if (follow_rx_cpu && cpu >= 0 && queue->io_cpu != cpu &&
+		    cpu_online(cpu))
+			WRITE_ONCE(queue->io_cpu, cpu);
+		queue_work_on(READ_ONCE(queue->io_cpu), nvme_tcp_wq,
+				&queue->io_work);
+	}
 	read_unlock(&sk->sk_callback_lock);
 }
 
@@ -801,7 +836,8 @@ static void nvme_tcp_write_space(struct sock *sk)
 	queue = sk->sk_user_data;
 	if (likely(queue && sk_stream_is_writeable(sk))) {
 		clear_bit(SOCK_NOSPACE, &sk->sk_socket->flags);
-		queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+		queue_work_on(READ_ONCE(queue->io_cpu), nvme_tcp_wq,
+				&queue->io_work);
 	}
 	read_unlock_bh(&sk->sk_callback_lock);
 }
@@ -856,10 +892,10 @@ static int nvme_tcp_try_send_data(struct nvme_tcp_request *req)
 		bool last = nvme_tcp_pdu_last_send(req, len);
 		int ret, flags = MSG_DONTWAIT;
 
-		if (last && !queue->data_digest)
+		if (last && !queue->data_digest && !nvme_tcp_queue_more(queue))
 			flags |= MSG_EOR;
 		else
-			flags |= MSG_MORE;
+			flags |= MSG_MORE | MSG_SENDPAGE_NOTLAST;
 
 		/* can't zcopy slab pages */
 		if (unlikely(PageSlab(page))) {
@@ -898,11 +934,16 @@ static int nvme_tcp_try_send_cmd_pdu(struct nvme_tcp_request *req)
 	struct nvme_tcp_queue *queue = req->queue;
 	struct nvme_tcp_cmd_pdu *pdu = req->pdu;
 	bool inline_data = nvme_tcp_has_inline_data(req);
-	int flags = MSG_DONTWAIT | (inline_data ? MSG_MORE : MSG_EOR);
 	u8 hdgst = nvme_tcp_hdgst_len(queue);
 	int len = sizeof(*pdu) + hdgst - req->offset;
+	int flags = MSG_DONTWAIT;
 	int ret;
 
+	if (inline_data || nvme_tcp_queue_more(queue))
+		flags |= MSG_MORE | MSG_SENDPAGE_NOTLAST;
+	else
+		flags |= MSG_EOR;
+
 	if (queue->hdr_digest && !req->offset)
 		nvme_tcp_hdgst(queue->snd_hash, pdu, sizeof(*pdu));
 
@@ -941,7 +982,7 @@ static int nvme_tcp_try_send_data_pdu(struct nvme_tcp_request *req)
 
 	ret = kernel_sendpage(queue->sock, virt_to_page(pdu),
 			offset_in_page(pdu) + req->offset, len,
-			MSG_DONTWAIT | MSG_MORE);
+			MSG_DONTWAIT | MSG_MORE | MSG_SENDPAGE_NOTLAST);
 	if (unlikely(ret <= 0))
 		return ret;
 
@@ -963,12 +1004,17 @@ static int nvme_tcp_try_send_ddgst(struct nvme_tcp_request *req)
 {
 	struct nvme_tcp_queue *queue = req->queue;
 	int ret;
-	struct msghdr msg = { .msg_flags = MSG_DONTWAIT | MSG_EOR };
+	struct msghdr msg = { .msg_flags = MSG_DONTWAIT };
 	struct kvec iov = {
 		.iov_base = &req->ddgst + req->offset,
 		.iov_len = NVME_TCP_DIGEST_LENGTH - req->offset
 	};
 
+	if (nvme_tcp_queue_more(queue))
+		msg.msg_flags |= MSG_MORE;
+	else
+		msg.msg_flags |= MSG_EOR;
+
 	ret = kernel_sendmsg(queue->sock, &msg, &iov, 1, iov.iov_len);
 	if (unlikely(ret <= 0))
 		return ret;
@@ -1048,7 +1094,16 @@ static void nvme_tcp_io_work(struct work_struct *w)
 		bool pending = false;
 		int result;
 
-		result = nvme_tcp_try_send(queue);
+		/*
+		 * Push out everything queued before going back to the
+		 * socket for completions, so back to back PDUs leave in as
+		 * few segments as MSG_MORE lets the stack build.
+		 */
+		do {
+			result = nvme_tcp_try_send(queue);
+		} while (result > 0 && nvme_tcp_queue_more(queue) &&
+			 !time_after(jiffies, deadline));
+
 		if (result > 0) {
 			pending = true;
 		} else if (unlikely(result < 0)) {
@@ -1074,7 +1129,8 @@ static void nvme_tcp_io_work(struct work_struct *w)
 
 	} while (!time_after(jiffies, deadline)); /* quota is exhausted */
 
-	queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+	queue_work_on(READ_ONCE(queue->io_cpu), nvme_tcp_wq,
+			&queue->io_work);
 }
 
 static void nvme_tcp_free_crypto(struct nvme_tcp_queue *queue)
@@ -1327,6 +1383,7 @@ static int nvme_tcp_alloc_queue(struct nvme_ctrl *nctrl,
 	else
 		n = (qid - 1) % num_online_cpus();
 	queue->io_cpu = cpumask_next_wrap(n - 1, cpu_online_mask, -1, false);
+	queue->rx_cpu = -1;
 	queue->request = NULL;
 	queue->data_remaining = 0;
 	queue->ddgst_remaining = 0;
@@ -2392,6 +2449,35 @@ static struct nvmf_transport_ops nvme_tcp_transport = {
 	.create_ctrl	= nvme_tcp_create_ctrl,
 };
 
+/*
+ * One line per queue: controller, queue id, the CPU io_work is queued on
+ * and the CPU the queue's socket last received data on.
+ */
+static int nvme_tcp_queues_show(struct seq_file *m, void *v)
+{
+	struct nvme_tcp_ctrl *ctrl;
+	int i;
+
+	mutex_lock(&nvme_tcp_ctrl_mutex);
+	list_for_each_entry(ctrl, &nvme_tcp_ctrl_list, list) {
+		for (i = 0; i < ctrl->ctrl.queue_count; i++) {
+			struct nvme_tcp_queue *queue = &ctrl->queues[i];
+
+			if (!test_bit(NVME_TCP_Q_ALLOCATED, &queue->flags))
+				continue;
+
+			seq_printf(m, "%s %d io_cpu %d rx_cpu %d\n",
+				   dev_name(ctrl->ctrl.device), i,
+				   READ_ONCE(queue->io_cpu),
+				   READ_ONCE(queue->rx_cpu));
+		}
+	}
+	mutex_unlock(&nvme_tcp_ctrl_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvme_tcp_queues);
+
 static int __init nvme_tcp_init_module(void)
 {
 	nvme_tcp_wq = alloc_workqueue("nvme_tcp_wq",
@@ -2399,6 +2485,10 @@ static int __init nvme_tcp_init_module(void)
 	if (!nvme_tcp_wq)
 		return -ENOMEM;
 
+	nvme_tcp_debugfs = debugfs_create_dir("nvme_tcp", NULL);
+	debugfs_create_file("queues", 0400, nvme_tcp_debugfs, NULL,
+			    &nvme_tcp_queues_fops);
+
 	nvmf_register_transport(&nvme_tcp_transport);
 	return 0;
 }
@@ -2415,6 +2505,7 @@ static void __exit nvme_tcp_cleanup_module(void)
 	mutex_unlock(&nvme_tcp_ctrl_mutex);
 	flush_workqueue(nvme_delete_wq);
 
+	debugfs_remove_recursive(nvme_tcp_debugfs);
 	destroy_workqueue(nvme_tcp_wq);
 }
 
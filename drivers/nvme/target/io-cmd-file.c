@@ -7,6 +7,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 #include <linux/uio.h>
 #include <linux/falloc.h>
+#include <linux/fadvise.h>
 #include <linux/file.h>
 #include "nvmet.h"
 
@@ -208,6 +209,14 @@ static bool nvmet_file_execute_io(struct nvmet_req *req, int ki_flags)
 		if ((ki_flags & IOCB_NOWAIT))
 			return false;
 		break;
+	default:
+		/*
+		 * A buffered read stops at the first page that isn't cached
+		 * under IOCB_NOWAIT; it is redone in full without it.
+		 */
+		if ((ki_flags & IOCB_NOWAIT) && ret >= 0 && ret < total_len)
+			return false;
+		break;
 	}
 
 complete:
@@ -224,6 +233,17 @@ static void nvmet_file_buffered_io_work(struct work_struct *w)
 
 static void nvmet_file_submit_buffered_io(struct nvmet_req *req)
 {
+	/*
+	 * A read that couldn't be served from the page cache will block the
+	 * worker until the data comes in, so get the reads going now rather
+	 * than once the worker gets around to it.
+	 */
+	if (req->cmd->rw.opcode == nvme_cmd_read)
+		vfs_fadvise(req->ns->file,
+			    le64_to_cpu(req->cmd->rw.slba) <<
+				req->ns->blksize_shift,
+			    req->transfer_len, POSIX_FADV_WILLNEED);
+
 	INIT_WORK(&req->f.work, nvmet_file_buffered_io_work);
 	queue_work(buffered_io_wq, &req->f.work);
 }
@@ -14,6 +14,7 @@
 #include <linux/inet.h>
 #include <linux/llist.h>
 #include <crypto/hash.h>
+#include <net/busy_poll.h>
 
 #include "nvmet.h"
 
@@ -23,6 +24,37 @@
 #define NVMET_TCP_SEND_BUDGET		8
 #define NVMET_TCP_IO_WORK_BUDGET	64
 
+/*
+ * After it last found work, keep a queue's io_work running and busy
+ * polling the socket for this long instead of waiting for the next socket
+ * callback to wake it up. 0 (the default) disables polling.
+ */
+static int idle_poll_period_usecs;
+module_param(idle_poll_period_usecs, int, 0644);
+MODULE_PARM_DESC(idle_poll_period_usecs,
+		 "usecs io_work keeps polling an idle queue (default 0)");
+
+/* CPUs to spread queue io_work over; all online CPUs if unset */
+static struct cpumask nvmet_tcp_io_cpus;
+
+static int nvmet_tcp_set_io_cpus(const char *val,
+		const struct kernel_param *kp)
+{
+	return cpulist_parse(val, &nvmet_tcp_io_cpus);
+}
+
+static int nvmet_tcp_get_io_cpus(char *buf, const struct kernel_param *kp)
+{
+	return sprintf(buf, "%*pbl\n", cpumask_pr_args(&nvmet_tcp_io_cpus));
+}
+
+static const struct kernel_param_ops nvmet_tcp_io_cpus_ops = {
+	.set	= nvmet_tcp_set_io_cpus,
+	.get	= nvmet_tcp_get_io_cpus,
+};
+module_param_cb(io_cpus, &nvmet_tcp_io_cpus_ops, NULL, 0444);
+MODULE_PARM_DESC(io_cpus, "list of CPUs to run queue io_work on");
+
 enum nvmet_tcp_send_state {
 	NVMET_TCP_SEND_DATA_PDU,
 	NVMET_TCP_SEND_DATA,
@@ -85,6 +117,7 @@ struct nvmet_tcp_queue {
 	struct nvmet_tcp_port	*port;
 	struct work_struct	io_work;
 	int			cpu;
+	unsigned long		poll_end;
 	struct nvmet_cq		nvme_cq;
 	struct nvmet_sq		nvme_sq;
 
@@ -1156,6 +1189,31 @@ static void nvmet_tcp_schedule_release_queue(struct nvmet_tcp_queue *queue)
 	spin_unlock(&queue->state_lock);
 }
 
+/*
+ * Whether io_work should requeue itself although it found nothing to do,
+ * because it found work within the last idle_poll_period_usecs. While it
+ * does, drive the socket's NAPI context directly (if the socket allows
+ * busy polling) so that new PDUs don't have to wait for the softirq.
+ */
+static bool nvmet_tcp_keep_polling(struct nvmet_tcp_queue *queue, int ops)
+{
+	unsigned int period = READ_ONCE(idle_poll_period_usecs);
+	struct sock *sk = queue->sock->sk;
+
+	if (!period || queue->state != NVMET_TCP_Q_LIVE)
+		return false;
+
+	if (ops)
+		queue->poll_end = jiffies + usecs_to_jiffies(period);
+	else if (time_after(jiffies, queue->poll_end))
+		return false;
+
+	if (sk_can_busy_loop(sk))
+		sk_busy_loop(sk, true);
+
+	return true;
+}
+
 static void nvmet_tcp_io_work(struct work_struct *w)
 {
 	struct nvmet_tcp_queue *queue =
@@ -1192,9 +1250,9 @@ static void nvmet_tcp_io_work(struct work_struct *w)
 	} while (pending && ops < NVMET_TCP_IO_WORK_BUDGET);
 
 	/*
-	 * We exahusted our budget, requeue our selves
+	 * We exahusted our budget, or are polling: requeue our selves
 	 */
-	if (pending)
+	if (pending || nvmet_tcp_keep_polling(queue, ops))
 		queue_work_on(queue->cpu, nvmet_tcp_wq, &queue->io_work);
 }
 
@@ -1491,8 +1549,16 @@ static int nvmet_tcp_alloc_queue(struct nvmet_tcp_port *port,
 	if (ret)
 		goto out_free_connect;
 
-	port->last_cpu = cpumask_next_wrap(port->last_cpu,
-				cpu_online_mask, -1, false);
+	if (cpumask_intersects(&nvmet_tcp_io_cpus, cpu_online_mask)) {
+		port->last_cpu = cpumask_next_and(port->last_cpu,
+				&nvmet_tcp_io_cpus, cpu_online_mask);
+		if (port->last_cpu >= nr_cpu_ids)
+			port->last_cpu = cpumask_first_and(&nvmet_tcp_io_cpus,
+					cpu_online_mask);
+	} else {
+		port->last_cpu = cpumask_next_wrap(port->last_cpu,
+					cpu_online_mask, -1, false);
+	}
 	queue->cpu = port->last_cpu;
 	nvmet_prepare_receive_pdu(queue);
 
@@ -284,7 +284,47 @@ static const struct attribute_group spi_controller_statistics_group = {
 	.attrs  = spi_controller_statistics_attrs,
 };
 
+static ssize_t idle_delay_ms_show(struct device *dev,
+				  struct device_attribute *a, char *buf)
+{
+	struct spi_controller *ctlr = container_of(dev, struct spi_controller,
+						   dev);
+
+	return sprintf(buf, "%u\n", ctlr->idle_delay_ms);
+}
+
+static ssize_t idle_delay_ms_store(struct device *dev,
+				   struct device_attribute *a,
+				   const char *buf, size_t count)
+{
+	struct spi_controller *ctlr = container_of(dev, struct spi_controller,
+						   dev);
+	unsigned int ms;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &ms);
+	if (ret)
+		return ret;
+
+	ret = spi_controller_set_idle_delay(ctlr, ms);
+	if (ret)
+		return ret;
+
+	return count;
+}
+static DEVICE_ATTR_RW(idle_delay_ms);
+
+static struct attribute *spi_master_attrs[] = {
+	&dev_attr_idle_delay_ms.attr,
+	NULL,
+};
+
+static const struct attribute_group spi_master_group = {
+	.attrs = spi_master_attrs,
+};
+
 static const struct attribute_group *spi_master_groups[] = {
+	&spi_master_group,
 	&spi_controller_statistics_group,
 	NULL,
 };
@@ -1362,6 +1402,20 @@ static void __spi_pump_messages(struct spi_controller *ctlr, bool in_kthread)
 			return;
 		}
 
+		/* Stay prepared until we have been idle for long enough */
+		if (ctlr->running && ctlr->idle_delay_ms) {
+			unsigned long idle_end = ctlr->last_msg_done +
+				msecs_to_jiffies(ctlr->idle_delay_ms);
+
+			if (time_before(jiffies, idle_end)) {
+				kthread_mod_delayed_work(&ctlr->kworker,
+							 &ctlr->pump_idle,
+							 idle_end - jiffies);
+				spin_unlock_irqrestore(&ctlr->queue_lock, flags);
+				return;
+			}
+		}
+
 		ctlr->busy = false;
 		ctlr->idling = true;
 		spin_unlock_irqrestore(&ctlr->queue_lock, flags);
@@ -1486,6 +1540,18 @@ static void spi_pump_messages(struct kthread_work *work)
 	__spi_pump_messages(ctlr, true);
 }
 
+/**
+ * spi_pump_idle - kthread delayed work function which idles the controller
+ * @work: pointer to kthread work struct contained in the controller struct
+ */
+static void spi_pump_idle(struct kthread_work *work)
+{
+	struct spi_controller *ctlr =
+		container_of(work, struct spi_controller, pump_idle.work);
+
+	__spi_pump_messages(ctlr, true);
+}
+
 /**
  * spi_take_timestamp_pre - helper for drivers to collect the beginning of the
  *			    TX timestamp for the requested byte from the SPI
@@ -1610,6 +1676,7 @@ static int spi_init_queue(struct spi_controller *ctlr)
 		return PTR_ERR(ctlr->kworker_task);
 	}
 	kthread_init_work(&ctlr->pump_messages, spi_pump_messages);
+	kthread_init_delayed_work(&ctlr->pump_idle, spi_pump_idle);
 
 	/*
 	 * Controller config will indicate if this controller should run the
@@ -1694,7 +1761,18 @@ void spi_finalize_current_message(struct spi_controller *ctlr)
 	spin_lock_irqsave(&ctlr->queue_lock, flags);
 	ctlr->cur_msg = NULL;
 	ctlr->cur_msg_prepared = false;
-	kthread_queue_work(&ctlr->kworker, &ctlr->pump_messages);
+	ctlr->last_msg_done = jiffies;
+	/*
+	 * If nothing else is queued and the controller is to stay prepared
+	 * for a while, there is nothing for the message pump to do until
+	 * then: the next spi_sync() pumps its message itself, and
+	 * spi_async() kicks the pump when it finds no message in flight.
+	 */
+	if (list_empty(&ctlr->queue) && ctlr->running && ctlr->idle_delay_ms)
+		kthread_mod_delayed_work(&ctlr->kworker, &ctlr->pump_idle,
+					 msecs_to_jiffies(ctlr->idle_delay_ms));
+	else
+		kthread_queue_work(&ctlr->kworker, &ctlr->pump_messages);
 	spin_unlock_irqrestore(&ctlr->queue_lock, flags);
 
 	trace_spi_message_done(mesg);
@@ -1776,6 +1854,7 @@ static int spi_destroy_queue(struct spi_controller *ctlr)
 		return ret;
 	}
 
+	kthread_cancel_delayed_work_sync(&ctlr->pump_idle);
 	kthread_flush_worker(&ctlr->kworker);
 	kthread_stop(ctlr->kworker_task);
 
@@ -1799,7 +1878,8 @@ static int __spi_queued_transfer(struct spi_device *spi,
 	msg->status = -EINPROGRESS;
 
 	list_add_tail(&msg->queue, &ctlr->queue);
-	if (!ctlr->busy && need_pump)
+	/* A controller kept prepared after a burst is busy but has no message */
+	if (!ctlr->cur_msg && need_pump)
 		kthread_queue_work(&ctlr->kworker, &ctlr->pump_messages);
 
 	spin_unlock_irqrestore(&ctlr->queue_lock, flags);
@@ -1863,6 +1943,45 @@ void spi_flush_queue(struct spi_controller *ctlr)
 		__spi_pump_messages(ctlr, false);
 }
 
+/**
+ * spi_controller_set_idle_delay - keep the controller prepared between bursts
+ * @ctlr: controller to configure
+ * @ms: how long to keep the hardware prepared after the queue runs empty,
+ *	at most SPI_IDLE_DELAY_MAX_MS; zero idles it as soon as possible
+ *
+ * Sets &spi_controller.idle_delay_ms. May be called by the controller driver
+ * before or after spi_register_controller(); it is also set from the
+ * "spi-idle-delay-ms" firmware property and the idle_delay_ms sysfs
+ * attribute of the controller.
+ *
+ * Context: any context.
+ *
+ * Return: zero on success, -EINVAL if @ms is too large.
+ */
+int spi_controller_set_idle_delay(struct spi_controller *ctlr, unsigned int ms)
+{
+	unsigned long flags;
+
+	/* spi_stop_queue() gives up after about five seconds */
+	if (ms > SPI_IDLE_DELAY_MAX_MS)
+		return -EINVAL;
+
+	if (!ctlr->queued) {
+		ctlr->idle_delay_ms = ms;
+		return 0;
+	}
+
+	spin_lock_irqsave(&ctlr->queue_lock, flags);
+	ctlr->idle_delay_ms = ms;
+	/* Re-arm a pending idle under the new delay */
+	if (ctlr->busy && !ctlr->cur_msg)
+		kthread_mod_delayed_work(&ctlr->kworker, &ctlr->pump_idle, 0);
+	spin_unlock_irqrestore(&ctlr->queue_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(spi_controller_set_idle_delay);
+
 /*-------------------------------------------------------------------------*/
 
 #if defined(CONFIG_OF)
@@ -2571,6 +2690,7 @@ int spi_register_controller(struct spi_controller *ctlr)
 	struct boardinfo	*bi;
 	int			status;
 	int			id, first_dynamic;
+	u32			idle_delay;
 
 	if (!dev)
 		return -ENODEV;
@@ -2630,6 +2750,11 @@ int spi_register_controller(struct spi_controller *ctlr)
 	if (!ctlr->max_dma_len)
 		ctlr->max_dma_len = INT_MAX;
 
+	if (!device_property_read_u32(&ctlr->dev, "spi-idle-delay-ms",
+				      &idle_delay) &&
+	    spi_controller_set_idle_delay(ctlr, idle_delay))
+		dev_warn(dev, "ignoring spi-idle-delay-ms of %u\n", idle_delay);
+
 	/* register the device, then userspace will see it.
 	 * registration fails if the bus ID is in use.
 	 */
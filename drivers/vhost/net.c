@@ -533,7 +533,7 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	endtime = busy_clock() + busyloop_timeout;
 
 	while (vhost_can_busy_poll(endtime)) {
-		if (vhost_has_work(&net->dev)) {
+		if (vhost_vq_has_work(poll_rx ? rvq : tvq)) {
 			*busyloop_intr = true;
 			break;
 		}
@@ -1328,6 +1328,8 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 
 	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev);
 	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev);
+	vhost_poll_bind_vq(n->poll + VHOST_NET_VQ_TX, &n->vqs[VHOST_NET_VQ_TX].vq);
+	vhost_poll_bind_vq(n->poll + VHOST_NET_VQ_RX, &n->vqs[VHOST_NET_VQ_RX].vq);
 
 	f->private_data = n;
 	n->page_frag.page = NULL;
@@ -37,6 +37,8 @@
 #include <linux/fs.h>
 #include <linux/vmalloc.h>
 #include <linux/miscdevice.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/signal.h>
 #include <asm/unaligned.h>
 #include <scsi/scsi_common.h>
 #include <scsi/scsi_proto.h>
@@ -189,6 +191,12 @@ struct vhost_scsi_virtqueue {
 	 * Writers must also take dev mutex and flush under it.
 	 */
 	int inflight_idx;
+	/*
+	 * Completions run on the worker that services this vq, so that they
+	 * don't race with its kick handler on the used ring.
+	 */
+	struct vhost_work completion_work; /* cmd completion work item */
+	struct llist_head completion_list; /* cmd completion queue */
 };
 
 struct vhost_scsi {
@@ -199,9 +207,6 @@ struct vhost_scsi {
 	struct vhost_dev dev;
 	struct vhost_scsi_virtqueue vqs[VHOST_SCSI_MAX_VQ];
 
-	struct vhost_work vs_completion_work; /* cmd completion work item */
-	struct llist_head vs_completion_list; /* cmd completion queue */
-
 	struct vhost_work vs_event_work; /* evt injection work item */
 	struct llist_head vs_event_list; /* evt injection queue */
 
@@ -364,11 +369,12 @@ static int vhost_scsi_get_cmd_state(struct se_cmd *se_cmd)
 
 static void vhost_scsi_complete_cmd(struct vhost_scsi_cmd *cmd)
 {
-	struct vhost_scsi *vs = cmd->tvc_vhost;
+	struct vhost_scsi_virtqueue *q = container_of(cmd->tvc_vq,
+					struct vhost_scsi_virtqueue, vq);
 
-	llist_add(&cmd->tvc_completion_list, &vs->vs_completion_list);
+	llist_add(&cmd->tvc_completion_list, &q->completion_list);
 
-	vhost_work_queue(&vs->dev, &vs->vs_completion_work);
+	vhost_vq_work_queue(&q->vq, &q->completion_work);
 }
 
 static int vhost_scsi_queue_data_in(struct se_cmd *se_cmd)
@@ -517,18 +523,20 @@ static void vhost_scsi_evt_work(struct vhost_work *work)
  */
 static void vhost_scsi_complete_cmd_work(struct vhost_work *work)
 {
-	struct vhost_scsi *vs = container_of(work, struct vhost_scsi,
-					vs_completion_work);
-	DECLARE_BITMAP(signal, VHOST_SCSI_MAX_VQ);
+	struct vhost_scsi_virtqueue *q = container_of(work,
+					struct vhost_scsi_virtqueue,
+					completion_work);
+	struct vhost_scsi *vs = container_of(q->vq.dev, struct vhost_scsi,
+					     dev);
 	struct virtio_scsi_cmd_resp v_rsp;
 	struct vhost_scsi_cmd *cmd, *t;
 	struct llist_node *llnode;
 	struct se_cmd *se_cmd;
 	struct iov_iter iov_iter;
-	int ret, vq;
+	bool signal = false;
+	int ret;
 
-	bitmap_zero(signal, VHOST_SCSI_MAX_VQ);
-	llnode = llist_del_all(&vs->vs_completion_list);
+	llnode = llist_del_all(&q->completion_list);
 	llist_for_each_entry_safe(cmd, t, llnode, tvc_completion_list) {
 		se_cmd = &cmd->tvc_se_cmd;
 
@@ -548,21 +556,16 @@ static void vhost_scsi_complete_cmd_work(struct vhost_work *work)
 			      cmd->tvc_in_iovs, sizeof(v_rsp));
 		ret = copy_to_iter(&v_rsp, sizeof(v_rsp), &iov_iter);
 		if (likely(ret == sizeof(v_rsp))) {
-			struct vhost_scsi_virtqueue *q;
 			vhost_add_used(cmd->tvc_vq, cmd->tvc_vq_desc, 0);
-			q = container_of(cmd->tvc_vq, struct vhost_scsi_virtqueue, vq);
-			vq = q - vs->vqs;
-			__set_bit(vq, signal);
+			signal = true;
 		} else
 			pr_err("Faulted on virtio_scsi_cmd_resp\n");
 
 		vhost_scsi_free_cmd(cmd);
 	}
 
-	vq = -1;
-	while ((vq = find_next_bit(signal, VHOST_SCSI_MAX_VQ, vq + 1))
-		< VHOST_SCSI_MAX_VQ)
-		vhost_signal(&vs->dev, &vs->vqs[vq].vq);
+	if (signal)
+		vhost_signal(&vs->dev, &q->vq);
 }
 
 static struct vhost_scsi_cmd *
@@ -809,6 +812,41 @@ vhost_scsi_send_bad_target(struct vhost_scsi *vs,
 		pr_err("Faulted on virtio_scsi_cmd_resp\n");
 }
 
+/* Busy-poll clock in ~us, as used for VHOST_SET_VRING_BUSYLOOP_TIMEOUT */
+static inline unsigned long vhost_scsi_busy_clock(void)
+{
+	return local_clock() >> 10;
+}
+
+/*
+ * Spin on the avail ring for up to the queue's busyloop timeout instead
+ * of going back to waiting for a guest kick.  Returns true if the guest
+ * queued more requests meanwhile.
+ */
+static bool vhost_scsi_busy_poll(struct vhost_scsi *vs,
+				 struct vhost_virtqueue *vq)
+{
+	unsigned long endtime;
+	bool avail = false;
+
+	preempt_disable();
+	endtime = vhost_scsi_busy_clock() + vq->busyloop_timeout;
+
+	while (likely(!need_resched() && !signal_pending(current) &&
+		      !time_after(vhost_scsi_busy_clock(), endtime))) {
+		if (vhost_vq_has_work(vq))
+			break;
+		if (!vhost_vq_avail_empty(&vs->dev, vq)) {
+			avail = true;
+			break;
+		}
+		cpu_relax();
+	}
+
+	preempt_enable();
+	return avail;
+}
+
 static int
 vhost_scsi_get_desc(struct vhost_scsi *vs, struct vhost_virtqueue *vq,
 		    struct vhost_scsi_ctx *vc)
@@ -819,6 +857,12 @@ vhost_scsi_get_desc(struct vhost_scsi *vs, struct vhost_virtqueue *vq,
 				     ARRAY_SIZE(vq->iov), &vc->out, &vc->in,
 				     NULL, NULL);
 
+	if (vc->head == vq->num && vq->busyloop_timeout &&
+	    vhost_scsi_busy_poll(vs, vq))
+		vc->head = vhost_get_vq_desc(vq, vq->iov,
+					     ARRAY_SIZE(vq->iov), &vc->out,
+					     &vc->in, NULL, NULL);
+
 	pr_debug("vhost_get_vq_desc: head: %d, out: %u in: %u\n",
 		 vc->head, vc->out, vc->in);
 
@@ -1365,7 +1409,6 @@ static void vhost_scsi_flush(struct vhost_scsi *vs)
 	/* Flush both the vhost poll and vhost work */
 	for (i = 0; i < VHOST_SCSI_MAX_VQ; i++)
 		vhost_scsi_flush_vq(vs, i);
-	vhost_work_flush(&vs->dev, &vs->vs_completion_work);
 	vhost_work_flush(&vs->dev, &vs->vs_event_work);
 
 	/* Wait for all reqs issued before the flush to be finished */
@@ -1613,7 +1656,6 @@ static int vhost_scsi_open(struct inode *inode, struct file *f)
 	if (!vqs)
 		goto err_vqs;
 
-	vhost_work_init(&vs->vs_completion_work, vhost_scsi_complete_cmd_work);
 	vhost_work_init(&vs->vs_event_work, vhost_scsi_evt_work);
 
 	vs->vs_events_nr = 0;
@@ -1627,6 +1669,11 @@ static int vhost_scsi_open(struct inode *inode, struct file *f)
 		vqs[i] = &vs->vqs[i].vq;
 		vs->vqs[i].vq.handle_kick = vhost_scsi_handle_kick;
 	}
+	for (i = 0; i < VHOST_SCSI_MAX_VQ; i++) {
+		init_llist_head(&vs->vqs[i].completion_list);
+		vhost_work_init(&vs->vqs[i].completion_work,
+				vhost_scsi_complete_cmd_work);
+	}
 	vhost_dev_init(&vs->dev, vqs, VHOST_SCSI_MAX_VQ, UIO_MAXIOV,
 		       VHOST_SCSI_WEIGHT, 0);
 
@@ -43,6 +43,11 @@ module_param(max_iotlb_entries, int, 0444);
 MODULE_PARM_DESC(max_iotlb_entries,
 	"Maximum number of iotlb entries. (default: 2048)");
 
+static unsigned int workers_per_dev = 1;
+module_param(workers_per_dev, uint, 0644);
+MODULE_PARM_DESC(workers_per_dev,
+	"Maximum number of worker threads per device; virtqueues are spread over them. (default: 1)");
+
 enum {
 	VHOST_MEMORY_F_LOG = 0x1,
 };
@@ -194,11 +199,21 @@ void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
 	poll->mask = mask;
 	poll->dev = dev;
 	poll->wqh = NULL;
+	poll->vq = NULL;
 
 	vhost_work_init(&poll->work, fn);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_init);
 
+/* Run the poll's work on the worker that services @vq, so that backend
+ * polls (e.g. a socket) and guest kicks for one queue stay on one thread.
+ */
+void vhost_poll_bind_vq(struct vhost_poll *poll, struct vhost_virtqueue *vq)
+{
+	poll->vq = vq;
+}
+EXPORT_SYMBOL_GPL(vhost_poll_bind_vq);
+
 /* Start polling a file. We add ourselves to file's wait queue. The caller must
  * keep a reference to a file until after vhost_poll_stop is called. */
 int vhost_poll_start(struct vhost_poll *poll, struct file *file)
@@ -231,17 +246,44 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_work_flush(struct vhost_dev *dev, struct vhost_work *work)
+static struct vhost_worker *vhost_poll_worker(struct vhost_poll *poll)
+{
+	if (poll->vq)
+		return poll->vq->worker;
+	return poll->dev->nworkers ? &poll->dev->workers[0] : NULL;
+}
+
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
+{
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		wake_up_process(worker->task);
+	}
+}
+
+static void vhost_worker_flush(struct vhost_worker *worker)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
 
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
-	}
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+/* Work can be queued on any of the workers, so flush them all */
+void vhost_work_flush(struct vhost_dev *dev, struct vhost_work *work)
+{
+	int i;
+
+	for (i = 0; i < dev->nworkers; i++)
+		vhost_worker_flush(&dev->workers[i]);
 }
 EXPORT_SYMBOL_GPL(vhost_work_flush);
 
@@ -255,30 +297,46 @@ EXPORT_SYMBOL_GPL(vhost_poll_flush);
 
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 {
-	if (!dev->worker)
+	if (!dev->nworkers)
 		return;
 
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
-	}
+	vhost_worker_queue(&dev->workers[0], work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
+/* Queue @work on the worker that services @vq, next to its kick handler */
+void vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
+{
+	if (vq->worker)
+		vhost_worker_queue(vq->worker, work);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_work_queue);
+
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->work_list);
+	int i;
+
+	for (i = 0; i < dev->nworkers; i++)
+		if (!llist_empty(&dev->workers[i].work_list))
+			return true;
+	return false;
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* As vhost_has_work(), but only for the worker that services @vq */
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
+{
+	return vq->worker && !llist_empty(&vq->worker->work_list);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	struct vhost_worker *worker = vhost_poll_worker(poll);
+
+	if (worker)
+		vhost_worker_queue(worker, &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
@@ -307,6 +365,7 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 	vq->used = NULL;
 	vq->last_avail_idx = 0;
 	vq->avail_idx = 0;
+	vq->avail_head_cnt = 0;
 	vq->last_used_idx = 0;
 	vq->signalled_used = 0;
 	vq->signalled_used_valid = false;
@@ -331,7 +390,8 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
+	struct vhost_dev *dev = worker->dev;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
 	mm_segment_t oldfs = get_fs();
@@ -348,7 +408,7 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
+		node = llist_del_all(&worker->work_list);
 		if (!node)
 			schedule();
 
@@ -469,11 +529,11 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->umem = NULL;
 	dev->iotlb = NULL;
 	dev->mm = NULL;
-	dev->worker = NULL;
+	dev->workers = NULL;
+	dev->nworkers = 0;
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
-	init_llist_head(&dev->work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -486,11 +546,14 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vq->indirect = NULL;
 		vq->heads = NULL;
 		vq->dev = dev;
+		vq->worker = NULL;
 		mutex_init(&vq->mutex);
 		vhost_vq_reset(dev, vq);
-		if (vq->handle_kick)
+		if (vq->handle_kick) {
 			vhost_poll_init(&vq->poll, vq->handle_kick,
 					EPOLLIN, dev);
+			vhost_poll_bind_vq(&vq->poll, vq);
+		}
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -520,12 +583,73 @@ static void vhost_attach_cgroups_work(struct vhost_work *work)
 static int vhost_attach_cgroups(struct vhost_dev *dev)
 {
 	struct vhost_attach_cgroups_struct attach;
+	int i;
 
 	attach.owner = current;
-	vhost_work_init(&attach.work, vhost_attach_cgroups_work);
-	vhost_work_queue(dev, &attach.work);
-	vhost_work_flush(dev, &attach.work);
-	return attach.ret;
+	for (i = 0; i < dev->nworkers; i++) {
+		vhost_work_init(&attach.work, vhost_attach_cgroups_work);
+		vhost_worker_queue(&dev->workers[i], &attach.work);
+		vhost_worker_flush(&dev->workers[i]);
+		if (attach.ret)
+			return attach.ret;
+	}
+	return 0;
+}
+
+static void vhost_dev_stop_workers(struct vhost_dev *dev)
+{
+	int i;
+
+	for (i = 0; i < dev->nvqs; ++i)
+		dev->vqs[i]->worker = NULL;
+	for (i = 0; i < dev->nworkers; i++) {
+		WARN_ON(!llist_empty(&dev->workers[i].work_list));
+		kthread_stop(dev->workers[i].task);
+	}
+	kfree(dev->workers);
+	dev->workers = NULL;
+	dev->nworkers = 0;
+}
+
+/* Start up to workers_per_dev threads, never more than there are
+ * virtqueues, and hand the virtqueues out to them round robin.  The
+ * first worker keeps the historical "vhost-<pid>" name and also runs
+ * device-wide work queued with vhost_work_queue().
+ */
+static int vhost_dev_start_workers(struct vhost_dev *dev)
+{
+	struct task_struct *task;
+	int i, n;
+
+	n = clamp_t(int, READ_ONCE(workers_per_dev), 1, max(dev->nvqs, 1));
+	dev->workers = kcalloc(n, sizeof(*dev->workers), GFP_KERNEL);
+	if (!dev->workers)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++) {
+		struct vhost_worker *worker = &dev->workers[i];
+
+		worker->dev = dev;
+		init_llist_head(&worker->work_list);
+		if (!i)
+			task = kthread_create(vhost_worker, worker, "vhost-%d",
+					      current->pid);
+		else
+			task = kthread_create(vhost_worker, worker,
+					      "vhost-%d-%d", current->pid, i);
+		if (IS_ERR(task)) {
+			vhost_dev_stop_workers(dev);
+			return PTR_ERR(task);
+		}
+
+		worker->task = task;
+		dev->nworkers++;
+		wake_up_process(task);	/* avoid contributing to loadavg */
+	}
+
+	for (i = 0; i < dev->nvqs; ++i)
+		dev->vqs[i]->worker = &dev->workers[i % n];
+	return 0;
 }
 
 /* Caller should have device mutex */
@@ -538,7 +662,6 @@ EXPORT_SYMBOL_GPL(vhost_dev_has_owner);
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	struct task_struct *worker;
 	int err;
 
 	/* Is there an owner already? */
@@ -550,14 +673,9 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 	/* No owner, become one */
 	dev->mm = get_task_mm(current);
 	dev->kcov_handle = kcov_common_handle();
-	worker = kthread_create(vhost_worker, dev, "vhost-%d", current->pid);
-	if (IS_ERR(worker)) {
-		err = PTR_ERR(worker);
+	err = vhost_dev_start_workers(dev);
+	if (err)
 		goto err_worker;
-	}
-
-	dev->worker = worker;
-	wake_up_process(worker);	/* avoid contributing to loadavg */
 
 	err = vhost_attach_cgroups(dev);
 	if (err)
@@ -569,8 +687,7 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	return 0;
 err_cgroup:
-	kthread_stop(worker);
-	dev->worker = NULL;
+	vhost_dev_stop_workers(dev);
 err_worker:
 	if (dev->mm)
 		mmput(dev->mm);
@@ -683,10 +800,8 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
+	if (dev->nworkers) {
+		vhost_dev_stop_workers(dev);
 		dev->kcov_handle = 0;
 	}
 	if (dev->mm)
@@ -996,6 +1111,42 @@ static inline int vhost_get_avail_head(struct vhost_virtqueue *vq,
 			       &vq->avail->ring[idx & (vq->num - 1)]);
 }
 
+/* Like vhost_get_avail_head(), but when there is no IOTLB, read up to
+ * VHOST_AVAIL_HEAD_BATCH of the entries the guest has made available
+ * with a single copy and serve the following calls from them.  Entries
+ * between last_avail_idx and avail_idx belong to us until they are
+ * used, so the copies stay valid across vhost_discard_vq_desc().
+ */
+static int vhost_fetch_avail_head(struct vhost_virtqueue *vq,
+				  __virtio16 *head, u16 idx)
+{
+	u16 off = idx - vq->avail_head_base;
+	unsigned int n, start;
+
+	if (vq->iotlb)
+		return vhost_get_avail_head(vq, head, idx);
+
+	if (off < vq->avail_head_cnt) {
+		*head = vq->avail_heads[off];
+		return 0;
+	}
+
+	start = idx & (vq->num - 1);
+	n = min_t(unsigned int, (u16)(vq->avail_idx - idx),
+		  VHOST_AVAIL_HEAD_BATCH);
+	n = min(n, vq->num - start);
+
+	vq->avail_head_cnt = 0;
+	if (__copy_from_user(vq->avail_heads, &vq->avail->ring[start],
+			     n * sizeof(*vq->avail_heads)))
+		return -EFAULT;
+	vq->avail_head_base = idx;
+	vq->avail_head_cnt = n;
+
+	*head = vq->avail_heads[0];
+	return 0;
+}
+
 static inline int vhost_get_avail_flags(struct vhost_virtqueue *vq,
 					__virtio16 *flags)
 {
@@ -1635,6 +1786,7 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 		vq->last_avail_idx = s.num;
 		/* Forget the cached index value. */
 		vq->avail_idx = vq->last_avail_idx;
+		vq->avail_head_cnt = 0;
 		break;
 	case VHOST_GET_VRING_BASE:
 		s.index = idx;
@@ -2018,6 +2170,7 @@ int vhost_vq_init_access(struct vhost_virtqueue *vq)
 		return 0;
 
 	vhost_init_is_le(vq);
+	vq->avail_head_cnt = 0;
 
 	r = vhost_update_used_flags(vq);
 	if (r)
@@ -2254,7 +2407,7 @@ int vhost_get_vq_desc(struct vhost_virtqueue *vq,
 
 	/* Grab the next descriptor number they're advertising, and increment
 	 * the index we've seen. */
-	if (unlikely(vhost_get_avail_head(vq, &ring_head, last_avail_idx))) {
+	if (unlikely(vhost_fetch_avail_head(vq, &ring_head, last_avail_idx))) {
 		vq_err(vq, "Failed to read head: idx %d address %p\n",
 		       last_avail_idx,
 		       &vq->avail->ring[last_avail_idx % vq->num]);
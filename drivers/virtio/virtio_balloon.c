@@ -169,6 +169,38 @@ static void set_page_pfns(struct virtio_balloon *vb,
 					  page_to_balloon_pfn(page) + i);
 }
 
+/*
+ * Try to take the pages for one inflate request as a single physically
+ * contiguous block, so that the host is handed whole ranges it can give
+ * back in one go instead of 4K holes scattered over its huge pages.  This
+ * is opportunistic: no reclaim or compaction is done for it, and callers
+ * fall back to single pages.  The block is split into order-0 pages and
+ * pushed in descending order so that they pop back out ascending.
+ */
+static unsigned int balloon_alloc_block(struct list_head *pages,
+					unsigned int num_pfns)
+{
+	unsigned int order, i;
+	struct page *page;
+
+	if (num_pfns < 2 * VIRTIO_BALLOON_PAGES_PER_PAGE)
+		return 0;
+
+	order = ilog2(num_pfns / VIRTIO_BALLOON_PAGES_PER_PAGE);
+	order = min_t(unsigned int, order, MAX_ORDER - 1);
+	page = alloc_pages((balloon_mapping_gfp_mask() | __GFP_NOMEMALLOC |
+			    __GFP_NORETRY | __GFP_NOWARN) &
+			   ~__GFP_DIRECT_RECLAIM, order);
+	if (!page)
+		return 0;
+
+	split_page(page, order);
+	for (i = 1 << order; i--; )
+		balloon_page_push(pages, page + i);
+
+	return (1 << order) * VIRTIO_BALLOON_PAGES_PER_PAGE;
+}
+
 static unsigned fill_balloon(struct virtio_balloon *vb, size_t num)
 {
 	unsigned num_allocated_pages;
@@ -179,7 +211,9 @@ static unsigned fill_balloon(struct virtio_balloon *vb, size_t num)
 	/* We can only do one array worth at a time. */
 	num = min(num, ARRAY_SIZE(vb->pfns));
 
-	for (num_pfns = 0; num_pfns < num;
+	num_pfns = balloon_alloc_block(&pages, num);
+
+	for (; num_pfns < num;
 	     num_pfns += VIRTIO_BALLOON_PAGES_PER_PAGE) {
 		struct page *page = balloon_page_alloc();
 
@@ -733,6 +733,63 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	return ret;
 }
 
+static unsigned int virtqueue_get_bufs_split(struct virtqueue *_vq,
+					     void **bufs, unsigned int *lens,
+					     unsigned int num)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int i, n = 0;
+	u16 used_idx, last_used;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return 0;
+	}
+
+	used_idx = virtio16_to_cpu(_vq->vdev, vq->split.vring.used->idx);
+	if (used_idx == vq->last_used_idx) {
+		END_USE(vq);
+		return 0;
+	}
+
+	/* Only get used array entries after they have been exposed by host. */
+	virtio_rmb(vq->weak_barriers);
+
+	while (n < num && vq->last_used_idx != used_idx) {
+		last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
+		i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		lens[n] = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+
+		if (unlikely(i >= vq->split.vring.num)) {
+			BAD_RING(vq, "id %u out of range\n", i);
+			return n;
+		}
+		if (unlikely(!vq->split.desc_state[i].data)) {
+			BAD_RING(vq, "id %u is not a head!\n", i);
+			return n;
+		}
+
+		bufs[n++] = vq->split.desc_state[i].data;
+		detach_buf_split(vq, i, NULL);
+		vq->last_used_idx++;
+	}
+
+	/* One event index update and barrier for the whole batch. */
+	if (!(vq->split.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT))
+		virtio_store_mb(vq->weak_barriers,
+				&vring_used_event(&vq->split.vring),
+				cpu_to_virtio16(_vq->vdev, vq->last_used_idx));
+
+	LAST_ADD_TIME_INVALID(vq);
+
+	END_USE(vq);
+	return n;
+}
+
 static void virtqueue_disable_cb_split(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -1906,6 +1963,38 @@ void *virtqueue_get_buf(struct virtqueue *_vq, unsigned int *len)
 	return virtqueue_get_buf_ctx(_vq, len, NULL);
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_buf);
+
+/**
+ * virtqueue_get_bufs - get up to @num used buffers at once
+ * @_vq: the struct virtqueue we're talking about.
+ * @bufs: array filled with the tokens of the used buffers.
+ * @lens: array filled with the lengths written by the other side.
+ * @num: number of entries in @bufs and @lens.
+ *
+ * The same as calling virtqueue_get_buf() up to @num times, but on a
+ * split ring the used index is read and ordered, and the used event
+ * index published, once for the whole batch rather than per buffer.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ *
+ * Returns the number of buffers stored in @bufs, 0 if there are none.
+ */
+unsigned int virtqueue_get_bufs(struct virtqueue *_vq, void **bufs,
+				unsigned int *lens, unsigned int num)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int n = 0;
+
+	if (!vq->packed_ring)
+		return virtqueue_get_bufs_split(_vq, bufs, lens, num);
+
+	while (n < num &&
+	       (bufs[n] = virtqueue_get_buf_ctx_packed(_vq, &lens[n], NULL)))
+		n++;
+	return n;
+}
+EXPORT_SYMBOL_GPL(virtqueue_get_bufs);
 /**
  * virtqueue_disable_cb - disable callbacks
  * @_vq: the struct virtqueue we're talking about.
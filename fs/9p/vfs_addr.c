@@ -20,6 +20,9 @@
 #include <linux/sched.h>
 #include <linux/uio.h>
 #include <linux/bvec.h>
+#include <linux/slab.h>
+#include <linux/writeback.h>
+#include <linux/workqueue.h>
 #include <net/9p/9p.h>
 #include <net/9p/client.h>
 
@@ -85,6 +88,130 @@ static int v9fs_vfs_readpage(struct file *filp, struct page *page)
 	return v9fs_fid_readpage(filp->private_data, page);
 }
 
+/**
+ * struct v9fs_page_batch - contiguous pages transferred by one 9P request
+ * @work: work item issuing the request
+ * @file: file being read, pinned until the request completes
+ * @fid: fid to issue the request on
+ * @pos: file offset of the first page
+ * @len: number of bytes to transfer
+ * @nr_pages: number of pages in @bvec
+ * @max_pages: number of pages that fit in one request
+ * @bvec: the pages
+ *
+ * Readahead and writeback group pages into batches of up to msize, and
+ * issue each batch from a work item so that several requests for a file
+ * can be in flight at once.  The pages stay locked (read) or under
+ * writeback (write) until the request completes.
+ */
+struct v9fs_page_batch {
+	struct work_struct work;
+	struct file *file;
+	struct p9_fid *fid;
+	loff_t pos;
+	size_t len;
+	unsigned int nr_pages;
+	unsigned int max_pages;
+	struct bio_vec bvec[];
+};
+
+static struct v9fs_page_batch *v9fs_batch_alloc(struct p9_fid *fid,
+						work_func_t func)
+{
+	struct v9fs_page_batch *batch;
+	unsigned int size = fid->iounit;
+	unsigned int max_pages;
+
+	if (!size || size > fid->clnt->msize - P9_IOHDRSZ)
+		size = fid->clnt->msize - P9_IOHDRSZ;
+	max_pages = max_t(unsigned int, size >> PAGE_SHIFT, 1);
+
+	batch = kmalloc(struct_size(batch, bvec, max_pages), GFP_NOFS);
+	if (!batch)
+		return NULL;
+
+	INIT_WORK(&batch->work, func);
+	batch->file = NULL;
+	batch->fid = fid;
+	batch->pos = 0;
+	batch->len = 0;
+	batch->nr_pages = 0;
+	batch->max_pages = max_pages;
+	return batch;
+}
+
+/**
+ * v9fs_batch_add - append the first @len bytes of a page to a batch
+ * @batch: batch to add to
+ * @page: page to add
+ * @len: bytes of @page to transfer
+ *
+ * Returns false if @page does not directly follow the batch or the batch
+ * is full.
+ */
+static bool v9fs_batch_add(struct v9fs_page_batch *batch, struct page *page,
+			   unsigned int len)
+{
+	struct bio_vec *bv;
+
+	if (batch->nr_pages) {
+		bv = &batch->bvec[batch->nr_pages - 1];
+		if (batch->nr_pages == batch->max_pages ||
+		    bv->bv_len != PAGE_SIZE ||
+		    bv->bv_page->index + 1 != page->index)
+			return false;
+	} else {
+		batch->pos = page_offset(page);
+	}
+
+	bv = &batch->bvec[batch->nr_pages++];
+	bv->bv_page = page;
+	bv->bv_offset = 0;
+	bv->bv_len = len;
+	batch->len += len;
+	return true;
+}
+
+static void v9fs_batch_submit(struct v9fs_page_batch *batch)
+{
+	queue_work(system_unbound_wq, &batch->work);
+}
+
+static void v9fs_readpages_work(struct work_struct *work)
+{
+	struct v9fs_page_batch *batch =
+		container_of(work, struct v9fs_page_batch, work);
+	struct iov_iter to;
+	unsigned int i;
+	int read, err;
+
+	iov_iter_bvec(&to, READ, batch->bvec, batch->nr_pages, batch->len);
+	read = p9_client_read(batch->fid, batch->pos, &to, &err);
+	p9_debug(P9_DEBUG_VFS, "pos %lld len %zu = %d err %d\n",
+		 batch->pos, batch->len, read, err);
+
+	for (i = 0; i < batch->nr_pages; i++) {
+		struct page *page = batch->bvec[i].bv_page;
+		struct inode *inode = page->mapping->host;
+		int filled = clamp_t(int, read - (int)(i << PAGE_SHIFT), 0,
+				     PAGE_SIZE);
+
+		if (err) {
+			v9fs_uncache_page(inode, page);
+		} else {
+			zero_user(page, filled, PAGE_SIZE - filled);
+			flush_dcache_page(page);
+			SetPageUptodate(page);
+			v9fs_readpage_to_fscache(inode, page);
+		}
+		unlock_page(page);
+		put_page(page);
+	}
+
+	fput(batch->file);
+	kfree(batch);
+}
+
 /**
  * v9fs_vfs_readpages - read a set of pages from 9P
  *
@@ -100,6 +227,8 @@ static int v9fs_vfs_readpages(struct file *filp, struct address_space *mapping,
 {
 	int ret = 0;
 	struct inode *inode;
+	struct p9_fid *fid;
+	struct v9fs_page_batch *batch = NULL;
 
 	inode = mapping->host;
 	p9_debug(P9_DEBUG_VFS, "inode: %p file: %p\n", inode, filp);
@@ -108,10 +237,35 @@ static int v9fs_vfs_readpages(struct file *filp, struct address_space *mapping,
 	if (ret == 0)
 		return ret;
 
-	ret = read_cache_pages(mapping, pages, v9fs_fid_readpage,
-			filp->private_data);
-	p9_debug(P9_DEBUG_VFS, "  = %d\n", ret);
-	return ret;
+	fid = filp->private_data;
+	while (!list_empty(pages)) {
+		struct page *page = lru_to_page(pages);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					  readahead_gfp_mask(mapping))) {
+			put_page(page);
+			continue;
+		}
+
+		if (batch && v9fs_batch_add(batch, page, PAGE_SIZE))
+			continue;
+		if (batch)
+			v9fs_batch_submit(batch);
+
+		batch = v9fs_batch_alloc(fid, v9fs_readpages_work);
+		if (!batch) {
+			v9fs_fid_readpage(fid, page);
+			put_page(page);
+			continue;
+		}
+		batch->file = get_file(filp);
+		v9fs_batch_add(batch, page, PAGE_SIZE);
+	}
+	if (batch)
+		v9fs_batch_submit(batch);
+
+	return 0;
 }
 
 /**
@@ -197,6 +351,93 @@ static int v9fs_vfs_writepage(struct page *page, struct writeback_control *wbc)
 	return retval;
 }
 
+static void v9fs_writepages_work(struct work_struct *work)
+{
+	struct v9fs_page_batch *batch =
+		container_of(work, struct v9fs_page_batch, work);
+	struct iov_iter from;
+	unsigned int i;
+	int err;
+
+	iov_iter_bvec(&from, WRITE, batch->bvec, batch->nr_pages, batch->len);
+	p9_client_write(batch->fid, batch->pos, &from, &err);
+	p9_debug(P9_DEBUG_VFS, "pos %lld len %zu err %d\n",
+		 batch->pos, batch->len, err);
+
+	for (i = 0; i < batch->nr_pages; i++) {
+		struct page *page = batch->bvec[i].bv_page;
+
+		if (err) {
+			SetPageError(page);
+			mapping_set_error(page->mapping, err);
+		}
+		end_page_writeback(page);
+	}
+
+	kfree(batch);
+}
+
+static int v9fs_writepages_add(struct page *page,
+			       struct writeback_control *wbc, void *data)
+{
+	struct v9fs_page_batch **batchp = data;
+	struct inode *inode = page->mapping->host;
+	struct v9fs_inode *v9inode = V9FS_I(inode);
+	loff_t size = i_size_read(inode);
+	unsigned int len;
+
+	/* Truncated away since it was dirtied */
+	if (page_offset(page) >= size) {
+		unlock_page(page);
+		return 0;
+	}
+
+	if (page->index == size >> PAGE_SHIFT)
+		len = size & ~PAGE_MASK;
+	else
+		len = PAGE_SIZE;
+
+	if (*batchp && v9fs_batch_add(*batchp, page, len))
+		goto added;
+	if (*batchp)
+		v9fs_batch_submit(*batchp);
+
+	/* We should have writeback_fid always set */
+	BUG_ON(!v9inode->writeback_fid);
+
+	*batchp = v9fs_batch_alloc(v9inode->writeback_fid,
+				   v9fs_writepages_work);
+	if (!*batchp)
+		return v9fs_vfs_writepage(page, wbc);
+	v9fs_batch_add(*batchp, page, len);
+added:
+	set_page_writeback(page);
+	unlock_page(page);
+	return 0;
+}
+
+/**
+ * v9fs_vfs_writepages - write back dirty pages of a file in msize batches
+ * @mapping: the address space
+ * @wbc: writeback control
+ *
+ * Writeback completes asynchronously; data integrity writeback waits for
+ * it through the page writeback bits.
+ */
+
+static int v9fs_vfs_writepages(struct address_space *mapping,
+			       struct writeback_control *wbc)
+{
+	struct v9fs_page_batch *batch = NULL;
+	int ret;
+
+	ret = write_cache_pages(mapping, wbc, v9fs_writepages_add, &batch);
+	if (batch)
+		v9fs_batch_submit(batch);
+
+	return ret;
+}
+
 /**
  * v9fs_launder_page - Writeback a dirty page
  * Returns 0 on success.
@@ -327,6 +568,7 @@ const struct address_space_operations v9fs_addr_operations = {
 	.readpages = v9fs_vfs_readpages,
 	.set_page_dirty = __set_page_dirty_nobuffers,
 	.writepage = v9fs_vfs_writepage,
+	.writepages = v9fs_vfs_writepages,
 	.write_begin = v9fs_write_begin,
 	.write_end = v9fs_write_end,
 	.releasepage = v9fs_release_page,
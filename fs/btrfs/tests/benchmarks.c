@@ -0,0 +1,386 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/types.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include "btrfs-tests.h"
+#include "../ctree.h"
+#include "../disk-io.h"
+#include "../free-space-cache.h"
+#include "../block-group.h"
+#include "../transaction.h"
+#include "../qgroup.h"
+#include "../ulist.h"
+
+/*
+ * Timed benchmarks on top of the self-test harness.  They don't check for
+ * correctness beyond what is needed to keep going, the self-tests do that,
+ * but run a fixed amount of work against the same dummy structures and print
+ * how long it took, so that allocator and qgroup changes can be compared
+ * across kernels.  The pseudo-random sequences are seeded with a constant to
+ * make runs repeatable.
+ */
+
+#define BENCH_SEED		0x5eed
+
+static u64 bench_ns(ktime_t start, u64 ops)
+{
+	return ops ? div64_u64(ktime_to_ns(ktime_sub(ktime_get(), start)), ops) : 0;
+}
+
+/*
+ * Free space cache lookups with every other sector free, i.e. as fragmented
+ * as a block group can get.  With @bitmap the free space is tracked in
+ * bitmaps, otherwise in one extent entry per free sector.
+ */
+static int bench_free_space(struct btrfs_block_group *cache, u32 sectorsize,
+			    bool bitmap)
+{
+	const u64 nr_ops = 1 << 16;
+	struct rnd_state rnd;
+	u64 max_extent_size;
+	u64 offset, i;
+	ktime_t start;
+	int ret;
+
+	prandom_seed_state(&rnd, BENCH_SEED);
+
+	for (offset = 0; offset < cache->length; offset += 2 * sectorsize) {
+		ret = test_add_free_space_entry(cache, offset, sectorsize,
+						bitmap);
+		if (ret) {
+			test_err("couldn't add free space %d", ret);
+			goto out;
+		}
+	}
+
+	/* Small allocations that fit anywhere, put back right away */
+	start = ktime_get();
+	for (i = 0; i < nr_ops; i++) {
+		u64 hint = prandom_u32_state(&rnd) % cache->length;
+
+		offset = btrfs_find_space_for_alloc(cache, hint, sectorsize, 0,
+						    &max_extent_size);
+		if (!offset)
+			continue;
+		ret = btrfs_add_free_space(cache, offset, sectorsize);
+		if (ret) {
+			test_err("couldn't return free space %d", ret);
+			goto out;
+		}
+	}
+	test_msg("bench: free space %s: %llu ns per fitting alloc",
+		 bitmap ? "bitmaps" : "extents", bench_ns(start, nr_ops));
+
+	/* Allocations that fit nowhere and have to look at everything */
+	start = ktime_get();
+	for (i = 0; i < nr_ops / 64; i++) {
+		offset = btrfs_find_space_for_alloc(cache, 0, 2 * sectorsize,
+						    0, &max_extent_size);
+		if (offset) {
+			test_err("unexpected allocation at %llu", offset);
+			ret = -EINVAL;
+			goto out;
+		}
+		cond_resched();
+	}
+	test_msg("bench: free space %s: %llu ns per failing alloc",
+		 bitmap ? "bitmaps" : "extents", bench_ns(start, nr_ops / 64));
+	ret = 0;
+out:
+	__btrfs_remove_free_space_cache(cache->free_space_ctl);
+	return ret;
+}
+
+static int bench_free_space_cache(u32 sectorsize, u32 nodesize)
+{
+	struct btrfs_fs_info *fs_info;
+	struct btrfs_block_group *cache;
+	struct btrfs_root *root;
+	int ret;
+
+	fs_info = btrfs_alloc_dummy_fs_info(nodesize, sectorsize);
+	if (!fs_info) {
+		test_std_err(TEST_ALLOC_FS_INFO);
+		return -ENOMEM;
+	}
+
+	cache = btrfs_alloc_dummy_block_group(fs_info, SZ_256M);
+	if (!cache) {
+		test_std_err(TEST_ALLOC_BLOCK_GROUP);
+		ret = -ENOMEM;
+		goto out_fs_info;
+	}
+
+	root = btrfs_alloc_dummy_root(fs_info);
+	if (IS_ERR(root)) {
+		test_std_err(TEST_ALLOC_ROOT);
+		ret = PTR_ERR(root);
+		goto out_cache;
+	}
+	root->fs_info->extent_root = root;
+
+	ret = bench_free_space(cache, sectorsize, false);
+	if (!ret)
+		ret = bench_free_space(cache, sectorsize, true);
+
+	btrfs_free_dummy_root(root);
+out_cache:
+	btrfs_free_dummy_block_group(cache);
+out_fs_info:
+	btrfs_free_dummy_fs_info(fs_info);
+	return ret;
+}
+
+/* Extent map lookups in a file made of many small extents */
+static int bench_extent_map(void)
+{
+	const u64 nr_extents = 1 << 16;
+	const u64 nr_ops = 1 << 18;
+	struct btrfs_fs_info *fs_info;
+	struct extent_map_tree *em_tree;
+	struct extent_map *em;
+	struct rb_node *node;
+	struct rnd_state rnd;
+	ktime_t start;
+	u64 i;
+	int ret = 0;
+
+	fs_info = btrfs_alloc_dummy_fs_info(PAGE_SIZE, PAGE_SIZE);
+	if (!fs_info) {
+		test_std_err(TEST_ALLOC_FS_INFO);
+		return -ENOMEM;
+	}
+
+	em_tree = kzalloc(sizeof(*em_tree), GFP_KERNEL);
+	if (!em_tree) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	extent_map_tree_init(em_tree);
+	prandom_seed_state(&rnd, BENCH_SEED);
+
+	/*
+	 * Discontiguous on disk, so that neighbouring extents aren't merged
+	 * into a single map.
+	 */
+	start = ktime_get();
+	for (i = 0; i < nr_extents; i++) {
+		em = alloc_extent_map();
+		if (!em) {
+			test_std_err(TEST_ALLOC_EXTENT_MAP);
+			ret = -ENOMEM;
+			goto out_tree;
+		}
+		em->start = i * SZ_4K;
+		em->len = SZ_4K;
+		em->block_start = 2 * i * SZ_4K;
+		em->block_len = SZ_4K;
+		write_lock(&em_tree->lock);
+		ret = add_extent_mapping(em_tree, em, 0);
+		write_unlock(&em_tree->lock);
+		free_extent_map(em);
+		if (ret < 0) {
+			test_err("cannot add extent map %llu: %d", i, ret);
+			goto out_tree;
+		}
+	}
+	test_msg("bench: extent map: %llu ns per insert of %llu",
+		 bench_ns(start, nr_extents), nr_extents);
+
+	start = ktime_get();
+	for (i = 0; i < nr_ops; i++) {
+		u64 idx = prandom_u32_state(&rnd) % nr_extents;
+
+		read_lock(&em_tree->lock);
+		em = lookup_extent_mapping(em_tree, idx * SZ_4K, SZ_4K);
+		read_unlock(&em_tree->lock);
+		if (!em) {
+			test_err("extent map %llu not found", idx);
+			ret = -ENOENT;
+			goto out_tree;
+		}
+		free_extent_map(em);
+	}
+	test_msg("bench: extent map: %llu ns per random lookup",
+		 bench_ns(start, nr_ops));
+
+out_tree:
+	while (!RB_EMPTY_ROOT(&em_tree->map.rb_root)) {
+		node = rb_first_cached(&em_tree->map);
+		em = rb_entry(node, struct extent_map, rb_node);
+		remove_extent_mapping(em_tree, em);
+		free_extent_map(em);
+	}
+	kfree(em_tree);
+out:
+	btrfs_free_dummy_fs_info(fs_info);
+	return ret;
+}
+
+static struct ulist *bench_roots(unsigned int nr)
+{
+	struct ulist *roots;
+	unsigned int i;
+
+	roots = ulist_alloc(GFP_KERNEL);
+	if (!roots)
+		return NULL;
+
+	for (i = 0; i < nr; i++) {
+		if (ulist_add(roots, BTRFS_FIRST_FREE_OBJECTID + i, 0,
+			      GFP_KERNEL) < 0) {
+			ulist_free(roots);
+			return NULL;
+		}
+	}
+	return roots;
+}
+
+/*
+ * Qgroup accounting of an extent shared by a growing number of snapshots:
+ * each step adds a reference from one more snapshot and drops it again, as
+ * happens when a snapshot's copy of a shared block is COWed.
+ */
+static int bench_qgroups(u32 sectorsize, u32 nodesize)
+{
+	const unsigned int nr_ops = 1 << 10;
+	struct btrfs_trans_handle trans;
+	struct btrfs_fs_info *fs_info;
+	struct ulist *old_roots, *new_roots;
+	struct btrfs_root *root;
+	unsigned int nr_roots, depth, i;
+	ktime_t start;
+	int ret;
+
+	fs_info = btrfs_alloc_dummy_fs_info(nodesize, sectorsize);
+	if (!fs_info) {
+		test_std_err(TEST_ALLOC_FS_INFO);
+		return -ENOMEM;
+	}
+
+	root = btrfs_alloc_dummy_root(fs_info);
+	if (IS_ERR(root)) {
+		test_std_err(TEST_ALLOC_ROOT);
+		ret = PTR_ERR(root);
+		goto out_fs_info;
+	}
+
+	/* Same setup as the qgroup self-tests */
+	root->fs_info->extent_root = root;
+	root->fs_info->tree_root = root;
+	root->fs_info->quota_root = root;
+	set_bit(BTRFS_FS_QUOTA_ENABLED, &fs_info->flags);
+
+	root->node = alloc_test_extent_buffer(root->fs_info, nodesize);
+	if (IS_ERR(root->node)) {
+		test_err("couldn't allocate dummy buffer");
+		ret = PTR_ERR(root->node);
+		root->node = NULL;
+		goto out;
+	}
+	btrfs_set_header_level(root->node, 0);
+	btrfs_set_header_nritems(root->node, 0);
+	root->alloc_bytenr += 2 * nodesize;
+
+	btrfs_init_dummy_trans(&trans, fs_info);
+
+	/* The qgroup items of all snapshots have to fit in one leaf */
+	nr_roots = min_t(unsigned int, 64, nodesize / 256);
+	for (i = 0; i < nr_roots; i++) {
+		ret = btrfs_create_qgroup(&trans, BTRFS_FIRST_FREE_OBJECTID + i);
+		if (ret) {
+			test_err("couldn't create qgroup %u: %d", i, ret);
+			goto out;
+		}
+	}
+
+	for (depth = 1; depth < nr_roots; depth <<= 1) {
+		/* Account the extent to @depth snapshots to begin with */
+		new_roots = bench_roots(depth);
+		if (!new_roots) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		ret = btrfs_qgroup_account_extent(&trans, nodesize, nodesize,
+						  NULL, new_roots);
+		if (ret) {
+			test_err("couldn't account extent %d", ret);
+			goto out;
+		}
+
+		start = ktime_get();
+		for (i = 0; i < nr_ops; i++) {
+			old_roots = bench_roots(depth);
+			new_roots = bench_roots(depth + 1);
+			if (!old_roots || !new_roots) {
+				ulist_free(old_roots);
+				ulist_free(new_roots);
+				ret = -ENOMEM;
+				goto out;
+			}
+
+			/* Consumes both ulists */
+			ret = btrfs_qgroup_account_extent(&trans, nodesize,
+					nodesize, old_roots, new_roots);
+			if (ret) {
+				test_err("couldn't account extent %d", ret);
+				goto out;
+			}
+
+			old_roots = bench_roots(depth + 1);
+			new_roots = bench_roots(depth);
+			if (!old_roots || !new_roots) {
+				ulist_free(old_roots);
+				ulist_free(new_roots);
+				ret = -ENOMEM;
+				goto out;
+			}
+
+			ret = btrfs_qgroup_account_extent(&trans, nodesize,
+					nodesize, old_roots, new_roots);
+			if (ret) {
+				test_err("couldn't account extent %d", ret);
+				goto out;
+			}
+		}
+		test_msg("bench: qgroups: %llu ns per account, %u sharing roots",
+			 bench_ns(start, 2 * nr_ops), depth);
+
+		old_roots = bench_roots(depth);
+		if (!old_roots) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		ret = btrfs_qgroup_account_extent(&trans, nodesize, nodesize,
+						  old_roots, NULL);
+		if (ret) {
+			test_err("couldn't account extent %d", ret);
+			goto out;
+		}
+		cond_resched();
+	}
+	ret = 0;
+out:
+	btrfs_free_dummy_root(root);
+out_fs_info:
+	btrfs_free_dummy_fs_info(fs_info);
+	return ret;
+}
+
+int btrfs_run_benchmarks(u32 sectorsize, u32 nodesize)
+{
+	int ret;
+
+	test_msg("running benchmarks, sectorsize: %u nodesize: %u",
+		 sectorsize, nodesize);
+
+	ret = bench_free_space_cache(sectorsize, nodesize);
+	if (ret)
+		return ret;
+	ret = bench_extent_map();
+	if (ret)
+		return ret;
+	return bench_qgroups(sectorsize, nodesize);
+}
@@ -7,6 +7,7 @@
 #include <linux/mount.h>
 #include <linux/pseudo_fs.h>
 #include <linux/magic.h>
+#include <linux/moduleparam.h>
 #include "btrfs-tests.h"
 #include "../ctree.h"
 #include "../free-space-cache.h"
@@ -19,6 +20,11 @@
 
 static struct vfsmount *test_mnt = NULL;
 
+static bool run_benchmarks;
+module_param(run_benchmarks, bool, 0444);
+MODULE_PARM_DESC(run_benchmarks,
+		 "Run timed benchmarks after the self-tests at module load");
+
 const char *test_error[] = {
 	[TEST_ALLOC_FS_INFO]	     = "cannot allocate fs_info",
 	[TEST_ALLOC_ROOT]	     = "cannot allocate root",
@@ -317,6 +323,12 @@ int btrfs_run_sanity_tests(void)
 		}
 	}
 	ret = btrfs_test_extent_map();
+	if (ret)
+		goto out;
+
+	if (run_benchmarks)
+		ret = btrfs_run_benchmarks(PAGE_SIZE,
+					   max_t(u32, PAGE_SIZE, SZ_16K));
 
 out:
 	btrfs_destroy_test_fs();
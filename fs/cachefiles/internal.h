@@ -18,6 +18,7 @@
 #include <linux/cred.h>
 #include <linux/workqueue.h>
 #include <linux/security.h>
+#include <linux/bvec.h>
 
 struct cachefiles_cache;
 struct cachefiles_object;
@@ -100,6 +101,22 @@ struct cachefiles_one_read {
 	struct list_head		op_link;	/* link in op's todo list */
 };
 
+/*
+ * direct read of a run of netfs pages from the backing file
+ */
+struct cachefiles_kiocb {
+	struct kiocb			iocb;
+	struct work_struct		work;		/* completion, in process context */
+	struct cachefiles_object	*object;
+	struct fscache_retrieval	*op;		/* retrieval op covering this */
+	long				ret;		/* result of the read */
+	unsigned int			nr_pages;
+	unsigned int			max_pages;
+	struct bio_vec			bvec[];		/* the netfs pages */
+};
+
+#define CACHEFILES_DIO_MAX_PAGES	64
+
 /*
  * backing file write tracking
  */
@@ -9,6 +9,9 @@
 #include <linux/slab.h>
 #include <linux/file.h>
 #include <linux/swap.h>
+#include <linux/uio.h>
+#include <linux/highmem.h>
+#include <linux/list_sort.h>
 #include "internal.h"
 
 /*
@@ -375,6 +378,273 @@ static int cachefiles_read_backing_file_one(struct cachefiles_object *object,
 	return -ENOMEM;
 }
 
+/*
+ * the part of the backing file last looked up with SEEK_DATA/SEEK_HOLE
+ */
+struct cachefiles_extent {
+	loff_t	start;
+	loff_t	end;
+	bool	data;
+};
+
+/*
+ * open the backing file of an object for reading
+ */
+static struct file *cachefiles_open_backing(struct cachefiles_object *object,
+					    struct cachefiles_cache *cache)
+{
+	struct path path = {
+		.mnt	= cache->mnt,
+		.dentry	= object->backer,
+	};
+
+	return dentry_open(&path, O_RDONLY | O_LARGEFILE, cache->cache_cred);
+}
+
+/*
+ * find out whether the backing file holds data for a page
+ * - as with bmap() before, the presence of data at the start of the page is
+ *   taken to indicate the page as a whole
+ * - the extent the answer covers is kept in *ext, so a run of pages costs a
+ *   couple of seeks rather than one lookup per page
+ */
+static bool cachefiles_page_has_data(struct file *file, pgoff_t index,
+				     struct cachefiles_extent *ext)
+{
+	loff_t pos = (loff_t)index << PAGE_SHIFT;
+	loff_t data, hole;
+
+	if (pos >= ext->start && pos < ext->end)
+		return ext->data;
+
+	ext->start = pos;
+	data = vfs_llseek(file, pos, SEEK_DATA);
+	if (data == pos) {
+		hole = vfs_llseek(file, pos, SEEK_HOLE);
+		ext->end = hole > pos ? hole : pos + PAGE_SIZE;
+		ext->data = true;
+	} else {
+		if (data > pos)
+			ext->end = data;
+		else if (data == -ENXIO)
+			ext->end = LLONG_MAX;
+		else
+			ext->end = pos + PAGE_SIZE;
+		ext->data = false;
+	}
+
+	_debug("%llx: %s to %llx", pos, ext->data ? "data" : "hole", ext->end);
+	return ext->data;
+}
+
+/*
+ * finish a direct read in process context
+ * - the netfs pages are unlocked and marked up to date by fscache_end_io()
+ */
+static void cachefiles_read_direct_done(struct work_struct *work)
+{
+	struct cachefiles_kiocb *ki =
+		container_of(work, struct cachefiles_kiocb, work);
+	struct fscache_retrieval *op = ki->op;
+	long left = ki->ret;
+	unsigned int i;
+	int error = 0;
+
+	_enter("{%lx+%u},%ld",
+	       ki->bvec[0].bv_page->index, ki->nr_pages, ki->ret);
+
+	if (ki->ret < 0) {
+		error = ki->ret;
+		if (error != -ENOMEM) {
+			cachefiles_io_error_obj(ki->object,
+						"Direct read error %ld on backing file",
+						ki->ret);
+			error = -EIO;
+		}
+	} else if (test_bit(FSCACHE_COOKIE_INVALIDATING,
+			    &ki->object->fscache.cookie->flags)) {
+		error = -ESTALE;
+	}
+
+	for (i = 0; i < ki->nr_pages; i++) {
+		struct page *netpage = ki->bvec[i].bv_page;
+		int page_error = error;
+
+		if (!page_error) {
+			if (left <= 0) {
+				/* the backing file shrank under us */
+				page_error = -ENODATA;
+			} else {
+				if (left < PAGE_SIZE)
+					zero_user_segment(netpage, left,
+							  PAGE_SIZE);
+				fscache_mark_page_cached(op, netpage);
+			}
+			left -= PAGE_SIZE;
+		}
+
+		fscache_end_io(op, netpage, page_error);
+		put_page(netpage);
+		fscache_retrieval_complete(op, 1);
+	}
+
+	fscache_put_retrieval(op);
+	fput(ki->iocb.ki_filp);
+	kfree(ki);
+	_leave("");
+}
+
+/*
+ * the backing fs may complete a direct read in interrupt context
+ */
+static void cachefiles_read_direct_complete(struct kiocb *iocb, long ret,
+					    long ret2)
+{
+	struct cachefiles_kiocb *ki =
+		container_of(iocb, struct cachefiles_kiocb, iocb);
+
+	ki->ret = ret;
+	queue_work(system_unbound_wq, &ki->work);
+}
+
+static struct cachefiles_kiocb *cachefiles_kiocb_alloc(
+	struct cachefiles_object *object, struct fscache_retrieval *op,
+	struct file *file, unsigned int max_pages)
+{
+	struct cachefiles_kiocb *ki;
+
+	max_pages = clamp_t(unsigned int, max_pages, 1,
+			    CACHEFILES_DIO_MAX_PAGES);
+	ki = kzalloc(struct_size(ki, bvec, max_pages), cachefiles_gfp);
+	if (!ki)
+		return NULL;
+
+	ki->iocb.ki_filp = get_file(file);
+	ki->iocb.ki_flags = IOCB_DIRECT;
+	ki->iocb.ki_complete = cachefiles_read_direct_complete;
+	INIT_WORK(&ki->work, cachefiles_read_direct_done);
+	ki->object = object;
+	ki->op = fscache_get_retrieval(op);
+	ki->max_pages = max_pages;
+	return ki;
+}
+
+/*
+ * see if a netfs page directly follows the run of pages in a direct read
+ */
+static bool cachefiles_kiocb_can_add(struct cachefiles_kiocb *ki,
+				     struct page *netpage)
+{
+	return ki->nr_pages < ki->max_pages &&
+		ki->bvec[ki->nr_pages - 1].bv_page->index + 1 == netpage->index;
+}
+
+static void cachefiles_kiocb_add(struct cachefiles_kiocb *ki,
+				 struct page *netpage)
+{
+	struct bio_vec *bv = &ki->bvec[ki->nr_pages++];
+
+	bv->bv_page = netpage;
+	bv->bv_offset = 0;
+	bv->bv_len = PAGE_SIZE;
+}
+
+/*
+ * start a direct read from the backing file straight into the netfs pages
+ * - the pages must be locked in the netfs pagecache, with a ref each handed
+ *   over to the read
+ */
+static void cachefiles_read_direct_submit(struct cachefiles_kiocb *ki)
+{
+	struct iov_iter iter;
+	ssize_t ret;
+
+	_enter("{%lx+%u}", ki->bvec[0].bv_page->index, ki->nr_pages);
+
+	ki->iocb.ki_pos = page_offset(ki->bvec[0].bv_page);
+	iov_iter_bvec(&iter, READ, ki->bvec, ki->nr_pages,
+		      ki->nr_pages * PAGE_SIZE);
+
+	ret = call_read_iter(ki->iocb.ki_filp, &ki->iocb, &iter);
+	if (ret != -EIOCBQUEUED)
+		cachefiles_read_direct_complete(&ki->iocb, ret, 0);
+}
+
+/*
+ * read a list of pages, sorted by index, directly from the backing file
+ * into the netfs pagecache
+ */
+static int cachefiles_read_backing_file_direct(struct cachefiles_object *object,
+					       struct fscache_retrieval *op,
+					       struct file *file,
+					       struct list_head *list,
+					       unsigned int nr)
+{
+	struct cachefiles_kiocb *ki = NULL;
+	struct page *netpage, *_n;
+	int ret = 0;
+
+	_enter(",,,%u", nr);
+
+	list_for_each_entry_safe(netpage, _n, list, lru) {
+		list_del(&netpage->lru);
+		nr--;
+
+		ret = add_to_page_cache_lru(netpage, op->mapping,
+					    netpage->index, cachefiles_gfp);
+		if (ret < 0) {
+			put_page(netpage);
+			fscache_retrieval_complete(op, 1);
+			if (ret == -EEXIST) {
+				ret = 0;
+				continue;
+			}
+			break;
+		}
+
+		if (ki && !cachefiles_kiocb_can_add(ki, netpage)) {
+			cachefiles_read_direct_submit(ki);
+			ki = NULL;
+		}
+		if (!ki) {
+			ki = cachefiles_kiocb_alloc(object, op, file, nr + 1);
+			if (!ki) {
+				/* the page is locked in the pagecache now */
+				fscache_end_io(op, netpage, -ENOMEM);
+				put_page(netpage);
+				fscache_retrieval_complete(op, 1);
+				ret = -ENOMEM;
+				break;
+			}
+		}
+		cachefiles_kiocb_add(ki, netpage);
+	}
+
+	if (ki)
+		cachefiles_read_direct_submit(ki);
+
+	/* tidy up after an error */
+	list_for_each_entry_safe(netpage, _n, list, lru) {
+		list_del(&netpage->lru);
+		put_page(netpage);
+		fscache_retrieval_complete(op, 1);
+	}
+
+	_leave(" = %d", ret);
+	return ret;
+}
+
+static int cachefiles_page_index_cmp(void *priv, struct list_head *a,
+				     struct list_head *b)
+{
+	struct page *pa = list_entry(a, struct page, lru);
+	struct page *pb = list_entry(b, struct page, lru);
+
+	if (pa->index == pb->index)
+		return 0;
+	return pa->index < pb->index ? -1 : 1;
+}
+
 /*
  * read a page from the cache or allocate a block in which to store it
  * - cache withdrawal is prevented by the caller
@@ -395,9 +665,10 @@ int cachefiles_read_or_alloc_page(struct fscache_retrieval *op,
 {
 	struct cachefiles_object *object;
 	struct cachefiles_cache *cache;
+	struct cachefiles_extent ext = {};
+	struct cachefiles_kiocb *ki;
 	struct inode *inode;
-	sector_t block;
-	unsigned shift;
+	struct file *file;
 	int ret;
 
 	object = container_of(op->op.object,
@@ -414,45 +685,51 @@ int cachefiles_read_or_alloc_page(struct fscache_retrieval *op,
 	ASSERT(S_ISREG(inode->i_mode));
 	ASSERT(inode->i_mapping->a_ops->readpages);
 
-	/* calculate the shift required to use bmap */
-	shift = PAGE_SHIFT - inode->i_sb->s_blocksize_bits;
+	file = cachefiles_open_backing(object, cache);
+	if (IS_ERR(file))
+		goto enobufs;
 
 	op->op.flags &= FSCACHE_OP_KEEP_FLAGS;
 	op->op.flags |= FSCACHE_OP_ASYNC;
 	op->op.processor = cachefiles_read_copier;
 
-	/* we assume the absence or presence of the first block is a good
-	 * enough indication for the page as a whole
-	 * - TODO: don't use bmap() for this as it is _not_ actually good
-	 *   enough for this as it doesn't indicate errors, but it's all we've
-	 *   got for the moment
-	 */
-	block = page->index;
-	block <<= shift;
-
-	ret = bmap(inode, &block);
-	ASSERT(ret < 0);
-
-	_debug("%llx -> %llx",
-	       (unsigned long long) (page->index << shift),
-	       (unsigned long long) block);
+	if (!cachefiles_page_has_data(file, page->index, &ext)) {
+		fput(file);
+		goto no_data;
+	}
 
-	if (block) {
+	if (inode->i_mapping->a_ops->direct_IO) {
+		/* read straight into the netfs page, bypassing the backing
+		 * pagecache */
+		ret = -ENOMEM;
+		ki = cachefiles_kiocb_alloc(object, op, file, 1);
+		if (ki) {
+			get_page(page);
+			cachefiles_kiocb_add(ki, page);
+			cachefiles_read_direct_submit(ki);
+			ret = 0;
+		} else {
+			fscache_retrieval_complete(op, 1);
+		}
+	} else {
 		/* submit the apparently valid page to the backing fs to be
 		 * read from disk */
 		ret = cachefiles_read_backing_file_one(object, op, page);
-	} else if (cachefiles_has_space(cache, 0, 1) == 0) {
-		/* there's space in the cache we can use */
-		fscache_mark_page_cached(op, page);
-		fscache_retrieval_complete(op, 1);
-		ret = -ENODATA;
-	} else {
-		goto enobufs;
 	}
+	fput(file);
 
 	_leave(" = %d", ret);
 	return ret;
 
+no_data:
+	if (cachefiles_has_space(cache, 0, 1) == 0) {
+		/* there's space in the cache we can use */
+		fscache_mark_page_cached(op, page);
+		fscache_retrieval_complete(op, 1);
+		_leave(" = -ENODATA");
+		return -ENODATA;
+	}
+
 enobufs:
 	fscache_retrieval_complete(op, 1);
 	_leave(" = -ENOBUFS");
@@ -687,11 +964,13 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 {
 	struct cachefiles_object *object;
 	struct cachefiles_cache *cache;
+	struct cachefiles_extent ext = {};
 	struct list_head backpages;
 	struct pagevec pagevec;
 	struct inode *inode;
+	struct file *file;
 	struct page *page, *_n;
-	unsigned shift, nrbackpages;
+	unsigned nrbackpages;
 	int ret, ret2, space;
 
 	object = container_of(op->op.object,
@@ -714,8 +993,13 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 	ASSERT(S_ISREG(inode->i_mode));
 	ASSERT(inode->i_mapping->a_ops->readpages);
 
-	/* calculate the shift required to use bmap */
-	shift = PAGE_SHIFT - inode->i_sb->s_blocksize_bits;
+	file = cachefiles_open_backing(object, cache);
+	if (IS_ERR(file))
+		goto all_enobufs;
+
+	/* walk the pages in file order so that extent lookups and direct
+	 * reads cover whole runs of them */
+	list_sort(NULL, pages, cachefiles_page_index_cmp);
 
 	pagevec_init(&pagevec);
 
@@ -728,28 +1012,10 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 
 	ret = space ? -ENODATA : -ENOBUFS;
 	list_for_each_entry_safe(page, _n, pages, lru) {
-		sector_t block;
-
-		/* we assume the absence or presence of the first block is a
-		 * good enough indication for the page as a whole
-		 * - TODO: don't use bmap() for this as it is _not_ actually
-		 *   good enough for this as it doesn't indicate errors, but
-		 *   it's all we've got for the moment
-		 */
-		block = page->index;
-		block <<= shift;
-
-		ret = bmap(inode, &block);
-		ASSERT(!ret);
-
-		_debug("%llx -> %llx",
-		       (unsigned long long) (page->index << shift),
-		       (unsigned long long) block);
-
-		if (block) {
+		if (cachefiles_page_has_data(file, page->index, &ext)) {
 			/* we have data - add it to the list to give to the
 			 * backing fs */
-			list_move(&page->lru, &backpages);
+			list_move_tail(&page->lru, &backpages);
 			(*nr_pages)--;
 			nrbackpages++;
 		} else if (space && pagevec_add(&pagevec, page) == 0) {
@@ -770,10 +1036,18 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 	/* submit the apparently valid pages to the backing fs to be read from
 	 * disk */
 	if (nrbackpages > 0) {
-		ret2 = cachefiles_read_backing_file(object, op, &backpages);
+		if (inode->i_mapping->a_ops->direct_IO)
+			ret2 = cachefiles_read_backing_file_direct(object, op,
+								   file,
+								   &backpages,
+								   nrbackpages);
+		else
+			ret2 = cachefiles_read_backing_file(object, op,
+							    &backpages);
 		if (ret2 == -ENOMEM || ret2 == -EINTR)
 			ret = ret2;
 	}
+	fput(file);
 
 	_leave(" = %d [nr=%u%s]",
 	       ret, *nr_pages, list_empty(pages) ? " empty" : "");
@@ -9,6 +9,7 @@
 #include <linux/wait.h>
 #include <linux/writeback.h>
 #include <linux/iversion.h>
+#include <linux/hash.h>
 
 #include "super.h"
 #include "mds_client.h"
@@ -499,22 +500,33 @@ static void __cap_set_timeouts(struct ceph_mds_client *mdsc,
 	     ci->i_hold_caps_min - jiffies, ci->i_hold_caps_max - jiffies);
 }
 
+/*
+ * An inode always goes on the same delayed cap shard.
+ */
+static struct ceph_cap_delay_shard *
+cap_delay_shard(struct ceph_mds_client *mdsc, struct ceph_inode_info *ci)
+{
+	return &mdsc->cap_delay[hash_ptr(ci, CEPH_CAP_DELAY_SHARD_BITS)];
+}
+
 /*
  * (Re)queue cap at the end of the delayed cap release list.
  *
  * If I_FLUSH is set, leave the inode at the front of the list.
  *
  * Caller holds i_ceph_lock
- *    -> we take mdsc->cap_delay_lock
+ *    -> we take the inode's cap delay shard lock
  */
 static void __cap_delay_requeue(struct ceph_mds_client *mdsc,
 				struct ceph_inode_info *ci,
 				bool set_timeout)
 {
+	struct ceph_cap_delay_shard *shard = cap_delay_shard(mdsc, ci);
+
 	dout("__cap_delay_requeue %p flags %d at %lu\n", &ci->vfs_inode,
 	     ci->i_ceph_flags, ci->i_hold_caps_max);
 	if (!mdsc->stopping) {
-		spin_lock(&mdsc->cap_delay_lock);
+		spin_lock(&shard->lock);
 		if (!list_empty(&ci->i_cap_delay_list)) {
 			if (ci->i_ceph_flags & CEPH_I_FLUSH)
 				goto no_change;
@@ -522,9 +534,9 @@ static void __cap_delay_requeue(struct ceph_mds_client *mdsc,
 		}
 		if (set_timeout)
 			__cap_set_timeouts(mdsc, ci);
-		list_add_tail(&ci->i_cap_delay_list, &mdsc->cap_delay_list);
+		list_add_tail(&ci->i_cap_delay_list, &shard->list);
 no_change:
-		spin_unlock(&mdsc->cap_delay_lock);
+		spin_unlock(&shard->lock);
 	}
 }
 
@@ -536,13 +548,15 @@ static void __cap_delay_requeue(struct ceph_mds_client *mdsc,
 static void __cap_delay_requeue_front(struct ceph_mds_client *mdsc,
 				      struct ceph_inode_info *ci)
 {
+	struct ceph_cap_delay_shard *shard = cap_delay_shard(mdsc, ci);
+
 	dout("__cap_delay_requeue_front %p\n", &ci->vfs_inode);
-	spin_lock(&mdsc->cap_delay_lock);
+	spin_lock(&shard->lock);
 	ci->i_ceph_flags |= CEPH_I_FLUSH;
 	if (!list_empty(&ci->i_cap_delay_list))
 		list_del_init(&ci->i_cap_delay_list);
-	list_add(&ci->i_cap_delay_list, &mdsc->cap_delay_list);
-	spin_unlock(&mdsc->cap_delay_lock);
+	list_add(&ci->i_cap_delay_list, &shard->list);
+	spin_unlock(&shard->lock);
 }
 
 /*
@@ -553,12 +567,15 @@ static void __cap_delay_requeue_front(struct ceph_mds_client *mdsc,
 static void __cap_delay_cancel(struct ceph_mds_client *mdsc,
 			       struct ceph_inode_info *ci)
 {
+	struct ceph_cap_delay_shard *shard;
+
 	dout("__cap_delay_cancel %p\n", &ci->vfs_inode);
 	if (list_empty(&ci->i_cap_delay_list))
 		return;
-	spin_lock(&mdsc->cap_delay_lock);
+	shard = cap_delay_shard(mdsc, ci);
+	spin_lock(&shard->lock);
 	list_del_init(&ci->i_cap_delay_list);
-	spin_unlock(&mdsc->cap_delay_lock);
+	spin_unlock(&shard->lock);
 }
 
 /*
@@ -2718,10 +2735,13 @@ int ceph_try_get_caps(struct inode *inode, int need, int want,
 	int ret;
 
 	BUG_ON(need & ~CEPH_CAP_FILE_RD);
-	BUG_ON(want & ~(CEPH_CAP_FILE_CACHE|CEPH_CAP_FILE_LAZYIO|CEPH_CAP_FILE_SHARED));
-	ret = ceph_pool_perm_check(inode, need);
-	if (ret < 0)
-		return ret;
+	BUG_ON(want & ~(CEPH_CAP_FILE_CACHE|CEPH_CAP_FILE_LAZYIO|CEPH_CAP_FILE_SHARED|
+			CEPH_CAP_FILE_EXCL|CEPH_CAP_DIR_UNLINK));
+	if (need) {
+		ret = ceph_pool_perm_check(inode, need);
+		if (ret < 0)
+			return ret;
+	}
 
 	ret = try_get_cap_refs(inode, need, want, 0,
 			       (nonblock ? NON_BLOCKING : 0), got);
@@ -4041,20 +4061,19 @@ void ceph_handle_caps(struct ceph_mds_session *session,
 }
 
 /*
- * Delayed work handler to process end of delayed cap release LRU list.
+ * Process the expired end of one delayed cap release shard.
  */
-void ceph_check_delayed_caps(struct ceph_mds_client *mdsc)
+static void check_delayed_caps_shard(struct ceph_cap_delay_shard *shard)
 {
 	struct inode *inode;
 	struct ceph_inode_info *ci;
 	int flags = CHECK_CAPS_NODELAY;
 
-	dout("check_delayed_caps\n");
 	while (1) {
-		spin_lock(&mdsc->cap_delay_lock);
-		if (list_empty(&mdsc->cap_delay_list))
+		spin_lock(&shard->lock);
+		if (list_empty(&shard->list))
 			break;
-		ci = list_first_entry(&mdsc->cap_delay_list,
+		ci = list_first_entry(&shard->list,
 				      struct ceph_inode_info,
 				      i_cap_delay_list);
 		if ((ci->i_ceph_flags & CEPH_I_FLUSH) == 0 &&
@@ -4063,7 +4082,7 @@ void ceph_check_delayed_caps(struct ceph_mds_client *mdsc)
 		list_del_init(&ci->i_cap_delay_list);
 
 		inode = igrab(&ci->vfs_inode);
-		spin_unlock(&mdsc->cap_delay_lock);
+		spin_unlock(&shard->lock);
 
 		if (inode) {
 			dout("check_delayed_caps on %p\n", inode);
@@ -4072,7 +4091,19 @@ void ceph_check_delayed_caps(struct ceph_mds_client *mdsc)
 			ceph_async_iput(inode);
 		}
 	}
-	spin_unlock(&mdsc->cap_delay_lock);
+	spin_unlock(&shard->lock);
+}
+
+/*
+ * Delayed work handler to process end of delayed cap release LRU list.
+ */
+void ceph_check_delayed_caps(struct ceph_mds_client *mdsc)
+{
+	int i;
+
+	dout("check_delayed_caps\n");
+	for (i = 0; i < CEPH_CAP_DELAY_SHARDS; i++)
+		check_delayed_caps_shard(&mdsc->cap_delay[i]);
 }
 
 /*
@@ -1039,6 +1039,60 @@ static int ceph_link(struct dentry *old_dentry, struct inode *dir,
 /*
  * rmdir and unlink are differ only by the metadata op code
  */
+static void ceph_async_unlink_cb(struct ceph_mds_client *mdsc,
+				 struct ceph_mds_request *req)
+{
+	int result = req->r_err;
+
+	if (!result && req->r_reply_info.head)
+		result = le32_to_cpu(req->r_reply_info.head->result);
+
+	/* the unlink already happened locally; report failure on fsync */
+	if (result) {
+		pr_warn("ceph: async unlink failure path=(%llx)%pd result=%d!\n",
+			ceph_ino(req->r_parent), req->r_dentry, result);
+		mapping_set_error(req->r_parent->i_mapping, result);
+		ceph_dir_clear_complete(req->r_parent);
+	}
+}
+
+/*
+ * An unlink may complete before the MDS has replied if we hold the
+ * exclusive and unlink caps on the directory and our dentry information
+ * is still covered by them.  Only single-linked non-directories qualify,
+ * so the dentry is the inode's primary link.  Returns the cap refs taken
+ * on @dir, or 0.
+ */
+static int get_caps_for_async_unlink(struct inode *dir, struct dentry *dentry)
+{
+	struct ceph_inode_info *ci = ceph_inode(dir);
+	struct ceph_dentry_info *di;
+	struct inode *inode = d_inode(dentry);
+	int want = CEPH_CAP_FILE_EXCL | CEPH_CAP_DIR_UNLINK;
+	int got = 0;
+	bool valid;
+
+	if (!ceph_test_mount_opt(ceph_sb_to_client(dir->i_sb), ASYNC_DIROPS) ||
+	    d_is_dir(dentry) || inode->i_nlink != 1)
+		return 0;
+
+	if (ceph_try_get_caps(dir, 0, want, true, &got) <= 0)
+		return 0;
+	if ((got & want) != want)
+		goto out_put;
+
+	spin_lock(&dentry->d_lock);
+	di = ceph_dentry(dentry);
+	valid = di && di->lease_shared_gen == atomic_read(&ci->i_shared_gen);
+	spin_unlock(&dentry->d_lock);
+	if (valid)
+		return got;
+
+out_put:
+	ceph_put_cap_refs(ci, got);
+	return 0;
+}
+
 static int ceph_unlink(struct inode *dir, struct dentry *dentry)
 {
 	struct ceph_fs_client *fsc = ceph_sb_to_client(dir->i_sb);
@@ -1067,10 +1121,30 @@ static int ceph_unlink(struct inode *dir, struct dentry *dentry)
 	req->r_dentry = dget(dentry);
 	req->r_num_caps = 2;
 	req->r_parent = dir;
-	set_bit(CEPH_MDS_R_PARENT_LOCKED, &req->r_req_flags);
 	req->r_dentry_drop = CEPH_CAP_FILE_SHARED;
 	req->r_dentry_unless = CEPH_CAP_FILE_EXCL;
 	req->r_inode_drop = ceph_drop_caps_for_unlink(inode);
+
+	if (op == CEPH_MDS_OP_UNLINK &&
+	    (req->r_dir_caps = get_caps_for_async_unlink(dir, dentry))) {
+		dout("async unlink on %llu/%pd caps=%s\n", ceph_ino(dir), dentry,
+		     ceph_cap_string(req->r_dir_caps));
+		req->r_callback = ceph_async_unlink_cb;
+		err = ceph_mdsc_submit_request(mdsc, dir, req);
+		if (!err) {
+			/*
+			 * We have enough caps, so we assume that the unlink
+			 * will succeed.  Fix up the local state now.
+			 */
+			drop_nlink(inode);
+			ceph_dir_clear_ordered(dir);
+			d_delete(dentry);
+		}
+		ceph_mdsc_put_request(req);
+		goto out;
+	}
+
+	set_bit(CEPH_MDS_R_PARENT_LOCKED, &req->r_req_flags);
 	err = ceph_mdsc_do_request(mdsc, dir, req);
 	if (!err && !req->r_reply_info.head->is_dentry)
 		d_delete(dentry);
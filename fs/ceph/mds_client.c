@@ -710,6 +710,9 @@ void ceph_mdsc_release_request(struct kref *kref)
 		ceph_async_iput(req->r_inode);
 	}
 	if (req->r_parent) {
+		if (req->r_dir_caps)
+			ceph_put_cap_refs(ceph_inode(req->r_parent),
+					  req->r_dir_caps);
 		ceph_put_cap_refs(ceph_inode(req->r_parent), CEPH_CAP_PIN);
 		ceph_async_iput(req->r_parent);
 	}
@@ -4163,6 +4166,7 @@ int ceph_mdsc_init(struct ceph_fs_client *fsc)
 
 {
 	struct ceph_mds_client *mdsc;
+	int i;
 
 	mdsc = kzalloc(sizeof(struct ceph_mds_client), GFP_NOFS);
 	if (!mdsc)
@@ -4197,9 +4201,11 @@ int ceph_mdsc_init(struct ceph_fs_client *fsc)
 	mdsc->request_tree = RB_ROOT;
 	INIT_DELAYED_WORK(&mdsc->delayed_work, delayed_work);
 	mdsc->last_renew_caps = jiffies;
-	INIT_LIST_HEAD(&mdsc->cap_delay_list);
+	for (i = 0; i < CEPH_CAP_DELAY_SHARDS; i++) {
+		spin_lock_init(&mdsc->cap_delay[i].lock);
+		INIT_LIST_HEAD(&mdsc->cap_delay[i].list);
+	}
 	INIT_LIST_HEAD(&mdsc->cap_wait_list);
-	spin_lock_init(&mdsc->cap_delay_lock);
 	INIT_LIST_HEAD(&mdsc->snap_flush_list);
 	spin_lock_init(&mdsc->snap_flush_lock);
 	mdsc->last_cap_flush_tid = 1;
@@ -4416,7 +4422,8 @@ void ceph_mdsc_close_sessions(struct ceph_mds_client *mdsc)
 			mutex_lock(&mdsc->mutex);
 		}
 	}
-	WARN_ON(!list_empty(&mdsc->cap_delay_list));
+	for (i = 0; i < CEPH_CAP_DELAY_SHARDS; i++)
+		WARN_ON(!list_empty(&mdsc->cap_delay[i].list));
 	mutex_unlock(&mdsc->mutex);
 
 	ceph_cleanup_snapid_map(mdsc);
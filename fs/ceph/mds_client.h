@@ -52,7 +52,7 @@ enum ceph_feature_type {
  *
  *         ci->i_ceph_lock
  *                 mdsc->snap_flush_lock
- *                 mdsc->cap_delay_lock
+ *                 mdsc->cap_delay[]->lock
  *
  */
 
@@ -279,6 +279,9 @@ struct ceph_mds_request {
 	struct inode *r_old_inode;
 	int r_old_inode_drop, r_old_inode_unless;
 
+	/* cap refs held on r_parent by an async dirop, dropped with req */
+	int r_dir_caps;
+
 	struct ceph_msg  *r_request;  /* original request */
 	int r_request_release_offset;
 	struct ceph_msg  *r_reply;
@@ -358,6 +361,19 @@ struct cap_wait {
 	int			want;
 };
 
+/*
+ * The delayed cap release list is split by inode so that cap updates on
+ * unrelated inodes don't all serialise on one lock.  Each shard is kept
+ * in release order, with CEPH_I_FLUSH inodes at the front.
+ */
+#define CEPH_CAP_DELAY_SHARD_BITS	4
+#define CEPH_CAP_DELAY_SHARDS		(1 << CEPH_CAP_DELAY_SHARD_BITS)
+
+struct ceph_cap_delay_shard {
+	spinlock_t		lock;
+	struct list_head	list;
+} ____cacheline_aligned_in_smp;
+
 /*
  * mds client state
  */
@@ -404,8 +420,8 @@ struct ceph_mds_client {
 	struct rb_root         request_tree;  /* pending mds requests */
 	struct delayed_work    delayed_work;  /* delayed work */
 	unsigned long    last_renew_caps;  /* last time we renewed our caps */
-	struct list_head cap_delay_list;   /* caps with delayed release */
-	spinlock_t       cap_delay_lock;   /* protects cap_delay_list */
+	/* caps with delayed release, sharded by inode */
+	struct ceph_cap_delay_shard cap_delay[CEPH_CAP_DELAY_SHARDS];
 	struct list_head snap_flush_list;  /* cap_snaps ready to flush */
 	spinlock_t       snap_flush_lock;
 
@@ -24,19 +24,174 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/namei.h>
+#include <crypto/skcipher.h>
 #include "fscrypt_private.h"
 
+/*
+ * Filesystem blocks en/decrypted as a batch.  Each block needs its own IV, so
+ * it needs its own request; but the requests are allocated once per bio rather
+ * than once per block, and all requests of a batch are started before any of
+ * them is waited for, so an asynchronous (e.g. hardware) skcipher can work on
+ * them in parallel.
+ */
+#define FSCRYPT_BATCH_SIZE	16
+
+struct fscrypt_block_req {
+	struct skcipher_request *req;
+	union fscrypt_iv iv;
+	struct scatterlist src, dst;
+	struct crypto_wait wait;
+	struct page *page;
+	u64 lblk_num;
+	int err;
+};
+
+struct fscrypt_batch {
+	const struct inode *inode;
+	fscrypt_direction_t rw;
+	unsigned int max;	/* number of requests allocated */
+	unsigned int nr;	/* number of requests started */
+	int err;		/* first error */
+	struct fscrypt_block_req reqs[FSCRYPT_BATCH_SIZE];
+};
+
+/*
+ * Allocations here may fail; callers then fall back to one request per block.
+ */
+static struct fscrypt_batch *fscrypt_alloc_batch(const struct inode *inode,
+						 fscrypt_direction_t rw)
+{
+	struct crypto_skcipher *tfm = inode->i_crypt_info->ci_ctfm;
+	struct fscrypt_batch *batch;
+	unsigned int i;
+
+	batch = kmalloc(sizeof(*batch), GFP_NOFS | __GFP_NOWARN);
+	if (!batch)
+		return NULL;
+
+	for (i = 0; i < FSCRYPT_BATCH_SIZE; i++) {
+		batch->reqs[i].req = skcipher_request_alloc(tfm, GFP_NOFS |
+							    __GFP_NOWARN);
+		if (!batch->reqs[i].req)
+			break;
+	}
+	if (i == 0) {
+		kfree(batch);
+		return NULL;
+	}
+
+	batch->inode = inode;
+	batch->rw = rw;
+	batch->max = i;
+	batch->nr = 0;
+	batch->err = 0;
+	return batch;
+}
+
+static void fscrypt_free_batch(struct fscrypt_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->max; i++)
+		skcipher_request_free(batch->reqs[i].req);
+	kfree(batch);
+}
+
+/* Wait for all started requests of a batch */
+static void fscrypt_wait_batch(struct fscrypt_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->nr; i++) {
+		struct fscrypt_block_req *br = &batch->reqs[i];
+		int err = crypto_wait_req(br->err, &br->wait);
+
+		if (!err)
+			continue;
+		fscrypt_err(batch->inode, "%scryption failed for block %llu: %d",
+			    (batch->rw == FS_DECRYPT ? "De" : "En"),
+			    br->lblk_num, err);
+		if (br->page)
+			SetPageError(br->page);
+		if (!batch->err)
+			batch->err = err;
+	}
+	batch->nr = 0;
+}
+
+/*
+ * Start en/decrypting one filesystem block.  On a decryption error, @page (if
+ * not NULL) is set to the Error state.
+ */
+static void fscrypt_batch_add(struct fscrypt_batch *batch, u64 lblk_num,
+			      struct page *src_page, struct page *dest_page,
+			      unsigned int len, unsigned int offs,
+			      struct page *page)
+{
+	struct fscrypt_block_req *br = &batch->reqs[batch->nr++];
+
+	fscrypt_generate_iv(&br->iv, lblk_num, batch->inode->i_crypt_info);
+	crypto_init_wait(&br->wait);
+	skcipher_request_set_callback(
+		br->req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		crypto_req_done, &br->wait);
+
+	sg_init_table(&br->dst, 1);
+	sg_set_page(&br->dst, dest_page, len, offs);
+	sg_init_table(&br->src, 1);
+	sg_set_page(&br->src, src_page, len, offs);
+	skcipher_request_set_crypt(br->req, &br->src, &br->dst, len, &br->iv);
+
+	br->page = page;
+	br->lblk_num = lblk_num;
+	if (batch->rw == FS_DECRYPT)
+		br->err = crypto_skcipher_decrypt(br->req);
+	else
+		br->err = crypto_skcipher_encrypt(br->req);
+
+	if (batch->nr == batch->max)
+		fscrypt_wait_batch(batch);
+}
+
 void fscrypt_decrypt_bio(struct bio *bio)
 {
+	const struct inode *inode = bio_first_page_all(bio)->mapping->host;
+	const unsigned int blockbits = inode->i_blkbits;
+	const unsigned int blocksize = 1 << blockbits;
+	struct fscrypt_batch *batch;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
 
+	batch = fscrypt_alloc_batch(inode, FS_DECRYPT);
+
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		int ret = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
-							   bv->bv_offset);
-		if (ret)
+		u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
+			       (bv->bv_offset >> blockbits);
+		unsigned int offs;
+
+		if (!batch) {
+			if (fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
+							     bv->bv_offset))
+				SetPageError(page);
+			continue;
+		}
+
+		if (WARN_ON_ONCE(!IS_ALIGNED(bv->bv_len | bv->bv_offset,
+					     blocksize))) {
 			SetPageError(page);
+			continue;
+		}
+
+		for (offs = bv->bv_offset; offs < bv->bv_offset + bv->bv_len;
+		     offs += blocksize, lblk_num++)
+			fscrypt_batch_add(batch, lblk_num, page, page,
+					  blocksize, offs, page);
+	}
+
+	if (batch) {
+		fscrypt_wait_batch(batch);
+		fscrypt_free_batch(batch);
 	}
 }
 EXPORT_SYMBOL(fscrypt_decrypt_bio);
@@ -66,6 +221,7 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	const unsigned int blocks_per_page_bits = PAGE_SHIFT - blockbits;
 	const unsigned int blocks_per_page = 1 << blocks_per_page_bits;
 	struct page *pages[16]; /* write up to 16 pages at a time */
+	struct fscrypt_batch *batch;
 	unsigned int nr_pages;
 	unsigned int i;
 	unsigned int offset;
@@ -99,6 +255,8 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	/* This always succeeds since __GFP_DIRECT_RECLAIM is set. */
 	bio = bio_alloc(GFP_NOFS, nr_pages);
 
+	batch = fscrypt_alloc_batch(inode, FS_ENCRYPT);
+
 	do {
 		bio_set_dev(bio, inode->i_sb->s_bdev);
 		bio->bi_iter.bi_sector = pblk << (blockbits - 9);
@@ -107,11 +265,18 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 		i = 0;
 		offset = 0;
 		do {
-			err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk,
-						  ZERO_PAGE(0), pages[i],
-						  blocksize, offset, GFP_NOFS);
-			if (err)
-				goto out;
+			if (batch) {
+				fscrypt_batch_add(batch, lblk, ZERO_PAGE(0),
+						  pages[i], blocksize, offset,
+						  NULL);
+			} else {
+				err = fscrypt_crypt_block(inode, FS_ENCRYPT,
+							  lblk, ZERO_PAGE(0),
+							  pages[i], blocksize,
+							  offset, GFP_NOFS);
+				if (err)
+					goto out;
+			}
 			lblk++;
 			pblk++;
 			len--;
@@ -126,6 +291,12 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 			}
 		} while (i != nr_pages && len != 0);
 
+		if (batch) {
+			fscrypt_wait_batch(batch);
+			err = batch->err;
+			if (err)
+				goto out;
+		}
 		err = submit_bio_wait(bio);
 		if (err)
 			goto out;
@@ -133,6 +304,11 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	} while (len != 0);
 	err = 0;
 out:
+	if (batch) {
+		/* Don't free pages still under encryption */
+		fscrypt_wait_batch(batch);
+		fscrypt_free_batch(batch);
+	}
 	bio_put(bio);
 	for (i = 0; i < nr_pages; i++)
 		fscrypt_free_bounce_page(pages[i]);
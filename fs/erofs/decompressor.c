@@ -7,6 +7,11 @@
 #include "compress.h"
 #include <linux/module.h>
 #include <linux/lz4.h>
+#ifdef CONFIG_EROFS_FS_ZIP_ZSTD
+#include <linux/zstd.h>
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
+#endif
 
 #ifndef LZ4_DISTANCE_MAX	/* history window size */
 #define LZ4_DISTANCE_MAX 65535	/* set to maximum value by default */
@@ -25,6 +30,9 @@ struct z_erofs_decompressor {
 	int (*prepare_destpages)(struct z_erofs_decompress_req *rq,
 				 struct list_head *pagepool);
 	int (*decompress)(struct z_erofs_decompress_req *rq, u8 *out);
+	/* set up and tear down shared contexts, optional */
+	int (*init)(void);
+	void (*exit)(void);
 	char *name;
 };
 
@@ -178,6 +186,175 @@ static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 	return ret;
 }
 
+#ifdef CONFIG_EROFS_FS_ZIP_ZSTD
+/*
+ * The window is bounded so that every CPU gets a fixed-size workspace;
+ * images must be built with a zstd window no larger than this.
+ */
+#define Z_EROFS_ZSTD_MAX_WINDOW	(128 * 1024)
+
+struct z_erofs_zstd_ctx {
+	ZSTD_DStream *stream;
+	void *wksp;
+};
+
+static struct z_erofs_zstd_ctx __percpu *z_erofs_zstd_ctxs;
+static DEFINE_MUTEX(z_erofs_zstd_lock);
+
+static void z_erofs_zstd_free(struct z_erofs_zstd_ctx __percpu *ctxs)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		vfree(per_cpu_ptr(ctxs, cpu)->wksp);
+	free_percpu(ctxs);
+}
+
+/* allocate the per-CPU streams on first use of a zstd-compressed inode */
+static int z_erofs_zstd_init(void)
+{
+	const size_t wkspsz =
+		ZSTD_DStreamWorkspaceBound(Z_EROFS_ZSTD_MAX_WINDOW);
+	struct z_erofs_zstd_ctx __percpu *ctxs;
+	int cpu, err = 0;
+
+	/* paired with smp_store_release() below */
+	if (smp_load_acquire(&z_erofs_zstd_ctxs))
+		return 0;
+
+	mutex_lock(&z_erofs_zstd_lock);
+	if (z_erofs_zstd_ctxs)
+		goto out_unlock;
+
+	ctxs = alloc_percpu(struct z_erofs_zstd_ctx);
+	if (!ctxs) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct z_erofs_zstd_ctx *ctx = per_cpu_ptr(ctxs, cpu);
+
+		ctx->wksp = vmalloc_node(wkspsz, cpu_to_node(cpu));
+		if (!ctx->wksp) {
+			err = -ENOMEM;
+			break;
+		}
+		ctx->stream = ZSTD_initDStream(Z_EROFS_ZSTD_MAX_WINDOW,
+					       ctx->wksp, wkspsz);
+		if (!ctx->stream) {
+			err = -EINVAL;
+			break;
+		}
+	}
+
+	if (err)
+		z_erofs_zstd_free(ctxs);
+	else
+		smp_store_release(&z_erofs_zstd_ctxs, ctxs);
+out_unlock:
+	mutex_unlock(&z_erofs_zstd_lock);
+	return err;
+}
+
+static void z_erofs_zstd_exit(void)
+{
+	if (z_erofs_zstd_ctxs)
+		z_erofs_zstd_free(z_erofs_zstd_ctxs);
+	z_erofs_zstd_ctxs = NULL;
+}
+
+/*
+ * zstd streams decode into their own window buffer and never read back
+ * from the destination, so all sparse pages can share one bounce page.
+ */
+static int z_erofs_zstd_prepare_destpages(struct z_erofs_decompress_req *rq,
+					  struct list_head *pagepool)
+{
+	const unsigned int nr =
+		PAGE_ALIGN(rq->pageofs_out + rq->outputsize) >> PAGE_SHIFT;
+	struct page *bounce = NULL;
+	unsigned int i;
+
+	for (i = 0; i < nr; ++i) {
+		if (rq->out[i])
+			continue;
+
+		if (bounce) {
+			get_page(bounce);
+		} else {
+			bounce = erofs_allocpage(pagepool, GFP_KERNEL);
+			if (!bounce)
+				return -ENOMEM;
+			bounce->mapping = Z_EROFS_MAPPING_STAGING;
+		}
+		rq->out[i] = bounce;
+	}
+	return 0;
+}
+
+static int z_erofs_zstd_decompress(struct z_erofs_decompress_req *rq, u8 *out)
+{
+	ZSTD_outBuffer outbuf = { .dst = out, .size = rq->outputsize };
+	ZSTD_inBuffer inbuf;
+	struct z_erofs_zstd_ctx *ctx;
+	unsigned int inputmargin;
+	bool copied;
+	size_t zerr;
+	u8 *src;
+	int ret;
+
+	if (rq->inputsize > PAGE_SIZE)
+		return -EOPNOTSUPP;
+
+	src = kmap_atomic(*rq->in);
+
+	/* compressed data is aligned to the end of pcluster by zero padding */
+	inputmargin = 0;
+	while (!src[inputmargin & ~PAGE_MASK])
+		if (!(++inputmargin & ~PAGE_MASK))
+			break;
+
+	if (inputmargin >= rq->inputsize) {
+		kunmap_atomic(src);
+		return -EIO;
+	}
+
+	/* the stream writes output while consuming input, never go inplace */
+	copied = false;
+	if (rq->inplace_io) {
+		src = generic_copy_inplace_data(rq, src, inputmargin);
+		inputmargin = 0;
+		copied = true;
+	}
+
+	inbuf.src = src + inputmargin;
+	inbuf.size = rq->inputsize - inputmargin;
+	inbuf.pos = 0;
+
+	ctx = get_cpu_ptr(z_erofs_zstd_ctxs);
+	zerr = ZSTD_resetDStream(ctx->stream);
+	if (!ZSTD_isError(zerr))
+		zerr = ZSTD_decompressStream(ctx->stream, &outbuf, &inbuf);
+	put_cpu_ptr(z_erofs_zstd_ctxs);
+
+	/* partial decoding stops once the requested output is filled */
+	ret = 0;
+	if (ZSTD_isError(zerr) || outbuf.pos != outbuf.size) {
+		erofs_err(rq->sb, "failed to decompress (zstd err %u), in[%zu, %u] out[%zu/%u]",
+			  ZSTD_isError(zerr) ? ZSTD_getErrorCode(zerr) : 0,
+			  inbuf.size, inputmargin, outbuf.pos, rq->outputsize);
+		ret = -EIO;
+	}
+
+	if (copied)
+		erofs_put_pcpubuf(src);
+	else
+		kunmap_atomic(src);
+	return ret;
+}
+#endif
+
 static struct z_erofs_decompressor decompressors[] = {
 	[Z_EROFS_COMPRESSION_SHIFTED] = {
 		.name = "shifted"
@@ -187,8 +364,43 @@ static struct z_erofs_decompressor decompressors[] = {
 		.decompress = z_erofs_lz4_decompress,
 		.name = "lz4"
 	},
+#ifdef CONFIG_EROFS_FS_ZIP_ZSTD
+	[Z_EROFS_COMPRESSION_ZSTD] = {
+		.init = z_erofs_zstd_init,
+		.exit = z_erofs_zstd_exit,
+		.prepare_destpages = z_erofs_zstd_prepare_destpages,
+		.decompress = z_erofs_zstd_decompress,
+		.name = "zstd"
+	},
+#endif
 };
 
+/*
+ * Called when an inode using @alg is first mapped, so that algorithms with
+ * per-CPU contexts only pay for them once such an image is really used.
+ */
+int z_erofs_get_decompressor(unsigned int alg)
+{
+	const struct z_erofs_decompressor *d;
+
+	if (alg >= Z_EROFS_COMPRESSION_MAX)
+		return -EOPNOTSUPP;
+
+	d = decompressors + alg;
+	if (!d->decompress)
+		return -EOPNOTSUPP;
+	return d->init ? d->init() : 0;
+}
+
+void z_erofs_put_decompressors(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(decompressors); ++i)
+		if (decompressors[i].exit)
+			decompressors[i].exit();
+}
+
 static void copy_from_pcpubuf(struct page **out, const char *dst,
 			      unsigned short pageofs_out,
 			      unsigned int outputsize)
@@ -31,13 +31,20 @@ typedef tagptr1_t compressed_page_t;
 #define tag_compressed_page_justfound(page) \
 	tagptr_fold(compressed_page_t, page, 1)
 
+/* at least this many pclusters per job when spreading a queue over CPUs */
+#define Z_EROFS_PCPU_BATCH	4
+
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
+/* per-CPU highpri workers that take over parts of a large queue */
+static struct workqueue_struct *z_erofs_pcpu_workqueue __read_mostly;
 static struct kmem_cache *pcluster_cachep __read_mostly;
 
 void z_erofs_exit_zip_subsystem(void)
 {
+	destroy_workqueue(z_erofs_pcpu_workqueue);
 	destroy_workqueue(z_erofs_workqueue);
 	kmem_cache_destroy(pcluster_cachep);
+	z_erofs_put_decompressors();
 }
 
 static inline int z_erofs_init_workqueue(void)
@@ -51,7 +58,17 @@ static inline int z_erofs_init_workqueue(void)
 	 */
 	z_erofs_workqueue = alloc_workqueue("erofs_unzipd", flags,
 					    onlinecpus + onlinecpus / 4);
-	return z_erofs_workqueue ? 0 : -ENOMEM;
+	if (!z_erofs_workqueue)
+		return -ENOMEM;
+
+	z_erofs_pcpu_workqueue = alloc_workqueue("erofs_unzipd_pcpu",
+						 WQ_HIGHPRI | WQ_CPU_INTENSIVE,
+						 0);
+	if (!z_erofs_pcpu_workqueue) {
+		destroy_workqueue(z_erofs_workqueue);
+		return -ENOMEM;
+	}
+	return 0;
 }
 
 static void z_erofs_pcluster_init_once(void *ptr)
@@ -417,7 +434,7 @@ static int z_erofs_register_collection(struct z_erofs_collector *clt,
 			Z_EROFS_PCLUSTER_FULL_LENGTH : 0);
 
 	if (map->m_flags & EROFS_MAP_ZIPPED)
-		pcl->algorithmformat = Z_EROFS_COMPRESSION_LZ4;
+		pcl->algorithmformat = EROFS_I(inode)->z_algorithmtype[0];
 	else
 		pcl->algorithmformat = Z_EROFS_COMPRESSION_SHIFTED;
 
@@ -959,6 +976,82 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+static void z_erofs_decompress_subqueue_work(struct work_struct *work)
+{
+	struct z_erofs_decompressqueue *q =
+		container_of(work, struct z_erofs_decompressqueue, u.work);
+	LIST_HEAD(pagepool);
+
+	z_erofs_decompress_queue(q, &pagepool);
+
+	put_pages_list(&pagepool);
+	kfree(q);
+}
+
+static void z_erofs_queue_subqueue(struct z_erofs_decompressqueue *q,
+				   unsigned int *cpu)
+{
+	*cpu = cpumask_next(*cpu, cpu_online_mask);
+	if (*cpu >= nr_cpu_ids)
+		*cpu = cpumask_first(cpu_online_mask);
+	queue_work_on(*cpu, z_erofs_pcpu_workqueue, &q->u.work);
+}
+
+/*
+ * Readahead easily submits dozens of pclusters in one go, and decompressing
+ * all of them in a single worker is what bounds large sequential reads.
+ * Cut the closed chain of @io into contiguous runs and hand all but the
+ * first one to per-CPU workers; the caller decompresses what's left in @io.
+ */
+static void z_erofs_spread_queue(struct z_erofs_decompressqueue *io)
+{
+	struct z_erofs_decompressqueue *q = NULL;
+	struct z_erofs_pcluster *pcl, *prev = NULL;
+	z_erofs_next_pcluster_t owned;
+	unsigned int nr = 0, nr_jobs, per_job, i = 0;
+	unsigned int cpu = raw_smp_processor_id();
+
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL_CLOSED;
+	     owned = READ_ONCE(pcl->next)) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		++nr;
+	}
+
+	nr_jobs = min(num_online_cpus(), nr / Z_EROFS_PCPU_BATCH);
+	if (nr_jobs <= 1)
+		return;
+	per_job = DIV_ROUND_UP(nr, nr_jobs);
+
+	owned = io->head;
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+
+		if (i && !(i % per_job)) {
+			struct z_erofs_decompressqueue *nq;
+
+			/* on failure, the previous job just keeps the rest */
+			nq = kmalloc(sizeof(*nq), GFP_NOIO | __GFP_NOWARN);
+			if (!nq)
+				break;
+
+			WRITE_ONCE(prev->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+			if (q)
+				z_erofs_queue_subqueue(q, &cpu);
+
+			nq->sb = io->sb;
+			nq->head = owned;
+			INIT_WORK(&nq->u.work, z_erofs_decompress_subqueue_work);
+			q = nq;
+		}
+		prev = pcl;
+		owned = READ_ONCE(pcl->next);
+		++i;
+	}
+
+	if (q)
+		z_erofs_queue_subqueue(q, &cpu);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -966,6 +1059,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	z_erofs_spread_queue(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 
 	put_pages_list(&pagepool);
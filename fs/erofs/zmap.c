@@ -4,7 +4,7 @@
  *             http://www.huawei.com/
  * Created by Gao Xiang <gaoxiang25@huawei.com>
  */
-#include "internal.h"
+#include "compress.h"
 #include <asm/unaligned.h>
 #include <trace/events/erofs.h>
 
@@ -63,10 +63,11 @@ static int z_erofs_fill_inode_lazy(struct inode *inode)
 	vi->z_algorithmtype[0] = h->h_algorithmtype & 15;
 	vi->z_algorithmtype[1] = h->h_algorithmtype >> 4;
 
-	if (vi->z_algorithmtype[0] >= Z_EROFS_COMPRESSION_MAX) {
-		erofs_err(sb, "unknown compression format %u for nid %llu, please upgrade kernel",
-			  vi->z_algorithmtype[0], vi->nid);
-		err = -EOPNOTSUPP;
+	err = z_erofs_get_decompressor(vi->z_algorithmtype[0]);
+	if (err) {
+		if (err == -EOPNOTSUPP)
+			erofs_err(sb, "unknown compression format %u for nid %llu, please upgrade kernel",
+				  vi->z_algorithmtype[0], vi->nid);
 		goto unmap_done;
 	}
 
@@ -11,6 +11,7 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/fs_context.h>
+#include <linux/slab.h>
 
 #define FUSE_CTL_SUPER_MAGIC 0x65735543
 
@@ -191,6 +192,71 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+/*
+ * Row n counts requests that transferred [2^n, 2^(n+1)) bytes and,
+ * separately, requests that took [2^n, 2^(n+1)) microseconds from being
+ * queued to being finished.  The last row also counts everything above.
+ */
+static ssize_t fuse_conn_req_hist_read(struct file *file, char __user *buf,
+				       size_t len, loff_t *ppos)
+{
+	struct fuse_req_hist *hist;
+	struct fuse_conn *fc;
+	size_t size = 0;
+	ssize_t ret;
+	char *tmp;
+	int cpu, i;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	tmp = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!tmp || !fc->req_hist) {
+		kfree(tmp);
+		fuse_conn_put(fc);
+		return -ENOMEM;
+	}
+
+	size += scnprintf(tmp, PAGE_SIZE, "%4s %12s %12s\n",
+			  "2^n", "bytes", "usecs");
+	for (i = 0; i < FUSE_HIST_BUCKETS; i++) {
+		unsigned long bytes = 0, usecs = 0;
+
+		for_each_possible_cpu(cpu) {
+			hist = per_cpu_ptr(fc->req_hist, cpu);
+			bytes += READ_ONCE(hist->size[i]);
+			usecs += READ_ONCE(hist->latency[i]);
+		}
+		size += scnprintf(tmp + size, PAGE_SIZE - size,
+				  "%4d %12lu %12lu\n", i, bytes, usecs);
+	}
+	fuse_conn_put(fc);
+
+	ret = simple_read_from_buffer(buf, len, ppos, tmp, size);
+	kfree(tmp);
+	return ret;
+}
+
+/* Any write clears the histograms */
+static ssize_t fuse_conn_req_hist_write(struct file *file,
+					const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	struct fuse_conn *fc = fuse_ctl_file_conn_get(file);
+	int cpu;
+
+	if (fc) {
+		/* Racing updates may survive, the counts are only statistics */
+		if (fc->req_hist)
+			for_each_possible_cpu(cpu)
+				memset(per_cpu_ptr(fc->req_hist, cpu), 0,
+				       sizeof(struct fuse_req_hist));
+		fuse_conn_put(fc);
+	}
+	return count;
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -217,6 +283,13 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_conn_req_hist_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_req_hist_read,
+	.write = fuse_conn_req_hist_write,
+	.llseek = no_llseek,
+};
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -285,7 +358,9 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "req_histogram", S_IFREG | 0600,
+				 1, NULL, &fuse_conn_req_hist_ops))
 		goto err;
 
 	return 0;
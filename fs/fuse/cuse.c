@@ -510,6 +510,7 @@ static int cuse_channel_open(struct inode *inode, struct file *file)
 
 	fud = fuse_dev_alloc_install(&cc->fc);
 	if (!fud) {
+		free_percpu(cc->fc.req_hist);
 		kfree(cc);
 		return -ENOMEM;
 	}
@@ -21,6 +21,8 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/eventfd.h>
+#include <linux/vmalloc.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -29,6 +31,42 @@ MODULE_ALIAS("devname:fuse");
 #define FUSE_INT_REQ_BIT (1ULL << 0)
 #define FUSE_REQ_ID_STEP (1ULL << 1)
 
+/* Limits for FUSE_DEV_IOC_RING_SETUP */
+#define FUSE_RING_MAX_ENTRIES		1024
+#define FUSE_RING_MAX_ENTRY_SIZE	((FUSE_MAX_MAX_PAGES + 1) << PAGE_SHIFT)
+#define FUSE_RING_MAX_SIZE		(64 << 20)
+
+/* Shared-memory transport of a /dev/fuse device */
+struct fuse_ring {
+	struct fuse_dev *fud;
+	/* The input queue this ring drains */
+	struct fuse_iqueue *fiq;
+
+	/* vmalloc_user() area shared with the daemon, starts with hdr */
+	struct fuse_ring_hdr *hdr;
+	size_t size;
+	unsigned int entries;
+	unsigned int entry_size;
+	size_t sq_off;
+	size_t cq_off;
+
+	/* Signalled when requests are queued and the daemon is waiting */
+	struct eventfd_ctx *efd;
+
+	/* Fills the submission slots, protects sq_tail and sq_bvec */
+	struct mutex sq_lock;
+	u32 sq_tail;
+	struct bio_vec *sq_bvec;
+
+	/* Drains the completion slots, protects cq_head and cq_bvec */
+	struct mutex cq_lock;
+	u32 cq_head;
+	struct bio_vec *cq_bvec;
+
+	/* Runs fuse_ring_dispatch() when requests are queued */
+	struct work_struct work;
+};
+
 static struct kmem_cache *fuse_req_cachep;
 
 static struct fuse_dev *fuse_get_dev(struct file *file)
@@ -208,6 +246,8 @@ __releases(fiq->lock)
 {
 	wake_up(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+	if (fiq->ring)
+		schedule_work(&fiq->ring->work);
 	spin_unlock(&fiq->lock);
 }
 
@@ -225,10 +265,57 @@ __releases(fiq->lock)
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+	req->fiq = fiq;
+	req->queue_time = ktime_get();
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
 
+/*
+ * Lock the input queue a new request should go to: the current CPU's
+ * queue if a device is bound to it, fc->iq otherwise.
+ */
+static struct fuse_iqueue *fuse_lock_iqueue(struct fuse_conn *fc)
+{
+	struct fuse_iqueue **cpu_iq = smp_load_acquire(&fc->cpu_iq);
+	struct fuse_iqueue *fiq;
+
+	if (cpu_iq) {
+		fiq = smp_load_acquire(&cpu_iq[raw_smp_processor_id()]);
+		if (fiq) {
+			spin_lock(&fiq->lock);
+			if (fiq->connected)
+				return fiq;
+			spin_unlock(&fiq->lock);
+		}
+	}
+
+	fiq = &fc->iq;
+	spin_lock(&fiq->lock);
+	return fiq;
+}
+
+/* Lock the input queue a pending request is on */
+static struct fuse_iqueue *fuse_req_lock_iqueue(struct fuse_req *req)
+{
+	struct fuse_iqueue *fiq;
+
+	for (;;) {
+		fiq = READ_ONCE(req->fiq);
+		spin_lock(&fiq->lock);
+		/* The request may have moved to fc->iq meanwhile */
+		if (likely(fiq == req->fiq))
+			return fiq;
+		spin_unlock(&fiq->lock);
+	}
+}
+
+/* The input queue the given device reads from */
+static struct fuse_iqueue *fuse_dev_iqueue(struct fuse_dev *fud)
+{
+	return READ_ONCE(fud->iq) ?: &fud->fc->iq;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -250,7 +337,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 
 static void flush_bg_queue(struct fuse_conn *fc)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
@@ -259,12 +346,27 @@ static void flush_bg_queue(struct fuse_conn *fc)
 		req = list_first_entry(&fc->bg_queue, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		spin_lock(&fiq->lock);
+		fiq = fuse_lock_iqueue(fc);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request_and_unlock(fiq, req);
 	}
 }
 
+static unsigned int fuse_hist_bucket(u64 val)
+{
+	return val ? min(fls64(val) - 1, FUSE_HIST_BUCKETS - 1) : 0;
+}
+
+/* Add a finished request to the connection's histograms */
+static void fuse_req_account(struct fuse_conn *fc, struct fuse_req *req)
+{
+	u64 usecs = ktime_us_delta(ktime_get(), req->queue_time);
+	u32 bytes = max(req->in.h.len, req->out.h.len);
+
+	this_cpu_inc(fc->req_hist->size[fuse_hist_bucket(bytes)]);
+	this_cpu_inc(fc->req_hist->latency[fuse_hist_bucket(usecs)]);
+}
+
 /*
  * This function is called when a request is finished.  Either a reply
  * has arrived or it was aborted (and not yet sent) or some error
@@ -281,6 +383,9 @@ void fuse_request_end(struct fuse_conn *fc, struct fuse_req *req)
 	if (test_and_set_bit(FR_FINISHED, &req->flags))
 		goto put_request;
 
+	if (req->queue_time && fc->req_hist)
+		fuse_req_account(fc, req);
+
 	async = req->args->end;
 	/*
 	 * test_and_set_bit() implies smp_mb() between bit
@@ -361,7 +466,7 @@ static int queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -375,7 +480,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		/* matches barrier in fuse_dev_do_read() */
 		smp_mb__after_atomic();
 		if (test_bit(FR_SENT, &req->flags))
-			queue_interrupt(fiq, req);
+			queue_interrupt(&fc->iq, req);
 	}
 
 	if (!test_bit(FR_FORCE, &req->flags)) {
@@ -385,7 +490,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->lock);
+		fiq = fuse_req_lock_iqueue(req);
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
@@ -406,10 +511,10 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
+	fiq = fuse_lock_iqueue(fc);
 	if (!fiq->connected) {
 		spin_unlock(&fiq->lock);
 		req->out.h.error = -ENOTCONN;
@@ -573,7 +678,7 @@ static int fuse_simple_notify_reply(struct fuse_conn *fc,
 				    struct fuse_args *args, u64 unique)
 {
 	struct fuse_req *req;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 	int err = 0;
 
 	req = fuse_get_req(fc, false);
@@ -585,7 +690,7 @@ static int fuse_simple_notify_reply(struct fuse_conn *fc,
 
 	fuse_args_to_req(req, args);
 
-	spin_lock(&fiq->lock);
+	fiq = fuse_lock_iqueue(fc);
 	if (fiq->connected) {
 		queue_request_and_unlock(fiq, req);
 	} else {
@@ -1164,6 +1269,74 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Copy a request taken off the input queue to the daemon and put it on
+ * the processing queue of @fud.  Returns the size of the request, an
+ * error, or zero if the request didn't fit into @nbytes and was ended.
+ */
+static ssize_t fuse_dev_send_req(struct fuse_dev *fud,
+				 struct fuse_copy_state *cs,
+				 struct fuse_req *req, size_t nbytes)
+{
+	ssize_t err;
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_pqueue *fpq = &fud->pq;
+	struct fuse_args *args = req->args;
+	unsigned reqsize = req->in.h.len;
+	unsigned int hash;
+
+	if (nbytes < reqsize) {
+		req->out.h.error = -EIO;
+		/* SETXATTR is special, since it may contain too large data */
+		if (args->opcode == FUSE_SETXATTR)
+			req->out.h.error = -E2BIG;
+		fuse_request_end(fc, req);
+		return 0;
+	}
+	spin_lock(&fpq->lock);
+	list_add(&req->list, &fpq->io);
+	spin_unlock(&fpq->lock);
+	cs->req = req;
+	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
+	if (!err)
+		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
+				     (struct fuse_arg *) args->in_args, 0);
+	fuse_copy_finish(cs);
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected) {
+		err = fc->aborted ? -ECONNABORTED : -ENODEV;
+		goto out_end;
+	}
+	if (err) {
+		req->out.h.error = -EIO;
+		goto out_end;
+	}
+	if (!test_bit(FR_ISREPLY, &req->flags)) {
+		err = reqsize;
+		goto out_end;
+	}
+	hash = fuse_req_hash(req->in.h.unique);
+	list_move_tail(&req->list, &fpq->processing[hash]);
+	__fuse_get_request(req);
+	set_bit(FR_SENT, &req->flags);
+	spin_unlock(&fpq->lock);
+	/* matches barrier in request_wait_answer() */
+	smp_mb__after_atomic();
+	if (test_bit(FR_INTERRUPTED, &req->flags))
+		queue_interrupt(&fc->iq, req);
+	fuse_put_request(fc, req);
+
+	return reqsize;
+
+out_end:
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	spin_unlock(&fpq->lock);
+	fuse_request_end(fc, req);
+	return err;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1178,12 +1351,8 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
-	struct fuse_iqueue *fiq = &fc->iq;
-	struct fuse_pqueue *fpq = &fud->pq;
+	struct fuse_iqueue *fiq = fuse_dev_iqueue(fud);
 	struct fuse_req *req;
-	struct fuse_args *args;
-	unsigned reqsize;
-	unsigned int hash;
 
 	/*
 	 * Require sane minimum read buffer - that has capacity for fixed part
@@ -1242,59 +1411,10 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
-	args = req->args;
-	reqsize = req->in.h.len;
-
-	/* If request is too large, reply with an error and restart the read */
-	if (nbytes < reqsize) {
-		req->out.h.error = -EIO;
-		/* SETXATTR is special, since it may contain too large data */
-		if (args->opcode == FUSE_SETXATTR)
-			req->out.h.error = -E2BIG;
-		fuse_request_end(fc, req);
-		goto restart;
-	}
-	spin_lock(&fpq->lock);
-	list_add(&req->list, &fpq->io);
-	spin_unlock(&fpq->lock);
-	cs->req = req;
-	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
+	err = fuse_dev_send_req(fud, cs, req, nbytes);
+	/* If request is too large, it was ended with an error */
 	if (!err)
-		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
-				     (struct fuse_arg *) args->in_args, 0);
-	fuse_copy_finish(cs);
-	spin_lock(&fpq->lock);
-	clear_bit(FR_LOCKED, &req->flags);
-	if (!fpq->connected) {
-		err = fc->aborted ? -ECONNABORTED : -ENODEV;
-		goto out_end;
-	}
-	if (err) {
-		req->out.h.error = -EIO;
-		goto out_end;
-	}
-	if (!test_bit(FR_ISREPLY, &req->flags)) {
-		err = reqsize;
-		goto out_end;
-	}
-	hash = fuse_req_hash(req->in.h.unique);
-	list_move_tail(&req->list, &fpq->processing[hash]);
-	__fuse_get_request(req);
-	set_bit(FR_SENT, &req->flags);
-	spin_unlock(&fpq->lock);
-	/* matches barrier in request_wait_answer() */
-	smp_mb__after_atomic();
-	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(fiq, req);
-	fuse_put_request(fc, req);
-
-	return reqsize;
-
-out_end:
-	if (!test_bit(FR_PRIVATE, &req->flags))
-		list_del_init(&req->list);
-	spin_unlock(&fpq->lock);
-	fuse_request_end(fc, req);
+		goto restart;
 	return err;
 
  err_unlock:
@@ -2022,6 +2142,238 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+/* Describe @len bytes of a ring slot with the ring's bvec array @bvec */
+static void fuse_ring_slot_iter(struct iov_iter *iter, unsigned int dir,
+				struct bio_vec *bvec, void *slot, size_t len)
+{
+	unsigned int i, nr = DIV_ROUND_UP(len, PAGE_SIZE);
+
+	for (i = 0; i < nr; i++) {
+		bvec[i].bv_page = vmalloc_to_page(slot + i * PAGE_SIZE);
+		bvec[i].bv_offset = 0;
+		bvec[i].bv_len = min_t(size_t, len - i * PAGE_SIZE, PAGE_SIZE);
+	}
+	iov_iter_bvec(iter, dir, bvec, nr, len);
+}
+
+/*
+ * Move pending requests of the ring's input queue into free submission
+ * slots, the same way fuse_dev_do_read() copies them to a read buffer.
+ * Forgets and interrupts are left for read().
+ */
+static void fuse_ring_dispatch(struct fuse_ring *ring)
+{
+	struct fuse_ring_hdr *hdr = ring->hdr;
+	struct fuse_iqueue *fiq = ring->fiq;
+	unsigned int queued = 0;
+
+	mutex_lock(&ring->sq_lock);
+	for (;;) {
+		struct fuse_copy_state cs;
+		struct iov_iter iter;
+		struct fuse_req *req;
+		void *slot;
+
+		/* The daemon hasn't consumed the oldest slot yet */
+		if (ring->sq_tail - smp_load_acquire(&hdr->sq_head) >=
+		    ring->entries)
+			break;
+
+		spin_lock(&fiq->lock);
+		if (!fiq->connected || list_empty(&fiq->pending)) {
+			spin_unlock(&fiq->lock);
+			break;
+		}
+		req = list_first_entry(&fiq->pending, struct fuse_req, list);
+		clear_bit(FR_PENDING, &req->flags);
+		list_del_init(&req->list);
+		spin_unlock(&fiq->lock);
+
+		slot = (void *)hdr + ring->sq_off +
+			(ring->sq_tail & (ring->entries - 1)) * ring->entry_size;
+		fuse_ring_slot_iter(&iter, READ, ring->sq_bvec, slot,
+				    ring->entry_size);
+		fuse_copy_init(&cs, 1, &iter);
+		if (fuse_dev_send_req(ring->fud, &cs, req,
+				      ring->entry_size) <= 0)
+			continue;
+
+		smp_store_release(&hdr->sq_tail, ++ring->sq_tail);
+		queued++;
+	}
+	mutex_unlock(&ring->sq_lock);
+
+	if (!queued)
+		return;
+
+	/* Pairs with the daemon setting NEED_WAKEUP then rechecking sq_tail */
+	smp_mb();
+	if (READ_ONCE(hdr->flags) & FUSE_RING_NEED_WAKEUP)
+		eventfd_signal(ring->efd, 1);
+}
+
+static void fuse_ring_work_fn(struct work_struct *work)
+{
+	fuse_ring_dispatch(container_of(work, struct fuse_ring, work));
+}
+
+/*
+ * Handle the replies the daemon put into the completion slots, as if
+ * each was passed to write().  Returns the number of slots consumed.
+ */
+static int fuse_ring_complete(struct fuse_ring *ring)
+{
+	struct fuse_ring_hdr *hdr = ring->hdr;
+	int done = 0;
+	u32 tail;
+
+	mutex_lock(&ring->cq_lock);
+	tail = smp_load_acquire(&hdr->cq_tail);
+	if (tail - ring->cq_head > ring->entries) {
+		mutex_unlock(&ring->cq_lock);
+		return -EINVAL;
+	}
+
+	while (ring->cq_head != tail) {
+		struct fuse_out_header *oh;
+		struct fuse_copy_state cs;
+		struct iov_iter iter;
+		u32 len;
+
+		oh = (void *)hdr + ring->cq_off +
+			(ring->cq_head & (ring->entries - 1)) * ring->entry_size;
+		/* fuse_dev_do_write() rechecks it against what it copies */
+		len = READ_ONCE(oh->len);
+		if (len >= sizeof(*oh) && len <= ring->entry_size) {
+			fuse_ring_slot_iter(&iter, WRITE, ring->cq_bvec, oh,
+					    len);
+			fuse_copy_init(&cs, 0, &iter);
+			fuse_dev_do_write(ring->fud, &cs, len);
+		}
+
+		smp_store_release(&hdr->cq_head, ++ring->cq_head);
+		done++;
+	}
+	mutex_unlock(&ring->cq_lock);
+
+	return done;
+}
+
+static void fuse_ring_free(struct fuse_ring *ring)
+{
+	if (ring->efd)
+		eventfd_ctx_put(ring->efd);
+	kfree(ring->sq_bvec);
+	kfree(ring->cq_bvec);
+	vfree(ring->hdr);
+	kfree(ring);
+}
+
+static int fuse_ring_setup(struct file *file,
+			   struct fuse_ring_setup __user *arg)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_ring_setup setup;
+	struct fuse_iqueue *fiq;
+	struct fuse_ring *ring;
+	unsigned int nr_pages;
+	int err;
+
+	if (!fud)
+		return -EPERM;
+	if (copy_from_user(&setup, arg, sizeof(setup)))
+		return -EFAULT;
+
+	if (setup.flags || !is_power_of_2(setup.entries) ||
+	    setup.entries > FUSE_RING_MAX_ENTRIES ||
+	    setup.entry_size < FUSE_MIN_READ_BUFFER ||
+	    setup.entry_size > FUSE_RING_MAX_ENTRY_SIZE ||
+	    !PAGE_ALIGNED(setup.entry_size) ||
+	    (u64)setup.entries * setup.entry_size * 2 > FUSE_RING_MAX_SIZE)
+		return -EINVAL;
+
+	fiq = fuse_dev_iqueue(fud);
+	if (fiq->ops != &fuse_dev_fiq_ops)
+		return -EOPNOTSUPP;
+	if (fud->ring)
+		return -EBUSY;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->fud = fud;
+	ring->fiq = fiq;
+	ring->entries = setup.entries;
+	ring->entry_size = setup.entry_size;
+	ring->sq_off = PAGE_SIZE;
+	ring->cq_off = ring->sq_off + (size_t)setup.entries * setup.entry_size;
+	ring->size = ring->cq_off + (size_t)setup.entries * setup.entry_size;
+	mutex_init(&ring->sq_lock);
+	mutex_init(&ring->cq_lock);
+	INIT_WORK(&ring->work, fuse_ring_work_fn);
+
+	err = -ENOMEM;
+	nr_pages = setup.entry_size >> PAGE_SHIFT;
+	ring->sq_bvec = kcalloc(nr_pages, sizeof(struct bio_vec), GFP_KERNEL);
+	ring->cq_bvec = kcalloc(nr_pages, sizeof(struct bio_vec), GFP_KERNEL);
+	ring->hdr = vmalloc_user(ring->size);
+	if (!ring->sq_bvec || !ring->cq_bvec || !ring->hdr)
+		goto out_free;
+
+	ring->efd = eventfd_ctx_fdget(setup.eventfd);
+	if (IS_ERR(ring->efd)) {
+		err = PTR_ERR(ring->efd);
+		ring->efd = NULL;
+		goto out_free;
+	}
+
+	ring->hdr->entries = ring->entries;
+	ring->hdr->entry_size = ring->entry_size;
+	ring->hdr->sq_off = ring->sq_off;
+	ring->hdr->cq_off = ring->cq_off;
+
+	spin_lock(&fiq->lock);
+	if (!fiq->connected || fiq->ring) {
+		err = fiq->connected ? -EBUSY : -ENOTCONN;
+		spin_unlock(&fiq->lock);
+		goto out_free;
+	}
+	fiq->ring = ring;
+	spin_unlock(&fiq->lock);
+
+	fud->ring = ring;
+	/* Pick up whatever was queued before the ring existed */
+	schedule_work(&ring->work);
+	return 0;
+
+out_free:
+	fuse_ring_free(ring);
+	return err;
+}
+
+static void fuse_ring_destroy(struct fuse_ring *ring)
+{
+	struct fuse_iqueue *fiq = ring->fiq;
+
+	spin_lock(&fiq->lock);
+	fiq->ring = NULL;
+	spin_unlock(&fiq->lock);
+	cancel_work_sync(&ring->work);
+	fuse_ring_free(ring);
+}
+
+static int fuse_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_ring *ring = fud ? READ_ONCE(fud->ring) : NULL;
+
+	if (!ring)
+		return -ENODEV;
+
+	return remap_vmalloc_range(vma, ring->hdr, vma->vm_pgoff);
+}
+
 static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
@@ -2031,7 +2383,7 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 	if (!fud)
 		return EPOLLERR;
 
-	fiq = &fud->fc->iq;
+	fiq = fuse_dev_iqueue(fud);
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->lock);
@@ -2134,6 +2486,29 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		flush_bg_queue(fc);
 		spin_unlock(&fc->bg_lock);
 
+		/*
+		 * Per-CPU queues go first: requests only ever move from them
+		 * to fc->iq, never back.
+		 */
+		if (fc->cpu_iq) {
+			int cpu;
+
+			for_each_possible_cpu(cpu) {
+				struct fuse_iqueue *cfiq = fc->cpu_iq[cpu];
+
+				if (!cfiq)
+					continue;
+				spin_lock(&cfiq->lock);
+				cfiq->connected = 0;
+				list_for_each_entry(req, &cfiq->pending, list)
+					clear_bit(FR_PENDING, &req->flags);
+				list_splice_tail_init(&cfiq->pending, &to_end);
+				wake_up_all(&cfiq->waitq);
+				spin_unlock(&cfiq->lock);
+				kill_fasync(&cfiq->fasync, SIGIO, POLL_IN);
+			}
+		}
+
 		spin_lock(&fiq->lock);
 		fiq->connected = 0;
 		list_for_each_entry(req, &fiq->pending, list)
@@ -2162,6 +2537,33 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Drop a device's binding to its per-CPU queue.  When the last reader of
+ * the queue goes away, requests still pending on it are handed over to
+ * fc->iq so that they don't get stranded.
+ */
+static void fuse_device_unbind(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = fud->iq;
+	struct fuse_iqueue *shared = &fud->fc->iq;
+	struct fuse_req *req;
+
+	spin_lock(&fiq->lock);
+	if (--fiq->nr_devs || !fiq->connected) {
+		spin_unlock(&fiq->lock);
+		return;
+	}
+
+	fiq->connected = 0;
+	/* fuse_abort_conn() disconnects us before fc->iq, so it's live */
+	spin_lock(&shared->lock);
+	list_for_each_entry(req, &fiq->pending, list)
+		WRITE_ONCE(req->fiq, shared);
+	list_splice_tail_init(&fiq->pending, &shared->pending);
+	shared->ops->wake_pending_and_unlock(shared);
+	spin_unlock(&fiq->lock);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2172,6 +2574,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		LIST_HEAD(to_end);
 		unsigned int i;
 
+		if (fud->ring)
+			fuse_ring_destroy(fud->ring);
+
 		spin_lock(&fpq->lock);
 		WARN_ON(!list_empty(&fpq->io));
 		for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
@@ -2180,6 +2585,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(fc, &to_end);
 
+		if (fud->iq)
+			fuse_device_unbind(fud);
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2199,7 +2607,7 @@ static int fuse_dev_fasync(int fd, struct file *file, int on)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fud->fc->iq.fasync);
+	return fasync_helper(fd, file, on, &fuse_dev_iqueue(fud)->fasync);
 }
 
 static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
@@ -2219,11 +2627,96 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+static int fuse_device_bind_cpu(struct file *file, u32 cpu)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_conn *fc;
+	struct fuse_iqueue **cpu_iq, *fiq;
+
+	if (!fud)
+		return -EPERM;
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	fc = fud->fc;
+	/* Other transports (virtio-fs) do their own queueing */
+	if (fc->iq.ops != &fuse_dev_fiq_ops)
+		return -EOPNOTSUPP;
+	/* fasync lists and rings are per queue, so don't move the fd */
+	if (fud->iq || fud->ring || (file->f_flags & FASYNC))
+		return -EBUSY;
+
+	cpu_iq = fc->cpu_iq;
+	if (!cpu_iq) {
+		cpu_iq = kcalloc(nr_cpu_ids, sizeof(*cpu_iq), GFP_KERNEL);
+		if (!cpu_iq)
+			return -ENOMEM;
+		smp_store_release(&fc->cpu_iq, cpu_iq);
+	}
+
+	fiq = cpu_iq[cpu];
+	if (!fiq) {
+		fiq = kmalloc(sizeof(*fiq), GFP_KERNEL);
+		if (!fiq)
+			return -ENOMEM;
+		fuse_iqueue_init(fiq, &fuse_dev_fiq_ops, NULL);
+		fiq->connected = 0;
+		/* Keep request IDs unique across all queues */
+		fiq->reqctr = (u64)(cpu + 1) << 48;
+		smp_store_release(&cpu_iq[cpu], fiq);
+	}
+
+	spin_lock(&fiq->lock);
+	/* Pairs with fuse_abort_conn() clearing fc->connected first */
+	if (!fc->connected) {
+		spin_unlock(&fiq->lock);
+		return -ENOTCONN;
+	}
+	fiq->nr_devs++;
+	fiq->connected = 1;
+	spin_unlock(&fiq->lock);
+
+	WRITE_ONCE(fud->iq, fiq);
+	return 0;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
 	int err = -ENOTTY;
 
+	if (cmd == FUSE_DEV_IOC_BIND_CPU && file->f_op == &fuse_dev_operations) {
+		u32 cpu;
+
+		if (get_user(cpu, (__u32 __user *) arg))
+			return -EFAULT;
+
+		mutex_lock(&fuse_mutex);
+		err = fuse_device_bind_cpu(file, cpu);
+		mutex_unlock(&fuse_mutex);
+		return err;
+	}
+
+	if (cmd == FUSE_DEV_IOC_RING_SETUP &&
+	    file->f_op == &fuse_dev_operations) {
+		mutex_lock(&fuse_mutex);
+		err = fuse_ring_setup(file, (void __user *) arg);
+		mutex_unlock(&fuse_mutex);
+		return err;
+	}
+
+	if (cmd == FUSE_DEV_IOC_RING_ENTER) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+		struct fuse_ring *ring = fud ? READ_ONCE(fud->ring) : NULL;
+
+		if (!ring)
+			return -EINVAL;
+
+		err = fuse_ring_complete(ring);
+		fuse_ring_dispatch(ring);
+		return err;
+	}
+
 	if (cmd == FUSE_DEV_IOC_CLONE) {
 		int oldfd;
 
@@ -2264,6 +2757,7 @@ const struct file_operations fuse_dev_operations = {
 	.write_iter	= fuse_dev_write,
 	.splice_write	= fuse_dev_splice_write,
 	.poll		= fuse_dev_poll,
+	.mmap		= fuse_dev_mmap,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
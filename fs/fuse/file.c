@@ -962,6 +962,36 @@ static int fuse_readpages_fill(void *_data, struct page *page)
 	return 0;
 }
 
+/*
+ * The VM ramps readahead up to file->f_ra.ra_pages, which starts out at the
+ * bdi default of 128k.  For a connection that negotiated larger requests,
+ * double the window each time readahead continues exactly where the last
+ * one ended, up to fc->max_pages, and halve it back on a non-sequential
+ * readahead so that random readers don't pay for it.
+ */
+static void fuse_readahead_adapt(struct file *file, struct fuse_conn *fc,
+				 pgoff_t start, unsigned int nr_pages)
+{
+	struct fuse_file *ff = file->private_data;
+	unsigned int base = inode_to_bdi(file_inode(file))->ra_pages;
+	unsigned int ra_pages = file->f_ra.ra_pages;
+
+	if (fc->max_pages <= base)
+		return;
+
+	if (start == READ_ONCE(ff->ra_next))
+		ra_pages = min(ra_pages * 2, fc->max_pages);
+	else
+		ra_pages = max(ra_pages / 2, base);
+	WRITE_ONCE(ff->ra_next, start + nr_pages);
+
+	if (ra_pages != file->f_ra.ra_pages) {
+		spin_lock(&file->f_lock);
+		file->f_ra.ra_pages = ra_pages;
+		spin_unlock(&file->f_lock);
+	}
+}
+
 static int fuse_readpages(struct file *file, struct address_space *mapping,
 			  struct list_head *pages, unsigned nr_pages)
 {
@@ -974,6 +1004,8 @@ static int fuse_readpages(struct file *file, struct address_space *mapping,
 	if (is_bad_inode(inode))
 		goto out;
 
+	fuse_readahead_adapt(file, fc, lru_to_page(pages)->index, nr_pages);
+
 	data.file = file;
 	data.inode = inode;
 	data.nr_pages = nr_pages;
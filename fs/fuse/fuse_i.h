@@ -31,12 +31,13 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/percpu.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
 
 /** Maximum of max_pages received in init_out */
-#define FUSE_MAX_MAX_PAGES 256
+#define FUSE_MAX_MAX_PAGES 1024
 
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
@@ -44,8 +45,62 @@
 /** It could be as large as PATH_MAX, but would that have any uses? */
 #define FUSE_NAME_MAX 1024
 
+/*
+ * Bind a cloned /dev/fuse fd to a CPU: requests submitted on that CPU are
+ * then queued for readers of this fd only.  Not in <linux/fuse.h> yet.
+ */
+#ifndef FUSE_DEV_IOC_BIND_CPU
+#define FUSE_DEV_IOC_BIND_CPU		_IOW(FUSE_DEV_IOC_MAGIC, 1, uint32_t)
+#endif
+
+#ifndef FUSE_DEV_IOC_RING_SETUP
+/*
+ * Shared-memory transport for a /dev/fuse fd, as an alternative to
+ * read()/write().  The daemon sets it up with FUSE_DEV_IOC_RING_SETUP and
+ * mmap()s the fd at offset 0: the first page holds struct fuse_ring_hdr,
+ * followed by the submission slots (requests, each starting with struct
+ * fuse_in_header) and the completion slots (replies, each starting with
+ * struct fuse_out_header).  Replies are consumed on FUSE_DEV_IOC_RING_ENTER.
+ */
+struct fuse_ring_hdr {
+	uint32_t	sq_head;	/* next request the daemon will read */
+	uint32_t	sq_tail;	/* next request slot the kernel fills */
+	uint32_t	cq_head;	/* next reply the kernel will read */
+	uint32_t	cq_tail;	/* next reply slot the daemon fills */
+	uint32_t	entries;
+	uint32_t	entry_size;
+	uint32_t	flags;
+	uint32_t	padding;
+	uint64_t	sq_off;
+	uint64_t	cq_off;
+};
+
+/* fuse_ring_hdr.flags: daemon is going to sleep on the eventfd */
+#define FUSE_RING_NEED_WAKEUP		(1 << 0)
+
+struct fuse_ring_setup {
+	uint32_t	entries;	/* power of two */
+	uint32_t	entry_size;	/* multiple of the page size */
+	int32_t		eventfd;	/* signalled when a request is queued */
+	uint32_t	flags;		/* must be zero */
+};
+
+#define FUSE_DEV_IOC_RING_SETUP		_IOW(FUSE_DEV_IOC_MAGIC, 2, \
+					     struct fuse_ring_setup)
+#define FUSE_DEV_IOC_RING_ENTER		_IO(FUSE_DEV_IOC_MAGIC, 3)
+#endif
+
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
+
+/** Number of log2 buckets in the per-connection request histograms */
+#define FUSE_HIST_BUCKETS 24
+
+/** Finished requests, by log2 of bytes transferred and of usecs */
+struct fuse_req_hist {
+	unsigned long size[FUSE_HIST_BUCKETS];
+	unsigned long latency[FUSE_HIST_BUCKETS];
+};
 
 /** List of active connections */
 extern struct list_head fuse_conn_list;
@@ -189,6 +244,9 @@ struct fuse_file {
 	/** Entry on inode's write_files list */
 	struct list_head write_entry;
 
+	/** Page readahead is expected to continue at if reads are sequential */
+	pgoff_t ra_next;
+
 	/* Readdir related */
 	struct {
 		/*
@@ -353,6 +411,12 @@ struct fuse_req {
 	/** Used to wake up the task waiting for completion of request*/
 	wait_queue_head_t waitq;
 
+	/** Input queue the request is pending on, changes under its lock */
+	struct fuse_iqueue *fiq;
+
+	/** When the request was queued, for the latency histogram */
+	ktime_t queue_time;
+
 #if IS_ENABLED(CONFIG_VIRTIO_FS)
 	/** virtio-fs's physically contiguous buffer for in and out args */
 	void *argbuf;
@@ -360,6 +424,7 @@ struct fuse_req {
 };
 
 struct fuse_iqueue;
+struct fuse_ring;
 
 /**
  * Input queue callbacks
@@ -431,6 +496,12 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+	/** Number of devices bound to this queue (per-CPU queues only) */
+	unsigned int nr_devs;
+
+	/** Shared-memory ring that requests of this queue are copied to */
+	struct fuse_ring *ring;
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -460,6 +531,12 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Per-CPU input queue this device reads, NULL for fc->iq */
+	struct fuse_iqueue *iq;
+
+	/** Shared-memory transport set up on this device, if any */
+	struct fuse_ring *ring;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -531,6 +608,13 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/**
+	 * Per-CPU input queues for devices bound with FUSE_DEV_IOC_BIND_CPU,
+	 * indexed by CPU and allocated on first use.  Forgets and interrupts
+	 * are always queued on @iq.
+	 */
+	struct fuse_iqueue **cpu_iq;
+
 	/** The next unique kernel file handle */
 	atomic64_t khctr;
 
@@ -752,6 +836,9 @@ struct fuse_conn {
 
 	/** List of device instances belonging to this connection */
 	struct list_head devices;
+
+	/** Per-cpu request histograms, NULL if they could not be allocated */
+	struct fuse_req_hist __percpu *req_hist;
 };
 
 static inline struct fuse_conn *get_fuse_conn_super(struct super_block *sb)
@@ -949,6 +1036,12 @@ struct fuse_conn *fuse_conn_get(struct fuse_conn *fc);
 void fuse_conn_init(struct fuse_conn *fc, struct user_namespace *user_ns,
 		    const struct fuse_iqueue_ops *fiq_ops, void *fiq_priv);
 
+/**
+ * Initialize an input queue
+ */
+void fuse_iqueue_init(struct fuse_iqueue *fiq,
+		      const struct fuse_iqueue_ops *ops, void *priv);
+
 /**
  * Release reference to fuse_conn
  */
@@ -13,6 +13,9 @@
 #include <linux/highmem.h>
 #include "fuse_i.h"
 
+/* Completed requests reaped from a request queue per lock round trip */
+#define VIRTIO_FS_REAP_BATCH 16
+
 /* List of virtio-fs device instances and a lock for the list. Also provides
  * mutual exclusion in device removal and mounting path
  */
@@ -496,7 +499,9 @@ static void virtio_fs_requests_done_work(struct work_struct *work)
 	struct fuse_args_pages *ap;
 	struct fuse_req *next;
 	struct fuse_args *args;
-	unsigned int len, i, thislen;
+	void *bufs[VIRTIO_FS_REAP_BATCH];
+	unsigned int lens[VIRTIO_FS_REAP_BATCH];
+	unsigned int len, i, n, thislen, nr_ended = 0;
 	struct page *page;
 	LIST_HEAD(reqs);
 
@@ -505,9 +510,13 @@ static void virtio_fs_requests_done_work(struct work_struct *work)
 	do {
 		virtqueue_disable_cb(vq);
 
-		while ((req = virtqueue_get_buf(vq, &len)) != NULL) {
+		while ((n = virtqueue_get_bufs(vq, bufs, lens,
+					       ARRAY_SIZE(bufs))) != 0) {
 			spin_lock(&fpq->lock);
-			list_move_tail(&req->list, &reqs);
+			for (i = 0; i < n; i++) {
+				req = bufs[i];
+				list_move_tail(&req->list, &reqs);
+			}
 			spin_unlock(&fpq->lock);
 		}
 	} while (!virtqueue_enable_cb(vq) && likely(!virtqueue_is_broken(vq)));
@@ -544,8 +553,13 @@ static void virtio_fs_requests_done_work(struct work_struct *work)
 		spin_unlock(&fpq->lock);
 
 		fuse_request_end(fc, req);
+		nr_ended++;
+	}
+
+	if (nr_ended) {
 		spin_lock(&fsvq->lock);
-		dec_in_flight_req(fsvq);
+		while (nr_ended--)
+			dec_in_flight_req(fsvq);
 		spin_unlock(&fsvq->lock);
 	}
 }
@@ -795,29 +795,70 @@ iomap_write_end(struct inode *inode, loff_t pos, unsigned len, unsigned copied,
 	return ret;
 }
 
+/*
+ * Maximum number of pages a single write iteration prepares, copies into and
+ * finishes together.
+ */
+#define IOMAP_WRITE_BATCH	16
+
+/*
+ * Pages can only be locked and prepared in batches when nothing hooks into
+ * the per-page write_begin/write_end sequence: page_prepare/page_done may
+ * open a transaction per page, and inline and buffer_head mappings are
+ * handled a page at a time.
+ */
+static unsigned
+iomap_write_batch_pages(struct iomap *iomap, struct iomap *srcmap)
+{
+	const struct iomap_page_ops *page_ops = iomap->page_ops;
+
+	if (srcmap->type == IOMAP_INLINE ||
+	    ((iomap->flags | srcmap->flags) & IOMAP_F_BUFFER_HEAD))
+		return 1;
+	if (page_ops && (page_ops->page_prepare || page_ops->page_done))
+		return 1;
+	return IOMAP_WRITE_BATCH;
+}
+
+/*
+ * Release a page from iomap_write_begin() without copying anything into it.
+ */
+static void
+iomap_write_abort(struct inode *inode, loff_t pos, unsigned len,
+		struct page *page)
+{
+	unlock_page(page);
+	put_page(page);
+	iomap_write_failed(inode, pos, len);
+}
+
 static loff_t
 iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 		struct iomap *iomap, struct iomap *srcmap)
 {
 	struct iov_iter *i = data;
+	unsigned max_pages = iomap_write_batch_pages(iomap, srcmap);
+	struct page *pages[IOMAP_WRITE_BATCH];
 	long status = 0;
 	ssize_t written = 0;
 
 	do {
-		struct page *page;
-		unsigned long offset;	/* Offset into pagecache page */
-		unsigned long bytes;	/* Bytes to write to page */
+		unsigned long offset;	/* Offset into first pagecache page */
+		unsigned long bytes;	/* Bytes to write in this batch */
 		size_t copied;		/* Bytes copied from user */
+		unsigned nr, n;
+		loff_t p;
+		bool short_copy;
 
 		offset = offset_in_page(pos);
-		bytes = min_t(unsigned long, PAGE_SIZE - offset,
+		bytes = min_t(unsigned long, max_pages * PAGE_SIZE - offset,
 						iov_iter_count(i));
 again:
 		if (bytes > length)
 			bytes = length;
 
 		/*
-		 * Bring in the user page that we will copy from _first_.
+		 * Bring in the user pages that we will copy from _first_.
 		 * Otherwise there's a nasty deadlock on copying from the
 		 * same page as we're writing to, without it being marked
 		 * up-to-date.
@@ -831,27 +872,63 @@ iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 			break;
 		}
 
-		status = iomap_write_begin(inode, pos, bytes, 0, &page, iomap,
-				srcmap);
-		if (unlikely(status))
+		/* Lock and prepare every page of the batch in index order */
+		for (nr = 0, p = pos; p < pos + bytes; nr++) {
+			unsigned plen = min_t(loff_t, PAGE_SIZE - offset_in_page(p),
+					pos + bytes - p);
+
+			status = iomap_write_begin(inode, p, plen, 0, &pages[nr],
+					iomap, srcmap);
+			if (unlikely(status))
+				break;
+			p += plen;
+		}
+		if (!nr)
 			break;
+		status = 0;
+		bytes = p - pos;
+
+		copied = 0;
+		short_copy = false;
+		for (n = 0, p = pos; n < nr; n++) {
+			struct page *page = pages[n];
+			unsigned poff = offset_in_page(p);
+			unsigned plen = min_t(loff_t, PAGE_SIZE - poff,
+					pos + bytes - p);
+			size_t done;
+			int ret;
+
+			if (short_copy) {
+				iomap_write_abort(inode, p, plen, page);
+				p += plen;
+				continue;
+			}
 
-		if (mapping_writably_mapped(inode->i_mapping))
-			flush_dcache_page(page);
+			if (mapping_writably_mapped(inode->i_mapping))
+				flush_dcache_page(page);
 
-		copied = iov_iter_copy_from_user_atomic(page, i, offset, bytes);
+			done = iov_iter_copy_from_user_atomic(page, i, poff,
+					plen);
 
-		flush_dcache_page(page);
+			flush_dcache_page(page);
 
-		status = iomap_write_end(inode, pos, bytes, copied, page, iomap,
-				srcmap);
+			ret = iomap_write_end(inode, p, plen, done, page, iomap,
+					srcmap);
+			if (unlikely(ret < 0)) {
+				status = ret;
+				short_copy = true;
+			} else {
+				iov_iter_advance(i, ret);
+				copied += ret;
+				short_copy = ret < plen;
+			}
+			p += plen;
+		}
 		if (unlikely(status < 0))
 			break;
-		copied = status;
 
 		cond_resched();
 
-		iov_iter_advance(i, copied);
 		if (unlikely(copied == 0)) {
 			/*
 			 * If we were unable to copy any data at all, we must
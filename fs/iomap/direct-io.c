@@ -17,6 +17,7 @@
  * Private flags for iomap_dio, must not overlap with the public ones in
  * iomap.h:
  */
+#define IOMAP_DIO_INLINE_COMP	(1 << 27)
 #define IOMAP_DIO_WRITE_FUA	(1 << 28)
 #define IOMAP_DIO_NEED_SYNC	(1 << 29)
 #define IOMAP_DIO_WRITE		(1 << 30)
@@ -143,6 +144,22 @@ static inline void iomap_dio_set_error(struct iomap_dio *dio, int ret)
 	cmpxchg(&dio->error, 0, ret);
 }
 
+/*
+ * IOCB_HIPRI is only a hint: a bio of a polled dio may still be completed
+ * from interrupt context, e.g. when the driver has no poll queues.  Only a
+ * completion reaped by blk_poll() in the submitter's task can run inline,
+ * and even then not if the page cache has to be invalidated, as that may
+ * sleep.
+ */
+static bool iomap_dio_complete_inline(struct iomap_dio *dio)
+{
+	struct inode *inode = file_inode(dio->iocb->ki_filp);
+
+	if (!(dio->flags & IOMAP_DIO_INLINE_COMP) || !in_task())
+		return false;
+	return !inode->i_mapping->nrpages;
+}
+
 static void iomap_dio_bio_end_io(struct bio *bio)
 {
 	struct iomap_dio *dio = bio->bi_private;
@@ -156,7 +173,8 @@ static void iomap_dio_bio_end_io(struct bio *bio)
 			struct task_struct *waiter = dio->submit.waiter;
 			WRITE_ONCE(dio->submit.waiter, NULL);
 			blk_wake_io_task(waiter);
-		} else if (dio->flags & IOMAP_DIO_WRITE) {
+		} else if ((dio->flags & IOMAP_DIO_WRITE) &&
+			   !iomap_dio_complete_inline(dio)) {
 			struct inode *inode = file_inode(dio->iocb->ki_filp);
 
 			INIT_WORK(&dio->aio.work, iomap_dio_complete_work);
@@ -219,6 +237,16 @@ iomap_dio_bio_actor(struct inode *inode, loff_t pos, loff_t length,
 	if (iomap->flags & IOMAP_F_SHARED)
 		dio->flags |= IOMAP_DIO_COW;
 
+	/*
+	 * Only pure overwrites can be completed inline: anything that needs
+	 * extent conversion, COW remapping, zeroing or a size update at
+	 * completion has to go through the workqueue.
+	 */
+	if (iomap->type != IOMAP_MAPPED ||
+	    (iomap->flags & (IOMAP_F_SHARED | IOMAP_F_NEW)) ||
+	    pos + length > dio->i_size)
+		dio->flags &= ~IOMAP_DIO_INLINE_COMP;
+
 	if (iomap->flags & IOMAP_F_NEW) {
 		need_zeroout = true;
 	} else if (iomap->type == IOMAP_MAPPED) {
@@ -458,6 +486,17 @@ iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 		 */
 		if ((iocb->ki_flags & (IOCB_DSYNC | IOCB_SYNC)) == IOCB_DSYNC)
 			dio->flags |= IOMAP_DIO_WRITE_FUA;
+
+		/*
+		 * Polled bios complete in the context of the task doing the
+		 * polling, so there is no need to bounce the completion of
+		 * overwrites to the dio workqueue.  The actor clears this for
+		 * any mapping that needs more work at completion time, and
+		 * iomap_dio_complete_inline() checks that the bio really was
+		 * polled.
+		 */
+		if (iocb->ki_flags & IOCB_HIPRI)
+			dio->flags |= IOMAP_DIO_INLINE_COMP;
 	}
 
 	if (iocb->ki_flags & IOCB_NOWAIT) {
@@ -478,11 +517,13 @@ iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	 * still work, but racing two incompatible write paths is a
 	 * pretty crazy thing to do, so we don't support it 100%.
 	 */
-	ret = invalidate_inode_pages2_range(mapping,
-			pos >> PAGE_SHIFT, end >> PAGE_SHIFT);
-	if (ret)
-		dio_warn_stale_pagecache(iocb->ki_filp);
-	ret = 0;
+	if (mapping->nrpages) {
+		ret = invalidate_inode_pages2_range(mapping,
+				pos >> PAGE_SHIFT, end >> PAGE_SHIFT);
+		if (ret)
+			dio_warn_stale_pagecache(iocb->ki_filp);
+		ret = 0;
+	}
 
 	if (iov_iter_rw(iter) == WRITE && !wait_for_completion &&
 	    !inode->i_sb->s_dio_done_wq) {
@@ -529,6 +570,10 @@ iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	if (dio->flags & IOMAP_DIO_WRITE_FUA)
 		dio->flags &= ~IOMAP_DIO_NEED_SYNC;
 
+	/* A cache flush at completion can't be issued inline either */
+	if (dio->flags & IOMAP_DIO_NEED_SYNC)
+		dio->flags &= ~IOMAP_DIO_INLINE_COMP;
+
 	WRITE_ONCE(iocb->ki_cookie, dio->submit.cookie);
 	WRITE_ONCE(iocb->private, dio->submit.last_queue);
 
@@ -20,6 +20,7 @@
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/blkdev.h>
+#include <linux/sort.h>
 #include <trace/events/jbd2.h>
 
 /*
@@ -174,12 +175,65 @@ void __jbd2_log_wait_for_space(journal_t *journal)
 	}
 }
 
+/*
+ * Queue background checkpointing.  Called under j_state_lock once free
+ * log space has dropped below the low watermark.
+ */
+void __jbd2_log_kick_checkpoint(journal_t *journal)
+{
+	if (journal->j_flags & (JBD2_UNMOUNT | JBD2_ABORT))
+		return;
+	queue_work(system_unbound_wq, &journal->j_checkpoint_work);
+}
+
+/*
+ * Checkpoint old transactions until the free log space is back above the
+ * high watermark, so that __jbd2_log_wait_for_space() is only reached
+ * when the background writeback can't keep up.
+ */
+void jbd2_log_checkpoint_work(struct work_struct *work)
+{
+	journal_t *journal = container_of(work, journal_t, j_checkpoint_work);
+	bool done;
+
+	mutex_lock_io(&journal->j_checkpoint_mutex);
+	do {
+		read_lock(&journal->j_state_lock);
+		spin_lock(&journal->j_list_lock);
+		done = (journal->j_flags & (JBD2_UNMOUNT | JBD2_ABORT)) ||
+		       !journal->j_checkpoint_transactions ||
+		       jbd2_log_space_left(journal) >=
+				jbd2_log_checkpoint_high_wmark(journal);
+		spin_unlock(&journal->j_list_lock);
+		read_unlock(&journal->j_state_lock);
+
+		if (!done && jbd2_log_do_checkpoint(journal) < 0)
+			done = true;
+		cond_resched();
+	} while (!done);
+	mutex_unlock(&journal->j_checkpoint_mutex);
+}
+
+static int bh_cmp_blocknr(const void *a, const void *b)
+{
+	const struct buffer_head *bha = *(const struct buffer_head **)a;
+	const struct buffer_head *bhb = *(const struct buffer_head **)b;
+
+	if (bha->b_blocknr < bhb->b_blocknr)
+		return -1;
+	return bha->b_blocknr > bhb->b_blocknr;
+}
+
 static void
 __flush_batch(journal_t *journal, int *batch_count)
 {
 	int i;
 	struct blk_plug plug;
 
+	/* Checkpoint order doesn't matter; submit in disk order */
+	sort(journal->j_chkpt_bhs, *batch_count, sizeof(struct buffer_head *),
+	     bh_cmp_blocknr, NULL);
+
 	blk_start_plug(&plug);
 	for (i = 0; i < *batch_count; i++)
 		write_dirty_buffer(journal->j_chkpt_bhs[i], REQ_SYNC);
@@ -762,6 +762,158 @@ int jbd2_complete_transaction(journal_t *journal, tid_t tid)
 }
 EXPORT_SYMBOL(jbd2_complete_transaction);
 
+/*
+ * Fast commits.  A filesystem that set the fast commit feature may log
+ * the changes of the running transaction as its own logical records in
+ * the fast commit area instead of forcing a full commit on fsync.  Only
+ * one fast commit runs at a time and fast commits and full commits
+ * exclude each other; the area is reused from its start after each full
+ * commit, so stale blocks on disk must be recognised by the filesystem
+ * through the tid it stamps into its records.
+ *
+ * Start a fast commit of transaction @tid.  Returns -EALREADY if @tid has
+ * already been fully committed, -EAGAIN if a full commit is needed anyway
+ * (nothing in the log yet tells recovery where to start) and -EOPNOTSUPP
+ * if the journal has no fast commit area.
+ */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid)
+{
+	DEFINE_WAIT(wait);
+
+	if (!journal->j_fc_wbuf)
+		return -EOPNOTSUPP;
+
+	write_lock(&journal->j_state_lock);
+	for (;;) {
+		if (tid_geq(journal->j_commit_sequence, tid)) {
+			write_unlock(&journal->j_state_lock);
+			return -EALREADY;
+		}
+		if (!(journal->j_flags & (JBD2_FAST_COMMIT_ONGOING |
+					  JBD2_FULL_COMMIT_ONGOING)))
+			break;
+		prepare_to_wait(&journal->j_fc_wait, &wait,
+				TASK_UNINTERRUPTIBLE);
+		write_unlock(&journal->j_state_lock);
+		schedule();
+		finish_wait(&journal->j_fc_wait, &wait);
+		write_lock(&journal->j_state_lock);
+	}
+	if (journal->j_flags & (JBD2_FLUSHED | JBD2_ABORT)) {
+		int err = is_journal_aborted(journal) ? -EIO : -EAGAIN;
+
+		write_unlock(&journal->j_state_lock);
+		return err;
+	}
+	journal->j_flags |= JBD2_FAST_COMMIT_ONGOING;
+	write_unlock(&journal->j_state_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_begin_commit);
+
+static void __jbd2_fc_end_commit(journal_t *journal)
+{
+	write_lock(&journal->j_state_lock);
+	journal->j_flags &= ~JBD2_FAST_COMMIT_ONGOING;
+	write_unlock(&journal->j_state_lock);
+	wake_up(&journal->j_fc_wait);
+}
+
+/*
+ * Finish a fast commit started by jbd2_fc_begin_commit().  The caller
+ * must have waited for its blocks with jbd2_fc_wait_bufs().
+ */
+int jbd2_fc_end_commit(journal_t *journal)
+{
+	__jbd2_fc_end_commit(journal);
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit);
+
+/*
+ * Abandon a fast commit (e.g. the area is full or the change can't be
+ * expressed as a logical record) and fall back to a full commit of @tid.
+ */
+int jbd2_fc_end_commit_fallback(journal_t *journal, tid_t tid)
+{
+	jbd2_fc_release_bufs(journal);
+	__jbd2_fc_end_commit(journal);
+	return jbd2_complete_transaction(journal, tid);
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit_fallback);
+
+/*
+ * Hand out the next block of the fast commit area.  The caller fills the
+ * buffer and submits it itself; jbd2_fc_wait_bufs() drops the reference.
+ */
+int jbd2_fc_get_buf(journal_t *journal, struct buffer_head **bh_out)
+{
+	unsigned long long pblock;
+	unsigned long blocknr;
+	struct buffer_head *bh;
+	int ret;
+
+	if (journal->j_fc_first + journal->j_fc_off >= journal->j_fc_last)
+		return -ENOSPC;
+
+	blocknr = journal->j_fc_first + journal->j_fc_off;
+	ret = jbd2_journal_bmap(journal, blocknr, &pblock);
+	if (ret)
+		return ret;
+
+	bh = __getblk(journal->j_dev, pblock, journal->j_blocksize);
+	if (!bh)
+		return -ENOMEM;
+
+	journal->j_fc_wbuf[journal->j_fc_off++] = bh;
+	*bh_out = bh;
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_get_buf);
+
+/*
+ * Wait for the last @num_blks fast commit blocks handed out to hit the
+ * disk and release them.
+ */
+int jbd2_fc_wait_bufs(journal_t *journal, int num_blks)
+{
+	struct buffer_head *bh;
+	int off = journal->j_fc_off;
+	int i, err = 0;
+
+	if (WARN_ON_ONCE(num_blks > off))
+		return -EINVAL;
+
+	for (i = off - 1; i >= off - num_blks; i--) {
+		bh = journal->j_fc_wbuf[i];
+		if (!bh)
+			continue;
+		wait_on_buffer(bh);
+		if (unlikely(!buffer_uptodate(bh)))
+			err = -EIO;
+		put_bh(bh);
+		journal->j_fc_wbuf[i] = NULL;
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(jbd2_fc_wait_bufs);
+
+/* Drop any fast commit blocks the ongoing fast commit still holds. */
+void jbd2_fc_release_bufs(journal_t *journal)
+{
+	int i;
+
+	for (i = 0; i < journal->j_fc_off; i++) {
+		if (journal->j_fc_wbuf[i]) {
+			put_bh(journal->j_fc_wbuf[i]);
+			journal->j_fc_wbuf[i] = NULL;
+		}
+	}
+}
+EXPORT_SYMBOL(jbd2_fc_release_bufs);
+
 /*
  * Log buffer allocation routines:
  */
@@ -974,6 +1126,7 @@ void jbd2_update_log_tail(journal_t *journal, tid_t tid, unsigned long block)
 struct jbd2_stats_proc_session {
 	journal_t *journal;
 	struct transaction_stats_s *stats;
+	struct jbd2_latency_hist hist;
 	int start;
 	int max;
 };
@@ -989,6 +1142,19 @@ static void *jbd2_seq_info_next(struct seq_file *seq, void *v, loff_t *pos)
 	return NULL;
 }
 
+static void jbd2_seq_hist_show(struct seq_file *seq,
+			       const unsigned long *hist)
+{
+	int i;
+
+	for (i = 0; i < JBD2_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		seq_printf(seq, "  >= %lu: %lu\n",
+			   i ? 1UL << (i - 1) : 0, hist[i]);
+	}
+}
+
 static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 {
 	struct jbd2_stats_proc_session *s = seq->private;
@@ -1023,6 +1189,10 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	seq_puts(seq, "handles locked out (us):\n");
+	jbd2_seq_hist_show(seq, s->hist.lh_locked);
+	seq_puts(seq, "transaction commit time (us):\n");
+	jbd2_seq_hist_show(seq, s->hist.lh_commit);
 	return 0;
 }
 
@@ -1054,6 +1224,7 @@ static int jbd2_seq_info_open(struct inode *inode, struct file *file)
 	}
 	spin_lock(&journal->j_history_lock);
 	memcpy(s->stats, &journal->j_stats, size);
+	s->hist = journal->j_hist;
 	s->journal = journal;
 	spin_unlock(&journal->j_history_lock);
 
@@ -1140,8 +1311,10 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	init_waitqueue_head(&journal->j_wait_commit);
 	init_waitqueue_head(&journal->j_wait_updates);
 	init_waitqueue_head(&journal->j_wait_reserved);
+	init_waitqueue_head(&journal->j_fc_wait);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
+	INIT_WORK(&journal->j_checkpoint_work, jbd2_log_checkpoint_work);
 	spin_lock_init(&journal->j_revoke_lock);
 	spin_lock_init(&journal->j_list_lock);
 	rwlock_init(&journal->j_state_lock);
@@ -1312,6 +1485,9 @@ static int journal_reset(journal_t *journal)
 		return -EINVAL;
 	}
 
+	if (jbd2_has_feature_fast_commit(journal))
+		last = journal->j_fc_first;
+
 	journal->j_first = first;
 	journal->j_last = last;
 
@@ -1640,6 +1816,40 @@ static int journal_get_superblock(journal_t *journal)
 	return err;
 }
 
+/*
+ * Carve the fast commit area out of the end of the log and allocate its
+ * buffer array.  Called with the log empty, before any transaction could
+ * have been written into the reserved blocks.
+ */
+static int jbd2_journal_init_fast_commit(journal_t *journal)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	unsigned long num_fc_blks = jbd2_journal_get_num_fc_blks(sb);
+	unsigned long maxlen = be32_to_cpu(sb->s_maxlen);
+
+	if (be32_to_cpu(sb->s_first) + JBD2_MIN_JOURNAL_BLOCKS + num_fc_blks >
+	    maxlen + 1) {
+		printk(KERN_ERR "JBD2: Journal too short for %lu fast commit "
+		       "blocks.\n", num_fc_blks);
+		return -EINVAL;
+	}
+
+	if (!journal->j_fc_wbuf) {
+		journal->j_fc_wbuf = kcalloc(num_fc_blks,
+					     sizeof(struct buffer_head *),
+					     GFP_KERNEL);
+		if (!journal->j_fc_wbuf)
+			return -ENOMEM;
+		journal->j_fc_wbufsize = num_fc_blks;
+	}
+
+	journal->j_fc_last = maxlen;
+	journal->j_fc_first = maxlen - num_fc_blks;
+	journal->j_fc_off = 0;
+	journal->j_last = journal->j_fc_first;
+	return 0;
+}
+
 /*
  * Load the on-disk journal superblock and read the key fields into the
  * journal_t.
@@ -1662,6 +1872,9 @@ static int load_superblock(journal_t *journal)
 	journal->j_last = be32_to_cpu(sb->s_maxlen);
 	journal->j_errno = be32_to_cpu(sb->s_errno);
 
+	if (jbd2_has_feature_fast_commit(journal))
+		return jbd2_journal_init_fast_commit(journal);
+
 	return 0;
 }
 
@@ -1748,6 +1961,12 @@ int jbd2_journal_destroy(journal_t *journal)
 {
 	int err = 0;
 
+	/*
+	 * Background checkpointing may wait for commits, so stop it while
+	 * the commit thread is still around.
+	 */
+	cancel_work_sync(&journal->j_checkpoint_work);
+
 	/* Wait for the commit thread to wake up and die. */
 	journal_kill_thread(journal);
 
@@ -1806,6 +2025,7 @@ int jbd2_journal_destroy(journal_t *journal)
 	if (journal->j_chksum_driver)
 		crypto_free_shash(journal->j_chksum_driver);
 	kfree(journal->j_wbuf);
+	kfree(journal->j_fc_wbuf);
 	kfree(journal);
 
 	return err;
@@ -1936,6 +2156,22 @@ int jbd2_journal_set_features (journal_t *journal, unsigned long compat,
 						   sizeof(sb->s_uuid));
 	}
 
+	/*
+	 * The fast commit area is taken from the end of the log, so it can
+	 * only be set up while the log is empty, i.e. right after
+	 * jbd2_journal_load() and before any handle has been started.
+	 */
+	if (INCOMPAT_FEATURE_ON(JBD2_FEATURE_INCOMPAT_FAST_COMMIT)) {
+		if ((journal->j_flags & JBD2_LOADED) &&
+		    (journal->j_head != journal->j_first ||
+		     journal->j_tail != journal->j_first))
+			return 0;
+		if (jbd2_journal_init_fast_commit(journal))
+			return 0;
+		if (journal->j_flags & JBD2_LOADED)
+			journal->j_free = journal->j_last - journal->j_first;
+	}
+
 	lock_buffer(journal->j_sb_buffer);
 
 	/* If enabling v3 checksums, update superblock */
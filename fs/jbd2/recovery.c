@@ -35,7 +35,6 @@ struct recovery_info
 	int		nr_revoke_hits;
 };
 
-enum passtype {PASS_SCAN, PASS_REVOKE, PASS_REPLAY};
 static int do_one_pass(journal_t *journal,
 				struct recovery_info *info, enum passtype pass);
 static int scan_revoke_records(journal_t *, struct buffer_head *,
@@ -413,6 +412,48 @@ static int jbd2_block_tag_csum_verify(journal_t *j, journal_block_tag_t *tag,
 		return tag->t_checksum == cpu_to_be16(csum32);
 }
 
+/*
+ * Feed the fast commit area to the filesystem, block by block, until it
+ * tells us to stop.  Runs after the regular log has been scanned or
+ * replayed, so info->end_transaction is the tid whose records are live.
+ * Without a replay callback the records of the area cannot be applied,
+ * so recovery has to fail rather than silently lose them.
+ */
+static int fc_do_one_pass(journal_t *journal,
+			  struct recovery_info *info, enum passtype pass)
+{
+	unsigned int expected_commit_id = info->end_transaction;
+	unsigned long next_fc_block;
+	struct buffer_head *bh;
+	int err = 0;
+
+	if (!journal->j_fc_replay_callback) {
+		printk(KERN_ERR "JBD2: no fast commit replay support on %s\n",
+		       journal->j_devname);
+		return -EOPNOTSUPP;
+	}
+
+	for (next_fc_block = journal->j_fc_first;
+	     next_fc_block < journal->j_fc_last; next_fc_block++) {
+		err = jread(&bh, journal, next_fc_block);
+		if (err)
+			break;
+
+		err = journal->j_fc_replay_callback(journal, bh, pass,
+					next_fc_block - journal->j_fc_first,
+					expected_commit_id);
+		brelse(bh);
+		if (err != JBD2_FC_REPLAY_CONTINUE)
+			break;
+		err = 0;
+	}
+
+	if (err < 0)
+		jbd_debug(3, "Fast commit replay failed at block %lu: %d\n",
+			  next_fc_block, err);
+	return err < 0 ? err : 0;
+}
+
 static int do_one_pass(journal_t *journal,
 			struct recovery_info *info, enum passtype pass)
 {
@@ -801,6 +842,10 @@ static int do_one_pass(journal_t *journal,
 	}
 	if (block_error && success == 0)
 		success = -EIO;
+
+	if (jbd2_has_feature_fast_commit(journal) && pass != PASS_REVOKE &&
+	    success == 0)
+		success = fc_do_one_pass(journal, info, pass);
 	return success;
 
  failed:
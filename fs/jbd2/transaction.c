@@ -280,8 +280,10 @@ static int add_transaction_credits(journal_t *journal, int blocks,
 	 *
 	 * We must therefore ensure the necessary space in the journal
 	 * *before* starting to dirty potentially checkpointed buffers
-	 * in the new transaction.
+	 * in the new transaction.  Checkpointing starts in the background
+	 * well before that point, so stalling here should be rare.
 	 */
+	jbd2_log_kick_checkpoint(journal);
 	if (jbd2_log_space_left(journal) < journal->j_max_transaction_buffers) {
 		atomic_sub(total, &t->t_outstanding_credits);
 		read_unlock(&journal->j_state_lock);
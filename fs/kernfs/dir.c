@@ -1703,4 +1703,6 @@ const struct file_operations kernfs_dir_fops = {
 	.iterate_shared	= kernfs_fop_readdir,
 	.release	= kernfs_dir_fop_release,
 	.llseek		= generic_file_llseek,
+	.unlocked_ioctl	= kernfs_dir_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
 };
@@ -14,6 +14,8 @@
 #include <linux/pagemap.h>
 #include <linux/sched/mm.h>
 #include <linux/fsnotify.h>
+#include <linux/uaccess.h>
+#include <uapi/linux/kernfs.h>
 
 #include "kernfs-internal.h"
 
@@ -969,6 +971,248 @@ const struct file_operations kernfs_file_fops = {
 	.fsync		= noop_fsync,
 };
 
+/*
+ * KERNFS_IOC_READ_ATTRS support.  Each attribute is read as open() +
+ * read() + close() of it would, calling the same ops on a kernfs_open_file
+ * which only lives for the duration of the read, but without going through
+ * the VFS and without a round trip to userland per attribute.
+ */
+#define KERNFS_READ_ATTRS_MAX_NAMES	(64 << 10)
+
+/* run the seq_file iteration of @of into its seq_file buffer */
+static int kernfs_seq_fill(struct kernfs_open_file *of,
+			   const struct kernfs_ops *ops)
+{
+	struct seq_file *sf = of->seq_file;
+	loff_t pos = 0;
+	size_t count;
+	void *v;
+	int ret = 0;
+
+	if (ops->seq_start)
+		v = ops->seq_start(sf, &pos);
+	else
+		v = NULL + 1;	/* single_open() behavior, see kernfs_seq_start() */
+
+	while (v && !IS_ERR(v)) {
+		count = sf->count;
+		ret = ops->seq_show(sf, v);
+		if (ret < 0)
+			break;
+		if (ret) {
+			/* SEQ_SKIP */
+			sf->count = count;
+			ret = 0;
+		}
+		if (seq_has_overflowed(sf)) {
+			ret = -EOVERFLOW;
+			break;
+		}
+		v = ops->seq_next ? ops->seq_next(sf, v, &pos) : NULL;
+	}
+	if (IS_ERR(v))
+		ret = PTR_ERR(v);
+	if (ops->seq_stop)
+		ops->seq_stop(sf, v);
+	return ret;
+}
+
+/* double the size of *@bufp, up to @limit, discarding its contents */
+static int kernfs_grow_buf(char **bufp, size_t *sizep, size_t limit)
+{
+	size_t len = min_t(size_t, *sizep * 2, PAGE_ALIGN(limit));
+	char *buf;
+
+	if (*sizep >= limit)
+		return -ENOSPC;
+	buf = kvmalloc(len, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	kvfree(*bufp);
+	*bufp = buf;
+	*sizep = len;
+	return 0;
+}
+
+/*
+ * Read the contents of @kn into *@bufp, growing it as needed but to no more
+ * than @limit bytes.  Returns the length read, -ENOSPC if the contents are
+ * larger than @limit or another -errno.
+ */
+static ssize_t kernfs_read_one_attr(struct file *dir_file,
+				    struct kernfs_node *kn, char **bufp,
+				    size_t *sizep, size_t limit)
+{
+	struct kernfs_open_file of = { };
+	struct seq_file sf = { };
+	const struct kernfs_ops *ops;
+	struct inode *inode;
+	ssize_t ret;
+
+	if (kernfs_type(kn) == KERNFS_DIR)
+		return -EISDIR;
+	if (kernfs_type(kn) != KERNFS_FILE)
+		return -EINVAL;
+
+	inode = kernfs_get_inode(file_inode(dir_file)->i_sb, kn);
+	if (!inode)
+		return -ENOMEM;
+	ret = inode_permission(inode, MAY_READ);
+	iput(inode);
+	if (ret)
+		return ret;
+
+	mutex_init(&of.mutex);
+	of.kn = kn;
+	of.file = dir_file;
+	of.seq_file = &sf;
+	sf.private = &of;
+	sf.file = dir_file;
+
+	mutex_lock(&of.mutex);
+	if (!kernfs_get_active(kn)) {
+		ret = -ENODEV;
+		goto out_unlock;
+	}
+
+	/*
+	 * Only seq_file based attributes.  Files with a raw ->read, such as
+	 * sysfs bin attributes, take their size from the inode of the file
+	 * they are read through and may have side effects, so they have to
+	 * be read with open() + read().
+	 */
+	ops = kernfs_ops(kn);
+	ret = -EOPNOTSUPP;
+	if (!ops->seq_show)
+		goto out_put;
+
+	if (ops->open) {
+		ret = ops->open(&of);
+		if (ret)
+			goto out_put;
+	}
+
+retry:
+	sf.buf = *bufp;
+	sf.size = *sizep;
+	sf.count = 0;
+	ret = kernfs_seq_fill(&of, ops);
+	if (ret == -EOVERFLOW) {
+		/* same as seq_read(), retry with a larger buffer */
+		ret = kernfs_grow_buf(bufp, sizep, limit);
+		if (!ret)
+			goto retry;
+	}
+	if (!ret)
+		ret = sf.count;
+
+	if (ret > (ssize_t)limit)
+		ret = -ENOSPC;
+
+	if (ops->release)
+		ops->release(&of);
+out_put:
+	kernfs_put_active(kn);
+out_unlock:
+	mutex_unlock(&of.mutex);
+	mutex_destroy(&of.mutex);
+	return ret;
+}
+
+static long kernfs_read_attrs(struct file *file,
+			      struct kernfs_read_attrs __user *uarg)
+{
+	struct inode *dir = file_inode(file);
+	struct kernfs_node *parent = dir->i_private;
+	struct kernfs_attr_record rec;
+	struct kernfs_read_attrs req;
+	const void *ns = NULL;
+	char __user *ubuf;
+	char *names, *name, *buf;
+	size_t size = PAGE_SIZE, off = 0, hdr, space;
+	ssize_t data;
+	u32 nr = 0;
+	long ret;
+
+	if (copy_from_user(&req, uarg, sizeof(req)))
+		return -EFAULT;
+	if (!req.names_len || req.names_len > KERNFS_READ_ATTRS_MAX_NAMES)
+		return -EINVAL;
+
+	ret = inode_permission(dir, MAY_EXEC);
+	if (ret)
+		return ret;
+
+	names = memdup_user(u64_to_user_ptr(req.names), req.names_len);
+	if (IS_ERR(names))
+		return PTR_ERR(names);
+	ret = -EINVAL;
+	if (names[req.names_len - 1] != '\0')
+		goto out_free_names;
+
+	ret = -ENOMEM;
+	buf = kvmalloc(size, GFP_KERNEL);
+	if (!buf)
+		goto out_free_names;
+
+	if (kernfs_ns_enabled(parent))
+		ns = kernfs_info(dir->i_sb)->ns;
+
+	ubuf = u64_to_user_ptr(req.buf);
+	ret = 0;
+	for (name = names; name < names + req.names_len;
+	     name += rec.name_len + 1, nr++) {
+		struct kernfs_node *kn;
+
+		rec.name_len = strlen(name);
+		hdr = sizeof(rec) + rec.name_len;
+		space = round_down(req.buf_len - off, 8);
+		if (hdr > space)
+			break;
+
+		kn = kernfs_find_and_get_ns(parent, name, ns);
+		if (kn) {
+			data = kernfs_read_one_attr(file, kn, &buf, &size,
+						    space - hdr);
+			kernfs_put(kn);
+		} else {
+			data = -ENOENT;
+		}
+		if (data == -ENOSPC)
+			break;
+
+		rec.error = min_t(ssize_t, data, 0);
+		rec.data_len = max_t(ssize_t, data, 0);
+		rec.rec_len = ALIGN(hdr + rec.data_len, 8);
+		if (copy_to_user(ubuf + off, &rec, sizeof(rec)) ||
+		    copy_to_user(ubuf + off + sizeof(rec), name, rec.name_len) ||
+		    copy_to_user(ubuf + off + hdr, buf, rec.data_len)) {
+			ret = -EFAULT;
+			break;
+		}
+		off += rec.rec_len;
+		cond_resched();
+	}
+
+	if (!ret && put_user(nr, &uarg->nr_read))
+		ret = -EFAULT;
+
+	kvfree(buf);
+out_free_names:
+	kfree(names);
+	return ret;
+}
+
+long kernfs_dir_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	switch (cmd) {
+	case KERNFS_IOC_READ_ATTRS:
+		return kernfs_read_attrs(file, (void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
 /**
  * __kernfs_create_file - kernfs internal function to create a file
  * @parent: directory to create the file in
@@ -116,6 +116,7 @@ struct kernfs_node *kernfs_new_node(struct kernfs_node *parent,
 extern const struct file_operations kernfs_file_fops;
 
 void kernfs_drain_open_files(struct kernfs_node *kn);
+long kernfs_dir_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 
 /*
  * symlink.c
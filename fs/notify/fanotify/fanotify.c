@@ -53,7 +53,9 @@ static bool should_merge(struct fsnotify_event *old_fsn,
 /* and the list better be locked by something too! */
 static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 {
-	struct fsnotify_event *test_event;
+	struct fsnotify_group *group = container_of(list, struct fsnotify_group,
+						    notification_list);
+	struct fanotify_event *test_event;
 	struct fanotify_event *new;
 
 	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
@@ -67,9 +69,11 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	if (fanotify_is_perm_event(new->mask))
 		return 0;
 
-	list_for_each_entry_reverse(test_event, list, list) {
-		if (should_merge(test_event, event)) {
-			FANOTIFY_E(test_event)->mask |= new->mask;
+	/* Buckets are kept newest first, like the old reverse list walk */
+	hlist_for_each_entry(test_event, fanotify_merge_bucket(group, new),
+			     merge_list) {
+		if (should_merge(&test_event->fse, event)) {
+			test_event->mask |= new->mask;
 			return 1;
 		}
 	}
@@ -77,6 +81,73 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	return 0;
 }
 
+/*
+ * Check whether an event that is queued and not yet read already reports
+ * everything the new event would. Such an event would only be merged into
+ * the queued one without changing it, so it can be dropped before paying for
+ * its allocation and path reference. This is what keeps marks on busy
+ * filesystems cheap: a stream of writes to a file produces one queued
+ * FAN_MODIFY event until the listener reads it.
+ *
+ * Only events carrying a path are checked, comparing fids would require
+ * encoding a file handle first.
+ */
+static bool fanotify_event_queued(struct fsnotify_group *group,
+				  struct inode *inode, u32 mask,
+				  const void *data, int data_type)
+{
+	const struct path *path = data;
+	struct fanotify_event *event;
+	struct hlist_head *bucket;
+	struct pid *pid;
+	bool found = false;
+
+	if (data_type != FSNOTIFY_EVENT_PATH ||
+	    FAN_GROUP_FLAG(group, FAN_REPORT_FID) ||
+	    fanotify_is_perm_event(mask))
+		return false;
+
+	if (FAN_GROUP_FLAG(group, FAN_REPORT_TID))
+		pid = task_pid(current);
+	else
+		pid = task_tgid(current);
+
+	bucket = fanotify_merge_hash(group, inode, pid);
+	/* Unlocked peek, missing a racing insert only costs the slow path */
+	if (hlist_empty(bucket))
+		return false;
+
+	spin_lock(&group->notification_lock);
+	hlist_for_each_entry(event, bucket, merge_list) {
+		if (event->fse.inode == inode && event->pid == pid &&
+		    fanotify_event_has_path(event) &&
+		    event->path.mnt == path->mnt &&
+		    event->path.dentry == path->dentry &&
+		    (event->mask & mask) == mask) {
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&group->notification_lock);
+
+	return found;
+}
+
+/* Index a newly queued event so that later events can be merged with it */
+static void fanotify_insert(struct fsnotify_group *group,
+			    struct fsnotify_event *fsn_event)
+{
+	struct fanotify_event *event = FANOTIFY_E(fsn_event);
+
+	assert_spin_locked(&group->notification_lock);
+
+	/* Permission events are never merged, see fanotify_merge() */
+	if (fanotify_is_perm_event(event->mask))
+		return;
+
+	hlist_add_head(&event->merge_list, fanotify_merge_bucket(group, event));
+}
+
 /*
  * Wait for response to permission event. The function also takes care of
  * freeing the permission event (or offloads that in case the wait is canceled
@@ -315,6 +386,7 @@ struct fanotify_event *fanotify_alloc_event(struct fsnotify_group *group,
 		goto out;
 init: __maybe_unused
 	fsnotify_init_event(&event->fse, inode);
+	INIT_HLIST_NODE(&event->merge_list);
 	event->mask = mask;
 	if (FAN_GROUP_FLAG(group, FAN_REPORT_TID))
 		event->pid = get_pid(task_pid(current));
@@ -421,6 +493,9 @@ static int fanotify_handle_event(struct fsnotify_group *group,
 			return 0;
 	}
 
+	if (fanotify_event_queued(group, inode, mask, data, data_type))
+		return 0;
+
 	if (FAN_GROUP_FLAG(group, FAN_REPORT_FID)) {
 		fsid = fanotify_get_fsid(iter_info);
 		/* Racing with mark destruction or creation? */
@@ -442,7 +517,8 @@ static int fanotify_handle_event(struct fsnotify_group *group,
 	}
 
 	fsn_event = &event->fse;
-	ret = fsnotify_add_event(group, fsn_event, fanotify_merge);
+	ret = fsnotify_insert_event(group, fsn_event, fanotify_merge,
+				    fanotify_insert);
 	if (ret) {
 		/* Permission events shouldn't be merged */
 		BUG_ON(ret == 1 && mask & FANOTIFY_PERM_EVENTS);
@@ -465,6 +541,7 @@ static void fanotify_free_group_priv(struct fsnotify_group *group)
 {
 	struct user_struct *user;
 
+	kfree(group->fanotify_data.merge_hash);
 	user = group->fanotify_data.user;
 	atomic_dec(&user->fanotify_listeners);
 	free_uid(user);
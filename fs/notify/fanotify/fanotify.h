@@ -3,6 +3,7 @@
 #include <linux/path.h>
 #include <linux/slab.h>
 #include <linux/exportfs.h>
+#include <linux/hash.h>
 
 extern struct kmem_cache *fanotify_mark_cache;
 extern struct kmem_cache *fanotify_event_cachep;
@@ -70,6 +71,8 @@ struct fanotify_event {
 	u8 fh_type;
 	u8 fh_len;
 	u16 pad;
+	/* entry in group->fanotify_data.merge_hash while queued */
+	struct hlist_node merge_list;
 	union {
 		/*
 		 * We hold ref to this path so it may be dereferenced at any
@@ -139,6 +142,37 @@ static inline struct fanotify_event *FANOTIFY_E(struct fsnotify_event *fse)
 	return container_of(fse, struct fanotify_event, fse);
 }
 
+/*
+ * Queued events are hashed by object and pid, which should_merge() requires
+ * to be equal, so a new event is only compared with plausible candidates
+ * instead of walking the whole notification queue.
+ */
+#define FANOTIFY_MERGE_HASH_BITS	7
+#define FANOTIFY_MERGE_HASH_SIZE	(1 << FANOTIFY_MERGE_HASH_BITS)
+
+static inline struct hlist_head *
+fanotify_merge_hash(struct fsnotify_group *group, struct inode *inode,
+		    struct pid *pid)
+{
+	unsigned long key = (unsigned long)inode ^ (unsigned long)pid;
+
+	return &group->fanotify_data.merge_hash[hash_long(key,
+						FANOTIFY_MERGE_HASH_BITS)];
+}
+
+static inline struct hlist_head *
+fanotify_merge_bucket(struct fsnotify_group *group,
+		      struct fanotify_event *event)
+{
+	return fanotify_merge_hash(group, event->fse.inode, event->pid);
+}
+
+/* Called with group->notification_lock held when an event is dequeued */
+static inline void fanotify_unhash_event(struct fanotify_event *event)
+{
+	hlist_del_init(&event->merge_list);
+}
+
 struct fanotify_event *fanotify_alloc_event(struct fsnotify_group *group,
 					    struct inode *inode, u32 mask,
 					    const void *data, int data_type,
@@ -29,6 +29,8 @@
 #define FANOTIFY_DEFAULT_MAX_EVENTS	16384
 #define FANOTIFY_DEFAULT_MAX_MARKS	8192
 #define FANOTIFY_DEFAULT_MAX_LISTENERS	128
+/* Max events dequeued by read() under one hold of the notification lock */
+#define FANOTIFY_READ_BATCH		32
 
 /*
  * All flags that may be specified in parameter event_f_flags of fanotify_init.
@@ -62,38 +64,58 @@ static int fanotify_event_info_len(struct fanotify_event *event)
 }
 
 /*
- * Get an fsnotify notification event if one exists and is small
- * enough to fit in "count". Return an error pointer if the count
- * is not large enough. When permission event is dequeued, its state is
- * updated accordingly.
+ * Dequeue the first event and drop it from the merge hash. Called with
+ * group->notification_lock held.
  */
-static struct fsnotify_event *get_one_event(struct fsnotify_group *group,
-					    size_t count)
+static struct fsnotify_event *fanotify_remove_first_event(
+						struct fsnotify_group *group)
 {
-	size_t event_size = FAN_EVENT_METADATA_LEN;
-	struct fsnotify_event *fsn_event = NULL;
+	struct fsnotify_event *fsn_event;
+
+	fsn_event = fsnotify_remove_first_event(group);
+	fanotify_unhash_event(FANOTIFY_E(fsn_event));
+	return fsn_event;
+}
+
+/*
+ * Move as many fsnotify notification events as fit in "count", up to
+ * FANOTIFY_READ_BATCH, onto @batch while taking the notification lock only
+ * once. Return the number of events dequeued, or -EINVAL if the count is not
+ * large enough for the first one. When permission event is dequeued, its
+ * state is updated accordingly.
+ */
+static int get_events(struct fsnotify_group *group, size_t count,
+		      struct list_head *batch)
+{
+	struct fsnotify_event *fsn_event;
+	size_t event_size;
+	int nr = 0;
 
 	pr_debug("%s: group=%p count=%zd\n", __func__, group, count);
 
 	spin_lock(&group->notification_lock);
-	if (fsnotify_notify_queue_is_empty(group))
-		goto out;
-
-	if (FAN_GROUP_FLAG(group, FAN_REPORT_FID)) {
-		event_size += fanotify_event_info_len(
-			FANOTIFY_E(fsnotify_peek_first_event(group)));
-	}
+	while (nr < FANOTIFY_READ_BATCH &&
+	       !fsnotify_notify_queue_is_empty(group)) {
+		event_size = FAN_EVENT_METADATA_LEN;
+		if (FAN_GROUP_FLAG(group, FAN_REPORT_FID)) {
+			event_size += fanotify_event_info_len(
+				FANOTIFY_E(fsnotify_peek_first_event(group)));
+		}
 
-	if (event_size > count) {
-		fsn_event = ERR_PTR(-EINVAL);
-		goto out;
+		if (event_size > count) {
+			if (!nr)
+				nr = -EINVAL;
+			break;
+		}
+		fsn_event = fanotify_remove_first_event(group);
+		if (fanotify_is_perm_event(FANOTIFY_E(fsn_event)->mask))
+			FANOTIFY_PE(fsn_event)->state = FAN_EVENT_REPORTED;
+		list_add_tail(&fsn_event->list, batch);
+		count -= event_size;
+		nr++;
 	}
-	fsn_event = fsnotify_remove_first_event(group);
-	if (fanotify_is_perm_event(FANOTIFY_E(fsn_event)->mask))
-		FANOTIFY_PE(fsn_event)->state = FAN_EVENT_REPORTED;
-out:
 	spin_unlock(&group->notification_lock);
-	return fsn_event;
+	return nr;
 }
 
 static int create_fd(struct fsnotify_group *group,
@@ -160,6 +182,38 @@ static void finish_permission_event(struct fsnotify_group *group,
 		fsnotify_destroy_event(group, &event->fae.fse);
 }
 
+/*
+ * Return events that read() dequeued but did not get to copy back to the
+ * head of the notification queue, in their original order.
+ */
+static void put_back_events(struct fsnotify_group *group,
+			    struct list_head *batch)
+{
+	struct fsnotify_event *fsn_event, *next;
+	struct fanotify_event *event;
+
+	spin_lock(&group->notification_lock);
+	list_for_each_entry_safe_reverse(fsn_event, next, batch, list) {
+		list_del_init(&fsn_event->list);
+		event = FANOTIFY_E(fsn_event);
+		if (fanotify_is_perm_event(event->mask)) {
+			/* The waiter gave up, nobody will answer this one */
+			if (FANOTIFY_PE(fsn_event)->state == FAN_EVENT_CANCELED) {
+				finish_permission_event(group,
+					FANOTIFY_PE(fsn_event), FAN_DENY);
+				spin_lock(&group->notification_lock);
+				continue;
+			}
+			FANOTIFY_PE(fsn_event)->state = FAN_EVENT_INIT;
+		} else if (fsn_event != group->overflow_event) {
+			hlist_add_head(&event->merge_list,
+				       fanotify_merge_bucket(group, event));
+		}
+		fsnotify_requeue_first_event(group, fsn_event);
+	}
+	spin_unlock(&group->notification_lock);
+}
+
 static int process_access_response(struct fsnotify_group *group,
 				   struct fanotify_response *response_struct)
 {
@@ -336,6 +390,7 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 {
 	struct fsnotify_group *group;
 	struct fsnotify_event *kevent;
+	LIST_HEAD(batch);
 	char __user *start;
 	int ret;
 	DEFINE_WAIT_FUNC(wait, woken_wake_function);
@@ -347,13 +402,13 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 
 	add_wait_queue(&group->notification_waitq, &wait);
 	while (1) {
-		kevent = get_one_event(group, count);
-		if (IS_ERR(kevent)) {
-			ret = PTR_ERR(kevent);
-			break;
+		if (list_empty(&batch)) {
+			ret = get_events(group, count, &batch);
+			if (ret < 0)
+				break;
 		}
 
-		if (!kevent) {
+		if (list_empty(&batch)) {
 			ret = -EAGAIN;
 			if (file->f_flags & O_NONBLOCK)
 				break;
@@ -369,6 +424,9 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 			continue;
 		}
 
+		/* Only this reader sees @batch, no need for the lock here */
+		kevent = list_first_entry(&batch, struct fsnotify_event, list);
+		list_del_init(&kevent->list);
 		ret = copy_event_to_user(group, kevent, buf, count);
 		if (unlikely(ret == -EOPENSTALE)) {
 			/*
@@ -406,6 +464,10 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 	}
 	remove_wait_queue(&group->notification_waitq, &wait);
 
+	/* Don't lose the rest of the batch if copying an event failed */
+	if (!list_empty(&batch))
+		put_back_events(group, &batch);
+
 	if (start != buf && ret != -EFAULT)
 		ret = buf - start;
 	return ret;
@@ -469,7 +531,7 @@ static int fanotify_release(struct inode *ignored, struct file *file)
 	 * response is consumed and fanotify_get_response() returns.
 	 */
 	while (!fsnotify_notify_queue_is_empty(group)) {
-		fsn_event = fsnotify_remove_first_event(group);
+		fsn_event = fanotify_remove_first_event(group);
 		if (!(FANOTIFY_E(fsn_event)->mask & FANOTIFY_PERM_EVENTS)) {
 			spin_unlock(&group->notification_lock);
 			fsnotify_destroy_event(group, fsn_event);
@@ -823,6 +885,13 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 	atomic_inc(&user->fanotify_listeners);
 	group->memcg = get_mem_cgroup_from_mm(current->mm);
 
+	group->fanotify_data.merge_hash = kcalloc(FANOTIFY_MERGE_HASH_SIZE,
+					sizeof(struct hlist_head), GFP_KERNEL);
+	if (!group->fanotify_data.merge_hash) {
+		fd = -ENOMEM;
+		goto out_destroy_group;
+	}
+
 	oevent = fanotify_alloc_event(group, NULL, FS_Q_OVERFLOW, NULL,
 				      FSNOTIFY_EVENT_NONE, NULL);
 	if (unlikely(!oevent)) {
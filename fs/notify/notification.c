@@ -80,11 +80,17 @@ void fsnotify_destroy_event(struct fsnotify_group *group,
  * added to the queue, 1 if the event was merged with some other queued event,
  * 2 if the event was not queued - either the queue of events has overflown
  * or the group is shutting down.
+ *
+ * If @insert is given, it is called under the notification lock for every
+ * event that was added to the queue (but not for the overflow event), so the
+ * backend can index the event for later merges.
  */
-int fsnotify_add_event(struct fsnotify_group *group,
-		       struct fsnotify_event *event,
-		       int (*merge)(struct list_head *,
-				    struct fsnotify_event *))
+int fsnotify_insert_event(struct fsnotify_group *group,
+			  struct fsnotify_event *event,
+			  int (*merge)(struct list_head *,
+				       struct fsnotify_event *),
+			  void (*insert)(struct fsnotify_group *,
+					 struct fsnotify_event *))
 {
 	int ret = 0;
 	struct list_head *list = &group->notification_list;
@@ -121,6 +127,8 @@ int fsnotify_add_event(struct fsnotify_group *group,
 queue:
 	group->q_len++;
 	list_add_tail(&event->list, list);
+	if (insert && event != group->overflow_event)
+		insert(group, event);
 	spin_unlock(&group->notification_lock);
 
 	wake_up(&group->notification_waitq);
@@ -158,6 +166,19 @@ struct fsnotify_event *fsnotify_remove_first_event(struct fsnotify_group *group)
 	return event;
 }
 
+/*
+ * Put an event obtained with fsnotify_remove_first_event() back at the head
+ * of the notification list, e.g. because the reader could not deliver it.
+ */
+void fsnotify_requeue_first_event(struct fsnotify_group *group,
+				  struct fsnotify_event *event)
+{
+	assert_spin_locked(&group->notification_lock);
+
+	list_add(&event->list, &group->notification_list);
+	group->q_len++;
+}
+
 /*
  * This will not remove the event, that must be done with
  * fsnotify_remove_first_event()
@@ -116,35 +116,22 @@ int ovl_copy_xattr(struct dentry *old, struct dentry *new)
 	return error;
 }
 
-static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
+/* Copy [pos, pos + len) of old_file to the same range of new_file */
+static int ovl_copy_up_file_range(struct file *old_file, struct file *new_file,
+				  loff_t pos, loff_t len)
 {
-	struct file *old_file;
-	struct file *new_file;
-	loff_t old_pos = 0;
-	loff_t new_pos = 0;
+	loff_t old_pos = pos;
+	loff_t new_pos = pos;
 	loff_t cloned;
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
 	int error = 0;
 
-	if (len == 0)
-		return 0;
-
-	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
-	if (IS_ERR(old_file))
-		return PTR_ERR(old_file);
-
-	new_file = ovl_path_open(new, O_LARGEFILE | O_WRONLY);
-	if (IS_ERR(new_file)) {
-		error = PTR_ERR(new_file);
-		goto out_fput;
-	}
-
 	/* Try to use clone_file_range to clone up within the same fs */
-	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
+	cloned = do_clone_file_range(old_file, pos, new_file, pos, len, 0);
 	if (cloned == len)
-		goto out;
+		return 0;
 	/* Couldn't clone, so now we try to copy the data */
 
 	/* Check if lower fs supports seek operation */
@@ -205,7 +192,30 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 
 		len -= bytes;
 	}
-out:
+
+	return error;
+}
+
+static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
+{
+	struct file *old_file;
+	struct file *new_file;
+	int error;
+
+	if (len == 0)
+		return 0;
+
+	old_file = ovl_path_open(old, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(old_file))
+		return PTR_ERR(old_file);
+
+	new_file = ovl_path_open(new, O_LARGEFILE | O_WRONLY);
+	if (IS_ERR(new_file)) {
+		error = PTR_ERR(new_file);
+		goto out_fput;
+	}
+
+	error = ovl_copy_up_file_range(old_file, new_file, 0, len);
 	if (!error)
 		error = vfs_fsync(new_file, 0);
 	fput(new_file);
@@ -768,6 +778,217 @@ static bool ovl_need_meta_copy_up(struct dentry *dentry, umode_t mode,
 	return true;
 }
 
+/*
+ * Instead of copying up all data of a large metacopy file on its first
+ * open for write, record an empty datamap and let the data be copied up
+ * chunk by chunk as it is written (ovl_lazy_copy_up_range()).  Returns 0
+ * if the file is now partially copied up.
+ */
+static int ovl_lazy_copy_up_start(struct ovl_copy_up_ctx *c,
+				  struct dentry *upper)
+{
+	struct ovl_fs *ofs = c->dentry->d_sb->s_fs_info;
+	struct inode *inode = d_inode(c->dentry);
+	unsigned long nchunks;
+	size_t size;
+	u8 *map;
+	int err;
+
+	if (!ofs->config.lazydata || c->stat.size <= OVL_LAZY_CHUNK_SIZE)
+		return -EOPNOTSUPP;
+
+	nchunks = DIV_ROUND_UP(c->stat.size, OVL_LAZY_CHUNK_SIZE);
+	size = DIV_ROUND_UP(nchunks, BITS_PER_BYTE);
+	if (size > XATTR_SIZE_MAX)
+		return -E2BIG;
+
+	map = kzalloc(size, GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+	/* Chunks past lower EOF have nothing to copy up */
+	if (nchunks % BITS_PER_BYTE)
+		map[size - 1] = 0xff << (nchunks % BITS_PER_BYTE);
+
+	err = ovl_do_setxattr(upper, OVL_XATTR_DATAMAP, map, size, 0);
+	if (err) {
+		kfree(map);
+		return err;
+	}
+
+	OVL_I(inode)->lazymap = map;
+	OVL_I(inode)->lazy_nchunks = size * BITS_PER_BYTE;
+	ovl_set_flag(OVL_LAZYDATA, inode);
+	ovl_set_upperdata(inode);
+
+	return 0;
+}
+
+/* Called with ovl_inode lock held once every chunk has been copied up */
+static int ovl_lazy_copy_up_end(struct dentry *dentry, struct dentry *upper)
+{
+	int err;
+
+	/* Without metacopy the stale datamap is ignored, so drop it last */
+	err = ovl_do_removexattr(upper, OVL_XATTR_METACOPY);
+	if (err)
+		return err;
+
+	ovl_do_removexattr(upper, OVL_XATTR_DATAMAP);
+	ovl_clear_flag(OVL_LAZYDATA, d_inode(dentry));
+
+	return 0;
+}
+
+/*
+ * Copy up the chunks of a partially copied up file that overlap
+ * [pos, pos + len) and have not been copied up yet, before they are
+ * modified in upper.  The copied data is made stable before the datamap
+ * says so, otherwise a crash could expose the holes of the upper file.
+ * With !copy, the chunks are only marked as copied up.
+ */
+static int ovl_lazy_update_range(struct dentry *dentry, loff_t pos,
+				 loff_t len, bool copy)
+{
+	struct inode *inode = d_inode(dentry);
+	struct ovl_inode *oi = OVL_I(inode);
+	struct path upperpath, datapath;
+	struct file *old_file = NULL, *new_file = NULL;
+	unsigned long first, last, idx;
+	const struct cred *old_cred;
+	size_t size;
+	u8 *map = NULL;
+	bool copied = false;
+	int err;
+
+	if (!ovl_test_flag(OVL_LAZYDATA, inode) || len <= 0)
+		return 0;
+
+	first = pos >> OVL_LAZY_CHUNK_SHIFT;
+	if (len > LLONG_MAX - pos)
+		last = ULONG_MAX;
+	else
+		last = (pos + len - 1) >> OVL_LAZY_CHUNK_SHIFT;
+
+	old_cred = ovl_override_creds(dentry->d_sb);
+	err = ovl_inode_lock(inode);
+	if (err)
+		goto out_creds;
+
+	/* Raced with another copy up of the last chunks? */
+	if (!ovl_test_flag(OVL_LAZYDATA, inode))
+		goto out_unlock;
+
+	ovl_path_upper(dentry, &upperpath);
+	ovl_path_lowerdata(dentry, &datapath);
+	if (WARN_ON(!upperpath.dentry || !datapath.dentry)) {
+		err = -EIO;
+		goto out_unlock;
+	}
+
+	if (first >= oi->lazy_nchunks)
+		goto out_unlock;
+	size = DIV_ROUND_UP(oi->lazy_nchunks, BITS_PER_BYTE);
+	last = min(last, oi->lazy_nchunks - 1);
+	for (idx = first; idx <= last; idx++) {
+		if (ovl_lazy_chunk_copied(inode, idx))
+			continue;
+
+		if (!map) {
+			err = -ENOMEM;
+			map = kmemdup(oi->lazymap, size, GFP_KERNEL);
+			if (!map)
+				goto out_unlock;
+		}
+		if (copy && !new_file) {
+			old_file = ovl_path_open(&datapath,
+						 O_LARGEFILE | O_RDONLY);
+			if (IS_ERR(old_file)) {
+				err = PTR_ERR(old_file);
+				old_file = NULL;
+				goto out_unlock;
+			}
+			new_file = ovl_path_open(&upperpath,
+						 O_LARGEFILE | O_WRONLY);
+			if (IS_ERR(new_file)) {
+				err = PTR_ERR(new_file);
+				new_file = NULL;
+				goto out_unlock;
+			}
+		}
+
+		if (copy) {
+			err = ovl_copy_up_file_range(old_file, new_file,
+					(loff_t)idx << OVL_LAZY_CHUNK_SHIFT,
+					OVL_LAZY_CHUNK_SIZE);
+			if (err)
+				goto out_unlock;
+		}
+		map[idx / BITS_PER_BYTE] |= 1 << (idx % BITS_PER_BYTE);
+		copied = true;
+	}
+
+	err = 0;
+	if (!copied)
+		goto out_unlock;
+
+	if (copy)
+		err = vfs_fsync_range(new_file,
+				(loff_t)first << OVL_LAZY_CHUNK_SHIFT,
+				((loff_t)(last + 1) << OVL_LAZY_CHUNK_SHIFT) - 1,
+				1);
+	if (!err)
+		err = ovl_do_setxattr(upperpath.dentry, OVL_XATTR_DATAMAP,
+				      map, size, 0);
+	if (err)
+		goto out_unlock;
+
+	/* Bits only ever get set, so lockless readers see old or new */
+	for (idx = 0; idx < size; idx++)
+		WRITE_ONCE(oi->lazymap[idx], map[idx]);
+
+	if (!memchr_inv(map, 0xff, size))
+		err = ovl_lazy_copy_up_end(dentry, upperpath.dentry);
+
+out_unlock:
+	ovl_inode_unlock(inode);
+	if (new_file)
+		fput(new_file);
+	if (old_file)
+		fput(old_file);
+	kfree(map);
+out_creds:
+	revert_creds(old_cred);
+
+	return err;
+}
+
+int ovl_lazy_copy_up_range(struct dentry *dentry, loff_t pos, loff_t len)
+{
+	return ovl_lazy_update_range(dentry, pos, len, true);
+}
+
+/* Finish copying up a partially copied up file */
+int ovl_lazy_copy_up_all(struct dentry *dentry)
+{
+	return ovl_lazy_update_range(dentry, 0, LLONG_MAX, true);
+}
+
+/*
+ * Before a truncate to @size, copy up the chunk that will straddle the new
+ * EOF.  After the truncate (@done), chunks past the new EOF are holes in
+ * upper that must not be refilled from lower if the file is extended.
+ */
+int ovl_lazy_truncate(struct dentry *dentry, loff_t size, bool done)
+{
+	loff_t end = round_up(size, OVL_LAZY_CHUNK_SIZE);
+
+	if (!done)
+		return size == end ? 0 :
+			ovl_lazy_update_range(dentry, size, 1, true);
+
+	return ovl_lazy_update_range(dentry, end, LLONG_MAX - end, false);
+}
+
 /* Copy up data of an inode which was copied up metadata only in the past. */
 static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 {
@@ -784,6 +1005,9 @@ static int ovl_copy_up_meta_inode_data(struct ovl_copy_up_ctx *c)
 	if (WARN_ON(datapath.dentry == NULL))
 		return -EIO;
 
+	if (!ovl_lazy_copy_up_start(c, upperpath.dentry))
+		return 0;
+
 	if (c->stat.size) {
 		err = cap_size = ovl_getxattr(upperpath.dentry, XATTR_NAME_CAPS,
 					      &capability, 0);
@@ -12,6 +12,7 @@
 #include <linux/splice.h>
 #include <linux/mm.h>
 #include <linux/fs.h>
+#include <linux/falloc.h>
 #include "overlayfs.h"
 
 struct ovl_aio_req {
@@ -171,6 +172,14 @@ static loff_t ovl_llseek(struct file *file, loff_t offset, int whence)
 			return vfs_setpos(file, 0, 0);
 	}
 
+	/*
+	 * Data of a partially copied up file is spread over lower and
+	 * upper, neither of which knows where its holes are.
+	 */
+	if ((whence == SEEK_DATA || whence == SEEK_HOLE) &&
+	    ovl_test_flag(OVL_LAZYDATA, inode))
+		return generic_file_llseek(file, offset, whence);
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		return ret;
@@ -263,6 +272,97 @@ static void ovl_aio_rw_complete(struct kiocb *iocb, long res, long res2)
 	orig_iocb->ki_complete(orig_iocb, res, res2);
 }
 
+/*
+ * Length of the run of chunks of a partially copied up file starting at
+ * @pos that are all copied up, or all not, capped to @len.
+ */
+static size_t ovl_lazy_run(struct inode *inode, loff_t pos, size_t len,
+			   bool *copied)
+{
+	unsigned long idx = pos >> OVL_LAZY_CHUNK_SHIFT;
+	loff_t end;
+
+	*copied = ovl_lazy_chunk_copied(inode, idx);
+	do {
+		end = (loff_t)++idx << OVL_LAZY_CHUNK_SHIFT;
+	} while (end - pos < len &&
+		 ovl_lazy_chunk_copied(inode, idx) == *copied);
+
+	return min_t(loff_t, end - pos, len);
+}
+
+static struct file *ovl_lazy_open_lower(struct file *file)
+{
+	struct path datapath;
+
+	ovl_path_lowerdata(file_dentry(file), &datapath);
+	if (WARN_ON(!datapath.dentry))
+		return ERR_PTR(-EIO);
+
+	return ovl_path_open(&datapath, O_LARGEFILE | O_RDONLY);
+}
+
+/*
+ * Read a partially copied up file, taking the chunks that have not been
+ * copied up yet from lower.  Past lower EOF, the rest is in upper.
+ */
+static ssize_t ovl_lazy_read_iter(struct kiocb *iocb, struct iov_iter *iter,
+				  struct file *upperfile)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct file *lowerfile = NULL;
+	struct file *realfile;
+	bool lower_eof = false;
+	size_t count, run;
+	ssize_t ret = 0;
+	ssize_t bytes;
+	bool copied;
+
+	if (iocb->ki_flags & IOCB_NOWAIT)
+		return -EAGAIN;
+
+	while ((count = iov_iter_count(iter))) {
+		run = ovl_lazy_run(inode, iocb->ki_pos, count, &copied);
+		realfile = upperfile;
+		if (!copied && !lower_eof) {
+			if (!lowerfile) {
+				lowerfile = ovl_lazy_open_lower(file);
+				if (IS_ERR(lowerfile)) {
+					bytes = PTR_ERR(lowerfile);
+					lowerfile = NULL;
+					goto error;
+				}
+			}
+			realfile = lowerfile;
+		}
+
+		iov_iter_truncate(iter, run);
+		bytes = vfs_iter_read(realfile, iter, &iocb->ki_pos,
+				      ovl_iocb_to_rwf(iocb));
+		iov_iter_reexpand(iter, iov_iter_count(iter) + count - run);
+		if (bytes < 0)
+			goto error;
+
+		ret += bytes;
+		if (bytes < run) {
+			if (realfile == upperfile)
+				break;
+			lower_eof = true;
+		}
+	}
+out:
+	if (lowerfile)
+		fput(lowerfile);
+
+	return ret;
+
+error:
+	if (!ret)
+		ret = bytes;
+	goto out;
+}
+
 static ssize_t ovl_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 {
 	struct file *file = iocb->ki_filp;
@@ -278,7 +378,9 @@ static ssize_t ovl_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 		return ret;
 
 	old_cred = ovl_override_creds(file_inode(file)->i_sb);
-	if (is_sync_kiocb(iocb)) {
+	if (ovl_test_flag(OVL_LAZYDATA, file_inode(file))) {
+		ret = ovl_lazy_read_iter(iocb, iter, real.file);
+	} else if (is_sync_kiocb(iocb)) {
 		ret = vfs_iter_read(real.file, iter, &iocb->ki_pos,
 				    ovl_iocb_to_rwf(iocb));
 	} else {
@@ -314,6 +416,7 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	struct fd real;
 	const struct cred *old_cred;
 	ssize_t ret;
+	loff_t pos;
 
 	if (!iov_iter_count(iter))
 		return 0;
@@ -325,6 +428,12 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (ret)
 		goto out_unlock;
 
+	pos = iocb->ki_flags & IOCB_APPEND ? i_size_read(inode) : iocb->ki_pos;
+	ret = ovl_lazy_copy_up_range(file_dentry(file), pos,
+				     iov_iter_count(iter));
+	if (ret)
+		goto out_unlock;
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		goto out_unlock;
@@ -369,16 +478,36 @@ static ssize_t ovl_splice_read(struct file *in, loff_t *ppos,
 			 struct pipe_inode_info *pipe, size_t len,
 			 unsigned int flags)
 {
+	struct inode *inode = file_inode(in);
+	struct file *lowerfile;
 	ssize_t ret;
 	struct fd real;
 	const struct cred *old_cred;
+	bool copied;
 
 	ret = ovl_real_fdget(in, &real);
 	if (ret)
 		return ret;
 
-	old_cred = ovl_override_creds(file_inode(in)->i_sb);
+	old_cred = ovl_override_creds(inode->i_sb);
+	if (ovl_test_flag(OVL_LAZYDATA, inode)) {
+		/* A short splice is fine, so stop at the end of the run */
+		len = ovl_lazy_run(inode, *ppos, len, &copied);
+		if (!copied) {
+			lowerfile = ovl_lazy_open_lower(in);
+			ret = PTR_ERR(lowerfile);
+			if (IS_ERR(lowerfile))
+				goto out;
+			ret = generic_file_splice_read(lowerfile, ppos, pipe,
+						       len, flags);
+			fput(lowerfile);
+			/* Past lower EOF, the rest is in upper */
+			if (ret)
+				goto out;
+		}
+	}
 	ret = generic_file_splice_read(real.file, ppos, pipe, len, flags);
+out:
 	revert_creds(old_cred);
 
 	ovl_file_accessed(in);
@@ -390,9 +519,16 @@ static ssize_t
 ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 			  loff_t *ppos, size_t len, unsigned int flags)
 {
+	struct inode *inode = file_inode(out);
 	struct fd real;
 	const struct cred *old_cred;
 	ssize_t ret;
+	loff_t pos;
+
+	pos = out->f_flags & O_APPEND ? i_size_read(inode) : *ppos;
+	ret = ovl_lazy_copy_up_range(file_dentry(out), pos, len);
+	if (ret)
+		return ret;
 
 	ret = ovl_real_fdget(out, &real);
 	if (ret)
@@ -431,6 +567,7 @@ static int ovl_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 
 static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 {
+	struct inode *inode = file_inode(file);
 	struct file *realfile = file->private_data;
 	const struct cred *old_cred;
 	int ret;
@@ -441,6 +578,13 @@ static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 	if (WARN_ON(file != vma->vm_file))
 		return -EIO;
 
+	/* The mapping can only be backed by upper once all data is there */
+	if (ovl_test_flag(OVL_LAZYDATA, inode)) {
+		ret = ovl_lazy_copy_up_all(file_dentry(file));
+		if (ret)
+			return ret;
+	}
+
 	vma->vm_file = get_file(realfile);
 
 	old_cred = ovl_override_creds(file_inode(file)->i_sb);
@@ -465,7 +609,15 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	struct inode *inode = file_inode(file);
 	struct fd real;
 	const struct cred *old_cred;
-	int ret;
+	int ret = 0;
+
+	/* Shifting data around needs all of it in upper */
+	if (mode & (FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE))
+		ret = ovl_lazy_copy_up_all(file_dentry(file));
+	else if (mode & (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE))
+		ret = ovl_lazy_copy_up_range(file_dentry(file), offset, len);
+	if (ret)
+		return ret;
 
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
@@ -677,6 +829,24 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 	const struct cred *old_cred;
 	loff_t ret;
 
+	/* A zero length clone or dedupe goes up to EOF of the source */
+	if (!len && op != OVL_COPY) {
+		ret = ovl_lazy_copy_up_range(file_dentry(file_in), pos_in,
+					     LLONG_MAX - pos_in);
+		if (!ret)
+			ret = ovl_lazy_copy_up_range(file_dentry(file_out),
+						     pos_out,
+						     LLONG_MAX - pos_out);
+	} else {
+		ret = ovl_lazy_copy_up_range(file_dentry(file_in), pos_in,
+					     len);
+		if (!ret)
+			ret = ovl_lazy_copy_up_range(file_dentry(file_out),
+						     pos_out, len);
+	}
+	if (ret)
+		return ret;
+
 	ret = ovl_real_fdget(file_out, &real_out);
 	if (ret)
 		return ret;
@@ -58,6 +58,12 @@ int ovl_setattr(struct dentry *dentry, struct iattr *attr)
 		if (attr->ia_valid & (ATTR_KILL_SUID|ATTR_KILL_SGID))
 			attr->ia_valid &= ~ATTR_MODE;
 
+		if (attr->ia_valid & ATTR_SIZE) {
+			err = ovl_lazy_truncate(dentry, attr->ia_size, false);
+			if (err)
+				goto out_put_write;
+		}
+
 		inode_lock(upperdentry->d_inode);
 		old_cred = ovl_override_creds(dentry->d_sb);
 		err = notify_change(upperdentry, attr, NULL);
@@ -66,6 +72,10 @@ int ovl_setattr(struct dentry *dentry, struct iattr *attr)
 			ovl_copyattr(upperdentry->d_inode, dentry->d_inode);
 		inode_unlock(upperdentry->d_inode);
 
+		if (!err && (attr->ia_valid & ATTR_SIZE))
+			err = ovl_lazy_truncate(dentry, attr->ia_size, true);
+out_put_write:
+
 		if (winode)
 			put_write_access(winode);
 	}
@@ -956,7 +966,13 @@ struct inode *ovl_get_inode(struct super_block *sb,
 		if (err < 0)
 			goto out_err;
 		metacopy = err;
-		if (!metacopy)
+		if (metacopy) {
+			/* Partially copied up data is served from upper */
+			err = ovl_lazy_load(inode, upperdentry);
+			if (err < 0)
+				goto out_err;
+		}
+		if (!metacopy || ovl_test_flag(OVL_LAZYDATA, inode))
 			ovl_set_flag(OVL_UPPERDATA, inode);
 	}
 
@@ -30,6 +30,15 @@ enum ovl_path_type {
 #define OVL_XATTR_NLINK OVL_XATTR_PREFIX "nlink"
 #define OVL_XATTR_UPPER OVL_XATTR_PREFIX "upper"
 #define OVL_XATTR_METACOPY OVL_XATTR_PREFIX "metacopy"
+#define OVL_XATTR_DATAMAP OVL_XATTR_PREFIX "datamap"
+
+/*
+ * Lazy data copy up happens in chunks of this size.  The datamap xattr
+ * of a partially copied up metacopy file is a little endian bitmap of
+ * the chunks that have been copied up; others still read from lower.
+ */
+#define OVL_LAZY_CHUNK_SHIFT	20
+#define OVL_LAZY_CHUNK_SIZE	(1UL << OVL_LAZY_CHUNK_SHIFT)
 
 enum ovl_inode_flag {
 	/* Pure upper dir that may contain non pure upper entries */
@@ -40,6 +49,8 @@ enum ovl_inode_flag {
 	OVL_UPPERDATA,
 	/* Inode number will remain constant over copy up. */
 	OVL_CONST_INO,
+	/* Upper data is only partially copied up (see OVL_XATTR_DATAMAP) */
+	OVL_LAZYDATA,
 };
 
 enum ovl_entry_flag {
@@ -292,6 +303,8 @@ void ovl_nlink_end(struct dentry *dentry);
 int ovl_lock_rename_workdir(struct dentry *workdir, struct dentry *upperdir);
 int ovl_check_metacopy_xattr(struct dentry *dentry);
 bool ovl_is_metacopy_dentry(struct dentry *dentry);
+int ovl_lazy_load(struct inode *inode, struct dentry *upperdentry);
+bool ovl_lazy_chunk_copied(struct inode *inode, unsigned long idx);
 char *ovl_get_redirect_xattr(struct dentry *dentry, int padding);
 ssize_t ovl_getxattr(struct dentry *dentry, char *name, char **value,
 		     size_t padding);
@@ -458,6 +471,9 @@ int ovl_copy_up(struct dentry *dentry);
 int ovl_copy_up_with_data(struct dentry *dentry);
 int ovl_copy_up_flags(struct dentry *dentry, int flags);
 int ovl_maybe_copy_up(struct dentry *dentry, int flags);
+int ovl_lazy_copy_up_range(struct dentry *dentry, loff_t pos, loff_t len);
+int ovl_lazy_copy_up_all(struct dentry *dentry);
+int ovl_lazy_truncate(struct dentry *dentry, loff_t size, bool done);
 int ovl_copy_xattr(struct dentry *old, struct dentry *new);
 int ovl_set_attr(struct dentry *upper, struct kstat *stat);
 struct ovl_fh *ovl_encode_real_fh(struct dentry *real, bool is_upper);
@@ -17,6 +17,7 @@ struct ovl_config {
 	bool nfs_export;
 	int xino;
 	bool metacopy;
+	bool lazydata;
 };
 
 struct ovl_sb {
@@ -75,6 +76,12 @@ struct ovl_fs {
 	struct inode *indexdir_trap;
 	/* -1: disabled, 0: same fs, 1..32: number of unused ino bits */
 	int xino_mode;
+	/* Merged dir cache statistics */
+	atomic_long_t dir_cache_hits;
+	atomic_long_t dir_cache_misses;
+	atomic64_t dir_cache_rebuild_ns;
+	u64 dir_cache_rebuild_max_ns;
+	struct dentry *debugfs_dir;
 };
 
 static inline struct ovl_fs *OVL_FS(struct super_block *sb)
@@ -112,6 +119,9 @@ struct ovl_inode {
 	struct inode vfs_inode;
 	struct dentry *__upperdentry;
 	struct inode *lower;
+	/* copied up chunks of a partially copied up file [lock] */
+	u8 *lazymap;
+	unsigned long lazy_nchunks;
 
 	/* synchronize copy up and more */
 	struct mutex lock;
@@ -13,8 +13,15 @@
 #include <linux/security.h>
 #include <linux/cred.h>
 #include <linux/ratelimit.h>
+#include <linux/module.h>
+#include <linux/ktime.h>
 #include "overlayfs.h"
 
+static bool ovl_keep_dir_cache = true;
+module_param_named(keep_dir_cache, ovl_keep_dir_cache, bool, 0644);
+MODULE_PARM_DESC(keep_dir_cache,
+		 "Keep merged directory caches after the last close until the directory changes");
+
 struct ovl_cache_entry {
 	unsigned int len;
 	unsigned int type;
@@ -242,8 +249,17 @@ static void ovl_cache_put(struct ovl_dir_file *od, struct dentry *dentry)
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
 	if (!cache->refcount) {
-		if (ovl_dir_cache(d_inode(dentry)) == cache)
+		/*
+		 * Listing all layers of a large merged dir is expensive, so
+		 * keep an up-to-date cache around for the next opener.  It is
+		 * freed with the inode or on first use after the dir changed.
+		 */
+		if (ovl_dir_cache(d_inode(dentry)) == cache) {
+			if (ovl_keep_dir_cache &&
+			    ovl_dentry_version_get(dentry) == cache->version)
+				return;
 			ovl_set_dir_cache(d_inode(dentry), NULL);
+		}
 
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
@@ -404,16 +420,23 @@ static void ovl_seek_cursor(struct ovl_dir_file *od, loff_t pos)
 
 static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 {
+	struct ovl_fs *ofs = dentry->d_sb->s_fs_info;
 	int res;
 	struct ovl_dir_cache *cache;
+	u64 start, ns;
 
 	cache = ovl_dir_cache(d_inode(dentry));
 	if (cache && ovl_dentry_version_get(dentry) == cache->version) {
-		WARN_ON(!cache->refcount);
 		cache->refcount++;
+		atomic_long_inc(&ofs->dir_cache_hits);
 		return cache;
 	}
 	ovl_set_dir_cache(d_inode(dentry), NULL);
+	/* A stale cache that was kept after the last close */
+	if (cache && !cache->refcount) {
+		ovl_cache_free(&cache->entries);
+		kfree(cache);
+	}
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
 	if (!cache)
@@ -423,6 +446,7 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 	INIT_LIST_HEAD(&cache->entries);
 	cache->root = RB_ROOT;
 
+	start = ktime_get_ns();
 	res = ovl_dir_read_merged(dentry, &cache->entries, &cache->root);
 	if (res) {
 		ovl_cache_free(&cache->entries);
@@ -430,6 +454,13 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 		return ERR_PTR(res);
 	}
 
+	ns = ktime_get_ns() - start;
+	atomic_long_inc(&ofs->dir_cache_misses);
+	atomic64_add(ns, &ofs->dir_cache_rebuild_ns);
+	/* Racy, but good enough for a statistic */
+	if (ns > READ_ONCE(ofs->dir_cache_rebuild_max_ns))
+		WRITE_ONCE(ofs->dir_cache_rebuild_max_ns, ns);
+
 	cache->version = ovl_dentry_version_get(dentry);
 	ovl_set_dir_cache(d_inode(dentry), cache);
 
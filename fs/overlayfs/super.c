@@ -15,6 +15,8 @@
 #include <linux/seq_file.h>
 #include <linux/posix_acl_xattr.h>
 #include <linux/exportfs.h>
+#include <linux/debugfs.h>
+#include <linux/kdev_t.h>
 #include "overlayfs.h"
 
 MODULE_AUTHOR("Miklos Szeredi <miklos@szeredi.hu>");
@@ -66,6 +68,11 @@ module_param_named(metacopy, ovl_metacopy_def, bool, 0644);
 MODULE_PARM_DESC(metacopy,
 		 "Default to on or off for the metadata only copy up feature");
 
+static bool ovl_lazydata_def;
+module_param_named(lazydata, ovl_lazydata_def, bool, 0644);
+MODULE_PARM_DESC(lazydata,
+		 "Default to on or off for copying up metacopy file data lazily on write");
+
 static void ovl_dentry_release(struct dentry *dentry)
 {
 	struct ovl_entry *oe = dentry->d_fsdata;
@@ -182,6 +189,8 @@ static struct inode *ovl_alloc_inode(struct super_block *sb)
 	oi->__upperdentry = NULL;
 	oi->lower = NULL;
 	oi->lowerdata = NULL;
+	oi->lazymap = NULL;
+	oi->lazy_nchunks = 0;
 	mutex_init(&oi->lock);
 
 	return &oi->vfs_inode;
@@ -192,6 +201,7 @@ static void ovl_free_inode(struct inode *inode)
 	struct ovl_inode *oi = OVL_I(inode);
 
 	kfree(oi->redirect);
+	kfree(oi->lazymap);
 	mutex_destroy(&oi->lock);
 	kmem_cache_free(ovl_inode_cachep, oi);
 }
@@ -208,10 +218,41 @@ static void ovl_destroy_inode(struct inode *inode)
 		iput(oi->lowerdata);
 }
 
+static struct dentry *ovl_debugfs_root;
+
+static int ovl_dir_cache_stats_show(struct seq_file *m, void *v)
+{
+	struct ovl_fs *ofs = m->private;
+	unsigned long misses = atomic_long_read(&ofs->dir_cache_misses);
+	u64 ns = atomic64_read(&ofs->dir_cache_rebuild_ns);
+
+	seq_printf(m, "hits: %lu\n", atomic_long_read(&ofs->dir_cache_hits));
+	seq_printf(m, "rebuilds: %lu\n", misses);
+	seq_printf(m, "rebuild_avg_us: %llu\n",
+		   misses ? div64_u64(ns, misses) / NSEC_PER_USEC : 0);
+	seq_printf(m, "rebuild_max_us: %llu\n",
+		   READ_ONCE(ofs->dir_cache_rebuild_max_ns) / NSEC_PER_USEC);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ovl_dir_cache_stats);
+
+static void ovl_debugfs_register(struct super_block *sb)
+{
+	struct ovl_fs *ofs = sb->s_fs_info;
+	char name[32];
+
+	snprintf(name, sizeof(name), "%u:%u", MAJOR(sb->s_dev),
+		 MINOR(sb->s_dev));
+	ofs->debugfs_dir = debugfs_create_dir(name, ovl_debugfs_root);
+	debugfs_create_file("dir_cache", 0444, ofs->debugfs_dir, ofs,
+			    &ovl_dir_cache_stats_fops);
+}
+
 static void ovl_free_fs(struct ovl_fs *ofs)
 {
 	unsigned i;
 
+	debugfs_remove_recursive(ofs->debugfs_dir);
 	iput(ofs->workbasedir_trap);
 	iput(ofs->indexdir_trap);
 	iput(ofs->workdir_trap);
@@ -363,6 +404,9 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 	if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
+	if (ofs->config.lazydata != ovl_lazydata_def)
+		seq_printf(m, ",lazydata=%s",
+			   ofs->config.lazydata ? "on" : "off");
 	return 0;
 }
 
@@ -403,6 +447,8 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_LAZYDATA_ON,
+	OPT_LAZYDATA_OFF,
 	OPT_ERR,
 };
 
@@ -421,6 +467,8 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_LAZYDATA_ON,		"lazydata=on"},
+	{OPT_LAZYDATA_OFF,		"lazydata=off"},
 	{OPT_ERR,			NULL}
 };
 
@@ -559,6 +607,14 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 			config->metacopy = false;
 			break;
 
+		case OPT_LAZYDATA_ON:
+			config->lazydata = true;
+			break;
+
+		case OPT_LAZYDATA_OFF:
+			config->lazydata = false;
+			break;
+
 		default:
 			pr_err("unrecognized mount option \"%s\" or missing value\n",
 					p);
@@ -606,6 +662,12 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 		}
 	}
 
+	/* Lazy data copy up starts from a metacopy upper */
+	if (config->lazydata && !config->metacopy) {
+		pr_info("disabling lazydata due to metacopy=off\n");
+		config->lazydata = false;
+	}
+
 	return 0;
 }
 
@@ -1609,6 +1671,7 @@ static int ovl_fill_super(struct super_block *sb, void *data, int silent)
 	ofs->config.nfs_export = ovl_nfs_export_def;
 	ofs->config.xino = ovl_xino_def();
 	ofs->config.metacopy = ovl_metacopy_def;
+	ofs->config.lazydata = ovl_lazydata_def;
 	err = ovl_parse_opt((char *) data, &ofs->config);
 	if (err)
 		goto out_err;
@@ -1724,6 +1787,7 @@ static int ovl_fill_super(struct super_block *sb, void *data, int silent)
 		       ovl_dentry_lower(root_dentry), NULL);
 
 	sb->s_root = root_dentry;
+	ovl_debugfs_register(sb);
 
 	return 0;
 
@@ -1772,10 +1836,13 @@ static int __init ovl_init(void)
 
 	err = ovl_aio_request_cache_init();
 	if (!err) {
+		ovl_debugfs_root = debugfs_create_dir("overlayfs", NULL);
 		err = register_filesystem(&ovl_fs_type);
 		if (!err)
 			return 0;
 
+		debugfs_remove_recursive(ovl_debugfs_root);
+
 		ovl_aio_request_cache_destroy();
 	}
 	kmem_cache_destroy(ovl_inode_cachep);
@@ -1794,6 +1861,7 @@ static void __exit ovl_exit(void)
 	rcu_barrier();
 	kmem_cache_destroy(ovl_inode_cachep);
 	ovl_aio_request_cache_destroy();
+	debugfs_remove_recursive(ovl_debugfs_root);
 }
 
 module_init(ovl_init);
@@ -860,6 +860,41 @@ bool ovl_is_metacopy_dentry(struct dentry *dentry)
 	return (oe->numlower > 1);
 }
 
+/*
+ * Load the datamap of a metacopy file whose data is partially copied up.
+ * Returns 1 if there is one, 0 for a plain metacopy file.
+ */
+int ovl_lazy_load(struct inode *inode, struct dentry *upperdentry)
+{
+	struct ovl_inode *oi = OVL_I(inode);
+	char *map = NULL;
+	ssize_t res;
+
+	res = ovl_getxattr(upperdentry, OVL_XATTR_DATAMAP, &map, 0);
+	if (res == -ENODATA || res == 0)
+		return 0;
+	if (res < 0)
+		return res;
+
+	oi->lazymap = map;
+	oi->lazy_nchunks = res * BITS_PER_BYTE;
+	ovl_set_flag(OVL_LAZYDATA, inode);
+
+	return 1;
+}
+
+/* Chunks past the end of the datamap were never in lower */
+bool ovl_lazy_chunk_copied(struct inode *inode, unsigned long idx)
+{
+	struct ovl_inode *oi = OVL_I(inode);
+
+	if (idx >= oi->lazy_nchunks)
+		return true;
+
+	return READ_ONCE(oi->lazymap[idx / BITS_PER_BYTE]) &
+		(1 << (idx % BITS_PER_BYTE));
+}
+
 ssize_t ovl_getxattr(struct dentry *dentry, char *name, char **value,
 		     size_t padding)
 {
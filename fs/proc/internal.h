@@ -13,6 +13,7 @@
 #include <linux/binfmts.h>
 #include <linux/sched/coredump.h>
 #include <linux/sched/task.h>
+#include <linux/proc_pidstats.h>
 
 struct ctl_table_header;
 struct mempolicy;
@@ -164,6 +165,14 @@ extern int pid_delete_dentry(const struct dentry *);
 extern int proc_pid_readdir(struct file *, struct dir_context *);
 struct dentry *proc_pid_lookup(struct dentry *, unsigned int);
 extern loff_t mem_lseek(struct file *, loff_t, int);
+extern bool has_pid_permissions(struct pid_namespace *, struct task_struct *,
+				int);
+
+struct tgid_iter {
+	unsigned int tgid;
+	struct task_struct *task;
+};
+extern struct tgid_iter next_tgid(struct pid_namespace *, struct tgid_iter);
 
 /* Lookups */
 typedef struct dentry *instantiate_t(struct dentry *,
@@ -276,6 +285,7 @@ extern void proc_self_init(void);
  * task_[no]mmu.c
  */
 struct mem_size_stats;
+struct smaps_rollup_cache;
 struct proc_maps_private {
 	struct inode *inode;
 	struct task_struct *task;
@@ -283,6 +293,9 @@ struct proc_maps_private {
 #ifdef CONFIG_MMU
 	struct vm_area_struct *tail_vma;
 #endif
+#ifdef CONFIG_PROC_PAGE_MONITOR
+	struct smaps_rollup_cache *rollup_cache;
+#endif
 #ifdef CONFIG_NUMA
 	struct mempolicy *task_mempolicy;
 #endif
@@ -302,3 +315,13 @@ extern unsigned long task_statm(struct mm_struct *,
 				unsigned long *, unsigned long *,
 				unsigned long *, unsigned long *);
 extern void task_mem(struct seq_file *, struct mm_struct *);
+extern void task_mem_stats(struct mm_struct *, struct proc_pidstats *);
+#ifdef CONFIG_PROC_PAGE_MONITOR
+extern int smaps_rollup_stats(struct mm_struct *, struct proc_pidstats *);
+#else
+static inline int smaps_rollup_stats(struct mm_struct *mm,
+				     struct proc_pidstats *ps)
+{
+	return 0;
+}
+#endif
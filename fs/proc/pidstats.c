@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * /proc/pidstats and /proc/pidstats_rollup: the numbers of /proc/<pid>/stat,
+ * the memory part of /proc/<pid>/status and, for the _rollup variant,
+ * /proc/<pid>/smaps_rollup for many thread groups per read(2), as fixed
+ * layout binary records instead of text. See <linux/proc_pidstats.h>.
+ */
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/pid_namespace.h>
+#include <linux/proc_fs.h>
+#include <linux/ptrace.h>
+#include <linux/sched.h>
+#include <linux/sched/cputime.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/task.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include "internal.h"
+
+static int pidstats_fill(struct pid_namespace *ns, struct task_struct *task,
+			 struct proc_pidstats *ps, bool rollup)
+{
+	struct mm_struct *mm;
+	unsigned long flags;
+	int ret = 0;
+
+	memset(ps, 0, sizeof(*ps));
+	ps->size = sizeof(*ps);
+	ps->pid = task_tgid_nr_ns(task, ns);
+	ps->state = task_state_to_char(task);
+	ps->task_flags = task->flags;
+	ps->priority = task_prio(task);
+	ps->nice = task_nice(task);
+	ps->processor = task_cpu(task);
+	ps->start_time = task->start_boottime;
+
+	/* Same accounting as do_task_stat() for a whole thread group */
+	if (lock_task_sighand(task, &flags)) {
+		struct signal_struct *sig = task->signal;
+		struct task_struct *t = task;
+		u64 utime, stime;
+
+		ps->num_threads = get_nr_threads(task);
+		do {
+			ps->min_flt += t->min_flt;
+			ps->maj_flt += t->maj_flt;
+		} while_each_thread(task, t);
+		ps->min_flt += sig->min_flt;
+		ps->maj_flt += sig->maj_flt;
+		thread_group_cputime_adjusted(task, &utime, &stime);
+		ps->utime = utime;
+		ps->stime = stime;
+
+		ps->sid = task_session_nr_ns(task, ns);
+		ps->ppid = task_tgid_nr_ns(task->real_parent, ns);
+		ps->pgid = task_pgrp_nr_ns(task, ns);
+
+		unlock_task_sighand(task, &flags);
+	}
+
+	/*
+	 * smaps_rollup needs the access check of proc_mem_open().  mm_access()
+	 * does it together with the mm lookup under cred_guard_mutex, so that
+	 * a racing exec can't hand us the mm of a more privileged image.
+	 */
+	if (rollup) {
+		mm = mm_access(task, PTRACE_MODE_READ_FSCREDS |
+				     PTRACE_MODE_NOAUDIT);
+		if (IS_ERR(mm)) {
+			if (PTR_ERR(mm) != -EACCES)
+				return PTR_ERR(mm);
+			/* the status counters need no ptrace access */
+			rollup = false;
+		}
+	}
+	if (!rollup)
+		mm = get_task_mm(task);
+	if (!mm)
+		return 0;
+
+	task_mem_stats(mm, ps);
+	if (rollup)
+		ret = smaps_rollup_stats(mm, ps);
+	mmput(mm);
+	return ret;
+}
+
+static ssize_t pidstats_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct pid_namespace *ns = proc_pid_ns(file_inode(file));
+	bool rollup = PDE_DATA(file_inode(file)) != NULL;
+	struct proc_pidstats *ps;
+	struct tgid_iter iter;
+	ssize_t done = 0;
+	int ret = 0;
+
+	if (count < sizeof(*ps))
+		return -EINVAL;
+	if (*ppos < 0 || *ppos >= PID_MAX_LIMIT)
+		return 0;
+
+	ps = kmalloc(sizeof(*ps), GFP_KERNEL);
+	if (!ps)
+		return -ENOMEM;
+
+	iter.tgid = *ppos;
+	iter.task = NULL;
+	for (iter = next_tgid(ns, iter);
+	     iter.task;
+	     iter.tgid += 1, iter = next_tgid(ns, iter)) {
+		if (count - done < sizeof(*ps)) {
+			put_task_struct(iter.task);
+			break;
+		}
+
+		cond_resched();
+		if (!has_pid_permissions(ns, iter.task, HIDEPID_INVISIBLE))
+			continue;
+
+		ret = pidstats_fill(ns, iter.task, ps, rollup);
+		if (!ret && copy_to_user(buf + done, ps, sizeof(*ps)))
+			ret = -EFAULT;
+		if (ret) {
+			put_task_struct(iter.task);
+			break;
+		}
+		done += sizeof(*ps);
+		*ppos = iter.tgid + 1;
+	}
+
+	kfree(ps);
+	return done ? done : ret;
+}
+
+static const struct proc_ops pidstats_proc_ops = {
+	.proc_read	= pidstats_read,
+	.proc_lseek	= default_llseek,
+};
+
+static int __init proc_pidstats_init(void)
+{
+	proc_create("pidstats", 0444, NULL, &pidstats_proc_ops);
+	proc_create_data("pidstats_rollup", 0444, NULL, &pidstats_proc_ops,
+			 (void *)1);
+	return 0;
+}
+fs_initcall(proc_pidstats_init);
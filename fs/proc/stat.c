@@ -104,8 +104,15 @@ static void show_all_irqs(struct seq_file *p)
 	show_irq_gap(p, nr_irqs - next);
 }
 
+/*
+ * /proc/stat_summary is /proc/stat without the per-IRQ counts on the "intr"
+ * line, which with thousands of interrupts make up most of the cost of
+ * generating the file.  Only the total is shown.
+ */
 static int show_stat(struct seq_file *p, void *v)
 {
+	bool summary = p->private;
+
 	int i, j;
 	u64 user, nice, system, idle, iowait, irq, softirq, steal;
 	u64 guest, guest_nice;
@@ -191,7 +198,8 @@ static int show_stat(struct seq_file *p, void *v)
 	}
 	seq_put_decimal_ull(p, "intr ", (unsigned long long)sum);
 
-	show_all_irqs(p);
+	if (!summary)
+		show_all_irqs(p);
 
 	seq_printf(p,
 		"\nctxt %llu\n"
@@ -217,10 +225,12 @@ static int show_stat(struct seq_file *p, void *v)
 static int stat_open(struct inode *inode, struct file *file)
 {
 	unsigned int size = 1024 + 128 * num_online_cpus();
+	void *summary = PDE_DATA(inode);
 
 	/* minimum size to display an interrupt count : 2 bytes */
-	size += 2 * nr_irqs;
-	return single_open_size(file, show_stat, NULL, size);
+	if (!summary)
+		size += 2 * nr_irqs;
+	return single_open_size(file, show_stat, summary, size);
 }
 
 static const struct proc_ops stat_proc_ops = {
@@ -233,6 +243,7 @@ static const struct proc_ops stat_proc_ops = {
 static int __init proc_stat_init(void)
 {
 	proc_create("stat", 0, NULL, &stat_proc_ops);
+	proc_create_data("stat_summary", 0, NULL, &stat_proc_ops, (void *)1);
 	return 0;
 }
 fs_initcall(proc_stat_init);
@@ -19,15 +19,15 @@
 #include <linux/shmem_fs.h>
 #include <linux/uaccess.h>
 #include <linux/pkeys.h>
+#include <linux/moduleparam.h>
 
 #include <asm/elf.h>
 #include <asm/tlb.h>
 #include <asm/tlbflush.h>
 #include "internal.h"
 
-#define SEQ_PUT_DEC(str, val) \
-		seq_put_decimal_ull_width(m, str, (val) << (PAGE_SHIFT-10), 8)
-void task_mem(struct seq_file *m, struct mm_struct *mm)
+/* Fill in the /proc/<pid>/status memory fields of @ps, in bytes */
+void task_mem_stats(struct mm_struct *mm, struct proc_pidstats *ps)
 {
 	unsigned long text, lib, swap, anon, file, shmem;
 	unsigned long hiwater_vm, total_vm, hiwater_rss, total_rss;
@@ -56,24 +56,46 @@ void task_mem(struct seq_file *m, struct mm_struct *mm)
 	lib = (mm->exec_vm << PAGE_SHIFT) - text;
 
 	swap = get_mm_counter(mm, MM_SWAPENTS);
-	SEQ_PUT_DEC("VmPeak:\t", hiwater_vm);
-	SEQ_PUT_DEC(" kB\nVmSize:\t", total_vm);
-	SEQ_PUT_DEC(" kB\nVmLck:\t", mm->locked_vm);
-	SEQ_PUT_DEC(" kB\nVmPin:\t", atomic64_read(&mm->pinned_vm));
-	SEQ_PUT_DEC(" kB\nVmHWM:\t", hiwater_rss);
-	SEQ_PUT_DEC(" kB\nVmRSS:\t", total_rss);
-	SEQ_PUT_DEC(" kB\nRssAnon:\t", anon);
-	SEQ_PUT_DEC(" kB\nRssFile:\t", file);
-	SEQ_PUT_DEC(" kB\nRssShmem:\t", shmem);
-	SEQ_PUT_DEC(" kB\nVmData:\t", mm->data_vm);
-	SEQ_PUT_DEC(" kB\nVmStk:\t", mm->stack_vm);
-	seq_put_decimal_ull_width(m,
-		    " kB\nVmExe:\t", text >> 10, 8);
-	seq_put_decimal_ull_width(m,
-		    " kB\nVmLib:\t", lib >> 10, 8);
-	seq_put_decimal_ull_width(m,
-		    " kB\nVmPTE:\t", mm_pgtables_bytes(mm) >> 10, 8);
-	SEQ_PUT_DEC(" kB\nVmSwap:\t", swap);
+
+	ps->vm_peak = (u64)hiwater_vm << PAGE_SHIFT;
+	ps->vm_size = (u64)total_vm << PAGE_SHIFT;
+	ps->vm_lck = (u64)mm->locked_vm << PAGE_SHIFT;
+	ps->vm_pin = (u64)atomic64_read(&mm->pinned_vm) << PAGE_SHIFT;
+	ps->vm_hwm = (u64)hiwater_rss << PAGE_SHIFT;
+	ps->vm_rss = (u64)total_rss << PAGE_SHIFT;
+	ps->rss_anon = (u64)anon << PAGE_SHIFT;
+	ps->rss_file = (u64)file << PAGE_SHIFT;
+	ps->rss_shmem = (u64)shmem << PAGE_SHIFT;
+	ps->vm_data = (u64)mm->data_vm << PAGE_SHIFT;
+	ps->vm_stk = (u64)mm->stack_vm << PAGE_SHIFT;
+	ps->vm_exe = text;
+	ps->vm_lib = lib;
+	ps->vm_pte = mm_pgtables_bytes(mm);
+	ps->vm_swap = (u64)swap << PAGE_SHIFT;
+}
+
+#define SEQ_PUT_DEC(str, val) \
+		seq_put_decimal_ull_width(m, str, (val) >> 10, 8)
+void task_mem(struct seq_file *m, struct mm_struct *mm)
+{
+	struct proc_pidstats ps;
+
+	task_mem_stats(mm, &ps);
+	SEQ_PUT_DEC("VmPeak:\t", ps.vm_peak);
+	SEQ_PUT_DEC(" kB\nVmSize:\t", ps.vm_size);
+	SEQ_PUT_DEC(" kB\nVmLck:\t", ps.vm_lck);
+	SEQ_PUT_DEC(" kB\nVmPin:\t", ps.vm_pin);
+	SEQ_PUT_DEC(" kB\nVmHWM:\t", ps.vm_hwm);
+	SEQ_PUT_DEC(" kB\nVmRSS:\t", ps.vm_rss);
+	SEQ_PUT_DEC(" kB\nRssAnon:\t", ps.rss_anon);
+	SEQ_PUT_DEC(" kB\nRssFile:\t", ps.rss_file);
+	SEQ_PUT_DEC(" kB\nRssShmem:\t", ps.rss_shmem);
+	SEQ_PUT_DEC(" kB\nVmData:\t", ps.vm_data);
+	SEQ_PUT_DEC(" kB\nVmStk:\t", ps.vm_stk);
+	SEQ_PUT_DEC(" kB\nVmExe:\t", ps.vm_exe);
+	SEQ_PUT_DEC(" kB\nVmLib:\t", ps.vm_lib);
+	SEQ_PUT_DEC(" kB\nVmPTE:\t", ps.vm_pte);
+	SEQ_PUT_DEC(" kB\nVmSwap:\t", ps.vm_swap);
 	seq_puts(m, " kB\n");
 	hugetlb_report_usage(m, mm);
 }
@@ -747,9 +769,19 @@ static const struct mm_walk_ops smaps_shmem_walk_ops = {
 	.pte_hole		= smaps_pte_hole,
 };
 
+/*
+ * Gather the stats of @vma from @start on, or of the whole vma if @start
+ * is zero.
+ */
 static void smap_gather_stats(struct vm_area_struct *vma,
-			     struct mem_size_stats *mss)
+			     struct mem_size_stats *mss, unsigned long start)
 {
+	const struct mm_walk_ops *ops = &smaps_walk_ops;
+
+	/* Invalid start */
+	if (start >= vma->vm_end)
+		return;
+
 #ifdef CONFIG_SHMEM
 	/* In case of smaps_rollup, reset the value from previous vma */
 	mss->check_shmem_swap = false;
@@ -766,18 +798,65 @@ static void smap_gather_stats(struct vm_area_struct *vma,
 		 */
 		unsigned long shmem_swapped = shmem_swap_usage(vma);
 
-		if (!shmem_swapped || (vma->vm_flags & VM_SHARED) ||
-					!(vma->vm_flags & VM_WRITE)) {
+		if (!start && (!shmem_swapped || (vma->vm_flags & VM_SHARED) ||
+					!(vma->vm_flags & VM_WRITE))) {
 			mss->swap += shmem_swapped;
 		} else {
 			mss->check_shmem_swap = true;
-			walk_page_vma(vma, &smaps_shmem_walk_ops, mss);
-			return;
+			ops = &smaps_shmem_walk_ops;
 		}
 	}
 #endif
 	/* mmap_sem is held in m_start */
-	walk_page_vma(vma, &smaps_walk_ops, mss);
+	if (!start)
+		walk_page_vma(vma, ops, mss);
+	else
+		walk_page_range(vma->vm_mm, start, vma->vm_end, ops, mss);
+}
+
+/*
+ * Gather the stats of all vmas of @mm for smaps_rollup. Walking the page
+ * tables of a large address space takes long, so mmap_sem is dropped
+ * between vmas whenever a writer is waiting for it, and the walk resumes
+ * at the address it got to. Called with mmap_sem held for read, returns
+ * -EINTR with it released if we got killed while retaking it.
+ */
+static int smap_gather_rollup(struct mm_struct *mm, struct mem_size_stats *mss,
+			      unsigned long *last_vma_end)
+{
+	struct vm_area_struct *vma;
+
+	for (vma = mm->mmap; vma;) {
+		smap_gather_stats(vma, mss, 0);
+		*last_vma_end = vma->vm_end;
+
+		if (rwsem_is_contended(&mm->mmap_sem)) {
+			up_read(&mm->mmap_sem);
+			if (down_read_killable(&mm->mmap_sem))
+				return -EINTR;
+
+			/*
+			 * The address space may have changed meanwhile. Look
+			 * up the vma that now covers or follows the last
+			 * address walked:
+			 * - none: everything has been walked;
+			 * - it starts at or after it: walk that vma next;
+			 * - it straddles it (e.g. it grew or got merged):
+			 *   walk only its part we have not seen yet.
+			 */
+			vma = find_vma(mm, *last_vma_end - 1);
+			if (!vma)
+				break;
+			if (vma->vm_start >= *last_vma_end)
+				continue;
+			if (vma->vm_end > *last_vma_end) {
+				smap_gather_stats(vma, mss, *last_vma_end);
+				*last_vma_end = vma->vm_end;
+			}
+		}
+		vma = vma->vm_next;
+	}
+	return 0;
 }
 
 #define SEQ_PUT_DEC(str, val) \
@@ -829,7 +908,7 @@ static int show_smap(struct seq_file *m, void *v)
 
 	memset(&mss, 0, sizeof(mss));
 
-	smap_gather_stats(vma, &mss);
+	smap_gather_stats(vma, &mss, 0);
 
 	show_map_vma(m, vma);
 
@@ -852,13 +931,32 @@ static int show_smap(struct seq_file *m, void *v)
 	return 0;
 }
 
+/*
+ * A smaps_rollup file that is read again within smaps_rollup_max_age_ms of
+ * its last page table walk reports the result of that walk, so monitors
+ * polling a kept-open file (pread() at offset 0) bound the cost they impose
+ * on the task. 0, the default, walks on every read.
+ */
+static unsigned int smaps_rollup_max_age_ms;
+module_param(smaps_rollup_max_age_ms, uint, 0644);
+MODULE_PARM_DESC(smaps_rollup_max_age_ms,
+		 "Max age in ms of smaps_rollup results reused by a reader");
+
+struct smaps_rollup_cache {
+	unsigned long stamp;		/* jiffies of the walk */
+	unsigned long start;
+	unsigned long end;
+	struct mem_size_stats mss;
+};
+
 static int show_smaps_rollup(struct seq_file *m, void *v)
 {
 	struct proc_maps_private *priv = m->private;
+	struct smaps_rollup_cache *cache = priv->rollup_cache;
+	unsigned int max_age = READ_ONCE(smaps_rollup_max_age_ms);
 	struct mem_size_stats mss;
 	struct mm_struct *mm;
-	struct vm_area_struct *vma;
-	unsigned long last_vma_end = 0;
+	unsigned long start = 0, last_vma_end = 0;
 	int ret = 0;
 
 	priv->task = get_proc_task(priv->inode);
@@ -871,6 +969,14 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 		goto out_put_task;
 	}
 
+	if (max_age && cache &&
+	    time_before(jiffies, cache->stamp + msecs_to_jiffies(max_age))) {
+		mss = cache->mss;
+		start = cache->start;
+		last_vma_end = cache->end;
+		goto show;
+	}
+
 	memset(&mss, 0, sizeof(mss));
 
 	ret = down_read_killable(&mm->mmap_sem);
@@ -879,21 +985,34 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 
 	hold_task_mempolicy(priv);
 
-	for (vma = priv->mm->mmap; vma; vma = vma->vm_next) {
-		smap_gather_stats(vma, &mss);
-		last_vma_end = vma->vm_end;
+	if (mm->mmap)
+		start = mm->mmap->vm_start;
+	ret = smap_gather_rollup(mm, &mss, &last_vma_end);
+
+	release_task_mempolicy(priv);
+	if (ret)
+		goto out_put_mm;
+	up_read(&mm->mmap_sem);
+
+	if (max_age) {
+		if (!cache)
+			cache = priv->rollup_cache =
+				kmalloc(sizeof(*cache), GFP_KERNEL_ACCOUNT);
+		if (cache) {
+			cache->stamp = jiffies;
+			cache->start = start;
+			cache->end = last_vma_end;
+			cache->mss = mss;
+		}
 	}
 
-	show_vma_header_prefix(m, priv->mm->mmap->vm_start,
-			       last_vma_end, 0, 0, 0, 0);
+show:
+	show_vma_header_prefix(m, start, last_vma_end, 0, 0, 0, 0);
 	seq_pad(m, ' ');
 	seq_puts(m, "[rollup]\n");
 
 	__show_smap(m, &mss, true);
 
-	release_task_mempolicy(priv);
-	up_read(&mm->mmap_sem);
-
 out_put_mm:
 	mmput(mm);
 out_put_task:
@@ -904,6 +1023,46 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 }
 #undef SEQ_PUT_DEC
 
+/*
+ * Fill in the smaps_rollup fields of @ps for /proc/pidstats_rollup. The
+ * caller must have checked that it may read @mm.
+ */
+int smaps_rollup_stats(struct mm_struct *mm, struct proc_pidstats *ps)
+{
+	struct mem_size_stats mss;
+	unsigned long last_vma_end = 0;
+	int ret;
+
+	memset(&mss, 0, sizeof(mss));
+
+	ret = down_read_killable(&mm->mmap_sem);
+	if (ret)
+		return ret;
+	ret = smap_gather_rollup(mm, &mss, &last_vma_end);
+	if (ret)
+		return ret;
+	up_read(&mm->mmap_sem);
+
+	ps->rss = mss.resident;
+	ps->pss = mss.pss >> PSS_SHIFT;
+	ps->pss_anon = mss.pss_anon >> PSS_SHIFT;
+	ps->pss_file = mss.pss_file >> PSS_SHIFT;
+	ps->pss_shmem = mss.pss_shmem >> PSS_SHIFT;
+	ps->shared_clean = mss.shared_clean;
+	ps->shared_dirty = mss.shared_dirty;
+	ps->private_clean = mss.private_clean;
+	ps->private_dirty = mss.private_dirty;
+	ps->referenced = mss.referenced;
+	ps->anonymous = mss.anonymous;
+	ps->lazyfree = mss.lazyfree;
+	ps->anon_huge = mss.anonymous_thp;
+	ps->swap = mss.swap;
+	ps->swap_pss = mss.swap_pss >> PSS_SHIFT;
+	ps->locked = mss.pss_locked >> PSS_SHIFT;
+	ps->flags |= PROC_PIDSTATS_ROLLUP;
+	return 0;
+}
+
 static const struct seq_operations proc_pid_smaps_op = {
 	.start	= m_start,
 	.next	= m_next,
@@ -953,6 +1112,7 @@ static int smaps_rollup_release(struct inode *inode, struct file *file)
 	if (priv->mm)
 		mmdrop(priv->mm);
 
+	kfree(priv->rollup_cache);
 	kfree(priv);
 	return single_release(inode, file);
 }
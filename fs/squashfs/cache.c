@@ -39,12 +39,55 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs.h"
 #include "page_actor.h"
 
+/*
+ * Find block in the cache hash table, called with the cache lock held.
+ */
+static struct squashfs_cache_entry *squashfs_cache_lookup(
+	struct squashfs_cache *cache, u64 block)
+{
+	struct squashfs_cache_entry *entry;
+
+	hlist_for_each_entry(entry, &cache->hash[hash_64(block,
+					cache->hash_bits)], hash_node)
+		if (entry->block == block)
+			return entry;
+
+	return NULL;
+}
+
+
+/*
+ * Take the least recently used unused entry, preferring one allocated on
+ * the local node.  Called with the cache lock held and cache->unused > 0.
+ */
+static struct squashfs_cache_entry *squashfs_cache_evict(
+	struct squashfs_cache *cache)
+{
+	struct squashfs_cache_entry *entry;
+	int node = numa_node_id();
+
+	if (list_empty(&cache->lru[node])) {
+		for (node = 0; node < nr_node_ids; node++)
+			if (!list_empty(&cache->lru[node]))
+				break;
+	}
+
+	entry = list_first_entry(&cache->lru[node],
+				struct squashfs_cache_entry, lru);
+	list_del_init(&entry->lru);
+	return entry;
+}
+
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -52,21 +95,14 @@
 struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	struct squashfs_cache *cache, u64 block, int length)
 {
-	int i, n;
 	struct squashfs_cache_entry *entry;
 
 	spin_lock(&cache->lock);
 
 	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
-				break;
-			}
-			i = (i + 1) % cache->entries;
-		}
+		entry = squashfs_cache_lookup(cache, block);
 
-		if (n == cache->entries) {
+		if (entry == NULL) {
 			/*
 			 * Block not in cache, if all cache entries are used
 			 * go to sleep waiting for one to become available.
@@ -81,25 +117,20 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			}
 
 			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
+			 * At least one unused cache entry, evict the least
+			 * recently used one.
 			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
-			}
-
-			cache->next_blk = (i + 1) % cache->entries;
-			entry = &cache->entry[i];
+			entry = squashfs_cache_evict(cache);
+			cache->misses++;
 
 			/*
 			 * Initialise chosen cache entry, and fill it in from
 			 * disk.
 			 */
 			cache->unused--;
+			hlist_del_init(&entry->hash_node);
+			hlist_add_head(&entry->hash_node,
+				&cache->hash[hash_64(block, cache->hash_bits)]);
 			entry->block = block;
 			entry->refcount = 1;
 			entry->pending = 1;
@@ -137,9 +168,11 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * previously unused there's one less cache entry available
 		 * for reuse.
 		 */
-		entry = &cache->entry[i];
-		if (entry->refcount == 0)
+		cache->hits++;
+		if (entry->refcount == 0) {
 			cache->unused--;
+			list_del_init(&entry->lru);
+		}
 		entry->refcount++;
 
 		/*
@@ -157,8 +190,9 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	}
 
 out:
-	TRACE("Got %s %d, start block %lld, refcount %d, error %d\n",
-		cache->name, i, entry->block, entry->refcount, entry->error);
+	TRACE("Got %s %td, start block %lld, refcount %d, error %d\n",
+		cache->name, entry - cache->entry, entry->block,
+		entry->refcount, entry->error);
 
 	if (entry->error)
 		ERROR("Unable to read %s cache entry [%llx]\n", cache->name,
@@ -178,6 +212,7 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 	entry->refcount--;
 	if (entry->refcount == 0) {
 		cache->unused++;
+		list_add_tail(&entry->lru, &cache->lru[entry->node]);
 		/*
 		 * If there's any processes waiting for a block to become
 		 * available, wake one up.
@@ -211,6 +246,8 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 	}
 
 	kfree(cache->entry);
+	kfree(cache->hash);
+	kfree(cache->lru);
 	kfree(cache);
 }
 
@@ -218,12 +255,14 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 /*
  * Initialise cache allocating the specified number of entries, each of
  * size block_size.  To avoid vmalloc fragmentation issues each entry
- * is allocated as a sequence of kmalloced PAGE_SIZE buffers.
+ * is allocated as a sequence of kmalloced PAGE_SIZE buffers.  Entries are
+ * spread round-robin over the online nodes, and each node keeps its own
+ * LRU list of unused entries.
  */
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	int block_size)
 {
-	int i, j;
+	int i, j, node = first_online_node;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -237,8 +276,18 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		goto cleanup;
 	}
 
-	cache->curr_blk = 0;
-	cache->next_blk = 0;
+	cache->hash_bits = max_t(unsigned int, order_base_2(entries), 1);
+	cache->hash = kcalloc(1 << cache->hash_bits, sizeof(*cache->hash),
+		GFP_KERNEL);
+	cache->lru = kcalloc(nr_node_ids, sizeof(*cache->lru), GFP_KERNEL);
+	if (cache->hash == NULL || cache->lru == NULL) {
+		ERROR("Failed to allocate %s cache\n", name);
+		goto cleanup;
+	}
+
+	for (i = 0; i < nr_node_ids; i++)
+		INIT_LIST_HEAD(&cache->lru[i]);
+
 	cache->unused = entries;
 	cache->entries = entries;
 	cache->block_size = block_size;
@@ -255,6 +304,11 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		init_waitqueue_head(&cache->entry[i].wait_queue);
 		entry->cache = cache;
 		entry->block = SQUASHFS_INVALID_BLK;
+		INIT_HLIST_NODE(&entry->hash_node);
+		entry->node = node;
+		list_add_tail(&entry->lru, &cache->lru[node]);
+		node = next_node_in(node, node_online_map);
+
 		entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
 		if (entry->data == NULL) {
 			ERROR("Failed to allocate %s cache entry\n", name);
@@ -262,7 +316,8 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		}
 
 		for (j = 0; j < cache->pages; j++) {
-			entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
+			entry->data[j] = kmalloc_node(PAGE_SIZE, GFP_KERNEL,
+							entry->node);
 			if (entry->data[j] == NULL) {
 				ERROR("Failed to allocate %s buffer\n", name);
 				goto cleanup;
@@ -285,6 +340,27 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 }
 
 
+/*
+ * Report cache size and hit/miss counters, for /proc/self/mountstats.
+ */
+void squashfs_cache_show_stats(struct seq_file *m,
+	struct squashfs_cache *cache)
+{
+	unsigned long hits, misses;
+
+	if (cache == NULL)
+		return;
+
+	spin_lock(&cache->lock);
+	hits = cache->hits;
+	misses = cache->misses;
+	spin_unlock(&cache->lock);
+
+	seq_printf(m, "\n\t%s cache: entries %d hits %lu misses %lu",
+		cache->name, cache->entries, hits, misses);
+}
+
+
 /*
  * Copy up to length bytes from cache entry to buffer starting at offset bytes
  * into the cache entry.  If there's not length bytes then copy the number of
@@ -494,7 +494,68 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/*
+ * Grab the pages of every datablock covered by the readahead window up
+ * front and hand each block to its own work item, so the reads are issued
+ * and decompressed in parallel.  The first block is decompressed here once
+ * the others are queued.  Fragments, sparse blocks and partially cached
+ * blocks go through squashfs_readpage() as before.
+ */
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned int nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	struct squashfs_ra_block *first = NULL, *rab;
+
+	while (!list_empty(pages)) {
+		struct page *page = lru_to_page(pages);
+		int index = page->index >> shift;
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					readahead_gfp_mask(mapping))) {
+			put_page(page);
+			continue;
+		}
+
+		rab = NULL;
+		if (index < file_end || squashfs_i(inode)->fragment_block ==
+					SQUASHFS_INVALID_BLK) {
+			int expected = index == file_end ?
+				(i_size_read(inode) & (msblk->block_size - 1)) :
+				 msblk->block_size;
+			u64 block = 0;
+			int bsize = read_blocklist(inode, index, &block);
+
+			if (bsize > 0)
+				rab = squashfs_readahead_prepare(page, block,
+							bsize, expected);
+		}
+
+		if (rab == NULL) {
+			squashfs_readpage(file, page);
+			put_page(page);
+		} else if (first == NULL)
+			first = rab;
+		else
+			squashfs_readahead_submit(rab, false);
+	}
+
+	if (first)
+		squashfs_readahead_submit(first, true);
+
+	return 0;
+}
+#endif
+
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readpages = squashfs_readpages,
+#endif
 };
@@ -34,3 +34,13 @@ int squashfs_readpage_block(struct page *page, u64 block, int bsize, int expecte
 	squashfs_cache_put(buffer);
 	return res;
 }
+
+/* Readahead is only done when decompressing directly into the page cache */
+int __init squashfs_readahead_init(void)
+{
+	return 0;
+}
+
+void squashfs_readahead_exit(void)
+{
+}
@@ -11,6 +11,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -21,41 +22,31 @@
 static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
 	int pages, struct page **page, int bytes);
 
-/* Read separately compressed datablock directly into page cache */
-int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
-	int expected)
-
-{
-	struct inode *inode = target_page->mapping->host;
-	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
-
-	int file_end = (i_size_read(inode) - 1) >> PAGE_SHIFT;
-	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
-	int start_index = target_page->index & ~mask;
-	int end_index = start_index | mask;
-	int i, n, pages, missing_pages, bytes, res = -ENOMEM;
-	struct page **page;
+/*
+ * Readahead of one datablock.  The pages are grabbed by the caller of
+ * squashfs_readahead_prepare(), the block is then read and decompressed
+ * either inline or by a work item, which lets a single reader keep several
+ * decompressors busy.
+ */
+struct squashfs_ra_block {
+	struct work_struct	work;
+	struct inode		*inode;
 	struct squashfs_page_actor *actor;
-	void *pageaddr;
+	u64			block;
+	int			bsize;
+	int			expected;
+	int			pages;
+	struct page		*page[];
+};
 
-	if (end_index > file_end)
-		end_index = file_end;
+static struct workqueue_struct *squashfs_ra_wq;
 
-	pages = end_index - start_index + 1;
-
-	page = kmalloc_array(pages, sizeof(void *), GFP_KERNEL);
-	if (page == NULL)
-		return res;
-
-	/*
-	 * Create a "page actor" which will kmap and kunmap the
-	 * page cache pages appropriately within the decompressor
-	 */
-	actor = squashfs_page_actor_init_special(page, pages, 0);
-	if (actor == NULL)
-		goto out;
+/* Grab the pages covered by a Squashfs block, return how many are missing */
+static int squashfs_grab_pages(struct page *target_page, struct page **page,
+	int start_index, int pages)
+{
+	int i, n, missing_pages;
 
-	/* Try to grab all the pages covered by the Squashfs block */
 	for (missing_pages = 0, i = 0, n = start_index; i < pages; i++, n++) {
 		page[i] = (n == target_page->index) ? target_page :
 			grab_cache_page_nowait(target_page->mapping, n);
@@ -73,21 +64,20 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 		}
 	}
 
-	if (missing_pages) {
-		/*
-		 * Couldn't get one or more pages, this page has either
-		 * been VM reclaimed, but others are still in the page cache
-		 * and uptodate, or we're racing with another thread in
-		 * squashfs_readpage also trying to grab them.  Fall back to
-		 * using an intermediate buffer.
-		 */
-		res = squashfs_read_cache(target_page, block, bsize, pages,
-							page, expected);
-		if (res < 0)
-			goto mark_errored;
+	return missing_pages;
+}
 
-		goto out;
-	}
+/*
+ * Decompress a block directly into the grabbed page cache pages, then mark
+ * them uptodate (or errored), unlock and release them.  On failure
+ * target_page, if any, is left locked for the caller to deal with.
+ */
+static int squashfs_decompress_pages(struct inode *inode, u64 block,
+	int bsize, int expected, struct page *target_page, struct page **page,
+	int pages, struct squashfs_page_actor *actor)
+{
+	int i, bytes, res;
+	void *pageaddr;
 
 	/* Decompress directly into the page cache buffers */
 	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
@@ -116,11 +106,78 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 			put_page(page[i]);
 	}
 
-	kfree(actor);
-	kfree(page);
-
 	return 0;
 
+mark_errored:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+		flush_dcache_page(page[i]);
+		SetPageError(page[i]);
+		unlock_page(page[i]);
+		put_page(page[i]);
+	}
+
+	return res;
+}
+
+/* Read separately compressed datablock directly into page cache */
+int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
+	int expected)
+
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+
+	int file_end = (i_size_read(inode) - 1) >> PAGE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, pages, missing_pages, res = -ENOMEM;
+	struct page **page;
+	struct squashfs_page_actor *actor;
+
+	if (end_index > file_end)
+		end_index = file_end;
+
+	pages = end_index - start_index + 1;
+
+	page = kmalloc_array(pages, sizeof(void *), GFP_KERNEL);
+	if (page == NULL)
+		return res;
+
+	/*
+	 * Create a "page actor" which will kmap and kunmap the
+	 * page cache pages appropriately within the decompressor
+	 */
+	actor = squashfs_page_actor_init_special(page, pages, 0);
+	if (actor == NULL)
+		goto out;
+
+	/* Try to grab all the pages covered by the Squashfs block */
+	missing_pages = squashfs_grab_pages(target_page, page, start_index,
+						pages);
+
+	if (missing_pages) {
+		/*
+		 * Couldn't get one or more pages, this page has either
+		 * been VM reclaimed, but others are still in the page cache
+		 * and uptodate, or we're racing with another thread in
+		 * squashfs_readpage also trying to grab them.  Fall back to
+		 * using an intermediate buffer.
+		 */
+		res = squashfs_read_cache(target_page, block, bsize, pages,
+							page, expected);
+		if (res < 0)
+			goto mark_errored;
+
+		goto out;
+	}
+
+	res = squashfs_decompress_pages(inode, block, bsize, expected,
+				target_page, page, pages, actor);
+	goto out;
+
 mark_errored:
 	/* Decompression failed, mark pages as errored.  Target_page is
 	 * dealt with by the caller
@@ -141,6 +198,105 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 }
 
 
+/*
+ * Nothing may touch the inode once its pages are unlocked, eviction only
+ * waits for those.
+ */
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_ra_block *rab = container_of(work,
+					struct squashfs_ra_block, work);
+	int res = squashfs_decompress_pages(rab->inode, rab->block, rab->bsize,
+				rab->expected, NULL, rab->page, rab->pages,
+				rab->actor);
+
+	if (res < 0)
+		ERROR("Unable to read ahead, block %llx, size %x\n",
+			rab->block, rab->bsize);
+
+	kfree(rab->actor);
+	kfree(rab);
+}
+
+
+/*
+ * Grab all the pages of the datablock containing page, which must be
+ * locked in the page cache.  Returns NULL if that isn't possible, in
+ * which case the page is left untouched for squashfs_readpage().
+ */
+struct squashfs_ra_block *squashfs_readahead_prepare(struct page *page,
+	u64 block, int bsize, int expected)
+{
+	struct inode *inode = page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
+	int start_index = page->index & ~mask;
+	int end_index = start_index | mask;
+	struct squashfs_ra_block *rab;
+	int i, pages;
+
+	if (end_index > file_end)
+		end_index = file_end;
+
+	pages = end_index - start_index + 1;
+
+	rab = kmalloc(struct_size(rab, page, pages), GFP_KERNEL);
+	if (rab == NULL)
+		return NULL;
+
+	rab->actor = squashfs_page_actor_init_special(rab->page, pages, 0);
+	if (rab->actor == NULL)
+		goto failed;
+
+	if (squashfs_grab_pages(page, rab->page, start_index, pages)) {
+		for (i = 0; i < pages; i++) {
+			if (rab->page[i] == NULL || rab->page[i] == page)
+				continue;
+			unlock_page(rab->page[i]);
+			put_page(rab->page[i]);
+		}
+		goto failed;
+	}
+
+	INIT_WORK(&rab->work, squashfs_readahead_work);
+	rab->inode = inode;
+	rab->block = block;
+	rab->bsize = bsize;
+	rab->expected = expected;
+	rab->pages = pages;
+	return rab;
+
+failed:
+	kfree(rab->actor);
+	kfree(rab);
+	return NULL;
+}
+
+
+void squashfs_readahead_submit(struct squashfs_ra_block *rab, bool wait)
+{
+	if (wait)
+		squashfs_readahead_work(&rab->work);
+	else
+		queue_work(squashfs_ra_wq, &rab->work);
+}
+
+
+int __init squashfs_readahead_init(void)
+{
+	squashfs_ra_wq = alloc_workqueue("squashfs_ra",
+				WQ_UNBOUND | WQ_HIGHPRI | WQ_CPU_INTENSIVE, 0);
+	return squashfs_ra_wq ? 0 : -ENOMEM;
+}
+
+
+void squashfs_readahead_exit(void)
+{
+	destroy_workqueue(squashfs_ra_wq);
+}
+
+
 static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
 	int pages, struct page **page, int bytes)
 {
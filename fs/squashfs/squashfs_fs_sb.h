@@ -15,19 +15,25 @@
 struct squashfs_cache {
 	char			*name;
 	int			entries;
-	int			curr_blk;
-	int			next_blk;
 	int			num_waiters;
 	int			unused;
 	int			block_size;
 	int			pages;
+	unsigned int		hash_bits;
+	unsigned long		hits;
+	unsigned long		misses;
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
+	struct hlist_head	*hash;
+	struct list_head	*lru;
 	struct squashfs_cache_entry *entry;
 };
 
 struct squashfs_cache_entry {
 	u64			block;
+	struct hlist_node	hash_node;
+	struct list_head	lru;
+	int			node;
 	int			length;
 	int			refcount;
 	u64			next_index;
@@ -65,4 +71,10 @@ struct squashfs_sb_info {
 	unsigned int				fragments;
 	int					xattr_ids;
 };
+
+/* Cache sizes requested at mount time, 0 means the default */
+struct squashfs_mount_opts {
+	unsigned int				metadata_cache;
+	unsigned int				fragment_cache;
+};
 #endif
@@ -18,6 +18,7 @@
 
 #include <linux/fs.h>
 #include <linux/fs_context.h>
+#include <linux/fs_parser.h>
 #include <linux/vfs.h>
 #include <linux/slab.h>
 #include <linux/mutex.h>
@@ -26,6 +27,8 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/seq_file.h>
+#include <linux/nodemask.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -67,6 +70,7 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(
 
 static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 {
+	struct squashfs_mount_opts *opts = fc->fs_private;
 	struct squashfs_sb_info *msblk;
 	struct squashfs_super_block *sblk = NULL;
 	struct inode *root;
@@ -193,8 +197,14 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 
 	err = -ENOMEM;
 
+	/*
+	 * Unless sized explicitly, scale the metadata and fragment caches with
+	 * the number of nodes, so that each node's LRU holds the default.
+	 */
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			opts->metadata_cache ? :
+			SQUASHFS_CACHED_BLKS * num_online_nodes(),
+			SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -270,7 +280,9 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts->fragment_cache ? :
+		SQUASHFS_CACHED_FRAGMENTS * num_online_nodes(),
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -343,6 +355,48 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	return err;
 }
 
+enum squashfs_param {
+	Opt_metadata_cache,
+	Opt_fragment_cache,
+};
+
+static const struct fs_parameter_spec squashfs_fs_parameters[] = {
+	fsparam_u32("metadata_cache",	Opt_metadata_cache),
+	fsparam_u32("fragment_cache",	Opt_fragment_cache),
+	{}
+};
+
+static int squashfs_parse_param(struct fs_context *fc,
+				struct fs_parameter *param)
+{
+	struct squashfs_mount_opts *opts = fc->fs_private;
+	struct fs_parse_result result;
+	int opt;
+
+	opt = fs_parse(fc, squashfs_fs_parameters, param, &result);
+	if (opt < 0)
+		return opt;
+
+	/* Cache sizes can't be changed on remount */
+	if (fc->purpose == FS_CONTEXT_FOR_RECONFIGURE)
+		return 0;
+
+	if (result.uint_32 == 0 || result.uint_32 > SQUASHFS_MAX_CACHED_BLKS)
+		return invalfc(fc, "%s must be between 1 and %d", param->key,
+			       SQUASHFS_MAX_CACHED_BLKS);
+
+	switch (opt) {
+	case Opt_metadata_cache:
+		opts->metadata_cache = result.uint_32;
+		break;
+	case Opt_fragment_cache:
+		opts->fragment_cache = result.uint_32;
+		break;
+	}
+
+	return 0;
+}
+
 static int squashfs_get_tree(struct fs_context *fc)
 {
 	return get_tree_bdev(fc, squashfs_fill_super);
@@ -355,17 +409,42 @@ static int squashfs_reconfigure(struct fs_context *fc)
 	return 0;
 }
 
+static void squashfs_free_fs_context(struct fs_context *fc)
+{
+	kfree(fc->fs_private);
+}
+
 static const struct fs_context_operations squashfs_context_ops = {
+	.parse_param	= squashfs_parse_param,
 	.get_tree	= squashfs_get_tree,
 	.reconfigure	= squashfs_reconfigure,
+	.free		= squashfs_free_fs_context,
 };
 
 static int squashfs_init_fs_context(struct fs_context *fc)
 {
+	struct squashfs_mount_opts *opts;
+
+	opts = kzalloc(sizeof(*opts), GFP_KERNEL);
+	if (!opts)
+		return -ENOMEM;
+
+	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
 }
 
+static int squashfs_show_stats(struct seq_file *m, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	squashfs_cache_show_stats(m, msblk->block_cache);
+	squashfs_cache_show_stats(m, msblk->fragment_cache);
+	squashfs_cache_show_stats(m, msblk->read_page);
+	return 0;
+}
+
+
 static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 {
 	struct squashfs_sb_info *msblk = dentry->d_sb->s_fs_info;
@@ -445,8 +524,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_readahead_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_readahead_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -460,6 +546,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_readahead_exit();
 	destroy_inodecache();
 }
 
@@ -482,6 +569,7 @@ static struct file_system_type squashfs_fs_type = {
 	.owner = THIS_MODULE,
 	.name = "squashfs",
 	.init_fs_context = squashfs_init_fs_context,
+	.parameters = squashfs_fs_parameters,
 	.kill_sb = kill_block_super,
 	.fs_flags = FS_REQUIRES_DEV
 };
@@ -491,6 +579,7 @@ static const struct super_operations squashfs_super_ops = {
 	.alloc_inode = squashfs_alloc_inode,
 	.free_inode = squashfs_free_inode,
 	.statfs = squashfs_statfs,
+	.show_stats = squashfs_show_stats,
 	.put_super = squashfs_put_super,
 };
 
@@ -32,6 +32,9 @@ struct ahash_request;
  */
 #define FS_VERITY_MAX_DIGEST_SIZE	SHA512_DIGEST_SIZE
 
+/* Maximum number of data pages whose hashes are computed concurrently */
+#define FS_VERITY_HASH_BATCH		8
+
 /* A hash algorithm supported by fs-verity */
 struct fsverity_hash_alg {
 	struct crypto_ahash *tfm; /* hash tfm, allocated on demand */
@@ -128,6 +131,10 @@ const u8 *fsverity_prepare_hash_state(struct fsverity_hash_alg *alg,
 int fsverity_hash_page(const struct merkle_tree_params *params,
 		       const struct inode *inode,
 		       struct ahash_request *req, struct page *page, u8 *out);
+int fsverity_hash_pages(const struct merkle_tree_params *params,
+			const struct inode *inode,
+			struct ahash_request **reqs, struct page **pages,
+			u8 (*outs)[FS_VERITY_MAX_DIGEST_SIZE], unsigned int nr);
 int fsverity_hash_buffer(struct fsverity_hash_alg *alg,
 			 const void *data, size_t size, u8 *out);
 void __init fsverity_check_hash_algs(void);
@@ -266,6 +266,67 @@ int fsverity_hash_page(const struct merkle_tree_params *params,
 	return err;
 }
 
+/**
+ * fsverity_hash_pages() - hash several data or hash pages concurrently
+ * @params: the Merkle tree's parameters
+ * @inode: inode for which the hashing is being done
+ * @reqs: preallocated hash requests, one per page
+ * @pages: the pages to hash
+ * @outs: output digests, one per page
+ * @nr: number of pages, at most FS_VERITY_HASH_BATCH
+ *
+ * Like fsverity_hash_page(), but all the requests are started before any is
+ * waited for, so that an asynchronous or multi-buffer hash implementation can
+ * work on them in parallel.  Synchronous implementations just hash the pages
+ * one after another.
+ *
+ * Return: 0 on success, -errno if hashing any of the pages failed
+ */
+int fsverity_hash_pages(const struct merkle_tree_params *params,
+			const struct inode *inode,
+			struct ahash_request **reqs, struct page **pages,
+			u8 (*outs)[FS_VERITY_MAX_DIGEST_SIZE], unsigned int nr)
+{
+	struct scatterlist sgs[FS_VERITY_HASH_BATCH];
+	struct crypto_wait waits[FS_VERITY_HASH_BATCH];
+	int errs[FS_VERITY_HASH_BATCH];
+	unsigned int i;
+	int err = 0;
+
+	if (WARN_ON(params->block_size != PAGE_SIZE ||
+		    nr > FS_VERITY_HASH_BATCH))
+		return -EINVAL;
+
+	for (i = 0; i < nr; i++) {
+		crypto_init_wait(&waits[i]);
+		sg_init_table(&sgs[i], 1);
+		sg_set_page(&sgs[i], pages[i], PAGE_SIZE, 0);
+		ahash_request_set_callback(reqs[i], CRYPTO_TFM_REQ_MAY_SLEEP |
+						    CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   crypto_req_done, &waits[i]);
+		ahash_request_set_crypt(reqs[i], &sgs[i], outs[i], PAGE_SIZE);
+
+		if (params->hashstate) {
+			errs[i] = crypto_ahash_import(reqs[i],
+						      params->hashstate);
+			if (!errs[i])
+				errs[i] = crypto_ahash_finup(reqs[i]);
+		} else {
+			errs[i] = crypto_ahash_digest(reqs[i]);
+		}
+	}
+
+	for (i = 0; i < nr; i++) {
+		errs[i] = crypto_wait_req(errs[i], &waits[i]);
+		if (errs[i] && !err) {
+			fsverity_err(inode, "Error %d computing page hash",
+				     errs[i]);
+			err = errs[i];
+		}
+	}
+	return err;
+}
+
 /**
  * fsverity_hash_buffer() - hash some data
  * @alg: the hash algorithm to use
@@ -67,7 +67,26 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
 }
 
 /*
- * Verify a single data page against the file's Merkle tree.
+ * The level 0 hash page used last while verifying a batch of data pages.  Most
+ * consecutive data pages share it, so it is looked up and checked only once;
+ * it is only ever cached once it has been verified.
+ */
+struct fsverity_leaf_cache {
+	struct page *hpage;
+	pgoff_t hindex;
+};
+
+static void cache_leaf_page(struct fsverity_leaf_cache *leaf,
+			    struct page *hpage, pgoff_t hindex)
+{
+	if (leaf->hpage)
+		put_page(leaf->hpage);
+	leaf->hpage = hpage;
+	leaf->hindex = hindex;
+}
+
+/*
+ * Find the hash that a data page must have.
  *
  * In principle, we need to verify the entire path to the root node.  However,
  * for efficiency the filesystem may cache the hash pages.  Therefore we need
@@ -81,27 +100,21 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
  * Note that multiple processes may race to verify a hash page and mark it
  * Checked, but it doesn't matter; the result will be the same either way.
  *
- * Return: true if the page is valid, else false.
+ * Return: 0 with the wanted hash in @want_hash, else -errno.
  */
-static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
-			struct ahash_request *req, struct page *data_page,
-			unsigned long level0_ra_pages)
+static int find_want_hash(struct inode *inode, const struct fsverity_info *vi,
+			  struct ahash_request *req, pgoff_t index,
+			  unsigned long level0_ra_pages,
+			  struct fsverity_leaf_cache *leaf, u8 *want_hash)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
-	const pgoff_t index = data_page->index;
 	int level;
-	u8 _want_hash[FS_VERITY_MAX_DIGEST_SIZE];
-	const u8 *want_hash;
 	u8 real_hash[FS_VERITY_MAX_DIGEST_SIZE];
 	struct page *hpages[FS_VERITY_MAX_LEVELS];
 	unsigned int hoffsets[FS_VERITY_MAX_LEVELS];
-	int err;
-
-	if (WARN_ON_ONCE(!PageLocked(data_page) || PageUptodate(data_page)))
-		return false;
-
-	pr_debug_ratelimited("Verifying data page %lu...\n", index);
+	pgoff_t leaf_hindex = 0;
+	int err = 0;
 
 	/*
 	 * Starting at the leaf level, ascend the tree saving hash pages along
@@ -118,6 +131,15 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		pr_debug_ratelimited("Level %d: hindex=%lu, hoffset=%u\n",
 				     level, hindex, hoffset);
 
+		if (level == 0) {
+			if (leaf && leaf->hpage && leaf->hindex == hindex) {
+				extract_hash(leaf->hpage, hoffset, hsize,
+					     want_hash);
+				return 0;
+			}
+			leaf_hindex = hindex;
+		}
+
 		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
 				level == 0 ? level0_ra_pages : 0);
 		if (IS_ERR(hpage)) {
@@ -129,9 +151,11 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		}
 
 		if (PageChecked(hpage)) {
-			extract_hash(hpage, hoffset, hsize, _want_hash);
-			want_hash = _want_hash;
-			put_page(hpage);
+			extract_hash(hpage, hoffset, hsize, want_hash);
+			if (level == 0 && leaf)
+				cache_leaf_page(leaf, hpage, hindex);
+			else
+				put_page(hpage);
 			pr_debug_ratelimited("Hash page already checked, want %s:%*phN\n",
 					     params->hash_alg->name,
 					     hsize, want_hash);
@@ -142,7 +166,7 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		hoffsets[level] = hoffset;
 	}
 
-	want_hash = vi->root_hash;
+	memcpy(want_hash, vi->root_hash, hsize);
 	pr_debug("Want root hash: %s:%*phN\n",
 		 params->hash_alg->name, hsize, want_hash);
 descend:
@@ -158,23 +182,51 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		if (err)
 			goto out;
 		SetPageChecked(hpage);
-		extract_hash(hpage, hoffset, hsize, _want_hash);
-		want_hash = _want_hash;
-		put_page(hpage);
+		extract_hash(hpage, hoffset, hsize, want_hash);
+		if (level == 1 && leaf)
+			cache_leaf_page(leaf, hpage, leaf_hindex);
+		else
+			put_page(hpage);
 		pr_debug("Verified hash page at level %d, now want %s:%*phN\n",
 			 level - 1, params->hash_alg->name, hsize, want_hash);
 	}
-
-	/* Finally, verify the data page */
-	err = fsverity_hash_page(params, inode, req, data_page, real_hash);
-	if (err)
-		goto out;
-	err = cmp_hashes(vi, want_hash, real_hash, index, -1);
 out:
 	for (; level > 0; level--)
 		put_page(hpages[level - 1]);
 
-	return err == 0;
+	return err;
+}
+
+/*
+ * Verify a single data page against the file's Merkle tree.
+ *
+ * Return: true if the page is valid, else false.
+ */
+static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
+			struct ahash_request *req, struct page *data_page,
+			unsigned long level0_ra_pages)
+{
+	const struct merkle_tree_params *params = &vi->tree_params;
+	const pgoff_t index = data_page->index;
+	u8 want_hash[FS_VERITY_MAX_DIGEST_SIZE];
+	u8 real_hash[FS_VERITY_MAX_DIGEST_SIZE];
+	int err;
+
+	if (WARN_ON_ONCE(!PageLocked(data_page) || PageUptodate(data_page)))
+		return false;
+
+	pr_debug_ratelimited("Verifying data page %lu...\n", index);
+
+	err = find_want_hash(inode, vi, req, index, level0_ra_pages, NULL,
+			     want_hash);
+	if (err)
+		return false;
+
+	err = fsverity_hash_page(params, inode, req, data_page, real_hash);
+	if (err)
+		return false;
+
+	return cmp_hashes(vi, want_hash, real_hash, index, -1) == 0;
 }
 
 /**
@@ -204,6 +256,81 @@ bool fsverity_verify_page(struct page *page)
 EXPORT_SYMBOL_GPL(fsverity_verify_page);
 
 #ifdef CONFIG_BLOCK
+/*
+ * Data pages of a bio whose wanted hashes are known, waiting to be hashed
+ * together by fsverity_hash_pages()
+ */
+struct fsverity_verify_batch {
+	struct ahash_request *reqs[FS_VERITY_HASH_BATCH];
+	struct page *pages[FS_VERITY_HASH_BATCH];
+	u8 want_hashes[FS_VERITY_HASH_BATCH][FS_VERITY_MAX_DIGEST_SIZE];
+	u8 real_hashes[FS_VERITY_HASH_BATCH][FS_VERITY_MAX_DIGEST_SIZE];
+	unsigned int max;	/* number of hash requests available */
+	unsigned int nr;	/* number of pages queued */
+	struct fsverity_leaf_cache leaf;
+};
+
+static struct fsverity_verify_batch *
+alloc_verify_batch(const struct merkle_tree_params *params,
+		   struct ahash_request *req)
+{
+	struct fsverity_verify_batch *batch;
+	struct ahash_request *extra;
+
+	batch = kmalloc(sizeof(*batch), GFP_NOFS);
+	if (!batch)
+		return NULL;
+
+	/*
+	 * Only the first request comes from the mempool; the others are just
+	 * opportunistic, since needing several mempool requests at a time
+	 * could deadlock.
+	 */
+	batch->reqs[0] = req;
+	for (batch->max = 1; batch->max < FS_VERITY_HASH_BATCH; batch->max++) {
+		extra = ahash_request_alloc(params->hash_alg->tfm,
+					    GFP_NOFS | __GFP_NOWARN);
+		if (!extra)
+			break;
+		batch->reqs[batch->max] = extra;
+	}
+	batch->nr = 0;
+	batch->leaf.hpage = NULL;
+	return batch;
+}
+
+static void free_verify_batch(struct fsverity_verify_batch *batch)
+{
+	unsigned int i;
+
+	if (batch->leaf.hpage)
+		put_page(batch->leaf.hpage);
+	for (i = 1; i < batch->max; i++)
+		ahash_request_free(batch->reqs[i]);
+	kfree(batch);
+}
+
+static void flush_verify_batch(struct inode *inode,
+			       const struct fsverity_info *vi,
+			       struct fsverity_verify_batch *batch)
+{
+	unsigned int i;
+	int err;
+
+	if (!batch->nr)
+		return;
+
+	err = fsverity_hash_pages(&vi->tree_params, inode, batch->reqs,
+				  batch->pages, batch->real_hashes, batch->nr);
+	for (i = 0; i < batch->nr; i++) {
+		if (err || cmp_hashes(vi, batch->want_hashes[i],
+				      batch->real_hashes[i],
+				      batch->pages[i]->index, -1))
+			SetPageError(batch->pages[i]);
+	}
+	batch->nr = 0;
+}
+
 /**
  * fsverity_verify_bio() - verify a 'read' bio that has just completed
  *
@@ -223,6 +350,7 @@ void fsverity_verify_bio(struct bio *bio)
 	struct inode *inode = bio_first_page_all(bio)->mapping->host;
 	const struct fsverity_info *vi = inode->i_verity_info;
 	const struct merkle_tree_params *params = &vi->tree_params;
+	struct fsverity_verify_batch *batch;
 	struct ahash_request *req;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
@@ -246,15 +374,43 @@ void fsverity_verify_bio(struct bio *bio)
 		max_ra_pages /= 4;
 	}
 
+	/*
+	 * Verify the pages in batches: first find the wanted hash of each
+	 * page, which mostly comes from the same leaf hash page, then hash
+	 * the data pages of the batch concurrently.
+	 */
+	batch = alloc_verify_batch(params, req);
+
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
 		unsigned long level0_index = page->index >> params->log_arity;
 		unsigned long level0_ra_pages =
 			min(max_ra_pages, params->level0_blocks - level0_index);
 
-		if (!PageError(page) &&
-		    !verify_page(inode, vi, req, page, level0_ra_pages))
+		if (PageError(page))
+			continue;
+
+		if (!batch) {
+			if (!verify_page(inode, vi, req, page, level0_ra_pages))
+				SetPageError(page);
+			continue;
+		}
+
+		if (WARN_ON_ONCE(!PageLocked(page) || PageUptodate(page)) ||
+		    find_want_hash(inode, vi, req, page->index,
+				   level0_ra_pages, &batch->leaf,
+				   batch->want_hashes[batch->nr])) {
 			SetPageError(page);
+			continue;
+		}
+		batch->pages[batch->nr++] = page;
+		if (batch->nr == batch->max)
+			flush_verify_batch(inode, vi, batch);
+	}
+
+	if (batch) {
+		flush_verify_batch(inode, vi, batch);
+		free_verify_batch(batch);
 	}
 
 	fsverity_free_hash_request(params->hash_alg, req);
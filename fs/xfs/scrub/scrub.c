@@ -565,3 +565,142 @@ xfs_scrub_metadata(
 	}
 	return error;
 }
+
+/*
+ * Batched scrubbing
+ *
+ * The per-AG scrubbers lock only the headers of the AG they check (plus
+ * higher AGs in order for cross-referencing), so requests for different
+ * AGs can run at the same time.  A batch hands an array of requests to
+ * a bounded number of workers, each of which takes the next unclaimed
+ * request until the array is exhausted.  Callers get the most overlap
+ * by ordering the array so that neighbouring requests target different
+ * AGs, e.g. all bnobt checks for AG 0..N, then all cntbt checks, and so
+ * on.  Requests for the same AG simply serialize on its header locks.
+ *
+ * The results of each request are written back to its own entry.  The
+ * first operational error stops the batch; entries that were never
+ * started are left untouched.  @throttle_ms, if nonzero, makes every
+ * worker pause between requests so that a scrub running during
+ * production hours leaves some I/O bandwidth to everyone else.
+ */
+
+/* Never run more than this many requests of one batch concurrently. */
+#define XCHK_BATCH_MAX_WORKERS	16
+
+struct xchk_batch {
+	struct xfs_inode		*ip;
+	struct xfs_scrub_metadata	*sms;
+	unsigned int			nr;
+	unsigned int			throttle_ms;
+	atomic_t			next;
+	atomic_t			done;
+	bool				aborted;
+};
+
+struct xchk_batch_worker {
+	struct work_struct		work;
+	struct xchk_batch		*batch;
+	int				error;
+};
+
+STATIC int
+xchk_batch_run(
+	struct xchk_batch		*batch)
+{
+	struct xfs_scrub_metadata	*sm;
+	unsigned int			i;
+	int				error;
+
+	while (!READ_ONCE(batch->aborted)) {
+		/*
+		 * Only the calling thread can see a fatal signal, so it is
+		 * the one that stops the workers from starting more requests.
+		 */
+		if (fatal_signal_pending(current)) {
+			WRITE_ONCE(batch->aborted, true);
+			return -EINTR;
+		}
+
+		i = atomic_inc_return(&batch->next) - 1;
+		if (i >= batch->nr)
+			break;
+
+		sm = &batch->sms[i];
+		error = xfs_scrub_metadata(batch->ip, sm);
+		if (error) {
+			WRITE_ONCE(batch->aborted, true);
+			return error;
+		}
+
+		trace_xchk_batch_progress(batch->ip, sm,
+				atomic_inc_return(&batch->done), batch->nr);
+
+		if (batch->throttle_ms)
+			msleep_interruptible(batch->throttle_ms);
+	}
+
+	return 0;
+}
+
+STATIC void
+xchk_batch_worker(
+	struct work_struct		*work)
+{
+	struct xchk_batch_worker	*w;
+
+	w = container_of(work, struct xchk_batch_worker, work);
+	w->error = xchk_batch_run(w->batch);
+}
+
+/* Run an array of scrub requests on up to @workers threads. */
+int
+xfs_scrub_metadata_batch(
+	struct xfs_inode		*ip,
+	struct xfs_scrub_metadata	*sms,
+	unsigned int			nr,
+	unsigned int			workers,
+	unsigned int			throttle_ms)
+{
+	struct xchk_batch		batch = {
+		.ip			= ip,
+		.sms			= sms,
+		.nr			= nr,
+		.throttle_ms		= throttle_ms,
+		.next			= ATOMIC_INIT(0),
+		.done			= ATOMIC_INIT(0),
+	};
+	struct xchk_batch_worker	*w = NULL;
+	unsigned int			i;
+	int				error;
+
+	if (!nr)
+		return 0;
+
+	workers = clamp_t(unsigned int, workers, 1,
+			  min_t(unsigned int, nr, XCHK_BATCH_MAX_WORKERS));
+
+	/* The calling thread is one of the workers. */
+	if (workers > 1) {
+		w = kmem_zalloc((workers - 1) * sizeof(*w), KM_MAYFAIL);
+		if (!w)
+			workers = 1;
+	}
+
+	for (i = 0; i < workers - 1; i++) {
+		w[i].batch = &batch;
+		INIT_WORK(&w[i].work, xchk_batch_worker);
+		queue_work(system_unbound_wq, &w[i].work);
+	}
+
+	error = xchk_batch_run(&batch);
+
+	for (i = 0; i < workers - 1; i++) {
+		flush_work(&w[i].work);
+		if (!error)
+			error = w[i].error;
+	}
+
+	kmem_free(w);
+	return error;
+}
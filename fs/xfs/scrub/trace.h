@@ -125,6 +125,35 @@ DEFINE_SCRUB_EVENT(xchk_deadlock_retry);
 DEFINE_SCRUB_EVENT(xrep_attempt);
 DEFINE_SCRUB_EVENT(xrep_done);
 
+TRACE_EVENT(xchk_batch_progress,
+	TP_PROTO(struct xfs_inode *ip, struct xfs_scrub_metadata *sm,
+		 unsigned int done, unsigned int nr),
+	TP_ARGS(ip, sm, done, nr),
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(unsigned int, type)
+		__field(xfs_agnumber_t, agno)
+		__field(unsigned int, flags)
+		__field(unsigned int, done)
+		__field(unsigned int, nr)
+	),
+	TP_fast_assign(
+		__entry->dev = ip->i_mount->m_super->s_dev;
+		__entry->type = sm->sm_type;
+		__entry->agno = sm->sm_agno;
+		__entry->flags = sm->sm_flags;
+		__entry->done = done;
+		__entry->nr = nr;
+	),
+	TP_printk("dev %d:%d type %s agno %u flags 0x%x done %u/%u",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  __print_symbolic(__entry->type, XFS_SCRUB_TYPE_STRINGS),
+		  __entry->agno,
+		  __entry->flags,
+		  __entry->done,
+		  __entry->nr)
+)
+
 TRACE_EVENT(xchk_op_error,
 	TP_PROTO(struct xfs_scrub *sc, xfs_agnumber_t agno,
 		 xfs_agblock_t bno, int error, void *ret_ip),
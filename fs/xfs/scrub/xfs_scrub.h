@@ -8,8 +8,13 @@
 
 #ifndef CONFIG_XFS_ONLINE_SCRUB
 # define xfs_scrub_metadata(ip, sm)	(-ENOTTY)
+# define xfs_scrub_metadata_batch(ip, sms, nr, workers, throttle_ms) \
+					(-ENOTTY)
 #else
 int xfs_scrub_metadata(struct xfs_inode *ip, struct xfs_scrub_metadata *sm);
+int xfs_scrub_metadata_batch(struct xfs_inode *ip,
+		struct xfs_scrub_metadata *sms, unsigned int nr,
+		unsigned int workers, unsigned int throttle_ms);
 #endif /* CONFIG_XFS_ONLINE_SCRUB */
 
 #endif	/* __XFS_SCRUB_H__ */
@@ -35,6 +35,20 @@ bool __must_check xchacha20poly1305_decrypt(
 	const size_t ad_len, const u8 nonce[XCHACHA20POLY1305_NONCE_SIZE],
 	const u8 key[CHACHA20POLY1305_KEY_SIZE]);
 
+/* One of several independent messages encrypted under the same key */
+struct chacha20poly1305_batch {
+	u8 *dst;
+	const u8 *src;
+	size_t src_len;
+	const u8 *ad;
+	size_t ad_len;
+	u64 nonce;
+};
+
+void chacha20poly1305_encrypt_batch(struct chacha20poly1305_batch *msgs,
+				    unsigned int nr,
+				    const u8 key[CHACHA20POLY1305_KEY_SIZE]);
+
 bool chacha20poly1305_encrypt_sg_inplace(struct scatterlist *src, size_t src_len,
 					 const u8 *ad, const size_t ad_len,
 					 const u64 nonce,
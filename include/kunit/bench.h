@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * An API to time a function from within a KUnit test case.
+ */
+
+#ifndef _KUNIT_BENCH_H
+#define _KUNIT_BENCH_H
+
+#include <linux/types.h>
+
+typedef void (*kunit_bench_func_t)(void *);
+
+struct kunit;
+
+/**
+ * struct kunit_bench_params - describes how a benchmark is run.
+ * @warmup: number of untimed calls made before the timed ones.
+ * @iterations: number of timed calls.
+ * @cpu: CPU to run the calls on, or -1 to leave placement to the scheduler.
+ * @cold_size: if non-zero, the size in bytes of a buffer that is written
+ *	before every timed call to evict the function's data from the caches.
+ */
+struct kunit_bench_params {
+	unsigned int warmup;
+	unsigned int iterations;
+	int cpu;
+	size_t cold_size;
+};
+
+/**
+ * struct kunit_bench_result - the time taken by one call, in nanoseconds.
+ * @min: fastest call.
+ * @p50: median.
+ * @p90: 90th percentile.
+ * @p99: 99th percentile.
+ * @max: slowest call.
+ * @mean: arithmetic mean.
+ */
+struct kunit_bench_result {
+	u64 min;
+	u64 p50;
+	u64 p90;
+	u64 p99;
+	u64 max;
+	u64 mean;
+};
+
+/**
+ * kunit_bench_run() - times repeated calls to a function.
+ * @test: the test case the benchmark is run from.
+ * @name: name of the benchmark, used in the result line.
+ * @params: how to run the benchmark, or NULL for the defaults (16 warm-up
+ *	    calls, 1000 timed calls, any CPU, warm caches).
+ * @func: the function to time.
+ * @context: passed to @func.
+ * @result: if non-NULL, filled in with the timings.
+ *
+ * Every timed call to @func is measured on its own with ktime_get_ns(), so
+ * the timings include the cost of reading the clock; functions that take
+ * less than a few hundred nanoseconds should loop internally. The timings
+ * are reported as a TAP diagnostic line of key=value pairs::
+ *
+ *	# test_case: bench name: iterations=1000 min=... p50=... p90=... p99=... max=... mean=... ns
+ *
+ * Return: 0 on success, or a negative errno if the benchmark could not be
+ * run, in which case @func may not have been called.
+ */
+int kunit_bench_run(struct kunit *test, const char *name,
+		    const struct kunit_bench_params *params,
+		    kunit_bench_func_t func, void *context,
+		    struct kunit_bench_result *result);
+
+#endif /* _KUNIT_BENCH_H */
@@ -613,6 +613,9 @@ int ceph_flags_to_mode(int flags);
 #define CEPH_CAP_FLOCK_SHARED  (CEPH_CAP_GSHARED   << CEPH_CAP_SFLOCK)
 #define CEPH_CAP_FLOCK_EXCL    (CEPH_CAP_GEXCL     << CEPH_CAP_SFLOCK)
 
+/* cap masks for async dir operations */
+#define CEPH_CAP_DIR_UNLINK    CEPH_CAP_FILE_RD
+
 
 /* cap masks (for getattr) */
 #define CEPH_STAT_CAP_INODE    CEPH_CAP_PIN
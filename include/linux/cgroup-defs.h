@@ -446,6 +446,7 @@ struct cgroup {
 	/* per-cpu recursive resource statistics */
 	struct cgroup_rstat_cpu __percpu *rstat_cpu;
 	struct list_head rstat_css_list;
+	unsigned long rstat_flush_time;		/* jiffies of the last flush */
 
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat last_bstat;
@@ -10,6 +10,7 @@
 #include <linux/uio.h>
 #include <linux/bug.h>
 #include <linux/scatterlist.h>
+#include <linux/highmem.h>
 #include <linux/bitmap.h>
 #include <linux/types.h>
 #include <asm/page.h>
@@ -1426,6 +1427,8 @@ dma_set_tx_state(struct dma_tx_state *st, dma_cookie_t last, dma_cookie_t used,
 struct dma_chan *dma_find_channel(enum dma_transaction_type tx_type);
 enum dma_status dma_sync_wait(struct dma_chan *chan, dma_cookie_t cookie);
 enum dma_status dma_wait_for_async_tx(struct dma_async_tx_descriptor *tx);
+unsigned int dma_async_memcpy_pages(struct dma_chan *chan, struct page **dst,
+				    struct page **src, unsigned int nr);
 void dma_issue_pending_all(void);
 struct dma_chan *__dma_request_channel(const dma_cap_mask_t *mask,
 				       dma_filter_fn fn, void *fn_param,
@@ -1450,6 +1453,17 @@ static inline enum dma_status dma_wait_for_async_tx(struct dma_async_tx_descript
 {
 	return DMA_COMPLETE;
 }
+static inline unsigned int dma_async_memcpy_pages(struct dma_chan *chan,
+						  struct page **dst,
+						  struct page **src,
+						  unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		copy_highpage(dst[i], src[i]);
+	return 0;
+}
 static inline void dma_issue_pending_all(void)
 {
 }
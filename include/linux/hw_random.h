@@ -16,6 +16,7 @@
 #include <linux/types.h>
 #include <linux/list.h>
 #include <linux/kref.h>
+#include <linux/mutex.h>
 
 /**
  * struct hwrng - Hardware Random Number Generator driver
@@ -50,6 +51,7 @@ struct hwrng {
 	struct list_head list;
 	struct kref ref;
 	struct completion cleanup_done;
+	struct mutex read_lock;		/* serializes read/data_read */
 };
 
 struct device;
@@ -12,15 +12,12 @@
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 #include <linux/iio/buffer.h>
+#include <uapi/linux/iio/buffer.h>
 
 struct iio_dma_buffer_queue;
 struct iio_dma_buffer_ops;
 struct device;
-
-struct iio_buffer_block {
-	u32 size;
-	u32 bytes_used;
-};
+struct vm_area_struct;
 
 /**
  * enum iio_block_state - State of a struct iio_dma_buffer_block
@@ -48,6 +45,8 @@ enum iio_block_state {
  * @queue: Parent DMA buffer queue
  * @kref: kref used to manage the lifetime of block
  * @state: Current state of the block
+ * @id: Index of the block in queue->blocks, for mmap blocks
+ * @timestamp: Completion time of the block in ns
  */
 struct iio_dma_buffer_block {
 	/* May only be accessed by the owner of the block */
@@ -70,6 +69,9 @@ struct iio_dma_buffer_block {
 	 * queue->list_lock if the block is not owned by the core.
 	 */
 	enum iio_block_state state;
+
+	unsigned int id;
+	u64 timestamp;
 };
 
 /**
@@ -101,6 +103,9 @@ struct iio_dma_buffer_queue_fileio {
  * @outgoing: List of buffers on the outgoing queue
  * @active: Whether the buffer is currently active
  * @fileio: FileIO state
+ * @blocks: Blocks allocated for block based (mmap) access, if any. While
+ *   there are such blocks the fileio interface is not used.
+ * @num_blocks: Number of entries in @blocks
  */
 struct iio_dma_buffer_queue {
 	struct iio_buffer buffer;
@@ -115,6 +120,9 @@ struct iio_dma_buffer_queue {
 	bool active;
 
 	struct iio_dma_buffer_queue_fileio fileio;
+
+	struct iio_dma_buffer_block **blocks;
+	unsigned int num_blocks;
 };
 
 /**
@@ -143,6 +151,18 @@ int iio_dma_buffer_set_bytes_per_datum(struct iio_buffer *buffer, size_t bpd);
 int iio_dma_buffer_set_length(struct iio_buffer *buffer, unsigned int length);
 int iio_dma_buffer_request_update(struct iio_buffer *buffer);
 
+int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+	struct iio_buffer_block_alloc_req *req);
+int iio_dma_buffer_free_blocks(struct iio_buffer *buffer);
+int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+	struct vm_area_struct *vma);
+
 int iio_dma_buffer_init(struct iio_dma_buffer_queue *queue,
 	struct device *dma_dev, const struct iio_dma_buffer_ops *ops);
 void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue);
@@ -3,11 +3,13 @@
 #define _IIO_BUFFER_GENERIC_IMPL_H_
 #include <linux/sysfs.h>
 #include <linux/kref.h>
+#include <uapi/linux/iio/buffer.h>
 
 #ifdef CONFIG_IIO_BUFFER
 
 struct iio_dev;
 struct iio_buffer;
+struct vm_area_struct;
 
 /**
  * INDIO_BUFFER_FLAG_FIXED_WATERMARK - Watermark level of the buffer can not be
@@ -32,6 +34,14 @@ struct iio_buffer;
  *                      device stops sampling. Calles are balanced with @enable.
  * @release:		called when the last reference to the buffer is dropped,
  *			should free all resources allocated by the buffer.
+ * @alloc_blocks:	allocate blocks for block based (mmap) access, replacing
+ *			any blocks allocated before.
+ * @free_blocks:	free the blocks allocated by @alloc_blocks.
+ * @query_block:	fill in the descriptor of the block with the given id.
+ * @enqueue_block:	hand a block owned by the application to the buffer.
+ * @dequeue_block:	take a completed block from the buffer, or return
+ *			-EAGAIN if there is none.
+ * @mmap:		map the memory of a block into userspace.
  * @modes:		Supported operating modes by this buffer type
  * @flags:		A bitmask combination of INDIO_BUFFER_FLAG_*
  *
@@ -58,6 +68,17 @@ struct iio_buffer_access_funcs {
 
 	void (*release)(struct iio_buffer *buffer);
 
+	int (*alloc_blocks)(struct iio_buffer *buffer,
+			    struct iio_buffer_block_alloc_req *req);
+	int (*free_blocks)(struct iio_buffer *buffer);
+	int (*query_block)(struct iio_buffer *buffer,
+			   struct iio_buffer_block *block);
+	int (*enqueue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*dequeue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*mmap)(struct iio_buffer *buffer, struct vm_area_struct *vma);
+
 	unsigned int modes;
 	unsigned int flags;
 };
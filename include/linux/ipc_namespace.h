@@ -48,6 +48,10 @@ struct ipc_namespace {
 	 * of shmctl()
 	 */
 	int		shm_rmid_forced;
+	/* Prefault segments on shmat() */
+	int		shm_populate;
+	/* Ask for transparent huge pages on shmem-backed segments */
+	int		shm_hugepage;
 
 	struct notifier_block ipcns_nb;
 
@@ -25,6 +25,7 @@
 #include <linux/stddef.h>
 #include <linux/mutex.h>
 #include <linux/timer.h>
+#include <linux/workqueue.h>
 #include <linux/slab.h>
 #include <linux/bit_spinlock.h>
 #include <crypto/hash.h>
@@ -262,7 +263,10 @@ typedef struct journal_superblock_s
 /* 0x0050 */
 	__u8	s_checksum_type;	/* checksum type */
 	__u8	s_padding2[3];
-	__u32	s_padding[42];
+/* 0x0054 */
+	__be32	s_num_fc_blks;		/* Number of fast commit blocks */
+/* 0x0058 */
+	__u32	s_padding[41];
 	__be32	s_checksum;		/* crc32c(superblock) */
 
 /* 0x0100 */
@@ -288,6 +292,7 @@ typedef struct journal_superblock_s
 #define JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT	0x00000004
 #define JBD2_FEATURE_INCOMPAT_CSUM_V2		0x00000008
 #define JBD2_FEATURE_INCOMPAT_CSUM_V3		0x00000010
+#define JBD2_FEATURE_INCOMPAT_FAST_COMMIT	0x00000020
 
 /* See "journal feature predicate functions" below */
 
@@ -298,7 +303,8 @@ typedef struct journal_superblock_s
 					JBD2_FEATURE_INCOMPAT_64BIT | \
 					JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT | \
 					JBD2_FEATURE_INCOMPAT_CSUM_V2 | \
-					JBD2_FEATURE_INCOMPAT_CSUM_V3)
+					JBD2_FEATURE_INCOMPAT_CSUM_V3 | \
+					JBD2_FEATURE_INCOMPAT_FAST_COMMIT)
 
 #ifdef __KERNEL__
 
@@ -331,6 +337,9 @@ BUFFER_FNS(Freed, freed)
 BUFFER_FNS(Shadow, shadow)
 BUFFER_FNS(Verified, verified)
 
+/* Recovery pass types, also passed to j_fc_replay_callback */
+enum passtype {PASS_SCAN, PASS_REVOKE, PASS_REPLAY};
+
 static inline struct buffer_head *jh2bh(struct journal_head *jh)
 {
 	return jh->b_bh;
@@ -735,6 +744,22 @@ struct transaction_stats_s {
 	struct transaction_run_stats_s run;
 };
 
+/*
+ * Commit latency histograms: bucket i counts latencies of less than 2^i
+ * microseconds, the last bucket also counts anything longer.
+ */
+#define JBD2_HIST_BUCKETS	24
+
+struct jbd2_latency_hist {
+	unsigned long		lh_locked[JBD2_HIST_BUCKETS];
+	unsigned long		lh_commit[JBD2_HIST_BUCKETS];
+};
+
+static inline unsigned int jbd2_hist_bucket(u64 us)
+{
+	return min_t(unsigned int, fls64(us), JBD2_HIST_BUCKETS - 1);
+}
+
 static inline unsigned long
 jbd2_time_diff(unsigned long start, unsigned long end)
 {
@@ -744,7 +769,7 @@ jbd2_time_diff(unsigned long start, unsigned long end)
 	return end + (MAX_JIFFY_OFFSET - start);
 }
 
-#define JBD2_NR_BATCH	64
+#define JBD2_NR_BATCH	256
 
 /**
  * struct journal_s - The journal_s type is the concrete type associated with
@@ -851,6 +876,14 @@ struct journal_s
 	 */
 	wait_queue_head_t	j_wait_reserved;
 
+	/**
+	 * @j_fc_wait:
+	 *
+	 * Wait queue to wait for a fast commit or for the full commit
+	 * excluding it to finish. [j_state_lock]
+	 */
+	wait_queue_head_t	j_fc_wait;
+
 	/**
 	 * @j_checkpoint_mutex:
 	 *
@@ -868,6 +901,15 @@ struct journal_s
 	 */
 	struct buffer_head	*j_chkpt_bhs[JBD2_NR_BATCH];
 
+	/**
+	 * @j_checkpoint_work:
+	 *
+	 * Background checkpointing, queued once free log space drops below
+	 * the low watermark so that handle starts rarely have to checkpoint
+	 * synchronously in __jbd2_log_wait_for_space().
+	 */
+	struct work_struct	j_checkpoint_work;
+
 	/**
 	 * @j_head:
 	 *
@@ -1065,6 +1107,40 @@ struct journal_s
 	 */
 	int			j_wbufsize;
 
+	/**
+	 * @j_fc_first:
+	 *
+	 * The block number of the first fast commit block in the journal.
+	 */
+	unsigned long		j_fc_first;
+
+	/**
+	 * @j_fc_last:
+	 *
+	 * One beyond the last fast commit block in the journal.
+	 */
+	unsigned long		j_fc_last;
+
+	/**
+	 * @j_fc_off:
+	 *
+	 * Number of fast commit blocks handed out since the last full
+	 * commit.  Only touched by the (single) ongoing fast commit.
+	 */
+	unsigned long		j_fc_off;
+
+	/**
+	 * @j_fc_wbuf: Array of fast commit bhs, one per fast commit block.
+	 */
+	struct buffer_head	**j_fc_wbuf;
+
+	/**
+	 * @j_fc_wbufsize:
+	 *
+	 * Size of @j_fc_wbuf array.
+	 */
+	int			j_fc_wbufsize;
+
 	/**
 	 * @j_last_sync_writer:
 	 *
@@ -1105,6 +1181,24 @@ struct journal_s
 	void			(*j_commit_callback)(journal_t *,
 						     transaction_t *);
 
+	/**
+	 * @j_fc_replay_callback:
+	 *
+	 * Called during recovery for each block of the fast commit area,
+	 * in order, once for PASS_SCAN and once for PASS_REPLAY.  @off is
+	 * the block's index within the area and @expected_tid the first
+	 * transaction the regular log did not find committed; records for
+	 * any other tid are stale.  Returns JBD2_FC_REPLAY_CONTINUE to be
+	 * fed the next block, JBD2_FC_REPLAY_STOP or a negative error.
+	 * Recovery of a journal with the fast commit feature fails if
+	 * this is not set.
+	 */
+	int			(*j_fc_replay_callback)(journal_t *journal,
+							struct buffer_head *bh,
+							enum passtype pass,
+							int off,
+							tid_t expected_tid);
+
 	/*
 	 * Journal statistics
 	 */
@@ -1124,6 +1218,12 @@ struct journal_s
 	 */
 	struct transaction_stats_s j_stats;
 
+	/**
+	 * @j_hist: Histograms of the time new handles were locked out and
+	 * of the commit time, per transaction. [j_history_lock]
+	 */
+	struct jbd2_latency_hist j_hist;
+
 	/**
 	 * @j_failed_commit: Failed journal commit ID.
 	 */
@@ -1234,6 +1334,27 @@ JBD2_FEATURE_INCOMPAT_FUNCS(64bit,		64BIT)
 JBD2_FEATURE_INCOMPAT_FUNCS(async_commit,	ASYNC_COMMIT)
 JBD2_FEATURE_INCOMPAT_FUNCS(csum2,		CSUM_V2)
 JBD2_FEATURE_INCOMPAT_FUNCS(csum3,		CSUM_V3)
+JBD2_FEATURE_INCOMPAT_FUNCS(fast_commit,	FAST_COMMIT)
+
+/*
+ * Fast commit area: a filesystem may reserve blocks at the end of the log
+ * for compact logical records of the running transaction, so that fsync
+ * of a small change need not wait for a full commit.  The record format
+ * is private to the filesystem; jbd2 only manages the space and hands the
+ * blocks back through j_fc_replay_callback during recovery.
+ */
+#define JBD2_DEFAULT_FAST_COMMIT_BLOCKS	256
+
+/* Return values of j_fc_replay_callback */
+#define JBD2_FC_REPLAY_STOP	0
+#define JBD2_FC_REPLAY_CONTINUE	1
+
+static inline int jbd2_journal_get_num_fc_blks(journal_superblock_t *jsb)
+{
+	int num_fc_blocks = be32_to_cpu(jsb->s_num_fc_blks);
+
+	return num_fc_blocks ? num_fc_blocks : JBD2_DEFAULT_FAST_COMMIT_BLOCKS;
+}
 
 /*
  * Journal flag definitions
@@ -1248,6 +1369,8 @@ JBD2_FEATURE_INCOMPAT_FUNCS(csum3,		CSUM_V3)
 						 * data write error in ordered
 						 * mode */
 #define JBD2_REC_ERR	0x080	/* The errno in the sb has been recorded */
+#define JBD2_FAST_COMMIT_ONGOING	0x100	/* Fast commit is in progress */
+#define JBD2_FULL_COMMIT_ONGOING	0x200	/* Full commit is in progress */
 
 /*
  * Function declarations for the journaling transaction and buffer
@@ -1494,8 +1617,18 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_transaction_committed(journal_t *journal, tid_t tid);
 int jbd2_complete_transaction(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
+void __jbd2_log_kick_checkpoint(journal_t *journal);
+void jbd2_log_checkpoint_work(struct work_struct *work);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
+/* Fast commit support */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid);
+int jbd2_fc_end_commit(journal_t *journal);
+int jbd2_fc_end_commit_fallback(journal_t *journal, tid_t tid);
+int jbd2_fc_get_buf(journal_t *journal, struct buffer_head **bh_out);
+int jbd2_fc_wait_bufs(journal_t *journal, int num_blks);
+void jbd2_fc_release_bufs(journal_t *journal);
+
 void __jbd2_log_wait_for_space(journal_t *journal);
 extern void __jbd2_journal_drop_transaction(journal_t *, transaction_t *);
 extern int jbd2_cleanup_journal_tail(journal_t *);
@@ -1575,6 +1708,30 @@ static inline unsigned long jbd2_log_space_left(journal_t *journal)
 	return max_t(long, free, 0);
 }
 
+/*
+ * Background checkpointing starts once less than twice the space a single
+ * transaction may need is left, and runs until a third of a transaction's
+ * worth above that is free again.  Foreground tasks only checkpoint
+ * themselves below j_max_transaction_buffers.
+ */
+static inline unsigned long jbd2_log_checkpoint_low_wmark(journal_t *journal)
+{
+	return 2 * journal->j_max_transaction_buffers;
+}
+
+static inline unsigned long jbd2_log_checkpoint_high_wmark(journal_t *journal)
+{
+	return jbd2_log_checkpoint_low_wmark(journal) +
+		journal->j_max_transaction_buffers / 3;
+}
+
+/* Must be called under j_state_lock */
+static inline void jbd2_log_kick_checkpoint(journal_t *journal)
+{
+	if (jbd2_log_space_left(journal) < jbd2_log_checkpoint_low_wmark(journal))
+		__jbd2_log_kick_checkpoint(journal);
+}
+
 /*
  * Definitions which augment the buffer_head layer
  */
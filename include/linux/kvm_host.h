@@ -70,6 +70,13 @@
 /* Two fragments for cross MMIO pages. */
 #define KVM_MAX_MMIO_FRAGMENTS	2
 
+/*
+ * Halt-polling latency histogram: bucket 0 counts blocks shorter than
+ * 1us, bucket i counts blocks in [2^(i+9), 2^(i+10)) ns, the last one
+ * everything longer.
+ */
+#define KVM_HALT_POLL_HIST_BUCKETS	16
+
 #ifndef KVM_ADDRESS_SPACE_NUM
 #define KVM_ADDRESS_SPACE_NUM	1
 #endif
@@ -283,6 +290,8 @@ struct kvm_vcpu {
 	sigset_t sigset;
 	struct kvm_vcpu_stat stat;
 	unsigned int halt_poll_ns;
+	u32 halt_poll_hist[KVM_HALT_POLL_HIST_BUCKETS];
+	u32 halt_poll_hist_samples;
 	bool valid_wakeup;
 
 #ifdef CONFIG_HAS_IOMEM
@@ -463,6 +472,10 @@ struct kvm {
 		struct list_head  items;
 		struct list_head  resampler_list;
 		struct mutex      resampler_lock;
+		/* Statistics of irqfds already shut down, under lock */
+		u64               inject_inline;
+		u64               inject_deferred;
+		u64               inject_coalesced;
 	} irqfds;
 	struct list_head ioeventfds;
 #endif
@@ -1176,6 +1189,7 @@ int kvm_ioeventfd(struct kvm *kvm, struct kvm_ioeventfd *args);
 #ifdef CONFIG_HAVE_KVM_IRQFD
 int kvm_irqfd(struct kvm *kvm, struct kvm_irqfd *args);
 void kvm_irqfd_release(struct kvm *kvm);
+void kvm_irqfd_create_debugfs(struct kvm *kvm);
 void kvm_irq_routing_update(struct kvm *);
 #else
 static inline int kvm_irqfd(struct kvm *kvm, struct kvm_irqfd *args)
@@ -1184,6 +1198,7 @@ static inline int kvm_irqfd(struct kvm *kvm, struct kvm_irqfd *args)
 }
 
 static inline void kvm_irqfd_release(struct kvm *kvm) {}
+static inline void kvm_irqfd_create_debugfs(struct kvm *kvm) {}
 #endif
 
 #else
@@ -1196,6 +1211,7 @@ static inline int kvm_irqfd(struct kvm *kvm, struct kvm_irqfd *args)
 }
 
 static inline void kvm_irqfd_release(struct kvm *kvm) {}
+static inline void kvm_irqfd_create_debugfs(struct kvm *kvm) {}
 
 #ifdef CONFIG_HAVE_KVM_IRQCHIP
 static inline void kvm_irq_routing_update(struct kvm *kvm)
@@ -1259,6 +1275,8 @@ extern unsigned int halt_poll_ns;
 extern unsigned int halt_poll_ns_grow;
 extern unsigned int halt_poll_ns_grow_start;
 extern unsigned int halt_poll_ns_shrink;
+extern bool halt_poll_adaptive;
+extern unsigned int halt_poll_adaptive_pct;
 
 struct kvm_device {
 	const struct kvm_device_ops *ops;
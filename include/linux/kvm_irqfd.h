@@ -59,6 +59,10 @@ struct kvm_kernel_irqfd {
 	struct work_struct shutdown;
 	struct irq_bypass_consumer consumer;
 	struct irq_bypass_producer *producer;
+	/* Injection statistics, updated by irqfd_wakeup() under wqh->lock */
+	u64 inject_inline;
+	u64 inject_deferred;
+	u64 inject_coalesced;
 };
 
 #endif /* __LINUX_KVM_IRQFD_H */
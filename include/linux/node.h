@@ -135,6 +135,8 @@ static inline int register_one_node(int nid)
 }
 
 extern void unregister_one_node(int nid);
+extern void node_set_lower_tier(int nid);
+extern void node_clear_lower_tier(int nid);
 extern int register_cpu_under_node(unsigned int cpu, unsigned int nid);
 extern int unregister_cpu_under_node(unsigned int cpu, unsigned int nid);
 extern void unregister_memory_block_under_nodes(struct memory_block *mem_blk);
@@ -160,6 +162,12 @@ static inline int unregister_one_node(int nid)
 {
 	return 0;
 }
+static inline void node_set_lower_tier(int nid)
+{
+}
+static inline void node_clear_lower_tier(int nid)
+{
+}
 static inline int register_cpu_under_node(unsigned int cpu, unsigned int nid)
 {
 	return 0;
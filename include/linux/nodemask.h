@@ -399,6 +399,7 @@ enum node_states {
 #endif
 	N_MEMORY,		/* The node has memory(regular, high, movable) */
 	N_CPU,		/* The node has one or more cpus */
+	N_LOWER_TIER,	/* The node's memory is a slower tier (e.g. dax/kmem) */
 	NR_NODE_STATES
 };
 
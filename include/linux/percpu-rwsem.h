@@ -97,6 +97,7 @@ static inline void percpu_up_read(struct percpu_rw_semaphore *sem)
 }
 
 extern void percpu_down_write(struct percpu_rw_semaphore *);
+extern void percpu_down_write_expedited(struct percpu_rw_semaphore *);
 extern void percpu_up_write(struct percpu_rw_semaphore *);
 
 extern int __percpu_init_rwsem(struct percpu_rw_semaphore *,
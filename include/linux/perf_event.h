@@ -844,6 +844,9 @@ struct perf_cpu_context {
 #ifdef CONFIG_CGROUP_PERF
 	struct perf_cgroup		*cgrp;
 	struct list_head		cgrp_cpuctx_entry;
+	/* group tree cursors for visit_groups_merge() */
+	struct perf_event		**visit_evts;
+	int				visit_size;
 #endif
 
 	struct list_head		sched_cb_entry;
@@ -116,6 +116,9 @@ struct posix_cputimer_base {
  * @expiry_active:	Timer expiry is active. Used for
  *			process wide timers to avoid multiple
  *			task trying to handle expiry concurrently
+ * @work_scheduled:	@work is queued and has not run yet
+ * @work:		task_work handling expiry on the way back to user
+ *			space; only used in task_struct
  *
  * Used in task_struct and signal_struct
  */
@@ -123,6 +126,8 @@ struct posix_cputimers {
 	struct posix_cputimer_base	bases[CPUCLOCK_MAX];
 	unsigned int			timers_active;
 	unsigned int			expiry_active;
+	unsigned int			work_scheduled;
+	struct callback_head		work;
 };
 
 static inline void posix_cputimers_init(struct posix_cputimers *pct)
@@ -221,7 +226,7 @@ struct k_itimer {
 	struct rcu_head		rcu;
 };
 
-void run_posix_cpu_timers(void);
+void run_posix_cpu_timers(int user_tick);
 void posix_cpu_timers_exit(struct task_struct *task);
 void posix_cpu_timers_exit_group(struct task_struct *task);
 void set_process_cpu_timer(struct task_struct *task, unsigned int clock_idx,
@@ -359,6 +359,8 @@ static inline void spi_unregister_driver(struct spi_driver *sdrv)
  * @kworker: thread struct for message pump
  * @kworker_task: pointer to task for message pump kworker thread
  * @pump_messages: work struct for scheduling work to the message pump
+ * @pump_idle: delayed work struct for idling the controller once
+ *	@idle_delay_ms has passed without a message
  * @queue_lock: spinlock to syncronise access to message queue
  * @queue: message queue
  * @idling: the device is entering idle state
@@ -373,6 +375,13 @@ static inline void spi_unregister_driver(struct spi_driver *sdrv)
  * @auto_runtime_pm: the core should ensure a runtime PM reference is held
  *                   while the hardware is prepared, using the parent
  *                   device for the spidev
+ * @idle_delay_ms: keep the hardware prepared for this long after the queue
+ *	runs empty, so that a burst of messages only prepares it once and
+ *	messages sent with spi_sync() in the meantime do not wake the message
+ *	pump thread. Zero idles the controller as soon as the queue is empty.
+ *	Stopping the queue waits for the delay to pass, so keep it short.
+ *	Set with spi_controller_set_idle_delay().
+ * @last_msg_done: jiffies at which the last message was finalized
  * @max_dma_len: Maximum length of a DMA transfer for the device.
  * @prepare_transfer_hardware: a message will soon arrive from the queue
  *	so the subsystem requests the driver to prepare the transfer hardware
@@ -585,6 +594,7 @@ struct spi_controller {
 	struct kthread_worker		kworker;
 	struct task_struct		*kworker_task;
 	struct kthread_work		pump_messages;
+	struct kthread_delayed_work	pump_idle;
 	spinlock_t			queue_lock;
 	struct list_head		queue;
 	struct spi_message		*cur_msg;
@@ -593,6 +603,8 @@ struct spi_controller {
 	bool				running;
 	bool				rt;
 	bool				auto_runtime_pm;
+	unsigned int			idle_delay_ms;
+	unsigned long			last_msg_done;
 	bool                            cur_msg_prepared;
 	bool				cur_msg_mapped;
 	struct completion               xfer_completion;
@@ -694,6 +706,10 @@ extern struct spi_message *spi_get_next_queued_message(struct spi_controller *ct
 extern void spi_finalize_current_message(struct spi_controller *ctlr);
 extern void spi_finalize_current_transfer(struct spi_controller *ctlr);
 
+#define SPI_IDLE_DELAY_MAX_MS	1000
+extern int spi_controller_set_idle_delay(struct spi_controller *ctlr,
+					 unsigned int ms);
+
 /* Helper calls for driver to timestamp transfer */
 void spi_take_timestamp_pre(struct spi_controller *ctlr,
 			    struct spi_transfer *xfer,
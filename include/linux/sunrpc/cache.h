@@ -45,6 +45,9 @@
  */
 struct cache_head {
 	struct hlist_node	cache_list;
+	struct list_head	expiry_list;	/* on cache_detail->expiry_queue
+						 * while hashed and VALID
+						 */
 	time64_t	expiry_time;	/* After time time, don't use the data */
 	time64_t	last_refresh;   /* If CACHE_PENDING, this is when upcall was
 					 * sent, else this is when update was
@@ -104,6 +107,7 @@ struct cache_detail {
 	struct list_head	others;
 	time64_t		nextcheck;
 	int			entries;
+	struct list_head	expiry_queue[2];	/* positive, negative */
 
 	/* fields for communication over channel */
 	struct list_head	queue;
@@ -18,12 +18,13 @@
 #include <linux/sunrpc/auth.h>
 #include <linux/sunrpc/svcauth.h>
 #include <linux/wait.h>
+#include <linux/llist.h>
 #include <linux/mm.h>
 
 /* statistics for svc_pool structures */
 struct svc_pool_stats {
 	atomic_long_t	packets;
-	unsigned long	sockets_queued;
+	atomic_long_t	sockets_queued;
 	atomic_long_t	threads_woken;
 	atomic_long_t	threads_timedout;
 };
@@ -42,6 +43,10 @@ struct svc_pool {
 	unsigned int		sp_id;	    	/* pool id; also node id on NUMA */
 	spinlock_t		sp_lock;	/* protects all fields */
 	struct list_head	sp_sockets;	/* pending sockets */
+	struct llist_head	sp_new ____cacheline_aligned_in_smp;
+						/* sockets queued without
+						 * sp_lock, moved to
+						 * sp_sockets on dequeue */
 	unsigned int		sp_nrthreads;	/* # of threads in pool */
 	struct list_head	sp_all_threads;	/* all server threads */
 	struct svc_pool_stats	sp_stats;	/* statistics on pool operation */
@@ -252,6 +257,10 @@ struct svc_rqst {
 	struct page *		*rq_respages;	/* points into rq_pages */
 	struct page *		*rq_next_page; /* next reply page to use */
 	struct page *		*rq_page_end;  /* one past the last page */
+	struct page		*rq_page_cache[RPCSVC_MAXPAGES];
+						/* released reply pages kept
+						 * for svc_alloc_arg() */
+	unsigned int		rq_page_cache_count;
 
 	struct kvec		rq_vec[RPCSVC_MAXPAGES]; /* generally useful.. */
 
@@ -359,12 +368,29 @@ xdr_ressize_check(struct svc_rqst *rqstp, __be32 *p)
 	return vec->iov_len <= PAGE_SIZE;
 }
 
+/*
+ * Keep a released page for the next svc_alloc_arg() if nobody else holds
+ * it.  Pages still referenced by the network layer or spliced in from the
+ * page cache are freed as before, and so are pages from another node or
+ * from the pfmemalloc reserves, which must go back to the allocator.
+ */
+static inline void svc_put_page(struct svc_rqst *rqstp, struct page *page)
+{
+	if (rqstp->rq_page_cache_count < ARRAY_SIZE(rqstp->rq_page_cache) &&
+	    page_ref_count(page) == 1 && !page->mapping &&
+	    !PageLRU(page) && !PageHighMem(page) &&
+	    page_to_nid(page) == numa_mem_id() && !page_is_pfmemalloc(page))
+		rqstp->rq_page_cache[rqstp->rq_page_cache_count++] = page;
+	else
+		put_page(page);
+}
+
 static inline void svc_free_res_pages(struct svc_rqst *rqstp)
 {
 	while (rqstp->rq_next_page != rqstp->rq_respages) {
 		struct page **pp = --rqstp->rq_next_page;
 		if (*pp) {
-			put_page(*pp);
+			svc_put_page(rqstp, *pp);
 			*pp = NULL;
 		}
 	}
@@ -82,6 +82,9 @@ struct svcxprt_rdma {
 
 	atomic_t             sc_sq_avail;	/* SQEs ready to be consumed */
 	unsigned int	     sc_sq_depth;	/* Depth of SQ */
+	atomic_long_t	     sc_stat_replies;	/* RPC replies sent */
+	atomic_long_t	     sc_stat_sq_wrs;	/* Send Queue WRs posted */
+	atomic_long_t	     sc_stat_sq_cqes;	/* Send Queue completions */
 	__be32		     sc_fc_credits;	/* Forward credits */
 	u32		     sc_max_requests;	/* Max requests */
 	u32		     sc_max_bc_requests;/* Backward credits */
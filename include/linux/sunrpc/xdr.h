@@ -155,6 +155,50 @@ xdr_decode_hyper(__be32 *p, __u64 *valp)
 	return p + 2;
 }
 
+/*
+ * Bulk conversion of fixed-size records: reserve or decode the space for
+ * the whole record once, then convert its integer fields in one pass.
+ */
+static inline __be32 *
+xdr_encode_uint32s(__be32 *p, const __u32 *array, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		p[i] = cpu_to_be32(array[i]);
+	return p + count;
+}
+
+static inline __be32 *
+xdr_decode_uint32s(__be32 *p, __u32 *array, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		array[i] = be32_to_cpu(p[i]);
+	return p + count;
+}
+
+static inline __be32 *
+xdr_encode_hypers(__be32 *p, const __u64 *array, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		put_unaligned_be64(array[i], p + 2 * i);
+	return p + 2 * count;
+}
+
+static inline __be32 *
+xdr_decode_hypers(__be32 *p, __u64 *array, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		array[i] = get_unaligned_be64(p + 2 * i);
+	return p + 2 * count;
+}
+
 static inline __be32 *
 xdr_decode_opaque_fixed(__be32 *p, void *ptr, unsigned int len)
 {
@@ -430,8 +474,33 @@ xdr_stream_encode_uint32_array(struct xdr_stream *xdr,
 	if (unlikely(!p))
 		return -EMSGSIZE;
 	*p++ = cpu_to_be32(array_size);
-	for (; array_size > 0; p++, array++, array_size--)
-		*p = cpu_to_be32p(array);
+	xdr_encode_uint32s(p, array, array_size);
+	return ret;
+}
+
+/**
+ * xdr_stream_encode_uint64_fixed - Encode a fixed-size array of hypers
+ * @xdr: pointer to xdr_stream
+ * @array: array of 64-bit integers
+ * @count: number of elements in @array
+ *
+ * Buffer space for the whole array is reserved with a single bounds
+ * check, and no element count is encoded.
+ *
+ * Return values:
+ *   On success, returns length in bytes of XDR buffer consumed
+ *   %-EMSGSIZE on XDR buffer overflow
+ */
+static inline ssize_t
+xdr_stream_encode_uint64_fixed(struct xdr_stream *xdr,
+		const __u64 *array, size_t count)
+{
+	ssize_t ret = count * sizeof(__u64);
+	__be32 *p = xdr_reserve_space(xdr, ret);
+
+	if (unlikely(!p))
+		return -EMSGSIZE;
+	xdr_encode_hypers(p, array, count);
 	return ret;
 }
 
@@ -546,9 +615,30 @@ xdr_stream_decode_uint32_array(struct xdr_stream *xdr,
 		retval = len;
 	} else
 		retval = -EMSGSIZE;
-	for (; array_size > 0; p++, array++, array_size--)
-		*array = be32_to_cpup(p);
+	xdr_decode_uint32s(p, array, array_size);
 	return retval;
 }
 
+/**
+ * xdr_stream_decode_uint64_fixed - Decode a fixed-size array of hypers
+ * @xdr: pointer to xdr_stream
+ * @array: location to store the integers
+ * @count: number of elements to decode
+ *
+ * Return values:
+ *   %0 on success
+ *   %-EBADMSG on XDR buffer overflow
+ */
+static inline ssize_t
+xdr_stream_decode_uint64_fixed(struct xdr_stream *xdr,
+		__u64 *array, size_t count)
+{
+	__be32 *p = xdr_inline_decode(xdr, count * sizeof(__u64));
+
+	if (unlikely(!p))
+		return -EBADMSG;
+	xdr_decode_hypers(p, array, count);
+	return 0;
+}
+
 #endif /* _SUNRPC_XDR_H_ */
@@ -179,6 +179,22 @@ extern u64 ktime_get_raw_fast_ns(void);
 extern u64 ktime_get_boot_fast_ns(void);
 extern u64 ktime_get_real_fast_ns(void);
 
+/**
+ * struct ktime_timestamps - Simultaneous mono/boot/real/tai timestamps
+ * @mono:	Monotonic timestamp
+ * @boot:	Boottime timestamp
+ * @real:	Realtime timestamp
+ * @tai:	International Atomic Time timestamp
+ */
+struct ktime_timestamps {
+	u64		mono;
+	u64		boot;
+	u64		real;
+	u64		tai;
+};
+
+extern void ktime_get_fast_timestamps(struct ktime_timestamps *snap);
+
 /*
  * timespec64/time64_t interfaces utilizing the ktime based ones
  * for API completeness, these could be implemented more efficiently
@@ -256,6 +256,50 @@ ZSTD_CCtx *ZSTD_initCCtx(void *workspace, size_t workspaceSize);
 size_t ZSTD_compressCCtx(ZSTD_CCtx *ctx, void *dst, size_t dstCapacity,
 	const void *src, size_t srcSize, ZSTD_parameters params);
 
+/**
+ * ZSTD_compressJobsWorkspaceBound() - memory needed for ZSTD_compressJobs()
+ * @cParams:   The compression parameters to be used for compression.
+ * @jobSize:   The number of input bytes compressed by each job.
+ * @nbWorkers: The number of jobs compressed concurrently.
+ *
+ * Return:     A lower bound on the size of the workspace that is passed to
+ *             ZSTD_compressJobs().
+ */
+size_t ZSTD_compressJobsWorkspaceBound(ZSTD_compressionParameters cParams,
+	size_t jobSize, unsigned int nbWorkers);
+
+/**
+ * ZSTD_compressJobs() - compress src into dst on several CPUs
+ * @workspace:     The workspace for the jobs. Must be size_t aligned.
+ * @workspaceSize: The size of workspace. Use
+ *                 ZSTD_compressJobsWorkspaceBound() to determine how large
+ *                 the workspace must be.
+ * @dst:           The buffer to compress src into.
+ * @dstCapacity:   The size of the destination buffer.
+ *                 ZSTD_compressBound(jobSize) for every started job is
+ *                 guaranteed to be large enough.
+ * @src:           The data to compress.
+ * @srcSize:       The size of the data to compress.
+ * @jobSize:       The number of input bytes compressed by each job.
+ * @nbWorkers:     The number of jobs compressed concurrently. The caller
+ *                 compresses one of them itself, the others run on
+ *                 system_unbound_wq.
+ * @params:        The parameters to use for compression.
+ *
+ * The input is compressed as a sequence of independent frames of jobSize
+ * bytes each. Matches do not cross job boundaries, so small jobs cost
+ * compression ratio. ZSTD_decompressDCtx() decodes all the frames in one
+ * call. ZSTD_decompressStream() returns 0 at the end of every frame, so
+ * streaming callers must keep calling it while input remains instead of
+ * stopping at the first 0. May sleep.
+ *
+ * Return:         The compressed size or an error, which can be checked using
+ *                 ZSTD_isError().
+ */
+size_t ZSTD_compressJobs(void *workspace, size_t workspaceSize, void *dst,
+	size_t dstCapacity, const void *src, size_t srcSize, size_t jobSize,
+	unsigned int nbWorkers, ZSTD_parameters params);
+
 /**
  * ZSTD_DCtxWorkspaceBound() - amount of memory needed to initialize a ZSTD_DCtx
  *
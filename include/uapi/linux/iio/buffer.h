@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/* The industrial I/O - block based buffer access */
+#ifndef _UAPI_IIO_BUFFER_H_
+#define _UAPI_IIO_BUFFER_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/**
+ * struct iio_buffer_block_alloc_req - Descriptor for allocating IIO buffer
+ *	blocks
+ * @type:	Type of block(s), must be 0
+ * @size:	Size of each block in bytes
+ * @count:	Number of blocks to allocate, updated with the number of blocks
+ *		actually allocated
+ * @id:		Set to the ID of the first allocated block
+ */
+struct iio_buffer_block_alloc_req {
+	__u32 type;
+	__u32 size;
+	__u32 count;
+	__u32 id;
+};
+
+/* The timestamp field of the block is valid */
+#define IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID	(1 << 0)
+
+/**
+ * struct iio_buffer_block - Descriptor for a IIO buffer block
+ * @id:		ID of the block
+ * @size:	Total size of the block in bytes
+ * @bytes_used:	Number of bytes that contain valid data
+ * @type:	Type of the block, always 0
+ * @flags:	Combination of IIO_BUFFER_BLOCK_FLAG_*
+ * @data.offset: Offset to pass to mmap() to map the block
+ * @timestamp:	Time at which the block was completed, in ns
+ *
+ * A block is owned by the application after allocation and after it has been
+ * dequeued, and by the kernel after it has been enqueued. The application
+ * must not access the mapped memory of a block it does not own.
+ */
+struct iio_buffer_block {
+	__u32 id;
+	__u32 size;
+	__u32 bytes_used;
+	__u32 type;
+	__u32 flags;
+	union {
+		__u32 offset;
+	} data;
+	__u64 timestamp;
+};
+
+#define IIO_BUFFER_BLOCK_ALLOC_IOCTL	_IOWR('i', 0xa0, struct iio_buffer_block_alloc_req)
+#define IIO_BUFFER_BLOCK_FREE_IOCTL	_IO('i', 0xa1)
+#define IIO_BUFFER_BLOCK_QUERY_IOCTL	_IOWR('i', 0xa2, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_ENQUEUE_IOCTL	_IOWR('i', 0xa3, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_DEQUEUE_IOCTL	_IOWR('i', 0xa4, struct iio_buffer_block)
+
+#endif /* _UAPI_IIO_BUFFER_H_ */
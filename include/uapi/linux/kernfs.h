@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_KERNFS_H
+#define _UAPI_LINUX_KERNFS_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * KERNFS_IOC_READ_ATTRS on a sysfs or cgroup directory fd reads several
+ * attribute files of that directory in one call, with the same contents
+ * and permission checks as open() + read() + close() of each of them.
+ *
+ * @names points to @names_len bytes of NUL terminated attribute names.
+ * For each name, in order, a struct kernfs_attr_record followed by the
+ * name and by the file contents is stored in @buf. Records are 8 byte
+ * aligned. Names whose record does not fit in @buf_len are not read,
+ * @nr_read tells how many names have been processed. Binary attributes
+ * and other files without a seq_file interface are not read, their
+ * record carries -EOPNOTSUPP.
+ */
+struct kernfs_read_attrs {
+	__u64	names;
+	__u64	buf;
+	__u32	names_len;
+	__u32	buf_len;
+	__u32	nr_read;
+	__u32	__pad;
+};
+
+struct kernfs_attr_record {
+	__u32	rec_len;	/* length of the record including padding */
+	__s32	error;		/* 0, or -errno with @data_len 0 */
+	__u32	name_len;	/* name follows, not NUL terminated */
+	__u32	data_len;	/* contents follow the name */
+};
+
+#define KERNFS_IOC_READ_ATTRS	_IOWR(0xb8, 1, struct kernfs_read_attrs)
+
+#endif /* _UAPI_LINUX_KERNFS_H */
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_PROC_PIDSTATS_H
+#define _UAPI_LINUX_PROC_PIDSTATS_H
+
+#include <linux/types.h>
+
+/*
+ * Records returned by read(2) of /proc/pidstats and /proc/pidstats_rollup:
+ * one struct proc_pidstats per visible thread group of the reader's pid
+ * namespace, in increasing pid order. A read returns as many whole records
+ * as fit in the buffer, the file offset is the pid to continue from and
+ * lseek(fd, 0, SEEK_SET) starts a new scan.
+ *
+ * Times are in nanoseconds, sizes in bytes. Fields are only ever appended,
+ * @size tells which of them the kernel filled in.
+ */
+
+/* The smaps_rollup fields are valid */
+#define PROC_PIDSTATS_ROLLUP	(1U << 0)
+
+struct proc_pidstats {
+	__u32	size;			/* sizeof(struct proc_pidstats) */
+	__u32	flags;			/* PROC_PIDSTATS_* */
+
+	/* /proc/<pid>/stat */
+	__s32	pid;
+	__s32	ppid;
+	__s32	pgid;
+	__s32	sid;
+	__u32	state;			/* state character, e.g. 'R' */
+	__u32	num_threads;
+	__s32	priority;
+	__s32	nice;
+	__u32	processor;
+	__u32	__pad;
+	__u64	task_flags;
+	__u64	min_flt;
+	__u64	maj_flt;
+	__u64	utime;
+	__u64	stime;
+	__u64	start_time;		/* since boot, including suspend */
+
+	/* /proc/<pid>/status */
+	__u64	vm_peak;
+	__u64	vm_size;
+	__u64	vm_lck;
+	__u64	vm_pin;
+	__u64	vm_hwm;
+	__u64	vm_rss;
+	__u64	rss_anon;
+	__u64	rss_file;
+	__u64	rss_shmem;
+	__u64	vm_data;
+	__u64	vm_stk;
+	__u64	vm_exe;
+	__u64	vm_lib;
+	__u64	vm_pte;
+	__u64	vm_swap;
+
+	/* /proc/<pid>/smaps_rollup, see PROC_PIDSTATS_ROLLUP */
+	__u64	rss;
+	__u64	pss;
+	__u64	pss_anon;
+	__u64	pss_file;
+	__u64	pss_shmem;
+	__u64	shared_clean;
+	__u64	shared_dirty;
+	__u64	private_clean;
+	__u64	private_dirty;
+	__u64	referenced;
+	__u64	anonymous;
+	__u64	lazyfree;
+	__u64	anon_huge;
+	__u64	swap;
+	__u64	swap_pss;
+	__u64	locked;
+};
+
+#endif /* _UAPI_LINUX_PROC_PIDSTATS_H */
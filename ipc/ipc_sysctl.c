@@ -150,6 +150,24 @@ static struct ctl_table ipc_kern_table[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_ONE,
 	},
+	{
+		.procname	= "shm_populate",
+		.data		= &init_ipc_ns.shm_populate,
+		.maxlen		= sizeof(init_ipc_ns.shm_populate),
+		.mode		= 0644,
+		.proc_handler	= proc_ipc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+	{
+		.procname	= "shm_hugepage",
+		.data		= &init_ipc_ns.shm_hugepage,
+		.maxlen		= sizeof(init_ipc_ns.shm_hugepage),
+		.mode		= 0644,
+		.proc_handler	= proc_ipc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{
 		.procname	= "msgmax",
 		.data		= &init_ipc_ns.msg_ctlmax,
@@ -138,6 +138,7 @@ struct mqueue_inode_info {
 	struct rb_root msg_tree;
 	struct rb_node *msg_tree_rightmost;
 	struct posix_msg_tree_node *node_cache;
+	struct msg_msg *msg_spare;	/* received buffer kept for reuse */
 	struct mq_attr attr;
 
 	struct sigevent notify;
@@ -325,6 +326,7 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		info->msg_tree = RB_ROOT;
 		info->msg_tree_rightmost = NULL;
 		info->node_cache = NULL;
+		info->msg_spare = NULL;
 		memset(&info->attr, 0, sizeof(info->attr));
 		info->attr.mq_maxmsg = min(ipc_ns->mq_msg_max,
 					   ipc_ns->mq_msg_default);
@@ -519,6 +521,8 @@ static void mqueue_evict_inode(struct inode *inode)
 		list_del(&msg->m_list);
 		free_msg(msg);
 	}
+	if (info->msg_spare)
+		free_msg(info->msg_spare);
 
 	user = info->user;
 	if (user) {
@@ -1025,6 +1029,33 @@ static inline void pipelined_receive(struct wake_q_head *wake_q,
 	__pipelined_op(wake_q, info, sender);
 }
 
+/*
+ * Each queue keeps the buffer of the last received message around, so
+ * that a stream of similarly sized messages does not have to go through
+ * kmalloc()/kfree() for every send/receive pair. The spare is handed
+ * over with xchg()/cmpxchg() and needs no info->lock.
+ */
+static struct msg_msg *mq_load_msg(struct mqueue_inode_info *info,
+				   const char __user *src, size_t len)
+{
+	struct msg_msg *spare, *msg;
+
+	spare = xchg(&info->msg_spare, NULL);
+	if (spare) {
+		msg = reload_msg(spare, src, len);
+		if (msg)
+			return msg;
+		free_msg(spare);
+	}
+	return load_msg(src, len);
+}
+
+static void mq_put_msg(struct mqueue_inode_info *info, struct msg_msg *msg)
+{
+	if (cmpxchg(&info->msg_spare, NULL, msg))
+		free_msg(msg);
+}
+
 static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 		size_t msg_len, unsigned int msg_prio,
 		struct timespec64 *ts)
@@ -1076,7 +1107,7 @@ static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 
 	/* First try to allocate memory, before doing anything with
 	 * existing queues. */
-	msg_ptr = load_msg(u_msg_ptr, msg_len);
+	msg_ptr = mq_load_msg(info, u_msg_ptr, msg_len);
 	if (IS_ERR(msg_ptr)) {
 		ret = PTR_ERR(msg_ptr);
 		goto out_fput;
@@ -1241,7 +1272,7 @@ static int do_mq_timedreceive(mqd_t mqdes, char __user *u_msg_ptr,
 			store_msg(u_msg_ptr, msg_ptr, msg_ptr->m_ts)) {
 			ret = -EFAULT;
 		}
-		free_msg(msg_ptr);
+		mq_put_msg(info, msg_ptr);
 	}
 out_fput:
 	fdput(f);
@@ -39,6 +39,7 @@
 #include <linux/nsproxy.h>
 #include <linux/ipc_namespace.h>
 #include <linux/rhashtable.h>
+#include <linux/percpu.h>
 
 #include <asm/current.h>
 #include <linux/uaccess.h>
@@ -835,6 +836,35 @@ static inline int pipelined_send(struct msg_queue *msq, struct msg_msg *msg,
 	return 0;
 }
 
+/*
+ * Each CPU keeps the buffer of the last message received on it, so that
+ * a send/receive ping-pong of similarly sized messages does not have to
+ * go through kmalloc()/kfree() for every message. The queue itself cannot
+ * hold the spare: it is not pinned while the message is copied to or
+ * from user space.
+ */
+static DEFINE_PER_CPU(struct msg_msg *, msg_spare);
+
+static struct msg_msg *msg_load(const void __user *src, size_t len)
+{
+	struct msg_msg *spare, *msg;
+
+	spare = this_cpu_xchg(msg_spare, NULL);
+	if (spare) {
+		msg = reload_msg(spare, src, len);
+		if (msg)
+			return msg;
+		free_msg(spare);
+	}
+	return load_msg(src, len);
+}
+
+static void msg_put(struct msg_msg *msg)
+{
+	if (this_cpu_cmpxchg(msg_spare, NULL, msg))
+		free_msg(msg);
+}
+
 static long do_msgsnd(int msqid, long mtype, void __user *mtext,
 		size_t msgsz, int msgflg)
 {
@@ -851,7 +881,7 @@ static long do_msgsnd(int msqid, long mtype, void __user *mtext,
 	if (mtype < 1)
 		return -EINVAL;
 
-	msg = load_msg(mtext, msgsz);
+	msg = msg_load(mtext, msgsz);
 	if (IS_ERR(msg))
 		return PTR_ERR(msg);
 
@@ -944,7 +974,7 @@ static long do_msgsnd(int msqid, long mtype, void __user *mtext,
 out_unlock1:
 	rcu_read_unlock();
 	if (msg != NULL)
-		free_msg(msg);
+		msg_put(msg);
 	return err;
 }
 
@@ -1246,7 +1276,7 @@ static long do_msgrcv(int msqid, void __user *buf, size_t bufsz, long msgtyp, in
 	}
 
 	bufsz = msg_handler(buf, msg, bufsz);
-	free_msg(msg);
+	msg_put(msg);
 
 	return bufsz;
 }
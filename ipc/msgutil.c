@@ -110,6 +110,38 @@ struct msg_msg *load_msg(const void __user *src, size_t len)
 
 	return msg;
 
+out_err:
+	free_msg(msg);
+	return ERR_PTR(err);
+}
+
+/*
+ * Reuse @msg, a message earlier returned by load_msg(), to load a new
+ * message of @len bytes from @src. Returns NULL, leaving @msg untouched,
+ * if it is not a single-segment buffer large enough for @len bytes.
+ * On any other failure @msg is freed.
+ */
+struct msg_msg *reload_msg(struct msg_msg *msg, const void __user *src,
+			   size_t len)
+{
+	int err;
+
+	if (msg->next || len > DATALEN_MSG ||
+	    ksize(msg) < sizeof(*msg) + len)
+		return NULL;
+
+	security_msg_msg_free(msg);
+
+	err = -EFAULT;
+	if (copy_from_user(msg + 1, src, len))
+		goto out_err;
+
+	err = security_msg_msg_alloc(msg);
+	if (err)
+		goto out_err;
+
+	return msg;
+
 out_err:
 	free_msg(msg);
 	return ERR_PTR(err);
@@ -103,9 +103,9 @@ struct sem {
 	 */
 	struct pid *sempid;
 	spinlock_t	lock;	/* spinlock for fine-grained semtimedop */
-	struct list_head pending_alter; /* pending single-sop operations */
+	struct list_head pending_alter; /* pending single-sem operations */
 					/* that alter the semaphore */
-	struct list_head pending_const; /* pending single-sop operations */
+	struct list_head pending_const; /* pending single-sem operations */
 					/* that do not alter the semaphore*/
 	time64_t	 sem_otime;	/* candidate for sem_otime */
 } ____cacheline_aligned_in_smp;
@@ -138,6 +138,7 @@ struct sem_queue {
 	int			nsops;	 /* number of operations */
 	bool			alter;	 /* does *sops alter the array? */
 	bool                    dupsop;	 /* sops on more than one sem_num */
+	bool			complex; /* counted in complex_count */
 };
 
 /* Each task has a list of undo requests. They are executed automatically
@@ -375,9 +376,34 @@ static void complexmode_tryleave(struct sem_array *sma)
 	}
 }
 
+/*
+ * Returns true if the @nsops operations in @sops can be handled like a
+ * single-sop request: they only need the per-semaphore lock and sleep on
+ * the per-semaphore queues.  That is the case for one sop, or for several
+ * that all target the same semaphore and none of which waits for zero:
+ * update_queue() stops scanning a pending_alter list once semval is 0,
+ * and count_semcnt() counts every entry on it as waiting for a nonzero
+ * value.
+ */
+static inline bool sem_ops_single(struct sembuf *sops, int nsops)
+{
+	int i;
+
+	if (nsops < 1)
+		return false;
+	if (nsops == 1)
+		return true;
+
+	for (i = 0; i < nsops; i++) {
+		if (sops[i].sem_num != sops[0].sem_num || !sops[i].sem_op)
+			return false;
+	}
+	return true;
+}
+
 #define SEM_GLOBAL_LOCK	(-1)
 /*
- * If the request contains only one semaphore operation, and there are
+ * If the request only operates on one semaphore, and there are
  * no complex transactions pending, lock only the semaphore involved.
  * Otherwise, lock the entire semaphore array, since we either have
  * multiple semaphores in our own semops, or we need to look at
@@ -389,7 +415,7 @@ static inline int sem_lock(struct sem_array *sma, struct sembuf *sops,
 	struct sem *sem;
 	int idx;
 
-	if (nsops != 1) {
+	if (!sem_ops_single(sops, nsops)) {
 		/* Complex operation - acquire a full lock */
 		ipc_lock_object(&sma->sem_perm);
 
@@ -796,7 +822,7 @@ static inline void wake_up_sem_queue_prepare(struct sem_queue *q, int error,
 static void unlink_queue(struct sem_array *sma, struct sem_queue *q)
 {
 	list_del(&q->list);
-	if (q->nsops > 1)
+	if (q->complex)
 		sma->complex_count--;
 }
 
@@ -1988,7 +2014,7 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 	struct sembuf *sops = fast_sops, *sop;
 	struct sem_undo *un;
 	int max, locknum;
-	bool undos = false, alter = false, dupsop = false;
+	bool undos = false, alter = false, dupsop = false, single;
 	struct sem_queue queue;
 	unsigned long dup = 0, jiffies_left = 0;
 	struct ipc_namespace *ns;
@@ -2041,6 +2067,7 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 			dup |= mask;
 		}
 	}
+	single = sem_ops_single(sops, nsops);
 
 	if (undos) {
 		/* On success, find_alloc_undo takes the rcu_read_lock */
@@ -2084,9 +2111,9 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 	/*
 	 * We eventually might perform the following check in a lockless
 	 * fashion, considering ipc_valid_object() locking constraints.
-	 * If nsops == 1 and there is no contention for sem_perm.lock, then
-	 * only a per-semaphore lock is held and it's OK to proceed with the
-	 * check below. More details on the fine grained locking scheme
+	 * If all sops target one semaphore and there is no contention for
+	 * sem_perm.lock, then only a per-semaphore lock is held and it's OK
+	 * to proceed with the check below. More details on the fine grained locking scheme
 	 * entangled here and why it's RMID race safe on comments at sem_lock()
 	 */
 	if (!ipc_valid_object(&sma->sem_perm))
@@ -2107,6 +2134,7 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 	queue.pid = task_tgid(current);
 	queue.alter = alter;
 	queue.dupsop = dupsop;
+	queue.complex = !single;
 
 	error = perform_atomic_semop(sma, &queue);
 	if (error == 0) { /* non-blocking succesfull path */
@@ -2133,8 +2161,10 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 	/*
 	 * We need to sleep on this operation, so we put the current
 	 * task into the pending queue and go to sleep.
+	 * Several sops that only alter one semaphore sleep on that
+	 * semaphore's queues like single-sop ones, see sem_ops_single().
 	 */
-	if (nsops == 1) {
+	if (single) {
 		struct sem *curr;
 		int idx = array_index_nospec(sops->sem_num, sma->sem_nsems);
 		curr = &sma->sems[idx];
@@ -102,6 +102,8 @@ void shm_init_ns(struct ipc_namespace *ns)
 	ns->shm_ctlall = SHMALL;
 	ns->shm_ctlmni = SHMMNI;
 	ns->shm_rmid_forced = 0;
+	ns->shm_populate = 0;
+	ns->shm_hugepage = 0;
 	ns->shm_tot = 0;
 	ipc_init_ids(&shm_ids(ns));
 }
@@ -506,6 +508,14 @@ static int shm_mmap(struct file *file, struct vm_area_struct *vma)
 	sfd->vm_ops = vma->vm_ops;
 #ifdef CONFIG_MMU
 	WARN_ON(!sfd->vm_ops->fault);
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	/*
+	 * Behaves like madvise(MADV_HUGEPAGE) on the attach: shmem then
+	 * allocates huge pages if shmem_enabled is not "never" or "deny".
+	 */
+	if (sfd->ns->shm_hugepage && !is_file_hugepages(sfd->file))
+		vma->vm_flags |= VM_HUGEPAGE;
 #endif
 	vma->vm_ops = &shm_vm_ops;
 	return 0;
@@ -1540,6 +1550,9 @@ long do_shmat(int shmid, char __user *shmaddr, int shmflg,
 	sfd->vm_ops = NULL;
 	file->private_data = sfd;
 
+	if (ns->shm_populate)
+		flags |= MAP_POPULATE;
+
 	err = security_mmap_file(file, prot, flags);
 	if (err)
 		goto out_fput;
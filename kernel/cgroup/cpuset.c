@@ -966,6 +966,68 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
 	mutex_unlock(&sched_domains_mutex);
 }
 
+/*
+ * Copy of the domains last handed to the scheduler.  Most cpuset updates,
+ * e.g. moving CPUs between cpusets that aren't partition roots, generate
+ * the very same domains again; those skip the rebuild and the walk over
+ * every task in rebuild_root_domains().  Protected by cpuset_rwsem.
+ */
+static struct cpumask *last_doms;
+static struct sched_domain_attr *last_attr;
+static int last_ndoms;
+
+static inline struct cpumask *last_dom(int i)
+{
+	return (void *)last_doms + i * cpumask_size();
+}
+
+static bool sched_domains_unchanged(int ndoms, cpumask_var_t doms[],
+				    struct sched_domain_attr *attr)
+{
+	int i;
+
+	if (!doms || ndoms != last_ndoms || !attr != !last_attr)
+		return false;
+
+	for (i = 0; i < ndoms; i++) {
+		if (!cpumask_equal(doms[i], last_dom(i)))
+			return false;
+		if (attr && memcmp(&attr[i], &last_attr[i], sizeof(*attr)))
+			return false;
+	}
+	return true;
+}
+
+static void sched_domains_save(int ndoms, cpumask_var_t doms[],
+			       struct sched_domain_attr *attr)
+{
+	int i;
+
+	kfree(last_doms);
+	kfree(last_attr);
+	last_doms = NULL;
+	last_attr = NULL;
+	last_ndoms = 0;
+
+	if (!doms)
+		return;
+
+	last_doms = kmalloc_array(ndoms, cpumask_size(), GFP_KERNEL);
+	if (attr)
+		last_attr = kmemdup(attr, ndoms * sizeof(*attr), GFP_KERNEL);
+	if (!last_doms || (attr && !last_attr)) {
+		kfree(last_doms);
+		kfree(last_attr);
+		last_doms = NULL;
+		last_attr = NULL;
+		return;
+	}
+
+	for (i = 0; i < ndoms; i++)
+		cpumask_copy(last_dom(i), doms[i]);
+	last_ndoms = ndoms;
+}
+
 /*
  * Rebuild scheduler domains.
  *
@@ -975,9 +1037,14 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
  * 'cpus' is removed, then call this routine to rebuild the
  * scheduler's dynamic sched domains.
  *
+ * Unless @force is set, nothing is done if the cpusets still yield the
+ * domains that were last built.  @force is for callers that need the
+ * domains rebuilt even if they are the same, e.g. after CPU hotplug or
+ * an architecture topology update.
+ *
  * Call with cpuset_mutex held.  Takes get_online_cpus().
  */
-static void rebuild_sched_domains_locked(void)
+static void __rebuild_sched_domains_locked(bool force)
 {
 	struct sched_domain_attr *attr;
 	cpumask_var_t *doms;
@@ -1002,10 +1069,59 @@ static void rebuild_sched_domains_locked(void)
 	/* Generate domain masks and attrs */
 	ndoms = generate_sched_domains(&doms, &attr);
 
+	if (!force && sched_domains_unchanged(ndoms, doms, attr)) {
+		free_sched_domains(doms, ndoms);
+		kfree(attr);
+		return;
+	}
+	sched_domains_save(ndoms, doms, attr);
+
 	/* Have scheduler rebuild the domains */
 	partition_and_rebuild_sched_domains(ndoms, doms, attr);
 }
+
+/*
+ * With "cpuset_rebuild_delay_ms=", sched domain rebuilds triggered by
+ * cpuset writes are deferred by that long, so that a burst of writes (e.g.
+ * a batch of containers starting) is served by a single rebuild.
+ */
+static unsigned long cpuset_rebuild_delay __read_mostly;
+
+static int __init cpuset_rebuild_delay_setup(char *str)
+{
+	unsigned int ms;
+
+	if (kstrtouint(str, 0, &ms))
+		return 0;
+
+	cpuset_rebuild_delay = msecs_to_jiffies(ms);
+	return 1;
+}
+__setup("cpuset_rebuild_delay_ms=", cpuset_rebuild_delay_setup);
+
+static void cpuset_rebuild_workfn(struct work_struct *work)
+{
+	get_online_cpus();
+	percpu_down_write(&cpuset_rwsem);
+	__rebuild_sched_domains_locked(false);
+	percpu_up_write(&cpuset_rwsem);
+	put_online_cpus();
+}
+static DECLARE_DELAYED_WORK(cpuset_rebuild_work, cpuset_rebuild_workfn);
+
+static void rebuild_sched_domains_locked(void)
+{
+	if (cpuset_rebuild_delay)
+		schedule_delayed_work(&cpuset_rebuild_work,
+				      cpuset_rebuild_delay);
+	else
+		__rebuild_sched_domains_locked(false);
+}
 #else /* !CONFIG_SMP */
+static void __rebuild_sched_domains_locked(bool force)
+{
+}
+
 static void rebuild_sched_domains_locked(void)
 {
 }
@@ -1015,7 +1131,7 @@ void rebuild_sched_domains(void)
 {
 	get_online_cpus();
 	percpu_down_write(&cpuset_rwsem);
-	rebuild_sched_domains_locked();
+	__rebuild_sched_domains_locked(true);
 	percpu_up_write(&cpuset_rwsem);
 	put_online_cpus();
 }
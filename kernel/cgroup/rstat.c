@@ -6,6 +6,25 @@
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * Readers of the statistics skip the flush if the cgroup or one of its
+ * ancestors was flushed less than this long ago, bounding the staleness of
+ * what they see.  Set with "cgroup_rstat_flush_ms=", 0 always flushes.
+ */
+static unsigned long cgroup_rstat_flush_interval __read_mostly;
+
+static int __init cgroup_rstat_flush_ms_setup(char *str)
+{
+	unsigned int ms;
+
+	if (kstrtouint(str, 0, &ms))
+		return 0;
+
+	cgroup_rstat_flush_interval = msecs_to_jiffies(ms);
+	return 1;
+}
+__setup("cgroup_rstat_flush_ms=", cgroup_rstat_flush_ms_setup);
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -156,11 +175,26 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 
 	lockdep_assert_held(&cgroup_rstat_lock);
 
+	cgrp->rstat_flush_time = jiffies;
+
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
+		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
 		struct cgroup *pos = NULL;
 
+		/*
+		 * Nothing in @cgrp's subtree was updated on @cpu, don't bother
+		 * with the lock.  An update racing with this check is no
+		 * different from one coming right after the flush.  The root
+		 * is never put on an updated list, so its own per-cpu stats
+		 * can't be told apart and it is always flushed.
+		 */
+		if (cgroup_parent(cgrp) &&
+		    READ_ONCE(rstatc->updated_children) == cgrp &&
+		    !READ_ONCE(rstatc->updated_next))
+			continue;
+
 		raw_spin_lock(cpu_lock);
 		while ((pos = cgroup_rstat_cpu_pop_updated(pos, cgrp, cpu))) {
 			struct cgroup_subsys_state *css;
@@ -223,12 +257,27 @@ void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
 	spin_unlock_irqrestore(&cgroup_rstat_lock, flags);
 }
 
+/* see cgroup_rstat_flush_interval */
+static bool cgroup_rstat_flushed_recently(struct cgroup *cgrp)
+{
+	if (!cgroup_rstat_flush_interval)
+		return false;
+
+	for (; cgrp; cgrp = cgroup_parent(cgrp)) {
+		if (time_before(jiffies, cgrp->rstat_flush_time +
+					 cgroup_rstat_flush_interval))
+			return true;
+	}
+	return false;
+}
+
 /**
  * cgroup_rstat_flush_begin - flush stats in @cgrp's subtree and hold
  * @cgrp: target cgroup
  *
  * Flush stats in @cgrp's subtree and prevent further flushes.  Must be
- * paired with cgroup_rstat_flush_release().
+ * paired with cgroup_rstat_flush_release().  The flush is skipped if the
+ * stats are no older than "cgroup_rstat_flush_ms=".
  *
  * This function may block.
  */
@@ -237,7 +286,8 @@ void cgroup_rstat_flush_hold(struct cgroup *cgrp)
 {
 	might_sleep();
 	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
+	if (!cgroup_rstat_flushed_recently(cgrp))
+		cgroup_rstat_flush_locked(cgrp, true);
 }
 
 /**
@@ -260,6 +310,9 @@ int cgroup_rstat_init(struct cgroup *cgrp)
 			return -ENOMEM;
 	}
 
+	/* not flushed yet, whatever jiffies is */
+	cgrp->rstat_flush_time = jiffies - cgroup_rstat_flush_interval - 1;
+
 	/* ->updated_children list is self terminated */
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
@@ -23,6 +23,16 @@
  */
 unsigned int zone_dma_bits __ro_after_init = 24;
 
+/*
+ * With CONFIG_DMA_DIRECT_MERGE_SG, dma_direct_map_sg() coalesces physically
+ * contiguous entries into one DMA segment and leaves a zero DMA length in
+ * the entries it merged away, which the unmap and sync helpers skip.
+ */
+static inline bool dma_direct_sg_merged(struct scatterlist *sg)
+{
+	return IS_ENABLED(CONFIG_DMA_DIRECT_MERGE_SG) && !sg_dma_len(sg);
+}
+
 static inline dma_addr_t phys_to_dma_direct(struct device *dev,
 		phys_addr_t phys)
 {
@@ -267,12 +277,15 @@ void dma_direct_sync_sg_for_device(struct device *dev,
 	for_each_sg(sgl, sg, nents, i) {
 		phys_addr_t paddr = dma_to_phys(dev, sg_dma_address(sg));
 
+		if (dma_direct_sg_merged(sg))
+			continue;
+
 		if (unlikely(is_swiotlb_buffer(paddr)))
-			swiotlb_tbl_sync_single(dev, paddr, sg->length,
+			swiotlb_tbl_sync_single(dev, paddr, sg_dma_len(sg),
 					dir, SYNC_FOR_DEVICE);
 
 		if (!dev_is_dma_coherent(dev))
-			arch_sync_dma_for_device(paddr, sg->length,
+			arch_sync_dma_for_device(paddr, sg_dma_len(sg),
 					dir);
 	}
 }
@@ -306,11 +319,14 @@ void dma_direct_sync_sg_for_cpu(struct device *dev,
 	for_each_sg(sgl, sg, nents, i) {
 		phys_addr_t paddr = dma_to_phys(dev, sg_dma_address(sg));
 
+		if (dma_direct_sg_merged(sg))
+			continue;
+
 		if (!dev_is_dma_coherent(dev))
-			arch_sync_dma_for_cpu(paddr, sg->length, dir);
+			arch_sync_dma_for_cpu(paddr, sg_dma_len(sg), dir);
 
 		if (unlikely(is_swiotlb_buffer(paddr)))
-			swiotlb_tbl_sync_single(dev, paddr, sg->length, dir,
+			swiotlb_tbl_sync_single(dev, paddr, sg_dma_len(sg), dir,
 					SYNC_FOR_CPU);
 	}
 
@@ -338,9 +354,12 @@ void dma_direct_unmap_sg(struct device *dev, struct scatterlist *sgl,
 	struct scatterlist *sg;
 	int i;
 
-	for_each_sg(sgl, sg, nents, i)
+	for_each_sg(sgl, sg, nents, i) {
+		if (dma_direct_sg_merged(sg))
+			continue;
 		dma_direct_unmap_page(dev, sg->dma_address, sg_dma_len(sg), dir,
 			     attrs);
+	}
 }
 EXPORT_SYMBOL(dma_direct_unmap_sg);
 #endif
@@ -371,12 +390,98 @@ dma_addr_t dma_direct_map_page(struct device *dev, struct page *page,
 }
 EXPORT_SYMBOL(dma_direct_map_page);
 
+#ifdef CONFIG_DMA_DIRECT_MERGE_SG
+static bool dma_direct_sg_can_merge(struct device *dev, phys_addr_t start,
+		size_t len, struct scatterlist *sg)
+{
+	dma_addr_t dma_start = phys_to_dma(dev, start);
+	unsigned long boundary = dma_get_seg_boundary(dev);
+
+	if (start + len != sg_phys(sg))
+		return false;
+	if (len + sg->length > dma_get_max_seg_size(dev))
+		return false;
+	/* the merged segment must not cross a segment boundary */
+	return !((dma_start ^ (dma_start + len + sg->length - 1)) & ~boundary);
+}
+
+static bool dma_direct_map_sg_seg(struct device *dev, struct scatterlist *out,
+		phys_addr_t start, size_t len, enum dma_data_direction dir,
+		unsigned long attrs)
+{
+	dma_addr_t dma_addr = phys_to_dma(dev, start);
+
+	if (unlikely(!dma_capable(dev, dma_addr, len, true)))
+		return false;
+
+	if (!dev_is_dma_coherent(dev) && !(attrs & DMA_ATTR_SKIP_CPU_SYNC))
+		arch_sync_dma_for_device(start, len, dir);
+	out->dma_address = dma_addr;
+	sg_dma_len(out) = len;
+	return true;
+}
+
+/*
+ * Map runs of physically contiguous entries as one segment each, so that a
+ * non-coherent device gets one cache maintenance call per run instead of
+ * one per entry.  Returns 0 if a run is not directly addressable by the
+ * device, in which case the caller maps the list entry by entry, bouncing
+ * through swiotlb where needed.
+ */
+static int dma_direct_map_sg_merge(struct device *dev, struct scatterlist *sgl,
+		int nents, enum dma_data_direction dir, unsigned long attrs)
+{
+	struct scatterlist *sg, *out = sgl;
+	phys_addr_t start = sg_phys(sgl);
+	size_t len = sgl->length;
+	int i, count = 1;
+
+	for_each_sg(sg_next(sgl), sg, nents - 1, i) {
+		if (dma_direct_sg_can_merge(dev, start, len, sg)) {
+			len += sg->length;
+			continue;
+		}
+
+		if (!dma_direct_map_sg_seg(dev, out, start, len, dir, attrs))
+			goto out_unmap;
+
+		out = sg_next(out);
+		count++;
+		start = sg_phys(sg);
+		len = sg->length;
+	}
+
+	if (!dma_direct_map_sg_seg(dev, out, start, len, dir, attrs))
+		goto out_unmap;
+
+	/* tell unmap and sync about the entries that were merged away */
+	for (sg = sg_next(out), i = count; i < nents; sg = sg_next(sg), i++)
+		sg_dma_len(sg) = 0;
+
+	return count;
+
+out_unmap:
+	dma_direct_unmap_sg(dev, sgl, count - 1, dir,
+			    attrs | DMA_ATTR_SKIP_CPU_SYNC);
+	return 0;
+}
+#endif
+
 int dma_direct_map_sg(struct device *dev, struct scatterlist *sgl, int nents,
 		enum dma_data_direction dir, unsigned long attrs)
 {
 	int i;
 	struct scatterlist *sg;
 
+#ifdef CONFIG_DMA_DIRECT_MERGE_SG
+	if (nents > 1 && likely(swiotlb_force != SWIOTLB_FORCE)) {
+		int count = dma_direct_map_sg_merge(dev, sgl, nents, dir, attrs);
+
+		if (count)
+			return count;
+	}
+#endif
+
 	for_each_sg(sgl, sg, nents, i) {
 		sg->dma_address = dma_direct_map_page(dev, sg_page(sg),
 				sg->offset, sg->length, dir, attrs);
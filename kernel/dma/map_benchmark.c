@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure dma_map_sg()/dma_unmap_sg() cost for a range of scatterlist sizes.
+ *
+ * The mappings are made for a dummy platform device with no IOMMU, so they
+ * go through dma-direct.  Whether cache maintenance is done depends on the
+ * architecture's default coherency for such a device.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/dma-mapping.h>
+#include <linux/dma-noncoherent.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+static unsigned int max_nents = 256;
+module_param(max_nents, uint, 0444);
+MODULE_PARM_DESC(max_nents, "largest scatterlist to map, in PAGE_SIZE entries");
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "number of map/unmap cycles per scatterlist size");
+
+static bool contiguous = true;
+module_param(contiguous, bool, 0444);
+MODULE_PARM_DESC(contiguous, "back the scatterlist with physically contiguous pages");
+
+static int dir = DMA_TO_DEVICE;
+module_param(dir, int, 0444);
+MODULE_PARM_DESC(dir, "DMA direction (0: bidirectional, 1: to device, 2: from device)");
+
+static struct page **map_bench_alloc_pages(unsigned int nr)
+{
+	struct page **pages, *page;
+	unsigned int i;
+
+	pages = kcalloc(nr, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return NULL;
+
+	if (contiguous) {
+		page = alloc_pages(GFP_KERNEL, get_order(nr * PAGE_SIZE));
+		if (!page)
+			goto err;
+		split_page(page, get_order(nr * PAGE_SIZE));
+		for (i = 0; i < nr; i++)
+			pages[i] = page + i;
+		/* release the tail of the order we had to round up to */
+		for (i = nr; i < 1U << get_order(nr * PAGE_SIZE); i++)
+			__free_page(page + i);
+		return pages;
+	}
+
+	for (i = 0; i < nr; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i])
+			goto err;
+	}
+	return pages;
+
+err:
+	for (i = 0; i < nr && pages[i]; i++)
+		__free_page(pages[i]);
+	kfree(pages);
+	return NULL;
+}
+
+static void map_bench_free_pages(struct page **pages, unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		__free_page(pages[i]);
+	kfree(pages);
+}
+
+static int map_bench_run(struct device *dev, struct scatterlist *sgl,
+			 struct page **pages, unsigned int nents)
+{
+	u64 map_ns = 0, unmap_ns = 0;
+	unsigned int i;
+	ktime_t t0, t1;
+	int count = 0;
+
+	sg_init_table(sgl, nents);
+	for (i = 0; i < nents; i++)
+		sg_set_page(&sgl[i], pages[i], PAGE_SIZE, 0);
+
+	for (i = 0; i < iterations; i++) {
+		t0 = ktime_get();
+		count = dma_map_sg(dev, sgl, nents, dir);
+		t1 = ktime_get();
+		if (!count)
+			return -ENOMEM;
+		map_ns += ktime_to_ns(ktime_sub(t1, t0));
+
+		t0 = ktime_get();
+		dma_unmap_sg(dev, sgl, nents, dir);
+		t1 = ktime_get();
+		unmap_ns += ktime_to_ns(ktime_sub(t1, t0));
+
+		cond_resched();
+	}
+
+	pr_info("%4u entries -> %4d segments: map %llu ns, unmap %llu ns\n",
+		nents, count, div_u64(map_ns, iterations),
+		div_u64(unmap_ns, iterations));
+	return 0;
+}
+
+static int __init map_bench_init(void)
+{
+	struct platform_device *pdev;
+	struct scatterlist *sgl;
+	struct page **pages;
+	unsigned int nents;
+	int ret;
+
+	if (!max_nents || !iterations || !valid_dma_direction(dir) ||
+	    dir == DMA_NONE)
+		return -EINVAL;
+
+	pdev = platform_device_register_simple(KBUILD_MODNAME, -1, NULL, 0);
+	if (IS_ERR(pdev))
+		return PTR_ERR(pdev);
+
+	ret = dma_set_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(64));
+	if (ret)
+		goto out_unregister;
+
+	ret = -ENOMEM;
+	sgl = kmalloc_array(max_nents, sizeof(*sgl), GFP_KERNEL);
+	if (!sgl)
+		goto out_unregister;
+
+	pages = map_bench_alloc_pages(max_nents);
+	if (!pages)
+		goto out_free_sgl;
+
+	pr_info("%u iterations, %s pages, %scoherent device\n", iterations,
+		contiguous ? "contiguous" : "scattered",
+		dev_is_dma_coherent(&pdev->dev) ? "" : "non-");
+
+	for (nents = 1; nents <= max_nents; nents *= 2) {
+		ret = map_bench_run(&pdev->dev, sgl, pages, nents);
+		if (ret)
+			break;
+	}
+
+	map_bench_free_pages(pages, max_nents);
+out_free_sgl:
+	kfree(sgl);
+out_unregister:
+	platform_device_unregister(pdev);
+
+	/* nothing to keep loaded, fail the load after a successful run */
+	return ret ? ret : -EAGAIN;
+}
+module_init(map_bench_init);
+
+MODULE_DESCRIPTION("DMA mapping benchmark");
+MODULE_LICENSE("GPL v2");
@@ -33,6 +33,7 @@
 #include <linux/ctype.h>
 #include <linux/highmem.h>
 #include <linux/gfp.h>
+#include <linux/slab.h>
 #include <linux/scatterlist.h>
 #include <linux/mem_encrypt.h>
 #include <linux/set_memory.h>
@@ -77,17 +78,32 @@ phys_addr_t io_tlb_start, io_tlb_end;
  */
 static unsigned long io_tlb_nslabs;
 
-/*
- * The number of used IO TLB block
- */
-static unsigned long io_tlb_used;
-
 /*
  * This is a free list describing the number of free entries available from
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
+
+/*
+ * The slabs are split into areas of io_tlb_area_nslabs slabs (the last one
+ * takes the remainder), each with its own lock, so that CPUs mapping bounce
+ * buffers at the same time don't all contend on a single lock.  A CPU starts
+ * looking in its own area and falls back to the others when it is full.
+ * Areas are made of whole IO_TLB_SEGSIZE segments, so that the free list
+ * never links slots of different areas.
+ */
+struct io_tlb_area {
+	spinlock_t lock;	/* protects the fields below and io_tlb_list */
+	unsigned long used;	/* number of used slabs */
+	unsigned int index;	/* where to start the next search */
+};
+
+static struct io_tlb_area *io_tlb_areas;
+static unsigned int io_tlb_nareas;
+static unsigned long io_tlb_area_nslabs;
+
+/* Number of areas requested with "swiotlb=<slabs>,<areas>", 0 for default */
+static unsigned int default_nareas;
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -102,11 +118,6 @@ unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
-/*
- * Protect the above data structures in the map and unmap calls
- */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
 static int late_alloc;
 
 static int __init
@@ -119,6 +130,11 @@ setup_io_tlb_npages(char *str)
 	}
 	if (*str == ',')
 		++str;
+	if (isdigit(*str)) {
+		default_nareas = simple_strtoul(str, &str, 0);
+		if (*str == ',')
+			++str;
+	}
 	if (!strcmp(str, "force")) {
 		swiotlb_force = SWIOTLB_FORCE;
 	} else if (!strcmp(str, "noforce")) {
@@ -198,8 +214,64 @@ void __init swiotlb_update_mem_attributes(void)
 	memset(vaddr, 0, bytes);
 }
 
+/*
+ * One area per possible CPU unless told otherwise, but no more than there
+ * are segments to go around.
+ */
+static unsigned int swiotlb_nr_areas(unsigned long nslabs)
+{
+	unsigned int nareas = default_nareas ?: num_possible_cpus();
+
+	return clamp_t(unsigned long, nareas, 1, nslabs / IO_TLB_SEGSIZE ?: 1);
+}
+
+static void swiotlb_init_areas(unsigned int nareas)
+{
+	unsigned int i;
+
+	io_tlb_nareas = nareas;
+	io_tlb_area_nslabs = rounddown(io_tlb_nslabs / nareas, IO_TLB_SEGSIZE);
+	/* less than a segment, see swiotlb_nr_areas() */
+	if (!io_tlb_area_nslabs)
+		io_tlb_area_nslabs = io_tlb_nslabs;
+
+	for (i = 0; i < io_tlb_nareas; i++) {
+		spin_lock_init(&io_tlb_areas[i].lock);
+		io_tlb_areas[i].used = 0;
+		io_tlb_areas[i].index = i * io_tlb_area_nslabs;
+	}
+}
+
+static inline unsigned int swiotlb_area_start(unsigned int area)
+{
+	return area * io_tlb_area_nslabs;
+}
+
+static inline unsigned int swiotlb_area_end(unsigned int area)
+{
+	return area == io_tlb_nareas - 1 ? io_tlb_nslabs :
+	       swiotlb_area_start(area + 1);
+}
+
+static inline unsigned int swiotlb_index_to_area(unsigned int index)
+{
+	return min_t(unsigned int, index / io_tlb_area_nslabs,
+		     io_tlb_nareas - 1);
+}
+
+static unsigned long swiotlb_used(void)
+{
+	unsigned long used = 0;
+	unsigned int i;
+
+	for (i = 0; i < io_tlb_nareas; i++)
+		used += READ_ONCE(io_tlb_areas[i].used);
+	return used;
+}
+
 int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 {
+	unsigned int nareas = swiotlb_nr_areas(nslabs);
 	unsigned long i, bytes;
 	size_t alloc_size;
 
@@ -226,11 +298,17 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		panic("%s: Failed to allocate %zu bytes align=0x%lx\n",
 		      __func__, alloc_size, PAGE_SIZE);
 
+	alloc_size = PAGE_ALIGN(array_size(nareas, sizeof(*io_tlb_areas)));
+	io_tlb_areas = memblock_alloc(alloc_size, SMP_CACHE_BYTES);
+	if (!io_tlb_areas)
+		panic("%s: Failed to allocate %zu bytes align=0x%x\n",
+		      __func__, alloc_size, SMP_CACHE_BYTES);
+
 	for (i = 0; i < io_tlb_nslabs; i++) {
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas(nareas);
 
 	if (verbose)
 		swiotlb_print_info();
@@ -329,6 +407,7 @@ static void swiotlb_cleanup(void)
 int
 swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 {
+	unsigned int nareas = swiotlb_nr_areas(nslabs);
 	unsigned long i, bytes;
 
 	bytes = nslabs << IO_TLB_SHIFT;
@@ -357,11 +436,15 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 	if (!io_tlb_orig_addr)
 		goto cleanup4;
 
+	io_tlb_areas = kcalloc(nareas, sizeof(*io_tlb_areas), GFP_KERNEL);
+	if (!io_tlb_areas)
+		goto cleanup5;
+
 	for (i = 0; i < io_tlb_nslabs; i++) {
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas(nareas);
 
 	swiotlb_print_info();
 
@@ -371,6 +454,10 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 
 	return 0;
 
+cleanup5:
+	free_pages((unsigned long)io_tlb_orig_addr,
+		   get_order(io_tlb_nslabs * sizeof(phys_addr_t)));
+	io_tlb_orig_addr = NULL;
 cleanup4:
 	free_pages((unsigned long)io_tlb_list, get_order(io_tlb_nslabs *
 	                                                 sizeof(int)));
@@ -386,6 +473,7 @@ void __init swiotlb_exit(void)
 		return;
 
 	if (late_alloc) {
+		kfree(io_tlb_areas);
 		free_pages((unsigned long)io_tlb_orig_addr,
 			   get_order(io_tlb_nslabs * sizeof(phys_addr_t)));
 		free_pages((unsigned long)io_tlb_list, get_order(io_tlb_nslabs *
@@ -393,6 +481,9 @@ void __init swiotlb_exit(void)
 		free_pages((unsigned long)phys_to_virt(io_tlb_start),
 			   get_order(io_tlb_nslabs << IO_TLB_SHIFT));
 	} else {
+		memblock_free_late(__pa(io_tlb_areas),
+				   PAGE_ALIGN(array_size(io_tlb_nareas,
+							 sizeof(*io_tlb_areas))));
 		memblock_free_late(__pa(io_tlb_orig_addr),
 				   PAGE_ALIGN(io_tlb_nslabs * sizeof(phys_addr_t)));
 		memblock_free_late(__pa(io_tlb_list),
@@ -443,6 +534,75 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Find @nslots free contiguous slots in @area and mark them used.  Returns
+ * the index of the first one, or -1 if the area has no suitable slots.
+ */
+static int swiotlb_area_find_slots(unsigned int area, unsigned int nslots,
+				   unsigned int stride,
+				   unsigned long offset_slots,
+				   unsigned long max_slots)
+{
+	struct io_tlb_area *a = &io_tlb_areas[area];
+	unsigned int start = swiotlb_area_start(area);
+	unsigned int end = swiotlb_area_end(area);
+	unsigned int index, wrap;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&a->lock, flags);
+
+	if (unlikely(nslots > end - start - a->used))
+		goto not_found;
+
+	index = ALIGN(a->index, stride);
+	if (index >= end)
+		index = start;
+	wrap = index;
+
+	do {
+		while (iommu_is_span_boundary(index, nslots, offset_slots,
+					      max_slots)) {
+			index += stride;
+			if (index >= end)
+				index = start;
+			if (index == wrap)
+				goto not_found;
+		}
+
+		/*
+		 * If we find a slot that indicates we have 'nslots' number of
+		 * contiguous buffers, we allocate the buffers from that slot
+		 * and mark the entries as '0' indicating unavailable.
+		 */
+		if (io_tlb_list[index] >= nslots) {
+			int count = 0;
+
+			for (i = index; i < (int) (index + nslots); i++)
+				io_tlb_list[i] = 0;
+			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
+				io_tlb_list[i] = ++count;
+
+			/*
+			 * Update the indices to avoid searching in the next
+			 * round.
+			 */
+			a->index = index + nslots < end ? index + nslots : start;
+			a->used += nslots;
+
+			spin_unlock_irqrestore(&a->lock, flags);
+			return index;
+		}
+		index += stride;
+		if (index >= end)
+			index = start;
+	} while (index != wrap);
+
+not_found:
+	spin_unlock_irqrestore(&a->lock, flags);
+	return -1;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   dma_addr_t tbl_dma_addr,
 				   phys_addr_t orig_addr,
@@ -451,14 +611,12 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   enum dma_data_direction dir,
 				   unsigned long attrs)
 {
-	unsigned long flags;
 	phys_addr_t tlb_addr;
-	unsigned int nslots, stride, index, wrap;
-	int i;
+	unsigned int nslots, stride, start_area, area;
+	int i, index;
 	unsigned long mask;
 	unsigned long offset_slots;
 	unsigned long max_slots;
-	unsigned long tmp_io_tlb_used;
 
 	if (no_iotlb_memory)
 		panic("Can not allocate SWIOTLB buffer earlier and can't now provide you with the DMA bounce buffer");
@@ -499,67 +657,25 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
-	 * request and allocate a buffer from that IO TLB pool.
+	 * request and allocate a buffer from that IO TLB pool, starting with
+	 * this CPU's area.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-
-	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
-		goto not_found;
-
-	index = ALIGN(io_tlb_index, stride);
-	if (index >= io_tlb_nslabs)
-		index = 0;
-	wrap = index;
-
+	start_area = area = raw_smp_processor_id() % io_tlb_nareas;
 	do {
-		while (iommu_is_span_boundary(index, nslots, offset_slots,
-					      max_slots)) {
-			index += stride;
-			if (index >= io_tlb_nslabs)
-				index = 0;
-			if (index == wrap)
-				goto not_found;
-		}
-
-		/*
-		 * If we find a slot that indicates we have 'nslots' number of
-		 * contiguous buffers, we allocate the buffers from that slot
-		 * and mark the entries as '0' indicating unavailable.
-		 */
-		if (io_tlb_list[index] >= nslots) {
-			int count = 0;
-
-			for (i = index; i < (int) (index + nslots); i++)
-				io_tlb_list[i] = 0;
-			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
-				io_tlb_list[i] = ++count;
-			tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
-
-			/*
-			 * Update the indices to avoid searching in the next
-			 * round.
-			 */
-			io_tlb_index = ((index + nslots) < io_tlb_nslabs
-					? (index + nslots) : 0);
-
+		index = swiotlb_area_find_slots(area, nslots, stride,
+						offset_slots, max_slots);
+		if (index >= 0)
 			goto found;
-		}
-		index += stride;
-		if (index >= io_tlb_nslabs)
-			index = 0;
-	} while (index != wrap);
-
-not_found:
-	tmp_io_tlb_used = io_tlb_used;
+		if (++area >= io_tlb_nareas)
+			area = 0;
+	} while (area != start_area);
 
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
 	if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
 		dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-			 alloc_size, io_tlb_nslabs, tmp_io_tlb_used);
+			 alloc_size, io_tlb_nslabs, swiotlb_used());
 	return (phys_addr_t)DMA_MAPPING_ERROR;
 found:
-	io_tlb_used += nslots;
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	tlb_addr = io_tlb_start + ((phys_addr_t)index << IO_TLB_SHIFT);
 
 	/*
 	 * Save away the mapping from the original address to the DMA address.
@@ -585,6 +701,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	unsigned long flags;
 	int i, count, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
+	struct io_tlb_area *area = &io_tlb_areas[swiotlb_index_to_area(index)];
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
 
 	/*
@@ -601,7 +718,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	spin_lock_irqsave(&area->lock, flags);
 	{
 		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
 			 io_tlb_list[index + nslots] : 0);
@@ -620,9 +737,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
 			io_tlb_list[i] = ++count;
 
-		io_tlb_used -= nslots;
+		area->used -= nslots;
 	}
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -707,13 +824,22 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = swiotlb_used();
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
 
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file_unsafe("io_tlb_used", 0400, root, NULL,
+				   &fops_io_tlb_used);
+	debugfs_create_u32("io_tlb_nareas", 0400, root, &io_tlb_nareas);
 	return 0;
 }
 
@@ -927,6 +927,43 @@ static inline int perf_cgroup_connect(int fd, struct perf_event *event,
 	return ret;
 }
 
+/*
+ * visit_groups_merge() needs a cursor per level of the current cgroup that
+ * has events, plus two for the events without a cgroup.  Make sure the CPU
+ * contexts of @pmu have room for the levels of @event's cgroup.
+ */
+static int perf_cgroup_ensure_storage(struct perf_event *event,
+				      struct pmu *pmu)
+{
+	struct perf_cpu_context *cpuctx;
+	struct perf_event **storage;
+	int cpu, size;
+
+	size = event->cgrp->css.cgroup->level + 3;
+
+	for_each_possible_cpu(cpu) {
+		cpuctx = per_cpu_ptr(pmu->pmu_cpu_context, cpu);
+		if (READ_ONCE(cpuctx->visit_size) >= size)
+			continue;
+
+		storage = kmalloc_node(size * sizeof(*storage), GFP_KERNEL,
+				       cpu_to_node(cpu));
+		if (!storage)
+			return -ENOMEM;
+
+		raw_spin_lock_irq(&cpuctx->ctx.lock);
+		if (cpuctx->visit_size < size) {
+			swap(cpuctx->visit_evts, storage);
+			cpuctx->visit_size = size;
+		}
+		raw_spin_unlock_irq(&cpuctx->ctx.lock);
+
+		kfree(storage);
+	}
+
+	return 0;
+}
+
 static inline void
 perf_cgroup_set_shadow_time(struct perf_event *event, u64 now)
 {
@@ -1037,6 +1074,12 @@ perf_cgroup_switch(struct task_struct *task, struct task_struct *next)
 {
 }
 
+static inline int perf_cgroup_ensure_storage(struct perf_event *event,
+					     struct pmu *pmu)
+{
+	return 0;
+}
+
 static inline void
 perf_cgroup_set_shadow_time(struct perf_event *event, u64 now)
 {
@@ -1517,20 +1560,42 @@ static void perf_event_groups_init(struct perf_event_groups *groups)
 	groups->index = 0;
 }
 
+#ifdef CONFIG_CGROUP_PERF
+static inline u64 perf_event_cgroup_id(struct perf_event *event)
+{
+	return event->cgrp ? cgroup_id(event->cgrp->css.cgroup) : 0;
+}
+#else
+static inline u64 perf_event_cgroup_id(struct perf_event *event)
+{
+	return 0;
+}
+#endif
+
 /*
  * Compare function for event groups;
  *
- * Implements complex key that first sorts by CPU and then by virtual index
- * which provides ordering when rotating groups for the same CPU.
+ * Implements complex key that first sorts by CPU, then by cgroup id (0 for
+ * events without a cgroup) and then by virtual index which provides ordering
+ * when rotating groups for the same CPU and cgroup.
  */
 static bool
 perf_event_groups_less(struct perf_event *left, struct perf_event *right)
 {
+	u64 left_cgrp_id, right_cgrp_id;
+
 	if (left->cpu < right->cpu)
 		return true;
 	if (left->cpu > right->cpu)
 		return false;
 
+	left_cgrp_id = perf_event_cgroup_id(left);
+	right_cgrp_id = perf_event_cgroup_id(right);
+	if (left_cgrp_id < right_cgrp_id)
+		return true;
+	if (left_cgrp_id > right_cgrp_id)
+		return false;
+
 	if (left->group_index < right->group_index)
 		return true;
 	if (left->group_index > right->group_index)
@@ -1540,9 +1605,9 @@ perf_event_groups_less(struct perf_event *left, struct perf_event *right)
 }
 
 /*
- * Insert @event into @groups' tree; using {@event->cpu, ++@groups->index} for
- * key (see perf_event_groups_less). This places it last inside the CPU
- * subtree.
+ * Insert @event into @groups' tree; using {@event->cpu, cgroup id,
+ * ++@groups->index} for key (see perf_event_groups_less). This places it
+ * last inside the CPU and cgroup subtree.
  */
 static void
 perf_event_groups_insert(struct perf_event_groups *groups,
@@ -1610,20 +1675,31 @@ del_event_from_groups(struct perf_event *event, struct perf_event_context *ctx)
 }
 
 /*
- * Get the leftmost event in the @cpu subtree.
+ * Get the leftmost event in the {@cpu, @cgrp_id} subtree.
  */
 static struct perf_event *
-perf_event_groups_first(struct perf_event_groups *groups, int cpu)
+perf_event_groups_first(struct perf_event_groups *groups, int cpu, u64 cgrp_id)
 {
 	struct perf_event *node_event = NULL, *match = NULL;
 	struct rb_node *node = groups->tree.rb_node;
+	u64 node_cgrp_id;
 
 	while (node) {
 		node_event = container_of(node, struct perf_event, group_node);
 
 		if (cpu < node_event->cpu) {
 			node = node->rb_left;
-		} else if (cpu > node_event->cpu) {
+			continue;
+		}
+		if (cpu > node_event->cpu) {
+			node = node->rb_right;
+			continue;
+		}
+
+		node_cgrp_id = perf_event_cgroup_id(node_event);
+		if (cgrp_id < node_cgrp_id) {
+			node = node->rb_left;
+		} else if (cgrp_id > node_cgrp_id) {
 			node = node->rb_right;
 		} else {
 			match = node_event;
@@ -1635,7 +1711,7 @@ perf_event_groups_first(struct perf_event_groups *groups, int cpu)
 }
 
 /*
- * Like rb_entry_next_safe() for the @cpu subtree.
+ * Like rb_entry_next_safe() for the {cpu, cgroup} subtree.
  */
 static struct perf_event *
 perf_event_groups_next(struct perf_event *event)
@@ -1643,7 +1719,8 @@ perf_event_groups_next(struct perf_event *event)
 	struct perf_event *next;
 
 	next = rb_entry_safe(rb_next(&event->group_node), typeof(*event), group_node);
-	if (next && next->cpu == event->cpu)
+	if (next && next->cpu == event->cpu &&
+	    perf_event_cgroup_id(next) == perf_event_cgroup_id(event))
 		return next;
 
 	return NULL;
@@ -3388,32 +3465,59 @@ static void cpu_ctx_sched_out(struct perf_cpu_context *cpuctx,
 	ctx_sched_out(&cpuctx->ctx, cpuctx, event_type);
 }
 
-static int visit_groups_merge(struct perf_event_groups *groups, int cpu,
+/*
+ * Visit the groups that can run on @cpu in group_index order: those bound to
+ * any CPU, those bound to @cpu without a cgroup and, for the CPU context of
+ * @cpuctx, those of the current cgroup and its ancestors.  Since the tree is
+ * keyed by cgroup, groups of other cgroups are never looked at.
+ */
+static int visit_groups_merge(struct perf_cpu_context *cpuctx,
+			      struct perf_event_context *ctx,
+			      struct perf_event_groups *groups, int cpu,
 			      int (*func)(struct perf_event *, void *), void *data)
 {
-	struct perf_event **evt, *evt1, *evt2;
+	struct perf_event *evts_default[2], **evts = evts_default;
+	struct perf_event *evt;
+	int i, best, nr = 0, size = ARRAY_SIZE(evts_default);
 	int ret;
 
-	evt1 = perf_event_groups_first(groups, -1);
-	evt2 = perf_event_groups_first(groups, cpu);
+#ifdef CONFIG_CGROUP_PERF
+	if (ctx == &cpuctx->ctx && cpuctx->cgrp) {
+		struct cgroup_subsys_state *css;
+
+		evts = cpuctx->visit_evts;
+		size = cpuctx->visit_size;
 
-	while (evt1 || evt2) {
-		if (evt1 && evt2) {
-			if (evt1->group_index < evt2->group_index)
-				evt = &evt1;
-			else
-				evt = &evt2;
-		} else if (evt1) {
-			evt = &evt1;
-		} else {
-			evt = &evt2;
+		for (css = &cpuctx->cgrp->css; css; css = css->parent) {
+			evt = perf_event_groups_first(groups, cpu,
+						      cgroup_id(css->cgroup));
+			if (evt && !WARN_ON_ONCE(nr >= size - 2))
+				evts[nr++] = evt;
+		}
+	}
+#endif
+
+	evt = perf_event_groups_first(groups, -1, 0);
+	if (evt)
+		evts[nr++] = evt;
+	evt = perf_event_groups_first(groups, cpu, 0);
+	if (evt)
+		evts[nr++] = evt;
+
+	while (nr) {
+		best = 0;
+		for (i = 1; i < nr; i++) {
+			if (evts[i]->group_index < evts[best]->group_index)
+				best = i;
 		}
 
-		ret = func(*evt, data);
+		ret = func(evts[best], data);
 		if (ret)
 			return ret;
 
-		*evt = perf_event_groups_next(*evt);
+		evts[best] = perf_event_groups_next(evts[best]);
+		if (!evts[best])
+			evts[best] = evts[--nr];
 	}
 
 	return 0;
@@ -3483,7 +3587,7 @@ ctx_pinned_sched_in(struct perf_event_context *ctx,
 		.can_add_hw = 1,
 	};
 
-	visit_groups_merge(&ctx->pinned_groups,
+	visit_groups_merge(cpuctx, ctx, &ctx->pinned_groups,
 			   smp_processor_id(),
 			   pinned_sched_in, &sid);
 }
@@ -3498,7 +3602,7 @@ ctx_flexible_sched_in(struct perf_event_context *ctx,
 		.can_add_hw = 1,
 	};
 
-	visit_groups_merge(&ctx->flexible_groups,
+	visit_groups_merge(cpuctx, ctx, &ctx->flexible_groups,
 			   smp_processor_id(),
 			   flexible_sched_in, &sid);
 }
@@ -10815,6 +10919,12 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 		goto err_pmu;
 	}
 
+	if (cgroup_fd != -1) {
+		err = perf_cgroup_ensure_storage(event, pmu);
+		if (err)
+			goto err_pmu;
+	}
+
 	if (event->attr.aux_output &&
 	    !(pmu->capabilities & PERF_PMU_CAP_AUX_OUTPUT)) {
 		err = -EOPNOTSUPP;
@@ -11008,6 +11118,7 @@ static int
 perf_event_set_output(struct perf_event *event, struct perf_event *output_event)
 {
 	struct perf_buffer *rb = NULL;
+	bool swap = false;
 	int ret = -EINVAL;
 
 	if (!output_event)
@@ -11062,12 +11173,24 @@ perf_event_set_output(struct perf_event *event, struct perf_event *output_event)
 			goto unlock;
 	}
 
+	swap = event->rb && rb && event->rb != rb;
 	ring_buffer_attach(event, rb);
 
 	ret = 0;
 unlock:
 	mutex_unlock(&event->mmap_mutex);
 
+	/*
+	 * Redirecting an overwrite-mode event from one buffer to another is
+	 * how an always-on collector takes a snapshot without pausing the
+	 * output: the event keeps writing into the spare buffer while the old
+	 * one is read at leisure.  Writers are RCU readers of event->rb from
+	 * perf_output_begin() to perf_output_end(), so once a grace period has
+	 * elapsed nothing can overwrite the old buffer under the reader.
+	 */
+	if (swap && is_write_backward(event))
+		synchronize_rcu();
+
 out:
 	return ret;
 }
@@ -27,6 +27,7 @@
 #include <linux/task_work.h>
 #include <linux/shmem_fs.h>
 #include <linux/khugepaged.h>
+#include <linux/seqlock.h>
 
 #include <linux/uprobes.h>
 
@@ -41,6 +42,8 @@ static struct rb_root uprobes_tree = RB_ROOT;
 #define no_uprobe_events()	RB_EMPTY_ROOT(&uprobes_tree)
 
 static DEFINE_SPINLOCK(uprobes_treelock);	/* serialize rbtree access */
+/* lets find_uprobe_rcu() detect concurrent tree modifications */
+static seqcount_t uprobes_seqcount = SEQCNT_ZERO(uprobes_seqcount);
 
 #define UPROBES_HASH_SZ	13
 /* serialize uprobe->pending_list */
@@ -55,6 +58,7 @@ DEFINE_STATIC_PERCPU_RWSEM(dup_mmap_sem);
 struct uprobe {
 	struct rb_node		rb_node;	/* node in the rb tree */
 	refcount_t		ref;
+	struct rcu_head		rcu;
 	struct rw_semaphore	register_rwsem;
 	struct rw_semaphore	consumer_rwsem;
 	struct list_head	pending_list;
@@ -615,7 +619,8 @@ static void put_uprobe(struct uprobe *uprobe)
 		mutex_lock(&delayed_uprobe_lock);
 		delayed_uprobe_remove(uprobe, NULL);
 		mutex_unlock(&delayed_uprobe_lock);
-		kfree(uprobe);
+		/* find_uprobe_rcu() may still be looking at it */
+		kfree_rcu(uprobe, rcu);
 	}
 }
 
@@ -672,6 +677,50 @@ static struct uprobe *find_uprobe(struct inode *inode, loff_t offset)
 	return uprobe;
 }
 
+/*
+ * Lockless variant of find_uprobe() for the breakpoint hit path, which
+ * would otherwise serialize all probe hits on uprobes_treelock.
+ *
+ * The rbtree code makes sure a lockless walk never loops or crashes, but a
+ * walk racing with a rotation can miss the node it is looking for, so a miss
+ * is only trusted if the tree did not change meanwhile.  A node that was
+ * found can be on its way out; its refcount has dropped to zero in that case
+ * and the memory stays valid until the end of the RCU read-side section.
+ */
+static struct uprobe *find_uprobe_rcu(struct inode *inode, loff_t offset)
+{
+	struct uprobe u = { .inode = inode, .offset = offset };
+	struct uprobe *uprobe;
+	struct rb_node *n;
+	unsigned int seq;
+	int match;
+
+	rcu_read_lock();
+	do {
+		seq = read_seqcount_begin(&uprobes_seqcount);
+		n = READ_ONCE(uprobes_tree.rb_node);
+
+		while (n) {
+			uprobe = rb_entry(n, struct uprobe, rb_node);
+			match = match_uprobe(&u, uprobe);
+			if (!match) {
+				if (!refcount_inc_not_zero(&uprobe->ref))
+					break;
+				rcu_read_unlock();
+				return uprobe;
+			}
+
+			if (match < 0)
+				n = READ_ONCE(n->rb_left);
+			else
+				n = READ_ONCE(n->rb_right);
+		}
+	} while (read_seqcount_retry(&uprobes_seqcount, seq));
+	rcu_read_unlock();
+
+	return NULL;
+}
+
 static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 {
 	struct rb_node **p = &uprobes_tree.rb_node;
@@ -694,10 +743,10 @@ static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 	}
 
 	u = NULL;
-	rb_link_node(&uprobe->rb_node, parent, p);
-	rb_insert_color(&uprobe->rb_node, &uprobes_tree);
 	/* get access + creation ref */
 	refcount_set(&uprobe->ref, 2);
+	rb_link_node_rcu(&uprobe->rb_node, parent, p);
+	rb_insert_color(&uprobe->rb_node, &uprobes_tree);
 
 	return u;
 }
@@ -715,7 +764,9 @@ static struct uprobe *insert_uprobe(struct uprobe *uprobe)
 	struct uprobe *u;
 
 	spin_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	u = __insert_uprobe(uprobe);
+	write_seqcount_end(&uprobes_seqcount);
 	spin_unlock(&uprobes_treelock);
 
 	return u;
@@ -953,7 +1004,9 @@ static void delete_uprobe(struct uprobe *uprobe)
 		return;
 
 	spin_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	rb_erase(&uprobe->rb_node, &uprobes_tree);
+	write_seqcount_end(&uprobes_seqcount);
 	spin_unlock(&uprobes_treelock);
 	RB_CLEAR_NODE(&uprobe->rb_node); /* for uprobe_is_active() */
 	put_uprobe(uprobe);
@@ -2052,7 +2105,7 @@ static struct uprobe *find_active_uprobe(unsigned long bp_vaddr, int *is_swbp)
 			struct inode *inode = file_inode(vma->vm_file);
 			loff_t offset = vaddr_to_offset(vma, bp_vaddr);
 
-			uprobe = find_uprobe(inode, offset);
+			uprobe = find_uprobe_rcu(inode, offset);
 		}
 
 		if (!uprobe)
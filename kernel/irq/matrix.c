@@ -7,6 +7,7 @@
 #include <linux/percpu.h>
 #include <linux/cpu.h>
 #include <linux/irq.h>
+#include <linux/kernel_stat.h>
 
 #define IRQ_MATRIX_SIZE	(BITS_TO_LONGS(IRQ_MATRIX_BITS))
 
@@ -17,6 +18,9 @@ struct cpumap {
 	unsigned int		managed_allocated;
 	bool			initialized;
 	bool			online;
+	unsigned int		irq_stamp;
+	unsigned long		irq_stamp_time;
+	unsigned long		irq_rate;
 	unsigned long		alloc_map[IRQ_MATRIX_SIZE];
 	unsigned long		managed_map[IRQ_MATRIX_SIZE];
 };
@@ -125,11 +129,44 @@ static unsigned int matrix_alloc_area(struct irq_matrix *m, struct cpumap *cm,
 	return area;
 }
 
-/* Find the best CPU which has the lowest vector allocation count */
+/*
+ * With "irqmatrix_load_aware=on" the CPU selection below prefers the CPUs
+ * which handled the fewest interrupts recently, so that busy vectors are
+ * not stacked on the same CPUs.  The rate is derived from kstat_irqs and
+ * refreshed at most once a second per CPU.
+ */
+static bool matrix_load_aware __read_mostly;
+
+static int __init matrix_load_aware_setup(char *str)
+{
+	return kstrtobool(str, &matrix_load_aware) ? -EINVAL : 0;
+}
+early_param("irqmatrix_load_aware", matrix_load_aware_setup);
+
+/* Interrupts per second handled by @cpu, over about the last second */
+static unsigned long matrix_cpu_irq_rate(struct cpumap *cm, unsigned int cpu)
+{
+	unsigned int irqs = kstat_cpu_irqs_sum(cpu);
+	unsigned long now = jiffies, span = now - cm->irq_stamp_time;
+
+	if (span < HZ)
+		return cm->irq_rate;
+
+	cm->irq_rate = (unsigned long)(irqs - cm->irq_stamp) * HZ / span;
+	cm->irq_stamp = irqs;
+	cm->irq_stamp_time = now;
+	return cm->irq_rate;
+}
+
+/*
+ * Find the best CPU which has the lowest vector allocation count, or in
+ * load aware mode the lowest interrupt rate.
+ */
 static unsigned int matrix_find_best_cpu(struct irq_matrix *m,
 					const struct cpumask *msk)
 {
 	unsigned int cpu, best_cpu, maxavl = 0;
+	unsigned long rate, minrate = ULONG_MAX;
 	struct cpumap *cm;
 
 	best_cpu = UINT_MAX;
@@ -137,8 +174,18 @@ static unsigned int matrix_find_best_cpu(struct irq_matrix *m,
 	for_each_cpu(cpu, msk) {
 		cm = per_cpu_ptr(m->maps, cpu);
 
-		if (!cm->online || cm->available <= maxavl)
+		if (!cm->online || !cm->available)
+			continue;
+
+		if (matrix_load_aware) {
+			rate = matrix_cpu_irq_rate(cm, cpu);
+			if (rate > minrate ||
+			    (rate == minrate && cm->available <= maxavl))
+				continue;
+			minrate = rate;
+		} else if (cm->available <= maxavl) {
 			continue;
+		}
 
 		best_cpu = cpu;
 		maxavl = cm->available;
@@ -146,11 +193,15 @@ static unsigned int matrix_find_best_cpu(struct irq_matrix *m,
 	return best_cpu;
 }
 
-/* Find the best CPU which has the lowest number of managed IRQs allocated */
+/*
+ * Find the best CPU which has the lowest number of managed IRQs allocated.
+ * In load aware mode, ties are broken by the lowest interrupt rate.
+ */
 static unsigned int matrix_find_best_cpu_managed(struct irq_matrix *m,
 						const struct cpumask *msk)
 {
 	unsigned int cpu, best_cpu, allocated = UINT_MAX;
+	unsigned long rate, minrate = ULONG_MAX;
 	struct cpumap *cm;
 
 	best_cpu = UINT_MAX;
@@ -161,6 +212,13 @@ static unsigned int matrix_find_best_cpu_managed(struct irq_matrix *m,
 		if (!cm->online || cm->managed_allocated > allocated)
 			continue;
 
+		if (matrix_load_aware) {
+			rate = matrix_cpu_irq_rate(cm, cpu);
+			if (cm->managed_allocated == allocated && rate > minrate)
+				continue;
+			minrate = rate;
+		}
+
 		best_cpu = cpu;
 		allocated = cm->managed_allocated;
 	}
@@ -355,6 +355,15 @@ static struct hlist_head classhash_table[CLASSHASH_SIZE];
 
 static struct hlist_head chainhash_table[CHAINHASH_SIZE];
 
+/*
+ * Bumped whenever lock chains are removed or reset, which invalidates the
+ * per-CPU recent-chain caches in front of chainhash_table.  It is bumped
+ * only once the chains are gone from the hash table, and a cache fill
+ * samples it before looking the chain up, so that a chain found just
+ * before its removal is filled under the old generation.
+ */
+static unsigned int chain_cache_gen;
+
 /*
  * The hash key of the lock dependency chains is a hash itself too:
  * it's a hash of all locks taken up to that lock, including that lock.
@@ -2866,6 +2875,56 @@ static inline struct lock_chain *lookup_chain_cache(u64 chain_key)
 	return NULL;
 }
 
+/*
+ * A small direct-mapped per-CPU cache of recently validated chains, looked
+ * at before the global hash table.  Entries are only trusted if they were
+ * filled in the current chain_cache_gen and the chain still has the same
+ * key, so removed or recycled chains are never hit.  Only accessed with
+ * interrupts disabled.
+ */
+#define CHAIN_PCPU_CACHE_BITS	6
+#define CHAIN_PCPU_CACHE_SIZE	(1UL << CHAIN_PCPU_CACHE_BITS)
+
+struct chain_pcpu_cache_entry {
+	u64			chain_key;
+	struct lock_chain	*chain;
+	unsigned int		gen;
+};
+
+static DEFINE_PER_CPU(struct chain_pcpu_cache_entry [CHAIN_PCPU_CACHE_SIZE],
+		      chain_pcpu_cache);
+
+static inline struct chain_pcpu_cache_entry *chain_pcpu_entry(u64 chain_key)
+{
+	return this_cpu_ptr(&chain_pcpu_cache[hash_long(chain_key,
+						       CHAIN_PCPU_CACHE_BITS)]);
+}
+
+static inline struct lock_chain *lookup_chain_pcpu_cache(u64 chain_key)
+{
+	struct chain_pcpu_cache_entry *e = chain_pcpu_entry(chain_key);
+	struct lock_chain *chain = e->chain;
+
+	if (!chain || e->chain_key != chain_key ||
+	    e->gen != READ_ONCE(chain_cache_gen) ||
+	    READ_ONCE(chain->chain_key) != chain_key)
+		return NULL;
+
+	debug_atomic_inc(chain_lookup_hits);
+	return chain;
+}
+
+static inline void fill_chain_pcpu_cache(u64 chain_key,
+					 struct lock_chain *chain,
+					 unsigned int gen)
+{
+	struct chain_pcpu_cache_entry *e = chain_pcpu_entry(chain_key);
+
+	e->chain_key = chain_key;
+	e->chain = chain;
+	e->gen = gen;
+}
+
 /*
  * If the key is not present yet in dependency chain cache then
  * add it and return 1 - in this case the new dependency chain is
@@ -2877,7 +2936,16 @@ static inline int lookup_chain_cache_add(struct task_struct *curr,
 					 u64 chain_key)
 {
 	struct lock_class *class = hlock_class(hlock);
-	struct lock_chain *chain = lookup_chain_cache(chain_key);
+	struct lock_chain *chain = lookup_chain_pcpu_cache(chain_key);
+
+	if (!chain) {
+		/* Pairs with the release in remove_class_from_lock_chains() */
+		unsigned int gen = smp_load_acquire(&chain_cache_gen);
+
+		chain = lookup_chain_cache(chain_key);
+		if (chain)
+			fill_chain_pcpu_cache(chain_key, chain, gen);
+	}
 
 	if (chain) {
 cache_hit:
@@ -4759,6 +4827,7 @@ void lockdep_reset(void)
 	debug_locks = 1;
 	for (i = 0; i < CHAINHASH_SIZE; i++)
 		INIT_HLIST_HEAD(chainhash_table + i);
+	smp_store_release(&chain_cache_gen, chain_cache_gen + 1);
 	raw_local_irq_restore(flags);
 }
 
@@ -4836,6 +4905,7 @@ static void remove_class_from_lock_chains(struct pending_free *pf,
 			remove_class_from_lock_chain(pf, chain, class);
 		}
 	}
+	smp_store_release(&chain_cache_gen, chain_cache_gen + 1);
 }
 
 /*
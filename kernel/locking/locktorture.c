@@ -14,6 +14,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/sched/rt.h>
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
@@ -46,6 +47,8 @@ torture_param(int, shutdown_secs, 0, "Shutdown time (j), <= zero to disable.");
 torture_param(int, stat_interval, 60,
 	     "Number of seconds between stats printk()s");
 torture_param(int, stutter, 5, "Number of jiffies to run/halt test, 0=disable");
+torture_param(int, sweep_interval, 0,
+	     "Seconds per step of a thread-count sweep, 0=disable");
 torture_param(int, verbose, 1,
 	     "Enable verbose debugging printk()s");
 
@@ -55,15 +58,20 @@ MODULE_PARM_DESC(torture_type,
 		 "Type of lock to torture (spin_lock, spin_lock_irq, mutex_lock, ...)");
 
 static struct task_struct *stats_task;
+static struct task_struct *sweep_task;
 static struct task_struct **writer_tasks;
 static struct task_struct **reader_tasks;
 
 static bool lock_is_write_held;
 static bool lock_is_read_held;
 
+/* Lock wait times, bucket b counting waits in [2^(b-1), 2^b) ns. */
+#define LOCK_WAIT_BUCKETS 32
+
 struct lock_stress_stats {
 	long n_lock_fail;
 	long n_lock_acquired;
+	unsigned long n_lock_wait[LOCK_WAIT_BUCKETS]; /* sweep only */
 };
 
 /* Forward reference. */
@@ -94,6 +102,8 @@ struct lock_torture_cxt {
 	struct lock_torture_ops *cur_ops;
 	struct lock_stress_stats *lwsa; /* writer statistics */
 	struct lock_stress_stats *lrsa; /* reader statistics */
+	int sweep_nwriters; /* writers running in this sweep step */
+	int sweep_nreaders; /* readers running in this sweep step */
 };
 static struct lock_torture_cxt cxt = { 0, 0, false,
 				       ATOMIC_INIT(0),
@@ -611,6 +621,25 @@ static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.name		= "percpu_rwsem_lock"
 };
 
+/*
+ * During a sweep, the kthreads beyond the count for the current step
+ * sit it out.
+ */
+static bool lock_torture_sweep_idle(int idx, int *nactive)
+{
+	if (sweep_interval <= 0 || idx < READ_ONCE(*nactive))
+		return false;
+	schedule_timeout_interruptible(HZ / 10);
+	return true;
+}
+
+static void lock_torture_wait_done(struct lock_stress_stats *lsp, u64 start)
+{
+	int b = fls64(ktime_get_ns() - start);
+
+	lsp->n_lock_wait[min(b, LOCK_WAIT_BUCKETS - 1)]++;
+}
+
 /*
  * Lock torture writer kthread.  Repeatedly acquires and releases
  * the lock, checking for duplicate acquisitions.
@@ -619,16 +648,25 @@ static int lock_torture_writer(void *arg)
 {
 	struct lock_stress_stats *lwsp = arg;
 	static DEFINE_TORTURE_RANDOM(rand);
+	u64 start = 0;
 
 	VERBOSE_TOROUT_STRING("lock_torture_writer task started");
 	set_user_nice(current, MAX_NICE);
 
 	do {
+		if (lock_torture_sweep_idle(lwsp - cxt.lwsa,
+					    &cxt.sweep_nwriters))
+			continue;
+
 		if ((torture_random(&rand) & 0xfffff) == 0)
 			schedule_timeout_uninterruptible(1);
 
 		cxt.cur_ops->task_boost(&rand);
+		if (sweep_interval > 0)
+			start = ktime_get_ns();
 		cxt.cur_ops->writelock();
+		if (sweep_interval > 0)
+			lock_torture_wait_done(lwsp, start);
 		if (WARN_ON_ONCE(lock_is_write_held))
 			lwsp->n_lock_fail++;
 		lock_is_write_held = 1;
@@ -656,15 +694,24 @@ static int lock_torture_reader(void *arg)
 {
 	struct lock_stress_stats *lrsp = arg;
 	static DEFINE_TORTURE_RANDOM(rand);
+	u64 start = 0;
 
 	VERBOSE_TOROUT_STRING("lock_torture_reader task started");
 	set_user_nice(current, MAX_NICE);
 
 	do {
+		if (lock_torture_sweep_idle(lrsp - cxt.lrsa,
+					    &cxt.sweep_nreaders))
+			continue;
+
 		if ((torture_random(&rand) & 0xfffff) == 0)
 			schedule_timeout_uninterruptible(1);
 
+		if (sweep_interval > 0)
+			start = ktime_get_ns();
 		cxt.cur_ops->readlock();
+		if (sweep_interval > 0)
+			lock_torture_wait_done(lrsp, start);
 		lock_is_read_held = 1;
 		if (WARN_ON_ONCE(lock_is_write_held))
 			lrsp->n_lock_fail++; /* rare, but... */
@@ -770,16 +817,121 @@ static int lock_torture_stats(void *arg)
 	return 0;
 }
 
+/* Totals over all kthreads of one kind, for a sweep step. */
+struct lock_sweep_snap {
+	long n_lock_acquired;
+	unsigned long n_lock_wait[LOCK_WAIT_BUCKETS];
+};
+
+static void lock_torture_sweep_snap(struct lock_sweep_snap *snap,
+				    struct lock_stress_stats *statp, int n)
+{
+	int i, b;
+
+	memset(snap, 0, sizeof(*snap));
+	for (i = 0; statp && i < n; i++) {
+		snap->n_lock_acquired += READ_ONCE(statp[i].n_lock_acquired);
+		for (b = 0; b < LOCK_WAIT_BUCKETS; b++)
+			snap->n_lock_wait[b] += READ_ONCE(statp[i].n_lock_wait[b]);
+	}
+}
+
+/*
+ * Upper bound in ns of the bucket holding the requested percentile of
+ * the waits counted between two snapshots.
+ */
+static u64 lock_torture_sweep_pct(struct lock_sweep_snap *old,
+				  struct lock_sweep_snap *new, int pct)
+{
+	unsigned long waits[LOCK_WAIT_BUCKETS];
+	unsigned long total = 0, seen = 0;
+	u64 rank;
+	int b;
+
+	for (b = 0; b < LOCK_WAIT_BUCKETS; b++) {
+		waits[b] = new->n_lock_wait[b] - old->n_lock_wait[b];
+		total += waits[b];
+	}
+	if (!total)
+		return 0;
+
+	rank = DIV_ROUND_UP_ULL((u64)total * pct, 100);
+	for (b = 0; b < LOCK_WAIT_BUCKETS - 1; b++) {
+		seen += waits[b];
+		if (seen >= rank)
+			break;
+	}
+	return 1ULL << b;
+}
+
+/*
+ * Steps through doubling numbers of writers and readers, up to the
+ * numbers of kthreads created, holding each step for sweep_interval
+ * seconds and printing one line of key=value pairs per step.  The
+ * highest step is held until the end of the test.
+ */
+static int lock_torture_sweep(void *arg)
+{
+	static struct lock_sweep_snap w_old, w_new, r_old, r_new;
+	int nw = 0, nr = 0;
+	bool done = false;
+	u64 start, ns;
+
+	VERBOSE_TOROUT_STRING("lock_torture_sweep task started");
+	do {
+		if (done) {
+			schedule_timeout_interruptible(sweep_interval * HZ);
+			continue;
+		}
+
+		nw = min(max(2 * nw, 1), cxt.nrealwriters_stress);
+		nr = min(max(2 * nr, 1), cxt.nrealreaders_stress);
+		WRITE_ONCE(cxt.sweep_nwriters, nw);
+		WRITE_ONCE(cxt.sweep_nreaders, nr);
+		/* Let the newly enabled kthreads notice before measuring. */
+		schedule_timeout_interruptible(HZ / 5);
+
+		lock_torture_sweep_snap(&w_old, cxt.lwsa, cxt.nrealwriters_stress);
+		lock_torture_sweep_snap(&r_old, cxt.lrsa, cxt.nrealreaders_stress);
+		start = ktime_get_ns();
+		schedule_timeout_interruptible(sweep_interval * HZ);
+		if (torture_must_stop())
+			break;
+		ns = ktime_get_ns() - start;
+		lock_torture_sweep_snap(&w_new, cxt.lwsa, cxt.nrealwriters_stress);
+		lock_torture_sweep_snap(&r_new, cxt.lrsa, cxt.nrealreaders_stress);
+
+		pr_alert("%s" TORTURE_FLAG
+			 "sweep: writers=%d readers=%d writes_per_sec=%llu reads_per_sec=%llu write_wait_p50_ns=%llu write_wait_p90_ns=%llu write_wait_p99_ns=%llu read_wait_p50_ns=%llu read_wait_p90_ns=%llu read_wait_p99_ns=%llu\n",
+			 torture_type, nw, nr,
+			 div64_u64((u64)(w_new.n_lock_acquired - w_old.n_lock_acquired) *
+				   NSEC_PER_SEC, ns),
+			 div64_u64((u64)(r_new.n_lock_acquired - r_old.n_lock_acquired) *
+				   NSEC_PER_SEC, ns),
+			 lock_torture_sweep_pct(&w_old, &w_new, 50),
+			 lock_torture_sweep_pct(&w_old, &w_new, 90),
+			 lock_torture_sweep_pct(&w_old, &w_new, 99),
+			 lock_torture_sweep_pct(&r_old, &r_new, 50),
+			 lock_torture_sweep_pct(&r_old, &r_new, 90),
+			 lock_torture_sweep_pct(&r_old, &r_new, 99));
+
+		done = nw == cxt.nrealwriters_stress &&
+		       nr == cxt.nrealreaders_stress;
+	} while (!torture_must_stop());
+	torture_kthread_stopping("lock_torture_sweep");
+	return 0;
+}
+
 static inline void
 lock_torture_print_module_parms(struct lock_torture_ops *cur_ops,
 				const char *tag)
 {
 	pr_alert("%s" TORTURE_FLAG
-		 "--- %s%s: nwriters_stress=%d nreaders_stress=%d stat_interval=%d verbose=%d shuffle_interval=%d stutter=%d shutdown_secs=%d onoff_interval=%d onoff_holdoff=%d\n",
+		 "--- %s%s: nwriters_stress=%d nreaders_stress=%d stat_interval=%d verbose=%d shuffle_interval=%d stutter=%d shutdown_secs=%d onoff_interval=%d onoff_holdoff=%d sweep_interval=%d\n",
 		 torture_type, tag, cxt.debug_lock ? " [debug]": "",
 		 cxt.nrealwriters_stress, cxt.nrealreaders_stress, stat_interval,
 		 verbose, shuffle_interval, stutter, shutdown_secs,
-		 onoff_interval, onoff_holdoff);
+		 onoff_interval, onoff_holdoff, sweep_interval);
 }
 
 static void lock_torture_cleanup(void)
@@ -814,6 +966,7 @@ static void lock_torture_cleanup(void)
 		reader_tasks = NULL;
 	}
 
+	torture_stop_kthread(lock_torture_sweep, sweep_task);
 	torture_stop_kthread(lock_torture_stats, stats_task);
 	lock_torture_stats_print();  /* -After- the stats thread is stopped! */
 
@@ -916,6 +1069,8 @@ static int __init lock_torture_init(void)
 		for (i = 0; i < cxt.nrealwriters_stress; i++) {
 			cxt.lwsa[i].n_lock_fail = 0;
 			cxt.lwsa[i].n_lock_acquired = 0;
+			memset(cxt.lwsa[i].n_lock_wait, 0,
+			       sizeof(cxt.lwsa[i].n_lock_wait));
 		}
 	}
 
@@ -949,6 +1104,8 @@ static int __init lock_torture_init(void)
 			for (i = 0; i < cxt.nrealreaders_stress; i++) {
 				cxt.lrsa[i].n_lock_fail = 0;
 				cxt.lrsa[i].n_lock_acquired = 0;
+				memset(cxt.lrsa[i].n_lock_wait, 0,
+				       sizeof(cxt.lrsa[i].n_lock_wait));
 			}
 		}
 	}
@@ -1037,6 +1194,12 @@ static int __init lock_torture_init(void)
 		if (firsterr)
 			goto unwind;
 	}
+	if (sweep_interval > 0) {
+		firsterr = torture_create_kthread(lock_torture_sweep, NULL,
+						  sweep_task);
+		if (firsterr)
+			goto unwind;
+	}
 	torture_init_end();
 	return 0;
 
@@ -140,10 +140,18 @@ static bool readers_active_check(struct percpu_rw_semaphore *sem)
 	return true;
 }
 
-void percpu_down_write(struct percpu_rw_semaphore *sem)
+static void __percpu_down_write(struct percpu_rw_semaphore *sem,
+				bool expedited)
 {
-	/* Notify readers to take the slow path. */
-	rcu_sync_enter(&sem->rss);
+	/*
+	 * Notify readers to take the slow path.  Writers arriving while
+	 * another one is still waiting here, or within a grace period of
+	 * the previous percpu_up_write(), share its rcu_sync transition.
+	 */
+	if (expedited)
+		rcu_sync_enter_expedited(&sem->rss);
+	else
+		rcu_sync_enter(&sem->rss);
 
 	down_write(&sem->rw_sem);
 
@@ -164,8 +172,23 @@ void percpu_down_write(struct percpu_rw_semaphore *sem)
 	/* Wait for all now active readers to complete. */
 	rcuwait_wait_event(&sem->writer, readers_active_check(sem));
 }
+
+void percpu_down_write(struct percpu_rw_semaphore *sem)
+{
+	__percpu_down_write(sem, false);
+}
 EXPORT_SYMBOL_GPL(percpu_down_write);
 
+/*
+ * For short, latency-sensitive write sections: if readers still have to
+ * be moved off their fast path, use an expedited grace period to do so.
+ */
+void percpu_down_write_expedited(struct percpu_rw_semaphore *sem)
+{
+	__percpu_down_write(sem, true);
+}
+EXPORT_SYMBOL_GPL(percpu_down_write_expedited);
+
 void percpu_up_write(struct percpu_rw_semaphore *sem)
 {
 	/*
@@ -0,0 +1,218 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/init.h>
+#include <linux/topology.h>
+
+/*
+ * Implement a NUMA-aware version of MCS (aka CNA, or compact NUMA-aware lock).
+ *
+ * In CNA, spinning threads are organized in two queues, a primary queue for
+ * threads running on the same NUMA node as the current lock holder, and a
+ * secondary queue for threads running on other nodes. Schematically, it
+ * looks like this:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * N.B. locked is 0 or 1 if the secondary queue is absent: 0 for a queue head
+ * that found the queue empty and never waited for the MCS lock, 1 for one
+ * that was handed it.  Otherwise, it contains the encoded tail of the last
+ * node in the secondary queue, which is circular, so the head of the
+ * secondary queue is that tail's ->next.  An encoded tail is never 0 or 1.
+ *
+ * When the lock is handed over, the holder looks for a successor on its own
+ * node, moving the remote waiters it skips over to the secondary queue.  The
+ * secondary queue is spliced back in front of the primary queue when no local
+ * successor is found, or after CNA_INTRA_NODE_THRESHOLD consecutive same-node
+ * hand-overs, which keeps remote waiters from starving.
+ *
+ * The NUMA-aware slow path is off by default and is selected at boot with
+ * "numa_spinlock=on".  It has to be selected before secondary CPUs come up,
+ * since a native waiter would not know what to do with a secondary queue.
+ *
+ * For more details, see https://arxiv.org/abs/1810.05600.
+ */
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	int			numa_node;
+	u32			encoded_tail;
+	u32			intra_count;
+};
+
+/*
+ * Number of consecutive hand-overs within a NUMA node after which the
+ * secondary queue is flushed back into the primary one.
+ */
+#define CNA_INTRA_NODE_THRESHOLD	(1 << 16)
+
+static bool numa_spinlock_param __initdata;
+
+static int __init numa_spinlock_setup(char *str)
+{
+	return kstrtobool(str, &numa_spinlock_param) ? -EINVAL : 0;
+}
+early_param("numa_spinlock", numa_spinlock_setup);
+
+/*
+ * Runs from do_pre_smp_initcalls(), while the boot CPU is still the only
+ * one that can be queued on a spinlock.
+ */
+static int __init numa_spinlock_init(void)
+{
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	if (numa_spinlock_param && nr_node_ids > 1) {
+		static_branch_enable(&numa_spinlock);
+		pr_info("Enabling CNA spinlock\n");
+	}
+	return 0;
+}
+early_initcall(numa_spinlock_init);
+
+static void cna_init_node(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	int idx = this_cpu_read(qnodes[0].mcs.count) - 1;
+
+	cn->numa_node = numa_node_id();
+	cn->encoded_tail = encode_tail(smp_processor_id(), idx);
+	cn->intra_count = 0;
+}
+
+static inline bool cna_has_secondary(struct mcs_spinlock *node)
+{
+	return node->locked > 1;
+}
+
+/*
+ * Move the waiters from @first to @last, a contiguous stretch of the primary
+ * queue, to the tail of @node's secondary queue.
+ */
+static void cna_splice_tail(struct mcs_spinlock *node,
+			    struct mcs_spinlock *first,
+			    struct mcs_spinlock *last)
+{
+	struct mcs_spinlock *sec_tail;
+
+	if (cna_has_secondary(node)) {
+		sec_tail = decode_tail(node->locked);
+		last->next = sec_tail->next;
+		sec_tail->next = first;
+	} else {
+		last->next = first;
+	}
+	node->locked = ((struct cna_node *)last)->encoded_tail;
+}
+
+/*
+ * Make the first waiter running on @node's NUMA node the next one in the
+ * primary queue, moving the remote waiters ahead of it to the secondary
+ * queue.  Returns false, leaving the queue untouched, if there is no such
+ * waiter linked into the queue yet.
+ */
+static bool cna_order_queue(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	struct mcs_spinlock *next = READ_ONCE(node->next);
+	struct mcs_spinlock *last = next, *nnode;
+
+	if (((struct cna_node *)next)->numa_node == cn->numa_node)
+		return true;
+
+	for (;;) {
+		nnode = READ_ONCE(last->next);
+		if (!nnode)
+			return false;
+		if (((struct cna_node *)nnode)->numa_node == cn->numa_node)
+			break;
+		last = nnode;
+	}
+
+	cna_splice_tail(node, next, last);
+	WRITE_ONCE(node->next, nnode);
+	return true;
+}
+
+/*
+ * Called by the queue head when it is the last one in the primary queue.
+ * With an empty secondary queue this is the usual attempt to clear the
+ * tail; otherwise the secondary queue becomes the primary one and its head
+ * is handed the MCS lock.
+ */
+static bool cna_try_clear_tail(struct qspinlock *lock, u32 val, u32 tail,
+			       struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *sec_head, *sec_tail;
+	u32 new;
+
+	if (!cna_has_secondary(node))
+		return __try_clear_tail(lock, val, tail, node);
+
+	if ((val & _Q_TAIL_MASK) != tail)
+		return false;
+
+	sec_tail = decode_tail(node->locked);
+	sec_head = sec_tail->next;
+	sec_tail->next = NULL;
+
+	/*
+	 * Release orders the store above against a newcomer linking itself
+	 * behind the new tail.
+	 */
+	new = ((struct cna_node *)sec_tail)->encoded_tail | _Q_LOCKED_VAL;
+	if (!atomic_try_cmpxchg_release(&lock->val, &val, new)) {
+		sec_tail->next = sec_head;
+		return false;
+	}
+
+	((struct cna_node *)sec_head)->intra_count = 0;
+	arch_mcs_spin_unlock_contended(&sec_head->locked);
+	lockevent_inc(lock_cna_splice);
+	return true;
+}
+
+/*
+ * Hand the MCS lock to a same-node successor if there is one and the
+ * threshold has not been reached; otherwise splice the secondary queue back
+ * in front of @next so that remote waiters get their turn.
+ */
+static void cna_pass_lock(struct mcs_spinlock *node, struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	struct mcs_spinlock *sec_head, *sec_tail;
+	u32 val = 1;
+
+	if (cn->intra_count < CNA_INTRA_NODE_THRESHOLD &&
+	    cna_order_queue(node)) {
+		next = node->next;
+		if (cna_has_secondary(node))
+			val = node->locked;
+		((struct cna_node *)next)->intra_count = cn->intra_count + 1;
+		lockevent_inc(lock_cna_intra);
+	} else if (cna_has_secondary(node)) {
+		sec_tail = decode_tail(node->locked);
+		sec_head = sec_tail->next;
+		sec_tail->next = next;
+		next = sec_head;
+		((struct cna_node *)next)->intra_count = 0;
+		lockevent_inc(lock_cna_splice);
+	} else {
+		((struct cna_node *)next)->intra_count = 0;
+	}
+
+	smp_store_release(&next->locked, val);
+}
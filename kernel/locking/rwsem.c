@@ -24,6 +24,7 @@
 #include <linux/sched/wake_q.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/clock.h>
+#include <linux/topology.h>
 #include <linux/export.h>
 #include <linux/rwsem.h>
 #include <linux/atomic.h>
@@ -355,6 +356,7 @@ struct rwsem_waiter {
 	enum rwsem_waiter_type type;
 	unsigned long timeout;
 	unsigned long last_rowner;
+	int numa_node;
 };
 #define rwsem_first_waiter(sem) \
 	list_first_entry(&sem->wait_list, struct rwsem_waiter, list)
@@ -378,6 +380,51 @@ enum writer_wait_state {
  */
 #define RWSEM_WAIT_TIMEOUT	DIV_ROUND_UP(HZ, 250)
 
+/*
+ * Maximum number of waiters a queueing writer looks back over to find one
+ * running on its own NUMA node.
+ */
+#define RWSEM_NUMA_SCAN_MAX	8
+
+/*
+ * Queue a writer in the wait list.  On NUMA systems, a writer is placed
+ * right behind the closest waiter (counting back from the tail, at most
+ * RWSEM_NUMA_SCAN_MAX entries) that sleeps on the same node, so that
+ * consecutive lock owners tend to share a node and the lock cacheline
+ * doesn't bounce between sockets.  The head of the queue is never
+ * displaced, so the handoff protocol is unaffected, and a waiter that has
+ * already waited past its timeout is never overtaken, which bounds how
+ * long any waiter can be passed over.
+ */
+static void rwsem_add_writer(struct rw_semaphore *sem,
+			     struct rwsem_waiter *waiter)
+{
+	struct rwsem_waiter *pos;
+	int scanned = 0;
+
+	lockdep_assert_held(&sem->wait_lock);
+
+	waiter->numa_node = numa_node_id();
+	if (nr_node_ids == 1 || list_empty(&sem->wait_list))
+		goto add_tail;
+
+	list_for_each_entry_reverse(pos, &sem->wait_list, list) {
+		if (pos->numa_node == waiter->numa_node) {
+			if (list_is_last(&pos->list, &sem->wait_list))
+				break;
+			list_add(&waiter->list, &pos->list);
+			lockevent_inc(rwsem_wlock_numa);
+			return;
+		}
+		if (++scanned >= RWSEM_NUMA_SCAN_MAX ||
+		    time_after(jiffies, pos->timeout))
+			break;
+	}
+
+add_tail:
+	list_add_tail(&waiter->list, &sem->wait_list);
+}
+
 /*
  * Magic number to batch-wakeup waiting readers, even when writers are
  * also present in the queue. This both limits the amount of work the
@@ -1039,6 +1086,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, int state)
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_READ;
 	waiter.timeout = jiffies + RWSEM_WAIT_TIMEOUT;
+	waiter.numa_node = numa_node_id();
 
 	raw_spin_lock_irq(&sem->wait_lock);
 	if (list_empty(&sem->wait_list)) {
@@ -1172,7 +1220,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	/* account for this before adding a new element to the list */
 	wstate = list_empty(&sem->wait_list) ? WRITER_FIRST : WRITER_NOT_FIRST;
 
-	list_add_tail(&waiter.list, &sem->wait_list);
+	rwsem_add_writer(sem, &waiter);
 
 	/* we're now waiting on the lock */
 	if (wstate == WRITER_NOT_FIRST) {
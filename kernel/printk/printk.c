@@ -43,6 +43,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -1951,6 +1952,32 @@ int vprintk_store(int facility, int level,
 			  dict, dictlen, text, text_len);
 }
 
+/*
+ * With "printk.offload=1", printing the log buffer to the consoles is left
+ * to the "printk" kthread, instead of whichever task happens to get the
+ * console lock in printk(), which can take seconds with slow consoles and
+ * a flood of messages.  Output stays synchronous until the kthread runs,
+ * and again once an oops or panic is in progress or the system is going
+ * down, so that nothing which matters is left sitting in the buffer.
+ */
+static bool printk_offload;
+module_param_named(offload, printk_offload, bool, S_IRUGO);
+MODULE_PARM_DESC(offload, "print to consoles from a dedicated kthread");
+
+static struct task_struct *printk_kthread;
+static bool printk_kthread_pending;
+
+static bool printk_kthread_offload(void)
+{
+	if (!printk_kthread || oops_in_progress ||
+	    atomic_read(&panic_cpu) != PANIC_CPU_INVALID ||
+	    system_state > SYSTEM_RUNNING)
+		return false;
+
+	defer_console_output();
+	return true;
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1980,7 +2007,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 	logbuf_unlock_irqrestore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched && pending_output) {
+	if (!in_sched && pending_output && !printk_kthread_offload()) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2950,9 +2977,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_kthread) {
+			WRITE_ONCE(printk_kthread_pending, true);
+			wake_up_process(printk_kthread);
+		} else if (console_trylock()) {
+			/* If trylock fails, someone else is doing the printing */
 			console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -2982,6 +3013,40 @@ void defer_console_output(void)
 	preempt_enable();
 }
 
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!READ_ONCE(printk_kthread_pending))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		WRITE_ONCE(printk_kthread_pending, false);
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	if (!printk_offload)
+		return 0;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: failed to start the printing kthread\n");
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 int vprintk_deferred(const char *fmt, va_list args)
 {
 	int r;
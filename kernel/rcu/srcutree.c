@@ -640,6 +640,15 @@ static void srcu_funnel_gp_start(struct srcu_struct *ssp, struct srcu_data *sdp,
 	for (; snp != NULL; snp = snp->srcu_parent) {
 		if (rcu_seq_done(&ssp->srcu_gp_seq, s) && snp != sdp->mynode)
 			return; /* GP already done and CBs recorded. */
+		/*
+		 * Above the leaf, a normal request for a grace period that
+		 * some other CPU has already recorded at this level can
+		 * piggyback on that CPU's traversal without taking the lock.
+		 * The acquire pairs with the release of that CPU's lock.
+		 */
+		if (do_norm && snp != sdp->mynode &&
+		    ULONG_CMP_GE(smp_load_acquire(&snp->srcu_have_cbs[idx]), s))
+			return;
 		spin_lock_irqsave_rcu_node(snp, flags);
 		if (ULONG_CMP_GE(snp->srcu_have_cbs[idx], s)) {
 			snp_seq = snp->srcu_have_cbs[idx];
@@ -656,7 +665,7 @@ static void srcu_funnel_gp_start(struct srcu_struct *ssp, struct srcu_data *sdp,
 				srcu_funnel_exp_start(ssp, snp, s);
 			return;
 		}
-		snp->srcu_have_cbs[idx] = s;
+		WRITE_ONCE(snp->srcu_have_cbs[idx], s);
 		if (snp == sdp->mynode)
 			snp->srcu_data_have_cbs[idx] |= sdp->grpmask;
 		if (!do_norm && ULONG_CMP_LT(snp->srcu_gp_seq_needed_exp, s))
@@ -664,7 +673,13 @@ static void srcu_funnel_gp_start(struct srcu_struct *ssp, struct srcu_data *sdp,
 		spin_unlock_irqrestore_rcu_node(snp, flags);
 	}
 
-	/* Top of tree, must ensure the grace period will be started. */
+	/*
+	 * Top of tree, must ensure the grace period will be started.
+	 * If a normal grace period covering s is already needed, whoever
+	 * recorded that need has taken care of starting it.
+	 */
+	if (do_norm && ULONG_CMP_GE(smp_load_acquire(&ssp->srcu_gp_seq_needed), s))
+		return;
 	spin_lock_irqsave_rcu_node(ssp, flags);
 	if (ULONG_CMP_LT(ssp->srcu_gp_seq_needed, s)) {
 		/*
@@ -15,6 +15,7 @@
 #include <linux/workqueue.h>
 #include <linux/compat.h>
 #include <linux/sched/deadline.h>
+#include <linux/task_work.h>
 
 #include "posix-timers.h"
 
@@ -1105,20 +1106,44 @@ static inline bool fastpath_timer_check(struct task_struct *tsk)
 	return false;
 }
 
+static void handle_posix_cpu_timers(struct task_struct *tsk);
+
+/*
+ * Runs on the way back to user space, after the tick found expired timers
+ * and queued it.
+ */
+static void posix_cpu_timers_work(struct callback_head *work)
+{
+	struct task_struct *tsk = current;
+
+	local_irq_disable();
+	WRITE_ONCE(tsk->posix_cputimers.work_scheduled, 0);
+	handle_posix_cpu_timers(tsk);
+	local_irq_enable();
+}
+
 /*
  * This is called from the timer interrupt handler.  The irq handler has
  * already updated our counts.  We need to check if any timers fire now.
  * Interrupts are disabled.
+ *
+ * Collecting and firing expired timers takes sighand->siglock, which is
+ * contended for large thread groups, so when the tick interrupted user
+ * space that work is handed to task_work and done on the imminent return
+ * to user space.  Ticks that hit the kernel (which includes guest mode)
+ * may not get back to user space soon, so they still do it right here.
  */
-void run_posix_cpu_timers(void)
+void run_posix_cpu_timers(int user_tick)
 {
+	struct posix_cputimers *pct = &current->posix_cputimers;
 	struct task_struct *tsk = current;
-	struct k_itimer *timer, *next;
-	unsigned long flags;
-	LIST_HEAD(firing);
 
 	lockdep_assert_irqs_disabled();
 
+	/* Expiry is already queued; it will see anything found now too. */
+	if (READ_ONCE(pct->work_scheduled))
+		return;
+
 	/*
 	 * The fast path checks that there are no expired thread or thread
 	 * group timers.  If that's so, just return.
@@ -1126,6 +1151,23 @@ void run_posix_cpu_timers(void)
 	if (!fastpath_timer_check(tsk))
 		return;
 
+	if (user_tick && !(tsk->flags & (PF_EXITING | PF_KTHREAD))) {
+		init_task_work(&pct->work, posix_cpu_timers_work);
+		if (!task_work_add(tsk, &pct->work, true)) {
+			WRITE_ONCE(pct->work_scheduled, 1);
+			return;
+		}
+	}
+
+	handle_posix_cpu_timers(tsk);
+}
+
+static void handle_posix_cpu_timers(struct task_struct *tsk)
+{
+	struct k_itimer *timer, *next;
+	unsigned long flags;
+	LIST_HEAD(firing);
+
 	if (!lock_task_sighand(tsk, &flags))
 		return;
 	/*
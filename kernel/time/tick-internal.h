@@ -164,4 +164,12 @@ static inline void timers_update_nohz(void) { }
 DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
 
 extern u64 get_next_timer_interrupt(unsigned long basej, u64 basem);
+
+struct timer_wheel_stats {
+	unsigned long	pending;
+	unsigned long	expired;
+	unsigned long	max_expiry_lag;
+};
+extern void timer_wheel_get_stats(unsigned int cpu,
+				  struct timer_wheel_stats *stats);
 void timer_clear_idle(void);
@@ -179,32 +179,37 @@ bool tick_nohz_full_running;
 EXPORT_SYMBOL_GPL(tick_nohz_full_running);
 static atomic_t tick_dep_mask;
 
-static bool check_tick_dependency(atomic_t *dep)
+static bool check_tick_dependency(atomic_t *dep, struct tick_sched *ts)
 {
 	int val = atomic_read(dep);
 
 	if (val & TICK_DEP_MASK_POSIX_TIMER) {
 		trace_tick_stop(0, TICK_DEP_MASK_POSIX_TIMER);
+		ts->tick_dep_fails[TICK_DEP_BIT_POSIX_TIMER]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_PERF_EVENTS) {
 		trace_tick_stop(0, TICK_DEP_MASK_PERF_EVENTS);
+		ts->tick_dep_fails[TICK_DEP_BIT_PERF_EVENTS]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_SCHED) {
 		trace_tick_stop(0, TICK_DEP_MASK_SCHED);
+		ts->tick_dep_fails[TICK_DEP_BIT_SCHED]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_CLOCK_UNSTABLE) {
 		trace_tick_stop(0, TICK_DEP_MASK_CLOCK_UNSTABLE);
+		ts->tick_dep_fails[TICK_DEP_BIT_CLOCK_UNSTABLE]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_RCU) {
 		trace_tick_stop(0, TICK_DEP_MASK_RCU);
+		ts->tick_dep_fails[TICK_DEP_BIT_RCU]++;
 		return true;
 	}
 
@@ -218,16 +223,16 @@ static bool can_stop_full_tick(int cpu, struct tick_sched *ts)
 	if (unlikely(!cpu_online(cpu)))
 		return false;
 
-	if (check_tick_dependency(&tick_dep_mask))
+	if (check_tick_dependency(&tick_dep_mask, ts))
 		return false;
 
-	if (check_tick_dependency(&ts->tick_dep_mask))
+	if (check_tick_dependency(&ts->tick_dep_mask, ts))
 		return false;
 
-	if (check_tick_dependency(&current->tick_dep_mask))
+	if (check_tick_dependency(&current->tick_dep_mask, ts))
 		return false;
 
-	if (check_tick_dependency(&current->signal->tick_dep_mask))
+	if (check_tick_dependency(&current->signal->tick_dep_mask, ts))
 		return false;
 
 	return true;
@@ -3,6 +3,7 @@
 #define _TICK_SCHED_H
 
 #include <linux/hrtimer.h>
+#include <linux/tick.h>
 
 enum tick_device_mode {
 	TICKDEV_MODE_PERIODIC,
@@ -77,6 +78,10 @@ struct tick_sched {
 	u64				next_timer;
 	ktime_t				idle_expires;
 	atomic_t			tick_dep_mask;
+#ifdef CONFIG_NO_HZ_FULL
+	/* Times each dependency kept the tick from being stopped */
+	unsigned long			tick_dep_fails[TICK_DEP_BIT_MAX + 1];
+#endif
 };
 
 extern struct tick_sched *tick_get_tick_sched(int cpu);
@@ -544,6 +544,45 @@ u64 ktime_get_real_fast_ns(void)
 }
 EXPORT_SYMBOL_GPL(ktime_get_real_fast_ns);
 
+/**
+ * ktime_get_fast_timestamps: - NMI safe timestamps of several clocks at once
+ * @snap:	Pointer to timestamp storage
+ *
+ * Stores clock monotonic, boottime, realtime and TAI timestamps which all
+ * derive from a single clocksource read and a single pass over the fast
+ * timekeeper, so they are mutually consistent apart from the caveats
+ * below.  Useful to correlate the clocks in tracing at high rates.
+ *
+ * Monotonic and realtime come from the same latch-protected readout base.
+ * The boottime and TAI offsets are read without synchronization, with the
+ * same side effects as described for ktime_get_boot_fast_ns().
+ */
+void ktime_get_fast_timestamps(struct ktime_timestamps *snap)
+{
+	struct timekeeper *tk = &tk_core.timekeeper;
+	struct tk_fast *tkf = &tk_fast_mono;
+	struct tk_read_base *tkr;
+	unsigned int seq;
+	u64 delta;
+
+	do {
+		seq = raw_read_seqcount_latch(&tkf->seq);
+		tkr = tkf->base + (seq & 0x01);
+
+		delta = timekeeping_delta_to_ns(tkr,
+				clocksource_delta(
+					tk_clock_read(tkr),
+					tkr->cycle_last,
+					tkr->mask));
+		snap->mono = ktime_to_ns(tkr->base) + delta;
+		snap->real = ktime_to_ns(tkr->base_real) + delta;
+	} while (read_seqcount_retry(&tkf->seq, seq));
+
+	snap->boot = snap->mono + ktime_to_ns(tk->offs_boot);
+	snap->tai = snap->mono + ktime_to_ns(tk->offs_tai);
+}
+EXPORT_SYMBOL_GPL(ktime_get_fast_timestamps);
+
 /**
  * halt_fast_timekeeper - Prevent fast timekeeper from accessing clocksource.
  * @tk: Timekeeper to snapshot.
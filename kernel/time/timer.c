@@ -205,6 +205,10 @@ struct timer_base {
 	unsigned int		cpu;
 	bool			is_idle;
 	bool			must_forward_clk;
+	/* Statistics, reported through /proc/timer_list */
+	unsigned int		nr_timers;
+	unsigned long		nr_expired;
+	unsigned long		max_expiry_lag;
 	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
 	struct hlist_head	vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
@@ -540,6 +544,7 @@ static void enqueue_timer(struct timer_base *base, struct timer_list *timer,
 	hlist_add_head(&timer->entry, base->vectors + idx);
 	__set_bit(idx, base->pending_map);
 	timer_set_idx(timer, idx);
+	base->nr_timers++;
 
 	trace_timer_start(timer, timer->expires, timer->flags);
 }
@@ -830,6 +835,7 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
 		__clear_bit(idx, base->pending_map);
 
 	detach_timer(timer, clear_pending);
+	base->nr_timers--;
 	return 1;
 }
 
@@ -1427,6 +1433,11 @@ static void expire_timers(struct timer_base *base, struct hlist_head *head)
 	 * is related to the old base->clk value.
 	 */
 	unsigned long baseclk = base->clk - 1;
+	unsigned long lag = jiffies - baseclk;
+
+	/* How far behind the wheel clock is when it gets to this bucket. */
+	if (lag > base->max_expiry_lag)
+		base->max_expiry_lag = lag;
 
 	while (!hlist_empty(head)) {
 		struct timer_list *timer;
@@ -1436,6 +1447,8 @@ static void expire_timers(struct timer_base *base, struct hlist_head *head)
 
 		base->running_timer = timer;
 		detach_timer(timer, true);
+		base->nr_timers--;
+		base->nr_expired++;
 
 		fn = timer->function;
 
@@ -1730,7 +1743,7 @@ void update_process_times(int user_tick)
 #endif
 	scheduler_tick();
 	if (IS_ENABLED(CONFIG_POSIX_TIMERS))
-		run_posix_cpu_timers();
+		run_posix_cpu_timers(user_tick);
 }
 
 /**
@@ -1941,6 +1954,29 @@ signed long __sched schedule_timeout_idle(signed long timeout)
 }
 EXPORT_SYMBOL(schedule_timeout_idle);
 
+/**
+ * timer_wheel_get_stats - Collect timer wheel statistics of a CPU
+ * @cpu:	The CPU whose timer bases are inspected
+ * @stats:	Where to store the sums over all of @cpu's timer bases
+ *
+ * The values are read without holding the base locks and are therefore
+ * only approximate.
+ */
+void timer_wheel_get_stats(unsigned int cpu, struct timer_wheel_stats *stats)
+{
+	struct timer_base *base;
+	int b;
+
+	memset(stats, 0, sizeof(*stats));
+	for (b = 0; b < NR_BASES; b++) {
+		base = per_cpu_ptr(&timer_bases[b], cpu);
+		stats->pending += READ_ONCE(base->nr_timers);
+		stats->expired += READ_ONCE(base->nr_expired);
+		stats->max_expiry_lag = max(stats->max_expiry_lag,
+					    READ_ONCE(base->max_expiry_lag));
+	}
+}
+
 #ifdef CONFIG_HOTPLUG_CPU
 static void migrate_timer_list(struct timer_base *new_base, struct hlist_head *head)
 {
@@ -1998,6 +2034,7 @@ int timers_dead_cpu(unsigned int cpu)
 
 		for (i = 0; i < WHEEL_SIZE; i++)
 			migrate_timer_list(new_base, old_base->vectors + i);
+		old_base->nr_timers = 0;
 
 		raw_spin_unlock(&old_base->lock);
 		raw_spin_unlock_irq(&new_base->lock);
@@ -151,6 +151,7 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 	P(nr_retries);
 	P(nr_hangs);
 	P(max_hang_time);
+	P(nr_coalesced);
 #endif
 #undef P
 #undef P_ns
@@ -178,6 +179,22 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 		P(last_jiffies);
 		P(next_timer);
 		P_ns(idle_expires);
+#ifdef CONFIG_NO_HZ_FULL
+		{
+			static const char * const dep_names[] = {
+				[TICK_DEP_BIT_POSIX_TIMER]	= "dep_posix_timer",
+				[TICK_DEP_BIT_PERF_EVENTS]	= "dep_perf_events",
+				[TICK_DEP_BIT_SCHED]		= "dep_sched",
+				[TICK_DEP_BIT_CLOCK_UNSTABLE]	= "dep_clk_unstable",
+				[TICK_DEP_BIT_RCU]		= "dep_rcu",
+			};
+			int i;
+
+			for (i = 0; i < ARRAY_SIZE(dep_names); i++)
+				SEQ_printf(m, "  .%-15s: %lu\n", dep_names[i],
+					   ts->tick_dep_fails[i]);
+		}
+#endif
 		SEQ_printf(m, "jiffies: %Lu\n",
 			   (unsigned long long)jiffies);
 	}
@@ -185,6 +202,17 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 
 #undef P
 #undef P_ns
+
+	{
+		struct timer_wheel_stats st;
+
+		timer_wheel_get_stats(cpu, &st);
+		SEQ_printf(m, " timer wheel:\n");
+		SEQ_printf(m, "  .%-15s: %lu\n", "pending", st.pending);
+		SEQ_printf(m, "  .%-15s: %lu\n", "expired", st.expired);
+		SEQ_printf(m, "  .%-15s: %lu jiffies\n", "max_expiry_lag",
+			   st.max_expiry_lag);
+	}
 	SEQ_printf(m, "\n");
 }
 
@@ -276,7 +304,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.8\n");
+	SEQ_printf(m, "Timer List Version: v0.9\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
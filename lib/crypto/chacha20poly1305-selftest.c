@@ -8889,6 +8889,7 @@ bool __init chacha20poly1305_selftest(void)
 	u8 *computed_output = NULL, *input = NULL;
 	bool success = true, ret;
 	struct scatterlist sg_src[3];
+	struct chacha20poly1305_batch batch[2];
 
 	computed_output = kmalloc(MAXIMUM_TEST_BUFFER_LEN, GFP_KERNEL);
 	input = kmalloc(MAXIMUM_TEST_BUFFER_LEN, GFP_KERNEL);
@@ -8941,6 +8942,35 @@ bool __init chacha20poly1305_selftest(void)
 		}
 	}
 
+	for (i = 0; i < ARRAY_SIZE(chacha20poly1305_enc_vectors); ++i) {
+		if (chacha20poly1305_enc_vectors[i].nlen != 8)
+			continue;
+		memset(computed_output, 0, MAXIMUM_TEST_BUFFER_LEN);
+		memset(input, 0, MAXIMUM_TEST_BUFFER_LEN);
+		for (j = 0; j < ARRAY_SIZE(batch); ++j) {
+			batch[j].dst = j ? input : computed_output;
+			batch[j].src = chacha20poly1305_enc_vectors[i].input;
+			batch[j].src_len = chacha20poly1305_enc_vectors[i].ilen;
+			batch[j].ad = chacha20poly1305_enc_vectors[i].assoc;
+			batch[j].ad_len = chacha20poly1305_enc_vectors[i].alen;
+			batch[j].nonce = get_unaligned_le64(
+				chacha20poly1305_enc_vectors[i].nonce);
+		}
+		chacha20poly1305_encrypt_batch(batch, ARRAY_SIZE(batch),
+			chacha20poly1305_enc_vectors[i].key);
+		for (j = 0; j < ARRAY_SIZE(batch); ++j) {
+			if (memcmp(batch[j].dst,
+				   chacha20poly1305_enc_vectors[i].output,
+				   chacha20poly1305_enc_vectors[i].ilen +
+							POLY1305_DIGEST_SIZE)) {
+				pr_err("chacha20poly1305 batch encryption self-test %zu: FAIL\n",
+				       i + 1);
+				success = false;
+				break;
+			}
+		}
+	}
+
 	for (i = 0; i < ARRAY_SIZE(chacha20poly1305_dec_vectors); ++i) {
 		memset(computed_output, 0, MAXIMUM_TEST_BUFFER_LEN);
 		ret = chacha20poly1305_decrypt(computed_output,
@@ -111,6 +111,37 @@ void chacha20poly1305_encrypt(u8 *dst, const u8 *src, const size_t src_len,
 }
 EXPORT_SYMBOL(chacha20poly1305_encrypt);
 
+/*
+ * Encrypt @nr independent messages under one key, as a stream of packets
+ * to the same peer would be. The key schedule is loaded once for the
+ * whole batch; each message gets its own nonce, ChaCha state and
+ * Poly1305 tag, exactly as with chacha20poly1305_encrypt().
+ */
+void chacha20poly1305_encrypt_batch(struct chacha20poly1305_batch *msgs,
+				    unsigned int nr,
+				    const u8 key[CHACHA20POLY1305_KEY_SIZE])
+{
+	u32 chacha_state[CHACHA_STATE_WORDS];
+	u32 k[CHACHA_KEY_WORDS];
+	__le64 iv[2];
+	unsigned int i;
+
+	chacha_load_key(k, key);
+
+	iv[0] = 0;
+	for (i = 0; i < nr; i++) {
+		iv[1] = cpu_to_le64(msgs[i].nonce);
+		chacha_init(chacha_state, k, (u8 *)iv);
+		__chacha20poly1305_encrypt(msgs[i].dst, msgs[i].src,
+					   msgs[i].src_len, msgs[i].ad,
+					   msgs[i].ad_len, chacha_state);
+	}
+
+	memzero_explicit(iv, sizeof(iv));
+	memzero_explicit(k, sizeof(k));
+}
+EXPORT_SYMBOL(chacha20poly1305_encrypt_batch);
+
 void xchacha20poly1305_encrypt(u8 *dst, const u8 *src, const size_t src_len,
 			       const u8 *ad, const size_t ad_len,
 			       const u8 nonce[XCHACHA20POLY1305_NONCE_SIZE],
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * An API to time a function from within a KUnit test case.
+ */
+
+#include <kunit/bench.h>
+#include <kunit/test.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+
+static const struct kunit_bench_params kunit_bench_default_params = {
+	.warmup = 16,
+	.iterations = 1000,
+	.cpu = -1,
+};
+
+static int kunit_bench_cmp(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a;
+	u64 y = *(const u64 *)b;
+
+	if (x < y)
+		return -1;
+	return x > y;
+}
+
+/* Nearest rank percentile of sorted samples. */
+static u64 kunit_bench_percentile(const u64 *samples, unsigned int n,
+				  unsigned int percent)
+{
+	return samples[div_u64((u64)(n - 1) * percent, 100)];
+}
+
+static void kunit_bench_measure(const struct kunit_bench_params *params,
+				kunit_bench_func_t func, void *context,
+				void *cold, u64 *samples)
+{
+	unsigned int i;
+	u64 start;
+
+	for (i = 0; i < params->warmup; i++) {
+		func(context);
+		cond_resched();
+	}
+
+	for (i = 0; i < params->iterations; i++) {
+		if (cold)
+			memset(cold, i, params->cold_size);
+
+		start = ktime_get_ns();
+		func(context);
+		samples[i] = ktime_get_ns() - start;
+
+		cond_resched();
+	}
+}
+
+int kunit_bench_run(struct kunit *test, const char *name,
+		    const struct kunit_bench_params *params,
+		    kunit_bench_func_t func, void *context,
+		    struct kunit_bench_result *result)
+{
+	struct kunit_bench_result res;
+	cpumask_var_t saved_mask;
+	unsigned int i, n;
+	void *cold = NULL;
+	u64 *samples;
+	u64 total = 0;
+	int ret;
+
+	if (!params)
+		params = &kunit_bench_default_params;
+	n = params->iterations;
+	if (!n)
+		return -EINVAL;
+	if (params->cpu >= 0 &&
+	    (params->cpu >= nr_cpu_ids || !cpu_online(params->cpu)))
+		return -EINVAL;
+
+	samples = kvmalloc_array(n, sizeof(*samples), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	ret = -ENOMEM;
+	if (params->cold_size) {
+		cold = vmalloc(params->cold_size);
+		if (!cold)
+			goto out_free_samples;
+	}
+
+	if (!alloc_cpumask_var(&saved_mask, GFP_KERNEL))
+		goto out_free_cold;
+
+	cpumask_copy(saved_mask, current->cpus_ptr);
+	if (params->cpu >= 0) {
+		ret = set_cpus_allowed_ptr(current, cpumask_of(params->cpu));
+		if (ret)
+			goto out_free_mask;
+	}
+
+	kunit_bench_measure(params, func, context, cold, samples);
+
+	if (params->cpu >= 0)
+		set_cpus_allowed_ptr(current, saved_mask);
+
+	sort(samples, n, sizeof(*samples), kunit_bench_cmp, NULL);
+	for (i = 0; i < n; i++)
+		total += samples[i];
+
+	res.min = samples[0];
+	res.p50 = kunit_bench_percentile(samples, n, 50);
+	res.p90 = kunit_bench_percentile(samples, n, 90);
+	res.p99 = kunit_bench_percentile(samples, n, 99);
+	res.max = samples[n - 1];
+	res.mean = div_u64(total, n);
+
+	kunit_info(test,
+		   "bench %s: iterations=%u min=%llu p50=%llu p90=%llu p99=%llu max=%llu mean=%llu ns\n",
+		   name, n, res.min, res.p50, res.p90, res.p99, res.max,
+		   res.mean);
+
+	if (result)
+		*result = res;
+	ret = 0;
+
+out_free_mask:
+	free_cpumask_var(saved_mask);
+out_free_cold:
+	vfree(cold);
+out_free_samples:
+	kvfree(samples);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(kunit_bench_run);
@@ -5,6 +5,7 @@
  * Copyright (C) 2019, Google LLC.
  * Author: Brendan Higgins <brendanhiggins@google.com>
  */
+#include <kunit/bench.h>
 #include <kunit/test.h>
 
 #include "try-catch-impl.h"
@@ -329,6 +330,70 @@ static struct kunit_suite kunit_resource_test_suite = {
 	.exit = kunit_resource_test_exit,
 	.test_cases = kunit_resource_test_cases,
 };
-kunit_test_suites(&kunit_try_catch_test_suite, &kunit_resource_test_suite);
+static void kunit_bench_test_count(void *context)
+{
+	unsigned int *calls = context;
+
+	(*calls)++;
+}
+
+static void kunit_bench_test_calls(struct kunit *test)
+{
+	struct kunit_bench_params params = {
+		.warmup = 3,
+		.iterations = 10,
+		.cpu = -1,
+		.cold_size = PAGE_SIZE,
+	};
+	struct kunit_bench_result result;
+	unsigned int calls = 0;
+
+	KUNIT_ASSERT_EQ(test,
+			kunit_bench_run(test, "count", &params,
+					kunit_bench_test_count, &calls,
+					&result),
+			0);
+	KUNIT_EXPECT_EQ(test, calls, 13U);
+	KUNIT_EXPECT_LE(test, result.min, result.p50);
+	KUNIT_EXPECT_LE(test, result.p50, result.p90);
+	KUNIT_EXPECT_LE(test, result.p90, result.p99);
+	KUNIT_EXPECT_LE(test, result.p99, result.max);
+	KUNIT_EXPECT_LE(test, result.mean, result.max);
+}
+
+static void kunit_bench_test_pinned(struct kunit *test)
+{
+	struct kunit_bench_params params = {
+		.iterations = 1,
+		.cpu = raw_smp_processor_id(),
+	};
+	unsigned int calls = 0;
+
+	KUNIT_EXPECT_EQ(test,
+			kunit_bench_run(test, "pinned", &params,
+					kunit_bench_test_count, &calls, NULL),
+			0);
+	KUNIT_EXPECT_EQ(test, calls, 1U);
+
+	params.iterations = 0;
+	KUNIT_EXPECT_EQ(test,
+			kunit_bench_run(test, "empty", &params,
+					kunit_bench_test_count, &calls, NULL),
+			-EINVAL);
+	KUNIT_EXPECT_EQ(test, calls, 1U);
+}
+
+static struct kunit_case kunit_bench_test_cases[] = {
+	KUNIT_CASE(kunit_bench_test_calls),
+	KUNIT_CASE(kunit_bench_test_pinned),
+	{}
+};
+
+static struct kunit_suite kunit_bench_test_suite = {
+	.name = "kunit-bench-test",
+	.test_cases = kunit_bench_test_cases,
+};
+kunit_test_suites(&kunit_try_catch_test_suite, &kunit_resource_test_suite,
+		  &kunit_bench_test_suite);
 
 MODULE_LICENSE("GPL v2");
@@ -268,8 +268,16 @@ static FORCE_INLINE int LZ4_decompress_generic(
 			if (!partialDecoding || (cpy == oend))
 				break;
 		} else {
-			/* may overwrite up to WILDCOPYLENGTH beyond cpy */
-			LZ4_wildCopy(op, ip, cpy);
+			/*
+			 * may overwrite up to WILDCOPYLENGTH beyond cpy,
+			 * or WILDCOPY16LENGTH when both buffers have room
+			 */
+			if (endOnInput && length > 16 &&
+			    cpy <= oend - WILDCOPY16LENGTH &&
+			    ip + length <= iend - WILDCOPY16LENGTH)
+				LZ4_wildCopy16(op, ip, cpy);
+			else
+				LZ4_wildCopy(op, ip, cpy);
 			ip += length;
 			op = cpy;
 		}
@@ -426,8 +434,13 @@ static FORCE_INLINE int LZ4_decompress_generic(
 				*op++ = *match++;
 		} else {
 			LZ4_copy8(op, match);
-			if (length > 16)
-				LZ4_wildCopy(op + 8, match + 8, cpy);
+			if (length > 16) {
+				if (offset >= 16 &&
+				    cpy <= oend - WILDCOPY16LENGTH)
+					LZ4_wildCopy16(op + 8, match + 8, cpy);
+				else
+					LZ4_wildCopy(op + 8, match + 8, cpy);
+			}
 		}
 		op = cpy; /* wildcopy correction */
 	}
@@ -73,6 +73,7 @@ typedef uintptr_t uptrval;
 #define MINMATCH 4
 
 #define WILDCOPYLENGTH 8
+#define WILDCOPY16LENGTH 16
 #define LASTLITERALS 5
 #define MFLIMIT (WILDCOPYLENGTH + MINMATCH)
 /*
@@ -170,6 +171,26 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+/*
+ * wide variant of LZ4_wildCopy() for long literal runs and matches,
+ * which can overwrite up to 15 bytes beyond dstEnd.
+ * src and dst must not overlap within 16 bytes.
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	do {
+		LZ4_copy8(d, s);
+		LZ4_copy8(d + 8, s + 8);
+		d += 16;
+		s += 16;
+	} while (d < e);
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
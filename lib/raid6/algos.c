@@ -28,6 +28,16 @@ EXPORT_SYMBOL(raid6_empty_zero_page);
 struct raid6_calls raid6_call;
 EXPORT_SYMBOL_GPL(raid6_call);
 
+/*
+ * Name of the gen/xor routine set to use instead of benchmarking, e.g.
+ * raid6_pq.algo=avx2x4 with a result from an earlier boot.
+ */
+static char *raid6_algo;
+#ifdef __KERNEL__
+module_param_named(algo, raid6_algo, charp, 0444);
+MODULE_PARM_DESC(algo, "Use this RAID6 syndrome algorithm, skipping the benchmark");
+#endif
+
 const struct raid6_calls * const raid6_algos[] = {
 #if defined(__i386__) && !defined(__arch_um__)
 #ifdef CONFIG_AS_AVX512
@@ -148,15 +158,39 @@ static inline const struct raid6_recov_calls *raid6_choose_recov(void)
 	return best;
 }
 
+static const struct raid6_calls *raid6_find_gen(const char *name)
+{
+	const struct raid6_calls *const *algo;
+
+	for (algo = raid6_algos; *algo; algo++)
+		if (!strcmp((*algo)->name, name))
+			if (!(*algo)->valid || (*algo)->valid())
+				return *algo;
+
+	return NULL;
+}
+
 static inline const struct raid6_calls *raid6_choose_gen(
 	void *(*const dptrs)[RAID6_TEST_DISKS], const int disks)
 {
 	unsigned long perf, bestgenperf, bestxorperf, j0, j1;
 	int start = (disks>>1)-1, stop = disks-3;	/* work on the second half of the disks */
 	const struct raid6_calls *const *algo;
-	const struct raid6_calls *best;
+	const struct raid6_calls *best, *bestxor;
+
+	if (raid6_algo) {
+		best = raid6_find_gen(raid6_algo);
+		if (best) {
+			pr_info("raid6: using requested algorithm %s\n",
+				best->name);
+			raid6_call = *best;
+			return best;
+		}
+		pr_err("raid6: algorithm %s not available\n", raid6_algo);
+	}
 
-	for (bestgenperf = 0, bestxorperf = 0, best = NULL, algo = raid6_algos; *algo; algo++) {
+	for (bestgenperf = 0, bestxorperf = 0, best = NULL, bestxor = NULL,
+	     algo = raid6_algos; *algo; algo++) {
 		if (!best || (*algo)->prefer >= best->prefer) {
 			if ((*algo)->valid && !(*algo)->valid())
 				continue;
@@ -204,8 +238,14 @@ static inline const struct raid6_calls *raid6_choose_gen(
 			}
 			preempt_enable();
 
-			if (best == *algo)
+			/*
+			 * The fastest xor() need not come from the fastest
+			 * gen(), so pick it on its own.
+			 */
+			if (perf > bestxorperf) {
 				bestxorperf = perf;
+				bestxor = *algo;
+			}
 
 			pr_info("raid6: %-8s xor() %5ld MB/s\n", (*algo)->name,
 				(perf * HZ * (disks-2)) >>
@@ -219,14 +259,17 @@ static inline const struct raid6_calls *raid6_choose_gen(
 				best->name,
 				(bestgenperf * HZ * (disks-2)) >>
 				(20 - PAGE_SHIFT+RAID6_TIME_JIFFIES_LG2));
-			if (best->xor_syndrome)
-				pr_info("raid6: .... xor() %ld MB/s, rmw enabled\n",
+			if (bestxor)
+				pr_info("raid6: .... xor() %ld MB/s using %s, rmw enabled\n",
 					(bestxorperf * HZ * (disks-2)) >>
-					(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2 + 1));
+					(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2 + 1),
+					bestxor->name);
 		} else
 			pr_info("raid6: skip pq benchmark and using algorithm %s\n",
 				best->name);
 		raid6_call = *best;
+		if (bestxor)
+			raid6_call.xor_syndrome = bestxor->xor_syndrome;
 	} else
 		pr_err("raid6: Yikes!  No algorithm found!\n");
 
@@ -0,0 +1,124 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation. This program is dual-licensed; you may select
+ * either version 2 of the GNU General Public License ("GPL") or BSD license
+ * ("BSD").
+ */
+
+/*
+ * Parallel compression of large buffers.
+ *
+ * The input is cut into jobs of jobSize bytes, and each job is compressed as
+ * an independent zstd frame on system_unbound_wq. The frames are then copied
+ * back to back into dst. ZSTD_decompressDCtx() decodes concatenated frames
+ * in one call; ZSTD_decompressStream() returns 0 after each frame and has to
+ * be called again while input remains.
+ */
+
+/*-*************************************
+*  Dependencies
+***************************************/
+#include "zstd_internal.h" /* includes zstd.h */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+
+typedef struct {
+	struct work_struct work;
+	ZSTD_CCtx *cctx;
+	void *buf;
+	size_t bufCapacity;
+	const void *src;
+	size_t srcSize;
+	ZSTD_parameters params;
+	size_t result;
+} ZSTD_job;
+
+static size_t ZSTD_jobWorkspaceBound(ZSTD_compressionParameters cParams, size_t jobSize)
+{
+	return ZSTD_ALIGN(sizeof(ZSTD_job)) + ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(cParams)) + ZSTD_ALIGN(ZSTD_compressBound(jobSize));
+}
+
+static ZSTD_job *ZSTD_jobAt(void *workspace, size_t jobSpace, unsigned i) { return (ZSTD_job *)((BYTE *)workspace + i * jobSpace); }
+
+size_t ZSTD_compressJobsWorkspaceBound(ZSTD_compressionParameters cParams, size_t jobSize, unsigned nbWorkers)
+{
+	return nbWorkers * ZSTD_jobWorkspaceBound(cParams, jobSize);
+}
+
+static void ZSTD_compressJob(struct work_struct *work)
+{
+	ZSTD_job *const job = container_of(work, ZSTD_job, work);
+
+	job->result = ZSTD_compressCCtx(job->cctx, job->buf, job->bufCapacity, job->src, job->srcSize, job->params);
+}
+
+size_t ZSTD_compressJobs(void *workspace, size_t workspaceSize, void *dst, size_t dstCapacity, const void *src, size_t srcSize, size_t jobSize,
+			 unsigned nbWorkers, ZSTD_parameters params)
+{
+	size_t const cctxSize = ZSTD_CCtxWorkspaceBound(params.cParams);
+	size_t const bufSize = ZSTD_compressBound(jobSize);
+	size_t const jobSpace = ZSTD_jobWorkspaceBound(params.cParams, jobSize);
+	BYTE *op = (BYTE *)dst;
+	const BYTE *ip = (const BYTE *)src;
+	const BYTE *const iend = ip + srcSize;
+	unsigned n, i;
+
+	if (!jobSize || !nbWorkers)
+		return ERROR(parameter_unknown);
+	if (workspaceSize < ZSTD_compressJobsWorkspaceBound(params.cParams, jobSize, nbWorkers))
+		return ERROR(memory_allocation);
+	CHECK_F(ZSTD_checkCParams(params.cParams));
+
+	for (i = 0; i < nbWorkers; i++) {
+		ZSTD_job *const job = ZSTD_jobAt(workspace, jobSpace, i);
+		BYTE *const base = (BYTE *)job;
+
+		job->cctx = ZSTD_initCCtx(base + ZSTD_ALIGN(sizeof(ZSTD_job)), cctxSize);
+		if (!job->cctx)
+			return ERROR(memory_allocation);
+		job->buf = base + ZSTD_ALIGN(sizeof(ZSTD_job)) + ZSTD_ALIGN(cctxSize);
+		job->bufCapacity = bufSize;
+		job->params = params;
+		INIT_WORK(&job->work, ZSTD_compressJob);
+	}
+
+	/* An empty input still produces one (empty) frame. */
+	do {
+		/* Queue all but the last job of this round, and run that one here. */
+		for (n = 0; n < nbWorkers && (n == 0 || ip < iend); n++) {
+			ZSTD_job *const job = ZSTD_jobAt(workspace, jobSpace, n);
+
+			job->src = ip;
+			job->srcSize = MIN(jobSize, (size_t)(iend - ip));
+			ip += job->srcSize;
+			if (n + 1 < nbWorkers && ip < iend)
+				queue_work(system_unbound_wq, &job->work);
+			else
+				ZSTD_compressJob(&job->work);
+		}
+
+		for (i = 0; i < n; i++)
+			flush_work(&ZSTD_jobAt(workspace, jobSpace, i)->work);
+
+		/* Stitch the frames of this round in input order. */
+		for (i = 0; i < n; i++) {
+			ZSTD_job *const job = ZSTD_jobAt(workspace, jobSpace, i);
+			size_t const cSize = job->result;
+
+			if (ZSTD_isError(cSize))
+				return cSize;
+			if (cSize > dstCapacity - (size_t)(op - (BYTE *)dst))
+				return ERROR(dstSize_tooSmall);
+			memcpy(op, job->buf, cSize);
+			op += cSize;
+		}
+	} while (ip < iend);
+
+	return op - (BYTE *)dst;
+}
+
+EXPORT_SYMBOL(ZSTD_compressJobsWorkspaceBound);
+EXPORT_SYMBOL(ZSTD_compressJobs);
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for ZSTD_compressJobs(): round trips through the one-shot
+ * and the streaming decoder, and a benchmark against ZSTD_compressCCtx().
+ */
+#include <kunit/bench.h>
+#include <kunit/test.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/zstd.h>
+
+#define ZSTD_JOBS_TEST_SRC_SIZE		(1024 * 1024 + 123)
+#define ZSTD_JOBS_TEST_JOB_SIZE		(128 * 1024)
+#define ZSTD_JOBS_TEST_WORKERS		4
+#define ZSTD_JOBS_TEST_LEVEL		3
+
+struct zstd_jobs_test {
+	ZSTD_parameters params;
+	void *src;
+	size_t src_size;
+	void *dst;
+	size_t dst_capacity;
+	size_t dst_size;
+	void *out;
+	void *wksp;
+	size_t wksp_size;
+	void *cctx_wksp;
+	size_t cctx_wksp_size;
+};
+
+/* Compressible, but not trivially: words picked from a small dictionary */
+static void zstd_jobs_test_fill(u8 *buf, size_t size)
+{
+	static const char * const words[] = {
+		"alpha ", "beta ", "gamma ", "delta ", "epsilon ", "zeta ",
+		"eta ", "theta ", "iota ", "kappa ", "lambda ", "mu ",
+	};
+	u32 seed = 0x2545f491;
+	size_t pos = 0;
+
+	while (pos < size) {
+		const char *word;
+		size_t len;
+
+		seed = seed * 1103515245 + 12345;
+		word = words[(seed >> 16) % ARRAY_SIZE(words)];
+		len = min(strlen(word), size - pos);
+		memcpy(buf + pos, word, len);
+		pos += len;
+	}
+}
+
+static void zstd_jobs_test_exit(struct kunit *test)
+{
+	struct zstd_jobs_test *t = test->priv;
+
+	if (!t)
+		return;
+	vfree(t->cctx_wksp);
+	vfree(t->wksp);
+	vfree(t->out);
+	vfree(t->dst);
+	vfree(t->src);
+}
+
+static int zstd_jobs_test_init(struct kunit *test)
+{
+	struct zstd_jobs_test *t;
+	size_t nb_jobs;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+	test->priv = t;
+
+	t->src_size = ZSTD_JOBS_TEST_SRC_SIZE;
+	t->params = ZSTD_getParams(ZSTD_JOBS_TEST_LEVEL, t->src_size, 0);
+	nb_jobs = DIV_ROUND_UP(t->src_size, ZSTD_JOBS_TEST_JOB_SIZE);
+	t->dst_capacity = nb_jobs * ZSTD_compressBound(ZSTD_JOBS_TEST_JOB_SIZE);
+	t->wksp_size = ZSTD_compressJobsWorkspaceBound(t->params.cParams,
+						       ZSTD_JOBS_TEST_JOB_SIZE,
+						       ZSTD_JOBS_TEST_WORKERS);
+	t->cctx_wksp_size = ZSTD_CCtxWorkspaceBound(t->params.cParams);
+
+	t->src = vmalloc(t->src_size);
+	t->dst = vmalloc(t->dst_capacity);
+	t->out = vmalloc(t->src_size);
+	t->wksp = vmalloc(t->wksp_size);
+	t->cctx_wksp = vmalloc(t->cctx_wksp_size);
+	if (!t->src || !t->dst || !t->out || !t->wksp || !t->cctx_wksp) {
+		/* The exit hook is not run when init fails */
+		zstd_jobs_test_exit(test);
+		return -ENOMEM;
+	}
+
+	zstd_jobs_test_fill(t->src, t->src_size);
+	return 0;
+}
+
+static void zstd_jobs_test_compress(void *context)
+{
+	struct zstd_jobs_test *t = context;
+
+	t->dst_size = ZSTD_compressJobs(t->wksp, t->wksp_size, t->dst,
+					t->dst_capacity, t->src, t->src_size,
+					ZSTD_JOBS_TEST_JOB_SIZE,
+					ZSTD_JOBS_TEST_WORKERS, t->params);
+}
+
+static void zstd_jobs_test_compress_single(void *context)
+{
+	struct zstd_jobs_test *t = context;
+	ZSTD_CCtx *cctx = ZSTD_initCCtx(t->cctx_wksp, t->cctx_wksp_size);
+
+	t->dst_size = ZSTD_compressCCtx(cctx, t->dst, t->dst_capacity,
+					t->src, t->src_size, t->params);
+}
+
+/* ZSTD_decompressDCtx() decodes all the frames in one call */
+static void zstd_jobs_test_dctx(struct kunit *test)
+{
+	struct zstd_jobs_test *t = test->priv;
+	size_t wksp_size = ZSTD_DCtxWorkspaceBound();
+	void *wksp = vmalloc(wksp_size);
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, wksp);
+
+	zstd_jobs_test_compress(t);
+	KUNIT_ASSERT_FALSE(test, ZSTD_isError(t->dst_size));
+	KUNIT_EXPECT_LT(test, t->dst_size, t->src_size);
+
+	dctx = ZSTD_initDCtx(wksp, wksp_size);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dctx);
+	ret = ZSTD_decompressDCtx(dctx, t->out, t->src_size, t->dst,
+				  t->dst_size);
+	KUNIT_EXPECT_FALSE(test, ZSTD_isError(ret));
+	KUNIT_EXPECT_EQ(test, ret, t->src_size);
+	KUNIT_EXPECT_EQ(test, memcmp(t->out, t->src, t->src_size), 0);
+
+	vfree(wksp);
+}
+
+/*
+ * ZSTD_decompressStream() returns 0 at the end of every frame; a caller
+ * has to keep going while there is input left.
+ */
+static void zstd_jobs_test_stream(struct kunit *test)
+{
+	struct zstd_jobs_test *t = test->priv;
+	size_t window = (size_t)1 << t->params.cParams.windowLog;
+	size_t wksp_size = ZSTD_DStreamWorkspaceBound(window);
+	void *wksp = vmalloc(wksp_size);
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	ZSTD_DStream *zds;
+	unsigned int frames = 0;
+	size_t ret;
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, wksp);
+
+	zstd_jobs_test_compress(t);
+	KUNIT_ASSERT_FALSE(test, ZSTD_isError(t->dst_size));
+
+	zds = ZSTD_initDStream(window, wksp, wksp_size);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, zds);
+
+	in.src = t->dst;
+	in.size = t->dst_size;
+	in.pos = 0;
+	out.dst = t->out;
+	out.size = t->src_size;
+	out.pos = 0;
+	while (in.pos < in.size) {
+		ret = ZSTD_decompressStream(zds, &out, &in);
+		KUNIT_ASSERT_FALSE(test, ZSTD_isError(ret));
+		if (!ret)
+			frames++;
+		else if (out.pos == out.size)
+			break;
+	}
+
+	KUNIT_EXPECT_EQ(test, frames,
+			DIV_ROUND_UP(t->src_size, ZSTD_JOBS_TEST_JOB_SIZE));
+	KUNIT_EXPECT_EQ(test, out.pos, t->src_size);
+	KUNIT_EXPECT_EQ(test, memcmp(t->out, t->src, t->src_size), 0);
+
+	vfree(wksp);
+}
+
+static void zstd_jobs_test_bench(struct kunit *test)
+{
+	struct zstd_jobs_test *t = test->priv;
+	struct kunit_bench_params params = {
+		.warmup = 2,
+		.iterations = 20,
+		.cpu = -1,
+	};
+
+	KUNIT_EXPECT_EQ(test,
+			kunit_bench_run(test, "compressCCtx", &params,
+					zstd_jobs_test_compress_single, t,
+					NULL),
+			0);
+	KUNIT_EXPECT_FALSE(test, ZSTD_isError(t->dst_size));
+
+	KUNIT_EXPECT_EQ(test,
+			kunit_bench_run(test, "compressJobs", &params,
+					zstd_jobs_test_compress, t, NULL),
+			0);
+	KUNIT_EXPECT_FALSE(test, ZSTD_isError(t->dst_size));
+}
+
+static struct kunit_case zstd_jobs_test_cases[] = {
+	KUNIT_CASE(zstd_jobs_test_dctx),
+	KUNIT_CASE(zstd_jobs_test_stream),
+	KUNIT_CASE(zstd_jobs_test_bench),
+	{}
+};
+
+static struct kunit_suite zstd_jobs_test_suite = {
+	.name = "zstd-compress-jobs",
+	.init = zstd_jobs_test_init,
+	.exit = zstd_jobs_test_exit,
+	.test_cases = zstd_jobs_test_cases,
+};
+kunit_test_suites(&zstd_jobs_test_suite);
+
+MODULE_LICENSE("Dual BSD/GPL");
@@ -100,15 +100,12 @@ static struct socket *__mptcp_socket_create(struct mptcp_sock *msk, int state)
 
 static struct sock *mptcp_subflow_get(const struct mptcp_sock *msk)
 {
-	struct mptcp_subflow_context *subflow;
-
 	sock_owned_by_me((const struct sock *)msk);
 
-	mptcp_for_each_subflow(msk, subflow) {
-		return mptcp_subflow_tcp_sock(subflow);
-	}
+	if (list_empty(&msk->conn_list))
+		return NULL;
 
-	return NULL;
+	return msk->sched->get_subflow(msk);
 }
 
 static bool mptcp_ext_cache_refill(struct mptcp_sock *msk)
@@ -270,8 +267,8 @@ static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 	int mss_now = 0, size_goal = 0, ret = 0;
 	struct mptcp_sock *msk = mptcp_sk(sk);
 	struct socket *ssock;
+	struct sock *ssk, *next;
 	size_t copied = 0;
-	struct sock *ssk;
 	long timeo;
 
 	if (msg->msg_flags & ~(MSG_MORE | MSG_DONTWAIT | MSG_NOSIGNAL))
@@ -309,6 +306,19 @@ static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 		}
 
 		copied += ret;
+
+		/* let the scheduler spread the data over the subflows */
+		if (!msg_data_left(msg))
+			break;
+		next = mptcp_subflow_get(msk);
+		if (!next || next == ssk)
+			continue;
+
+		tcp_push(ssk, msg->msg_flags, mss_now, tcp_sk(ssk)->nonagle,
+			 size_goal);
+		release_sock(ssk);
+		ssk = next;
+		lock_sock(ssk);
 	}
 
 	if (copied) {
@@ -350,6 +360,384 @@ int mptcp_read_actor(read_descriptor_t *desc, struct sk_buff *skb,
 	return copy_len;
 }
 
+static void mptcp_drop(struct sock *sk, struct sk_buff *skb)
+{
+	sk_drops_add(sk, skb);
+	__kfree_skb(skb);
+}
+
+/* Append @from to @to when the former carries exactly the data that
+ * follows the latter; @to must not hold any unmapped trailing bytes.
+ * The caller has scheduled at least @from's truesize on @sk, which
+ * covers the delta charged here.
+ */
+static bool mptcp_try_coalesce(struct sock *sk, struct sk_buff *to,
+			       struct sk_buff *from)
+{
+	struct mptcp_skb_cb *to_cb = MPTCP_SKB_CB(to);
+	struct mptcp_skb_cb *from_cb = MPTCP_SKB_CB(from);
+	bool fragstolen;
+	int delta;
+
+	if (from_cb->map_seq != to_cb->end_seq || from_cb->offset ||
+	    from->len != from_cb->end_seq - from_cb->map_seq ||
+	    to->len != to_cb->offset + (to_cb->end_seq - to_cb->map_seq))
+		return false;
+
+	if (!skb_try_coalesce(to, from, &fragstolen, &delta))
+		return false;
+
+	pr_debug("coalesced seq %llx into %llx new len %d new end seq %llx",
+		 from_cb->map_seq, to_cb->map_seq, to->len, from_cb->end_seq);
+	to_cb->end_seq = from_cb->end_seq;
+	kfree_skb_partial(from, fragstolen);
+	atomic_add(delta, &sk->sk_rmem_alloc);
+	sk_mem_charge(sk, delta);
+	return true;
+}
+
+/* Insert an skb carrying future data into the msk out-of-order rbtree,
+ * dropping whatever it fully overlaps. Modeled after tcp_data_queue_ofo(),
+ * with 64 bit data sequence numbers.
+ */
+static void mptcp_data_queue_ofo(struct mptcp_sock *msk, struct sk_buff *skb)
+{
+	struct sock *sk = (struct sock *)msk;
+	struct rb_node **p, *parent;
+	u64 seq, end_seq;
+	struct sk_buff *skb1;
+
+	seq = MPTCP_SKB_CB(skb)->map_seq;
+	end_seq = MPTCP_SKB_CB(skb)->end_seq;
+	pr_debug("msk=%p seq=%llx end_seq=%llx ack_seq=%llx", msk, seq,
+		 end_seq, msk->ack_seq);
+
+	p = &msk->out_of_order_queue.rb_node;
+	if (RB_EMPTY_ROOT(&msk->out_of_order_queue)) {
+		rb_link_node(&skb->rbnode, NULL, p);
+		rb_insert_color(&skb->rbnode, &msk->out_of_order_queue);
+		msk->ooo_last_skb = skb;
+		goto end;
+	}
+
+	/* with several subflows, for each of them appending to the tail of
+	 * the ooo queue is the common case: avoid the O(log(N)) lookup
+	 */
+	if (mptcp_try_coalesce(sk, msk->ooo_last_skb, skb))
+		return;
+
+	if (!before64(seq, MPTCP_SKB_CB(msk->ooo_last_skb)->end_seq)) {
+		parent = &msk->ooo_last_skb->rbnode;
+		p = &parent->rb_right;
+		goto insert;
+	}
+
+	/* Find place to insert this segment. Handle overlaps on the way. */
+	parent = NULL;
+	while (*p) {
+		parent = *p;
+		skb1 = rb_to_skb(parent);
+		if (before64(seq, MPTCP_SKB_CB(skb1)->map_seq)) {
+			p = &parent->rb_left;
+			continue;
+		}
+		if (before64(seq, MPTCP_SKB_CB(skb1)->end_seq)) {
+			if (!after64(end_seq, MPTCP_SKB_CB(skb1)->end_seq)) {
+				/* All the bits are present. Drop. */
+				mptcp_drop(sk, skb);
+				return;
+			}
+			if (!after64(seq, MPTCP_SKB_CB(skb1)->map_seq)) {
+				/* skb covers skb1, replace the latter */
+				rb_replace_node(&skb1->rbnode, &skb->rbnode,
+						&msk->out_of_order_queue);
+				mptcp_drop(sk, skb1);
+				goto merge_right;
+			}
+			/* partial overlap, keep looking on the right */
+		} else if (mptcp_try_coalesce(sk, skb1, skb)) {
+			return;
+		}
+		p = &parent->rb_right;
+	}
+
+insert:
+	rb_link_node(&skb->rbnode, parent, p);
+	rb_insert_color(&skb->rbnode, &msk->out_of_order_queue);
+
+merge_right:
+	/* Remove other segments covered by skb. */
+	while ((skb1 = skb_rb_next(skb)) != NULL) {
+		if (before64(end_seq, MPTCP_SKB_CB(skb1)->end_seq))
+			break;
+		rb_erase(&skb1->rbnode, &msk->out_of_order_queue);
+		mptcp_drop(sk, skb1);
+	}
+	/* If there is no skb after us, we are the last_skb ! */
+	if (!skb1)
+		msk->ooo_last_skb = skb;
+
+end:
+	skb_condense(skb);
+	skb_set_owner_r(skb, sk);
+}
+
+/* Queue @copy_len bytes of @skb starting at @offset, which map to the
+ * current data sequence number of @ssk, into the msk. The skb is no longer
+ * on the subflow receive queue.
+ */
+static void __mptcp_move_skb(struct mptcp_sock *msk, struct sock *ssk,
+			     struct sk_buff *skb, unsigned int offset,
+			     size_t copy_len)
+{
+	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
+	struct sock *sk = (struct sock *)msk;
+	struct sk_buff *tail;
+
+	skb_ext_reset(skb);
+	skb_orphan(skb);
+
+	/* try to fetch the required memory from the subflow */
+	if (!sk_rmem_schedule(sk, skb, skb->truesize)) {
+		if (ssk->sk_forward_alloc < skb->truesize)
+			goto drop;
+		__sk_mem_reclaim(ssk, skb->truesize);
+		if (!sk_rmem_schedule(sk, skb, skb->truesize))
+			goto drop;
+	}
+
+	MPTCP_SKB_CB(skb)->map_seq = mptcp_subflow_get_mapped_dsn(subflow);
+	MPTCP_SKB_CB(skb)->end_seq = MPTCP_SKB_CB(skb)->map_seq + copy_len;
+	MPTCP_SKB_CB(skb)->offset = offset;
+
+	/* another subflow may have delivered the head of this data already */
+	if (before64(MPTCP_SKB_CB(skb)->map_seq, msk->ack_seq) &&
+	    after64(MPTCP_SKB_CB(skb)->end_seq, msk->ack_seq)) {
+		u32 delta = msk->ack_seq - MPTCP_SKB_CB(skb)->map_seq;
+
+		MPTCP_SKB_CB(skb)->offset += delta;
+		MPTCP_SKB_CB(skb)->map_seq = msk->ack_seq;
+		copy_len -= delta;
+	}
+
+	if (MPTCP_SKB_CB(skb)->map_seq == msk->ack_seq) {
+		/* in sequence */
+		WRITE_ONCE(msk->ack_seq, msk->ack_seq + copy_len);
+		tail = skb_peek_tail(&sk->sk_receive_queue);
+		if (tail && mptcp_try_coalesce(sk, tail, skb))
+			return;
+
+		skb_set_owner_r(skb, sk);
+		__skb_queue_tail(&sk->sk_receive_queue, skb);
+		return;
+	} else if (after64(MPTCP_SKB_CB(skb)->map_seq, msk->ack_seq)) {
+		mptcp_data_queue_ofo(msk, skb);
+		return;
+	}
+
+	/* else old data, the sender retransmitted it on another subflow */
+drop:
+	mptcp_drop(sk, skb);
+}
+
+/* Move the skbs that became in sequence from the ooo queue to the msk
+ * receive queue; returns true if any was moved.
+ */
+static bool mptcp_ofo_queue(struct mptcp_sock *msk)
+{
+	struct sock *sk = (struct sock *)msk;
+	struct sk_buff *skb, *tail;
+	bool moved = false;
+	struct rb_node *p;
+	u64 end_seq;
+
+	p = rb_first(&msk->out_of_order_queue);
+	while (p) {
+		skb = rb_to_skb(p);
+		if (after64(MPTCP_SKB_CB(skb)->map_seq, msk->ack_seq))
+			break;
+
+		p = rb_next(p);
+		rb_erase(&skb->rbnode, &msk->out_of_order_queue);
+
+		if (unlikely(!after64(MPTCP_SKB_CB(skb)->end_seq,
+				      msk->ack_seq))) {
+			mptcp_drop(sk, skb);
+			continue;
+		}
+
+		end_seq = MPTCP_SKB_CB(skb)->end_seq;
+		tail = skb_peek_tail(&sk->sk_receive_queue);
+		if (!tail || !mptcp_try_coalesce(sk, tail, skb)) {
+			int delta = msk->ack_seq - MPTCP_SKB_CB(skb)->map_seq;
+
+			/* skip overlapping data, if any */
+			MPTCP_SKB_CB(skb)->offset += delta;
+			MPTCP_SKB_CB(skb)->map_seq += delta;
+			__skb_queue_tail(&sk->sk_receive_queue, skb);
+		}
+		WRITE_ONCE(msk->ack_seq, end_seq);
+		moved = true;
+	}
+	return moved;
+}
+
+/* Move the data available on @ssk, under its current mappings, into the
+ * msk. Whole skbs are moved without copying; when a mapping ends inside an
+ * skb, the msk gets a clone and the subflow keeps the rest. Returns true
+ * when the caller should stop pulling from this subflow.
+ */
+static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
+					   struct sock *ssk)
+{
+	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
+	struct sock *sk = (struct sock *)msk;
+	struct tcp_sock *tp = tcp_sk(ssk);
+	unsigned int moved = 0;
+	bool done = false;
+
+	if (!(sk->sk_userlocks & SOCK_RCVBUF_LOCK) &&
+	    READ_ONCE(ssk->sk_rcvbuf) > sk->sk_rcvbuf)
+		WRITE_ONCE(sk->sk_rcvbuf, READ_ONCE(ssk->sk_rcvbuf));
+
+	while (!done && mptcp_subflow_data_available(ssk)) {
+		u32 map_remaining, offset;
+		u32 seq = tp->copied_seq;
+		struct sk_buff *skb;
+		bool fin;
+		size_t len;
+
+		map_remaining = subflow->map_data_len -
+				mptcp_subflow_get_map_offset(subflow);
+
+		skb = skb_peek(&ssk->sk_receive_queue);
+		if (!skb)
+			break;
+
+		if (tp->urg_data && tp->urg_seq == seq) {
+			pr_err("Urgent data present, cannot proceed");
+			done = true;
+			break;
+		}
+
+		offset = seq - TCP_SKB_CB(skb)->seq;
+		fin = TCP_SKB_CB(skb)->tcp_flags & TCPHDR_FIN;
+		len = skb->len - offset;
+		if (offset >= skb->len) {
+			WARN_ON_ONCE(!fin);
+			sk_eat_skb(ssk, skb);
+			WRITE_ONCE(tp->copied_seq, seq + 1);
+			done = true;
+			break;
+		}
+
+		if (len > map_remaining) {
+			struct sk_buff *clone;
+
+			clone = skb_clone(skb, sk_gfp_mask(ssk, GFP_KERNEL));
+			if (!clone) {
+				done = true;
+				break;
+			}
+
+			len = map_remaining;
+			fin = false;
+			__mptcp_move_skb(msk, ssk, clone, offset, len);
+		} else {
+			__skb_unlink(skb, &ssk->sk_receive_queue);
+			__mptcp_move_skb(msk, ssk, skb, offset, len);
+		}
+
+		seq += len;
+		moved += len;
+		if (fin) {
+			seq++;
+			done = true;
+		}
+		WRITE_ONCE(tp->copied_seq, seq);
+
+		if (atomic_read(&sk->sk_rmem_alloc) > READ_ONCE(sk->sk_rcvbuf))
+			done = true;
+	}
+
+	if (moved) {
+		tcp_rcv_space_adjust(ssk);
+		tcp_cleanup_rbuf(ssk, moved);
+	}
+
+	/* the last mapping may have been fully consumed */
+	if (subflow->data_avail)
+		mptcp_subflow_data_available(ssk);
+	return done;
+}
+
+/* Pull data from all the subflows with data available into the msk
+ * receive and out-of-order queues; returns true if in-sequence data
+ * was queued.
+ */
+static bool __mptcp_move_skbs(struct mptcp_sock *msk)
+{
+	struct sock *sk = (struct sock *)msk;
+	u64 old_ack = msk->ack_seq;
+	struct sock *ssk;
+	bool done;
+
+	while (atomic_read(&sk->sk_rmem_alloc) <= READ_ONCE(sk->sk_rcvbuf)) {
+		ssk = mptcp_subflow_recv_lookup(msk);
+		if (!ssk)
+			break;
+
+		lock_sock(ssk);
+		done = __mptcp_move_skbs_from_subflow(msk, ssk);
+		release_sock(ssk);
+		mptcp_ofo_queue(msk);
+		if (done)
+			break;
+	}
+
+	return msk->ack_seq != old_ack;
+}
+
+/* Copy up to @len bytes from the msk receive queue into @msg */
+static int __mptcp_recvmsg_mskq(struct mptcp_sock *msk, struct msghdr *msg,
+				size_t len)
+{
+	struct sock *sk = (struct sock *)msk;
+	struct sk_buff *skb;
+	int copied = 0;
+
+	while ((skb = skb_peek(&sk->sk_receive_queue)) != NULL) {
+		u32 offset = MPTCP_SKB_CB(skb)->offset;
+		u32 data_len = MPTCP_SKB_CB(skb)->end_seq -
+			       MPTCP_SKB_CB(skb)->map_seq;
+		u32 count = min_t(size_t, len - copied, data_len);
+		int err;
+
+		err = skb_copy_datagram_msg(skb, offset, msg, count);
+		if (unlikely(err < 0)) {
+			if (!copied)
+				return err;
+			break;
+		}
+
+		copied += count;
+
+		if (count < data_len) {
+			MPTCP_SKB_CB(skb)->offset += count;
+			MPTCP_SKB_CB(skb)->map_seq += count;
+			break;
+		}
+
+		__skb_unlink(skb, &sk->sk_receive_queue);
+		__kfree_skb(skb);
+
+		if (copied >= len)
+			break;
+	}
+
+	return copied;
+}
+
 static void mptcp_wait_data(struct sock *sk, long *timeo)
 {
 	DEFINE_WAIT_FUNC(wait, woken_wake_function);
@@ -369,15 +757,7 @@ static int mptcp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len,
 			 int nonblock, int flags, int *addr_len)
 {
 	struct mptcp_sock *msk = mptcp_sk(sk);
-	struct mptcp_subflow_context *subflow;
-	bool more_data_avail = false;
-	struct mptcp_read_arg arg;
-	read_descriptor_t desc;
-	bool wait_data = false;
 	struct socket *ssock;
-	struct tcp_sock *tp;
-	bool done = false;
-	struct sock *ssk;
 	int copied = 0;
 	int target;
 	long timeo;
@@ -395,65 +775,26 @@ static int mptcp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len,
 		return copied;
 	}
 
-	arg.msg = msg;
-	desc.arg.data = &arg;
-	desc.error = 0;
-
 	timeo = sock_rcvtimeo(sk, nonblock);
 
 	len = min_t(size_t, len, INT_MAX);
 	target = sock_rcvlowat(sk, flags & MSG_WAITALL, len);
 
-	while (!done) {
-		u32 map_remaining;
+	while (len > (size_t)copied) {
 		int bytes_read;
 
-		ssk = mptcp_subflow_recv_lookup(msk);
-		pr_debug("msk=%p ssk=%p", msk, ssk);
-		if (!ssk)
-			goto wait_for_data;
-
-		subflow = mptcp_subflow_ctx(ssk);
-		tp = tcp_sk(ssk);
-
-		lock_sock(ssk);
-		do {
-			/* try to read as much data as available */
-			map_remaining = subflow->map_data_len -
-					mptcp_subflow_get_map_offset(subflow);
-			desc.count = min_t(size_t, len - copied, map_remaining);
-			pr_debug("reading %zu bytes, copied %d", desc.count,
-				 copied);
-			bytes_read = tcp_read_sock(ssk, &desc,
-						   mptcp_read_actor);
-			if (bytes_read < 0) {
-				if (!copied)
-					copied = bytes_read;
-				done = true;
-				goto next;
-			}
+		bytes_read = __mptcp_recvmsg_mskq(msk, msg, len - copied);
+		if (unlikely(bytes_read < 0)) {
+			if (!copied)
+				copied = bytes_read;
+			goto out_err;
+		}
 
-			pr_debug("msk ack_seq=%llx -> %llx", msk->ack_seq,
-				 msk->ack_seq + bytes_read);
-			msk->ack_seq += bytes_read;
-			copied += bytes_read;
-			if (copied >= len) {
-				done = true;
-				goto next;
-			}
-			if (tp->urg_data && tp->urg_seq == tp->copied_seq) {
-				pr_err("Urgent data present, cannot proceed");
-				done = true;
-				goto next;
-			}
-next:
-			more_data_avail = mptcp_subflow_data_available(ssk);
-		} while (more_data_avail && !done);
-		release_sock(ssk);
-		continue;
+		copied += bytes_read;
 
-wait_for_data:
-		more_data_avail = false;
+		if (skb_queue_empty(&sk->sk_receive_queue) &&
+		    __mptcp_move_skbs(msk))
+			continue;
 
 		/* only the master socket status is relevant here. The exit
 		 * conditions mirror closely tcp_recvmsg()
@@ -494,26 +835,25 @@ static int mptcp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len,
 		}
 
 		pr_debug("block timeout %ld", timeo);
-		wait_data = true;
 		mptcp_wait_data(sk, &timeo);
 		if (unlikely(__mptcp_tcp_fallback(msk)))
 			goto fallback;
 	}
 
-	if (more_data_avail) {
-		if (!test_bit(MPTCP_DATA_READY, &msk->flags))
-			set_bit(MPTCP_DATA_READY, &msk->flags);
-	} else if (!wait_data) {
+	if (skb_queue_empty(&sk->sk_receive_queue)) {
+		/* entire backlog drained, clear DATA_READY. */
 		clear_bit(MPTCP_DATA_READY, &msk->flags);
 
-		/* .. race-breaker: ssk might get new data after last
-		 * data_available() returns false.
+		/* .. race-breaker: ssk might have gotten new data
+		 * after last __mptcp_move_skbs() returned false.
 		 */
-		ssk = mptcp_subflow_recv_lookup(msk);
-		if (unlikely(ssk))
+		if (unlikely(__mptcp_move_skbs(msk)))
 			set_bit(MPTCP_DATA_READY, &msk->flags);
+	} else if (unlikely(!test_bit(MPTCP_DATA_READY, &msk->flags))) {
+		/* data to read but mptcp_wait_data() cleared DATA_READY */
+		set_bit(MPTCP_DATA_READY, &msk->flags);
 	}
-
+out_err:
 	release_sock(sk);
 	return copied;
 }
@@ -553,10 +893,12 @@ static int __mptcp_init_sock(struct sock *sk)
 	struct mptcp_sock *msk = mptcp_sk(sk);
 
 	INIT_LIST_HEAD(&msk->conn_list);
+	msk->out_of_order_queue = RB_ROOT;
 	__set_bit(MPTCP_SEND_SPACE, &msk->flags);
 
 	msk->first = NULL;
 	inet_csk(sk)->icsk_sync_mss = mptcp_sync_mss;
+	mptcp_init_sched(msk);
 
 	return 0;
 }
@@ -755,6 +1097,8 @@ static void mptcp_destroy(struct sock *sk)
 
 	if (msk->cached_ext)
 		__skb_ext_put(msk->cached_ext);
+	skb_rbtree_purge(&msk->out_of_order_queue);
+	mptcp_release_sched(msk);
 }
 
 static int mptcp_setsockopt(struct sock *sk, int level, int optname,
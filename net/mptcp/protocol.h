@@ -59,6 +59,22 @@
 #define MPTCP_DATA_READY	0
 #define MPTCP_SEND_SPACE	1
 
+struct mptcp_sock;
+
+#define MPTCP_SCHED_NAME_MAX	16
+
+/* Subflow scheduler; see sched.c */
+struct mptcp_sched_ops {
+	/* return the subflow to carry the next chunk of data, called
+	 * with the msk socket lock held
+	 */
+	struct sock *	(*get_subflow)(const struct mptcp_sock *msk);
+
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct module		*owner;
+	struct list_head	list;
+};
+
 /* MPTCP connection sock */
 struct mptcp_sock {
 	/* inet_connection_sock must be the first member */
@@ -74,8 +90,20 @@ struct mptcp_sock {
 	struct skb_ext	*cached_ext;	/* for the next sendmsg */
 	struct socket	*subflow; /* outgoing connect/listener/!mp_capable */
 	struct sock	*first;
+	struct mptcp_sched_ops *sched;
+	struct rb_root	out_of_order_queue;
+	struct sk_buff	*ooo_last_skb;
+};
+
+/* control block of the skbs queued on the msk, by data sequence number */
+struct mptcp_skb_cb {
+	u64 map_seq;
+	u64 end_seq;
+	u32 offset;
 };
 
+#define MPTCP_SKB_CB(__skb)	((struct mptcp_skb_cb *)&((__skb)->cb[0]))
+
 #define mptcp_for_each_subflow(__msk, __subflow)			\
 	list_for_each_entry(__subflow, &((__msk)->conn_list), node)
 
@@ -166,6 +194,14 @@ mptcp_subflow_get_mapped_dsn(const struct mptcp_subflow_context *subflow)
 }
 
 int mptcp_is_enabled(struct net *net);
+const char *mptcp_get_scheduler(struct net *net);
+
+void mptcp_sched_init(void);
+struct mptcp_sched_ops *mptcp_sched_find(const char *name);
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_init_sched(struct mptcp_sock *msk);
+void mptcp_release_sched(struct mptcp_sock *msk);
 bool mptcp_subflow_data_available(struct sock *sk);
 void mptcp_subflow_init(void);
 int mptcp_subflow_create_socket(struct sock *sk, struct socket **new_sock);
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * Packet scheduler: for each chunk of outgoing data, pick the subflow
+ * that will carry it. The policy is selected per netns through the
+ * net.mptcp.scheduler sysctl and is fixed for the lifetime of a socket.
+ */
+
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include <net/tcp.h>
+
+#include "protocol.h"
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+static bool mptcp_subflow_is_usable(const struct sock *ssk)
+{
+	return ((1 << ssk->sk_state) & (TCPF_ESTABLISHED | TCPF_CLOSE_WAIT)) &&
+	       sk_stream_memory_free(ssk);
+}
+
+/* First subflow with send space; fall back to the first subflow so that
+ * the caller can wait for memory on it.
+ */
+static struct sock *mptcp_sched_default_get(const struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *first = NULL;
+	struct sock *ssk;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (mptcp_subflow_is_usable(ssk))
+			return ssk;
+		if (!first)
+			first = ssk;
+	}
+
+	return first;
+}
+
+/* Usable subflow with the lowest smoothed RTT */
+static struct sock *mptcp_sched_lowrtt_get(const struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *best = NULL;
+	u32 best_srtt = U32_MAX;
+	struct sock *ssk;
+	u32 srtt;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_is_usable(ssk))
+			continue;
+
+		srtt = READ_ONCE(tcp_sk(ssk)->srtt_us);
+		if (srtt < best_srtt) {
+			best_srtt = srtt;
+			best = ssk;
+		}
+	}
+
+	return best ? : mptcp_sched_default_get(msk);
+}
+
+/* Usable subflow with the smallest share of its congestion window in
+ * flight, so that over time each subflow carries data in proportion to
+ * its cwnd.
+ */
+static struct sock *mptcp_sched_cwnd_get(const struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	u32 best_inflight = 0, best_cwnd = 0;
+	struct sock *best = NULL;
+	u32 inflight, cwnd;
+	struct sock *ssk;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_is_usable(ssk))
+			continue;
+
+		inflight = tcp_packets_in_flight(tcp_sk(ssk));
+		cwnd = max_t(u32, tcp_sk(ssk)->snd_cwnd, 1);
+		if (!best ||
+		    (u64)inflight * best_cwnd < (u64)best_inflight * cwnd) {
+			best_inflight = inflight;
+			best_cwnd = cwnd;
+			best = ssk;
+		}
+	}
+
+	return best ? : mptcp_sched_default_get(msk);
+}
+
+static struct mptcp_sched_ops mptcp_sched_default = {
+	.get_subflow	= mptcp_sched_default_get,
+	.name		= "default",
+	.owner		= THIS_MODULE,
+};
+
+static struct mptcp_sched_ops mptcp_sched_lowrtt = {
+	.get_subflow	= mptcp_sched_lowrtt_get,
+	.name		= "lowrtt",
+	.owner		= THIS_MODULE,
+};
+
+static struct mptcp_sched_ops mptcp_sched_cwnd = {
+	.get_subflow	= mptcp_sched_cwnd_get,
+	.name		= "cwnd",
+	.owner		= THIS_MODULE,
+};
+
+/* Must be called with rcu lock held */
+struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name))
+			return sched;
+	}
+
+	return NULL;
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	int ret = 0;
+
+	if (!sched->get_subflow)
+		return -EINVAL;
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		pr_notice("%s already registered\n", sched->name);
+		ret = -EEXIST;
+	} else {
+		list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+	}
+	spin_unlock(&mptcp_sched_list_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mptcp_register_scheduler);
+
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (sched == &mptcp_sched_default)
+		return;
+
+	spin_lock(&mptcp_sched_list_lock);
+	list_del_rcu(&sched->list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	/* sockets hold a module reference, only lookups can still race */
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(mptcp_unregister_scheduler);
+
+/* Select the scheduler named by the netns sysctl, falling back to the
+ * built-in default when it is gone or its module is unloading.
+ */
+void mptcp_init_sched(struct mptcp_sock *msk)
+{
+	struct sock *sk = (struct sock *)msk;
+	struct mptcp_sched_ops *sched;
+
+	rcu_read_lock();
+	sched = mptcp_sched_find(mptcp_get_scheduler(sock_net(sk)));
+	if (!sched || !try_module_get(sched->owner)) {
+		sched = &mptcp_sched_default;
+		__module_get(sched->owner);
+	}
+	rcu_read_unlock();
+
+	msk->sched = sched;
+}
+
+void mptcp_release_sched(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+
+	if (!sched)
+		return;
+
+	msk->sched = NULL;
+	module_put(sched->owner);
+}
+
+void __init mptcp_sched_init(void)
+{
+	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_lowrtt);
+	mptcp_register_scheduler(&mptcp_sched_cwnd);
+}
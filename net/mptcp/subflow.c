@@ -461,22 +461,17 @@ static bool subflow_check_data_avail(struct sock *ssk)
 		ack_seq = mptcp_subflow_get_mapped_dsn(subflow);
 		pr_debug("msk ack_seq=%llx subflow ack_seq=%llx", old_ack,
 			 ack_seq);
-		if (ack_seq == old_ack)
+		if (!before64(ack_seq, old_ack))
 			break;
 
-		/* only accept in-sequence mapping. Old values are spurious
-		 * retransmission; we can hit "future" values on active backup
-		 * subflow switch, we relay on retransmissions to get
-		 * in-sequence data.
-		 * Cuncurrent subflows support will require subflow data
-		 * reordering
+		/* "future" mappings are fine, the msk out-of-order queue
+		 * reorders data coming from different subflows. Old values
+		 * are spurious retransmission: discard the part already
+		 * acked at the connection level.
 		 */
 		map_remaining = subflow->map_data_len -
 				mptcp_subflow_get_map_offset(subflow);
-		if (before64(ack_seq, old_ack))
-			delta = min_t(size_t, old_ack - ack_seq, map_remaining);
-		else
-			delta = min_t(size_t, ack_seq - old_ack, map_remaining);
+		delta = min_t(size_t, old_ack - ack_seq, map_remaining);
 
 		/* discard mapped data */
 		pr_debug("discarding %zu bytes, current map len=%d", delta,
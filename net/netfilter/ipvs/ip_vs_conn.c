@@ -27,10 +27,12 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <linux/proc_fs.h>		/* for proc_net_* */
 #include <linux/slab.h>
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
+#include <linux/log2.h>
 #include <linux/random.h>
 
 #include <net/net_namespace.h>
@@ -67,11 +69,13 @@ static atomic_t ip_vs_conn_no_cport_cnt = ATOMIC_INIT(0);
 static unsigned int ip_vs_conn_rnd __read_mostly;
 
 /*
- *  Fine locking granularity for big connection hash table
+ *  Fine locking granularity for big connection hash table: the lock
+ *  array is sized at init time from the number of possible CPUs, so
+ *  that writers on big boxes do not keep colliding on the same bucket
+ *  locks, but it never has more locks than the table has buckets.
  */
-#define CT_LOCKARRAY_BITS  5
-#define CT_LOCKARRAY_SIZE  (1<<CT_LOCKARRAY_BITS)
-#define CT_LOCKARRAY_MASK  (CT_LOCKARRAY_SIZE-1)
+#define CT_LOCKARRAY_MIN_BITS	5
+#define CT_LOCKS_PER_CPU	16
 
 /* We need an addrstrlen that works with or without v6 */
 #ifdef CONFIG_IP_VS_IPV6
@@ -86,17 +90,17 @@ struct ip_vs_aligned_lock
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
-static struct ip_vs_aligned_lock
-__ip_vs_conntbl_lock_array[CT_LOCKARRAY_SIZE] __cacheline_aligned;
+static struct ip_vs_aligned_lock *__ip_vs_conntbl_lock_array __read_mostly;
+static unsigned int ct_lockarray_mask __read_mostly;
 
 static inline void ct_write_lock_bh(unsigned int key)
 {
-	spin_lock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_lock_bh(&__ip_vs_conntbl_lock_array[key & ct_lockarray_mask].l);
 }
 
 static inline void ct_write_unlock_bh(unsigned int key)
 {
-	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key & ct_lockarray_mask].l);
 }
 
 static void ip_vs_conn_expire(struct timer_list *t);
@@ -1391,19 +1395,38 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	unsigned int lock_bits;
 	int idx;
 
+	if (ip_vs_conn_tab_bits < 8 || ip_vs_conn_tab_bits > 20) {
+		pr_info("conn_tab_bits %d out of range, using %d\n",
+			ip_vs_conn_tab_bits, CONFIG_IP_VS_TAB_BITS);
+		ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
+	}
+
 	/* Compute size and mask */
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
 	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
+	lock_bits = order_base_2(num_possible_cpus() * CT_LOCKS_PER_CPU);
+	lock_bits = clamp_t(unsigned int, lock_bits, CT_LOCKARRAY_MIN_BITS,
+			    ip_vs_conn_tab_bits);
+	ct_lockarray_mask = (1U << lock_bits) - 1;
+	__ip_vs_conntbl_lock_array =
+		kvmalloc_array(1U << lock_bits,
+			       sizeof(*__ip_vs_conntbl_lock_array), GFP_KERNEL);
+	if (!__ip_vs_conntbl_lock_array)
+		return -ENOMEM;
+
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
 	ip_vs_conn_tab = vmalloc(array_size(ip_vs_conn_tab_size,
 					    sizeof(*ip_vs_conn_tab)));
-	if (!ip_vs_conn_tab)
+	if (!ip_vs_conn_tab) {
+		kvfree(__ip_vs_conntbl_lock_array);
 		return -ENOMEM;
+	}
 
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
@@ -1411,20 +1434,22 @@ int __init ip_vs_conn_init(void)
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
 		vfree(ip_vs_conn_tab);
+		kvfree(__ip_vs_conntbl_lock_array);
 		return -ENOMEM;
 	}
 
 	pr_info("Connection hash table configured "
-		"(size=%d, memory=%ldKbytes)\n",
+		"(size=%d, memory=%ldKbytes, locks=%u)\n",
 		ip_vs_conn_tab_size,
-		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024);
+		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024,
+		ct_lockarray_mask + 1);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
 		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
 
-	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
+	for (idx = 0; idx <= ct_lockarray_mask; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
 	}
 
@@ -1441,4 +1466,5 @@ void ip_vs_conn_cleanup(void)
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
 	vfree(ip_vs_conn_tab);
+	kvfree(__ip_vs_conntbl_lock_array);
 }
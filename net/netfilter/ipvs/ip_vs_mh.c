@@ -46,9 +46,12 @@ struct ip_vs_mh_dest_setup {
 	int		turns;	/* weight / gcd() and rshift */
 };
 
-/* Available prime numbers for MH table */
-static int primes[] = {251, 509, 1021, 2039, 4093,
-		       8191, 16381, 32749, 65521, 131071};
+/* Available prime numbers for MH table. Kept const so that the table
+ * size folds to a compile-time constant and the per-packet "% size" in
+ * the lookup becomes a multiply instead of a hardware divide.
+ */
+static const int primes[] = {251, 509, 1021, 2039, 4093,
+			     8191, 16381, 32749, 65521, 131071};
 
 /* For IPVS MH entry hash table */
 #ifndef CONFIG_IP_VS_MH_TAB_INDEX
@@ -545,6 +545,12 @@ ovs_ct_expect_find(struct net *net, const struct nf_conntrack_zone *zone,
 	struct nf_conntrack_tuple tuple;
 	struct nf_conntrack_expect *exp;
 
+	/* Without any helper expectations in this netns there is nothing to
+	 * find, so skip parsing the tuple on every ct() lookup.
+	 */
+	if (!READ_ONCE(net->ct.expect_count))
+		return NULL;
+
 	if (!nf_ct_get_tuplepr(skb, skb_network_offset(skb), proto, net, &tuple))
 		return NULL;
 
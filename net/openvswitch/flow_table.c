@@ -29,6 +29,7 @@
 #include <linux/icmp.h>
 #include <linux/icmpv6.h>
 #include <linux/rculist.h>
+#include <linux/sort.h>
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/ndisc.h>
@@ -179,12 +180,32 @@ static struct mask_array *tbl_mask_array_alloc(int size)
 	if (!new)
 		return NULL;
 
+	new->usage = __alloc_percpu(sizeof(unsigned long) * size,
+				    __alignof__(unsigned long));
+	if (!new->usage) {
+		kfree(new);
+		return NULL;
+	}
+
 	new->count = 0;
 	new->max = size;
 
 	return new;
 }
 
+static void tbl_mask_array_free(struct mask_array *ma)
+{
+	free_percpu(ma->usage);
+	kfree(ma);
+}
+
+static void mask_array_rcu_cb(struct rcu_head *rcu)
+{
+	struct mask_array *ma = container_of(rcu, struct mask_array, rcu);
+
+	tbl_mask_array_free(ma);
+}
+
 static int tbl_mask_array_realloc(struct flow_table *tbl, int size)
 {
 	struct mask_array *old;
@@ -205,7 +226,8 @@ static int tbl_mask_array_realloc(struct flow_table *tbl, int size)
 	}
 
 	rcu_assign_pointer(tbl->mask_array, new);
-	kfree_rcu(old, rcu);
+	if (old)
+		call_rcu(&old->rcu, mask_array_rcu_cb);
 
 	return 0;
 }
@@ -312,7 +334,7 @@ int ovs_flow_tbl_init(struct flow_table *table)
 free_ti:
 	__table_instance_destroy(ti);
 free_mask_array:
-	kfree(ma);
+	tbl_mask_array_free(ma);
 free_mask_cache:
 	free_percpu(table->mask_cache);
 	return -ENOMEM;
@@ -335,6 +357,11 @@ static void table_instance_flow_free(struct flow_table *table,
 	if (count)
 		table->count--;
 
+	/* Orders the unlink before the generation change seen by
+	 * ovs_flow_tbl_lookup_stats(), retiring microflow cache entries.
+	 */
+	smp_store_release(&table->flow_gen, table->flow_gen + 1);
+
 	if (ovs_identifier_is_ufid(&flow->id)) {
 		hlist_del_rcu(&flow->ufid_table.node[ufid_ti->node_ver]);
 
@@ -392,7 +419,8 @@ void ovs_flow_tbl_destroy(struct flow_table *table)
 	struct table_instance *ufid_ti = rcu_dereference_raw(table->ufid_ti);
 
 	free_percpu(table->mask_cache);
-	kfree_rcu(rcu_dereference_raw(table->mask_array), rcu);
+	call_rcu(&rcu_dereference_raw(table->mask_array)->rcu,
+		 mask_array_rcu_cb);
 	table_instance_destroy(table, ti, ufid_ti, false);
 }
 
@@ -594,6 +622,12 @@ static struct sw_flow *masked_flow_lookup(struct table_instance *ti,
 	return NULL;
 }
 
+static void mask_usage_inc(struct mask_array *ma, u32 index)
+{
+	if (likely(index < ma->max))
+		this_cpu_inc(ma->usage[index]);
+}
+
 /* Flow lookup does full lookup on flow table. It starts with
  * mask from index passed in *index.
  */
@@ -612,8 +646,10 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 		mask = rcu_dereference_ovsl(ma->masks[*index]);
 		if (mask) {
 			flow = masked_flow_lookup(ti, key, mask, n_mask_hit);
-			if (flow)
+			if (flow) {
+				mask_usage_inc(ma, *index);
 				return flow;
+			}
 		}
 	}
 
@@ -629,6 +665,7 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 		flow = masked_flow_lookup(ti, key, mask, n_mask_hit);
 		if (flow) { /* Found */
 			*index = i;
+			mask_usage_inc(ma, i);
 			return flow;
 		}
 	}
@@ -636,12 +673,30 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 	return NULL;
 }
 
+/* Checks that the microflow 'flow' cached for this skb_hash really
+ * matches 'key', which costs one masked compare instead of the hash and
+ * bucket walk of masked_flow_lookup().
+ */
+static bool microflow_match(const struct sw_flow *flow,
+			    const struct sw_flow_key *key, u32 *n_mask_hit)
+{
+	struct sw_flow_key masked_key;
+
+	(*n_mask_hit)++;
+	ovs_flow_mask_key(&masked_key, key, false, flow->mask);
+	return flow_cmp_masked_key(flow, &masked_key, &flow->mask->range);
+}
+
 /*
  * mask_cache maps flow to probable mask. This cache is not tightly
  * coupled cache, It means updates to  mask list can result in inconsistent
  * cache entry in mask cache.
  * This is per cpu cache and is divided in MC_HASH_SEGS segments.
  * In case of a hash collision the entry is hashed in next segment.
+ *
+ * Each entry also remembers the flow it last resolved to. That flow is
+ * returned directly, after one masked compare, as long as no flow was
+ * removed from the table since it was cached.
  * */
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 					  const struct sw_flow_key *key,
@@ -652,7 +707,7 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	struct table_instance *ti = rcu_dereference(tbl->ti);
 	struct mask_cache_entry *entries, *ce;
 	struct sw_flow *flow;
-	u32 hash;
+	u32 hash, gen;
 	int seg;
 
 	*n_mask_hit = 0;
@@ -668,6 +723,9 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	if (key->recirc_id)
 		skb_hash = jhash_1word(skb_hash, key->recirc_id);
 
+	/* Pairs with the release in table_instance_flow_free(). */
+	gen = smp_load_acquire(&tbl->flow_gen);
+
 	ce = NULL;
 	hash = skb_hash;
 	entries = this_cpu_ptr(tbl->mask_cache);
@@ -679,10 +737,19 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 
 		e = &entries[index];
 		if (e->skb_hash == skb_hash) {
+			flow = e->flow;
+			if (flow && e->flow_gen == gen &&
+			    microflow_match(flow, key, n_mask_hit)) {
+				mask_usage_inc(ma, e->mask_index);
+				return flow;
+			}
+
 			flow = flow_lookup(tbl, ti, ma, key, n_mask_hit,
 					   &e->mask_index);
 			if (!flow)
 				e->skb_hash = 0;
+			e->flow = flow;
+			e->flow_gen = gen;
 			return flow;
 		}
 
@@ -694,8 +761,11 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 
 	/* Cache miss, do full lookup. */
 	flow = flow_lookup(tbl, ti, ma, key, n_mask_hit, &ce->mask_index);
-	if (flow)
+	if (flow) {
 		ce->skb_hash = skb_hash;
+		ce->flow = flow;
+		ce->flow_gen = gen;
+	}
 
 	return flow;
 }
@@ -785,6 +855,78 @@ int ovs_flow_tbl_num_masks(const struct flow_table *table)
 	return READ_ONCE(ma->count);
 }
 
+struct mask_count {
+	int index;
+	unsigned long counter;
+};
+
+static int compare_mask_and_count(const void *a, const void *b)
+{
+	const struct mask_count *mc_a = a;
+	const struct mask_count *mc_b = b;
+
+	/* Keep the current order among masks with equal counts */
+	if (mc_a->counter == mc_b->counter)
+		return mc_a->index - mc_b->index;
+	return mc_a->counter > mc_b->counter ? -1 : 1;
+}
+
+/* Must be called with OVS mutex held.
+ *
+ * flow_lookup() tries the masks in array order, so move the masks that
+ * hit most often since the array was built to the front. The new array
+ * starts with fresh counters.
+ */
+void ovs_flow_masks_rebalance(struct flow_table *table)
+{
+	struct mask_array *ma = ovsl_dereference(table->mask_array);
+	struct mask_count *masks_and_count;
+	struct mask_array *new;
+	int count = ma->count;
+	int i;
+
+	if (count < 2)
+		return;
+
+	masks_and_count = kmalloc_array(count, sizeof(*masks_and_count),
+					GFP_KERNEL);
+	if (!masks_and_count)
+		return;
+
+	for (i = 0; i < count; i++) {
+		int cpu;
+
+		masks_and_count[i].index = i;
+		masks_and_count[i].counter = 0;
+		for_each_possible_cpu(cpu)
+			masks_and_count[i].counter +=
+				per_cpu_ptr(ma->usage, cpu)[i];
+	}
+
+	sort(masks_and_count, count, sizeof(*masks_and_count),
+	     compare_mask_and_count, NULL);
+
+	for (i = 0; i < count; i++)
+		if (masks_and_count[i].index != i)
+			break;
+	if (i == count)
+		goto out;
+
+	new = tbl_mask_array_alloc(ma->max);
+	if (!new)
+		goto out;
+
+	for (i = 0; i < count; i++)
+		RCU_INIT_POINTER(new->masks[i],
+			ovsl_dereference(ma->masks[masks_and_count[i].index]));
+	new->count = count;
+
+	rcu_assign_pointer(table->mask_array, new);
+	call_rcu(&ma->rcu, mask_array_rcu_cb);
+out:
+	kfree(masks_and_count);
+}
+
 static struct table_instance *table_instance_expand(struct table_instance *ti,
 						    bool ufid)
 {
@@ -25,11 +25,17 @@
 struct mask_cache_entry {
 	u32 skb_hash;
 	u32 mask_index;
+	/* Microflow: last flow hit for skb_hash, valid while flow_gen
+	 * matches flow_table->flow_gen.
+	 */
+	struct sw_flow *flow;
+	u32 flow_gen;
 };
 
 struct mask_array {
 	struct rcu_head rcu;
 	int count, max;
+	unsigned long __percpu *usage;	/* per-CPU hits of each mask */
 	struct sw_flow_mask __rcu *masks[];
 };
 
@@ -50,6 +56,7 @@ struct flow_table {
 	unsigned long last_rehash;
 	unsigned int count;
 	unsigned int ufid_count;
+	u32 flow_gen;		/* bumped whenever a flow is removed */
 };
 
 extern struct kmem_cache *flow_stats_cache;
@@ -69,6 +76,7 @@ int ovs_flow_tbl_insert(struct flow_table *table, struct sw_flow *flow,
 			const struct sw_flow_mask *mask);
 void ovs_flow_tbl_remove(struct flow_table *table, struct sw_flow *flow);
 int  ovs_flow_tbl_num_masks(const struct flow_table *table);
+void ovs_flow_masks_rebalance(struct flow_table *table);
 struct sw_flow *ovs_flow_tbl_dump_next(struct table_instance *table,
 				       u32 *bucket, u32 *idx);
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *,
@@ -83,6 +83,7 @@
 #include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 #include <linux/percpu.h>
+#include <linux/cpu.h>
 #ifdef CONFIG_INET
 #include <net/inet_common.h>
 #endif
@@ -196,6 +197,7 @@ static int prb_queue_frozen(struct tpacket_kbdq_core *);
 static void prb_open_block(struct tpacket_kbdq_core *,
 		struct tpacket_block_desc *);
 static void prb_retire_rx_blk_timer_expired(struct timer_list *);
+static void prb_retire_rx_blk_timer_expired_pcpu(struct timer_list *);
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *);
 static void prb_fill_rxhash(struct tpacket_kbdq_core *, struct tpacket3_hdr *);
 static void prb_clear_rxhash(struct tpacket_kbdq_core *,
@@ -232,6 +234,17 @@ struct packet_skb_cb {
 	(((x)->kactive_blk_num < ((x)->knum_blocks-1)) ? \
 	((x)->kactive_blk_num+1) : 0)
 
+/* The block core the current CPU fills. Per-CPU cores are only ever
+ * touched by their own CPU with BHs disabled, which is what lets
+ * tpacket_rcv() skip sk_receive_queue.lock for them.
+ */
+static struct tpacket_kbdq_core *prb_rx_core(struct packet_sock *po)
+{
+	if (po->rx_ring.prb_pcpu)
+		return this_cpu_ptr(po->rx_ring.prb_pcpu);
+	return GET_PBDQC_FROM_RB(&po->rx_ring);
+}
+
 static void __fanout_unlink(struct sock *sk, struct packet_sock *po);
 static void __fanout_link(struct sock *sk, struct packet_sock *po);
 
@@ -240,6 +253,58 @@ static int packet_direct_xmit(struct sk_buff *skb)
 	return dev_direct_xmit(skb, packet_pick_tx_queue(skb));
 }
 
+/* Like dev_direct_xmit() for a list of skbs: the txq stays locked across
+ * the list and the driver is told more is coming until the last skb for
+ * that queue, so it only has to ring the doorbell once.
+ */
+static void packet_direct_xmit_list(struct sk_buff *skb)
+{
+	struct net_device *dev = skb->dev;
+	struct netdev_queue *txq = NULL;
+	struct sk_buff *next;
+	int ret, cpu;
+	bool again, more;
+
+	for (next = skb; next; next = next->next)
+		skb_set_queue_mapping(next, packet_pick_tx_queue(next));
+
+	local_bh_disable();
+	cpu = smp_processor_id();
+	for (; skb; skb = next) {
+		next = skb->next;
+		skb_mark_not_on_list(skb);
+
+		if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+			goto drop;
+
+		again = false;
+		skb = validate_xmit_skb_list(skb, dev, &again);
+		if (!skb)
+			continue;
+
+		if (txq != skb_get_tx_queue(dev, skb)) {
+			if (txq)
+				HARD_TX_UNLOCK(dev, txq);
+			txq = skb_get_tx_queue(dev, skb);
+			HARD_TX_LOCK(dev, txq, cpu);
+		}
+
+		more = next && skb_get_queue_mapping(next) ==
+			       skb_get_queue_mapping(skb);
+		ret = NETDEV_TX_BUSY;
+		if (!netif_xmit_frozen_or_drv_stopped(txq))
+			ret = netdev_start_xmit(skb, dev, txq, more);
+		if (dev_xmit_complete(ret))
+			continue;
+drop:
+		atomic_long_inc(&dev->tx_dropped);
+		kfree_skb(skb);
+	}
+	if (txq)
+		HARD_TX_UNLOCK(dev, txq);
+	local_bh_enable();
+}
+
 static struct net_device *packet_cached_dev_get(struct packet_sock *po)
 {
 	struct net_device *dev;
@@ -503,6 +568,21 @@ static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
 		struct sk_buff_head *rb_queue)
 {
 	struct tpacket_kbdq_core *pkc;
+	int cpu;
+
+	if (po->rx_ring.prb_pcpu) {
+		/* The rx hook is gone, only the timers themselves can
+		 * still re-arm, which del_timer_sync() copes with.
+		 */
+		for_each_possible_cpu(cpu) {
+			pkc = per_cpu_ptr(po->rx_ring.prb_pcpu, cpu);
+			WRITE_ONCE(pkc->delete_blk_timer, 1);
+			prb_del_retire_blk_timer(pkc);
+		}
+		free_percpu(po->rx_ring.prb_pcpu);
+		po->rx_ring.prb_pcpu = NULL;
+		return;
+	}
 
 	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 
@@ -566,10 +646,55 @@ static void prb_init_ft_ops(struct tpacket_kbdq_core *p1,
 	p1->feature_req_word = req_u->req3.tp_feature_req_word;
 }
 
+static void init_prb_bdqc_pcpu(struct packet_sock *po,
+			       struct packet_ring_buffer *rb,
+			       struct tpacket_kbdq_core __percpu *pcpu)
+{
+	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
+	unsigned int nr_blocks = p1->knum_blocks / num_possible_cpus();
+	struct tpacket_kbdq_core *pkc;
+	unsigned int first = 0;
+	int cpu;
+
+	cpus_read_lock();
+	for_each_possible_cpu(cpu) {
+		pkc = per_cpu_ptr(pcpu, cpu);
+
+		memcpy(pkc, p1, sizeof(*pkc));
+		pkc->pkbdq = &p1->pkbdq[first];
+		pkc->pkblk_start = pkc->pkbdq[0].buffer;
+		pkc->knum_blocks = nr_blocks;
+		pkc->po = po;
+		pkc->cpu = cpu;
+		atomic_set(&pkc->blk_fill_in_prog, 0);
+		atomic_set(&pkc->pkts, 0);
+		atomic_set(&pkc->freeze_q_cnt, 0);
+		timer_setup(&pkc->retire_blk_timer,
+			    prb_retire_rx_blk_timer_expired_pcpu,
+			    TIMER_PINNED);
+		prb_open_block(pkc, GET_PBLOCK_DESC(pkc, 0));
+
+		/* Opening armed the timer here, it belongs on @cpu. An
+		 * offline CPU arms its own once it receives again.
+		 */
+		del_timer(&pkc->retire_blk_timer);
+		if (cpu_online(cpu)) {
+			pkc->retire_blk_timer.expires =
+				jiffies + pkc->tov_in_jiffies;
+			add_timer_on(&pkc->retire_blk_timer, cpu);
+		}
+
+		first += nr_blocks;
+	}
+	cpus_read_unlock();
+	rb->prb_pcpu = pcpu;
+}
+
 static void init_prb_bdqc(struct packet_sock *po,
 			struct packet_ring_buffer *rb,
 			struct pgv *pg_vec,
-			union tpacket_req_u *req_u)
+			union tpacket_req_u *req_u,
+			struct tpacket_kbdq_core __percpu *pcpu)
 {
 	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
 	struct tpacket_block_desc *pbd;
@@ -596,6 +721,11 @@ static void init_prb_bdqc(struct packet_sock *po,
 
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
 	prb_init_ft_ops(p1, req_u);
+	if (pcpu) {
+		/* p1 only serves as the template of the per-CPU cores */
+		init_prb_bdqc_pcpu(po, rb, pcpu);
+		return;
+	}
 	prb_setup_retire_blk_timer(po);
 	prb_open_block(p1, pbd);
 }
@@ -633,21 +763,17 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  * prb_calc_retire_blk_tmo() calculates the tmo.
  *
  */
-static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
+static void __prb_retire_rx_blk_timer(struct packet_sock *po,
+				      struct tpacket_kbdq_core *pkc)
 {
-	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
-	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
 
-	spin_lock(&po->sk.sk_receive_queue.lock);
-
 	frozen = prb_queue_frozen(pkc);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 
-	if (unlikely(pkc->delete_blk_timer))
-		goto out;
+	if (unlikely(READ_ONCE(pkc->delete_blk_timer)))
+		return;
 
 	/* We only need to plug the race when the block is partially filled.
 	 * tpacket_rcv:
@@ -675,7 +801,7 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 			if (!prb_dispatch_next_block(pkc, po))
 				goto refresh_timer;
 			else
-				goto out;
+				return;
 		} else {
 			/* Case 1. Queue was frozen because user-space was
 			 *	   lagging behind.
@@ -695,18 +821,39 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 				* Thawing/timer-refresh is a side effect.
 				*/
 				prb_open_block(pkc, pbd);
-				goto out;
+				return;
 			}
 		}
 	}
 
 refresh_timer:
 	_prb_refresh_rx_retire_blk_timer(pkc);
+}
 
-out:
+static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
+{
+	struct packet_sock *po =
+		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
+
+	spin_lock(&po->sk.sk_receive_queue.lock);
+	__prb_retire_rx_blk_timer(po, GET_PBDQC_FROM_RB(&po->rx_ring));
 	spin_unlock(&po->sk.sk_receive_queue.lock);
 }
 
+/* Pinned to the CPU owning @pkc, so it cannot race with tpacket_rcv() */
+static void prb_retire_rx_blk_timer_expired_pcpu(struct timer_list *t)
+{
+	struct tpacket_kbdq_core *pkc = from_timer(pkc, t, retire_blk_timer);
+
+	/* CPU hotplug migrated us. Stay idle, the owner re-arms the timer
+	 * from tpacket_rcv() once it is back online.
+	 */
+	if (unlikely(pkc->cpu != smp_processor_id()))
+		return;
+
+	__prb_retire_rx_blk_timer(pkc->po, pkc);
+}
+
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
 		struct tpacket_block_desc *pbd1, __u32 status)
 {
@@ -868,7 +1015,10 @@ static void prb_freeze_queue(struct tpacket_kbdq_core *pkc,
 				  struct packet_sock *po)
 {
 	pkc->reset_pending_on_curr_blk = 1;
-	po->stats.stats3.tp_freeze_q_cnt++;
+	if (pkc->po)
+		atomic_inc(&pkc->freeze_q_cnt);
+	else
+		po->stats.stats3.tp_freeze_q_cnt++;
 }
 
 #define TOTAL_PKT_LEN_INCL_ALIGN(length) (ALIGN((length), V3_ALIGNMENT))
@@ -941,9 +1091,8 @@ static int prb_queue_frozen(struct tpacket_kbdq_core *pkc)
 	return pkc->reset_pending_on_curr_blk;
 }
 
-static void prb_clear_blk_fill_status(struct packet_ring_buffer *rb)
+static void prb_clear_blk_fill_status(struct tpacket_kbdq_core *pkc)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
 	atomic_dec(&pkc->blk_fill_in_prog);
 }
 
@@ -1002,7 +1151,7 @@ static void prb_fill_curr_block(char *curr,
 	prb_run_all_ft_ops(pkc, ppd);
 }
 
-/* Assumes caller has the sk->rx_queue.lock */
+/* Assumes caller has the sk->rx_queue.lock, unless the ring is per-CPU */
 static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 					    struct sk_buff *skb,
 					    unsigned int len
@@ -1012,9 +1161,15 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 	struct tpacket_block_desc *pbd;
 	char *curr, *end;
 
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	pkc = prb_rx_core(po);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 
+	/* The core of a CPU that was offline has no timer armed */
+	if (po->rx_ring.prb_pcpu &&
+	    unlikely(!timer_pending(&pkc->retire_blk_timer)) &&
+	    !READ_ONCE(pkc->delete_blk_timer))
+		_prb_refresh_rx_retire_blk_timer(pkc);
+
 	/* Queue is frozen when user space is lagging behind */
 	if (prb_queue_frozen(pkc)) {
 		/*
@@ -1084,12 +1239,9 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 	}
 }
 
-static void *prb_lookup_block(const struct packet_sock *po,
-			      const struct packet_ring_buffer *rb,
-			      unsigned int idx,
-			      int status)
+static void *__prb_lookup_block(const struct tpacket_kbdq_core *pkc,
+				unsigned int idx, int status)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
 	struct tpacket_block_desc *pbd = GET_PBLOCK_DESC(pkc, idx);
 
 	if (status != BLOCK_STATUS(pbd))
@@ -1097,6 +1249,31 @@ static void *prb_lookup_block(const struct packet_sock *po,
 	return pbd;
 }
 
+static void *prb_lookup_block(const struct packet_sock *po,
+			      const struct packet_ring_buffer *rb,
+			      unsigned int idx,
+			      int status)
+{
+	return __prb_lookup_block(GET_PBDQC_FROM_RB(rb), idx, status);
+}
+
+/* Per-CPU ring is readable as soon as one sub-ring has a retired block */
+static bool prb_pcpu_readable(struct packet_ring_buffer *rb)
+{
+	struct tpacket_kbdq_core *pkc;
+	unsigned int prev;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pkc = per_cpu_ptr(rb->prb_pcpu, cpu);
+		prev = READ_ONCE(pkc->kactive_blk_num);
+		prev = prev ? prev - 1 : pkc->knum_blocks - 1;
+		if (!__prb_lookup_block(pkc, prev, TP_STATUS_KERNEL))
+			return true;
+	}
+	return false;
+}
+
 static int prb_previous_blk_num(struct packet_ring_buffer *rb)
 {
 	unsigned int prev;
@@ -1215,15 +1392,21 @@ static bool __tpacket_has_room(const struct packet_sock *po, int pow_off)
 
 static bool __tpacket_v3_has_room(const struct packet_sock *po, int pow_off)
 {
+	const struct tpacket_kbdq_core *pkc;
 	int idx, len;
 
-	len = READ_ONCE(po->rx_ring.prb_bdqc.knum_blocks);
-	idx = READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num);
+	/* Only a hint, recvmsg() may look from any CPU */
+	if (po->rx_ring.prb_pcpu)
+		pkc = raw_cpu_ptr(po->rx_ring.prb_pcpu);
+	else
+		pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	len = READ_ONCE(pkc->knum_blocks);
+	idx = READ_ONCE(pkc->kactive_blk_num);
 	if (pow_off)
 		idx += len >> pow_off;
 	if (idx >= len)
 		idx -= len;
-	return prb_lookup_block(po, &po->rx_ring, idx, TP_STATUS_KERNEL);
+	return __prb_lookup_block(pkc, idx, TP_STATUS_KERNEL);
 }
 
 static int __packet_rcv_has_room(const struct packet_sock *po,
@@ -1292,6 +1475,7 @@ static void packet_sock_destruct(struct sock *sk)
 		return;
 	}
 
+	kfree(pkt_sk(sk)->tx_ring.tx_blocks);
 	sk_refcnt_debug_dec(sk);
 }
 
@@ -2174,6 +2358,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	__u32 ts_status;
 	bool is_drop_n_account = false;
 	bool do_vnet = false;
+	bool pcpu;
 
 	/* struct tpacket{2,3}_hdr is aligned to a multiple of TPACKET_ALIGNMENT.
 	 * We may add members to them until current aligned size without forcing
@@ -2269,7 +2454,9 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			do_vnet = false;
 		}
 	}
-	spin_lock(&sk->sk_receive_queue.lock);
+	pcpu = po->rx_ring.prb_pcpu;
+	if (!pcpu)
+		spin_lock(&sk->sk_receive_queue.lock);
 	h.raw = packet_current_rx_frame(po, skb,
 					TP_STATUS_KERNEL, (macoff+snaplen));
 	if (!h.raw)
@@ -2292,12 +2479,16 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 				    vio_le(), true, 0))
 		goto drop_n_account;
 
-	po->stats.stats1.tp_packets++;
-	if (copy_skb) {
-		status |= TP_STATUS_COPY;
-		__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
+	if (pcpu) {
+		atomic_inc(&prb_rx_core(po)->pkts);
+	} else {
+		po->stats.stats1.tp_packets++;
+		if (copy_skb) {
+			status |= TP_STATUS_COPY;
+			__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
+		}
+		spin_unlock(&sk->sk_receive_queue.lock);
 	}
-	spin_unlock(&sk->sk_receive_queue.lock);
 
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
@@ -2382,7 +2573,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		__packet_set_status(po, h.raw, status);
 		sk->sk_data_ready(sk);
 	} else {
-		prb_clear_blk_fill_status(&po->rx_ring);
+		prb_clear_blk_fill_status(prb_rx_core(po));
 	}
 
 drop_n_restore:
@@ -2398,7 +2589,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	return 0;
 
 drop_n_account:
-	spin_unlock(&sk->sk_receive_queue.lock);
+	if (!pcpu)
+		spin_unlock(&sk->sk_receive_queue.lock);
 	atomic_inc(&po->tp_drops);
 	is_drop_n_account = true;
 
@@ -2407,6 +2599,19 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	goto drop_n_restore;
 }
 
+/* Hand a TP_FT_REQ_TX_BLOCK block back once its last skb is gone */
+static void prb_tx_block_put(struct packet_tx_block *blk)
+{
+	if (!atomic_dec_and_test(&blk->pending))
+		return;
+
+	BLOCK_STATUS(blk->pbd) = blk->status;
+#if ARCH_IMPLEMENTS_FLUSH_DCACHE_PAGE == 1
+	flush_dcache_page(pgv_to_page(blk->pbd));
+#endif
+	smp_wmb();
+}
+
 static void tpacket_destruct_skb(struct sk_buff *skb)
 {
 	struct packet_sock *po = pkt_sk(skb->sk);
@@ -2418,8 +2623,12 @@ static void tpacket_destruct_skb(struct sk_buff *skb)
 		ph = skb_zcopy_get_nouarg(skb);
 		packet_dec_pending(&po->tx_ring);
 
-		ts = __packet_set_timestamp(po, ph, skb);
-		__packet_set_status(po, ph, TP_STATUS_AVAILABLE | ts);
+		if (po->tx_ring.tx_blocks) {
+			prb_tx_block_put(ph);
+		} else {
+			ts = __packet_set_timestamp(po, ph, skb);
+			__packet_set_status(po, ph, TP_STATUS_AVAILABLE | ts);
+		}
 
 		if (!packet_read_pending(&po->tx_ring))
 			complete(&po->skb_completion);
@@ -2605,6 +2814,166 @@ static int tpacket_parse_header(struct packet_sock *po, void *frame,
 	return tp_len;
 }
 
+static void packet_xmit_list(struct packet_sock *po, struct sk_buff *skb)
+{
+	struct sk_buff *next;
+
+	if (po->xmit == packet_direct_xmit) {
+		packet_direct_xmit_list(skb);
+		return;
+	}
+
+	/* The qdisc layer does its own bulking towards the driver */
+	for (; skb; skb = next) {
+		next = skb->next;
+		skb_mark_not_on_list(skb);
+		po->xmit(skb);
+	}
+}
+
+/* Send the packets of a TP_STATUS_SEND_REQUEST block as one burst.
+ *
+ * If the block can only be sent in part, its num_pkts and
+ * offset_to_first_pkt are rewritten to describe what is left. It then
+ * goes back to TP_STATUS_SEND_REQUEST, or to TP_STATUS_WRONG_FORMAT if
+ * a malformed packet stopped us, once the skbs already sent are gone.
+ */
+static int tpacket_snd_block(struct packet_sock *po, struct net_device *dev,
+			     struct packet_tx_block *blk, __be16 proto,
+			     unsigned char *addr,
+			     const struct sockcm_cookie *sockc, bool need_wait)
+{
+	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->tx_ring);
+	unsigned int data_off = po->tp_hdrlen - sizeof(struct sockaddr_ll);
+	struct tpacket_block_desc *pbd = blk->pbd;
+	struct sk_buff *skb, *head = NULL, **tail = &head;
+	int hlen = LL_RESERVED_SPACE(dev);
+	int tlen = dev->needed_tailroom;
+	unsigned int off, next, len, num, i;
+	int tp_len, len_sum = 0, err = 0;
+	int reserve = 0, size_max;
+	struct tpacket3_hdr *h3;
+
+	if (po->sk.sk_socket->type == SOCK_RAW)
+		reserve = dev->hard_header_len;
+	size_max = dev->mtu + reserve + VLAN_HLEN;
+
+	num = READ_ONCE(BLOCK_NUM_PKTS(pbd));
+	off = READ_ONCE(BLOCK_O2FP(pbd));
+
+	/* Bias keeps the block ours until every packet is queued */
+	atomic_inc(&blk->pending);
+	blk->status = TP_STATUS_AVAILABLE;
+	BLOCK_STATUS(pbd) = TP_STATUS_SENDING;
+
+	for (i = 0; i < num; i++, off += next) {
+		if (unlikely(off < BLK_HDR_LEN ||
+			     off > pkc->kblk_size - data_off ||
+			     !IS_ALIGNED(off, TPACKET_ALIGNMENT)))
+			goto bad_format;
+
+		h3 = (void *)pbd + off;
+		len = READ_ONCE(h3->tp_len);
+		next = READ_ONCE(h3->tp_next_offset);
+		/* As on rx, a zero offset ends the chain whatever num_pkts says */
+		if (!next)
+			num = i + 1;
+		if (unlikely(len > size_max ||
+			     len > pkc->kblk_size - data_off - off))
+			goto bad_format;
+
+		/* Don't sleep on sndbuf that our own unsent skbs hold */
+		skb = sock_alloc_send_skb(&po->sk,
+				hlen + tlen + sizeof(struct sockaddr_ll),
+				!need_wait || head, &err);
+		if (!skb && head) {
+			packet_xmit_list(po, head);
+			head = NULL;
+			tail = &head;
+			skb = sock_alloc_send_skb(&po->sk,
+				hlen + tlen + sizeof(struct sockaddr_ll),
+				!need_wait, &err);
+		}
+		if (unlikely(!skb)) {
+			blk->status = TP_STATUS_SEND_REQUEST;
+			goto partial;
+		}
+
+		tp_len = tpacket_fill_skb(po, skb, blk, dev, (void *)h3 + data_off,
+					  len, proto, addr, hlen,
+					  dev->hard_header_len, sockc);
+		if (likely(tp_len >= 0) &&
+		    tp_len > dev->mtu + reserve &&
+		    !packet_extra_vlan_len_allowed(dev, skb))
+			tp_len = -EMSGSIZE;
+		if (unlikely(tp_len < 0)) {
+			kfree_skb(skb);
+			if (po->tp_loss)
+				continue;
+			err = tp_len;
+			goto bad_format;
+		}
+
+		skb->destructor = tpacket_destruct_skb;
+		atomic_inc(&blk->pending);
+		packet_inc_pending(&po->tx_ring);
+
+		*tail = skb;
+		tail = &skb->next;
+		len_sum += tp_len;
+	}
+	goto out;
+
+bad_format:
+	if (!err)
+		err = -EINVAL;
+	blk->status = TP_STATUS_WRONG_FORMAT;
+partial:
+	BLOCK_NUM_PKTS(pbd) = num - i;
+	BLOCK_O2FP(pbd) = off;
+out:
+	if (head)
+		packet_xmit_list(po, head);
+	prb_tx_block_put(blk);
+	return len_sum ? : err;
+}
+
+static int tpacket_snd_blocks(struct packet_sock *po, struct net_device *dev,
+			      __be16 proto, unsigned char *addr,
+			      const struct sockcm_cookie *sockc, bool need_wait)
+{
+	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->tx_ring);
+	struct packet_tx_block *blk;
+	int err = 0, len_sum = 0;
+	long timeo;
+
+	for (;;) {
+		blk = &po->tx_ring.tx_blocks[pkc->kactive_blk_num];
+		if (READ_ONCE(BLOCK_STATUS(blk->pbd)) != TP_STATUS_SEND_REQUEST)
+			break;
+		smp_rmb();
+
+		err = tpacket_snd_block(po, dev, blk, proto, addr, sockc,
+					need_wait);
+		if (err < 0)
+			break;
+		len_sum += err;
+		err = 0;
+		if (blk->status != TP_STATUS_AVAILABLE)
+			break;
+		pkc->kactive_blk_num = GET_NEXT_PRB_BLK_NUM(pkc);
+	}
+
+	while (need_wait && packet_read_pending(&po->tx_ring)) {
+		timeo = sock_sndtimeo(&po->sk, false);
+		timeo = wait_for_completion_interruptible_timeout(&po->skb_completion, timeo);
+		if (timeo <= 0)
+			return !timeo ? -ETIMEDOUT : -ERESTARTSYS;
+	}
+
+	return len_sum ? : err;
+}
+
 static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 {
 	struct sk_buff *skb = NULL;
@@ -2678,6 +3047,12 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 
 	reinit_completion(&po->skb_completion);
 
+	if (po->tx_ring.tx_blocks) {
+		err = tpacket_snd_blocks(po, dev, proto, addr, &sockc,
+					 need_wait);
+		goto out_put;
+	}
+
 	do {
 		ph = packet_current_frame(po, &po->tx_ring,
 					  TP_STATUS_SEND_REQUEST);
@@ -3932,6 +4307,18 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		spin_lock_bh(&sk->sk_receive_queue.lock);
 		memcpy(&st, &po->stats, sizeof(st));
 		memset(&po->stats, 0, sizeof(po->stats));
+		if (po->rx_ring.prb_pcpu) {
+			struct tpacket_kbdq_core *pkc;
+			int cpu;
+
+			for_each_possible_cpu(cpu) {
+				pkc = per_cpu_ptr(po->rx_ring.prb_pcpu, cpu);
+				st.stats3.tp_packets +=
+					atomic_xchg(&pkc->pkts, 0);
+				st.stats3.tp_freeze_q_cnt +=
+					atomic_xchg(&pkc->freeze_q_cnt, 0);
+			}
+		}
 		spin_unlock_bh(&sk->sk_receive_queue.lock);
 		drops = atomic_xchg(&po->tp_drops, 0);
 
@@ -4158,16 +4545,30 @@ static __poll_t packet_poll(struct file *file, struct socket *sock,
 
 	spin_lock_bh(&sk->sk_receive_queue.lock);
 	if (po->rx_ring.pg_vec) {
-		if (!packet_previous_rx_frame(po, &po->rx_ring,
-			TP_STATUS_KERNEL))
+		if (po->rx_ring.prb_pcpu) {
+			if (prb_pcpu_readable(&po->rx_ring))
+				mask |= EPOLLIN | EPOLLRDNORM;
+		} else if (!packet_previous_rx_frame(po, &po->rx_ring,
+			TP_STATUS_KERNEL)) {
 			mask |= EPOLLIN | EPOLLRDNORM;
+		}
 	}
 	packet_rcv_try_clear_pressure(po);
 	spin_unlock_bh(&sk->sk_receive_queue.lock);
 	spin_lock_bh(&sk->sk_write_queue.lock);
 	if (po->tx_ring.pg_vec) {
-		if (packet_current_frame(po, &po->tx_ring, TP_STATUS_AVAILABLE))
+		if (po->tx_ring.tx_blocks) {
+			struct tpacket_kbdq_core *pkc;
+
+			pkc = GET_PBDQC_FROM_RB(&po->tx_ring);
+			if (prb_lookup_block(po, &po->tx_ring,
+					     pkc->kactive_blk_num,
+					     TP_STATUS_AVAILABLE))
+				mask |= EPOLLOUT | EPOLLWRNORM;
+		} else if (packet_current_frame(po, &po->tx_ring,
+						TP_STATUS_AVAILABLE)) {
 			mask |= EPOLLOUT | EPOLLWRNORM;
+		}
 	}
 	spin_unlock_bh(&sk->sk_write_queue.lock);
 	return mask;
@@ -4271,9 +4672,47 @@ static struct pgv *alloc_pg_vec(struct tpacket_req *req, int order)
 	goto out;
 }
 
+static struct packet_tx_block *init_prb_tx_blocks(struct packet_sock *po,
+						  struct packet_ring_buffer *rb,
+						  struct pgv *pg_vec,
+						  struct tpacket_req3 *req3)
+{
+	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(rb);
+	struct tpacket_block_desc *pbd;
+	struct packet_tx_block *blks;
+	unsigned int i;
+
+	blks = kcalloc(req3->tp_block_nr, sizeof(*blks), GFP_KERNEL);
+	if (!blks)
+		return NULL;
+
+	memset(pkc, 0x0, sizeof(*pkc));
+	pkc->pkbdq = pg_vec;
+	pkc->kblk_size = req3->tp_block_size;
+	pkc->knum_blocks = req3->tp_block_nr;
+	pkc->hdrlen = po->tp_hdrlen;
+	pkc->version = po->tp_version;
+	pkc->blk_sizeof_priv = req3->tp_sizeof_priv;
+	pkc->feature_req_word = req3->tp_feature_req_word;
+
+	/* Pre-fill the layout, user space only sets num_pkts and status */
+	for (i = 0; i < pkc->knum_blocks; i++) {
+		pbd = GET_PBLOCK_DESC(pkc, i);
+		pbd->version = pkc->version;
+		BLOCK_O2PRIV(pbd) = BLK_HDR_LEN;
+		BLOCK_O2FP(pbd) = BLK_PLUS_PRIV(pkc->blk_sizeof_priv);
+		BLOCK_STATUS(pbd) = TP_STATUS_AVAILABLE;
+		blks[i].pbd = pbd;
+	}
+
+	return blks;
+}
+
 static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		int closing, int tx_ring)
 {
+	struct tpacket_kbdq_core __percpu *pcpu = NULL;
+	struct packet_tx_block *tx_blocks = NULL;
 	struct pgv *pg_vec = NULL;
 	struct packet_sock *po = pkt_sk(sk);
 	int was_running, order = 0;
@@ -4348,16 +4787,41 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		case TPACKET_V3:
 			/* Block transmit is not supported yet */
 			if (!tx_ring) {
-				init_prb_bdqc(po, rb, pg_vec, req_u);
+				if (req_u->req3.tp_feature_req_word &
+				    TP_FT_REQ_PERCPU_RING) {
+					err = -EINVAL;
+					if (req->tp_block_nr %
+					    num_possible_cpus())
+						goto out_free_pg_vec;
+					err = -ENOMEM;
+					pcpu = alloc_percpu(struct tpacket_kbdq_core);
+					if (!pcpu)
+						goto out_free_pg_vec;
+				}
+				init_prb_bdqc(po, rb, pg_vec, req_u, pcpu);
 			} else {
 				struct tpacket_req3 *req3 = &req_u->req3;
+				bool blocks = req3->tp_feature_req_word &
+					      TP_FT_REQ_TX_BLOCK;
 
 				if (req3->tp_retire_blk_tov ||
-				    req3->tp_sizeof_priv ||
-				    req3->tp_feature_req_word) {
+				    (req3->tp_sizeof_priv && !blocks) ||
+				    (req3->tp_feature_req_word &
+				     ~TP_FT_REQ_TX_BLOCK)) {
 					err = -EINVAL;
 					goto out_free_pg_vec;
 				}
+				if (blocks) {
+					err = -EINVAL;
+					if (po->has_vnet_hdr || po->tp_tx_has_off)
+						goto out_free_pg_vec;
+					err = -ENOMEM;
+					tx_blocks = init_prb_tx_blocks(po, rb,
+								       pg_vec,
+								       req3);
+					if (!tx_blocks)
+						goto out_free_pg_vec;
+				}
 			}
 			break;
 		default:
@@ -4390,6 +4854,11 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		err = 0;
 		spin_lock_bh(&rb_queue->lock);
 		swap(rb->pg_vec, pg_vec);
+		/* In-flight skbs may still point at the blocks on close,
+		 * packet_sock_destruct() frees them then.
+		 */
+		if (!closing)
+			swap(rb->tx_blocks, tx_blocks);
 		rb->frame_max = (req->tp_frame_nr - 1);
 		rb->head = 0;
 		rb->frame_size = req->tp_frame_size;
@@ -4421,6 +4890,7 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 	}
 
 out_free_pg_vec:
+	kfree(tx_blocks);
 	if (pg_vec)
 		free_pg_vec(pg_vec, order, req->tp_block_nr);
 out:
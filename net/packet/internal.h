@@ -13,6 +13,30 @@ struct packet_mclist {
 	unsigned char		addr[MAX_ADDR_LEN];
 };
 
+/* tp_feature_req_word bit: split the TPACKET_V3 rx ring into one sub-ring
+ * of tp_block_nr / num_possible_cpus() blocks per possible CPU, in
+ * ascending CPU order. Each sub-ring is filled only by its own CPU,
+ * without taking sk_receive_queue.lock.
+ */
+#ifndef TP_FT_REQ_PERCPU_RING
+#define TP_FT_REQ_PERCPU_RING	0x2
+#endif
+
+/* tp_feature_req_word bit for a TPACKET_V3 tx ring: packets are grouped
+ * into blocks led by a struct tpacket_block_desc, chained through
+ * tp_next_offset, and a TP_STATUS_SEND_REQUEST block is sent as a whole.
+ */
+#ifndef TP_FT_REQ_TX_BLOCK
+#define TP_FT_REQ_TX_BLOCK	0x4
+#endif
+
+/* Kernel side state of a TP_FT_REQ_TX_BLOCK block */
+struct packet_tx_block {
+	struct tpacket_block_desc	*pbd;
+	atomic_t			pending;
+	u32				status;
+};
+
 /* kbdq - kernel block descriptor queue */
 struct tpacket_kbdq_core {
 	struct pgv	*pkbdq;
@@ -50,6 +74,12 @@ struct tpacket_kbdq_core {
 
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
+
+	/* Only set for the per-CPU cores of a TP_FT_REQ_PERCPU_RING ring */
+	struct packet_sock	*po;
+	int			cpu;
+	atomic_t		pkts;
+	atomic_t		freeze_q_cnt;
 };
 
 struct pgv {
@@ -71,6 +101,8 @@ struct packet_ring_buffer {
 	unsigned int __percpu	*pending_refcnt;
 
 	struct tpacket_kbdq_core	prb_bdqc;
+	struct tpacket_kbdq_core __percpu	*prb_pcpu;
+	struct packet_tx_block		*tx_blocks;
 };
 
 extern struct mutex fanout_mutex;
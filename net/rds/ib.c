@@ -42,7 +42,6 @@
 #include <linux/module.h>
 #include <net/addrconf.h>
 
-#include "rds_single_path.h"
 #include "rds.h"
 #include "ib.h"
 #include "ib_mr.h"
@@ -74,10 +73,15 @@ LIST_HEAD(ib_nodev_conns);
 static void rds_ib_nodev_connect(void)
 {
 	struct rds_ib_connection *ic;
+	struct rds_conn_path *cp;
 
 	spin_lock(&ib_nodev_conns_lock);
-	list_for_each_entry(ic, &ib_nodev_conns, ib_node)
-		rds_conn_connect_if_down(ic->conn);
+	list_for_each_entry(ic, &ib_nodev_conns, ib_node) {
+		/* paths beyond the negotiated count stay down */
+		cp = ic->i_cpath;
+		if (cp->cp_index < max_t(int, 1, ic->conn->c_npaths))
+			rds_conn_path_connect_if_down(cp);
+	}
 	spin_unlock(&ib_nodev_conns_lock);
 }
 
@@ -88,7 +92,7 @@ static void rds_ib_dev_shutdown(struct rds_ib_device *rds_ibdev)
 
 	spin_lock_irqsave(&rds_ibdev->spinlock, flags);
 	list_for_each_entry(ic, &rds_ibdev->conn_list, ib_node)
-		rds_conn_path_drop(&ic->conn->c_path[0], true);
+		rds_conn_path_drop(ic->i_cpath, true);
 	spin_unlock_irqrestore(&rds_ibdev->spinlock, flags);
 }
 
@@ -306,7 +310,8 @@ static int rds_ib_conn_info_visitor(struct rds_connection *conn,
 				    void *buffer)
 {
 	struct rds_info_rdma_connection *iinfo = buffer;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_conn_path *cp = &conn->c_path[0];
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	/* We will only ever look at IB transports */
 	if (conn->c_trans != &rds_ib_transport)
@@ -323,7 +328,7 @@ static int rds_ib_conn_info_visitor(struct rds_connection *conn,
 
 	memset(&iinfo->src_gid, 0, sizeof(iinfo->src_gid));
 	memset(&iinfo->dst_gid, 0, sizeof(iinfo->dst_gid));
-	if (rds_conn_state(conn) == RDS_CONN_UP) {
+	if (rds_conn_path_state(cp) == RDS_CONN_UP) {
 		struct rds_ib_device *rds_ibdev;
 
 		rdma_read_gids(ic->i_cm_id, (union ib_gid *)&iinfo->src_gid,
@@ -345,7 +350,8 @@ static int rds6_ib_conn_info_visitor(struct rds_connection *conn,
 				     void *buffer)
 {
 	struct rds6_info_rdma_connection *iinfo6 = buffer;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_conn_path *cp = &conn->c_path[0];
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	/* We will only ever look at IB transports */
 	if (conn->c_trans != &rds_ib_transport)
@@ -361,7 +367,7 @@ static int rds6_ib_conn_info_visitor(struct rds_connection *conn,
 	memset(&iinfo6->src_gid, 0, sizeof(iinfo6->src_gid));
 	memset(&iinfo6->dst_gid, 0, sizeof(iinfo6->dst_gid));
 
-	if (rds_conn_state(conn) == RDS_CONN_UP) {
+	if (rds_conn_path_state(cp) == RDS_CONN_UP) {
 		struct rds_ib_device *rds_ibdev;
 
 		rdma_read_gids(ic->i_cm_id, (union ib_gid *)&iinfo6->src_gid,
@@ -571,7 +577,8 @@ struct rds_transport rds_ib_transport = {
 	.t_owner		= THIS_MODULE,
 	.t_name			= "infiniband",
 	.t_unloading		= rds_ib_is_unloading,
-	.t_type			= RDS_TRANS_IB
+	.t_type			= RDS_TRANS_IB,
+	.t_mp_capable		= 1,
 };
 
 int rds_ib_init(void)
@@ -67,7 +67,7 @@ struct rds_ib_conn_priv_cmn {
 	u8			ricpc_protocol_minor;
 	__be16			ricpc_protocol_minor_mask;	/* bitmask */
 	u8			ricpc_dp_toss;
-	u8			ripc_reserved1;
+	u8			ricpc_dp_path;	/* index into c_path[] */
 	__be16			ripc_reserved2;
 	__be64			ricpc_ack_seq;
 	__be32			ricpc_credit;	/* non-zero enables flow ctl */
@@ -145,6 +145,7 @@ struct rds_ib_connection {
 	struct list_head	ib_node;
 	struct rds_ib_device	*rds_ibdev;
 	struct rds_connection	*conn;
+	struct rds_conn_path	*i_cpath;
 
 	/* alphabet soup, IBTA style */
 	struct rdma_cm_id	*i_cm_id;
@@ -377,11 +378,11 @@ void rds_ib_state_change(struct sock *sk);
 int rds_ib_listen_init(void);
 void rds_ib_listen_stop(void);
 __printf(2, 3)
-void __rds_ib_conn_error(struct rds_connection *conn, const char *, ...);
+void __rds_ib_conn_error(struct rds_conn_path *cp, const char *, ...);
 int rds_ib_cm_handle_connect(struct rdma_cm_id *cm_id,
 			     struct rdma_cm_event *event, bool isv6);
 int rds_ib_cm_initiate_connect(struct rdma_cm_id *cm_id, bool isv6);
-void rds_ib_cm_connect_complete(struct rds_connection *conn,
+void rds_ib_cm_connect_complete(struct rds_conn_path *cp,
 				struct rdma_cm_event *event);
 struct rds_header **rds_dma_hdrs_alloc(struct ib_device *ibdev,
 				       struct dma_pool *pool,
@@ -389,24 +390,26 @@ struct rds_header **rds_dma_hdrs_alloc(struct ib_device *ibdev,
 void rds_dma_hdrs_free(struct dma_pool *pool, struct rds_header **hdrs,
 		       dma_addr_t *dma_addrs, u32 num_hdrs);
 
-#define rds_ib_conn_error(conn, fmt...) \
-	__rds_ib_conn_error(conn, KERN_WARNING "RDS/IB: " fmt)
+#define rds_ib_conn_error(cp, fmt...) \
+	__rds_ib_conn_error(cp, KERN_WARNING "RDS/IB: " fmt)
 
 /* ib_rdma.c */
 int rds_ib_update_ipaddr(struct rds_ib_device *rds_ibdev,
 			 struct in6_addr *ipaddr);
-void rds_ib_add_conn(struct rds_ib_device *rds_ibdev, struct rds_connection *conn);
-void rds_ib_remove_conn(struct rds_ib_device *rds_ibdev, struct rds_connection *conn);
+void rds_ib_add_conn(struct rds_ib_device *rds_ibdev,
+		     struct rds_ib_connection *ic);
+void rds_ib_remove_conn(struct rds_ib_device *rds_ibdev,
+			struct rds_ib_connection *ic);
 void rds_ib_destroy_nodev_conns(void);
 void rds_ib_mr_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc);
 
 /* ib_recv.c */
 int rds_ib_recv_init(void);
 void rds_ib_recv_exit(void);
-int rds_ib_recv_path(struct rds_conn_path *conn);
+int rds_ib_recv_path(struct rds_conn_path *cp);
 int rds_ib_recv_alloc_caches(struct rds_ib_connection *ic, gfp_t gfp);
 void rds_ib_recv_free_caches(struct rds_ib_connection *ic);
-void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp);
+void rds_ib_recv_refill(struct rds_conn_path *cp, int prefill, gfp_t gfp);
 void rds_ib_inc_free(struct rds_incoming *inc);
 int rds_ib_inc_copy_to_user(struct rds_incoming *inc, struct iov_iter *to);
 void rds_ib_recv_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc,
@@ -440,8 +443,8 @@ void rds_ib_send_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc);
 void rds_ib_send_init_ring(struct rds_ib_connection *ic);
 void rds_ib_send_clear_ring(struct rds_ib_connection *ic);
 int rds_ib_xmit_rdma(struct rds_connection *conn, struct rm_rdma_op *op);
-void rds_ib_send_add_credits(struct rds_connection *conn, unsigned int credits);
-void rds_ib_advertise_credits(struct rds_connection *conn, unsigned int posted);
+void rds_ib_send_add_credits(struct rds_conn_path *cp, unsigned int credits);
+void rds_ib_advertise_credits(struct rds_conn_path *cp, unsigned int posted);
 int rds_ib_send_grab_credits(struct rds_ib_connection *ic, u32 wanted,
 			     u32 *adv_credits, int need_posted, int max_posted);
 int rds_ib_xmit_atomic(struct rds_connection *conn, struct rm_atomic_op *op);
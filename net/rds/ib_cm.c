@@ -38,7 +38,6 @@
 #include <linux/ratelimit.h>
 #include <net/addrconf.h>
 
-#include "rds_single_path.h"
 #include "rds.h"
 #include "ib.h"
 #include "ib_mr.h"
@@ -54,14 +53,14 @@ static void rds_ib_set_protocol(struct rds_connection *conn, unsigned int versio
 /*
  * Set up flow control
  */
-static void rds_ib_set_flow_control(struct rds_connection *conn, u32 credits)
+static void rds_ib_set_flow_control(struct rds_conn_path *cp, u32 credits)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	if (rds_ib_sysctl_flow_control && credits != 0) {
 		/* We're doing flow control */
 		ic->i_flowctl = 1;
-		rds_ib_send_add_credits(conn, credits);
+		rds_ib_send_add_credits(cp, credits);
 	} else {
 		ic->i_flowctl = 0;
 	}
@@ -96,9 +95,10 @@ rds_ib_tune_rnr(struct rds_ib_connection *ic, struct ib_qp_attr *attr)
  * Connection established.
  * We get here for both outgoing and incoming connection.
  */
-void rds_ib_cm_connect_complete(struct rds_connection *conn, struct rdma_cm_event *event)
+void rds_ib_cm_connect_complete(struct rds_conn_path *cp, struct rdma_cm_event *event)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_connection *conn = cp->cp_conn;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	const union rds_ib_conn_priv *dp = NULL;
 	struct ib_qp_attr qp_attr;
 	__be64 ack_seq = 0;
@@ -132,7 +132,7 @@ void rds_ib_cm_connect_complete(struct rds_connection *conn, struct rdma_cm_even
 	/* make sure it isn't empty data */
 	if (major) {
 		rds_ib_set_protocol(conn, RDS_PROTOCOL(major, minor));
-		rds_ib_set_flow_control(conn, be32_to_cpu(credit));
+		rds_ib_set_flow_control(cp, be32_to_cpu(credit));
 	}
 
 	if (conn->c_version < RDS_PROTOCOL_VERSION) {
@@ -146,9 +146,9 @@ void rds_ib_cm_connect_complete(struct rds_connection *conn, struct rdma_cm_even
 		}
 	}
 
-	pr_notice("RDS/IB: %s conn connected <%pI6c,%pI6c,%d> version %u.%u%s\n",
+	pr_notice("RDS/IB: %s conn connected <%pI6c,%pI6c,%d,%u> version %u.%u%s\n",
 		  ic->i_active_side ? "Active" : "Passive",
-		  &conn->c_laddr, &conn->c_faddr, conn->c_tos,
+		  &conn->c_laddr, &conn->c_faddr, conn->c_tos, cp->cp_index,
 		  RDS_PROTOCOL_MAJOR(conn->c_version),
 		  RDS_PROTOCOL_MINOR(conn->c_version),
 		  ic->i_flowctl ? ", flow control" : "");
@@ -166,7 +166,7 @@ void rds_ib_cm_connect_complete(struct rds_connection *conn, struct rdma_cm_even
 	rds_ib_recv_init_ring(ic);
 	/* Post receive buffers - as a side effect, this will update
 	 * the posted credit count. */
-	rds_ib_recv_refill(conn, 1, GFP_KERNEL);
+	rds_ib_recv_refill(cp, 1, GFP_KERNEL);
 
 	/* Tune RNR behavior */
 	rds_ib_tune_rnr(ic, &qp_attr);
@@ -186,15 +186,19 @@ void rds_ib_cm_connect_complete(struct rds_connection *conn, struct rdma_cm_even
 	 * we had received a regular ACK. */
 	if (dp) {
 		if (ack_seq)
-			rds_send_drop_acked(conn, be64_to_cpu(ack_seq),
-					    NULL);
+			rds_send_path_drop_acked(cp, be64_to_cpu(ack_seq),
+						 NULL);
 	}
 
 	conn->c_proposed_version = conn->c_version;
-	rds_connect_complete(conn);
+	rds_connect_path_complete(cp, RDS_CONN_CONNECTING);
+
+	/* learn how many paths the peer supports */
+	if (conn->c_npaths == 0)
+		rds_send_ping(conn, cp->cp_index);
 }
 
-static void rds_ib_cm_fill_conn_param(struct rds_connection *conn,
+static void rds_ib_cm_fill_conn_param(struct rds_conn_path *cp,
 				      struct rdma_conn_param *conn_param,
 				      union rds_ib_conn_priv *dp,
 				      u32 protocol_version,
@@ -202,7 +206,8 @@ static void rds_ib_cm_fill_conn_param(struct rds_connection *conn,
 				      u32 max_initiator_depth,
 				      bool isv6)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_connection *conn = cp->cp_conn;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	struct rds_ib_device *rds_ibdev = ic->rds_ibdev;
 
 	memset(conn_param, 0, sizeof(struct rdma_conn_param));
@@ -228,6 +233,7 @@ static void rds_ib_cm_fill_conn_param(struct rds_connection *conn,
 			dp->ricp_v6.dp_ack_seq =
 			    cpu_to_be64(rds_ib_piggyb_ack(ic));
 			dp->ricp_v6.dp_cmn.ricpc_dp_toss = conn->c_tos;
+			dp->ricp_v6.dp_cmn.ricpc_dp_path = cp->cp_index;
 
 			conn_param->private_data = &dp->ricp_v6;
 			conn_param->private_data_len = sizeof(dp->ricp_v6);
@@ -243,6 +249,7 @@ static void rds_ib_cm_fill_conn_param(struct rds_connection *conn,
 			dp->ricp_v4.dp_ack_seq =
 			    cpu_to_be64(rds_ib_piggyb_ack(ic));
 			dp->ricp_v4.dp_cmn.ricpc_dp_toss = conn->c_tos;
+			dp->ricp_v4.dp_cmn.ricpc_dp_path = cp->cp_index;
 
 			conn_param->private_data = &dp->ricp_v4;
 			conn_param->private_data_len = sizeof(dp->ricp_v4);
@@ -280,10 +287,9 @@ static void rds_ib_cq_event_handler(struct ib_event *event, void *data)
  */
 static void rds_ib_cq_comp_handler_recv(struct ib_cq *cq, void *context)
 {
-	struct rds_connection *conn = context;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = context;
 
-	rdsdebug("conn %p cq %p\n", conn, cq);
+	rdsdebug("ic %p cq %p\n", ic, cq);
 
 	rds_ib_stats_inc(s_ib_evt_handler_call);
 
@@ -316,7 +322,7 @@ static void poll_scq(struct rds_ib_connection *ic, struct ib_cq *cq,
 static void rds_ib_tasklet_fn_send(unsigned long data)
 {
 	struct rds_ib_connection *ic = (struct rds_ib_connection *)data;
-	struct rds_connection *conn = ic->conn;
+	struct rds_conn_path *cp = ic->i_cpath;
 
 	rds_ib_stats_inc(s_ib_tasklet_call);
 
@@ -328,10 +334,10 @@ static void rds_ib_tasklet_fn_send(unsigned long data)
 	ib_req_notify_cq(ic->i_send_cq, IB_CQ_NEXT_COMP);
 	poll_scq(ic, ic->i_send_cq, ic->i_send_wc);
 
-	if (rds_conn_up(conn) &&
-	    (!test_bit(RDS_LL_SEND_FULL, &conn->c_flags) ||
-	    test_bit(0, &conn->c_map_queued)))
-		rds_send_xmit(&ic->conn->c_path[0]);
+	if (rds_conn_path_up(cp) &&
+	    (!test_bit(RDS_LL_SEND_FULL, &cp->cp_flags) ||
+	    test_bit(0, &ic->conn->c_map_queued)))
+		rds_send_xmit(cp);
 }
 
 static void poll_rcq(struct rds_ib_connection *ic, struct ib_cq *cq,
@@ -356,12 +362,12 @@ static void poll_rcq(struct rds_ib_connection *ic, struct ib_cq *cq,
 static void rds_ib_tasklet_fn_recv(unsigned long data)
 {
 	struct rds_ib_connection *ic = (struct rds_ib_connection *)data;
-	struct rds_connection *conn = ic->conn;
+	struct rds_conn_path *cp = ic->i_cpath;
 	struct rds_ib_device *rds_ibdev = ic->rds_ibdev;
 	struct rds_ib_ack_state state;
 
 	if (!rds_ibdev)
-		rds_conn_drop(conn);
+		rds_conn_path_drop(cp, false);
 
 	rds_ib_stats_inc(s_ib_tasklet_call);
 
@@ -377,18 +383,18 @@ static void rds_ib_tasklet_fn_recv(unsigned long data)
 	if (state.ack_next_valid)
 		rds_ib_set_ack(ic, state.ack_next, state.ack_required);
 	if (state.ack_recv_valid && state.ack_recv > ic->i_ack_recv) {
-		rds_send_drop_acked(conn, state.ack_recv, NULL);
+		rds_send_path_drop_acked(cp, state.ack_recv, NULL);
 		ic->i_ack_recv = state.ack_recv;
 	}
 
-	if (rds_conn_up(conn))
+	if (rds_conn_path_up(cp))
 		rds_ib_attempt_ack(ic);
 }
 
 static void rds_ib_qp_event_handler(struct ib_event *event, void *data)
 {
-	struct rds_connection *conn = data;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = data;
+	struct rds_connection *conn = ic->conn;
 
 	rdsdebug("conn %p ic %p event %u (%s)\n", conn, ic, event->event,
 		 ib_event_msg(event->event));
@@ -401,17 +407,16 @@ static void rds_ib_qp_event_handler(struct ib_event *event, void *data)
 		rdsdebug("Fatal QP Event %u (%s) - connection %pI6c->%pI6c, reconnecting\n",
 			 event->event, ib_event_msg(event->event),
 			 &conn->c_laddr, &conn->c_faddr);
-		rds_conn_drop(conn);
+		rds_conn_path_drop(ic->i_cpath, false);
 		break;
 	}
 }
 
 static void rds_ib_cq_comp_handler_send(struct ib_cq *cq, void *context)
 {
-	struct rds_connection *conn = context;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = context;
 
-	rdsdebug("conn %p cq %p\n", conn, cq);
+	rdsdebug("ic %p cq %p\n", ic, cq);
 
 	rds_ib_stats_inc(s_ib_evt_handler_call);
 
@@ -506,9 +511,9 @@ void rds_dma_hdrs_free(struct dma_pool *pool, struct rds_header **hdrs,
  * This needs to be very careful to not leave IS_ERR pointers around for
  * cleanup to trip over.
  */
-static int rds_ib_setup_qp(struct rds_connection *conn)
+static int rds_ib_setup_qp(struct rds_conn_path *cp)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	struct ib_device *dev = ic->i_cm_id->device;
 	struct ib_qp_init_attr attr;
 	struct ib_cq_init_attr cq_attr = {};
@@ -532,7 +537,7 @@ static int rds_ib_setup_qp(struct rds_connection *conn)
 	fr_queue_space = (rds_ibdev->use_fastreg ? RDS_IB_DEFAULT_FR_WR : 0);
 
 	/* add the conn now so that connection establishment has the dev */
-	rds_ib_add_conn(rds_ibdev, conn);
+	rds_ib_add_conn(rds_ibdev, ic);
 
 	max_wrs = rds_ibdev->max_wrs < rds_ib_sysctl_max_send_wr + 1 ?
 		rds_ibdev->max_wrs - 1 : rds_ib_sysctl_max_send_wr;
@@ -551,7 +556,7 @@ static int rds_ib_setup_qp(struct rds_connection *conn)
 	cq_attr.cqe = ic->i_send_ring.w_nr + fr_queue_space + 1;
 	cq_attr.comp_vector = ic->i_scq_vector;
 	ic->i_send_cq = ib_create_cq(dev, rds_ib_cq_comp_handler_send,
-				     rds_ib_cq_event_handler, conn,
+				     rds_ib_cq_event_handler, ic,
 				     &cq_attr);
 	if (IS_ERR(ic->i_send_cq)) {
 		ret = PTR_ERR(ic->i_send_cq);
@@ -565,7 +570,7 @@ static int rds_ib_setup_qp(struct rds_connection *conn)
 	cq_attr.cqe = ic->i_recv_ring.w_nr;
 	cq_attr.comp_vector = ic->i_rcq_vector;
 	ic->i_recv_cq = ib_create_cq(dev, rds_ib_cq_comp_handler_recv,
-				     rds_ib_cq_event_handler, conn,
+				     rds_ib_cq_event_handler, ic,
 				     &cq_attr);
 	if (IS_ERR(ic->i_recv_cq)) {
 		ret = PTR_ERR(ic->i_recv_cq);
@@ -590,7 +595,7 @@ static int rds_ib_setup_qp(struct rds_connection *conn)
 	/* XXX negotiate max send/recv with remote? */
 	memset(&attr, 0, sizeof(attr));
 	attr.event_handler = rds_ib_qp_event_handler;
-	attr.qp_context = conn;
+	attr.qp_context = ic;
 	/* + 1 to allow for the single ack message */
 	attr.cap.max_send_wr = ic->i_send_ring.w_nr + fr_queue_space + 1;
 	attr.cap.max_recv_wr = ic->i_recv_ring.w_nr + 1;
@@ -656,7 +661,7 @@ static int rds_ib_setup_qp(struct rds_connection *conn)
 
 	rds_ib_recv_init_ack(ic);
 
-	rdsdebug("conn %p pd %p cq %p %p\n", conn, ic->i_pd,
+	rdsdebug("conn %p pd %p cq %p %p\n", cp->cp_conn, ic->i_pd,
 		 ic->i_send_cq, ic->i_recv_cq);
 
 	goto out;
@@ -689,7 +694,7 @@ static int rds_ib_setup_qp(struct rds_connection *conn)
 	ib_destroy_cq(ic->i_send_cq);
 	ic->i_send_cq = NULL;
 rds_ibdev_out:
-	rds_ib_remove_conn(rds_ibdev, conn);
+	rds_ib_remove_conn(rds_ibdev, ic);
 out:
 	rds_ib_dev_put(rds_ibdev);
 
@@ -793,6 +798,7 @@ int rds_ib_cm_handle_connect(struct rdma_cm_id *cm_id,
 	const struct rds_ib_conn_priv_cmn *dp_cmn;
 	struct rds_connection *conn = NULL;
 	struct rds_ib_connection *ic = NULL;
+	struct rds_conn_path *cp = NULL;
 	struct rdma_conn_param conn_param;
 	const union rds_ib_conn_priv *dp;
 	union rds_ib_conn_priv dp_rep;
@@ -857,6 +863,10 @@ int rds_ib_cm_handle_connect(struct rdma_cm_id *cm_id,
 		 (unsigned long long)be64_to_cpu(lguid),
 		 (unsigned long long)be64_to_cpu(fguid), dp_cmn->ricpc_dp_toss);
 
+	/* peers without multipath support always leave this zero */
+	if (dp_cmn->ricpc_dp_path >= RDS_MPATH_WORKERS)
+		goto out;
+
 	/* RDS/IB is not currently netns aware, thus init_net */
 	conn = rds_conn_create(&init_net, daddr6, saddr6,
 			       &rds_ib_transport, dp_cmn->ricpc_dp_toss,
@@ -874,58 +884,60 @@ int rds_ib_cm_handle_connect(struct rdma_cm_id *cm_id,
 	 * by both hosts, we have a random backoff mechanism -
 	 * see the comment above rds_queue_reconnect()
 	 */
-	mutex_lock(&conn->c_cm_lock);
-	if (!rds_conn_transition(conn, RDS_CONN_DOWN, RDS_CONN_CONNECTING)) {
-		if (rds_conn_state(conn) == RDS_CONN_UP) {
+	cp = &conn->c_path[dp_cmn->ricpc_dp_path];
+	mutex_lock(&cp->cp_cm_lock);
+	if (!rds_conn_path_transition(cp, RDS_CONN_DOWN, RDS_CONN_CONNECTING)) {
+		if (rds_conn_path_state(cp) == RDS_CONN_UP) {
 			rdsdebug("incoming connect while connecting\n");
-			rds_conn_drop(conn);
+			rds_conn_path_drop(cp, false);
 			rds_ib_stats_inc(s_ib_listen_closed_stale);
 		} else
-		if (rds_conn_state(conn) == RDS_CONN_CONNECTING) {
+		if (rds_conn_path_state(cp) == RDS_CONN_CONNECTING) {
 			/* Wait and see - our connect may still be succeeding */
 			rds_ib_stats_inc(s_ib_connect_raced);
 		}
 		goto out;
 	}
 
-	ic = conn->c_transport_data;
+	ic = cp->cp_transport_data;
 
 	rds_ib_set_protocol(conn, version);
-	rds_ib_set_flow_control(conn, be32_to_cpu(dp_cmn->ricpc_credit));
+	rds_ib_set_flow_control(cp, be32_to_cpu(dp_cmn->ricpc_credit));
 
 	/* If the peer gave us the last packet it saw, process this as if
 	 * we had received a regular ACK. */
 	if (dp_cmn->ricpc_ack_seq)
-		rds_send_drop_acked(conn, be64_to_cpu(dp_cmn->ricpc_ack_seq),
-				    NULL);
+		rds_send_path_drop_acked(cp,
+					 be64_to_cpu(dp_cmn->ricpc_ack_seq),
+					 NULL);
 
 	BUG_ON(cm_id->context);
 	BUG_ON(ic->i_cm_id);
 
 	ic->i_cm_id = cm_id;
-	cm_id->context = conn;
+	cm_id->context = cp;
 
 	/* We got halfway through setting up the ib_connection, if we
 	 * fail now, we have to take the long route out of this mess. */
 	destroy = 0;
 
-	err = rds_ib_setup_qp(conn);
+	err = rds_ib_setup_qp(cp);
 	if (err) {
-		rds_ib_conn_error(conn, "rds_ib_setup_qp failed (%d)\n", err);
+		rds_ib_conn_error(cp, "rds_ib_setup_qp failed (%d)\n", err);
 		goto out;
 	}
 
-	rds_ib_cm_fill_conn_param(conn, &conn_param, &dp_rep, version,
+	rds_ib_cm_fill_conn_param(cp, &conn_param, &dp_rep, version,
 				  event->param.conn.responder_resources,
 				  event->param.conn.initiator_depth, isv6);
 
 	/* rdma_accept() calls rdma_reject() internally if it fails */
 	if (rdma_accept(cm_id, &conn_param))
-		rds_ib_conn_error(conn, "rdma_accept failed\n");
+		rds_ib_conn_error(cp, "rdma_accept failed\n");
 
 out:
-	if (conn)
-		mutex_unlock(&conn->c_cm_lock);
+	if (cp)
+		mutex_unlock(&cp->cp_cm_lock);
 	if (err)
 		rdma_reject(cm_id, &err, sizeof(int));
 	return destroy;
@@ -934,8 +946,9 @@ int rds_ib_cm_handle_connect(struct rdma_cm_id *cm_id,
 
 int rds_ib_cm_initiate_connect(struct rdma_cm_id *cm_id, bool isv6)
 {
-	struct rds_connection *conn = cm_id->context;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_conn_path *cp = cm_id->context;
+	struct rds_connection *conn = cp->cp_conn;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	struct rdma_conn_param conn_param;
 	union rds_ib_conn_priv dp;
 	int ret;
@@ -945,18 +958,18 @@ int rds_ib_cm_initiate_connect(struct rdma_cm_id *cm_id, bool isv6)
 	rds_ib_set_protocol(conn, RDS_PROTOCOL_4_1);
 	ic->i_flowctl = rds_ib_sysctl_flow_control;	/* advertise flow control */
 
-	ret = rds_ib_setup_qp(conn);
+	ret = rds_ib_setup_qp(cp);
 	if (ret) {
-		rds_ib_conn_error(conn, "rds_ib_setup_qp failed (%d)\n", ret);
+		rds_ib_conn_error(cp, "rds_ib_setup_qp failed (%d)\n", ret);
 		goto out;
 	}
 
-	rds_ib_cm_fill_conn_param(conn, &conn_param, &dp,
+	rds_ib_cm_fill_conn_param(cp, &conn_param, &dp,
 				  conn->c_proposed_version,
 				  UINT_MAX, UINT_MAX, isv6);
 	ret = rdma_connect(cm_id, &conn_param);
 	if (ret)
-		rds_ib_conn_error(conn, "rdma_connect failed (%d)\n", ret);
+		rds_ib_conn_error(cp, "rdma_connect failed (%d)\n", ret);
 
 out:
 	/* Beware - returning non-zero tells the rdma_cm to destroy
@@ -978,7 +991,13 @@ int rds_ib_conn_path_connect(struct rds_conn_path *cp)
 	struct rds_ib_connection *ic;
 	int ret;
 
-	ic = conn->c_transport_data;
+	/* for multipath rds, we only trigger the connection after
+	 * the handshake probe has determined the number of paths.
+	 */
+	if (cp->cp_index > 0 && conn->c_npaths < 2)
+		return -EAGAIN;
+
+	ic = cp->cp_transport_data;
 
 	/* XXX I wonder what affect the port space has */
 	/* delegate cm event handler to rdma_transport */
@@ -988,7 +1007,7 @@ int rds_ib_conn_path_connect(struct rds_conn_path *cp)
 	else
 #endif
 		handler = rds_rdma_cm_event_handler;
-	ic->i_cm_id = rdma_create_id(&init_net, handler, conn,
+	ic->i_cm_id = rdma_create_id(&init_net, handler, cp,
 				     RDMA_PS_TCP, IB_QPT_RC);
 	if (IS_ERR(ic->i_cm_id)) {
 		ret = PTR_ERR(ic->i_cm_id);
@@ -1048,8 +1067,7 @@ int rds_ib_conn_path_connect(struct rds_conn_path *cp)
  */
 void rds_ib_conn_path_shutdown(struct rds_conn_path *cp)
 {
-	struct rds_connection *conn = cp->cp_conn;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	int err = 0;
 
 	rdsdebug("cm %p pd %p cq %p %p qp %p\n", ic->i_cm_id,
@@ -1151,7 +1169,7 @@ void rds_ib_conn_path_shutdown(struct rds_conn_path *cp)
 		 * Move connection back to the nodev list.
 		 */
 		if (ic->rds_ibdev)
-			rds_ib_remove_conn(ic->rds_ibdev, conn);
+			rds_ib_remove_conn(ic->rds_ibdev, ic);
 
 		ic->i_cm_id = NULL;
 		ic->i_pd = NULL;
@@ -1198,7 +1216,7 @@ void rds_ib_conn_path_shutdown(struct rds_conn_path *cp)
 	ic->i_active_side = false;
 }
 
-int rds_ib_conn_alloc(struct rds_connection *conn, gfp_t gfp)
+static int rds_ib_conn_path_alloc(struct rds_conn_path *cp, gfp_t gfp)
 {
 	struct rds_ib_connection *ic;
 	unsigned long flags;
@@ -1234,18 +1252,41 @@ int rds_ib_conn_alloc(struct rds_connection *conn, gfp_t gfp)
 	rds_ib_ring_init(&ic->i_send_ring, 0);
 	rds_ib_ring_init(&ic->i_recv_ring, 0);
 
-	ic->conn = conn;
-	conn->c_transport_data = ic;
+	ic->conn = cp->cp_conn;
+	ic->i_cpath = cp;
+	cp->cp_transport_data = ic;
 
 	spin_lock_irqsave(&ib_nodev_conns_lock, flags);
 	list_add_tail(&ic->ib_node, &ib_nodev_conns);
 	spin_unlock_irqrestore(&ib_nodev_conns_lock, flags);
 
 
-	rdsdebug("conn %p conn ic %p\n", conn, conn->c_transport_data);
+	rdsdebug("conn %p path %u ic %p\n", cp->cp_conn, cp->cp_index, ic);
 	return 0;
 }
 
+/* Each path gets its own QP, rings and completion vectors, so sends
+ * hashed onto different paths do not contend with each other.
+ */
+int rds_ib_conn_alloc(struct rds_connection *conn, gfp_t gfp)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < RDS_MPATH_WORKERS; i++) {
+		ret = rds_ib_conn_path_alloc(&conn->c_path[i], gfp);
+		if (ret)
+			break;
+	}
+	if (ret) {
+		while (--i >= 0) {
+			rds_ib_conn_free(conn->c_path[i].cp_transport_data);
+			conn->c_path[i].cp_transport_data = NULL;
+		}
+	}
+	return ret;
+}
+
 /*
  * Free a connection. Connection must be shut down and not set for reconnect.
  */
@@ -1277,11 +1318,11 @@ void rds_ib_conn_free(void *arg)
  * An error occurred on the connection
  */
 void
-__rds_ib_conn_error(struct rds_connection *conn, const char *fmt, ...)
+__rds_ib_conn_error(struct rds_conn_path *cp, const char *fmt, ...)
 {
 	va_list ap;
 
-	rds_conn_drop(conn);
+	rds_conn_path_drop(cp, false);
 
 	va_start(ap, fmt);
 	vprintk(fmt, ap);
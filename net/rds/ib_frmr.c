@@ -326,8 +326,8 @@ void rds_ib_mr_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc)
 
 	if (wc->status != IB_WC_SUCCESS) {
 		rds_transition_frwr_state(ibmr, FRMR_IS_INUSE, FRMR_IS_STALE);
-		if (rds_conn_up(ic->conn))
-			rds_ib_conn_error(ic->conn,
+		if (rds_conn_path_up(ic->i_cpath))
+			rds_ib_conn_error(ic->i_cpath,
 					  "frmr completion <%pI4,%pI4> status %u(%s), vendor_err 0x%x, disconnecting and reconnecting\n",
 					  &ic->conn->c_laddr,
 					  &ic->conn->c_faddr,
@@ -35,7 +35,6 @@
 #include <linux/rculist.h>
 #include <linux/llist.h>
 
-#include "rds_single_path.h"
 #include "ib_mr.h"
 #include "rds.h"
 
@@ -123,10 +122,9 @@ int rds_ib_update_ipaddr(struct rds_ib_device *rds_ibdev,
 	return 0;
 }
 
-void rds_ib_add_conn(struct rds_ib_device *rds_ibdev, struct rds_connection *conn)
+void rds_ib_add_conn(struct rds_ib_device *rds_ibdev,
+		     struct rds_ib_connection *ic)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
-
 	/* conn was previously on the nodev_conns_list */
 	spin_lock_irq(&ib_nodev_conns_lock);
 	BUG_ON(list_empty(&ib_nodev_conns));
@@ -142,10 +140,9 @@ void rds_ib_add_conn(struct rds_ib_device *rds_ibdev, struct rds_connection *con
 	refcount_inc(&rds_ibdev->refcount);
 }
 
-void rds_ib_remove_conn(struct rds_ib_device *rds_ibdev, struct rds_connection *conn)
+void rds_ib_remove_conn(struct rds_ib_device *rds_ibdev,
+			struct rds_ib_connection *ic)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
-
 	/* place conn on nodev_conns_list */
 	spin_lock(&ib_nodev_conns_lock);
 
@@ -167,9 +164,14 @@ void rds_ib_destroy_nodev_conns(void)
 	struct rds_ib_connection *ic, *_ic;
 	LIST_HEAD(tmp_list);
 
-	/* avoid calling conn_destroy with irqs off */
+	/* avoid calling conn_destroy with irqs off; a connection is
+	 * destroyed once, through the entry of its first path
+	 */
 	spin_lock_irq(&ib_nodev_conns_lock);
-	list_splice(&ib_nodev_conns, &tmp_list);
+	list_for_each_entry_safe(ic, _ic, &ib_nodev_conns, ib_node) {
+		if (!ic->i_cpath->cp_index)
+			list_move_tail(&ic->ib_node, &tmp_list);
+	}
 	spin_unlock_irq(&ib_nodev_conns_lock);
 
 	list_for_each_entry_safe(ic, _ic, &tmp_list, ib_node)
@@ -614,8 +616,9 @@ void *rds_ib_get_mr(struct scatterlist *sg, unsigned long nents,
 		return ibmr;
 	}
 
+	/* all paths share the device; register through the first */
 	if (conn)
-		ic = conn->c_transport_data;
+		ic = conn->c_path[0].cp_transport_data;
 
 	if (!rds_ibdev->mr_8k_pool || !rds_ibdev->mr_1m_pool) {
 		ret = -ENODEV;
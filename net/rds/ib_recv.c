@@ -36,7 +36,6 @@
 #include <linux/dma-mapping.h>
 #include <rdma/rdma_cm.h>
 
-#include "rds_single_path.h"
 #include "rds.h"
 #include "ib.h"
 
@@ -205,7 +204,7 @@ void rds_ib_inc_free(struct rds_incoming *inc)
 	struct rds_ib_incoming *ibinc;
 	struct rds_page_frag *frag;
 	struct rds_page_frag *pos;
-	struct rds_ib_connection *ic = inc->i_conn->c_transport_data;
+	struct rds_ib_connection *ic = inc->i_conn_path->cp_transport_data;
 
 	ibinc = container_of(inc, struct rds_ib_incoming, ii_inc);
 
@@ -267,7 +266,7 @@ static struct rds_ib_incoming *rds_ib_refill_one_inc(struct rds_ib_connection *i
 		rds_ib_stats_inc(s_ib_rx_total_incs);
 	}
 	INIT_LIST_HEAD(&ibinc->ii_frags);
-	rds_inc_init(&ibinc->ii_inc, ic->conn, &ic->conn->c_faddr);
+	rds_inc_path_init(&ibinc->ii_inc, ic->i_cpath, &ic->conn->c_faddr);
 
 	return ibinc;
 }
@@ -304,10 +303,9 @@ static struct rds_page_frag *rds_ib_refill_one_frag(struct rds_ib_connection *ic
 	return frag;
 }
 
-static int rds_ib_recv_refill_one(struct rds_connection *conn,
+static int rds_ib_recv_refill_one(struct rds_ib_connection *ic,
 				  struct rds_ib_recv_work *recv, gfp_t gfp)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
 	struct ib_sge *sge;
 	int ret = -ENOMEM;
 	gfp_t slab_mask = GFP_NOWAIT;
@@ -355,22 +353,22 @@ static int rds_ib_recv_refill_one(struct rds_connection *conn,
 	return ret;
 }
 
-static int acquire_refill(struct rds_connection *conn)
+static int acquire_refill(struct rds_conn_path *cp)
 {
-	return test_and_set_bit(RDS_RECV_REFILL, &conn->c_flags) == 0;
+	return test_and_set_bit(RDS_RECV_REFILL, &cp->cp_flags) == 0;
 }
 
-static void release_refill(struct rds_connection *conn)
+static void release_refill(struct rds_conn_path *cp)
 {
-	clear_bit(RDS_RECV_REFILL, &conn->c_flags);
+	clear_bit(RDS_RECV_REFILL, &cp->cp_flags);
 
 	/* We don't use wait_on_bit()/wake_up_bit() because our waking is in a
 	 * hot path and finding waiters is very rare.  We don't want to walk
 	 * the system-wide hashed waitqueue buckets in the fast path only to
 	 * almost never find waiters.
 	 */
-	if (waitqueue_active(&conn->c_waitq))
-		wake_up_all(&conn->c_waitq);
+	if (waitqueue_active(&cp->cp_waitq))
+		wake_up_all(&cp->cp_waitq);
 }
 
 /*
@@ -378,9 +376,10 @@ static void release_refill(struct rds_connection *conn)
  * they have all the allocations they need to queue received fragments into
  * sockets.
  */
-void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
+void rds_ib_recv_refill(struct rds_conn_path *cp, int prefill, gfp_t gfp)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_connection *conn = cp->cp_conn;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	struct rds_ib_recv_work *recv;
 	unsigned int posted = 0;
 	int ret = 0;
@@ -392,10 +391,10 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 	 * is posting buffers.  If we can't get the refill lock,
 	 * let them do their thing
 	 */
-	if (!acquire_refill(conn))
+	if (!acquire_refill(cp))
 		return;
 
-	while ((prefill || rds_conn_up(conn)) &&
+	while ((prefill || rds_conn_path_up(cp)) &&
 	       rds_ib_ring_alloc(&ic->i_recv_ring, 1, &pos)) {
 		if (pos >= ic->i_recv_ring.w_nr) {
 			printk(KERN_NOTICE "Argh - ring alloc returned pos=%u\n",
@@ -404,7 +403,7 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 		}
 
 		recv = &ic->i_recvs[pos];
-		ret = rds_ib_recv_refill_one(conn, recv, gfp);
+		ret = rds_ib_recv_refill_one(ic, recv, gfp);
 		if (ret) {
 			must_wake = true;
 			break;
@@ -417,7 +416,7 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 		/* XXX when can this fail? */
 		ret = ib_post_recv(ic->i_cm_id->qp, &recv->r_wr, NULL);
 		if (ret) {
-			rds_ib_conn_error(conn, "recv post on "
+			rds_ib_conn_error(cp, "recv post on "
 			       "%pI6c returned %d, disconnecting and "
 			       "reconnecting\n", &conn->c_faddr,
 			       ret);
@@ -434,12 +433,12 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 
 	/* We're doing flow control - update the window. */
 	if (ic->i_flowctl && posted)
-		rds_ib_advertise_credits(conn, posted);
+		rds_ib_advertise_credits(cp, posted);
 
 	if (ret)
 		rds_ib_ring_unalloc(&ic->i_recv_ring, 1);
 
-	release_refill(conn);
+	release_refill(cp);
 
 	/* if we're called from the softirq handler, we'll be GFP_NOWAIT.
 	 * in this case the ring being low is going to lead to more interrupts
@@ -451,11 +450,11 @@ void rds_ib_recv_refill(struct rds_connection *conn, int prefill, gfp_t gfp)
 	 * lock held.  Use rds_ib_ring_low() instead of ring_empty to decide
 	 * if we should requeue.
 	 */
-	if (rds_conn_up(conn) &&
+	if (rds_conn_path_up(cp) &&
 	    (must_wake ||
 	    (can_wait && rds_ib_ring_low(&ic->i_recv_ring)) ||
 	    rds_ib_ring_empty(&ic->i_recv_ring))) {
-		queue_delayed_work(rds_wq, &conn->c_recv_w, 1);
+		queue_delayed_work(rds_wq, &cp->cp_recv_w, 1);
 	}
 	if (can_wait)
 		cond_resched();
@@ -678,7 +677,7 @@ static void rds_ib_send_ack(struct rds_ib_connection *ic, unsigned int adv_credi
 
 		rds_ib_stats_inc(s_ib_ack_send_failure);
 
-		rds_ib_conn_error(ic->conn, "sending ack failed\n");
+		rds_ib_conn_error(ic->i_cpath, "sending ack failed\n");
 	} else
 		rds_ib_stats_inc(s_ib_ack_sent);
 }
@@ -838,11 +837,12 @@ static void rds_ib_cong_recv(struct rds_connection *conn,
 	rds_cong_map_updated(map, le64_to_cpu(uncongested));
 }
 
-static void rds_ib_process_recv(struct rds_connection *conn,
+static void rds_ib_process_recv(struct rds_conn_path *cp,
 				struct rds_ib_recv_work *recv, u32 data_len,
 				struct rds_ib_ack_state *state)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_connection *conn = cp->cp_conn;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	struct rds_ib_incoming *ibinc = ic->i_ibinc;
 	struct rds_header *ihdr, *hdr;
 
@@ -852,7 +852,7 @@ static void rds_ib_process_recv(struct rds_connection *conn,
 		 data_len);
 
 	if (data_len < sizeof(struct rds_header)) {
-		rds_ib_conn_error(conn, "incoming message "
+		rds_ib_conn_error(cp, "incoming message "
 		       "from %pI6c didn't include a "
 		       "header, disconnecting and "
 		       "reconnecting\n",
@@ -865,7 +865,7 @@ static void rds_ib_process_recv(struct rds_connection *conn,
 
 	/* Validate the checksum. */
 	if (!rds_message_verify_checksum(ihdr)) {
-		rds_ib_conn_error(conn, "incoming message "
+		rds_ib_conn_error(cp, "incoming message "
 		       "from %pI6c has corrupted header - "
 		       "forcing a reconnect\n",
 		       &conn->c_faddr);
@@ -879,7 +879,7 @@ static void rds_ib_process_recv(struct rds_connection *conn,
 
 	/* Process the credits update if there was one */
 	if (ihdr->h_credit)
-		rds_ib_send_add_credits(conn, ihdr->h_credit);
+		rds_ib_send_add_credits(cp, ihdr->h_credit);
 
 	if (ihdr->h_sport == 0 && ihdr->h_dport == 0 && data_len == 0) {
 		/* This is an ACK-only packet. The fact that it gets
@@ -931,7 +931,7 @@ static void rds_ib_process_recv(struct rds_connection *conn,
 		    hdr->h_len != ihdr->h_len ||
 		    hdr->h_sport != ihdr->h_sport ||
 		    hdr->h_dport != ihdr->h_dport) {
-			rds_ib_conn_error(conn,
+			rds_ib_conn_error(cp,
 				"fragment header mismatch; forcing reconnect\n");
 			return;
 		}
@@ -972,6 +972,7 @@ void rds_ib_recv_cqe_handler(struct rds_ib_connection *ic,
 			     struct rds_ib_ack_state *state)
 {
 	struct rds_connection *conn = ic->conn;
+	struct rds_conn_path *cp = ic->i_cpath;
 	struct rds_ib_recv_work *recv;
 
 	rdsdebug("wc wr_id 0x%llx status %u (%s) byte_len %u imm_data %u\n",
@@ -989,11 +990,11 @@ void rds_ib_recv_cqe_handler(struct rds_ib_connection *ic,
 	 * event is processed.
 	 */
 	if (wc->status == IB_WC_SUCCESS) {
-		rds_ib_process_recv(conn, recv, wc->byte_len, state);
+		rds_ib_process_recv(cp, recv, wc->byte_len, state);
 	} else {
 		/* We expect errors as the qp is drained during shutdown */
-		if (rds_conn_up(conn) || rds_conn_connecting(conn))
-			rds_ib_conn_error(conn, "recv completion on <%pI6c,%pI6c, %d> had status %u (%s), vendor err 0x%x, disconnecting and reconnecting\n",
+		if (rds_conn_path_up(cp) || rds_conn_path_connecting(cp))
+			rds_ib_conn_error(cp, "recv completion on <%pI6c,%pI6c, %d> had status %u (%s), vendor err 0x%x, disconnecting and reconnecting\n",
 					  &conn->c_laddr, &conn->c_faddr,
 					  conn->c_tos, wc->status,
 					  ib_wc_status_msg(wc->status),
@@ -1020,7 +1021,7 @@ void rds_ib_recv_cqe_handler(struct rds_ib_connection *ic,
 		rds_ib_stats_inc(s_ib_rx_ring_empty);
 
 	if (rds_ib_ring_low(&ic->i_recv_ring)) {
-		rds_ib_recv_refill(conn, 0, GFP_NOWAIT);
+		rds_ib_recv_refill(cp, 0, GFP_NOWAIT);
 		rds_ib_stats_inc(s_ib_rx_refill_from_cq);
 	}
 }
@@ -1028,12 +1029,12 @@ void rds_ib_recv_cqe_handler(struct rds_ib_connection *ic,
 int rds_ib_recv_path(struct rds_conn_path *cp)
 {
 	struct rds_connection *conn = cp->cp_conn;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	rdsdebug("conn %p\n", conn);
-	if (rds_conn_up(conn)) {
+	if (rds_conn_path_up(cp)) {
 		rds_ib_attempt_ack(ic);
-		rds_ib_recv_refill(conn, 0, GFP_KERNEL);
+		rds_ib_recv_refill(cp, 0, GFP_KERNEL);
 		rds_ib_stats_inc(s_ib_rx_refill_from_thread);
 	}
 
@@ -36,7 +36,6 @@
 #include <linux/dmapool.h>
 #include <linux/ratelimit.h>
 
-#include "rds_single_path.h"
 #include "rds.h"
 #include "ib.h"
 #include "ib_mr.h"
@@ -244,6 +243,7 @@ void rds_ib_send_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc)
 {
 	struct rds_message *rm = NULL;
 	struct rds_connection *conn = ic->conn;
+	struct rds_conn_path *cp = ic->i_cpath;
 	struct rds_ib_send_work *send;
 	u32 completed;
 	u32 oldest;
@@ -296,13 +296,13 @@ void rds_ib_send_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc)
 	rds_ib_sub_signaled(ic, nr_sig);
 	nr_sig = 0;
 
-	if (test_and_clear_bit(RDS_LL_SEND_FULL, &conn->c_flags) ||
+	if (test_and_clear_bit(RDS_LL_SEND_FULL, &cp->cp_flags) ||
 	    test_bit(0, &conn->c_map_queued))
-		queue_delayed_work(rds_wq, &conn->c_send_w, 0);
+		queue_delayed_work(rds_wq, &cp->cp_send_w, 0);
 
 	/* We expect errors as the qp is drained during shutdown */
-	if (wc->status != IB_WC_SUCCESS && rds_conn_up(conn)) {
-		rds_ib_conn_error(conn, "send completion on <%pI6c,%pI6c,%d> had status %u (%s), vendor err 0x%x, disconnecting and reconnecting\n",
+	if (wc->status != IB_WC_SUCCESS && rds_conn_path_up(cp)) {
+		rds_ib_conn_error(cp, "send completion on <%pI6c,%pI6c,%d> had status %u (%s), vendor err 0x%x, disconnecting and reconnecting\n",
 				  &conn->c_laddr, &conn->c_faddr,
 				  conn->c_tos, wc->status,
 				  ib_wc_status_msg(wc->status), wc->vendor_err);
@@ -377,10 +377,8 @@ int rds_ib_send_grab_credits(struct rds_ib_connection *ic,
 		avail--;
 
 	if (avail < wanted) {
-		struct rds_connection *conn = ic->i_cm_id->context;
-
 		/* Oops, there aren't that many credits left! */
-		set_bit(RDS_LL_SEND_FULL, &conn->c_flags);
+		set_bit(RDS_LL_SEND_FULL, &ic->i_cpath->cp_flags);
 		got = avail;
 	} else {
 		/* Sometimes you get what you want, lalala. */
@@ -406,9 +404,9 @@ int rds_ib_send_grab_credits(struct rds_ib_connection *ic,
 	return got;
 }
 
-void rds_ib_send_add_credits(struct rds_connection *conn, unsigned int credits)
+void rds_ib_send_add_credits(struct rds_conn_path *cp, unsigned int credits)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	if (credits == 0)
 		return;
@@ -416,20 +414,20 @@ void rds_ib_send_add_credits(struct rds_connection *conn, unsigned int credits)
 	rdsdebug("credits=%u current=%u%s\n",
 			credits,
 			IB_GET_SEND_CREDITS(atomic_read(&ic->i_credits)),
-			test_bit(RDS_LL_SEND_FULL, &conn->c_flags) ? ", ll_send_full" : "");
+			test_bit(RDS_LL_SEND_FULL, &cp->cp_flags) ? ", ll_send_full" : "");
 
 	atomic_add(IB_SET_SEND_CREDITS(credits), &ic->i_credits);
-	if (test_and_clear_bit(RDS_LL_SEND_FULL, &conn->c_flags))
-		queue_delayed_work(rds_wq, &conn->c_send_w, 0);
+	if (test_and_clear_bit(RDS_LL_SEND_FULL, &cp->cp_flags))
+		queue_delayed_work(rds_wq, &cp->cp_send_w, 0);
 
 	WARN_ON(IB_GET_SEND_CREDITS(credits) >= 16384);
 
 	rds_ib_stats_inc(s_ib_rx_credit_updates);
 }
 
-void rds_ib_advertise_credits(struct rds_connection *conn, unsigned int posted)
+void rds_ib_advertise_credits(struct rds_conn_path *cp, unsigned int posted)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	if (posted == 0)
 		return;
@@ -485,7 +483,8 @@ static inline int rds_ib_set_wr_signal_state(struct rds_ib_connection *ic,
 int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 		unsigned int hdr_off, unsigned int sg, unsigned int off)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_conn_path *cp = rm->m_inc.i_conn_path;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 	struct ib_device *dev = ic->i_cm_id->device;
 	struct rds_ib_send_work *send = NULL;
 	struct rds_ib_send_work *first;
@@ -524,7 +523,7 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 
 	work_alloc = rds_ib_ring_alloc(&ic->i_send_ring, i, &pos);
 	if (work_alloc == 0) {
-		set_bit(RDS_LL_SEND_FULL, &conn->c_flags);
+		set_bit(RDS_LL_SEND_FULL, &cp->cp_flags);
 		rds_ib_stats_inc(s_ib_tx_ring_full);
 		ret = -ENOMEM;
 		goto out;
@@ -539,7 +538,7 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 			flow_controlled = 1;
 		}
 		if (work_alloc == 0) {
-			set_bit(RDS_LL_SEND_FULL, &conn->c_flags);
+			set_bit(RDS_LL_SEND_FULL, &cp->cp_flags);
 			rds_ib_stats_inc(s_ib_tx_throttle);
 			ret = -ENOMEM;
 			goto out;
@@ -720,7 +719,7 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 		work_alloc = i;
 	}
 	if (ic->i_flowctl && i < credit_alloc)
-		rds_ib_send_add_credits(conn, credit_alloc - i);
+		rds_ib_send_add_credits(cp, credit_alloc - i);
 
 	if (nr_sig)
 		atomic_add(nr_sig, &ic->i_signaled_sends);
@@ -741,7 +740,7 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 			prev->s_op = NULL;
 		}
 
-		rds_ib_conn_error(ic->conn, "ib_post_send failed\n");
+		rds_ib_conn_error(cp, "ib_post_send failed\n");
 		goto out;
 	}
 
@@ -758,7 +757,8 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
  */
 int rds_ib_xmit_atomic(struct rds_connection *conn, struct rm_atomic_op *op)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_message *rm = container_of(op, struct rds_message, atomic);
+	struct rds_ib_connection *ic = rm->m_inc.i_conn_path->cp_transport_data;
 	struct rds_ib_send_work *send = NULL;
 	const struct ib_send_wr *failed_wr;
 	u32 pos;
@@ -844,7 +844,8 @@ int rds_ib_xmit_atomic(struct rds_connection *conn, struct rm_atomic_op *op)
 
 int rds_ib_xmit_rdma(struct rds_connection *conn, struct rm_rdma_op *op)
 {
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_message *rm = container_of(op, struct rds_message, rdma);
+	struct rds_ib_connection *ic = rm->m_inc.i_conn_path->cp_transport_data;
 	struct rds_ib_send_work *send = NULL;
 	struct rds_ib_send_work *first;
 	struct rds_ib_send_work *prev;
@@ -1001,8 +1002,7 @@ int rds_ib_xmit_rdma(struct rds_connection *conn, struct rm_rdma_op *op)
 
 void rds_ib_xmit_path_complete(struct rds_conn_path *cp)
 {
-	struct rds_connection *conn = cp->cp_conn;
-	struct rds_ib_connection *ic = conn->c_transport_data;
+	struct rds_ib_connection *ic = cp->cp_transport_data;
 
 	/* We may have a pending ACK or window update we were unable
 	 * to send previously (due to flow control). Try again. */
@@ -33,7 +33,6 @@
 #include <linux/module.h>
 #include <rdma/rdma_cm.h>
 
-#include "rds_single_path.h"
 #include "rdma_transport.h"
 #include "ib.h"
 
@@ -51,7 +50,8 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 					 bool isv6)
 {
 	/* this can be null in the listening path */
-	struct rds_connection *conn = cm_id->context;
+	struct rds_conn_path *cp = cm_id->context;
+	struct rds_connection *conn = cp ? cp->cp_conn : NULL;
 	struct rds_transport *trans;
 	int ret = 0;
 	int *err;
@@ -65,13 +65,13 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 
 	/* Prevent shutdown from tearing down the connection
 	 * while we're executing. */
-	if (conn) {
-		mutex_lock(&conn->c_cm_lock);
+	if (cp) {
+		mutex_lock(&cp->cp_cm_lock);
 
 		/* If the connection is being shut down, bail out
 		 * right away. We return 0 so cm_id doesn't get
 		 * destroyed prematurely */
-		if (rds_conn_state(conn) == RDS_CONN_DISCONNECTING) {
+		if (rds_conn_path_state(cp) == RDS_CONN_DISCONNECTING) {
 			/* Reject incoming connections while we're tearing
 			 * down an existing one. */
 			if (event->event == RDMA_CM_EVENT_CONNECT_REQUEST)
@@ -99,20 +99,20 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 		if (conn) {
 			struct rds_ib_connection *ibic;
 
-			ibic = conn->c_transport_data;
+			ibic = cp->cp_transport_data;
 			if (ibic && ibic->i_cm_id == cm_id) {
 				cm_id->route.path_rec[0].sl =
 					TOS_TO_SL(conn->c_tos);
 				ret = trans->cm_initiate_connect(cm_id, isv6);
 			} else {
-				rds_conn_drop(conn);
+				rds_conn_path_drop(cp, false);
 			}
 		}
 		break;
 
 	case RDMA_CM_EVENT_ESTABLISHED:
 		if (conn)
-			trans->cm_connect_complete(conn, event);
+			trans->cm_connect_complete(cp, event);
 		break;
 
 	case RDMA_CM_EVENT_REJECTED:
@@ -128,7 +128,7 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 			if (!conn->c_tos)
 				conn->c_proposed_version = RDS_PROTOCOL_COMPAT_VERSION;
 
-			rds_conn_drop(conn);
+			rds_conn_path_drop(cp, false);
 		}
 		rdsdebug("Connection rejected: %s\n",
 			 rdma_reject_msg(cm_id, event->status));
@@ -140,7 +140,7 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 	case RDMA_CM_EVENT_DEVICE_REMOVAL:
 	case RDMA_CM_EVENT_ADDR_CHANGE:
 		if (conn)
-			rds_conn_drop(conn);
+			rds_conn_path_drop(cp, false);
 		break;
 
 	case RDMA_CM_EVENT_DISCONNECTED:
@@ -149,14 +149,14 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 		rdsdebug("DISCONNECT event - dropping connection "
 			 "%pI6c->%pI6c\n", &conn->c_laddr,
 			 &conn->c_faddr);
-		rds_conn_drop(conn);
+		rds_conn_path_drop(cp, false);
 		break;
 
 	case RDMA_CM_EVENT_TIMEWAIT_EXIT:
 		if (conn) {
 			pr_info("RDS: RDMA_CM_EVENT_TIMEWAIT_EXIT event: dropping connection %pI6c->%pI6c\n",
 				&conn->c_laddr, &conn->c_faddr);
-			rds_conn_drop(conn);
+			rds_conn_path_drop(cp, false);
 		}
 		break;
 
@@ -168,8 +168,8 @@ static int rds_rdma_cm_event_handler_cmn(struct rdma_cm_id *cm_id,
 	}
 
 out:
-	if (conn)
-		mutex_unlock(&conn->c_cm_lock);
+	if (cp)
+		mutex_unlock(&cp->cp_cm_lock);
 
 	rdsdebug("id %p event %u (%s) handling ret %d\n", cm_id, event->event,
 		 rdma_event_msg(event->event), ret);
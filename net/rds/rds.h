@@ -567,7 +567,7 @@ struct rds_transport {
 	int (*cm_handle_connect)(struct rdma_cm_id *cm_id,
 				 struct rdma_cm_event *event, bool isv6);
 	int (*cm_initiate_connect)(struct rdma_cm_id *cm_id, bool isv6);
-	void (*cm_connect_complete)(struct rds_connection *conn,
+	void (*cm_connect_complete)(struct rds_conn_path *cp,
 				    struct rdma_cm_event *event);
 
 	unsigned int (*stats_info_copy)(struct rds_info_iterator *iter,
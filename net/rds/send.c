@@ -1455,8 +1455,12 @@ rds_send_probe(struct rds_conn_path *cp, __be16 sport,
 	rm->m_inc.i_hdr.h_flags |= h_flags;
 	cp->cp_next_tx_seq++;
 
+	/* looped back IB conns cannot bring up the extra paths, as
+	 * neither side has the smaller address; keep them single path
+	 */
 	if (RDS_HS_PROBE(be16_to_cpu(sport), be16_to_cpu(dport)) &&
-	    cp->cp_conn->c_trans->t_mp_capable) {
+	    cp->cp_conn->c_trans->t_mp_capable &&
+	    !cp->cp_conn->c_loopback) {
 		u16 npaths = cpu_to_be16(RDS_MPATH_WORKERS);
 		u32 my_gen_num = cpu_to_be32(cp->cp_conn->c_my_gen_num);
 
@@ -237,6 +237,7 @@ static struct sock *smc_sock_alloc(struct net *net, struct socket *sock,
 	INIT_LIST_HEAD(&smc->accept_q);
 	spin_lock_init(&smc->accept_q_lock);
 	spin_lock_init(&smc->conn.send_lock);
+	atomic_set(&smc->conn.cdc_pend_tx_wr, 0);
 	sk->sk_prot->hash(sk);
 	sk_refcnt_debug_inc(sk);
 	mutex_init(&smc->clcsock_release_lock);
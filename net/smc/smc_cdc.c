@@ -48,6 +48,19 @@ static void smc_cdc_tx_handler(struct smc_wr_tx_pend_priv *pnd_snd,
 		smp_mb__after_atomic();
 		smc_curs_copy(&conn->tx_curs_fin, &cdcpend->cursor, conn);
 	}
+
+	/* last outstanding CDC completed: push data held back by autocork.
+	 * atomic_dec_and_test() is a full barrier, ordering the decrement
+	 * before reading tx_curs_prep; paired with smp_mb() in
+	 * smc_tx_should_autocork()
+	 */
+	if (atomic_dec_and_test(&conn->cdc_pend_tx_wr) &&
+	    smc_tx_prepared_sends(conn)) {
+		if (sock_owned_by_user(&smc->sk))
+			mod_delayed_work(system_wq, &conn->tx_work, 0);
+		else
+			smc_tx_sndbuf_nonempty(conn);
+	}
 	smc_tx_sndbuf_nonfull(smc);
 	bh_unlock_sock(&smc->sk);
 }
@@ -102,10 +115,14 @@ int smc_cdc_msg_send(struct smc_connection *conn,
 	conn->tx_cdc_seq++;
 	conn->local_tx_ctrl.seqno = conn->tx_cdc_seq;
 	smc_host_msg_to_cdc((struct smc_cdc_msg *)wr_buf, conn, &cfed);
+	atomic_inc(&conn->cdc_pend_tx_wr);
+	smp_mb__after_atomic(); /* make the increment visible to sendmsg */
 	rc = smc_wr_tx_send(link, (struct smc_wr_tx_pend_priv *)pend);
 	if (!rc) {
 		smc_curs_copy(&conn->rx_curs_confirmed, &cfed, conn);
 		conn->local_rx_ctrl.prod_flags.cons_curs_upd_req = 0;
+	} else {
+		atomic_dec(&conn->cdc_pend_tx_wr);
 	}
 
 	return rc;
@@ -160,6 +177,8 @@ static void smc_cdc_tx_dismisser(struct smc_wr_tx_pend_priv *tx_pend)
 	struct smc_cdc_tx_pend *cdc_pend =
 		(struct smc_cdc_tx_pend *)tx_pend;
 
+	/* the tx handler skips dismissed slots, don't leave them counted */
+	atomic_dec(&cdc_pend->conn->cdc_pend_tx_wr);
 	cdc_pend->conn = NULL;
 }
 
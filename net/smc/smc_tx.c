@@ -30,6 +30,7 @@
 
 #define SMC_TX_WORK_DELAY	0
 #define SMC_TX_CORK_DELAY	(HZ >> 2)	/* 250 ms */
+#define SMC_TX_AUTOCORK_SIZE	(64 * 1024)
 
 /***************************** sndbuf producer *******************************/
 
@@ -128,6 +129,28 @@ static bool smc_tx_is_corked(struct smc_sock *smc)
 	return (tp->nonagle & TCP_NAGLE_CORK) ? true : false;
 }
 
+/* While CDC messages of this connection are still in flight, hold back
+ * small amounts of new data; the completion of the last outstanding CDC
+ * pushes everything prepared so far in one RDMA write.
+ */
+static bool smc_tx_should_autocork(struct smc_connection *conn)
+{
+	int corking_size;
+
+	if (conn->lgr->is_smcd || conn->urg_tx_pend)
+		return false;
+	corking_size = min_t(int, SMC_TX_AUTOCORK_SIZE,
+			     conn->sndbuf_desc->len >> 1);
+	/* order the tx_curs_prep update before reading cdc_pend_tx_wr,
+	 * paired with atomic_dec_and_test() in smc_cdc_tx_handler(): either
+	 * we see no CDC in flight and push ourselves, or the completion of
+	 * the last one sees our data and pushes it
+	 */
+	smp_mb();
+	return atomic_read(&conn->cdc_pend_tx_wr) &&
+	       smc_tx_prepared_sends(conn) <= corking_size;
+}
+
 /* sndbuf producer: main API called by socket layer.
  * called under sock lock.
  */
@@ -230,6 +253,9 @@ int smc_tx_sendmsg(struct smc_sock *smc, struct msghdr *msg, size_t len)
 			 */
 			schedule_delayed_work(&conn->tx_work,
 					      SMC_TX_CORK_DELAY);
+		else if (smc_tx_should_autocork(conn))
+			/* completion of the in-flight CDC pushes the data */
+			continue;
 		else
 			smc_tx_sndbuf_nonempty(conn);
 	} /* while (msg_data_left(msg)) */
@@ -44,6 +44,7 @@ static void cache_init(struct cache_head *h, struct cache_detail *detail)
 {
 	time64_t now = seconds_since_boot();
 	INIT_HLIST_NODE(&h->cache_list);
+	INIT_LIST_HEAD(&h->expiry_list);
 	h->flags = 0;
 	kref_init(&h->ref);
 	h->expiry_time = now + CACHE_NEW_EXPIRY;
@@ -55,6 +56,8 @@ static void cache_init(struct cache_head *h, struct cache_detail *detail)
 
 static void cache_fresh_unlocked(struct cache_head *head,
 				struct cache_detail *detail);
+static void cache_queue_expiry(struct cache_head *h,
+			       struct cache_detail *detail);
 
 static struct cache_head *sunrpc_cache_find_rcu(struct cache_detail *detail,
 						struct cache_head *key,
@@ -82,6 +85,7 @@ static void sunrpc_begin_cache_remove_entry(struct cache_head *ch,
 {
 	/* Must be called under cd->hash_lock */
 	hlist_del_init_rcu(&ch->cache_list);
+	list_del_init(&ch->expiry_list);
 	set_bit(CACHE_CLEANED, &ch->flags);
 	cd->entries --;
 }
@@ -128,6 +132,7 @@ static struct cache_head *sunrpc_cache_add_entry(struct cache_detail *detail,
 	}
 
 	hlist_add_head_rcu(&new->cache_list, head);
+	cache_queue_expiry(new, detail);
 	detail->entries++;
 	cache_get(new);
 	spin_unlock(&detail->hash_lock);
@@ -152,6 +157,37 @@ EXPORT_SYMBOL_GPL(sunrpc_cache_lookup_rcu);
 
 static void cache_dequeue(struct cache_detail *detail, struct cache_head *ch);
 
+/*
+ * Hashed entries are kept on an expiry queue, in order of expiry_time, so
+ * that cache_clean() finds the next entry to expire at the head.  An entry
+ * is queued when it is hashed, with its initial CACHE_NEW_EXPIRY, and
+ * moved whenever it is given a new expiry time.
+ * Negative entries get a queue of their own as they are usually given a
+ * shorter lifetime than positive ones.  Within a queue the new expiry
+ * time is normally the latest, so the search starts from the tail.
+ * Must be called under detail->hash_lock.
+ */
+static void cache_queue_expiry(struct cache_head *h,
+			       struct cache_detail *detail)
+{
+	struct list_head *queue;
+	struct cache_head *tmp;
+
+	queue = &detail->expiry_queue[test_bit(CACHE_NEGATIVE, &h->flags)];
+	list_del(&h->expiry_list);
+
+	if (!list_empty(queue) &&
+	    h->expiry_time < list_first_entry(queue, struct cache_head,
+					      expiry_list)->expiry_time) {
+		list_add(&h->expiry_list, queue);
+		return;
+	}
+	list_for_each_entry_reverse(tmp, queue, expiry_list)
+		if (tmp->expiry_time <= h->expiry_time)
+			break;
+	list_add(&h->expiry_list, &tmp->expiry_list);
+}
+
 static void cache_fresh_locked(struct cache_head *head, time64_t expiry,
 			       struct cache_detail *detail)
 {
@@ -163,6 +199,8 @@ static void cache_fresh_locked(struct cache_head *head, time64_t expiry,
 	head->last_refresh = now;
 	smp_wmb(); /* paired with smp_rmb() in cache_is_valid() */
 	set_bit(CACHE_VALID, &head->flags);
+	if (!hlist_unhashed(&head->cache_list))
+		cache_queue_expiry(head, detail);
 }
 
 static void cache_fresh_unlocked(struct cache_head *head,
@@ -336,16 +374,19 @@ EXPORT_SYMBOL_GPL(cache_check);
 /*
  * caches need to be periodically cleaned.
  * For this we maintain a list of cache_detail and
- * a current pointer into that list and into the table
- * for that entry.
+ * a current pointer into that list.
  *
- * Each time cache_clean is called it finds the next non-empty entry
- * in the current table and walks the list in that entry
- * looking for entries that can be removed.
+ * Each time cache_clean is called it looks at the heads of the
+ * expiry queues of the current table for an entry that can be
+ * removed.  After a flush, the whole of each queue is searched
+ * instead, as the last_refresh time is not ordered.
  *
  * An entry gets removed if:
  * - The expiry is before current time
  * - The last_refresh time is before the flush_time for that cache
+ * This includes entries that never became valid, e.g. because their
+ * upcall was never answered: they are removed when their initial
+ * CACHE_NEW_EXPIRY runs out, which also dequeues the upcall.
  *
  * later we might drop old entries with non-NEVER expiry if that table
  * is getting 'full' for some definition of 'full'
@@ -353,12 +394,11 @@ EXPORT_SYMBOL_GPL(cache_check);
  * The question of "how often to scan a table" is an interesting one
  * and is answered in part by the use of the "nextcheck" field in the
  * cache_detail.
- * When a scan of a table begins, the nextcheck field is set to a time
- * that is well into the future.
- * While scanning, if an expiry time is found that is earlier than the
- * current nextcheck time, nextcheck is set to that expiry time.
- * If the flush_time is ever set to a time earlier than the nextcheck
- * time, the nextcheck time is then set to that flush_time.
+ * When nothing is left to remove from a table, the nextcheck field is
+ * set to just after the earliest expiry time at the head of its queues,
+ * or to a time well into the future if they are empty.
+ * When the flush_time is set, the nextcheck time is set to that
+ * flush_time.
  *
  * A table is then only scanned if the current time is at least
  * the nextcheck time.
@@ -368,7 +408,6 @@ EXPORT_SYMBOL_GPL(cache_check);
 static LIST_HEAD(cache_list);
 static DEFINE_SPINLOCK(cache_list_lock);
 static struct cache_detail *current_detail;
-static int current_index;
 
 static void do_cache_clean(struct work_struct *work);
 static struct delayed_work cache_cleaner;
@@ -377,6 +416,8 @@ void sunrpc_init_cache_detail(struct cache_detail *cd)
 {
 	spin_lock_init(&cd->hash_lock);
 	INIT_LIST_HEAD(&cd->queue);
+	INIT_LIST_HEAD(&cd->expiry_queue[0]);
+	INIT_LIST_HEAD(&cd->expiry_queue[1]);
 	spin_lock(&cache_list_lock);
 	cd->nextcheck = 0;
 	cd->entries = 0;
@@ -408,6 +449,48 @@ void sunrpc_destroy_cache_detail(struct cache_detail *cd)
 }
 EXPORT_SYMBOL_GPL(sunrpc_destroy_cache_detail);
 
+/* Like cache_is_expired(), but also true for stale entries never made valid */
+static bool cache_can_clean(struct cache_detail *cd, struct cache_head *ch)
+{
+	if (!test_bit(CACHE_VALID, &ch->flags))
+		return ch->expiry_time < seconds_since_boot();
+	return cache_is_expired(cd, ch);
+}
+
+/* Must be called under cd->hash_lock */
+static struct cache_head *cache_first_expired(struct cache_detail *cd)
+{
+	bool flushing = cd->nextcheck <= cd->flush_time;
+	struct cache_head *ch;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cd->expiry_queue); i++) {
+		list_for_each_entry(ch, &cd->expiry_queue[i], expiry_list) {
+			if (cache_can_clean(cd, ch))
+				return ch;
+			if (!flushing)
+				break;
+		}
+	}
+	return NULL;
+}
+
+/* Must be called under cd->hash_lock */
+static time64_t cache_next_expiry(struct cache_detail *cd)
+{
+	time64_t nextcheck = seconds_since_boot()+30*60;
+	struct cache_head *ch;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cd->expiry_queue); i++) {
+		ch = list_first_entry_or_null(&cd->expiry_queue[i],
+					      struct cache_head, expiry_list);
+		if (ch && nextcheck > ch->expiry_time)
+			nextcheck = ch->expiry_time+1;
+	}
+	return nextcheck;
+}
+
 /* clean cache tries to find something to clean
  * and cleans it.
  * It returns 1 if it cleaned something,
@@ -416,14 +499,15 @@ EXPORT_SYMBOL_GPL(sunrpc_destroy_cache_detail);
  */
 static int cache_clean(void)
 {
-	int rv = 0;
+	struct cache_head *ch;
+	struct cache_detail *d;
 	struct list_head *next;
 
 	spin_lock(&cache_list_lock);
 
-	/* find a suitable table if we don't already have one */
+	/* find a table that is due to be checked */
 	while (current_detail == NULL ||
-	    current_index >= current_detail->hash_size) {
+	       current_detail->nextcheck > seconds_since_boot()) {
 		if (current_detail)
 			next = current_detail->others.next;
 		else
@@ -434,55 +518,23 @@ static int cache_clean(void)
 			return -1;
 		}
 		current_detail = list_entry(next, struct cache_detail, others);
-		if (current_detail->nextcheck > seconds_since_boot())
-			current_index = current_detail->hash_size;
-		else {
-			current_index = 0;
-			current_detail->nextcheck = seconds_since_boot()+30*60;
-		}
 	}
 
-	/* find a non-empty bucket in the table */
-	while (current_detail &&
-	       current_index < current_detail->hash_size &&
-	       hlist_empty(&current_detail->hash_table[current_index]))
-		current_index++;
-
-	/* find a cleanable entry in the bucket and clean it, or set to next bucket */
-
-	if (current_detail && current_index < current_detail->hash_size) {
-		struct cache_head *ch = NULL;
-		struct cache_detail *d;
-		struct hlist_head *head;
-		struct hlist_node *tmp;
-
-		spin_lock(&current_detail->hash_lock);
-
-		/* Ok, now to clean this strand */
-
-		head = &current_detail->hash_table[current_index];
-		hlist_for_each_entry_safe(ch, tmp, head, cache_list) {
-			if (current_detail->nextcheck > ch->expiry_time)
-				current_detail->nextcheck = ch->expiry_time+1;
-			if (!cache_is_expired(current_detail, ch))
-				continue;
-
-			sunrpc_begin_cache_remove_entry(ch, current_detail);
-			rv = 1;
-			break;
-		}
-
-		spin_unlock(&current_detail->hash_lock);
-		d = current_detail;
-		if (!ch)
-			current_index ++;
-		spin_unlock(&cache_list_lock);
-		if (ch)
-			sunrpc_end_cache_remove_entry(ch, d);
-	} else
-		spin_unlock(&cache_list_lock);
+	/* clean one expired entry, or move on from this table */
+	d = current_detail;
+	spin_lock(&d->hash_lock);
+	ch = cache_first_expired(d);
+	if (ch)
+		sunrpc_begin_cache_remove_entry(ch, d);
+	else
+		d->nextcheck = cache_next_expiry(d);
+	spin_unlock(&d->hash_lock);
+	spin_unlock(&cache_list_lock);
 
-	return rv;
+	if (!ch)
+		return 0;
+	sunrpc_end_cache_remove_entry(ch, d);
+	return 1;
 }
 
 /*
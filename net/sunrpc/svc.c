@@ -37,7 +37,7 @@ static void svc_unregister(const struct svc_serv *serv, struct net *net);
 
 #define svc_serv_is_pooled(serv)    ((serv)->sv_ops->svo_function)
 
-#define SVC_POOL_DEFAULT	SVC_POOL_GLOBAL
+#define SVC_POOL_DEFAULT	SVC_POOL_PERNODE
 
 /*
  * Structure for mapping cpus to pools and vice versa.
@@ -478,6 +478,7 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 
 		pool->sp_id = i;
 		INIT_LIST_HEAD(&pool->sp_sockets);
+		init_llist_head(&pool->sp_new);
 		INIT_LIST_HEAD(&pool->sp_all_threads);
 		spin_lock_init(&pool->sp_lock);
 	}
@@ -598,6 +599,8 @@ svc_release_buffer(struct svc_rqst *rqstp)
 	for (i = 0; i < ARRAY_SIZE(rqstp->rq_pages); i++)
 		if (rqstp->rq_pages[i])
 			put_page(rqstp->rq_pages[i]);
+	while (rqstp->rq_page_cache_count)
+		put_page(rqstp->rq_page_cache[--rqstp->rq_page_cache_count]);
 }
 
 struct svc_rqst *
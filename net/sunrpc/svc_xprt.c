@@ -416,10 +416,12 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 
 	atomic_long_inc(&pool->sp_stats.packets);
 
-	spin_lock_bh(&pool->sp_lock);
-	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
-	pool->sp_stats.sockets_queued++;
-	spin_unlock_bh(&pool->sp_lock);
+	/*
+	 * Producers never take sp_lock: XPT_BUSY guarantees the transport is
+	 * on no other queue, and the consumer moves sp_new onto sp_sockets.
+	 */
+	llist_add(&xprt->xpt_ready_new, &pool->sp_new);
+	atomic_long_inc(&pool->sp_stats.sockets_queued);
 
 	/* find a thread for this xprt */
 	rcu_read_lock();
@@ -453,6 +455,25 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 }
 EXPORT_SYMBOL_GPL(svc_xprt_enqueue);
 
+static bool svc_pool_has_xprts(struct svc_pool *pool)
+{
+	return !list_empty(&pool->sp_sockets) || !llist_empty(&pool->sp_new);
+}
+
+/*
+ * Move the transports queued locklessly onto sp_sockets, oldest first.
+ * Caller holds sp_lock.
+ */
+static void svc_pool_move_new(struct svc_pool *pool)
+{
+	struct llist_node *node = llist_del_all(&pool->sp_new);
+	struct svc_xprt *xprt, *tmp;
+
+	node = llist_reverse_order(node);
+	llist_for_each_entry_safe(xprt, tmp, node, xpt_ready_new)
+		list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
+}
+
 /*
  * Dequeue the first transport, if there is one.
  */
@@ -460,10 +481,12 @@ static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 {
 	struct svc_xprt	*xprt = NULL;
 
-	if (list_empty(&pool->sp_sockets))
+	if (!svc_pool_has_xprts(pool))
 		goto out;
 
 	spin_lock_bh(&pool->sp_lock);
+	if (list_empty(&pool->sp_sockets))
+		svc_pool_move_new(pool);
 	if (likely(!list_empty(&pool->sp_sockets))) {
 		xprt = list_first_entry(&pool->sp_sockets,
 					struct svc_xprt, xpt_ready);
@@ -628,6 +651,14 @@ static void svc_check_conn_limits(struct svc_serv *serv)
 	}
 }
 
+/* Reuse a page recycled by svc_free_res_pages() before allocating */
+static struct page *svc_get_page(struct svc_rqst *rqstp)
+{
+	if (rqstp->rq_page_cache_count)
+		return rqstp->rq_page_cache[--rqstp->rq_page_cache_count];
+	return alloc_page(GFP_KERNEL);
+}
+
 static int svc_alloc_arg(struct svc_rqst *rqstp)
 {
 	struct svc_serv *serv = rqstp->rq_server;
@@ -645,7 +676,7 @@ static int svc_alloc_arg(struct svc_rqst *rqstp)
 	}
 	for (i = 0; i < pages ; i++)
 		while (rqstp->rq_pages[i] == NULL) {
-			struct page *p = alloc_page(GFP_KERNEL);
+			struct page *p = svc_get_page(rqstp);
 			if (!p) {
 				set_current_state(TASK_INTERRUPTIBLE);
 				if (signalled() || kthread_should_stop()) {
@@ -682,7 +713,7 @@ rqst_should_sleep(struct svc_rqst *rqstp)
 		return false;
 
 	/* was a socket queued? */
-	if (!list_empty(&pool->sp_sockets))
+	if (svc_pool_has_xprts(pool))
 		return false;
 
 	/* are we shutting down? */
@@ -1087,6 +1118,7 @@ static struct svc_xprt *svc_dequeue_net(struct svc_serv *serv, struct net *net)
 		pool = &serv->sv_pools[i];
 
 		spin_lock_bh(&pool->sp_lock);
+		svc_pool_move_new(pool);
 		list_for_each_entry_safe(xprt, tmp, &pool->sp_sockets, xpt_ready) {
 			if (xprt->xpt_net != net)
 				continue;
@@ -1409,7 +1441,7 @@ static int svc_pool_stats_show(struct seq_file *m, void *p)
 	seq_printf(m, "%u %lu %lu %lu %lu\n",
 		pool->sp_id,
 		(unsigned long)atomic_long_read(&pool->sp_stats.packets),
-		pool->sp_stats.sockets_queued,
+		(unsigned long)atomic_long_read(&pool->sp_stats.sockets_queued),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_woken),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout));
 
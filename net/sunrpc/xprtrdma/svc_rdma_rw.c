@@ -210,6 +210,7 @@ static void svc_rdma_write_done(struct ib_cq *cq, struct ib_wc *wc)
 
 	trace_svcrdma_wc_write(wc);
 
+	atomic_long_inc(&rdma->sc_stat_sq_cqes);
 	atomic_add(cc->cc_sqecount, &rdma->sc_sq_avail);
 	wake_up(&rdma->sc_send_wait);
 
@@ -268,6 +269,7 @@ static void svc_rdma_wc_read_done(struct ib_cq *cq, struct ib_wc *wc)
 
 	trace_svcrdma_wc_read(wc);
 
+	atomic_long_inc(&rdma->sc_stat_sq_cqes);
 	atomic_add(cc->cc_sqecount, &rdma->sc_sq_avail);
 	wake_up(&rdma->sc_send_wait);
 
@@ -327,6 +329,8 @@ static int svc_rdma_post_chunk_ctxt(struct svc_rdma_chunk_ctxt *cc)
 					      cc->cc_sqecount, ret);
 			if (ret)
 				break;
+			atomic_long_add(cc->cc_sqecount,
+					&rdma->sc_stat_sq_wrs);
 			return 0;
 		}
 
@@ -667,11 +671,19 @@ static int svc_rdma_build_read_segment(struct svc_rdma_read_info *info,
 
 /* Walk the segments in the Read chunk starting at @p and construct
  * RDMA Read operations to pull the chunk to the server.
+ *
+ * Clients often split a large buffer registered under one R_key into
+ * several segments. Segments that continue the previous one in the
+ * same R_key's address space are merged, so they are moved by a single
+ * rdma_rw_ctx and cost fewer Send Queue entries and completions.
  */
 static int svc_rdma_build_read_chunk(struct svc_rqst *rqstp,
 				     struct svc_rdma_read_info *info,
 				     __be32 *p)
 {
+	u32 handle = 0, length = 0;
+	bool pending = false;
+	u64 offset = 0;
 	unsigned int i;
 	int ret;
 
@@ -685,16 +697,32 @@ static int svc_rdma_build_read_chunk(struct svc_rqst *rqstp,
 		rs_length = be32_to_cpup(p++);
 		p = xdr_decode_hyper(p, &rs_offset);
 
-		ret = svc_rdma_build_read_segment(info, rqstp,
-						  rs_handle, rs_length,
-						  rs_offset);
-		if (ret < 0)
-			break;
-
 		trace_svcrdma_encode_rseg(rs_handle, rs_length, rs_offset);
 		info->ri_chunklen += rs_length;
+
+		if (pending && rs_handle == handle &&
+		    rs_offset == offset + length &&
+		    length + rs_length >= length) {
+			length += rs_length;
+			continue;
+		}
+
+		if (pending) {
+			ret = svc_rdma_build_read_segment(info, rqstp, handle,
+							  length, offset);
+			if (ret < 0)
+				goto out;
+		}
+		handle = rs_handle;
+		length = rs_length;
+		offset = rs_offset;
+		pending = true;
 	}
+	if (pending)
+		ret = svc_rdma_build_read_segment(info, rqstp, handle,
+						  length, offset);
 
+out:
 	/* Pages under I/O have been copied to head->rc_pages.
 	 * Prevent their premature release by svc_xprt_release() .
 	 */
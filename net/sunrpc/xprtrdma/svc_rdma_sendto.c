@@ -267,6 +267,7 @@ static void svc_rdma_wc_send(struct ib_cq *cq, struct ib_wc *wc)
 
 	trace_svcrdma_wc_send(wc);
 
+	atomic_long_inc(&rdma->sc_stat_sq_cqes);
 	atomic_inc(&rdma->sc_sq_avail);
 	wake_up(&rdma->sc_send_wait);
 
@@ -316,6 +317,8 @@ int svc_rdma_send(struct svcxprt_rdma *rdma, struct ib_send_wr *wr)
 			set_bit(XPT_CLOSE, &rdma->sc_xprt.xpt_flags);
 			svc_xprt_put(&rdma->sc_xprt);
 			wake_up(&rdma->sc_send_wait);
+		} else {
+			atomic_long_inc(&rdma->sc_stat_sq_wrs);
 		}
 		break;
 	}
@@ -875,6 +878,7 @@ int svc_rdma_sendto(struct svc_rqst *rqstp)
 				      wr_lst, rp_ch);
 	if (ret < 0)
 		goto err1;
+	atomic_long_inc(&rdma->sc_stat_replies);
 	ret = 0;
 
 out:
@@ -590,6 +590,10 @@ static void __svc_rdma_free(struct work_struct *work)
 	struct svc_xprt *xprt = &rdma->sc_xprt;
 
 	trace_svcrdma_xprt_free(xprt);
+	dprintk("svcrdma: xprt %p sent %ld replies using %ld SQ WRs and %ld SQ completions\n",
+		xprt, atomic_long_read(&rdma->sc_stat_replies),
+		atomic_long_read(&rdma->sc_stat_sq_wrs),
+		atomic_long_read(&rdma->sc_stat_sq_cqes));
 
 	if (rdma->sc_qp && !IS_ERR(rdma->sc_qp))
 		ib_drain_qp(rdma->sc_qp);
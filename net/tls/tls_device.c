@@ -33,6 +33,7 @@
 #include <linux/highmem.h>
 #include <linux/module.h>
 #include <linux/netdevice.h>
+#include <linux/slab.h>
 #include <net/dst.h>
 #include <net/inet_connection_sock.h>
 #include <net/tcp.h>
@@ -122,13 +123,23 @@ static struct net_device *get_netdev_for_sock(struct sock *sk)
 	return netdev;
 }
 
+/* One record is allocated per TLS record sent, i.e. up to every 16K of
+ * payload, so give them their own cache instead of going through kmalloc.
+ */
+static struct kmem_cache *tls_record_cache __read_mostly;
+
+static struct tls_record_info *alloc_record(void)
+{
+	return kmem_cache_alloc(tls_record_cache, GFP_KERNEL);
+}
+
 static void destroy_record(struct tls_record_info *record)
 {
 	int i;
 
 	for (i = 0; i < record->num_frags; i++)
 		__skb_frag_unref(&record->frags[i]);
-	kfree(record);
+	kmem_cache_free(tls_record_cache, record);
 }
 
 static void delete_all_records(struct tls_offload_context_tx *offload_ctx)
@@ -150,6 +161,7 @@ static void tls_icsk_clean_acked(struct sock *sk, u32 acked_seq)
 	struct tls_offload_context_tx *ctx;
 	u64 deleted_records = 0;
 	unsigned long flags;
+	LIST_HEAD(acked);
 
 	if (!tls_ctx)
 		return;
@@ -161,17 +173,22 @@ static void tls_icsk_clean_acked(struct sock *sk, u32 acked_seq)
 	if (info && !before(acked_seq, info->end_seq))
 		ctx->retransmit_hint = NULL;
 
-	list_for_each_entry_safe(info, temp, &ctx->records_list, list) {
+	list_for_each_entry(info, &ctx->records_list, list) {
 		if (before(acked_seq, info->end_seq))
 			break;
-		list_del(&info->list);
-
-		destroy_record(info);
 		deleted_records++;
 	}
 
+	/* Unlink the acked records in one go and free them outside the lock
+	 * that the driver's retransmit path takes for tls_get_record().
+	 */
+	list_cut_before(&acked, &ctx->records_list, &info->list);
+
 	ctx->unacked_record_sn += deleted_records;
 	spin_unlock_irqrestore(&ctx->lock, flags);
+
+	list_for_each_entry_safe(info, temp, &acked, list)
+		destroy_record(info);
 }
 
 /* At this point, there should be no references on this
@@ -338,7 +355,7 @@ static int tls_create_new_record(struct tls_offload_context_tx *offload_ctx,
 	struct tls_record_info *record;
 	skb_frag_t *frag;
 
-	record = kmalloc(sizeof(*record), GFP_KERNEL);
+	record = alloc_record();
 	if (!record)
 		return -ENOMEM;
 
@@ -946,7 +963,10 @@ int tls_set_device_offload(struct sock *sk, struct tls_context *ctx)
 	if (ctx->priv_ctx_tx)
 		return -EEXIST;
 
-	start_marker_record = kmalloc(sizeof(*start_marker_record), GFP_KERNEL);
+	if (!tls_record_cache)
+		return -ENOMEM;
+
+	start_marker_record = alloc_record();
 	if (!start_marker_record)
 		return -ENOMEM;
 
@@ -1096,7 +1116,7 @@ int tls_set_device_offload(struct sock *sk, struct tls_context *ctx)
 	kfree(offload_ctx);
 	ctx->priv_ctx_tx = NULL;
 free_marker_record:
-	kfree(start_marker_record);
+	kmem_cache_free(tls_record_cache, start_marker_record);
 	return rc;
 }
 
@@ -1276,6 +1296,8 @@ static struct notifier_block tls_dev_notifier = {
 
 void __init tls_device_init(void)
 {
+	/* Without the cache device offload is refused and SW is used */
+	tls_record_cache = KMEM_CACHE(tls_record_info, 0);
 	register_netdevice_notifier(&tls_dev_notifier);
 }
 
@@ -1284,4 +1306,5 @@ void __exit tls_device_cleanup(void)
 	unregister_netdevice_notifier(&tls_dev_notifier);
 	flush_work(&tls_device_gc_work);
 	clean_acked_data_flush();
+	kmem_cache_destroy(tls_record_cache);
 }
@@ -42,6 +42,27 @@
 #include <net/strparser.h>
 #include <net/tls.h>
 
+/* Upper bound on the number of records a single recvmsg() call keeps in
+ * flight with an asynchronous AEAD before it waits for them to complete.
+ * Zero means no limit beyond the amount of parsed records available.
+ */
+static unsigned int rx_async_depth __read_mostly;
+module_param(rx_async_depth, uint, 0644);
+MODULE_PARM_DESC(rx_async_depth,
+		 "Max records decrypted asynchronously before waiting (0 = unlimited)");
+
+/* Let sendmsg() encrypt straight out of the pinned user pages even when the
+ * AEAD completes asynchronously, instead of copying the plaintext into the
+ * record first. The ciphertext still goes into freshly allocated pages that
+ * tls_push_record() hands to TCP as skb frags. sendmsg() waits for these
+ * records to be encrypted before it returns, so user memory is no longer
+ * read once the call has completed.
+ */
+static bool tx_async_zerocopy __read_mostly;
+module_param(tx_async_zerocopy, bool, 0644);
+MODULE_PARM_DESC(tx_async_zerocopy,
+		 "Encrypt from user pages also with asynchronous crypto");
+
 static int __skb_nsg(struct sk_buff *skb, int offset, int len,
                      unsigned int recursion_level)
 {
@@ -264,6 +285,21 @@ static int tls_do_decryption(struct sock *sk,
 	return ret;
 }
 
+/* Wait for all records submitted with tls_do_decryption(async = true) */
+static int tls_decrypt_async_wait(struct tls_sw_context_rx *ctx)
+{
+	int err = 0;
+
+	smp_store_mb(ctx->async_notify, true);
+	if (atomic_read(&ctx->decrypt_pending))
+		err = crypto_wait_req(-EINPROGRESS, &ctx->async_wait);
+	else
+		reinit_completion(&ctx->async_wait.completion);
+	WRITE_ONCE(ctx->async_notify, false);
+
+	return err;
+}
+
 static void tls_trim_both_msgs(struct sock *sk, int target_size)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
@@ -911,6 +947,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 	struct tls_prot_info *prot = &tls_ctx->prot_info;
 	struct tls_sw_context_tx *ctx = tls_sw_ctx_tx(tls_ctx);
 	bool async_capable = ctx->async_capable;
+	bool zc_capable = !async_capable || READ_ONCE(tx_async_zerocopy);
 	unsigned char record_type = TLS_RECORD_TYPE_DATA;
 	bool is_kvec = iov_iter_is_kvec(&msg->msg_iter);
 	bool eor = !(msg->msg_flags & MSG_MORE);
@@ -944,7 +981,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 	while (msg_data_left(msg)) {
 		if (sk->sk_err) {
 			ret = -sk->sk_err;
-			goto send_end;
+			goto send_wait;
 		}
 
 		if (ctx->open_rec)
@@ -953,7 +990,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 			rec = ctx->open_rec = tls_get_rec(sk);
 		if (!rec) {
 			ret = -ENOMEM;
-			goto send_end;
+			goto send_wait;
 		}
 
 		msg_pl = &rec->msg_plaintext;
@@ -988,7 +1025,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 			full_record = true;
 		}
 
-		if (!is_kvec && (full_record || eor) && !async_capable) {
+		if (!is_kvec && (full_record || eor) && zc_capable) {
 			u32 first = msg_pl->sg.end;
 
 			ret = sk_msg_zerocopy_from_iter(sk, &msg->msg_iter,
@@ -1011,7 +1048,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 				else if (ctx->open_rec && ret == -ENOSPC)
 					goto rollback_iter;
 				else if (ret != -EAGAIN)
-					goto send_end;
+					goto send_wait;
 			}
 			continue;
 rollback_iter:
@@ -1028,7 +1065,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 		ret = tls_clone_plaintext_msg(sk, required_size);
 		if (ret) {
 			if (ret != -ENOSPC)
-				goto send_end;
+				goto send_wait;
 
 			/* Adjust try_to_copy according to the amount that was
 			 * actually allocated. The difference is due
@@ -1064,7 +1101,7 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 				else if (ret != -EAGAIN) {
 					if (ret == -ENOSPC)
 						ret = 0;
-					goto send_end;
+					goto send_wait;
 				}
 			}
 		}
@@ -1079,17 +1116,21 @@ int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 trim_sgl:
 			if (ctx->open_rec)
 				tls_trim_both_msgs(sk, orig_size);
-			goto send_end;
+			goto send_wait;
 		}
 
 		if (ctx->open_rec && msg_en->sg.size < required_size)
 			goto alloc_encrypted;
 	}
 
+send_wait:
 	if (!num_async) {
 		goto send_end;
 	} else if (num_zc) {
-		/* Wait for pending encryptions to get completed */
+		/* Wait for pending encryptions to get completed. The error
+		 * paths need this too: the user pages that zerocopy records
+		 * are encrypted from are unpinned once we return.
+		 */
 		smp_store_mb(ctx->async_notify, true);
 
 		if (atomic_read(&ctx->encrypt_pending))
@@ -1805,8 +1846,23 @@ int tls_sw_recvmsg(struct sock *sk,
 		}
 
 		if (err == -EINPROGRESS) {
+			unsigned int depth = READ_ONCE(rx_async_depth);
+
 			async = true;
 			num_async++;
+
+			/* Bound the pipeline. The records stay queued on
+			 * rx_list in order and are copied out at recv_end.
+			 */
+			if (depth && atomic_read(&ctx->decrypt_pending) >= depth) {
+				err = tls_decrypt_async_wait(ctx);
+				if (err) {
+					tls_err_abort(sk, err);
+					copied = 0;
+					decrypted = 0;
+					goto end;
+				}
+			}
 		} else if (prot->version == TLS_1_3_VERSION) {
 			tlm->control = ctx->control;
 		}
@@ -1889,20 +1945,14 @@ int tls_sw_recvmsg(struct sock *sk,
 recv_end:
 	if (num_async) {
 		/* Wait for all previously submitted records to be decrypted */
-		smp_store_mb(ctx->async_notify, true);
-		if (atomic_read(&ctx->decrypt_pending)) {
-			err = crypto_wait_req(-EINPROGRESS, &ctx->async_wait);
-			if (err) {
-				/* one of async decrypt failed */
-				tls_err_abort(sk, err);
-				copied = 0;
-				decrypted = 0;
-				goto end;
-			}
-		} else {
-			reinit_completion(&ctx->async_wait.completion);
+		err = tls_decrypt_async_wait(ctx);
+		if (err) {
+			/* one of async decrypt failed */
+			tls_err_abort(sk, err);
+			copied = 0;
+			decrypted = 0;
+			goto end;
 		}
-		WRITE_ONCE(ctx->async_notify, false);
 
 		/* Drain records from the rx_list & copy if required */
 		if (is_peek || is_kvec)
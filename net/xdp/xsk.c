@@ -22,6 +22,7 @@
 #include <linux/net.h>
 #include <linux/netdevice.h>
 #include <linux/rculist.h>
+#include <net/busy_poll.h>
 #include <net/xdp_sock.h>
 #include <net/xdp.h>
 
@@ -29,7 +30,8 @@
 #include "xdp_umem.h"
 #include "xsk.h"
 
-#define TX_BATCH_SIZE 16
+#define TX_BATCH_SIZE 32
+#define XSK_DESC_MAX_FRAGS (MAX_SKB_FRAGS + 1)
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
@@ -57,6 +59,18 @@ void xsk_umem_release_addr(struct xdp_umem *umem)
 }
 EXPORT_SYMBOL(xsk_umem_release_addr);
 
+u32 xsk_umem_peek_addr_batch(struct xdp_umem *umem, u64 *addrs, u32 max)
+{
+	return xskq_cons_peek_addr_batch(umem->fq, addrs, umem, max);
+}
+EXPORT_SYMBOL(xsk_umem_peek_addr_batch);
+
+void xsk_umem_release_addr_n(struct xdp_umem *umem, u32 cnt)
+{
+	xskq_cons_release_n(umem->fq, cnt);
+}
+EXPORT_SYMBOL(xsk_umem_release_addr_n);
+
 void xsk_set_rx_need_wakeup(struct xdp_umem *umem)
 {
 	if (umem->need_wakeup & XDP_WAKEUP_RX)
@@ -117,6 +131,26 @@ bool xsk_umem_uses_need_wakeup(struct xdp_umem *umem)
 }
 EXPORT_SYMBOL(xsk_umem_uses_need_wakeup);
 
+/* Drivers call this from their NAPI poll routine with the id of the NAPI
+ * context serving the queue the umem is bound to. It lets sockets with
+ * SO_BUSY_POLL set drive that NAPI context from poll(), sendmsg() and
+ * recvmsg() instead of kicking the driver through ndo_xsk_wakeup().
+ */
+void xsk_umem_mark_napi_id(struct xdp_umem *umem, unsigned int napi_id)
+{
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	struct xdp_sock *xs;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(xs, &umem->xsk_list, list) {
+		if (READ_ONCE(xs->sk.sk_napi_id) != napi_id)
+			WRITE_ONCE(xs->sk.sk_napi_id, napi_id);
+	}
+	rcu_read_unlock();
+#endif
+}
+EXPORT_SYMBOL(xsk_umem_mark_napi_id);
+
 /* If a buffer crosses a page boundary, we need to do 2 memcpy's, one for
  * each page. This is only required in copy mode.
  */
@@ -140,6 +174,48 @@ static void __xsk_rcv_memcpy(struct xdp_umem *umem, u64 addr, void *from_buf,
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+/* Spread a frame that does not fit into a single chunk over several
+ * buffers from the fill ring. Every Rx descriptor but the last one of
+ * the frame carries XDP_PKT_CONTD, and metadata only precedes the data
+ * in the first buffer. Either the whole frame is posted or nothing is.
+ */
+static int xsk_rcv_frags(struct xdp_sock *xs, void *from_buf, u32 len,
+			 u32 metalen)
+{
+	struct xdp_umem *umem = xs->umem;
+	u32 frag_size = umem->chunk_size_nohr - XDP_PACKET_HEADROOM;
+	u64 addrs[XSK_DESC_MAX_FRAGS];
+	u32 nb_frags, i;
+
+	nb_frags = DIV_ROUND_UP(len, frag_size);
+	if (!xs->rx->sg || nb_frags > XSK_DESC_MAX_FRAGS)
+		return -ENOSPC;
+
+	if (xskq_cons_peek_addr_batch(umem->fq, addrs, umem, nb_frags) <
+	    nb_frags || xskq_prod_nb_free(xs->rx, nb_frags) < nb_frags)
+		return -ENOSPC;
+
+	for (i = 0; i < nb_frags; i++) {
+		u32 copy = min(len, frag_size);
+		u64 addr;
+
+		addr = xsk_umem_adjust_offset(umem, addrs[i], umem->headroom);
+		__xsk_rcv_memcpy(umem, addr, from_buf, copy, metalen);
+
+		addr = xsk_umem_adjust_offset(umem, addr, metalen);
+		len -= copy;
+		/* Cannot fail, the space was checked above */
+		xskq_prod_reserve_desc(xs->rx, addr, copy,
+				       len ? XDP_PKT_CONTD : 0);
+
+		from_buf += copy + metalen;
+		metalen = 0;
+	}
+
+	xskq_cons_release_n(umem->fq, nb_frags);
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 {
 	u64 offset = xs->umem->headroom;
@@ -148,12 +224,6 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 	u32 metalen;
 	int err;
 
-	if (!xskq_cons_peek_addr(xs->umem->fq, &addr, xs->umem) ||
-	    len > xs->umem->chunk_size_nohr - XDP_PACKET_HEADROOM) {
-		xs->rx_dropped++;
-		return -ENOSPC;
-	}
-
 	if (unlikely(xdp_data_meta_unsupported(xdp))) {
 		from_buf = xdp->data;
 		metalen = 0;
@@ -162,25 +232,40 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 		metalen = xdp->data - xdp->data_meta;
 	}
 
+	if (len > xs->umem->chunk_size_nohr - XDP_PACKET_HEADROOM) {
+		err = xsk_rcv_frags(xs, from_buf, len, metalen);
+		if (err)
+			goto out_drop;
+
+		xdp_return_buff(xdp);
+		return 0;
+	}
+
+	if (!xskq_cons_peek_addr(xs->umem->fq, &addr, xs->umem)) {
+		err = -ENOSPC;
+		goto out_drop;
+	}
+
 	memcpy_addr = xsk_umem_adjust_offset(xs->umem, addr, offset);
 	__xsk_rcv_memcpy(xs->umem, memcpy_addr, from_buf, len, metalen);
 
 	offset += metalen;
 	addr = xsk_umem_adjust_offset(xs->umem, addr, offset);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, 0);
 	if (!err) {
 		xskq_cons_release(xs->umem->fq);
 		xdp_return_buff(xdp);
 		return 0;
 	}
 
+out_drop:
 	xs->rx_dropped++;
 	return err;
 }
 
 static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 {
-	int err = xskq_prod_reserve_desc(xs->rx, xdp->handle, len);
+	int err = xskq_prod_reserve_desc(xs->rx, xdp->handle, len, 0);
 
 	if (err)
 		xs->rx_dropped++;
@@ -237,8 +322,14 @@ int xsk_generic_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 		goto out_unlock;
 	}
 
-	if (!xskq_cons_peek_addr(xs->umem->fq, &addr, xs->umem) ||
-	    len > xs->umem->chunk_size_nohr - XDP_PACKET_HEADROOM) {
+	if (len > xs->umem->chunk_size_nohr - XDP_PACKET_HEADROOM) {
+		err = xsk_rcv_frags(xs, xdp->data_meta, len, metalen);
+		if (err)
+			goto out_drop;
+		goto out_submit;
+	}
+
+	if (!xskq_cons_peek_addr(xs->umem->fq, &addr, xs->umem)) {
 		err = -ENOSPC;
 		goto out_drop;
 	}
@@ -248,11 +339,12 @@ int xsk_generic_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 	memcpy(buffer, xdp->data_meta, len + metalen);
 
 	addr = xsk_umem_adjust_offset(xs->umem, addr, metalen);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, 0);
 	if (err)
 		goto out_drop;
 
 	xskq_cons_release(xs->umem->fq);
+out_submit:
 	xskq_prod_submit(xs->rx);
 
 	spin_unlock_bh(&xs->rx_lock);
@@ -340,6 +432,34 @@ bool xsk_umem_consume_tx(struct xdp_umem *umem, struct xdp_desc *desc)
 }
 EXPORT_SYMBOL(xsk_umem_consume_tx);
 
+u32 xsk_umem_consume_tx_batch(struct xdp_umem *umem, struct xdp_desc *descs,
+			      u32 max)
+{
+	struct xdp_sock *xs;
+	u32 nb_descs = 0;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(xs, &umem->xsk_list, list) {
+		nb_descs = xskq_cons_peek_desc_batch(xs->tx, descs, umem, max);
+		if (!nb_descs)
+			continue;
+
+		/* Same backpressure as in xsk_umem_consume_tx(), but the
+		 * completion queue entries for the whole batch are
+		 * reserved at once. Descriptors that did not get an entry
+		 * stay in the Tx ring.
+		 */
+		nb_descs = xskq_prod_reserve_addr_batch(umem->cq, descs,
+							nb_descs);
+		xskq_cons_release_n(xs->tx, nb_descs);
+		break;
+	}
+	rcu_read_unlock();
+
+	return nb_descs;
+}
+EXPORT_SYMBOL(xsk_umem_consume_tx_batch);
+
 static int xsk_wakeup(struct xdp_sock *xs, u8 flags)
 {
 	struct net_device *dev = xs->dev;
@@ -370,69 +490,210 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Buffers of a multi-buffer frame, completed together when its skb is
+ * freed.
+ */
+struct xsk_tx_frags {
+	u32 nb_frags;
+	u64 addrs[];
+};
+
+static void xsk_destruct_skb_frags(struct sk_buff *skb)
+{
+	struct xsk_tx_frags *frags = skb_shinfo(skb)->destructor_arg;
+	struct xdp_sock *xs = xdp_sk(skb->sk);
+	unsigned long flags;
+	u32 i;
+
+	spin_lock_irqsave(&xs->tx_completion_lock, flags);
+	for (i = 0; i < frags->nb_frags; i++)
+		xskq_prod_submit_addr(xs->umem->cq, frags->addrs[i]);
+	spin_unlock_irqrestore(&xs->tx_completion_lock, flags);
+
+	kfree(frags);
+	sock_wfree(skb);
+}
+
+/* Number of descriptors making up the frame at the head of @descs, or 0
+ * if the frame does not end within the first @max descriptors.
+ */
+static u32 xsk_tx_frame_descs(struct xdp_desc *descs, u32 max)
+{
+	u32 i;
+
+	for (i = 0; i < max; i++) {
+		if (!(descs[i].options & XDP_PKT_CONTD))
+			return i + 1;
+	}
+
+	return 0;
+}
+
+/* Drop a frame that cannot be sent: it has more fragments than an skb
+ * can carry, or one of its descriptors is invalid. The first @nb_descs
+ * of them have already been read into @descs; the rest, if any, are
+ * consumed from the ring up to the end of the frame.
+ */
+static void xsk_tx_skip_frame(struct xdp_sock *xs, struct xdp_desc *descs,
+			      u32 nb_descs)
+{
+	struct xdp_desc desc;
+
+	xs->tx->invalid_descs += nb_descs;
+	xskq_cons_release_n(xs->tx, nb_descs);
+	if (!(descs[nb_descs - 1].options & XDP_PKT_CONTD))
+		return;
+
+	while (xskq_cons_peek_desc(xs->tx, &desc, xs->umem)) {
+		xs->tx->invalid_descs++;
+		xskq_cons_release(xs->tx);
+		if (!(desc.options & XDP_PKT_CONTD))
+			break;
+	}
+}
+
+static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
+				     struct xdp_desc *descs, u32 nb_frags,
+				     int *err)
+{
+	struct xsk_tx_frags *frags = NULL;
+	struct sock *sk = &xs->sk;
+	u32 i, len = 0, offset = 0;
+	struct sk_buff *skb;
+
+	for (i = 0; i < nb_frags; i++)
+		len += descs[i].len;
+
+	if (nb_frags > 1) {
+		frags = kmalloc(struct_size(frags, addrs, nb_frags),
+				GFP_KERNEL);
+		if (unlikely(!frags)) {
+			*err = -EAGAIN;
+			return NULL;
+		}
+	}
+
+	skb = sock_alloc_send_skb(sk, len, 1, err);
+	if (unlikely(!skb)) {
+		*err = -EAGAIN;
+		goto out_free_frags;
+	}
+
+	skb_put(skb, len);
+	for (i = 0; i < nb_frags; i++) {
+		char *buffer = xdp_umem_get_data(xs->umem, descs[i].addr);
+
+		*err = skb_store_bits(skb, offset, buffer, descs[i].len);
+		if (unlikely(*err)) {
+			kfree_skb(skb);
+			goto out_free_frags;
+		}
+		offset += descs[i].len;
+	}
+
+	skb->dev = xs->dev;
+	skb->priority = sk->sk_priority;
+	skb->mark = sk->sk_mark;
+
+	if (frags) {
+		frags->nb_frags = nb_frags;
+		for (i = 0; i < nb_frags; i++)
+			frags->addrs[i] = descs[i].addr;
+		skb_shinfo(skb)->destructor_arg = frags;
+		skb->destructor = xsk_destruct_skb_frags;
+	} else {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)descs[0].addr;
+		skb->destructor = xsk_destruct_skb;
+	}
+
+	return skb;
+
+out_free_frags:
+	kfree(frags);
+	return NULL;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
+	struct xdp_desc descs[TX_BATCH_SIZE];
 	struct xdp_sock *xs = xdp_sk(sk);
-	u32 max_batch = TX_BATCH_SIZE;
 	bool sent_frame = false;
-	struct xdp_desc desc;
+	u32 i = 0, nb_descs, nb_peeked;
 	struct sk_buff *skb;
 	int err = 0;
 
+	BUILD_BUG_ON(TX_BATCH_SIZE <= XSK_DESC_MAX_FRAGS);
+
 	mutex_lock(&xs->mutex);
 
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->umem)) {
-		char *buffer;
-		u64 addr;
-		u32 len;
+	nb_peeked = xskq_cons_peek_desc_batch(xs->tx, descs, xs->umem,
+					      TX_BATCH_SIZE);
+	/* This is the backpreassure mechanism for the Tx path.
+	 * Reserve space in the completion queue and only proceed
+	 * if there is space in it. This avoids having to implement
+	 * any buffering in the Tx path.
+	 */
+	nb_descs = xskq_prod_reserve_n(xs->umem->cq, nb_peeked);
 
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
-		}
+	while (i < nb_descs) {
+		u32 avail = nb_descs - i;
+		u32 nb_frags = xsk_tx_frame_descs(&descs[i], avail);
 
-		len = desc.len;
-		skb = sock_alloc_send_skb(sk, len, 1, &err);
-		if (unlikely(!skb)) {
-			err = -EAGAIN;
-			goto out;
+		if (unlikely(nb_frags > XSK_DESC_MAX_FRAGS ||
+			     (!nb_frags && avail > XSK_DESC_MAX_FRAGS))) {
+			/* More fragments than an skb can carry */
+			xsk_tx_skip_frame(xs, &descs[i], nb_frags ?: avail);
+			err = -EINVAL;
+			goto out_cancel;
 		}
 
-		skb_put(skb, len);
-		addr = desc.addr;
-		buffer = xdp_umem_get_data(xs->umem, addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		/* This is the backpreassure mechanism for the Tx path.
-		 * Reserve space in the completion queue and only proceed
-		 * if there is space in it. This avoids having to implement
-		 * any buffering in the Tx path.
-		 */
-		if (unlikely(err) || xskq_prod_reserve(xs->umem->cq)) {
-			kfree_skb(skb);
-			goto out;
+		if (!nb_frags) {
+			if (nb_descs < nb_peeked || nb_peeked == TX_BATCH_SIZE) {
+				/* Out of completion slots, or the frame
+				 * straddles the end of the batch.
+				 */
+				err = -EAGAIN;
+			} else if (xs->tx->cached_prod - xs->tx->cached_cons >
+				   avail) {
+				/* The batch was cut short by an invalid
+				 * descriptor in the middle of the frame.
+				 */
+				xsk_tx_skip_frame(xs, &descs[i], avail);
+				err = -EINVAL;
+			}
+			/* Otherwise the rest of the frame is not in the
+			 * ring yet.
+			 */
+			goto out_cancel;
 		}
 
-		skb->dev = xs->dev;
-		skb->priority = sk->sk_priority;
-		skb->mark = sk->sk_mark;
-		skb_shinfo(skb)->destructor_arg = (void *)(long)desc.addr;
-		skb->destructor = xsk_destruct_skb;
+		skb = xsk_build_skb(xs, &descs[i], nb_frags, &err);
+		if (unlikely(!skb))
+			goto out_cancel;
 
 		err = dev_direct_xmit(skb, xs->queue_id);
-		xskq_cons_release(xs->tx);
+		xskq_cons_release_n(xs->tx, nb_frags);
+		i += nb_frags;
 		/* Ignore NET_XMIT_CN as packet might have been sent */
 		if (err == NET_XMIT_DROP || err == NETDEV_TX_BUSY) {
 			/* SKB completed but not sent */
 			err = -EBUSY;
-			goto out;
+			goto out_cancel;
 		}
 
 		sent_frame = true;
 	}
 
+	if (nb_descs == TX_BATCH_SIZE && xskq_cons_has_entries(xs->tx, 1))
+		err = -EAGAIN;
+
+out_cancel:
+	/* Completion entries reserved for descriptors that were not sent */
+	xskq_prod_cancel_n(xs->umem->cq, nb_descs - i);
+	__xskq_cons_release(xs->tx);
 out:
 	if (sent_frame)
 		sk->sk_write_space(sk);
@@ -453,6 +714,21 @@ static int __xsk_sendmsg(struct sock *sk)
 	return xs->zc ? xsk_zc_xmit(xs) : xsk_generic_xmit(sk);
 }
 
+/* Whether a busy-poll of the socket reaches the NAPI context of its
+ * queue. When the current call has just done one, that poll loop already
+ * processed the rings and there is no need to wake up the driver. The
+ * SO_BUSY_POLL time is the per-socket budget for it.
+ */
+static bool xsk_can_busy_poll(struct sock *sk)
+{
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	return sk_can_busy_loop(sk) &&
+	       READ_ONCE(sk->sk_napi_id) >= MIN_NAPI_ID;
+#else
+	return false;
+#endif
+}
+
 static int xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 {
 	bool need_wait = !(m->msg_flags & MSG_DONTWAIT);
@@ -464,9 +740,41 @@ static int xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 	if (unlikely(need_wait))
 		return -EOPNOTSUPP;
 
+	if (xsk_can_busy_poll(sk)) {
+		sk_busy_loop(sk, 1); /* only support non-blocking sockets */
+		if (xs->zc)
+			return 0;
+	}
+
 	return __xsk_sendmsg(sk);
 }
 
+static int xsk_recvmsg(struct socket *sock, struct msghdr *m, size_t len,
+		       int flags)
+{
+	bool need_wait = !(flags & MSG_DONTWAIT);
+	struct sock *sk = sock->sk;
+	struct xdp_sock *xs = xdp_sk(sk);
+
+	if (unlikely(!xsk_is_bound(xs)))
+		return -ENXIO;
+	if (unlikely(!(xs->dev->flags & IFF_UP)))
+		return -ENETDOWN;
+	if (unlikely(!xs->rx))
+		return -ENOBUFS;
+	if (unlikely(need_wait))
+		return -EOPNOTSUPP;
+
+	if (xsk_can_busy_poll(sk)) {
+		sk_busy_loop(sk, 1); /* only support non-blocking sockets */
+		return 0;
+	}
+
+	if (xs->zc && (xs->umem->need_wakeup & XDP_WAKEUP_RX))
+		return xsk_wakeup(xs, XDP_WAKEUP_RX);
+	return 0;
+}
+
 static __poll_t xsk_poll(struct file *file, struct socket *sock,
 			     struct poll_table_struct *wait)
 {
@@ -481,11 +789,17 @@ static __poll_t xsk_poll(struct file *file, struct socket *sock,
 	umem = xs->umem;
 
 	if (umem->need_wakeup) {
-		if (xs->zc)
-			xsk_wakeup(xs, umem->need_wakeup);
-		else
+		if (xs->zc) {
+			/* sock_poll() has already busy-polled the queue if
+			 * the syscall asked for it
+			 */
+			if (!xsk_can_busy_poll(sk) ||
+			    !(poll_requested_events(wait) & POLL_BUSY_LOOP))
+				xsk_wakeup(xs, umem->need_wakeup);
+		} else {
 			/* Poll needs to drive Tx also in copy mode */
 			__xsk_sendmsg(sk);
+		}
 	}
 
 	if (xs->rx && !xskq_prod_is_empty(xs->rx))
@@ -662,7 +976,11 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG))
+		return -EINVAL;
+
+	/* Multi-buffer frames are only supported in copy mode */
+	if ((flags & XDP_USE_SG) && (flags & XDP_ZEROCOPY))
 		return -EINVAL;
 
 	rtnl_lock();
@@ -714,7 +1032,8 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			sockfd_put(sock);
 			goto out_unlock;
 		}
-		if (umem_xs->dev != dev || umem_xs->queue_id != qid) {
+		if (umem_xs->dev != dev || umem_xs->queue_id != qid ||
+		    ((flags & XDP_USE_SG) && umem_xs->zc)) {
 			err = -EINVAL;
 			sockfd_put(sock);
 			goto out_unlock;
@@ -733,6 +1052,9 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		xskq_set_umem(xs->umem->cq, xs->umem->size,
 			      xs->umem->chunk_mask);
 
+		if (flags & XDP_USE_SG)
+			flags |= XDP_COPY;
+
 		err = xdp_umem_assign_dev(xs->umem, dev, qid, flags);
 		if (err)
 			goto out_unlock;
@@ -745,6 +1067,10 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 	xs->queue_id = qid;
 	xskq_set_umem(xs->rx, xs->umem->size, xs->umem->chunk_mask);
 	xskq_set_umem(xs->tx, xs->umem->size, xs->umem->chunk_mask);
+	if (xs->rx)
+		xs->rx->sg = flags & XDP_USE_SG;
+	if (xs->tx)
+		xs->tx->sg = flags & XDP_USE_SG;
 	xdp_add_sk_umem(xs->umem, xs);
 
 out_unlock:
@@ -1097,7 +1423,7 @@ static const struct proto_ops xsk_proto_ops = {
 	.setsockopt	= xsk_setsockopt,
 	.getsockopt	= xsk_getsockopt,
 	.sendmsg	= xsk_sendmsg,
-	.recvmsg	= sock_no_recvmsg,
+	.recvmsg	= xsk_recvmsg,
 	.mmap		= xsk_mmap,
 	.sendpage	= sock_no_sendpage,
 };
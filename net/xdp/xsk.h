@@ -4,6 +4,11 @@
 #ifndef XSK_H_
 #define XSK_H_
 
+/* sxdp_flags bit allowing frames to span several UMEM chunks, see
+ * XDP_PKT_CONTD. Copy mode only.
+ */
+#define XDP_USE_SG	(1 << 4)
+
 struct xdp_ring_offset_v1 {
 	__u64 producer;
 	__u64 consumer;
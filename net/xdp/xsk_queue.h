@@ -16,6 +16,11 @@ struct xdp_ring {
 	u32 flags;
 };
 
+/* Set in the options field of every descriptor of a multi-buffer frame
+ * except the last one. Only valid on sockets bound with XDP_USE_SG.
+ */
+#define XDP_PKT_CONTD (1 << 0)
+
 /* Used for the RX and TX queues for packets */
 struct xdp_rxtx_ring {
 	struct xdp_ring ptrs;
@@ -37,6 +42,7 @@ struct xsk_queue {
 	u32 cached_cons;
 	struct xdp_ring *ring;
 	u64 invalid_descs;
+	bool sg;
 };
 
 /* The structure of the shared state of the rings are the same as the
@@ -170,6 +176,14 @@ static inline bool xskq_cons_read_addr(struct xsk_queue *q, u64 *addr,
 	return false;
 }
 
+static inline bool xskq_cons_has_bad_options(struct xsk_queue *q,
+					     struct xdp_desc *d)
+{
+	u32 valid_options = q->sg ? XDP_PKT_CONTD : 0;
+
+	return d->options & ~valid_options;
+}
+
 static inline bool xskq_cons_is_valid_desc(struct xsk_queue *q,
 					   struct xdp_desc *d,
 					   struct xdp_umem *umem)
@@ -178,7 +192,8 @@ static inline bool xskq_cons_is_valid_desc(struct xsk_queue *q,
 		if (!xskq_cons_is_valid_unaligned(q, d->addr, d->len, umem))
 			return false;
 
-		if (d->len > umem->chunk_size_nohr || d->options) {
+		if (d->len > umem->chunk_size_nohr ||
+		    xskq_cons_has_bad_options(q, d)) {
 			q->invalid_descs++;
 			return false;
 		}
@@ -190,7 +205,7 @@ static inline bool xskq_cons_is_valid_desc(struct xsk_queue *q,
 		return false;
 
 	if (((d->addr + d->len) & q->chunk_mask) != (d->addr & q->chunk_mask) ||
-	    d->options) {
+	    xskq_cons_has_bad_options(q, d)) {
 		q->invalid_descs++;
 		return false;
 	}
@@ -216,6 +231,79 @@ static inline bool xskq_cons_read_desc(struct xsk_queue *q,
 	return false;
 }
 
+/* Batched variants of the readers above. They fill in up to @max
+ * entries starting at the local consumer pointer without moving it, so
+ * that the caller can release exactly the number of entries it used
+ * with xskq_cons_release_n(). Invalid entries at the head of the ring
+ * are skipped and accounted for just like in the single entry readers.
+ * An invalid entry further in terminates the batch instead, so that the
+ * returned entries always form one contiguous span of the ring. It is
+ * accounted for when it reaches the head of the ring in a later call.
+ */
+static inline u32 xskq_cons_read_addr_batch(struct xsk_queue *q, u64 *addrs,
+					    struct xdp_umem *umem, u32 max)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+	u32 cached_cons, nb_entries = 1;
+
+	if (!max || !xskq_cons_read_addr(q, &addrs[0], umem))
+		return 0;
+
+	cached_cons = q->cached_cons + 1;
+	while (cached_cons != q->cached_prod && nb_entries < max) {
+		u64 invalid_descs = q->invalid_descs;
+		u32 idx = cached_cons & q->ring_mask;
+		u64 addr = ring->desc[idx] & q->chunk_mask;
+		bool valid;
+
+		if (umem->flags & XDP_UMEM_UNALIGNED_CHUNK_FLAG)
+			valid = xskq_cons_is_valid_unaligned(q, addr,
+							     umem->chunk_size_nohr,
+							     umem);
+		else
+			valid = xskq_cons_is_valid_addr(q, addr);
+
+		if (unlikely(!valid)) {
+			q->invalid_descs = invalid_descs;
+			break;
+		}
+
+		addrs[nb_entries++] = addr;
+		cached_cons++;
+	}
+
+	return nb_entries;
+}
+
+static inline u32 xskq_cons_read_desc_batch(struct xsk_queue *q,
+					    struct xdp_desc *descs,
+					    struct xdp_umem *umem, u32 max)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 cached_cons, nb_entries = 1;
+
+	if (!max || !xskq_cons_read_desc(q, &descs[0], umem))
+		return 0;
+
+	cached_cons = q->cached_cons + 1;
+	while (cached_cons != q->cached_prod && nb_entries < max) {
+		u64 invalid_descs = q->invalid_descs;
+		u32 idx = cached_cons & q->ring_mask;
+
+		descs[nb_entries] = ring->desc[idx];
+		if (unlikely(!xskq_cons_is_valid_desc(q, &descs[nb_entries],
+						      umem))) {
+			q->invalid_descs = invalid_descs;
+			break;
+		}
+
+		nb_entries++;
+		cached_cons++;
+	}
+
+	return nb_entries;
+}
+
 /* Functions for consumers */
 
 static inline void __xskq_cons_release(struct xsk_queue *q)
@@ -277,6 +365,32 @@ static inline void xskq_cons_release(struct xsk_queue *q)
 	q->cached_cons++;
 }
 
+/* Refresh the producer pointer only if the entries already seen locally
+ * cannot satisfy the whole batch, so a batch costs at most one index
+ * refresh and one release barrier.
+ */
+static inline u32 xskq_cons_peek_addr_batch(struct xsk_queue *q, u64 *addrs,
+					    struct xdp_umem *umem, u32 max)
+{
+	if (q->cached_prod - q->cached_cons < max)
+		xskq_cons_get_entries(q);
+	return xskq_cons_read_addr_batch(q, addrs, umem, max);
+}
+
+static inline u32 xskq_cons_peek_desc_batch(struct xsk_queue *q,
+					    struct xdp_desc *descs,
+					    struct xdp_umem *umem, u32 max)
+{
+	if (q->cached_prod - q->cached_cons < max)
+		xskq_cons_get_entries(q);
+	return xskq_cons_read_desc_batch(q, descs, umem, max);
+}
+
+static inline void xskq_cons_release_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_cons += cnt;
+}
+
 static inline bool xskq_cons_is_full(struct xsk_queue *q)
 {
 	/* No barriers needed since data is not accessed */
@@ -310,6 +424,52 @@ static inline int xskq_prod_reserve(struct xsk_queue *q)
 	return 0;
 }
 
+static inline u32 xskq_prod_nb_free(struct xsk_queue *q, u32 max)
+{
+	u32 free_entries = q->nentries - (q->cached_prod - q->cached_cons);
+
+	if (free_entries >= max)
+		return max;
+
+	/* Refresh the local tail pointer */
+	q->cached_cons = READ_ONCE(q->ring->consumer);
+	free_entries = q->nentries - (q->cached_prod - q->cached_cons);
+
+	return min(free_entries, max);
+}
+
+static inline u32 xskq_prod_reserve_n(struct xsk_queue *q, u32 max)
+{
+	u32 nb_entries = xskq_prod_nb_free(q, max);
+
+	/* A, matches D */
+	q->cached_prod += nb_entries;
+	return nb_entries;
+}
+
+/* Give back entries that were reserved but never submitted. */
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
+static inline u32 xskq_prod_reserve_addr_batch(struct xsk_queue *q,
+					       struct xdp_desc *descs, u32 max)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+	u32 nb_entries, i, cached_prod;
+
+	nb_entries = xskq_prod_nb_free(q, max);
+
+	/* A, matches D */
+	cached_prod = q->cached_prod;
+	for (i = 0; i < nb_entries; i++)
+		ring->desc[cached_prod++ & q->ring_mask] = descs[i].addr;
+	q->cached_prod = cached_prod;
+
+	return nb_entries;
+}
+
 static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 {
 	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
@@ -323,7 +483,7 @@ static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 }
 
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 options)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -335,6 +495,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = options;
 
 	return 0;
 }
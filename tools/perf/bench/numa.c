@@ -121,6 +121,9 @@ struct params {
 	bool			show_convergence;
 	bool			measure_convergence;
 
+	/* Page migration between memory nodes: */
+	bool			migrate;
+
 	int			perturb_secs;
 	int			nr_cpus;
 	int			nr_nodes;
@@ -196,6 +199,7 @@ static const struct option options[] = {
 	OPT_BOOLEAN('c', "show_convergence", &p0.show_convergence, "show convergence details, "
 		    "convergence is reached when each process (all its threads) is running on a single NUMA node."),
 	OPT_BOOLEAN('m', "measure_convergence",	&p0.measure_convergence, "measure convergence latency"),
+	OPT_BOOLEAN('X', "migrate"	, &p0.migrate,		"measure move_pages() bandwidth and access latency between memory nodes"),
 	OPT_BOOLEAN('q', "quiet"	, &p0.show_quiet,	"quiet mode"),
 	OPT_BOOLEAN('S', "serialize-startup", &p0.serialize_startup,"serialize thread startup"),
 
@@ -1482,6 +1486,164 @@ static void print_res(const char *name, double val,
 		printf(" %14.3f %s\n", val, txt_long);
 }
 
+#define CHASE_STRIDE (64/sizeof(u64))
+
+/*
+ * Link the cachelines of the buffer into one randomly ordered cycle, so
+ * that walking it defeats the hardware prefetchers:
+ */
+static void setup_chase(u64 *data, long lines)
+{
+	long *perm = zalloc(lines * sizeof(*perm));
+	long i;
+
+	BUG_ON(!perm);
+
+	for (i = 0; i < lines; i++)
+		perm[i] = i;
+	for (i = lines - 1; i > 0; i--) {
+		long j = rand() % (i + 1);
+		long tmp = perm[i];
+
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+	for (i = 0; i < lines; i++)
+		data[perm[i] * CHASE_STRIDE] = perm[(i + 1) % lines];
+
+	free(perm);
+}
+
+/*
+ * Average latency of a dependent load, in nsecs:
+ */
+static double chase_latency(u64 *data, long lines)
+{
+	struct timeval start, stop, diff;
+	long steps = max(lines, 1000000L);
+	volatile u64 sink;
+	u64 idx = 0;
+	long i;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < steps; i++)
+		idx = data[idx * CHASE_STRIDE];
+	gettimeofday(&stop, NULL);
+	sink = idx;
+	(void)sink;
+
+	timersub(&stop, &start, &diff);
+
+	return (diff.tv_sec * NSEC_PER_SEC + diff.tv_usec * NSEC_PER_USEC) / (double)steps;
+}
+
+/*
+ * Move a buffer with move_pages() from every memory node to every other
+ * one, then walk it from the node of CPU#0. Memory-only nodes, such as
+ * PMEM or CXL memory onlined via dax/kmem, are valid sources and targets,
+ * so this shows both the migration bandwidth between tiers and what an
+ * access costs at each node distance.
+ */
+static int bench_migrate(const char *name)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+	long bytes = g->p.bytes_process ? : g->p.bytes_global;
+	long nr_pages = bytes / page_size;
+	long lines = bytes / 64;
+	int cpu_node = numa_node_of_cpu(0);
+	int *nodes, *status;
+	void **pages;
+	int src, dst;
+	long i;
+
+	if (nr_numa_nodes() < 2) {
+		printf(" # migration needs at least 2 memory nodes\n");
+		return -1;
+	}
+	BUG_ON(!nr_pages);
+
+	pages  = zalloc(nr_pages * sizeof(*pages));
+	nodes  = zalloc(nr_pages * sizeof(*nodes));
+	status = zalloc(nr_pages * sizeof(*status));
+	BUG_ON(!pages || !nodes || !status);
+
+	/* All accesses come from one place, the only variable is the memory: */
+	BUG_ON(numa_run_on_node(cpu_node));
+
+	for (src = 0; src < g->p.nr_nodes; src++) {
+		if (!is_node_present(src))
+			continue;
+
+		for (dst = 0; dst < g->p.nr_nodes; dst++) {
+			struct timeval start, stop, diff;
+			char res_name[64];
+			double runtime_sec;
+			long moved = 0;
+			u8 *buf;
+			long ret;
+
+			if (dst == src || !is_node_present(dst))
+				continue;
+
+			bind_to_memnode(src);
+			buf = setup_private_data(bytes);
+			setup_chase((u64 *)buf, lines);
+			mempol_restore();
+
+			for (i = 0; i < nr_pages; i++) {
+				pages[i] = buf + i * page_size;
+				nodes[i] = dst;
+			}
+
+			gettimeofday(&start, NULL);
+			ret = move_pages(0, nr_pages, pages, nodes, status, MPOL_MF_MOVE);
+			gettimeofday(&stop, NULL);
+			if (ret < 0) {
+				printf(" # move_pages(%d => %d) failed: %s\n", src, dst, strerror(errno));
+				free_data(buf, bytes);
+				continue;
+			}
+
+			/* A positive return is the number of pages left behind: */
+			for (i = 0; i < nr_pages; i++) {
+				if (status[i] == dst)
+					moved++;
+			}
+			if (ret > 0 || moved < nr_pages)
+				printf(" # move_pages(%d => %d): only %ld of %ld pages migrated\n",
+				       src, dst, moved, nr_pages);
+			if (!moved) {
+				free_data(buf, bytes);
+				continue;
+			}
+
+			timersub(&stop, &start, &diff);
+			runtime_sec = diff.tv_sec + diff.tv_usec / (double)USEC_PER_SEC;
+
+			snprintf(res_name, sizeof(res_name), "%s%d-to-%d,", name ? : "migrate-", src, dst);
+			print_res(res_name, moved * page_size / runtime_sec / 1e9,
+				  "GB/sec,", "migration bandwidth", "GB/sec migration bandwidth");
+			print_res(res_name, moved / runtime_sec,
+				  "pages/sec,", "migration rate", "pages/sec migration rate");
+
+			snprintf(res_name, sizeof(res_name), "%snode-%d-dist-%d,",
+				 name ? : "migrate-", dst, numa_distance(cpu_node, dst));
+			print_res(res_name, chase_latency((u64 *)buf, lines),
+				  "nsecs,", "access latency after migration", "nsecs access latency");
+
+			free_data(buf, bytes);
+		}
+	}
+
+	numa_run_on_node(-1);
+
+	free(status);
+	free(nodes);
+	free(pages);
+
+	return 0;
+}
+
 static int __bench_numa(const char *name)
 {
 	struct timeval start, stop, diff;
@@ -1498,6 +1660,13 @@ static int __bench_numa(const char *name)
 	if (init())
 		return -1;
 
+	if (g->p.migrate) {
+		int ret = bench_migrate(name);
+
+		deinit();
+		return ret;
+	}
+
 	pids = zalloc(g->p.nr_proc * sizeof(*pids));
 	pid = -1;
 
@@ -1751,6 +1920,9 @@ static const char *tests[][MAX_ARGS] = {
    { "RAM-bw-cross,",     "mem",  "-p",  "2",  "-t",  "1", "-P", "1024",
 		 	   "-C", "0,8", "-M", "1,0", OPT_BW_RAM },
 
+   /* Page migration bandwidth and access latency between all nodes: */
+   { "RAM-migrate-",	  "mem",  "-P",  "256", "-X", "-q", "--thp", "-1" },
+
    /* Convergence latency measurements: */
    { " 1x3-convergence,", "mem",  "-p",  "1", "-t",  "3", "-P",  "512", OPT_CONV },
    { " 1x4-convergence,", "mem",  "-p",  "1", "-t",  "4", "-P",  "512", OPT_CONV },
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * pipe-splice: Measure pipe throughput for the copying and the zero-copy paths.
+ *
+ * Every pair of threads shares a pipe: the writer pushes buffers into it with
+ * write(2), or maps them in with vmsplice(2), and the reader drains it with
+ * read(2), or moves the pages to /dev/null with splice(2).
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/zalloc.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <internal/cpumap.h>
+#include <perf/cpumap.h>
+
+#include "../util/stat.h"
+#include <subcmd/parse-options.h>
+#include "bench.h"
+
+static unsigned int npairs = 0;
+static unsigned int nsecs  = 10;
+static unsigned int bufsize = 64 * 1024;
+static unsigned int pipesize = 0;
+static bool use_vmsplice = false, use_splice = false;
+static bool done = false, silent = false;
+
+static struct timeval start, end, runtime;
+static pthread_mutex_t thread_lock;
+static unsigned int threads_starting;
+static struct stats throughput_stats;
+static pthread_cond_t thread_parent, thread_worker;
+
+struct pipe_pair {
+	int id;
+	int fds[2];
+	int devnull;
+	void *buf;
+	pthread_t writer, reader;
+	unsigned long bytes;
+};
+
+static const struct option options[] = {
+	OPT_UINTEGER('p', "pairs",    &npairs,       "Specify amount of writer/reader pairs"),
+	OPT_UINTEGER('r', "runtime",  &nsecs,        "Specify runtime (in seconds)"),
+	OPT_UINTEGER('b', "bufsize",  &bufsize,      "Specify size of each transfer (in bytes)"),
+	OPT_UINTEGER('P', "pipesize", &pipesize,     "Resize the pipes with F_SETPIPE_SZ (in bytes)"),
+	OPT_BOOLEAN( 'v', "vmsplice", &use_vmsplice, "Use vmsplice() instead of write() on the writer side"),
+	OPT_BOOLEAN( 'S', "splice",   &use_splice,   "Use splice() to /dev/null instead of read() on the reader side"),
+	OPT_BOOLEAN( 's', "silent",   &silent,       "Silent mode: do not display data/details"),
+	OPT_END()
+};
+
+static const char * const bench_pipe_splice_usage[] = {
+	"perf bench pipe splice <options>",
+	NULL
+};
+
+static void wait_for_start(void)
+{
+	pthread_mutex_lock(&thread_lock);
+	threads_starting--;
+	if (!threads_starting)
+		pthread_cond_signal(&thread_parent);
+	pthread_cond_wait(&thread_worker, &thread_lock);
+	pthread_mutex_unlock(&thread_lock);
+}
+
+static void *writerfn(void *arg)
+{
+	struct pipe_pair *p = arg;
+	struct iovec iov = { .iov_base = p->buf, .iov_len = bufsize };
+	ssize_t ret;
+
+	wait_for_start();
+
+	while (!done) {
+		if (use_vmsplice)
+			ret = vmsplice(p->fds[1], &iov, 1, 0);
+		else
+			ret = write(p->fds[1], p->buf, bufsize);
+		if (ret < 0 && errno != EINTR)
+			err(EXIT_FAILURE, use_vmsplice ? "vmsplice" : "write");
+	}
+
+	/* let the reader see EOF once it has drained the pipe */
+	close(p->fds[1]);
+	return NULL;
+}
+
+static void *readerfn(void *arg)
+{
+	struct pipe_pair *p = arg;
+	unsigned long bytes = 0; /* avoid cacheline bouncing */
+	ssize_t ret;
+
+	wait_for_start();
+
+	for (;;) {
+		if (use_splice)
+			ret = splice(p->fds[0], NULL, p->devnull, NULL,
+				     bufsize, SPLICE_F_MOVE);
+		else
+			ret = read(p->fds[0], p->buf, bufsize);
+		if (!ret)
+			break;
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, use_splice ? "splice" : "read");
+		}
+		if (!done)
+			bytes += ret;
+	}
+
+	p->bytes = bytes;
+	return NULL;
+}
+
+static void toggle_done(int sig __maybe_unused,
+			siginfo_t *info __maybe_unused,
+			void *uc __maybe_unused)
+{
+	/* inform all threads that we're done for the day */
+	done = true;
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &runtime);
+}
+
+static void print_summary(void)
+{
+	unsigned long avg = avg_stats(&throughput_stats);
+	double stddev = stddev_stats(&throughput_stats);
+
+	printf("%sAveraged %ld bytes/sec (+- %.2f%%), total secs = %d\n",
+	       !silent ? "\n" : "", avg, rel_stddev_stats(stddev, avg),
+	       (int) runtime.tv_sec);
+}
+
+static void start_thread(pthread_t *thread, pthread_attr_t *attr, int cpu,
+			 void *(*fn)(void *), struct pipe_pair *p)
+{
+	cpu_set_t cpuset;
+	int ret;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+
+	ret = pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &cpuset);
+	if (ret)
+		err(EXIT_FAILURE, "pthread_attr_setaffinity_np");
+
+	ret = pthread_create(thread, attr, fn, p);
+	if (ret)
+		err(EXIT_FAILURE, "pthread_create");
+}
+
+int bench_pipe_splice(int argc, const char **argv)
+{
+	int ret = 0;
+	struct sigaction act;
+	unsigned int i;
+	pthread_attr_t thread_attr;
+	struct pipe_pair *pairs = NULL;
+	struct perf_cpu_map *cpu;
+
+	argc = parse_options(argc, argv, options, bench_pipe_splice_usage, 0);
+	if (argc || !bufsize) {
+		usage_with_options(bench_pipe_splice_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	cpu = perf_cpu_map__new(NULL);
+	if (!cpu)
+		goto errmem;
+
+	sigfillset(&act.sa_mask);
+	act.sa_sigaction = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+
+	if (!npairs) /* default to one writer and one reader per CPU */
+		npairs = max(cpu->nr / 2, 1);
+
+	pairs = calloc(npairs, sizeof(*pairs));
+	if (!pairs)
+		goto errmem;
+
+	printf("Run summary [PID %d]: %d pairs, %s -> pipe -> %s, %d bytes per transfer for %d secs.\n\n",
+	       getpid(), npairs, use_vmsplice ? "vmsplice" : "write",
+	       use_splice ? "splice" : "read", bufsize, nsecs);
+
+	init_stats(&throughput_stats);
+	pthread_mutex_init(&thread_lock, NULL);
+	pthread_cond_init(&thread_parent, NULL);
+	pthread_cond_init(&thread_worker, NULL);
+
+	threads_starting = 2 * npairs;
+	pthread_attr_init(&thread_attr);
+	for (i = 0; i < npairs; i++) {
+		struct pipe_pair *p = &pairs[i];
+
+		p->id = i;
+		if (pipe(p->fds))
+			err(EXIT_FAILURE, "pipe");
+		if (pipesize && fcntl(p->fds[0], F_SETPIPE_SZ, pipesize) < 0)
+			err(EXIT_FAILURE, "fcntl(F_SETPIPE_SZ)");
+
+		p->devnull = -1;
+		if (use_splice) {
+			p->devnull = open("/dev/null", O_WRONLY);
+			if (p->devnull < 0)
+				err(EXIT_FAILURE, "open(/dev/null)");
+		}
+
+		/* page aligned, so that vmsplice() hands over whole pages */
+		if (posix_memalign(&p->buf, sysconf(_SC_PAGESIZE), bufsize))
+			goto errmem;
+		memset(p->buf, i, bufsize);
+
+		start_thread(&p->writer, &thread_attr,
+			     cpu->map[(2 * i) % cpu->nr], writerfn, p);
+		start_thread(&p->reader, &thread_attr,
+			     cpu->map[(2 * i + 1) % cpu->nr], readerfn, p);
+	}
+	pthread_attr_destroy(&thread_attr);
+
+	pthread_mutex_lock(&thread_lock);
+	while (threads_starting)
+		pthread_cond_wait(&thread_parent, &thread_lock);
+	gettimeofday(&start, NULL);
+	pthread_cond_broadcast(&thread_worker);
+	pthread_mutex_unlock(&thread_lock);
+
+	sleep(nsecs);
+	toggle_done(0, NULL, NULL);
+
+	for (i = 0; i < npairs; i++) {
+		ret = pthread_join(pairs[i].writer, NULL);
+		if (ret)
+			err(EXIT_FAILURE, "pthread_join");
+		ret = pthread_join(pairs[i].reader, NULL);
+		if (ret)
+			err(EXIT_FAILURE, "pthread_join");
+	}
+
+	/* cleanup & report results */
+	pthread_cond_destroy(&thread_parent);
+	pthread_cond_destroy(&thread_worker);
+	pthread_mutex_destroy(&thread_lock);
+
+	for (i = 0; i < npairs; i++) {
+		unsigned long t = pairs[i].bytes / runtime.tv_sec;
+
+		update_stats(&throughput_stats, t);
+		if (!silent)
+			printf("[pair %2d] %ld bytes/sec (%.2f GB/sec)\n",
+			       pairs[i].id, t, (double)t / (1ULL << 30));
+
+		close(pairs[i].fds[0]);
+		if (pairs[i].devnull >= 0)
+			close(pairs[i].devnull);
+		zfree(&pairs[i].buf);
+	}
+
+	print_summary();
+
+	free(pairs);
+	free(cpu);
+	return ret;
+errmem:
+	err(EXIT_FAILURE, "calloc");
+}
@@ -0,0 +1,72 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measure how zram read throughput scales with the number of concurrent
+# readers. The device is filled with same-filled (zero) pages and with
+# compressible data in two halves, then read back by 1, 2, 4, ... up to
+# nproc parallel dd jobs, each reading its own region of the disk.
+#
+# Usage: ./zram_scaling.sh [disksize in MB]
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+size_mb=${1:-512}
+dev_id=
+dev=
+
+cleanup()
+{
+	[ -n "$dev" ] || return
+	echo 1 > /sys/block/zram$dev_id/reset
+	echo $dev_id > /sys/class/zram-control/hot_remove
+}
+
+if [ $UID != 0 ]; then
+	echo "$0: must be run as root"
+	exit $ksft_skip
+fi
+
+if [ ! -d /sys/class/zram-control ]; then
+	modprobe zram num_devices=0 > /dev/null 2>&1 || {
+		echo "$0: zram module not available"
+		exit $ksft_skip
+	}
+fi
+
+dev_id=$(cat /sys/class/zram-control/hot_add) || exit 1
+dev=/dev/zram$dev_id
+trap cleanup EXIT
+
+echo ${size_mb}M > /sys/block/zram$dev_id/disksize || exit 1
+
+half=$((size_mb / 2))
+dd if=/dev/zero of=$dev bs=1M count=$half oflag=direct status=none
+yes "zram scaling benchmark" | dd of=$dev bs=1M seek=$half \
+	count=$((size_mb - half)) iflag=fullblock oflag=direct status=none
+
+echo "zram$dev_id mm_stat: $(cat /sys/block/zram$dev_id/mm_stat)"
+printf "%8s %12s\n" "readers" "MB/s"
+
+nr_cpus=$(nproc)
+jobs=1
+while [ $jobs -le $nr_cpus ]; do
+	chunk=$((size_mb / jobs))
+	start=$(date +%s%N)
+	for i in $(seq 0 $((jobs - 1))); do
+		dd if=$dev of=/dev/null bs=1M skip=$((i * chunk)) \
+			count=$chunk iflag=direct status=none &
+	done
+	wait
+	end=$(date +%s%N)
+
+	ns=$((end - start))
+	[ $ns -gt 0 ] || ns=1
+	printf "%8d %12d\n" $jobs $((chunk * jobs * 1000000000 / ns))
+
+	[ $jobs -eq $nr_cpus ] && break
+	jobs=$((jobs * 2))
+	[ $jobs -gt $nr_cpus ] && jobs=$nr_cpus
+done
+
+exit 0
@@ -19,6 +19,15 @@
 
 static struct kmem_cache *async_pf_cache;
 
+/*
+ * Number of pages following the faulting one that are faulted in by the
+ * same work item, never crossing a huge page boundary or the end of the
+ * VMA.  Helps guests whose memory is arriving from a post-copy migration
+ * or swap, where neighbouring pages are usually missing too.
+ */
+static unsigned int async_pf_prefetch_pages;
+module_param(async_pf_prefetch_pages, uint, 0644);
+
 int kvm_async_pf_init(void)
 {
 	async_pf_cache = KMEM_CACHE(kvm_async_pf, 0);
@@ -42,6 +51,42 @@ void kvm_async_pf_vcpu_init(struct kvm_vcpu *vcpu)
 	spin_lock_init(&vcpu->async_pf.lock);
 }
 
+/*
+ * Runs after the completion for @addr has been queued, so that the vCPU
+ * does not wait for the neighbours to arrive.
+ */
+static void async_pf_prefetch(struct mm_struct *mm, unsigned long addr)
+{
+	unsigned int nr = READ_ONCE(async_pf_prefetch_pages);
+	struct vm_area_struct *vma;
+	unsigned long start, end;
+	int locked = 1;
+
+	if (!nr)
+		return;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, addr);
+	if (!vma || vma->vm_start > addr)
+		goto out;
+
+	start = (addr & PAGE_MASK) + PAGE_SIZE;
+	end = min3(ALIGN(start, PMD_SIZE), vma->vm_end,
+		   start + min_t(unsigned long, nr, PTRS_PER_PMD) * PAGE_SIZE);
+	if (start >= end)
+		goto out;
+
+	/*
+	 * Read faults only: they bring in swapped-out or missing pages
+	 * without allocating memory the guest has never written to.
+	 */
+	get_user_pages_remote(NULL, mm, start, (end - start) >> PAGE_SHIFT, 0,
+			      NULL, NULL, &locked);
+out:
+	if (locked)
+		up_read(&mm->mmap_sem);
+}
+
 static void async_pf_execute(struct work_struct *work)
 {
 	struct kvm_async_pf *apf =
@@ -83,6 +128,8 @@ static void async_pf_execute(struct work_struct *work)
 	if (swq_has_sleeper(&vcpu->wq))
 		swake_up_one(&vcpu->wq);
 
+	async_pf_prefetch(mm, addr);
+
 	mmput(mm);
 	kvm_put_kvm(vcpu->kvm);
 }
@@ -52,7 +52,7 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	 * there is always one unused entry in the buffer
 	 */
 	ring = dev->kvm->coalesced_mmio_ring;
-	avail = (ring->first - last - 1) % KVM_COALESCED_MMIO_MAX;
+	avail = (READ_ONCE(ring->first) - last - 1) % KVM_COALESCED_MMIO_MAX;
 	if (avail == 0) {
 		/* full */
 		return 0;
@@ -72,6 +72,18 @@ static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 	if (!coalesced_mmio_in_range(dev, addr, len))
 		return -EOPNOTSUPP;
 
+	/* Larger accesses don't fit an entry, let userspace handle them */
+	if (len > sizeof(ring->coalesced_mmio[0].data))
+		return -EOPNOTSUPP;
+
+	/*
+	 * Once the ring is full every vCPU writing to a zone exits until
+	 * userspace drains it.  Don't make them all bounce the ring lock on
+	 * the way out; the check is repeated under the lock.
+	 */
+	if (!coalesced_mmio_has_room(dev, READ_ONCE(ring->last)))
+		return -EOPNOTSUPP;
+
 	spin_lock(&dev->kvm->ring_lock);
 
 	insert = READ_ONCE(ring->last);
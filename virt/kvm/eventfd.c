@@ -23,6 +23,8 @@
 #include <linux/srcu.h>
 #include <linux/slab.h>
 #include <linux/seqlock.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
 #include <linux/irqbypass.h>
 #include <trace/events/kvm.h>
 
@@ -44,12 +46,21 @@ irqfd_inject(struct work_struct *work)
 	struct kvm_kernel_irqfd *irqfd =
 		container_of(work, struct kvm_kernel_irqfd, inject);
 	struct kvm *kvm = irqfd->kvm;
+	unsigned seq;
+	u32 type;
 
 	if (!irqfd->resampler) {
+		do {
+			seq = read_seqcount_begin(&irqfd->irq_entry_sc);
+			type = irqfd->irq_entry.type;
+		} while (read_seqcount_retry(&irqfd->irq_entry_sc, seq));
+
 		kvm_set_irq(kvm, KVM_USERSPACE_IRQ_SOURCE_ID, irqfd->gsi, 1,
 				false);
-		kvm_set_irq(kvm, KVM_USERSPACE_IRQ_SOURCE_ID, irqfd->gsi, 0,
-				false);
+		/* MSIs are edge triggered, there is nothing to de-assert */
+		if (type != KVM_IRQ_ROUTING_MSI)
+			kvm_set_irq(kvm, KVM_USERSPACE_IRQ_SOURCE_ID,
+				    irqfd->gsi, 0, false);
 	} else
 		kvm_set_irq(kvm, KVM_IRQFD_RESAMPLE_IRQ_SOURCE_ID,
 			    irqfd->gsi, 1, false);
@@ -136,6 +147,12 @@ irqfd_shutdown(struct work_struct *work)
 		eventfd_ctx_put(irqfd->resamplefd);
 	}
 
+	spin_lock_irq(&kvm->irqfds.lock);
+	kvm->irqfds.inject_inline += irqfd->inject_inline;
+	kvm->irqfds.inject_deferred += irqfd->inject_deferred;
+	kvm->irqfds.inject_coalesced += irqfd->inject_coalesced;
+	spin_unlock_irq(&kvm->irqfds.lock);
+
 	/*
 	 * It is now safe to release the object's resources
 	 */
@@ -198,11 +215,19 @@ irqfd_wakeup(wait_queue_entry_t *wait, unsigned mode, int sync, void *key)
 			seq = read_seqcount_begin(&irqfd->irq_entry_sc);
 			irq = irqfd->irq_entry;
 		} while (read_seqcount_retry(&irqfd->irq_entry_sc, seq));
-		/* An event has been signaled, inject an interrupt */
+		/*
+		 * An event has been signaled, inject an interrupt.  If that
+		 * can't be done from here, a still pending inject work will
+		 * deliver this signal together with the earlier ones.
+		 */
 		if (kvm_arch_set_irq_inatomic(&irq, kvm,
 					      KVM_USERSPACE_IRQ_SOURCE_ID, 1,
-					      false) == -EWOULDBLOCK)
-			schedule_work(&irqfd->inject);
+					      false) != -EWOULDBLOCK)
+			irqfd->inject_inline++;
+		else if (schedule_work(&irqfd->inject))
+			irqfd->inject_deferred++;
+		else
+			irqfd->inject_coalesced++;
 		srcu_read_unlock(&kvm->irq_srcu, idx);
 	}
 
@@ -625,6 +650,40 @@ void kvm_irq_routing_update(struct kvm *kvm)
 	spin_unlock_irq(&kvm->irqfds.lock);
 }
 
+static int irqfd_stats_show(struct seq_file *m, void *v)
+{
+	struct kvm *kvm = m->private;
+	struct kvm_kernel_irqfd *irqfd;
+	u64 inject_inline, inject_deferred, inject_coalesced;
+
+	spin_lock_irq(&kvm->irqfds.lock);
+	inject_inline = kvm->irqfds.inject_inline;
+	inject_deferred = kvm->irqfds.inject_deferred;
+	inject_coalesced = kvm->irqfds.inject_coalesced;
+	list_for_each_entry(irqfd, &kvm->irqfds.items, list) {
+		inject_inline += READ_ONCE(irqfd->inject_inline);
+		inject_deferred += READ_ONCE(irqfd->inject_deferred);
+		inject_coalesced += READ_ONCE(irqfd->inject_coalesced);
+	}
+	spin_unlock_irq(&kvm->irqfds.lock);
+
+	seq_printf(m, "inline %llu\ndeferred %llu\ncoalesced %llu\n",
+		   inject_inline, inject_deferred, inject_coalesced);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(irqfd_stats);
+
+/*
+ * inline: signals injected directly from the eventfd wakeup, which includes
+ * posting them to the vCPU.  deferred: signals that needed the inject work.
+ * coalesced: signals merged into an inject work that was still pending.
+ */
+void kvm_irqfd_create_debugfs(struct kvm *kvm)
+{
+	debugfs_create_file("irqfd_stats", 0444, kvm->debugfs_dentry, kvm,
+			    &irqfd_stats_fops);
+}
+
 /*
  * create a host-wide workqueue for issuing deferred shutdown requests
  * aggregated from all vm* instances. We need our own isolated
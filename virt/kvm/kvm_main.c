@@ -51,6 +51,8 @@
 #include <linux/io.h>
 #include <linux/lockdep.h>
 #include <linux/kthread.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
 
 #include <asm/processor.h>
 #include <asm/ioctl.h>
@@ -90,6 +92,19 @@ unsigned int halt_poll_ns_shrink;
 module_param(halt_poll_ns_shrink, uint, 0644);
 EXPORT_SYMBOL_GPL(halt_poll_ns_shrink);
 
+/*
+ * Pick the per-vcpu poll window from a histogram of recent block times
+ * instead of growing and shrinking it geometrically.
+ */
+bool halt_poll_adaptive;
+module_param(halt_poll_adaptive, bool, 0644);
+EXPORT_SYMBOL_GPL(halt_poll_adaptive);
+
+/* Share of recent wakeups the adaptive window tries to catch by polling */
+unsigned int halt_poll_adaptive_pct = 80;
+module_param(halt_poll_adaptive_pct, uint, 0644);
+EXPORT_SYMBOL_GPL(halt_poll_adaptive_pct);
+
 /*
  * Ordering of locks:
  *
@@ -653,6 +668,8 @@ static int kvm_create_vm_debugfs(struct kvm *kvm, int fd)
 				    kvm->debugfs_dentry, stat_data,
 				    &stat_fops_per_vm);
 	}
+
+	kvm_irqfd_create_debugfs(kvm);
 	return 0;
 }
 
@@ -1267,15 +1284,21 @@ int kvm_get_dirty_log_protect(struct kvm *kvm,
 		dirty_bitmap_buffer = dirty_bitmap;
 	} else {
 		dirty_bitmap_buffer = kvm_second_dirty_bitmap(memslot);
-		memset(dirty_bitmap_buffer, 0, n);
 
+		/*
+		 * Every word of the snapshot is written below, so there is
+		 * no need to clear it up front: that would be a second pass
+		 * over a bitmap that is megabytes long for a big slot.
+		 */
 		spin_lock(&kvm->mmu_lock);
 		for (i = 0; i < n / sizeof(long); i++) {
 			unsigned long mask;
 			gfn_t offset;
 
-			if (!dirty_bitmap[i])
+			if (!dirty_bitmap[i]) {
+				dirty_bitmap_buffer[i] = 0;
 				continue;
+			}
 
 			*flush = true;
 			mask = xchg(&dirty_bitmap[i], 0);
@@ -2439,6 +2462,61 @@ static void shrink_halt_poll_ns(struct kvm_vcpu *vcpu)
 	trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
 }
 
+/* Samples after which the histogram is halved, so it follows the guest */
+#define HALT_POLL_HIST_DECAY	128
+
+static unsigned int halt_poll_hist_bucket(u64 block_ns)
+{
+	if (block_ns < 1024)
+		return 0;
+	return min_t(unsigned int, ilog2(block_ns) - 9,
+		     KVM_HALT_POLL_HIST_BUCKETS - 1);
+}
+
+/*
+ * Record a valid wakeup and set the poll window to the shortest bucket
+ * boundary that would have caught halt_poll_adaptive_pct percent of the
+ * recent ones.  halt_poll_ns stays the CPU budget: if catching that many
+ * wakeups would take a longer window, polling is mostly wasted and is
+ * turned off until the distribution moves.
+ */
+static void adapt_halt_poll_ns(struct kvm_vcpu *vcpu, u64 block_ns)
+{
+	unsigned int old = vcpu->halt_poll_ns, val = 0;
+	u32 *hist = vcpu->halt_poll_hist;
+	u64 want, seen = 0;
+	int i;
+
+	hist[halt_poll_hist_bucket(block_ns)]++;
+	if (++vcpu->halt_poll_hist_samples >= HALT_POLL_HIST_DECAY) {
+		vcpu->halt_poll_hist_samples = 0;
+		for (i = 0; i < KVM_HALT_POLL_HIST_BUCKETS; i++) {
+			hist[i] >>= 1;
+			vcpu->halt_poll_hist_samples += hist[i];
+		}
+	}
+
+	want = (u64)vcpu->halt_poll_hist_samples *
+	       min(READ_ONCE(halt_poll_adaptive_pct), 100U);
+	for (i = 0; i < KVM_HALT_POLL_HIST_BUCKETS - 1; i++) {
+		u64 window = 1ULL << (i + 10);
+
+		if (window > halt_poll_ns)
+			break;
+		seen += hist[i];
+		if (seen * 100 >= want) {
+			val = window;
+			break;
+		}
+	}
+
+	vcpu->halt_poll_ns = val;
+	if (val > old)
+		trace_kvm_halt_poll_ns_grow(vcpu->vcpu_id, val, old);
+	else if (val < old)
+		trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
+}
+
 static int kvm_vcpu_check_block(struct kvm_vcpu *vcpu)
 {
 	int ret = -EINTR;
@@ -2510,6 +2588,8 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 	if (!kvm_arch_no_poll(vcpu)) {
 		if (!vcpu_valid_wakeup(vcpu)) {
 			shrink_halt_poll_ns(vcpu);
+		} else if (halt_poll_ns && READ_ONCE(halt_poll_adaptive)) {
+			adapt_halt_poll_ns(vcpu, block_ns);
 		} else if (halt_poll_ns) {
 			if (block_ns <= vcpu->halt_poll_ns)
 				;
@@ -2764,9 +2844,23 @@ static int create_vcpu_fd(struct kvm_vcpu *vcpu)
 	return anon_inode_getfd(name, &kvm_vcpu_fops, vcpu, O_RDWR | O_CLOEXEC);
 }
 
+static int vcpu_halt_poll_hist_show(struct seq_file *m, void *v)
+{
+	struct kvm_vcpu *vcpu = m->private;
+	int i;
+
+	for (i = 0; i < KVM_HALT_POLL_HIST_BUCKETS; i++)
+		seq_printf(m, "%s%llu %u\n",
+			   i == KVM_HALT_POLL_HIST_BUCKETS - 1 ? ">=" : "<",
+			   i == KVM_HALT_POLL_HIST_BUCKETS - 1 ?
+				1ULL << (i + 9) : 1ULL << (i + 10),
+			   READ_ONCE(vcpu->halt_poll_hist[i]));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vcpu_halt_poll_hist);
+
 static void kvm_create_vcpu_debugfs(struct kvm_vcpu *vcpu)
 {
-#ifdef __KVM_HAVE_ARCH_VCPU_DEBUGFS
 	char dir_name[ITOA_MAX_LEN * 2];
 
 	if (!debugfs_initialized())
@@ -2776,6 +2870,10 @@ static void kvm_create_vcpu_debugfs(struct kvm_vcpu *vcpu)
 	vcpu->debugfs_dentry = debugfs_create_dir(dir_name,
 						  vcpu->kvm->debugfs_dentry);
 
+	debugfs_create_file("halt_poll_hist", 0444, vcpu->debugfs_dentry,
+			    vcpu, &vcpu_halt_poll_hist_fops);
+
+#ifdef __KVM_HAVE_ARCH_VCPU_DEBUGFS
 	kvm_arch_create_vcpu_debugfs(vcpu);
 #endif
 }